@@ -16,6 +16,7 @@
 #endif // HAVE_GCC_ABI_DEMANGLE
 
 #include "kp_kernel_timer.h"
+#include "kp_kernel_publisher.h"
 
 #include <ldms/ldms.h>
 #include <ldms/ldmsd_stream.h>
@@ -103,7 +104,24 @@ class KernelPerformanceInfo {
 			addTime(sample_time);
 			incrementCount();
 
-			if( (*ldms_publish) ) {
+			if( (*ldms_publish) && kernel_publisher.isRunning() ) {
+				// leave the formatting and the publishing to the
+				// publisher thread
+				if( !kernel_publisher.isAggregate() &&
+				    ( (callCount - 1) % kernel_publisher.getSampleEvery() ) )
+					return;
+
+				KernelEvent ev;
+				ev.name = kernelName;
+				ev.end = now;
+				ev.time = sample_time;
+				ev.total_time = total_time;
+				ev.count = callCount;
+				ev.total_count = kernel_ex * kernelSampleRate;
+				ev.level = nestingLevel;
+				ev.type = (uint8_t) kType;
+				kernel_publisher.enqueue(ev);
+			} else if( (*ldms_publish) ) {
 				const int buffer_size = (NULL == kernelName) ? 4096 :
 					( strlen(kernelName) > 3072 ? 2048 + strlen(kernelName) : 4096 );
 
@@ -3,7 +3,7 @@
 #include <execinfo.h>
 #include <cstdlib>
 #include <cstring>
-#include <map>
+#include <unordered_map>
 #include <vector>
 #include <algorithm>
 #include <string>
@@ -13,6 +13,7 @@
 #include <limits.h>
 #include "kp_kernel_timer.h"
 #include "kp_kernel_info.h"
+#include "kp_kernel_publisher.h"
 #include "kp_all.hpp"
 
 #include <ldms/ldms.h>
@@ -23,7 +24,7 @@ using namespace KokkosTools;
 
 static uint64_t uniqID = 0;
 static KernelPerformanceInfo* currentEntry;
-static std::map<std::string, KernelPerformanceInfo*> count_map;
+static std::unordered_map<std::string, KernelPerformanceInfo*> count_map;
 static double initTime;
 static uint64_t initTimeEpochMS;
 static char* outputDelimiter;
@@ -40,8 +41,9 @@ static char hostname_kp[HOST_NAME_MAX];
 
 void increment_counter(const char* name, KernelExecutionType kType) {
 	std::string nameStr(name);
+	std::unordered_map<std::string, KernelPerformanceInfo*>::iterator it = count_map.find(nameStr);
 
-	if(count_map.find(name) == count_map.end()) {
+	if(it == count_map.end()) {
 		KernelPerformanceInfo* info = new KernelPerformanceInfo(nameStr, kType, &ldms, hostname_kp,
 				slurm_rank, slurm_job_id, initTime, initTimeEpochMS,
 				0, tool_verbosity, &ldms_publish);
@@ -49,7 +51,7 @@ void increment_counter(const char* name, KernelExecutionType kType) {
 
 		currentEntry = info;
 	} else {
-		currentEntry = count_map[nameStr];
+		currentEntry = it->second;
 	}
 
 	currentEntry->startTimer();
@@ -57,8 +59,9 @@ void increment_counter(const char* name, KernelExecutionType kType) {
 
 void increment_counter_region(const char* name, KernelExecutionType kType) {
 	std::string nameStr(name);
+	std::unordered_map<std::string, KernelPerformanceInfo*>::iterator it = count_map.find(nameStr);
 
-	if(count_map.find(name) == count_map.end()) {
+	if(it == count_map.end()) {
 		KernelPerformanceInfo* info = new KernelPerformanceInfo(nameStr, kType, &ldms, hostname_kp,
 				slurm_rank, slurm_job_id, initTime, initTimeEpochMS,
 				0, tool_verbosity, &ldms_publish);
@@ -66,7 +69,7 @@ void increment_counter_region(const char* name, KernelExecutionType kType) {
 
 		regions[current_region_level] = info;
 	} else {
-		regions[current_region_level] = count_map[nameStr];
+		regions[current_region_level] = it->second;
 	}
 
 	regions[current_region_level]->startTimer();
@@ -182,10 +185,13 @@ extern "C" void kokkosp_init_library(const int loadSeq,
 
 	initTime = seconds();
 	initTimeEpochMS = getEpochMS();
+
+	kernel_publisher.start(&ldms, &ldms_publish, hostname_kp, slurm_rank,
+		slurm_job_id, initTime, initTimeEpochMS, tool_verbosity);
 }
 
 extern "C" void kokkosp_finalize_library() {
-
+	kernel_publisher.finish();
 }
 
 extern "C" void kokkosp_begin_parallel_for(const char* name, const uint32_t devID, uint64_t* kID) {
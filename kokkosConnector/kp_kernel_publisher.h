@@ -0,0 +1,338 @@
+
+#ifndef _H_KOKKOS_LDMS_CONNECTOR_PUBLISHER
+#define _H_KOKKOS_LDMS_CONNECTOR_PUBLISHER
+
+/*
+ * Background publisher of the kernel events.
+ *
+ * The Kokkos callbacks only append a fixed-size KernelEvent to a ring owned
+ * by the calling thread. A publisher thread drains the rings every flush
+ * interval, or sooner when a ring holds the flush threshold of events, and
+ * publishes the events in one "kokkos-perf-data" stream message (one entry
+ * per event in the "kokkos-perf-data" list). In the aggregate mode, the
+ * publisher sums the count and the time of each kernel over the interval
+ * instead, and publishes one entry per kernel.
+ *
+ * Environment variables:
+ *   KOKKOS_LDMS_ASYNC         0 to publish each event from the callback
+ *                             (default 1)
+ *   KOKKOS_LDMS_MODE          "events" (default) or "aggregate"
+ *   KOKKOS_LDMS_SAMPLE        in the events mode, publish only every N-th
+ *                             completion of each kernel (default 1)
+ *   KOKKOS_LDMS_FLUSH_MS      flush interval in milliseconds (default 1000)
+ *   KOKKOS_LDMS_FLUSH_EVENTS  flush when a ring holds N events (default 1024)
+ *   KOKKOS_LDMS_RING_SIZE     events per thread ring, rounded up to a power
+ *                             of 2 (default 8192)
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+
+#include "kp_kernel_timer.h"
+
+#include <ldms/ldms.h>
+#include <ldms/ldmsd_stream.h>
+
+/* stream messages are split above this size */
+#define KP_PUBLISHER_MSG_MAX (60 * 1024)
+
+/* A completed kernel. `name` is owned by the KernelPerformanceInfo of the
+ * kernel, which is never deleted. */
+struct KernelEvent {
+	const char* name;
+	double end;		/* seconds(), at completion */
+	double time;		/* the kernel time */
+	double total_time;	/* the time of all kernels so far */
+	uint64_t count;		/* completions of this kernel so far */
+	uint64_t total_count;	/* completions of all kernels so far */
+	uint16_t level;
+	uint8_t type;
+};
+
+/* single-producer (the owner thread), single-consumer (the publisher) */
+class KernelEventRing {
+	public:
+		KernelEventRing(uint64_t size) : head(0), tail(0), drops(0) {
+			uint64_t n = 1;
+			while (n < size)
+				n <<= 1;
+			mask = n - 1;
+			events.resize(n);
+		}
+
+		/* Returns the number of queued events, or 0 if the ring is full
+		 * and the event is dropped. */
+		uint64_t push(const KernelEvent& ev) {
+			const uint64_t t = tail.load(std::memory_order_relaxed);
+			const uint64_t n = t - head.load(std::memory_order_acquire);
+			if (n > mask) {
+				drops.fetch_add(1, std::memory_order_relaxed);
+				return 0;
+			}
+			events[t & mask] = ev;
+			tail.store(t + 1, std::memory_order_release);
+			return n + 1;
+		}
+
+		bool pop(KernelEvent& ev) {
+			const uint64_t h = head.load(std::memory_order_relaxed);
+			if (h == tail.load(std::memory_order_acquire))
+				return false;
+			ev = events[h & mask];
+			head.store(h + 1, std::memory_order_release);
+			return true;
+		}
+
+		uint64_t takeDrops() {
+			return drops.exchange(0, std::memory_order_relaxed);
+		}
+
+	private:
+		std::atomic<uint64_t> head;
+		char pad[64 - sizeof(std::atomic<uint64_t>)]; /* head and tail on separate cache lines */
+		std::atomic<uint64_t> tail;
+		std::atomic<uint64_t> drops;
+		uint64_t mask;
+		std::vector<KernelEvent> events;
+};
+
+/* the per-interval sums of a kernel in the aggregate mode */
+struct KernelAggregate {
+	uint64_t count;
+	double time;
+	KernelEvent last;
+};
+
+class KernelPublisher {
+	public:
+		KernelPublisher() : running(false), stop(false), wake(false),
+			drops(0), lastEnd(0), aggregate(false), sampleEvery(1), flushEvents(1024),
+			ringSize(8192), flushMS(1000) {}
+
+		bool isRunning() {
+			return running.load(std::memory_order_relaxed);
+		}
+
+		bool isAggregate() {
+			return aggregate;
+		}
+
+		uint64_t getSampleEvery() {
+			return sampleEvery;
+		}
+
+		void start(ldms_t* the_ldms, bool* ldms_global_publish,
+				const char* node_name, const int rank_no,
+				const int job_id, const double job_start,
+				const uint64_t job_epoch_start,
+				const int tool_verbosity) {
+			const char* env;
+
+			env = getenv("KOKKOS_LDMS_ASYNC");
+			if (NULL != env && 0 == atoi(env))
+				return;
+			env = getenv("KOKKOS_LDMS_MODE");
+			aggregate = (NULL != env && 0 == strcmp(env, "aggregate"));
+			env = getenv("KOKKOS_LDMS_SAMPLE");
+			if (NULL != env && atoi(env) > 1)
+				sampleEvery = atoi(env);
+			env = getenv("KOKKOS_LDMS_FLUSH_MS");
+			if (NULL != env && atoi(env) > 0)
+				flushMS = atoi(env);
+			env = getenv("KOKKOS_LDMS_FLUSH_EVENTS");
+			if (NULL != env && atoi(env) > 0)
+				flushEvents = atoi(env);
+			env = getenv("KOKKOS_LDMS_RING_SIZE");
+			if (NULL != env && atoi(env) > 0)
+				ringSize = atoi(env);
+
+			ldms = the_ldms;
+			ldms_publish = ldms_global_publish;
+			nodename = node_name;
+			rank = rank_no;
+			jobid = job_id;
+			jobStartTime = job_start;
+			jobStartEpochTimeMS = job_epoch_start;
+			verbosity = tool_verbosity;
+
+			stop = false;
+			thread = std::thread(&KernelPublisher::run, this);
+			running.store(true, std::memory_order_release);
+		}
+
+		/* publish the queued events and stop the publisher thread */
+		void finish() {
+			if (!isRunning())
+				return;
+			running.store(false, std::memory_order_release);
+			{
+				std::lock_guard<std::mutex> lk(mutex);
+				stop = true;
+			}
+			cond.notify_one();
+			thread.join();
+		}
+
+		/* called from the Kokkos callbacks */
+		void enqueue(const KernelEvent& ev) {
+			static thread_local KernelEventRing* ring = NULL;
+
+			if (NULL == ring) {
+				ring = new KernelEventRing(ringSize);
+				std::lock_guard<std::mutex> lk(ringsMutex);
+				rings.push_back(ring);
+			}
+			if (ring->push(ev) == flushEvents) {
+				/* A lost wakeup only delays the flush to the next
+				 * interval; don't take the mutex in the kernel path. */
+				wake.store(true, std::memory_order_relaxed);
+				cond.notify_one();
+			}
+		}
+
+	private:
+		void run() {
+			std::unique_lock<std::mutex> lk(mutex);
+			while (!stop) {
+				cond.wait_for(lk, std::chrono::milliseconds(flushMS),
+					[this] { return stop || wake.load(std::memory_order_relaxed); });
+				wake.store(false, std::memory_order_relaxed);
+				lk.unlock();
+				flush();
+				lk.lock();
+			}
+			lk.unlock();
+			flush();
+		}
+
+		double epoch(double t) {
+			double epoch_stamp = (double) jobStartEpochTimeMS;
+			epoch_stamp += (t - jobStartTime) * 1000.0;
+			return epoch_stamp / 1000.0;
+		}
+
+		void appendEntry(const KernelEvent& ev, uint64_t count, double time) {
+			char buf[256];
+
+			if (!entries.empty())
+				entries += ", ";
+			entries += "{ \"name\" : \"";
+			entries += ev.name;
+			snprintf(buf, sizeof(buf), "\", \"type\" : %d, \"current-kernel-count\" : %llu, \"total-kernel-count\" : %llu, \"level\" : %u, \"current-kernel-time\" : %.9f, \"total-kernel-time\" : %.9f }",
+				(int) ev.type, (unsigned long long) count,
+				(unsigned long long) ev.total_count, ev.level,
+				time, ev.total_time);
+			entries += buf;
+			lastEnd = ev.end;
+			if (entries.size() > KP_PUBLISHER_MSG_MAX)
+				publish();
+		}
+
+		void publish() {
+			char buf[512];
+
+			if (entries.empty() && !drops)
+				return;
+			snprintf(buf, sizeof(buf), "{ \"job-id\" : %d, \"node-name\" : \"%s\", \"rank\" : %d, \"timestamp\" : \"%.6f\", ",
+				jobid, nodename, rank, epoch(lastEnd));
+			msg = buf;
+			if (drops) {
+				snprintf(buf, sizeof(buf), "\"dropped-events\" : %llu, ",
+					(unsigned long long) drops);
+				msg += buf;
+				drops = 0;
+			}
+			msg += "\"kokkos-perf-data\" : [ ";
+			msg += entries;
+			msg += " ] }\n";
+			entries.clear();
+
+			if (verbosity > 0)
+				printf("%s", msg.c_str());
+			if (*ldms_publish)
+				ldmsd_stream_publish((*ldms), "kokkos-perf-data",
+					LDMSD_STREAM_JSON, msg.c_str(), msg.size() + 1);
+		}
+
+		void flush() {
+			std::vector<KernelEventRing*> snapshot;
+			KernelEvent ev;
+			size_t i;
+
+			{
+				std::lock_guard<std::mutex> lk(ringsMutex);
+				snapshot = rings;
+			}
+			for (i = 0; i < snapshot.size(); i++) {
+				drops += snapshot[i]->takeDrops();
+				while (snapshot[i]->pop(ev)) {
+					if (!aggregate) {
+						appendEntry(ev, ev.count, ev.time);
+						continue;
+					}
+					KernelAggregate& a = sums[ev.name];
+					a.count++;
+					a.time += ev.time;
+					a.last = ev;
+				}
+			}
+			if (aggregate) {
+				std::unordered_map<const char*, KernelAggregate>::iterator it;
+				for (it = sums.begin(); it != sums.end(); it++) {
+					if (!it->second.count)
+						continue;
+					appendEntry(it->second.last, it->second.count,
+							it->second.time);
+					it->second.count = 0;
+					it->second.time = 0;
+				}
+			}
+			publish();
+		}
+
+		std::atomic<bool> running;
+		bool stop;
+		std::atomic<bool> wake;
+		std::mutex mutex;
+		std::condition_variable cond;
+		std::thread thread;
+
+		std::mutex ringsMutex;
+		std::vector<KernelEventRing*> rings;
+
+		/* publisher thread only */
+		std::unordered_map<const char*, KernelAggregate> sums;
+		std::string entries;
+		std::string msg;
+		uint64_t drops;
+		double lastEnd;
+
+		bool aggregate;
+		uint64_t sampleEvery;
+		uint64_t flushEvents;
+		uint64_t ringSize;
+		int flushMS;
+
+		ldms_t* ldms;
+		bool* ldms_publish;
+		const char* nodename;
+		int rank;
+		int jobid;
+		int verbosity;
+		double jobStartTime;
+		uint64_t jobStartEpochTimeMS;
+};
+
+static KernelPublisher kernel_publisher;
+
+#endif
@@ -109,7 +109,7 @@ LDMSD_CTRL_CMD_MAP = {'usage': {'req_attr': [], 'opt_attr': ['name']},
                                      'opt_attr' : [ 'auth', 'perm', 'rail', 'quota', 'rx_rate' ] },
                       ##### Updater Policy #####
                       'updtr_add': {'req_attr': ['name'],
-                                    'opt_attr': ['offset', 'push', 'interval', 'auto_interval', 'perm']},
+                                    'opt_attr': ['offset', 'push', 'interval', 'auto_interval', 'perm', 'batch']},
                       'updtr_del': {'req_attr': ['name']},
                       'updtr_match_add': {'req_attr': ['name', 'regex', 'match']},
                       'updtr_match_del': {'req_attr': ['name', 'regex', 'match']},
@@ -124,7 +124,8 @@ LDMSD_CTRL_CMD_MAP = {'usage': {'req_attr': [], 'opt_attr': ['name']},
                       'update_time_stats' : {'req_attr': [], 'opt_attr' : ['name', 'reset']},
                       ##### Storage Policy #####
                       'strgp_add': {'req_attr': ['name', 'plugin', 'container'],
-                                    'opt_attr' : ['schema', 'regex', 'flush', 'decomposition', 'perm' ] },
+                                    'opt_attr' : ['schema', 'regex', 'flush', 'decomposition', 'perm',
+                                                  'queue_depth', 'queue_policy' ] },
                       'strgp_del': {'req_attr': ['name']},
                       'strgp_prdcr_add': {'req_attr': ['name', 'regex']},
                       'strgp_prdcr_del': {'req_attr': ['name', 'regex']},
@@ -161,6 +162,7 @@ LDMSD_CTRL_CMD_MAP = {'usage': {'req_attr': [], 'opt_attr': ['name']},
                       'log_status' : {'req_attr' : [], 'opt_attr' : ['name']},
                       'stats_reset' : {'req_attr' : [], 'opt_attr' : ['list']},
                       'profiling' : {'req_attr' : [], 'opt_attr' : ['enable', 'reset']},
+                      'store_threads' : {'req_attr' : ['num'], 'opt_attr' : []},
                       ##### Failover. #####
                       'failover_config': {
                                 'req_attr': [
@@ -391,6 +393,10 @@ class LDMSD_Req_Attr(object):
                    'reconnect' : INTERVAL,
                    'summary' : SUMMARY,
                    'size' : SIZE,
+                   'batch' : SIZE,
+                   'num' : SIZE,
+                   'queue_depth' : SIZE,
+                   'queue_policy' : TYPE,
                    'IP' : IP,
                    'ip' : IP,
                    'ask_interval': ASK_INTERVAL,
@@ -630,6 +636,7 @@ class LDMSD_Request(object):
     # IDs 0x600 + 22 to 0x600 + 30 are reserved to match command-line options handlers
     # defined in ldmsd_request.h. These must stay in sync with the C implementation.
     PROFILING = 0x600 + 31
+    STORE_THR_SET = 0x600 + 32
 
     FAILOVER_CONFIG        = 0x700
     FAILOVER_PEERCFG_START = 0x700  +  1
@@ -745,6 +752,7 @@ class LDMSD_Request(object):
             'failover_stop'          : {'id' : FAILOVER_STOP},
             'xprt_stats'    :  {'id' : XPRT_STATS},
             'profiling'    :  {'id' : PROFILING},
+            'store_threads' :  {'id' : STORE_THR_SET},
             'thread_stats'  :  {'id' : THREAD_STATS},
             'prdcr_stats'   :  {'id' : PRDCR_STATS},
             'set_stats'     :  {'id' : SET_STATS},
@@ -2756,7 +2764,8 @@ class Communicator(object):
         except Exception as e:
             return errno.ENOTCONN, str(e)
 
-    def updtr_add(self, name, interval=1000000, offset=None, push=None, auto=None, perm=None):
+    def updtr_add(self, name, interval=1000000, offset=None, push=None, auto=None, perm=None,
+                  batch=None):
         """
         Add an Updater that will periodically update Producer metric sets either
         by pulling the content or by registering for an update push. The default
@@ -2781,6 +2790,8 @@ class Communicator(object):
                     the given sample interval. The default is False.
         perm      - The configuration client permission required to
                     modify the updater configuration.
+        batch     - The maximum number of sets of a producer updated in one
+                    batch. 0 (default) updates each set separately.
 
         Returns:
         A tuple of status, data
@@ -2813,6 +2824,8 @@ class Communicator(object):
             ]
         if perm:
             attrs.append(LDMSD_Req_Attr(attr_id=LDMSD_Req_Attr.PERM, value=str(perm)))
+        if batch:
+            attrs.append(LDMSD_Req_Attr(attr_id=LDMSD_Req_Attr.SIZE, value=str(batch)))
         req = LDMSD_Request(command_id=LDMSD_Request.UPDTR_ADD, attrs=attrs)
         try:
             req.send(self)
@@ -3139,7 +3152,8 @@ class Communicator(object):
             return errno.ENOTCONN, str(e)
 
     def strgp_add(self, name, plugin, container, schema=None,
-                  regex=None, perm=0o600, flush=None, decomposition=None):
+                  regex=None, perm=0o600, flush=None, decomposition=None,
+                  queue_depth=None, queue_policy=None):
         """
         Add a Storage Policy that will store metric set data when
         updates complete on a metric set.
@@ -3158,6 +3172,10 @@ class Communicator(object):
         flush         - Interval between calls to the storage plugin flush method.
                         By default, the flush method is not called.
         decomposition - The path to a decomposition configuration file
+        queue_depth   - The maximum number of stores queued for the store
+                        threads. 0 (default) stores on the update threads.
+        queue_policy  - 'block' (default) or 'drop', what to do with an
+                        update when the queue is full.
         Returns:
         A tuple of status, data
         - status is an errno from the errno module
@@ -3178,6 +3196,10 @@ class Communicator(object):
             attrs.append(LDMSD_Req_Attr(attr_id = LDMSD_Req_Attr.DECOMPOSITION, value = decomposition))
         if flush is not None:
             attrs.append(LDMSD_Req_Attr(attr_name='flush', value=flush))
+        if queue_depth is not None:
+            attrs.append(LDMSD_Req_Attr(attr_id=LDMSD_Req_Attr.SIZE, value=str(queue_depth)))
+        if queue_policy is not None:
+            attrs.append(LDMSD_Req_Attr(attr_id=LDMSD_Req_Attr.TYPE, value=queue_policy))
         req = LDMSD_Request(command_id=LDMSD_Request.STRGP_ADD, attrs=attrs)
         try:
             req.send(self)
@@ -3429,6 +3451,21 @@ class Communicator(object):
             self.close()
             return errno.ENOTCONN, str(e)
 
+    def store_threads(self, num):
+        """Set the number of threads serving the storage policy queues"""
+        req = LDMSD_Request(
+                command_id=LDMSD_Request.STORE_THR_SET,
+                attrs=[
+                    LDMSD_Req_Attr(attr_id=LDMSD_Req_Attr.SIZE, value=str(num))
+                ])
+        try:
+            req.send(self)
+            resp = req.receive(self)
+            return resp['errcode'], resp['msg']
+        except Exception as e:
+            self.close()
+            return errno.ENOTCONN, str(e)
+
     def thread_stats(self, reset=False):
         """Query the daemon's I/O thread utilization data"""
         if reset is None:
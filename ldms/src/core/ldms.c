@@ -75,6 +75,7 @@
 #include "ldms_heap.h"
 #include "ldms_private.h"
 #include "coll/rbt.h"
+#include "coll/fnv_hash.h"
 
 ovis_log_t xlog;
 
@@ -83,6 +84,8 @@ static char *__set_dir = SET_DIR_PATH;
 #define SET_DIR_LEN sizeof(SET_DIR_PATH)
 static char __set_path[PATH_MAX];
 static void __destroy_set(void *v);
+static void __name_idx_put(struct ldms_name_idx *nidx);
+static void __val_tbl_put(struct ldms_val_tbl *tbl);
 
 static struct {
 	pthread_rwlock_t default_authz_lock;
@@ -224,13 +227,125 @@ static int id_comparator(void *a, const void *b)
 	return 0;
 }
 
-static struct rbt __id_tree = {
-	.root = NULL,
-	.comparator = id_comparator
-};
-
 static pthread_mutex_t __set_tree_lock = PTHREAD_MUTEX_INITIALIZER;
 
+/*
+ * Lookups by instance name and by set_id do not take the set tree lock.
+ * They go through two hash-sharded indices, each shard an rbt under its
+ * own rwlock, so that concurrent lookups, creates and deletes from the zap
+ * I/O threads and the daemon workers only contend when they hash to the
+ * same shard. The set tree remains the ordered index for iteration; the
+ * set tree lock only covers it.
+ *
+ * Lock order: __set_tree_lock, then a shard lock.
+ */
+#define SET_SHARD_BITS	6
+#define SET_SHARD_COUNT	(1 << SET_SHARD_BITS)
+
+struct set_shard {
+	pthread_rwlock_t lock;
+	struct rbt tree;
+} __attribute__((aligned(64)));
+
+static struct set_shard __name_shard[SET_SHARD_COUNT];
+static struct set_shard __id_shard[SET_SHARD_COUNT];
+
+static void __attribute__ ((constructor)) __set_shard_init(void)
+{
+	int i;
+	for (i = 0; i < SET_SHARD_COUNT; i++) {
+		pthread_rwlock_init(&__name_shard[i].lock, NULL);
+		rbt_init(&__name_shard[i].tree, set_comparator);
+		pthread_rwlock_init(&__id_shard[i].lock, NULL);
+		rbt_init(&__id_shard[i].tree, id_comparator);
+	}
+}
+
+static inline struct set_shard *__name_shard_get(const char *name)
+{
+	return &__name_shard[fnv_hash_a1_32(name, strlen(name), 0)
+			     & (SET_SHARD_COUNT - 1)];
+}
+
+static inline struct set_shard *__id_shard_get(uint64_t id)
+{
+	/* set_ids are sequential, mix the bits before taking the shard */
+	id *= 0x9e3779b97f4a7c15ULL;
+	return &__id_shard[id >> (64 - SET_SHARD_BITS)];
+}
+
+/*
+ * The name shard is the last index a new set goes into and the first one it
+ * leaves, so that nobody can find a set by name that is not in all of them.
+ * Until then, the set tree may briefly hold a second, unpublished set of
+ * the same name.
+ *
+ * Returns EEXIST if a set with the same instance name is indexed.
+ */
+static int __set_index_add(struct ldms_set *set)
+{
+	struct set_shard *name_shard, *id_shard;
+
+	pthread_mutex_lock(&__set_tree_lock);
+	rbt_ins(&__set_tree, &set->rb_node);
+	pthread_mutex_unlock(&__set_tree_lock);
+	id_shard = __id_shard_get(set->set_id);
+	pthread_rwlock_wrlock(&id_shard->lock);
+	rbt_ins(&id_shard->tree, &set->id_node);
+	pthread_rwlock_unlock(&id_shard->lock);
+
+	name_shard = __name_shard_get(set->name_node.key);
+	pthread_rwlock_wrlock(&name_shard->lock);
+	if (!rbt_find(&name_shard->tree, set->name_node.key)) {
+		rbt_ins(&name_shard->tree, &set->name_node);
+		pthread_rwlock_unlock(&name_shard->lock);
+		return 0;
+	}
+	pthread_rwlock_unlock(&name_shard->lock);
+
+	/* we lost a race creating this same set name */
+	pthread_rwlock_wrlock(&id_shard->lock);
+	rbt_del(&id_shard->tree, &set->id_node);
+	pthread_rwlock_unlock(&id_shard->lock);
+	pthread_mutex_lock(&__set_tree_lock);
+	rbt_del(&__set_tree, &set->rb_node);
+	pthread_mutex_unlock(&__set_tree_lock);
+	return EEXIST;
+}
+
+static void __set_index_del(struct ldms_set *set)
+{
+	struct set_shard *shard;
+
+	shard = __name_shard_get(set->name_node.key);
+	pthread_rwlock_wrlock(&shard->lock);
+	rbt_del(&shard->tree, &set->name_node);
+	pthread_rwlock_unlock(&shard->lock);
+	shard = __id_shard_get(set->set_id);
+	pthread_rwlock_wrlock(&shard->lock);
+	rbt_del(&shard->tree, &set->id_node);
+	pthread_rwlock_unlock(&shard->lock);
+	pthread_mutex_lock(&__set_tree_lock);
+	rbt_del(&__set_tree, &set->rb_node);
+	pthread_mutex_unlock(&__set_tree_lock);
+}
+
+/*
+ * Point the name keys of an indexed set at a new copy of its instance
+ * name. The name does not change, so neither does its position.
+ */
+static void __set_index_rekey(struct ldms_set *set, const char *name)
+{
+	struct set_shard *shard = __name_shard_get(name);
+
+	pthread_mutex_lock(&__set_tree_lock);
+	pthread_rwlock_wrlock(&shard->lock);
+	set->rb_node.key = (void *)name;
+	set->name_node.key = (void *)name;
+	pthread_rwlock_unlock(&shard->lock);
+	pthread_mutex_unlock(&__set_tree_lock);
+}
+
 static struct rbt __del_tree = {
 	.root = NULL,
 	.comparator = id_comparator
@@ -248,6 +363,597 @@ int ldms_set_deleting_count()
 
 static pthread_mutex_t __del_tree_lock = PTHREAD_MUTEX_INITIALIZER;
 
+/*
+ * Metric descriptors shared by remote sets, one block per schema digest.
+ *
+ * The wire image of a set is
+ *
+ *   [hdr + dict][instance name][schema name + digest][descriptors]
+ *   [meta-attribute values][data array]
+ *
+ * and only the descriptors are identical in all sets of a schema. When
+ * sharing is enabled, a looked-up set is converted to a compact image that
+ * omits the descriptor range; the descriptors are kept once in a reference
+ * counted ldms_meta_shr indexed by digest. The meta-attribute offsets in
+ * the shared descriptors are relative to the start of the values, so sets
+ * whose names differ in length can share a block.
+ *
+ * Peers still see the wire image: it is rebuilt for pushes by
+ * __ldms_set_wire_read() and kept for downstream lookups by
+ * __ldms_set_export_map().
+ */
+struct ldms_meta_shr {
+	struct rbn rbn;		/* key: digest */
+	struct ldms_digest_s digest;
+	int ref;
+	uint32_t card;
+	uint32_t desc_len;	/* length of the descriptor range */
+	uint32_t *rel;		/* dict[i] relative to the descriptor range */
+	uint8_t *descs;		/* descriptors, meta offsets relative to values */
+	size_t size;		/* allocation size */
+	uint64_t buf[OVIS_FLEX];
+};
+
+static int __meta_shr_cmp(void *a, const void *b)
+{
+	return memcmp(a, b, LDMS_DIGEST_LENGTH);
+}
+
+static int __meta_share;
+static struct rbt __meta_shr_tree = RBT_INITIALIZER(__meta_shr_cmp);
+static pthread_mutex_t __meta_shr_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct ldms_meta_share_stats __meta_shr_stats;
+
+int ldms_meta_share_enable(int enable)
+{
+	return __atomic_exchange_n(&__meta_share, !!enable, __ATOMIC_SEQ_CST);
+}
+
+void ldms_meta_share_stats_get(struct ldms_meta_share_stats *stats)
+{
+	pthread_mutex_lock(&__meta_shr_lock);
+	*stats = __meta_shr_stats;
+	pthread_mutex_unlock(&__meta_shr_lock);
+	stats->saved_bytes = (int64_t)stats->set_bytes
+			     - (int64_t)stats->block_bytes
+			     - (int64_t)stats->export_bytes;
+}
+
+/*
+ * Locate the descriptor range of the wire image \c meta.
+ *
+ * The descriptors must be in dictionary order and be followed by the
+ * meta-attribute values. Returns EINVAL if the layout is not one that
+ * ldms_set_create() produces, or if the set contains records whose
+ * instances refer back to the set meta-data.
+ */
+static int __meta_shr_layout(struct ldms_set_hdr *meta,
+			     uint32_t *desc_off, uint32_t *mvals_off)
+{
+	uint32_t card = __le32_to_cpu(meta->card);
+	uint32_t meta_sz = __le32_to_cpu(meta->meta_sz);
+	uint32_t i, d, end, voff;
+	ldms_mdesc_t vd;
+
+	if (!card)
+		return EINVAL;
+	end = ldms_off_(meta, get_first_metric_desc(meta));
+	*desc_off = end;
+	for (i = 0; i < card; i++) {
+		d = __le32_to_cpu(meta->dict[i]);
+		if (d < end || d + sizeof(*vd) > meta_sz)
+			return EINVAL;
+		vd = ldms_ptr_(struct ldms_value_desc, meta, d);
+		switch (vd->vd_type) {
+		case LDMS_V_RECORD_TYPE:
+		case LDMS_V_RECORD_INST:
+		case LDMS_V_RECORD_ARRAY:
+			return EINVAL;
+		default:
+			break;
+		}
+		end = roundup(d + sizeof(*vd) + vd->vd_name_unit_len, 8);
+		if (end > meta_sz)
+			return EINVAL;
+	}
+	for (i = 0; i < card; i++) {
+		vd = ldms_ptr_(struct ldms_value_desc, meta,
+			       __le32_to_cpu(meta->dict[i]));
+		if (vd->vd_flags & LDMS_MDESC_F_DATA)
+			continue;
+		voff = __le32_to_cpu(vd->vd_data_offset);
+		if (voff < end || voff + ldms_metric_value_size_get(vd->vd_type,
+				__le32_to_cpu(vd->vd_array_count)) > meta_sz)
+			return EINVAL;
+	}
+	*mvals_off = end;
+	return 0;
+}
+
+/*
+ * Rebase the meta-attribute offsets of the descriptor range \c descs
+ * (starting at \c desc_off in \c meta) by \c delta.
+ */
+static void __meta_shr_rebase(struct ldms_set_hdr *meta, uint32_t desc_off,
+			      uint8_t *descs, int64_t delta)
+{
+	uint32_t i, card = __le32_to_cpu(meta->card);
+	ldms_mdesc_t vd;
+
+	for (i = 0; i < card; i++) {
+		vd = (ldms_mdesc_t)&descs[__le32_to_cpu(meta->dict[i]) - desc_off];
+		if (vd->vd_flags & LDMS_MDESC_F_DATA)
+			continue;
+		vd->vd_data_offset = __cpu_to_le32(
+				__le32_to_cpu(vd->vd_data_offset) + delta);
+	}
+}
+
+/*
+ * Returns 0 if the descriptors of \c meta, already copied to \c descs and
+ * rebased, are those of \c shr.
+ */
+static int __meta_shr_match(struct ldms_meta_shr *shr,
+			    struct ldms_set_hdr *meta, uint32_t desc_off,
+			    uint32_t desc_len, const uint8_t *descs)
+{
+	uint32_t i;
+
+	if (shr->card != __le32_to_cpu(meta->card) || shr->desc_len != desc_len)
+		return EINVAL;
+	for (i = 0; i < shr->card; i++) {
+		if (shr->rel[i] != __le32_to_cpu(meta->dict[i]) - desc_off)
+			return EINVAL;
+	}
+	return memcmp(shr->descs, descs, desc_len) ? EINVAL : 0;
+}
+
+/* Caller must hold __meta_shr_lock */
+static struct ldms_meta_shr *
+__meta_shr_new(ldms_digest_t digest, struct ldms_set_hdr *meta,
+	       uint32_t desc_off, uint32_t desc_len, const uint8_t *descs)
+{
+	struct ldms_meta_shr *shr;
+	uint32_t i, card = __le32_to_cpu(meta->card);
+	size_t rel_sz = roundup(card * sizeof(uint32_t), 8);
+	size_t sz = sizeof(*shr) + rel_sz + desc_len;
+
+	shr = malloc(sz);
+	if (!shr)
+		return NULL;
+	memcpy(&shr->digest, digest, sizeof(shr->digest));
+	rbn_init(&shr->rbn, &shr->digest);
+	shr->ref = 1;
+	shr->card = card;
+	shr->desc_len = desc_len;
+	shr->size = sz;
+	shr->rel = (uint32_t *)shr->buf;
+	shr->descs = (uint8_t *)shr->buf + rel_sz;
+	for (i = 0; i < card; i++)
+		shr->rel[i] = __le32_to_cpu(meta->dict[i]) - desc_off;
+	memcpy(shr->descs, descs, desc_len);
+	rbt_ins(&__meta_shr_tree, &shr->rbn);
+	__meta_shr_stats.blocks++;
+	__meta_shr_stats.block_bytes += sz;
+	return shr;
+}
+
+/* Caller must hold __meta_shr_lock */
+static void __meta_shr_put(struct ldms_meta_shr *shr)
+{
+	if (--shr->ref)
+		return;
+	rbt_del(&__meta_shr_tree, &shr->rbn);
+	__meta_shr_stats.blocks--;
+	__meta_shr_stats.block_bytes -= shr->size;
+	free(shr);
+}
+
+/* Release the shared-meta resources of a set being destroyed. */
+static void __set_meta_unshare(struct ldms_set *s)
+{
+	struct ldms_meta_shr *shr = s->meta_shr ? s->meta_shr : s->shr_retired;
+
+	__ldms_set_meta_land_put(s);
+	pthread_mutex_lock(&__meta_shr_lock);
+	if (s->xmeta) {
+		__meta_shr_stats.export_sets--;
+		__meta_shr_stats.export_bytes -= __ldms_set_wire_size_get(s);
+	}
+	if (s->meta_shr) {
+		__meta_shr_stats.sets--;
+		__meta_shr_stats.set_bytes -= s->desc_len;
+	}
+	__meta_shr_put(shr);
+	pthread_mutex_unlock(&__meta_shr_lock);
+	if (s->xmeta) {
+		zap_unmap(s->xmap);
+		mm_free(s->xmeta);
+	}
+	if (s->meta_retired)
+		mm_free(s->meta_retired);
+	s->meta_shr = NULL;
+	s->shr_retired = NULL;
+	s->meta_retired = NULL;
+}
+
+/*
+ * Give a shared set a private meta-data again, built from the landed wire
+ * meta-data \c land and the current data. This is used when the remote
+ * descriptors no longer match the shared ones, e.g. after the producer
+ * changed a metric user data.
+ *
+ * The compact meta-data and the shared descriptors may still be in use by
+ * an accessor that raced with the switch, so they are kept until the set
+ * is destroyed. A peer that looked the set up from the wire image keeps
+ * reading it; it is still refreshed by __ldms_set_export_sync().
+ */
+static int __set_meta_private(struct ldms_set *s, struct ldms_set_hdr *land)
+{
+	uint32_t meta_sz = __le32_to_cpu(land->meta_sz);
+	uint32_t desc_len = s->desc_len;
+	size_t sz = __ldms_set_wire_size_get(s);
+	struct ldms_set_hdr *meta;
+	zap_map_t map;
+
+	meta = mm_alloc(sz);
+	if (!meta)
+		return ENOMEM;
+	memcpy(meta, land, meta_sz);
+	memcpy((uint8_t *)meta + meta_sz, s->data_array, sz - meta_sz);
+	if (zap_map(&map, meta, sz, ZAP_ACCESS_READ | ZAP_ACCESS_WRITE)) {
+		mm_free(meta);
+		return ENOMEM;
+	}
+	__set_index_rekey(s, get_instance_name(meta)->name);
+	pthread_mutex_lock(&s->lock);
+	zap_unmap(s->lmap);
+	s->lmap = map;
+	s->meta_retired = s->meta;
+	s->shr_retired = s->meta_shr;
+	s->meta = meta;
+	s->meta_shr = NULL;
+	s->desc_off = 0;
+	s->desc_len = 0;
+	s->data_array = (void *)meta + meta_sz;
+	s->data = __set_array_get(s, s->curr_idx);
+	pthread_mutex_unlock(&s->lock);
+
+	pthread_mutex_lock(&__meta_shr_lock);
+	__meta_shr_stats.sets--;
+	__meta_shr_stats.set_bytes -= desc_len;
+	pthread_mutex_unlock(&__meta_shr_lock);
+	return 0;
+}
+
+/*
+ * Convert a remote set that has just been looked up to the compact layout.
+ *
+ * The set is in the set index but is not published yet, so the readers
+ * that reach it through the index skip it (see __ldms_set_published()) or
+ * access its memory under set->lock. The memory is replaced, and the local
+ * map recreated, under set->lock, and the old memory is freed. Returns
+ * ENOTSUP, leaving the set unchanged, if sharing is disabled or the set
+ * cannot be shared.
+ */
+int __ldms_set_meta_share(struct ldms_set *set)
+{
+	struct ldms_set_hdr *meta = set->meta, *cmeta;
+	struct ldms_meta_shr *shr;
+	uint32_t desc_off, mvals_off, desc_len;
+	ldms_digest_t digest;
+	struct rbn *rbn;
+	uint8_t *descs;
+	size_t tail_sz;
+	zap_map_t map;
+	int rc;
+
+	if (!__atomic_load_n(&__meta_share, __ATOMIC_RELAXED))
+		return ENOTSUP;
+	digest = ldms_set_digest_get(set);
+	if (digest == &null_digest)
+		return ENOTSUP;
+	if (__meta_shr_layout(meta, &desc_off, &mvals_off))
+		return ENOTSUP;
+	desc_len = mvals_off - desc_off;
+	descs = malloc(desc_len);
+	if (!descs)
+		return ENOMEM;
+	memcpy(descs, (uint8_t *)meta + desc_off, desc_len);
+	__meta_shr_rebase(meta, desc_off, descs, -(int64_t)mvals_off);
+
+	pthread_mutex_lock(&__meta_shr_lock);
+	rbn = rbt_find(&__meta_shr_tree, digest);
+	if (rbn) {
+		shr = container_of(rbn, struct ldms_meta_shr, rbn);
+		if (__meta_shr_match(shr, meta, desc_off, desc_len, descs)) {
+			/* digest collision, do not share */
+			pthread_mutex_unlock(&__meta_shr_lock);
+			free(descs);
+			return ENOTSUP;
+		}
+		shr->ref++;
+	} else {
+		shr = __meta_shr_new(digest, meta, desc_off, desc_len, descs);
+	}
+	pthread_mutex_unlock(&__meta_shr_lock);
+	free(descs);
+	if (!shr)
+		return ENOMEM;
+
+	tail_sz = __ldms_set_size_get(set) - mvals_off;
+	cmeta = mm_alloc(desc_off + tail_sz);
+	if (!cmeta) {
+		rc = ENOMEM;
+		goto put;
+	}
+	memcpy(cmeta, meta, desc_off);
+	memcpy((uint8_t *)cmeta + desc_off, (uint8_t *)meta + mvals_off, tail_sz);
+	if (zap_map(&map, cmeta, desc_off + tail_sz,
+		    ZAP_ACCESS_READ | ZAP_ACCESS_WRITE)) {
+		mm_free(cmeta);
+		rc = ENOMEM;
+		goto put;
+	}
+	/* The set indices are keyed on the instance name inside the meta-data */
+	__set_index_rekey(set, get_instance_name(cmeta)->name);
+	pthread_mutex_lock(&set->lock);
+	zap_unmap(set->lmap);
+	set->lmap = map;
+	set->meta = cmeta;
+	set->meta_shr = shr;
+	set->desc_off = desc_off;
+	set->desc_len = desc_len;
+	set->data_array = (void *)cmeta + __le32_to_cpu(cmeta->meta_sz) - desc_len;
+	set->data = __set_array_get(set, set->curr_idx);
+	pthread_mutex_unlock(&set->lock);
+	mm_free(meta);
+
+	pthread_mutex_lock(&__meta_shr_lock);
+	__meta_shr_stats.sets++;
+	__meta_shr_stats.set_bytes += desc_len;
+	pthread_mutex_unlock(&__meta_shr_lock);
+	return 0;
+ put:
+	pthread_mutex_lock(&__meta_shr_lock);
+	__meta_shr_put(shr);
+	pthread_mutex_unlock(&__meta_shr_lock);
+	return rc;
+}
+
+/*
+ * Allocate the buffer that the wire meta-data of a shared set is read into
+ * when the remote meta-data generation changes.
+ */
+int __ldms_set_meta_land_get(struct ldms_set *s)
+{
+	size_t sz = __le32_to_cpu(s->meta->meta_sz);
+
+	if (s->land)
+		return 0;
+	s->land = mm_alloc(sz);
+	if (!s->land)
+		return ENOMEM;
+	if (zap_map(&s->land_map, s->land, sz,
+		    ZAP_ACCESS_READ | ZAP_ACCESS_WRITE)) {
+		mm_free(s->land);
+		s->land = NULL;
+		return ENOMEM;
+	}
+	return 0;
+}
+
+void __ldms_set_meta_land_put(struct ldms_set *s)
+{
+	if (!s->land)
+		return;
+	zap_unmap(s->land_map);
+	mm_free(s->land);
+	s->land = NULL;
+}
+
+/*
+ * Copy the landed wire meta-data into the compact set. A set whose schema
+ * changed under the same name is rejected with EINVAL. If only the
+ * descriptor contents changed (e.g. a metric user data), the set stops
+ * sharing the descriptors and gets a private meta-data.
+ */
+int __ldms_set_meta_land_apply(struct ldms_set *s)
+{
+	struct ldms_set_hdr *land = s->land;
+	uint32_t desc_off, mvals_off;
+	uint8_t *descs;
+	int rc;
+
+	if (!land)
+		return EINVAL;
+	if (land->meta_sz != s->meta->meta_sz ||
+	    land->data_sz != s->meta->data_sz ||
+	    land->array_card != s->meta->array_card ||
+	    land->card != s->meta->card ||
+	    __meta_shr_layout(land, &desc_off, &mvals_off) ||
+	    desc_off != s->desc_off || mvals_off - desc_off != s->desc_len) {
+		rc = EINVAL;
+		goto out;
+	}
+	descs = malloc(s->desc_len);
+	if (!descs) {
+		rc = ENOMEM;
+		goto out;
+	}
+	memcpy(descs, (uint8_t *)land + desc_off, s->desc_len);
+	__meta_shr_rebase(land, desc_off, descs, -(int64_t)mvals_off);
+	rc = __meta_shr_match(s->meta_shr, land, desc_off, s->desc_len, descs);
+	free(descs);
+	if (rc) {
+		rc = __set_meta_private(s, land);
+		goto out;
+	}
+	__ldms_set_wire_write(s, 0, land, __le32_to_cpu(land->meta_sz));
+ out:
+	__ldms_set_meta_land_put(s);
+	return rc;
+}
+
+/* The size of the set as seen by peers */
+uint32_t __ldms_set_wire_size_get(struct ldms_set *s)
+{
+	return __ldms_set_size_get(s) + s->desc_len;
+}
+
+/*
+ * Copy \c len bytes at offset \c off of the wire image of the set to
+ * \c buf.
+ */
+int __ldms_set_wire_read(struct ldms_set *s, size_t off, void *buf, size_t len)
+{
+	uint8_t *dst = buf;
+	size_t mvals_off, n;
+	uint8_t *descs;
+
+	if (!s->meta_shr) {
+		memcpy(dst, (uint8_t *)s->meta + off, len);
+		return 0;
+	}
+	mvals_off = s->desc_off + s->desc_len;
+	if (off < s->desc_off) {
+		/* header, dictionary and names */
+		n = s->desc_off - off;
+		if (n > len)
+			n = len;
+		memcpy(dst, (uint8_t *)s->meta + off, n);
+		dst += n;
+		off += n;
+		len -= n;
+	}
+	if (len && off < mvals_off) {
+		/* descriptors */
+		n = mvals_off - off;
+		if (n > len)
+			n = len;
+		descs = malloc(s->desc_len);
+		if (!descs)
+			return ENOMEM;
+		memcpy(descs, s->meta_shr->descs, s->desc_len);
+		__meta_shr_rebase(s->meta, s->desc_off, descs, mvals_off);
+		memcpy(dst, descs + (off - s->desc_off), n);
+		free(descs);
+		dst += n;
+		off += n;
+		len -= n;
+	}
+	/* meta-attribute values and data */
+	if (len)
+		memcpy(dst, (uint8_t *)s->meta + off - s->desc_len, len);
+	return 0;
+}
+
+/*
+ * Refresh the range [off, off + len) of the exported image. The exported
+ * descriptors never change and are not copied. Caller must hold s->lock.
+ */
+static void __set_export_copy(struct ldms_set *s, size_t off, size_t len)
+{
+	size_t mvals_off = s->desc_off + s->desc_len;
+	size_t end = off + len;
+
+	if (off < s->desc_off) {
+		len = (end < s->desc_off ? end : s->desc_off) - off;
+		(void)__ldms_set_wire_read(s, off, (uint8_t *)s->xmeta + off, len);
+	}
+	if (end > mvals_off) {
+		if (off < mvals_off)
+			off = mvals_off;
+		(void)__ldms_set_wire_read(s, off, (uint8_t *)s->xmeta + off,
+					   end - off);
+	}
+}
+
+/*
+ * Copy \c len bytes of the wire image at offset \c off into the set. The
+ * descriptor range of a shared set is skipped.
+ */
+void __ldms_set_wire_write(struct ldms_set *s, size_t off,
+			   const void *buf, size_t len)
+{
+	const uint8_t *src = buf;
+	size_t off0 = off, len0 = len;
+	size_t mvals_off, n;
+
+	if (!s->meta_shr) {
+		memcpy((uint8_t *)s->meta + off, src, len);
+		return;
+	}
+	mvals_off = s->desc_off + s->desc_len;
+	if (off < s->desc_off) {
+		n = s->desc_off - off;
+		if (n > len)
+			n = len;
+		memcpy((uint8_t *)s->meta + off, src, n);
+		src += n;
+		off += n;
+		len -= n;
+	}
+	if (len && off < mvals_off) {
+		n = mvals_off - off;
+		if (n > len)
+			n = len;
+		src += n;
+		off += n;
+		len -= n;
+	}
+	if (len)
+		memcpy((uint8_t *)s->meta + off - s->desc_len, src, len);
+	if (s->xmeta) {
+		pthread_mutex_lock(&s->lock);
+		__set_export_copy(s, off0, len0);
+		pthread_mutex_unlock(&s->lock);
+	}
+}
+
+/*
+ * Return the map that peers read the set from. A shared set is exported
+ * from a wire image that is created on the first request and refreshed by
+ * __ldms_set_export_sync() after each update.
+ */
+zap_map_t __ldms_set_export_map(struct ldms_set *s)
+{
+	struct ldms_set_hdr *xmeta;
+	size_t sz;
+
+	if (!s->meta_shr)
+		return s->lmap;
+	pthread_mutex_lock(&s->lock);
+	if (s->xmeta)
+		goto out;
+	sz = __ldms_set_wire_size_get(s);
+	xmeta = mm_alloc(sz);
+	if (!xmeta)
+		goto out;
+	if (__ldms_set_wire_read(s, 0, xmeta, sz) ||
+	    zap_map(&s->xmap, xmeta, sz, ZAP_ACCESS_READ | ZAP_ACCESS_WRITE)) {
+		mm_free(xmeta);
+		goto out;
+	}
+	s->xmeta = xmeta;
+	pthread_mutex_lock(&__meta_shr_lock);
+	__meta_shr_stats.export_sets++;
+	__meta_shr_stats.export_bytes += sz;
+	pthread_mutex_unlock(&__meta_shr_lock);
+ out:
+	pthread_mutex_unlock(&s->lock);
+	return s->xmeta ? s->xmap : NULL;
+}
+
+void __ldms_set_export_sync(struct ldms_set *s)
+{
+	if (!s->xmeta)
+		return;
+	pthread_mutex_lock(&s->lock);
+	__set_export_copy(s, 0, __ldms_set_wire_size_get(s));
+	pthread_mutex_unlock(&s->lock);
+}
+
 void __ldms_gn_inc(struct ldms_set *set, ldms_mdesc_t desc)
 {
 	if (desc->vd_flags & LDMS_MDESC_F_DATA) {
@@ -258,17 +964,23 @@ void __ldms_gn_inc(struct ldms_set *set, ldms_mdesc_t desc)
 	}
 }
 
-/* Caller must hold the ldms set tree lock. */
+/*
+ * Returns the set with a reference taken. The caller does not need the set
+ * tree lock; holding it is allowed.
+ */
 struct ldms_set *__ldms_find_local_set(const char *set_name)
 {
+	struct set_shard *shard = __name_shard_get(set_name);
 	struct rbn *z;
 	struct ldms_set *s = NULL;
 
-	z = rbt_find(&__set_tree, (void *)set_name);
+	pthread_rwlock_rdlock(&shard->lock);
+	z = rbt_find(&shard->tree, (void *)set_name);
 	if (z) {
-		s = container_of(z, struct ldms_set, rb_node);
+		s = container_of(z, struct ldms_set, name_node);
 		ref_get(&s->ref, __func__);
 	}
+	pthread_rwlock_unlock(&shard->lock);
 	return s;
 }
 
@@ -305,11 +1017,7 @@ void __ldms_set_tree_unlock()
 
 ldms_set_t ldms_set_by_name(const char *set_name)
 {
-	struct ldms_set *set;
-	__ldms_set_tree_lock();
-	set = __ldms_find_local_set(set_name);
-	__ldms_set_tree_unlock();
-	return set;
+	return __ldms_find_local_set(set_name);
 }
 
 struct set_mode {
@@ -439,18 +1147,9 @@ struct get_set_names_arg {
 
 #define STATE_BUF_SZ 4
 #define PERM_BUF_SZ 16
-size_t __ldms_format_set_meta_as_json(struct ldms_set *set,
-				      int need_comma,
-				      char *buf, size_t buf_size)
+void __ldms_format_perm(uint32_t perm, char *buf)
 {
-	size_t cnt;
-	char dbuf[2*LDMS_DIGEST_LENGTH+1];
-	ldms_digest_t digest = ldms_set_digest_get(set);
-
-	/* format perm */
-	uint32_t perm = __le32_to_cpu(set->meta->perm);
-	char perm_str[PERM_BUF_SZ];
-	char *s = perm_str;
+	char *s = buf;
 	int i;
 	*s = '-';
 	s++;
@@ -473,9 +1172,10 @@ size_t __ldms_format_set_meta_as_json(struct ldms_set *set,
 		s++;
 	}
 	*s = '\0';
+}
 
-	/* format state flags */
-	char state[STATE_BUF_SZ];
+void __ldms_format_set_state(struct ldms_set *set, char *state)
+{
 	if (set->data->trans.flags == LDMS_TRANSACTION_END)
 		state[0] = 'C';
 	else
@@ -491,6 +1191,24 @@ size_t __ldms_format_set_meta_as_json(struct ldms_set *set,
 	else
 		state[2] = ' ';
 	state[3] = '\0';
+}
+
+size_t __ldms_format_set_meta_as_json(struct ldms_set *set,
+				      int need_comma,
+				      char *buf, size_t buf_size)
+{
+	size_t cnt;
+	char dbuf[2*LDMS_DIGEST_LENGTH+1];
+	ldms_digest_t digest = ldms_set_digest_get(set);
+
+	/* format perm */
+	uint32_t perm = __le32_to_cpu(set->meta->perm);
+	char perm_str[PERM_BUF_SZ];
+	__ldms_format_perm(perm, perm_str);
+
+	/* format state flags */
+	char state[STATE_BUF_SZ];
+	__ldms_format_set_state(set, state);
 
 	cnt = snprintf(buf, buf_size,
 		       "%c{"
@@ -626,9 +1344,7 @@ __record_set(const char *instance_name,
 	zap_err_t zerr;
 	size_t sz;
 
-	__ldms_set_tree_lock();
 	set = __ldms_find_local_set(instance_name);
-	__ldms_set_tree_unlock();
 	if (set) {
 		ref_put(&set->ref, "__ldms_find_local_set");
 		errno = EEXIST;
@@ -661,23 +1377,14 @@ __record_set(const char *instance_name,
 
 	ref_init(&set->ref, __func__, __destroy_set, set);
 	rbn_init(&set->rb_node, get_instance_name(set->meta)->name);
+	rbn_init(&set->name_node, get_instance_name(set->meta)->name);
 	rbn_init(&set->id_node, (void *)set->set_id);
 
-	__ldms_set_tree_lock();
-	/* Check if we lost a race creating this same set name */
-	struct ldms_set *nset = __ldms_find_local_set(instance_name);
-	if (nset) {
-		ref_put(&nset->ref, "__ldms_find_local_set");
+	if (__set_index_add(set)) {
 		errno = EEXIST;
 		free(set);
-		set = NULL;
-		goto unlock_set_tree;
+		return NULL;
 	}
-	rbt_ins(&__set_tree, &set->rb_node);
-	rbt_ins(&__id_tree, &set->id_node);
-
- unlock_set_tree:
-	__ldms_set_tree_unlock();
 	return set;
 
  free_set:
@@ -687,15 +1394,20 @@ __record_set(const char *instance_name,
 }
 
 /**
- * Callers must hold the set_tree lock
+ * No reference is taken on the returned set. The set tree lock is not
+ * required.
  */
 extern struct ldms_set *__ldms_set_by_id(uint64_t id)
 {
+	struct set_shard *shard = __id_shard_get(id);
 	struct ldms_set *set = NULL;
 	struct rbn *rbn;
-	rbn = rbt_find(&__id_tree, (void *)id);
+
+	pthread_rwlock_rdlock(&shard->lock);
+	rbn = rbt_find(&shard->tree, (void *)id);
 	if (rbn)
 		set = container_of(rbn, struct ldms_set, id_node);
+	pthread_rwlock_unlock(&shard->lock);
 	return set;
 }
 
@@ -705,7 +1417,8 @@ int __ldms_set_publish(struct ldms_set *set)
 	if (set->flags & LDMS_SET_F_PUBLISHED)
 		return EEXIST;
 
-	set->flags |= LDMS_SET_F_PUBLISHED;
+	/* pairs with __ldms_set_published() */
+	__atomic_or_fetch(&set->flags, LDMS_SET_F_PUBLISHED, __ATOMIC_RELEASE);
 	__ldms_dir_add_set(set);
 	return 0;
 }
@@ -848,6 +1561,53 @@ int __ldms_xprt_update(ldms_t x, struct ldms_set *set, ldms_update_cb_t cb,
 	return rc;
 }
 
+int __ldms_xprt_update_batch(ldms_t x, struct ldms_update_batch_ent_s *ents,
+			     int count, ldms_update_cb_t cb)
+{
+	ldms_t xprt = ldms_xprt_get(x, "update");
+	int i, rc, n_remote = 0;
+
+	if (!xprt) {
+		for (i = 0; i < count; i++)
+			ents[i].rc = EINVAL;
+		return EINVAL;
+	}
+
+	/*
+	 * Local sets are completed synchronously below without the xprt
+	 * lock. The remote sets are issued under a single lock acquisition.
+	 */
+	for (i = 0; i < count; i++) {
+		if (ents[i].set->flags & LDMS_SET_F_REMOTE)
+			n_remote++;
+	}
+	rc = 0;
+	if (n_remote == count) {
+		pthread_mutex_lock(&xprt->lock);
+		rc = __ldms_remote_update_batch(xprt, ents, count, cb);
+		pthread_mutex_unlock(&xprt->lock);
+		goto out;
+	}
+	pthread_mutex_lock(&xprt->lock);
+	for (i = 0; i < count; i++) {
+		if (0 == (ents[i].set->flags & LDMS_SET_F_REMOTE))
+			continue;
+		__ldms_remote_update_batch(xprt, &ents[i], 1, cb);
+		if (ents[i].rc && !rc)
+			rc = ents[i].rc;
+	}
+	pthread_mutex_unlock(&xprt->lock);
+	for (i = 0; i < count; i++) {
+		if (ents[i].set->flags & LDMS_SET_F_REMOTE)
+			continue;
+		ents[i].rc = 0;
+		cb(ents[i].set->xprt, ents[i].set, 0, ents[i].cb_arg);
+	}
+ out:
+	ldms_xprt_put(xprt, "update");
+	return rc;
+}
+
 /* Implementation is in ldms_rail.c */
 ldms_t __ldms_xprt_to_rail(ldms_t x);
 int ldms_xprt_update(struct ldms_set *set, ldms_update_cb_t cb, void *arg)
@@ -884,6 +1644,57 @@ int ldms_xprt_update(struct ldms_set *set, ldms_update_cb_t cb, void *arg)
 	return rc;
 }
 
+int ldms_xprt_update_batch(struct ldms_update_batch_ent_s *ents, int count,
+			   ldms_update_cb_t cb)
+{
+	int i, rc = 0;
+	ldms_t x = NULL, r;
+
+	if (count <= 0 || !cb)
+		return EINVAL;
+
+	/* Only the sets looked up from a transport can be updated */
+	for (i = 0; i < count; i++) {
+		if (!ents[i].set || !ents[i].set->xprt) {
+			ents[i].rc = EINVAL;
+			rc = EINVAL;
+			continue;
+		}
+		ents[i].rc = 0;
+		if (!x)
+			x = ents[i].set->xprt;
+	}
+	if (!x)
+		return EINVAL;
+
+	if (ENABLED_PROFILING(LDMS_XPRT_OP_UPDATE)) {
+		/*
+		 * The update profile is tracked per set in an operation
+		 * context that ldms_xprt_update() manages.
+		 */
+		for (i = 0; i < count; i++) {
+			if (ents[i].rc)
+				continue;
+			ents[i].rc = ldms_xprt_update(ents[i].set, cb,
+						      ents[i].cb_arg);
+			if (ents[i].rc && !rc)
+				rc = ents[i].rc;
+		}
+		return rc;
+	}
+
+	/* See ldms_xprt_update() */
+	r = __ldms_xprt_to_rail(x);
+	if (!r) {
+		for (i = 0; i < count; i++)
+			ents[i].rc = EINVAL;
+		return EINVAL;
+	}
+	/* the sets without a transport are not on any endpoint of the rail
+	 * and fail with EINVAL there */
+	return r->ops.update_batch(r, ents, count, cb);
+}
+
 void __ldms_set_on_xprt_term(ldms_set_t set, ldms_t xprt)
 {
 	struct rbn *rbn;
@@ -961,12 +1772,18 @@ static void __destroy_set_no_lock(void *v)
 	}
 
 	rbt_del(&__del_tree, &set->del_node);
+	if (set->meta_shr || set->shr_retired)
+		__set_meta_unshare(set);
 	mm_free(set->meta);
 	__ldms_set_info_delete(&set->local_info);
 	__ldms_set_info_delete(&set->remote_info);
 	zap_unmap(set->lmap);
 	if (set->rmap)
 		zap_unmap(set->rmap);
+	if (set->name_idx)
+		__name_idx_put(set->name_idx);
+	if (set->val_tbl)
+		__val_tbl_put(set->val_tbl);
 	free(set);
 }
 
@@ -982,19 +1799,15 @@ void __ldms_set_delete(ldms_set_t s, int notify)
 	ldms_t x;
 	struct ldms_set *__set;
 
-	__ldms_set_tree_lock();
 	__set = __ldms_set_by_id(s->set_id);
 	if (!__set) {
-		__ldms_set_tree_unlock();
 		/*
 		 * This is impossible since RBDs are removed.
 		 */
 		assert(0);
 		return;
 	}
-	rbt_del(&__set_tree, &s->rb_node);
-	rbt_del(&__id_tree, &s->id_node);
-	__ldms_set_tree_unlock();
+	__set_index_del(s);
 
 	/* NOTE: We will clean up the push and lookup collections
 	 *       when we destroy the set. While we wait for the
@@ -1160,7 +1973,8 @@ struct ldms_set *__ldms_create_set(const char *instance_name,
 
 uint32_t __ldms_set_size_get(struct ldms_set *s)
 {
-	return __le32_to_cpu(s->meta->meta_sz) +
+	/* desc_len is 0 unless the descriptors are shared */
+	return __le32_to_cpu(s->meta->meta_sz) - s->desc_len +
 		(__le32_to_cpu(s->meta->array_card) *
 		 (__le32_to_cpu(s->meta->data_sz)));
 }
@@ -1222,6 +2036,9 @@ int ldms_init(size_t max_size)
 	__ldms_config.default_authz_gid = getegid();
 	__ldms_config.default_authz_perm = 0440;
 	pthread_rwlock_init(&__ldms_config.default_authz_lock, NULL);
+	char *share = getenv("LDMS_SHARE_META");
+	if (share && atoi(share))
+		ldms_meta_share_enable(1);
 	__ldms_stream_stats_init();
 	return delete_thread_init_once();
 }
@@ -2114,11 +2931,28 @@ static enum ldms_value_type type_scalar_types[] = {
 	[LDMS_V_D64_ARRAY] = LDMS_V_D64
 };
 
+/* The descriptor of metric \c idx, which must be a valid index */
+static inline ldms_mdesc_t __set_desc(ldms_set_t s, int idx)
+{
+	uint32_t off = __le32_to_cpu(s->meta->dict[idx]);
+	if (s->meta_shr)
+		return (ldms_mdesc_t)&s->meta_shr->descs[off - s->desc_off];
+	return ldms_ptr_(struct ldms_value_desc, s->meta, off);
+}
+
+/* The value of the meta-attribute described by \c desc */
+static inline ldms_mval_t __set_meta_val(ldms_set_t s, ldms_mdesc_t desc)
+{
+	uint32_t off = __le32_to_cpu(desc->vd_data_offset);
+	if (s->meta_shr)
+		off += s->desc_off;
+	return ldms_ptr_(union ldms_value, s->meta, off);
+}
+
 static inline ldms_mdesc_t __desc_get(ldms_set_t s, int idx)
 {
 	if (idx >= 0 && idx < __le32_to_cpu(s->meta->card))
-		return ldms_ptr_(struct ldms_value_desc, s->meta,
-				__le32_to_cpu(s->meta->dict[idx]));
+		return __set_desc(s, idx);
 	errno = ENOENT;
 	return NULL;
 }
@@ -2162,7 +2996,125 @@ int ldms_metric_flags_get(ldms_set_t s, int i)
 	return 0;
 }
 
-int ldms_metric_by_name(ldms_set_t set, const char *name)
+/*
+ * Metric name -> index hash table, one per schema digest.
+ *
+ * Sets of the same schema have the same metric names at the same indices,
+ * so the table is built once from the first set and shared (reference
+ * counted) by all sets carrying that digest. The table stores only metric
+ * indices; the name at the candidate index is always compared against the
+ * set's own dictionary, so a lookup can never return a wrong index.
+ *
+ * Schemas with fewer than LDMS_NAME_IDX_MIN_CARD metrics, and sets without
+ * a digest, use the linear scan.
+ */
+#define LDMS_NAME_IDX_MIN_CARD 16
+
+struct ldms_name_idx {
+	struct rbn rbn;		/* key: digest */
+	struct ldms_digest_s digest;
+	int ref;
+	uint32_t card;
+	uint32_t mask;		/* number of slots - 1 */
+	int32_t slot[OVIS_FLEX];	/* metric index or -1 */
+};
+
+static int __name_idx_cmp(void *a, const void *b)
+{
+	return memcmp(a, b, LDMS_DIGEST_LENGTH);
+}
+
+static struct rbt __name_idx_tree = RBT_INITIALIZER(__name_idx_cmp);
+static pthread_mutex_t __name_idx_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static inline uint32_t __name_hash(const char *name)
+{
+	return fnv_hash_a1_32(name, strlen(name), 0);
+}
+
+static struct ldms_name_idx *__name_idx_new(ldms_set_t s, ldms_digest_t digest)
+{
+	struct ldms_name_idx *nidx;
+	uint32_t card = ldms_set_card_get(s);
+	uint32_t nslot, h, i;
+	ldms_mdesc_t desc;
+
+	for (nslot = 1; nslot < 2 * card; nslot <<= 1)
+		;
+	nidx = malloc(sizeof(*nidx) + nslot * sizeof(nidx->slot[0]));
+	if (!nidx)
+		return NULL;
+	memcpy(&nidx->digest, digest, sizeof(nidx->digest));
+	rbn_init(&nidx->rbn, &nidx->digest);
+	nidx->ref = 1;
+	nidx->card = card;
+	nidx->mask = nslot - 1;
+	memset(nidx->slot, -1, nslot * sizeof(nidx->slot[0]));
+	for (i = 0; i < card; i++) {
+		desc = __desc_get(s, i);
+		h = __name_hash(desc->vd_name_unit) & nidx->mask;
+		/* duplicate names keep the lowest index first in the chain */
+		while (nidx->slot[h] >= 0)
+			h = (h + 1) & nidx->mask;
+		nidx->slot[h] = i;
+	}
+	return nidx;
+}
+
+static void __name_idx_put(struct ldms_name_idx *nidx)
+{
+	pthread_mutex_lock(&__name_idx_lock);
+	if (0 == --nidx->ref) {
+		rbt_del(&__name_idx_tree, &nidx->rbn);
+		free(nidx);
+	}
+	pthread_mutex_unlock(&__name_idx_lock);
+}
+
+/* Returns the name index of the set, or NULL if the set must be scanned. */
+static struct ldms_name_idx *__set_name_idx(ldms_set_t s)
+{
+	struct ldms_name_idx *nidx, *cur = NULL;
+	ldms_digest_t digest;
+	struct rbn *rbn;
+
+	nidx = __atomic_load_n(&s->name_idx, __ATOMIC_ACQUIRE);
+	if (nidx)
+		return nidx;
+	if (ldms_set_card_get(s) < LDMS_NAME_IDX_MIN_CARD)
+		return NULL;
+	digest = ldms_set_digest_get(s);
+	if (digest == &null_digest)
+		return NULL;
+
+	pthread_mutex_lock(&__name_idx_lock);
+	rbn = rbt_find(&__name_idx_tree, digest);
+	if (rbn) {
+		nidx = container_of(rbn, struct ldms_name_idx, rbn);
+		if (nidx->card != ldms_set_card_get(s)) {
+			/* digest collision, do not share */
+			pthread_mutex_unlock(&__name_idx_lock);
+			return NULL;
+		}
+		nidx->ref++;
+	} else {
+		nidx = __name_idx_new(s, digest);
+		if (nidx)
+			rbt_ins(&__name_idx_tree, &nidx->rbn);
+	}
+	pthread_mutex_unlock(&__name_idx_lock);
+	if (!nidx)
+		return NULL;
+	if (!__atomic_compare_exchange_n(&s->name_idx, &cur, nidx, 0,
+					 __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+		/* another thread resolved it first */
+		__name_idx_put(nidx);
+		return cur;
+	}
+	return nidx;
+}
+
+static int __metric_by_name_scan(ldms_set_t set, const char *name)
 {
 	int i;
 	for (i = 0; i < ldms_set_card_get(set); i++) {
@@ -2173,6 +3125,46 @@ int ldms_metric_by_name(ldms_set_t set, const char *name)
 	return -1;
 }
 
+static inline int __metric_by_name_idx(ldms_set_t set,
+				       struct ldms_name_idx *nidx,
+				       const char *name)
+{
+	uint32_t h = __name_hash(name) & nidx->mask;
+	ldms_mdesc_t desc;
+	int i;
+	while ((i = nidx->slot[h]) >= 0) {
+		desc = __desc_get(set, i);
+		if (desc && 0 == strcmp(desc->vd_name_unit, name))
+			return i;
+		h = (h + 1) & nidx->mask;
+	}
+	return -1;
+}
+
+int ldms_metric_by_name(ldms_set_t set, const char *name)
+{
+	struct ldms_name_idx *nidx = __set_name_idx(set);
+	if (!nidx)
+		return __metric_by_name_scan(set, name);
+	return __metric_by_name_idx(set, nidx, name);
+}
+
+int ldms_metric_ids_by_names(ldms_set_t set, const char *names[],
+			     int *ids, int count)
+{
+	struct ldms_name_idx *nidx = __set_name_idx(set);
+	int i, found = 0;
+	for (i = 0; i < count; i++) {
+		if (nidx)
+			ids[i] = __metric_by_name_idx(set, nidx, names[i]);
+		else
+			ids[i] = __metric_by_name_scan(set, names[i]);
+		if (ids[i] >= 0)
+			found++;
+	}
+	return found;
+}
+
 int __schema_mdef_add(ldms_schema_t s, ldms_mdef_t m)
 {
 	/* Digest */
@@ -2395,7 +3387,8 @@ enum ldms_value_type ldms_metric_type_to_scalar_type(enum ldms_value_type t)
 void ldms_metric_user_data_set(ldms_set_t s, int i, uint64_t u)
 {
 	ldms_mdesc_t desc = __desc_get(s, i);
-	if (desc) {
+	/* shared descriptors are read-only */
+	if (desc && !s->meta_shr) {
 		desc->vd_user_data = __cpu_to_le64(u);
 		__ldms_gn_inc(s, desc);
 	}
@@ -2421,15 +3414,13 @@ static int metric_is_array(ldms_mdesc_t desc)
 
 int ldms_metric_is_array(ldms_set_t s, int i)
 {
-	ldms_mdesc_t desc = ldms_ptr_(struct ldms_value_desc, s->meta,
-			__le32_to_cpu(s->meta->dict[i]));
+	ldms_mdesc_t desc = __set_desc(s, i);
 	return metric_is_array(desc);
 }
 
 void ldms_metric_modify(ldms_set_t s, int i)
 {
-	ldms_mdesc_t desc = ldms_ptr_(struct ldms_value_desc, s->meta,
-			__le32_to_cpu(s->meta->dict[i]));
+	ldms_mdesc_t desc = __set_desc(s, i);
 	if (desc)
 		__ldms_gn_inc(s, desc);
 	else
@@ -2445,16 +3436,14 @@ static ldms_mval_t __mval_to_set(struct ldms_set *s, int idx, ldms_mdesc_t *pd)
 		return NULL;
 	}
 
-	desc = ldms_ptr_(struct ldms_value_desc, s->meta,
-			__le32_to_cpu(s->meta->dict[idx]));
+	desc = __set_desc(s, idx);
 	if (pd)
 		*pd = desc;
 	if (desc->vd_flags & LDMS_MDESC_F_DATA) {
 		return ldms_ptr_(union ldms_value, s->data,
 				 __le32_to_cpu(desc->vd_data_offset));
 	}
-	return ldms_ptr_(union ldms_value, s->meta,
-			__le32_to_cpu(desc->vd_data_offset));
+	return __set_meta_val(s, desc);
 }
 
 static ldms_mval_t __mval_to_get(struct ldms_set *s, int idx, ldms_mdesc_t *pd)
@@ -2467,8 +3456,7 @@ static ldms_mval_t __mval_to_get(struct ldms_set *s, int idx, ldms_mdesc_t *pd)
 		errno = ENOENT;
 		return NULL;
 	}
-	desc = ldms_ptr_(struct ldms_value_desc, s->meta,
-			 __le32_to_cpu(s->meta->dict[idx]));
+	desc = __set_desc(s, idx);
 	if (pd)
 		*pd = desc;
 	if (desc->vd_flags & LDMS_MDESC_F_DATA) {
@@ -2488,8 +3476,7 @@ static ldms_mval_t __mval_to_get(struct ldms_set *s, int idx, ldms_mdesc_t *pd)
 					 __le32_to_cpu(desc->vd_data_offset));
 		}
 	}
-	return ldms_ptr_(union ldms_value, s->meta,
-			__le32_to_cpu(desc->vd_data_offset));
+	return __set_meta_val(s, desc);
 }
 
 ldms_mval_t ldms_metric_get(ldms_set_t s, int i)
@@ -2499,8 +3486,7 @@ ldms_mval_t ldms_metric_get(ldms_set_t s, int i)
 
 uint32_t ldms_metric_array_get_len(ldms_set_t s, int i)
 {
-	ldms_mdesc_t desc = ldms_ptr_(struct ldms_value_desc, s->meta,
-				      __le32_to_cpu(s->meta->dict[i]));
+	ldms_mdesc_t desc = __set_desc(s, i);
 	if (metric_is_array(desc))
 		return __le32_to_cpu(desc->vd_array_count);
 	return 1;
@@ -2894,8 +3880,7 @@ void ldms_metric_array_set_double(ldms_set_t s, int mid, int idx, double v)
 void ldms_metric_array_set(ldms_set_t s, int mid, ldms_mval_t mval,
 			   size_t start, size_t count)
 {
-	ldms_mdesc_t desc = ldms_ptr_(struct ldms_value_desc, s->meta,
-				      __le32_to_cpu(s->meta->dict[mid]));
+	ldms_mdesc_t desc = __set_desc(s, mid);
 	int i;
 	ldms_mval_t val = __mval_to_set(s, mid, &desc);
 	switch (desc->vd_type) {
@@ -3048,6 +4033,322 @@ double ldms_metric_get_double(ldms_set_t s, int i)
 	return 0;
 }
 
+/*
+ * Metric value offset table, one per schema digest.
+ *
+ * Entry i holds the value offset, the type and the location (data or
+ * meta-data) of metric i, and the number of metrics starting at i that
+ * have the same type and location and whose values are adjacent. Scalar
+ * values take one 8 byte slot each, so a run of scalars is an array of
+ * slots, and a range of metrics is accessed one run at a time without
+ * going through the dictionary and the descriptors.
+ *
+ * The table is shared like the name index. It is built from the first set
+ * of a digest and only shared with the sets having the same card and
+ * sizes. Sets without a digest get a private table.
+ *
+ * The offsets of the meta-attributes are those of the full layout. A set
+ * sharing its descriptors (see __ldms_set_meta_share()) has the desc_len
+ * bytes of the descriptors removed in front of the meta-attribute values,
+ * so the same table serves the sets that share and those that do not.
+ */
+struct ldms_val_ent {
+	uint32_t off;		/* vd_data_offset in the full layout */
+	uint32_t run;		/* adjacent values of the same type */
+	uint8_t type;
+	uint8_t meta;		/* the value is in the meta-data */
+};
+
+struct ldms_val_tbl {
+	struct rbn rbn;		/* key: digest */
+	struct ldms_digest_s digest;
+	int ref;
+	int shared;		/* in __val_tbl_tree */
+	uint32_t card;
+	uint32_t meta_sz;
+	uint32_t data_sz;
+	struct ldms_val_ent ent[OVIS_FLEX];
+};
+
+static struct rbt __val_tbl_tree = RBT_INITIALIZER(__name_idx_cmp);
+static pthread_mutex_t __val_tbl_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int __type_is_scalar(enum ldms_value_type t)
+{
+	return t >= LDMS_V_CHAR && t <= LDMS_V_D64;
+}
+
+static struct ldms_val_tbl *__val_tbl_new(ldms_set_t s)
+{
+	struct ldms_val_tbl *tbl;
+	struct ldms_val_ent *e;
+	int card = ldms_set_card_get(s);
+	ldms_mdesc_t desc;
+	int i;
+
+	tbl = malloc(sizeof(*tbl) + card * sizeof(tbl->ent[0]));
+	if (!tbl)
+		return NULL;
+	tbl->ref = 1;
+	tbl->shared = 0;
+	tbl->card = card;
+	tbl->meta_sz = __le32_to_cpu(s->meta->meta_sz);
+	tbl->data_sz = __le32_to_cpu(s->meta->data_sz);
+	for (i = card - 1; i >= 0; i--) {
+		desc = __set_desc(s, i);
+		e = &tbl->ent[i];
+		e->off = __le32_to_cpu(desc->vd_data_offset);
+		e->type = desc->vd_type;
+		e->meta = !(desc->vd_flags & LDMS_MDESC_F_DATA);
+		if (e->meta && s->meta_shr)
+			/* relative to the values that follow the descriptors */
+			e->off += s->desc_off + s->desc_len;
+		e->run = 1;
+		if (i < card - 1 && __type_is_scalar(e->type) &&
+		    e[1].type == e->type && e[1].meta == e->meta &&
+		    e[1].off == e->off + sizeof(uint64_t))
+			e->run += e[1].run;
+	}
+	return tbl;
+}
+
+static void __val_tbl_put(struct ldms_val_tbl *tbl)
+{
+	pthread_mutex_lock(&__val_tbl_lock);
+	if (0 == --tbl->ref) {
+		if (tbl->shared)
+			rbt_del(&__val_tbl_tree, &tbl->rbn);
+		free(tbl);
+	}
+	pthread_mutex_unlock(&__val_tbl_lock);
+}
+
+/* Returns the value offset table of the set, or NULL if out of memory. */
+static struct ldms_val_tbl *__set_val_tbl(ldms_set_t s)
+{
+	struct ldms_val_tbl *tbl, *cur = NULL;
+	ldms_digest_t digest;
+	struct rbn *rbn = NULL;
+
+	tbl = __atomic_load_n(&s->val_tbl, __ATOMIC_ACQUIRE);
+	if (tbl)
+		return tbl;
+	digest = ldms_set_digest_get(s);
+
+	pthread_mutex_lock(&__val_tbl_lock);
+	if (digest != &null_digest)
+		rbn = rbt_find(&__val_tbl_tree, digest);
+	if (rbn) {
+		tbl = container_of(rbn, struct ldms_val_tbl, rbn);
+		if (tbl->card == ldms_set_card_get(s) &&
+		    tbl->meta_sz == __le32_to_cpu(s->meta->meta_sz) &&
+		    tbl->data_sz == __le32_to_cpu(s->meta->data_sz)) {
+			tbl->ref++;
+		} else {
+			/* digest collision, use a private table */
+			tbl = __val_tbl_new(s);
+		}
+	} else {
+		tbl = __val_tbl_new(s);
+		if (tbl && digest != &null_digest) {
+			memcpy(&tbl->digest, digest, sizeof(tbl->digest));
+			rbn_init(&tbl->rbn, &tbl->digest);
+			rbt_ins(&__val_tbl_tree, &tbl->rbn);
+			tbl->shared = 1;
+		}
+	}
+	pthread_mutex_unlock(&__val_tbl_lock);
+	if (!tbl)
+		return NULL;
+	if (!__atomic_compare_exchange_n(&s->val_tbl, &cur, tbl, 0,
+					 __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+		/* another thread resolved it first */
+		__val_tbl_put(tbl);
+		return cur;
+	}
+	return tbl;
+}
+
+/*
+ * Checks that metrics [first, first + n) exist and have the type t0 or t1.
+ * Returns the table of the set, or NULL with errno set.
+ */
+static struct ldms_val_tbl *__range_check(ldms_set_t s, int first, int n,
+					  enum ldms_value_type t0,
+					  enum ldms_value_type t1)
+{
+	struct ldms_val_tbl *tbl;
+	struct ldms_val_ent *e;
+	int i;
+
+	if (first < 0 || n < 0 || first > (int)ldms_set_card_get(s) - n) {
+		errno = ENOENT;
+		return NULL;
+	}
+	tbl = __set_val_tbl(s);
+	if (!tbl) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	for (i = first; i < first + n; i += e->run) {
+		e = &tbl->ent[i];
+		if (e->type != t0 && e->type != t1) {
+			errno = EINVAL;
+			return NULL;
+		}
+	}
+	return tbl;
+}
+
+/* The value slots of the run at entry \c e */
+static inline uint64_t *__run_slots(ldms_set_t s, struct ldms_data_hdr *data,
+				    struct ldms_val_ent *e)
+{
+	if (!e->meta)
+		return ldms_ptr_(uint64_t, data, e->off);
+	/* desc_len is 0 if the set does not share its descriptors */
+	return ldms_ptr_(uint64_t, s->meta, e->off - s->desc_len);
+}
+
+/*
+ * Stores the \c n values of \c width bytes at \c vals in metrics
+ * [first, first + n), then bumps the generation numbers once.
+ */
+static int __range_set(ldms_set_t s, int first, int n, const void *vals,
+		       int width, enum ldms_value_type t0,
+		       enum ldms_value_type t1)
+{
+	struct ldms_val_tbl *tbl;
+	struct ldms_val_ent *e;
+	uint64_t *slot;
+	int i, j, k, seg, data_idx = -1, meta_idx = -1;
+
+	tbl = __range_check(s, first, n, t0, t1);
+	if (!tbl)
+		return errno;
+	for (i = first, k = 0; k < n; i += seg, k += seg) {
+		e = &tbl->ent[i];
+		seg = e->run < n - k ? e->run : n - k;
+		slot = __run_slots(s, s->data, e);
+		if (width == sizeof(uint64_t)) {
+			const uint64_t *v = (const uint64_t *)vals + k;
+			for (j = 0; j < seg; j++)
+				slot[j] = __cpu_to_le64(v[j]);
+		} else {
+			const uint32_t *v = (const uint32_t *)vals + k;
+			for (j = 0; j < seg; j++)
+				*(uint32_t *)&slot[j] = __cpu_to_le32(v[j]);
+		}
+		if (e->meta)
+			meta_idx = i;
+		else
+			data_idx = i;
+	}
+	if (data_idx >= 0)
+		__ldms_gn_inc(s, __set_desc(s, data_idx));
+	if (meta_idx >= 0)
+		__ldms_gn_inc(s, __set_desc(s, meta_idx));
+	return 0;
+}
+
+/*
+ * Loads the values of metrics [first, first + n) into \c vals. Like
+ * ldms_metric_get(), reads the previous data inside a transaction.
+ */
+static int __range_get(ldms_set_t s, int first, int n, void *vals,
+		       int width, enum ldms_value_type t0,
+		       enum ldms_value_type t1)
+{
+	struct ldms_val_tbl *tbl;
+	struct ldms_val_ent *e;
+	struct ldms_data_hdr *data = s->data;
+	uint64_t *slot;
+	int i, j, k, seg, acnt;
+
+	tbl = __range_check(s, first, n, t0, t1);
+	if (!tbl)
+		return errno;
+	if (s->data->trans.flags != LDMS_TRANSACTION_END) {
+		acnt = __le32_to_cpu(s->meta->array_card);
+		data = __set_array_get(s, (s->curr_idx + (acnt - 1)) % acnt);
+	}
+	for (i = first, k = 0; k < n; i += seg, k += seg) {
+		e = &tbl->ent[i];
+		seg = e->run < n - k ? e->run : n - k;
+		slot = __run_slots(s, data, e);
+		if (width == sizeof(uint64_t)) {
+			uint64_t *v = (uint64_t *)vals + k;
+			for (j = 0; j < seg; j++)
+				v[j] = __le64_to_cpu(slot[j]);
+		} else {
+			uint32_t *v = (uint32_t *)vals + k;
+			for (j = 0; j < seg; j++)
+				v[j] = __le32_to_cpu(*(uint32_t *)&slot[j]);
+		}
+	}
+	return 0;
+}
+
+int ldms_metric_set_u64_range(ldms_set_t s, int first, int n, const uint64_t *vals)
+{
+	return __range_set(s, first, n, vals, sizeof(*vals), LDMS_V_U64, LDMS_V_S64);
+}
+
+int ldms_metric_set_s64_range(ldms_set_t s, int first, int n, const int64_t *vals)
+{
+	return __range_set(s, first, n, vals, sizeof(*vals), LDMS_V_U64, LDMS_V_S64);
+}
+
+int ldms_metric_set_u32_range(ldms_set_t s, int first, int n, const uint32_t *vals)
+{
+	return __range_set(s, first, n, vals, sizeof(*vals), LDMS_V_U32, LDMS_V_S32);
+}
+
+int ldms_metric_set_s32_range(ldms_set_t s, int first, int n, const int32_t *vals)
+{
+	return __range_set(s, first, n, vals, sizeof(*vals), LDMS_V_U32, LDMS_V_S32);
+}
+
+int ldms_metric_set_float_range(ldms_set_t s, int first, int n, const float *vals)
+{
+	return __range_set(s, first, n, vals, sizeof(*vals), LDMS_V_F32, LDMS_V_F32);
+}
+
+int ldms_metric_set_double_range(ldms_set_t s, int first, int n, const double *vals)
+{
+	return __range_set(s, first, n, vals, sizeof(*vals), LDMS_V_D64, LDMS_V_D64);
+}
+
+int ldms_metric_get_u64_range(ldms_set_t s, int first, int n, uint64_t *vals)
+{
+	return __range_get(s, first, n, vals, sizeof(*vals), LDMS_V_U64, LDMS_V_S64);
+}
+
+int ldms_metric_get_s64_range(ldms_set_t s, int first, int n, int64_t *vals)
+{
+	return __range_get(s, first, n, vals, sizeof(*vals), LDMS_V_U64, LDMS_V_S64);
+}
+
+int ldms_metric_get_u32_range(ldms_set_t s, int first, int n, uint32_t *vals)
+{
+	return __range_get(s, first, n, vals, sizeof(*vals), LDMS_V_U32, LDMS_V_S32);
+}
+
+int ldms_metric_get_s32_range(ldms_set_t s, int first, int n, int32_t *vals)
+{
+	return __range_get(s, first, n, vals, sizeof(*vals), LDMS_V_U32, LDMS_V_S32);
+}
+
+int ldms_metric_get_float_range(ldms_set_t s, int first, int n, float *vals)
+{
+	return __range_get(s, first, n, vals, sizeof(*vals), LDMS_V_F32, LDMS_V_F32);
+}
+
+int ldms_metric_get_double_range(ldms_set_t s, int first, int n, double *vals)
+{
+	return __range_get(s, first, n, vals, sizeof(*vals), LDMS_V_D64, LDMS_V_D64);
+}
+
 const char *ldms_metric_array_get_str(ldms_set_t s, int mid)
 {
 	ldms_mdesc_t desc;
@@ -174,9 +174,12 @@ typedef struct ldms_record *ldms_record_t;
  * The functions for doing this are as follows:
  *
  * \li \b ldms_metric_by_name() Find the index for a metric
+ * \li \b ldms_metric_ids_by_names() Find the indices of many metrics at once
  * \li \b ldms_metric_set() Set the value of a metric.
  * \li \b ldms_metric_get_X() Get the value of a metric where the X
  * specifies the data type
+ * \li \b ldms_metric_set_X_range() Set the values of adjacent metrics
+ * \li \b ldms_metric_get_X_range() Get the values of adjacent metrics
  * \li \b ldms_metric_set_S() Set the value of a metric where the X
  * specifies the data type
  *
@@ -1544,6 +1547,71 @@ ldms_stream_subscribe(const char *stream, int is_regex,
  */
 void ldms_stream_close(ldms_stream_client_t c);
 
+/**
+ * The overflow policies of a stream client delivery ring.
+ */
+typedef enum ldms_stream_ring_policy_e {
+	/** Discard the oldest queued message to make room for the new one. */
+	LDMS_STREAM_RING_DROP_OLDEST,
+	/** Discard the new message. */
+	LDMS_STREAM_RING_DROP_NEWEST,
+	/** Make the publisher wait for room in the ring. */
+	LDMS_STREAM_RING_BLOCK,
+} ldms_stream_ring_policy_t;
+
+/**
+ * \brief Deliver the stream data to the client asynchronously.
+ *
+ * By default, the callback function of a local client is called by the
+ * publishing thread, so a slow client delays the publisher and the other
+ * clients of the stream. This function gives the client \c c a bounded
+ * delivery ring. The publishers then only queue a reference to the stream
+ * data to the ring, and the client callback is called from the thread
+ * draining the ring, one message at a time in the publishing order.
+ *
+ * When the ring is full, \c policy decides what happens to the new message.
+ * The dropped messages are counted in the \c drops and \c ring_drops
+ * counters of the client statistics (\c ldms_stream_client_get_stats()).
+ *
+ * The ring is drained by \c worker if it is not \c NULL, or by a thread
+ * owned by the client otherwise. \c ldms_stream_close() delivers the queued
+ * messages before the \c LDMS_STREAM_EVENT_CLOSE event.
+ *
+ * \param c      The local stream client handle.
+ * \param size   The number of messages the ring can hold; it is rounded up
+ *               to a power of 2.
+ * \param policy The overflow policy.
+ * \param worker The \c ev worker draining the ring, or \c NULL.
+ *
+ * \retval 0      If succeeded.
+ * \retval EINVAL If \c c is a remote client, \c size is 0 or \c policy is
+ *                not valid.
+ * \retval EBUSY  If \c c already has a delivery ring.
+ * \retval ENOMEM If there is not enough memory.
+ * \retval errno  Other errors from creating the draining thread.
+ */
+int ldms_stream_client_ring_set(ldms_stream_client_t c, uint32_t size,
+				ldms_stream_ring_policy_t policy,
+				ev_worker_t worker);
+
+/**
+ * \brief Deliver the JSON stream data to the client without parsing it.
+ *
+ * By default, the data of an \c LDMS_STREAM_JSON message is parsed before
+ * it is delivered to a local client, and the parsed object is given in
+ * \c recv.json. A client that only needs a few values out of the message,
+ * or that parses the data itself, can skip that work with this function.
+ * The \c recv.json of the events delivered to such a client is \c NULL and
+ * the data is only available in \c recv.data.
+ *
+ * \param c   The local stream client handle.
+ * \param raw 1 to deliver the raw data only, 0 to restore the default.
+ *
+ * \retval 0      If succeeded.
+ * \retval EINVAL If \c c is a remote client.
+ */
+int ldms_stream_client_raw_json_set(ldms_stream_client_t c, int raw);
+
 /**
  * \brief Request a remote stream subscritpion.
  *
@@ -1654,6 +1722,10 @@ struct ldms_stream_client_stats_s {
 	int is_regex;
 	const char *match; /* the matching string; allocated with the structure */
 	const char *desc; /* the short description; allocated with the structure */
+	uint32_t ring_size; /* 0 if the client has no delivery ring */
+	uint64_t ring_lag; /* messages in the ring, waiting for delivery */
+	uint64_t ring_max_lag; /* the highest ring_lag seen by the publishers */
+	struct ldms_stream_counters_s ring_drops; /* drops due to ring overflow */
 };
 TAILQ_HEAD(ldms_stream_client_stats_tq_s, ldms_stream_client_stats_s);
 
@@ -1929,6 +2001,54 @@ int ldms_xprt_dir_cancel(ldms_t t);
 #define LDMS_DIR_F_NOTIFY	1
 extern int ldms_xprt_dir(ldms_t x, ldms_dir_cb_t cb, void *cb_arg, uint32_t flags);
 
+/**
+ * \brief A copy of the directory of a peer kept across connections
+ *
+ * Peers that support the binary directory protocol send the directory
+ * update notifications as batches of changes, and a requester that still
+ * holds the directory of the same peer process is only sent the sets
+ * that changed since it was received. The cache holds that directory so
+ * that the application is still given the complete LDMS_DIR_LIST.
+ *
+ * A cache is used with one transport at a time, e.g. one per producer
+ * that reconnects to the same peer.
+ *
+ * \returns A new, empty cache or NULL if there is not enough memory.
+ */
+typedef struct ldms_dir_cache_s *ldms_dir_cache_t;
+extern ldms_dir_cache_t ldms_dir_cache_new(void);
+
+/**
+ * \brief Free a directory cache
+ *
+ * \param c The cache from ldms_dir_cache_new()
+ */
+extern void ldms_dir_cache_free(ldms_dir_cache_t c);
+
+/**
+ * \brief Query the sets published by a host using a directory cache.
+ *
+ * Like ldms_xprt_dir(), but the directory is maintained in \c cache.
+ * The \c cb function is given the complete directory in a single
+ * LDMS_DIR_LIST when the query completes, even if only the changes since
+ * the cached directory were transferred. LDMS_DIR_ADD and LDMS_DIR_UPD
+ * notifications are delivered as with ldms_xprt_dir().
+ *
+ * The environment variable LDMS_DIR_LOG_SIZE sets the number of
+ * directory changes the peer remembers for this (default 65536), and
+ * LDMS_DIR_BATCH_USEC the time it collects changes before notifying
+ * (default 10000).
+ *
+ * \param x	 The transport handle
+ * \param cb	 The callback function
+ * \param cb_arg The \c cb argument
+ * \param flags	 LDMS_DIR_F_NOTIFY for directory update notifications
+ * \param cache	 The directory cache, or NULL for ldms_xprt_dir()
+ * \returns	 0 if the query was submitted successfully
+ */
+extern int ldms_xprt_dir_cached(ldms_t x, ldms_dir_cb_t cb, void *cb_arg,
+				uint32_t flags, ldms_dir_cache_t cache);
+
 #define LDMS_XPRT_LIBPATH_DEFAULT PLUGINDIR
 #define LDMS_DEFAULT_PORT	LDMSDPORT
 #define LDMS_LOOKUP_PATH_MAX	511
@@ -2029,6 +2149,45 @@ typedef void (*ldms_update_cb_t)(ldms_t t, ldms_set_t s, int flags, void *arg);
  */
 extern int ldms_xprt_update(ldms_set_t s, ldms_update_cb_t update_cb, void *arg);
 
+/**
+ * \brief An entry in an update batch
+ *
+ * See ldms_xprt_update_batch().
+ */
+struct ldms_update_batch_ent_s {
+	ldms_set_t set;	/**< The set to update */
+	void *cb_arg;	/**< The \c arg given to the update callback of \c set */
+	int rc;		/**< [out] The synchronous status of the update request */
+};
+
+/**
+ * \brief Update the contents of a batch of metric sets.
+ *
+ * This is equivalent to calling ldms_xprt_update() on each set in \c ents,
+ * but the transport reference, the endpoint lock and the connection and
+ * authentication checks are taken once per endpoint instead of once per
+ * set, and the update contexts of the whole batch are allocated in a single
+ * block. All sets in the batch must be looked up from the same transport
+ * (e.g. from the same producer).
+ *
+ * The synchronous status of each set is returned in \c ents[i].rc. The
+ * \c update_cb is called as with ldms_xprt_update() for each set whose
+ * \c rc is 0, and is not called for the sets that failed synchronously.
+ *
+ * \param ents      The array of batch entries.
+ * \param count     The number of entries in \c ents.
+ * \param update_cb The function to call when the update of a set completes.
+ *
+ * \retval 0      If all updates were requested successfully.
+ * \retval EINVAL If \c count is not positive or \c update_cb is NULL, or
+ *                if a set in \c ents is not a remote set. The \c rc of such
+ *                a set is EINVAL; the other sets are updated.
+ * \retval errno  The first synchronous error of the batch. See \c ents[i].rc
+ *                for the status of each set.
+ */
+extern int ldms_xprt_update_batch(struct ldms_update_batch_ent_s *ents,
+				  int count, ldms_update_cb_t update_cb);
+
 #define LDMS_XPRT_PUSH_F_CHANGE	1
 /**
  * \brief Register a remote set for push notifications
@@ -2824,6 +2983,48 @@ extern int ldms_set_count();
  */
 extern int ldms_set_deleting_count();
 
+/**
+ * \brief Shared set meta-data statistics
+ *
+ * \see ldms_meta_share_enable(), ldms_meta_share_stats_get()
+ */
+struct ldms_meta_share_stats {
+	uint64_t blocks;	/*! Number of shared descriptor blocks */
+	uint64_t block_bytes;	/*! Memory held by the shared blocks */
+	uint64_t sets;		/*! Number of sets using a shared block */
+	uint64_t set_bytes;	/*! Descriptor bytes these sets would hold unshared */
+	uint64_t export_sets;	/*! Shared sets exported to peers */
+	uint64_t export_bytes;	/*! Memory held by the exported images */
+	int64_t saved_bytes;	/*! set_bytes - block_bytes - export_bytes */
+};
+
+/**
+ * \brief Enable or disable meta-data sharing of looked-up sets
+ *
+ * When enabled, the metric descriptors (names, units, types and offsets)
+ * of a set returned by ldms_xprt_lookup() are kept once per schema digest
+ * and shared by all remote sets with that digest; each set keeps only its
+ * header, instance and schema names and meta-attribute values. Sets that
+ * contain record types are never shared. Peers that look up or receive a
+ * push of a shared set are served a full image of the set, so the
+ * protocol is unchanged.
+ *
+ * The setting applies to subsequent lookups. Sharing is also enabled if
+ * the LDMS_SHARE_META environment variable is set to a non-zero value
+ * when ldms_init() is called.
+ *
+ * \param enable Non-zero to enable, 0 to disable.
+ * \returns The previous setting.
+ */
+int ldms_meta_share_enable(int enable);
+
+/**
+ * \brief Get the meta-data sharing statistics
+ *
+ * \param[out] stats The statistics.
+ */
+void ldms_meta_share_stats_get(struct ldms_meta_share_stats *stats);
+
 /**
  * \addtogroup ldms_set_config LDMS Set Configuration
  *
@@ -3562,6 +3763,24 @@ extern int ldms_schema_meta_array_add_with_unit(ldms_schema_t s, const char *nam
  */
 extern int ldms_metric_by_name(ldms_set_t s, const char *name);
 
+/**
+ * \brief Resolve the metric indices of many names at once
+ *
+ * For each name in \c names, stores the index of the metric with that
+ * name in the corresponding entry of \c ids, or -1 if the set has no such
+ * metric. The lookup uses the name index shared by all sets of the same
+ * schema, so resolving the indices of a wide schema costs one hash
+ * probe per name rather than a scan of the metric dictionary.
+ *
+ * \param s	The metric set handle
+ * \param names	Array of \c count metric names
+ * \param ids	Array of \c count indices to fill
+ * \param count	The number of names
+ * \returns	The number of names found in the set.
+ */
+extern int ldms_metric_ids_by_names(ldms_set_t s, const char *names[],
+				    int *ids, int count);
+
 /**
  * \brief Returns the name of a metric.
  *
@@ -3650,7 +3869,9 @@ extern enum ldms_value_type ldms_metric_str_to_type(const char *name);
 /**
  * \brief Set the user-data associated with a metric
  *
- * Sets the user-defined meta data associated with a metric.
+ * Sets the user-defined meta data associated with a metric. It has no
+ * effect on a remote set whose meta-data is shared, see
+ * ldms_meta_share_enable().
  *
  * \param s     The set handle.
  * \param i	The metric index
@@ -3833,6 +4054,58 @@ int64_t ldms_metric_array_get_s64(ldms_set_t s, int id, int idx);
 float ldms_metric_array_get_float(ldms_set_t s, int id, int idx);
 double ldms_metric_array_get_double(ldms_set_t s, int id, int idx);
 
+/**
+ * \brief Set the values of a range of metrics.
+ *
+ * Set metrics \c first to \c first + \c n - 1 to the \c n values at
+ * \c vals, which is the same as calling ldms_metric_set_X() for each
+ * metric, but the metric offsets come from a table shared by all sets of
+ * the schema and the generation number is updated once. Samplers that
+ * write many adjacent counters in a transaction should use these.
+ *
+ * Every metric in the range must have the type of the function, or the
+ * other signedness of it (e.g. LDMS_V_U64 or LDMS_V_S64 for
+ * ldms_metric_set_u64_range()). Nothing is set if a metric does not.
+ *
+ * \param s	The set handle.
+ * \param first	The index of the first metric
+ * \param n	The number of metrics
+ * \param vals	The array of \c n values
+ * \retval 0	If the values were set
+ * \retval ENOENT If the range is not in the set
+ * \retval EINVAL If a metric in the range has a different type
+ * \retval ENOMEM If the offset table cannot be allocated
+ */
+int ldms_metric_set_u64_range(ldms_set_t s, int first, int n, const uint64_t *vals);
+int ldms_metric_set_s64_range(ldms_set_t s, int first, int n, const int64_t *vals);
+int ldms_metric_set_u32_range(ldms_set_t s, int first, int n, const uint32_t *vals);
+int ldms_metric_set_s32_range(ldms_set_t s, int first, int n, const int32_t *vals);
+int ldms_metric_set_float_range(ldms_set_t s, int first, int n, const float *vals);
+int ldms_metric_set_double_range(ldms_set_t s, int first, int n, const double *vals);
+
+/**
+ * \brief Get the values of a range of metrics.
+ *
+ * The mirror of ldms_metric_set_X_range(). Stores the values of metrics
+ * \c first to \c first + \c n - 1 in \c vals. Like ldms_metric_get_X(),
+ * it returns the values of the previous sample inside a transaction.
+ *
+ * \param s	The set handle.
+ * \param first	The index of the first metric
+ * \param n	The number of metrics
+ * \param vals	The array of \c n values to fill
+ * \retval 0	If the values were read
+ * \retval ENOENT If the range is not in the set
+ * \retval EINVAL If a metric in the range has a different type
+ * \retval ENOMEM If the offset table cannot be allocated
+ */
+int ldms_metric_get_u64_range(ldms_set_t s, int first, int n, uint64_t *vals);
+int ldms_metric_get_s64_range(ldms_set_t s, int first, int n, int64_t *vals);
+int ldms_metric_get_u32_range(ldms_set_t s, int first, int n, uint32_t *vals);
+int ldms_metric_get_s32_range(ldms_set_t s, int first, int n, int32_t *vals);
+int ldms_metric_get_float_range(ldms_set_t s, int first, int n, float *vals);
+int ldms_metric_get_double_range(ldms_set_t s, int first, int n, double *vals);
+
 /**
  * \brief Set the value of an ldms_mval_t.
  *
@@ -0,0 +1,797 @@
+/* -*- c-basic-offset: 8 -*-
+ * Copyright (c) 2026 National Technology & Engineering Solutions
+ * of Sandia, LLC (NTESS). Under the terms of Contract DE-NA0003525 with
+ * NTESS, the U.S. Government retains certain rights in this software.
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file ldms_dir.c
+ *
+ * The directory generation log and the binary directory records.
+ *
+ * Every add, update and delete of a published set is assigned the next
+ * directory generation number (gn) and recorded in a ring. A peer that
+ * knows the directory as of generation N of this process (identified by
+ * the directory session) is sent only the net changes after N instead of
+ * the whole directory, and the directory update notifications are
+ * coalesced from the same log.
+ *
+ * The client side keeps the directory it has received in an
+ * ldms_dir_cache_t so that the full directory can still be handed to the
+ * application after only the changes went over the wire.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <endian.h>
+#include <pthread.h>
+#include <sys/queue.h>
+#include <asm/byteorder.h>
+
+#include "ovis_log/ovis_log.h"
+#include "ldms.h"
+#include "ldms_xprt.h"
+#include "ldms_private.h"
+
+#define LDMS_DIR_LOG_SIZE_DEFAULT 65536
+
+struct dir_log_ent {
+	uint64_t gn;
+	enum ldms_dir_type type;
+	uid_t uid;
+	gid_t gid;
+	uint32_t perm;
+	char *name;
+};
+
+static pthread_once_t dir_log_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t dir_log_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t dir_log_cond = PTHREAD_COND_INITIALIZER;
+static struct dir_log_ent *dir_log;
+static size_t dir_log_size;
+static uint64_t dir_session;
+static uint64_t dir_gn;
+
+static void __dir_log_init(void)
+{
+	struct timespec ts;
+	char *s = getenv("LDMS_DIR_LOG_SIZE");
+
+	dir_log_size = LDMS_DIR_LOG_SIZE_DEFAULT;
+	if (s && atol(s) > 0)
+		dir_log_size = atol(s);
+	dir_log = calloc(dir_log_size, sizeof(*dir_log));
+	if (!dir_log)
+		dir_log_size = 0; /* every peer gets the full directory */
+
+	/* Distinguishes the generation numbers of this process from the
+	 * ones of a previous incarnation of the daemon. */
+	(void)clock_gettime(CLOCK_REALTIME, &ts);
+	dir_session = ((uint64_t)ts.tv_sec << 32) ^ ts.tv_nsec ^
+		      ((uint64_t)getpid() << 16);
+	if (!dir_session)
+		dir_session = 1;
+}
+
+uint64_t __ldms_dir_session(void)
+{
+	pthread_once(&dir_log_once, __dir_log_init);
+	return dir_session;
+}
+
+uint64_t __ldms_dir_gn(void)
+{
+	uint64_t gn;
+	pthread_mutex_lock(&dir_log_lock);
+	gn = dir_gn;
+	pthread_mutex_unlock(&dir_log_lock);
+	return gn;
+}
+
+/* Wait for the directory generation to move past `gn` */
+uint64_t __ldms_dir_wait(uint64_t gn)
+{
+	pthread_mutex_lock(&dir_log_lock);
+	while (dir_gn <= gn)
+		pthread_cond_wait(&dir_log_cond, &dir_log_lock);
+	gn = dir_gn;
+	pthread_mutex_unlock(&dir_log_lock);
+	return gn;
+}
+
+/* NOTE: set->lock is held by the caller */
+void __ldms_dir_log(struct ldms_set *set, enum ldms_dir_type type)
+{
+	struct dir_log_ent *ent;
+	char *name;
+
+	pthread_once(&dir_log_once, __dir_log_init);
+	name = strdup(get_instance_name(set->meta)->name);
+	pthread_mutex_lock(&dir_log_lock);
+	dir_gn++;
+	if (dir_log_size) {
+		ent = &dir_log[dir_gn % dir_log_size];
+		free(ent->name);
+		ent->gn = dir_gn;
+		ent->type = type;
+		ent->uid = __le32_to_cpu(set->meta->uid);
+		ent->gid = __le32_to_cpu(set->meta->gid);
+		ent->perm = __le32_to_cpu(set->meta->perm);
+		ent->name = name;
+		if (!name) {
+			/* The window can no longer be reconstructed */
+			ent->gn = 0;
+		}
+	} else {
+		free(name);
+	}
+	pthread_cond_broadcast(&dir_log_cond);
+	pthread_mutex_unlock(&dir_log_lock);
+}
+
+static int change_cmp(void *a, const void *b)
+{
+	return strcmp(a, b);
+}
+
+static struct ldms_dir_change *change_new(const char *name)
+{
+	size_t len = strlen(name) + 1;
+	struct ldms_dir_change *c = calloc(1, sizeof(*c) + len);
+	if (!c)
+		return NULL;
+	memcpy(c->name, name, len);
+	rbn_init(&c->rbn, c->name);
+	return c;
+}
+
+void __ldms_dir_change_list_free(struct ldms_dir_change_list *list)
+{
+	struct ldms_dir_change *c;
+	while ((c = TAILQ_FIRST(list))) {
+		TAILQ_REMOVE(list, c, entry);
+		free(c->bin);
+		free(c->json);
+		free(c);
+	}
+}
+
+/*
+ * Collect the net change of every set changed after generation `since`.
+ *
+ * A set that was deleted last is a DEL, a set that was added in the
+ * window is an ADD, anything else is an UPD. The changes are listed in
+ * the order the sets first changed. Returns ESTALE if the log no longer
+ * covers the window.
+ */
+int __ldms_dir_changes(uint64_t since, uint64_t *gn,
+		       struct ldms_dir_change_list *list)
+{
+	struct rbt rbt;
+	struct rbn *rbn;
+	struct dir_log_ent *ent;
+	struct ldms_dir_change *c;
+	uint64_t i;
+	int rc = 0;
+
+	pthread_once(&dir_log_once, __dir_log_init);
+	rbt_init(&rbt, change_cmp);
+	pthread_mutex_lock(&dir_log_lock);
+	*gn = dir_gn;
+	if (since > dir_gn || dir_gn - since > dir_log_size) {
+		rc = ESTALE;
+		goto out;
+	}
+	for (i = since + 1; i <= dir_gn; i++) {
+		ent = &dir_log[i % dir_log_size];
+		if (ent->gn != i) {
+			rc = ESTALE;
+			goto out;
+		}
+		rbn = rbt_find(&rbt, ent->name);
+		if (rbn) {
+			c = container_of(rbn, struct ldms_dir_change, rbn);
+		} else {
+			c = change_new(ent->name);
+			if (!c) {
+				rc = ENOMEM;
+				goto out;
+			}
+			c->type = LDMS_DIR_UPD;
+			rbt_ins(&rbt, &c->rbn);
+			TAILQ_INSERT_TAIL(list, c, entry);
+		}
+		if (ent->type == LDMS_DIR_DEL)
+			c->type = LDMS_DIR_DEL;
+		else if (ent->type == LDMS_DIR_ADD || c->type == LDMS_DIR_ADD)
+			c->type = LDMS_DIR_ADD;
+		else if (c->type == LDMS_DIR_DEL)
+			/* deleted and recreated in the window */
+			c->type = LDMS_DIR_ADD;
+		c->gn = ent->gn;
+		c->uid = ent->uid;
+		c->gid = ent->gid;
+		c->perm = ent->perm;
+	}
+ out:
+	pthread_mutex_unlock(&dir_log_lock);
+	if (rc)
+		__ldms_dir_change_list_free(list);
+	return rc;
+}
+
+/* Every published set as an ADD, e.g. for a full directory */
+int __ldms_dir_all(struct ldms_dir_change_list *list)
+{
+	struct ldms_name_list name_list;
+	struct ldms_name_entry *name;
+	struct ldms_dir_change *c;
+	uint64_t gn = __ldms_dir_gn();
+	int rc;
+
+	__ldms_set_tree_lock();
+	rc = __ldms_get_local_set_list(&name_list);
+	__ldms_set_tree_unlock();
+	if (rc)
+		return rc;
+	LIST_FOREACH(name, &name_list, entry) {
+		c = change_new(name->name);
+		if (!c) {
+			rc = ENOMEM;
+			__ldms_dir_change_list_free(list);
+			break;
+		}
+		c->type = LDMS_DIR_ADD;
+		c->gn = gn;
+		TAILQ_INSERT_TAIL(list, c, entry);
+	}
+	__ldms_empty_name_list(&name_list);
+	return rc;
+}
+
+#define REC_HDR_SZ offsetof(struct ldms_dir_bin_rec, strs)
+#define REC_ALIGN(_sz_) (((_sz_) + 7) & ~(size_t)7)
+
+static size_t __rec_put_str(char *strs, size_t off, size_t cap, const char *s)
+{
+	size_t len = strlen(s) + 1;
+	if (off + len <= cap)
+		memcpy(&strs[off], s, len);
+	return off + len;
+}
+
+/*
+ * Format `set` as a binary directory record into `buf`. Returns the size
+ * of the record; nothing useful was written if it is larger than
+ * `buf_size`.
+ */
+size_t __ldms_dir_bin_format_set(struct ldms_set *set, enum ldms_dir_type type,
+				 void *buf, size_t buf_size)
+{
+	struct ldms_dir_bin_rec *rec = buf;
+	struct ldms_set_info_pair *info;
+	ldms_digest_t digest = ldms_set_digest_get(set);
+	size_t cap = buf_size > REC_HDR_SZ ? buf_size - REC_HDR_SZ : 0;
+	size_t off = 0, len;
+	int info_count = 0;
+	char state[4];
+
+	off = __rec_put_str(rec->strs, off, cap, get_instance_name(set->meta)->name);
+	len = off;
+	off = __rec_put_str(rec->strs, off, cap, get_schema_name(set->meta)->name);
+	if (off - len > UINT16_MAX || len > UINT16_MAX)
+		return SIZE_MAX;
+	LIST_FOREACH(info, &set->local_info, entry) {
+		off = __rec_put_str(rec->strs, off, cap, info->key);
+		off = __rec_put_str(rec->strs, off, cap, info->value);
+		info_count++;
+	}
+	LIST_FOREACH(info, &set->remote_info, entry) {
+		/* remote info that is not overridden by local info */
+		if (__ldms_set_info_find(&set->local_info, info->key))
+			continue;
+		off = __rec_put_str(rec->strs, off, cap, info->key);
+		off = __rec_put_str(rec->strs, off, cap, info->value);
+		info_count++;
+	}
+	len = REC_ALIGN(REC_HDR_SZ + off);
+	if (len > buf_size)
+		return len;
+
+	memset(&rec->strs[off], 0, len - REC_HDR_SZ - off);
+	rec->rec_len = htonl(len);
+	rec->type = type;
+	__ldms_format_set_state(set, state);
+	memcpy(rec->flags, state, sizeof(rec->flags));
+	rec->meta_sz = htonl(__le32_to_cpu(set->meta->meta_sz));
+	rec->data_sz = htonl(__le32_to_cpu(set->meta->data_sz));
+	rec->heap_sz = htonl(__le32_to_cpu(set->meta->heap_sz));
+	rec->uid = htonl(__le32_to_cpu(set->meta->uid));
+	rec->gid = htonl(__le32_to_cpu(set->meta->gid));
+	rec->perm = htonl(__le32_to_cpu(set->meta->perm));
+	rec->card = htonl(__le32_to_cpu(set->meta->card));
+	rec->array_card = htonl(__le32_to_cpu(set->meta->array_card));
+	rec->meta_gn = htobe64(__le64_to_cpu(set->meta->meta_gn));
+	rec->data_gn = htobe64(__le64_to_cpu(set->data->gn));
+	rec->timestamp.sec = htonl(__le32_to_cpu(set->data->trans.ts.sec));
+	rec->timestamp.usec = htonl(__le32_to_cpu(set->data->trans.ts.usec));
+	rec->duration.sec = htonl(__le32_to_cpu(set->data->trans.dur.sec));
+	rec->duration.usec = htonl(__le32_to_cpu(set->data->trans.dur.usec));
+	rec->name_len = htons(strlen(get_instance_name(set->meta)->name) + 1);
+	rec->schema_len = htons(strlen(get_schema_name(set->meta)->name) + 1);
+	rec->info_count = htons(info_count);
+	if (digest) {
+		rec->has_digest = htons(1);
+		memcpy(rec->digest, digest->digest, LDMS_DIGEST_LENGTH);
+	} else {
+		rec->has_digest = 0;
+		memset(rec->digest, 0, LDMS_DIGEST_LENGTH);
+	}
+	return len;
+}
+
+/* A DEL record only carries the name */
+static size_t __dir_bin_format_del(const char *name, void *buf, size_t buf_size)
+{
+	struct ldms_dir_bin_rec *rec = buf;
+	size_t name_len = strlen(name) + 1;
+	size_t len = REC_ALIGN(REC_HDR_SZ + name_len + 1);
+
+	if (len > buf_size)
+		return len;
+	memset(rec, 0, len);
+	rec->rec_len = htonl(len);
+	rec->type = LDMS_DIR_DEL;
+	memcpy(rec->flags, "   ", sizeof(rec->flags));
+	rec->name_len = htons(name_len);
+	rec->schema_len = htons(1);
+	memcpy(rec->strs, name, name_len);
+	return len;
+}
+
+static int __dir_change_format_bin(struct ldms_dir_change *c,
+				   struct ldms_set *set)
+{
+	size_t sz = 1024, len;
+	void *buf;
+
+ again:
+	buf = malloc(sz);
+	if (!buf)
+		return ENOMEM;
+	if (set)
+		len = __ldms_dir_bin_format_set(set, c->type, buf, sz);
+	else
+		len = __dir_bin_format_del(c->name, buf, sz);
+	if (len == SIZE_MAX) {
+		free(buf);
+		return E2BIG;
+	}
+	if (len > sz) {
+		free(buf);
+		sz = len;
+		goto again;
+	}
+	c->bin = buf;
+	c->bin_len = len;
+	return 0;
+}
+
+/*
+ * Format the binary (json == 0) or the JSON record of a change. The set
+ * attributes are taken from the set as it is now. A set that is gone is
+ * formatted as a DEL; there is no JSON record for a DEL (ENOENT).
+ */
+int __ldms_dir_change_format(struct ldms_dir_change *c, int json)
+{
+	struct ldms_set *set = NULL;
+	int rc = 0;
+
+	if ((json && c->json) || (!json && c->bin))
+		return 0;
+	if (c->type != LDMS_DIR_DEL) {
+		set = __ldms_find_local_set(c->name);
+	}
+	if (!set) {
+		if (json)
+			return ENOENT;
+		c->type = LDMS_DIR_DEL;
+		return __dir_change_format_bin(c, NULL);
+	}
+	pthread_mutex_lock(&set->lock);
+	c->uid = __le32_to_cpu(set->meta->uid);
+	c->gid = __le32_to_cpu(set->meta->gid);
+	c->perm = __le32_to_cpu(set->meta->perm);
+	if (json) {
+		c->json = __ldms_format_set_for_dir(set, &c->json_len);
+		if (!c->json)
+			rc = ENOMEM;
+	} else {
+		rc = __dir_change_format_bin(c, set);
+	}
+	pthread_mutex_unlock(&set->lock);
+	ref_put(&set->ref, "__ldms_find_local_set");
+	return rc;
+}
+
+static void __dset_free(ldms_dir_set_t dset)
+{
+	int j;
+	free(dset->inst_name);
+	free(dset->schema_name);
+	free(dset->flags);
+	free(dset->digest_str);
+	free(dset->perm);
+	if (dset->info) {
+		for (j = 0; j < dset->info_count; j++) {
+			free(dset->info[j].key);
+			free(dset->info[j].value);
+		}
+		free(dset->info);
+	}
+	memset(dset, 0, sizeof(*dset));
+}
+
+static const char *__rec_str(const char **s, const char *end)
+{
+	const char *str = *s;
+	size_t len = strnlen(str, end - str);
+	if (str + len >= end)
+		return NULL;
+	*s = str + len + 1;
+	return str;
+}
+
+static int __dir_bin_decode_rec(const struct ldms_dir_bin_rec *rec,
+				size_t rec_len, ldms_dir_set_t dset)
+{
+	const char *s = rec->strs;
+	const char *end = (const char *)rec + rec_len;
+	const char *name, *schema, *k, *v;
+	char buf[LDMS_DIGEST_STR_LENGTH];
+	struct ldms_digest_s digest;
+	int i, info_count = ntohs(rec->info_count);
+
+	name = __rec_str(&s, end);
+	schema = __rec_str(&s, end);
+	if (!name || !schema)
+		return EINVAL;
+	dset->inst_name = strdup(name);
+	dset->schema_name = strdup(schema);
+	if (ntohs(rec->has_digest)) {
+		memcpy(digest.digest, rec->digest, LDMS_DIGEST_LENGTH);
+		dset->digest_str = strdup(ldms_digest_str(&digest, buf, sizeof(buf)));
+	} else {
+		dset->digest_str = strdup("");
+	}
+	dset->flags = strndup(rec->flags, sizeof(rec->flags));
+	__ldms_format_perm(ntohl(rec->perm), buf);
+	dset->perm = strdup(buf);
+	if (!dset->inst_name || !dset->schema_name || !dset->digest_str ||
+	    !dset->flags || !dset->perm)
+		return ENOMEM;
+	dset->meta_size = ntohl(rec->meta_sz);
+	dset->data_size = ntohl(rec->data_sz);
+	dset->heap_size = ntohl(rec->heap_sz);
+	dset->uid = ntohl(rec->uid);
+	dset->gid = ntohl(rec->gid);
+	dset->card = ntohl(rec->card);
+	dset->array_card = ntohl(rec->array_card);
+	dset->meta_gn = be64toh(rec->meta_gn);
+	dset->data_gn = be64toh(rec->data_gn);
+	dset->timestamp.sec = ntohl(rec->timestamp.sec);
+	dset->timestamp.usec = ntohl(rec->timestamp.usec);
+	dset->duration.sec = ntohl(rec->duration.sec);
+	dset->duration.usec = ntohl(rec->duration.usec);
+	dset->info_count = 0;
+	dset->info = NULL;
+	if (!info_count)
+		return 0;
+	dset->info = calloc(info_count, sizeof(*dset->info));
+	if (!dset->info)
+		return ENOMEM;
+	for (i = 0; i < info_count; i++) {
+		k = __rec_str(&s, end);
+		v = k ? __rec_str(&s, end) : NULL;
+		if (!v)
+			return EINVAL;
+		dset->info[i].key = strdup(k);
+		dset->info[i].value = strdup(v);
+		dset->info_count++;
+		if (!dset->info[i].key || !dset->info[i].value)
+			return ENOMEM;
+	}
+	return 0;
+}
+
+/*
+ * Decode a binary directory message into a directory and the type of
+ * each of its records. The directory type is left to the caller.
+ */
+int __ldms_dir_bin_decode(const void *buf, size_t len,
+			  uint64_t *session, uint64_t *gn,
+			  ldms_dir_t *pdir, uint8_t **ptypes)
+{
+	const struct ldms_dir_bin_hdr *hdr = buf;
+	const struct ldms_dir_bin_rec *rec;
+	const char *end = (const char *)buf + len;
+	ldms_dir_t dir;
+	uint8_t *types;
+	size_t count, rec_len;
+	int i, rc;
+
+	if (len < sizeof(*hdr))
+		return EINVAL;
+	count = ntohl(hdr->rec_count);
+	if (count > len / REC_HDR_SZ)
+		return EINVAL;
+	*session = be64toh(hdr->session);
+	*gn = be64toh(hdr->gn);
+	dir = calloc(1, sizeof(*dir) + count * sizeof(struct ldms_dir_set_s));
+	types = malloc(count + 1);
+	if (!dir || !types) {
+		rc = ENOMEM;
+		goto err;
+	}
+	dir->set_count = 0;
+	rec = (const void *)hdr->recs;
+	for (i = 0; i < count; i++) {
+		if ((const char *)rec + REC_HDR_SZ > end) {
+			rc = EINVAL;
+			goto err;
+		}
+		rec_len = ntohl(rec->rec_len);
+		if (rec_len < REC_HDR_SZ || rec_len > end - (const char *)rec) {
+			rc = EINVAL;
+			goto err;
+		}
+		types[i] = rec->type;
+		dir->set_count++;
+		rc = __dir_bin_decode_rec(rec, rec_len, &dir->set_data[i]);
+		if (rc)
+			goto err;
+		rec = (const void *)((const char *)rec + rec_len);
+	}
+	*pdir = dir;
+	*ptypes = types;
+	return 0;
+ err:
+	ldms_xprt_dir_free(NULL, dir);
+	free(types);
+	return rc;
+}
+
+/*
+ * The directory of a peer as of the peer's directory generation `gn`.
+ */
+struct dir_cache_ent {
+	struct rbn rbn;
+	uint64_t epoch;
+	struct ldms_dir_set_s dset;
+};
+
+struct ldms_dir_cache_s {
+	pthread_mutex_t lock;
+	uint64_t session;	/* 0 if the cache is not usable for a delta */
+	uint64_t gn;
+	uint64_t epoch;		/* mark & sweep of a full directory */
+	struct rbt tree;	/* dir_cache_ent by instance name */
+};
+
+ldms_dir_cache_t ldms_dir_cache_new(void)
+{
+	ldms_dir_cache_t c = calloc(1, sizeof(*c));
+	if (!c)
+		return NULL;
+	pthread_mutex_init(&c->lock, NULL);
+	rbt_init(&c->tree, change_cmp);
+	return c;
+}
+
+static void __cache_ent_free(ldms_dir_cache_t c, struct dir_cache_ent *ent)
+{
+	rbt_del(&c->tree, &ent->rbn);
+	__dset_free(&ent->dset);
+	free(ent);
+}
+
+void ldms_dir_cache_free(ldms_dir_cache_t c)
+{
+	struct rbn *rbn;
+	if (!c)
+		return;
+	while ((rbn = rbt_min(&c->tree)))
+		__cache_ent_free(c, container_of(rbn, struct dir_cache_ent, rbn));
+	pthread_mutex_destroy(&c->lock);
+	free(c);
+}
+
+void __ldms_dir_cache_lock(ldms_dir_cache_t c)
+{
+	pthread_mutex_lock(&c->lock);
+}
+
+void __ldms_dir_cache_unlock(ldms_dir_cache_t c)
+{
+	pthread_mutex_unlock(&c->lock);
+}
+
+void __ldms_dir_cache_gn_get(ldms_dir_cache_t c, uint64_t *session, uint64_t *gn)
+{
+	pthread_mutex_lock(&c->lock);
+	*session = c->session;
+	*gn = c->gn;
+	pthread_mutex_unlock(&c->lock);
+}
+
+/* NOTE: c->lock is held by the caller */
+void __ldms_dir_cache_gn_set(ldms_dir_cache_t c, uint64_t session, uint64_t gn)
+{
+	c->session = session;
+	c->gn = gn;
+}
+
+/* Start a full directory; the entries it does not refresh are swept */
+void __ldms_dir_cache_mark(ldms_dir_cache_t c)
+{
+	c->epoch++;
+}
+
+void __ldms_dir_cache_sweep(ldms_dir_cache_t c)
+{
+	struct rbn *rbn, *next;
+	struct dir_cache_ent *ent;
+
+	for (rbn = rbt_min(&c->tree); rbn; rbn = next) {
+		next = rbn_succ(rbn);
+		ent = container_of(rbn, struct dir_cache_ent, rbn);
+		if (ent->epoch != c->epoch)
+			__cache_ent_free(c, ent);
+	}
+}
+
+static int __dset_copy(ldms_dir_set_t dst, ldms_dir_set_t src)
+{
+	int j;
+
+	*dst = *src;
+	dst->inst_name = strdup(src->inst_name);
+	dst->schema_name = strdup(src->schema_name);
+	dst->digest_str = strdup(src->digest_str);
+	dst->flags = strdup(src->flags);
+	dst->perm = strdup(src->perm);
+	dst->info = NULL;
+	dst->info_count = 0;
+	if (!dst->inst_name || !dst->schema_name || !dst->digest_str ||
+	    !dst->flags || !dst->perm)
+		goto err;
+	if (!src->info || !src->info_count)
+		return 0;
+	dst->info = calloc(src->info_count, sizeof(*dst->info));
+	if (!dst->info)
+		goto err;
+	for (j = 0; j < src->info_count; j++) {
+		dst->info[j].key = strdup(src->info[j].key);
+		dst->info[j].value = strdup(src->info[j].value);
+		dst->info_count++;
+		if (!dst->info[j].key || !dst->info[j].value)
+			goto err;
+	}
+	return 0;
+ err:
+	__dset_free(dst);
+	return ENOMEM;
+}
+
+/*
+ * Apply a directory record to the cache. `*found` tells if the set was
+ * in the cache before the record.
+ */
+int __ldms_dir_cache_apply(ldms_dir_cache_t c, ldms_dir_set_t dset,
+			   enum ldms_dir_type type, int *found)
+{
+	struct dir_cache_ent *ent = NULL;
+	struct rbn *rbn;
+	int rc;
+
+	rbn = rbt_find(&c->tree, dset->inst_name);
+	if (rbn)
+		ent = container_of(rbn, struct dir_cache_ent, rbn);
+	*found = (ent != NULL);
+	if (type == LDMS_DIR_DEL) {
+		if (ent)
+			__cache_ent_free(c, ent);
+		return 0;
+	}
+	if (ent) {
+		rbt_del(&c->tree, &ent->rbn);
+		__dset_free(&ent->dset);
+	} else {
+		ent = calloc(1, sizeof(*ent));
+		if (!ent)
+			goto enomem;
+	}
+	rc = __dset_copy(&ent->dset, dset);
+	if (rc) {
+		free(ent);
+		goto enomem;
+	}
+	ent->epoch = c->epoch;
+	rbn_init(&ent->rbn, ent->dset.inst_name);
+	rbt_ins(&c->tree, &ent->rbn);
+	return 0;
+ enomem:
+	/* The cache no longer reflects the peer directory */
+	c->session = 0;
+	return ENOMEM;
+}
+
+/* The cached directory as an LDMS_DIR_LIST; NOTE: c->lock is held */
+ldms_dir_t __ldms_dir_cache_list(ldms_dir_cache_t c)
+{
+	size_t count = rbt_card(&c->tree);
+	struct dir_cache_ent *ent;
+	struct rbn *rbn;
+	ldms_dir_t dir;
+
+	dir = calloc(1, sizeof(*dir) + count * sizeof(struct ldms_dir_set_s));
+	if (!dir)
+		return NULL;
+	dir->type = LDMS_DIR_LIST;
+	dir->more = 0;
+	dir->set_count = 0;
+	RBT_FOREACH(rbn, &c->tree) {
+		ent = container_of(rbn, struct dir_cache_ent, rbn);
+		if (__dset_copy(&dir->set_data[dir->set_count], &ent->dset)) {
+			ldms_xprt_dir_free(NULL, dir);
+			return NULL;
+		}
+		dir->set_count++;
+	}
+	return dir;
+}
@@ -131,7 +131,8 @@ struct ldms_set {
 	struct ldms_set_info_list local_info;
 	struct ldms_set_info_list remote_info; /*set info from the lookup operation */
 	struct rbn rb_node;	/* Indexed by instance name */
-	struct rbn id_node;	/* Indexed by set_id */
+	struct rbn name_node;	/* Name index shard, hashed by instance name */
+	struct rbn id_node;	/* Id index shard, hashed by set_id */
 	struct rbn del_node;	/* Indexed by timestamp */
 	pthread_mutex_t lock;
 	int curr_idx;
@@ -158,6 +159,38 @@ struct ldms_set {
 	 * The field is NULL when no update is in progress.
 	 */
 	struct ldms_op_ctxt *curr_updt_ctxt;
+
+	/*
+	 * Metric name index shared by all sets with the same schema digest.
+	 * It is resolved on the first ldms_metric_by_name() and released
+	 * when the set is destroyed.
+	 */
+	struct ldms_name_idx *name_idx;
+
+	/*
+	 * Metric value offset table shared by all sets with the same schema
+	 * digest (see __set_val_tbl()). It is resolved on the first range
+	 * accessor call and released when the set is destroyed.
+	 */
+	struct ldms_val_tbl *val_tbl;
+
+	/*
+	 * Metric descriptors shared by all remote sets with the same schema
+	 * digest (see __ldms_set_meta_share()). When set, the set memory
+	 * omits the descriptor range [desc_off, desc_off + desc_len) of the
+	 * wire image and the meta-attribute values start at desc_off.
+	 */
+	struct ldms_meta_shr *meta_shr;
+	uint32_t desc_off;
+	uint32_t desc_len;
+	struct ldms_set_hdr *land; /* meta-data landing buffer for updates */
+	zap_map_t land_map;
+	struct ldms_set_hdr *xmeta; /* wire image exported to peers */
+	zap_map_t xmap;
+	/* The compact meta-data and the shared descriptors of a set that
+	 * stopped sharing them, released when the set is destroyed. */
+	struct ldms_set_hdr *meta_retired;
+	struct ldms_meta_shr *shr_retired;
 };
 
 /* Convenience macro to roundup a value to a multiple of the _s parameter */
@@ -168,7 +201,8 @@ extern int __ldms_remote_lookup(ldms_t _x, const char *path,
 				enum ldms_lookup_flags flags,
 				ldms_lookup_cb_t cb, void *cb_arg,
 				struct ldms_op_ctxt *op_ctxt);
-extern int __ldms_remote_dir(ldms_t x, ldms_dir_cb_t cb, void *cb_arg, uint32_t flags);
+extern int __ldms_remote_dir(ldms_t x, ldms_dir_cb_t cb, void *cb_arg,
+			     uint32_t flags, ldms_dir_cache_t cache);
 extern int __ldms_remote_dir_cancel(ldms_t x);
 extern struct ldms_set *
 __ldms_create_set(const char *instance_name, const char *schema_name,
@@ -200,7 +234,70 @@ extern size_t __ldms_format_set_meta_as_json(struct ldms_set *set,
 					     char *buf, size_t buf_size);
 extern int __ldms_for_all_sets(int (*cb)(struct ldms_set *, void *), void *arg);
 
+/*
+ * Directory generation log (ldms_dir.c). Every add, update and delete of
+ * a published set bumps the directory generation number and is logged so
+ * that peers can be sent only the changes since a generation they have.
+ */
+struct ldms_dir_change {
+	struct rbn rbn;
+	TAILQ_ENTRY(ldms_dir_change) entry;
+	enum ldms_dir_type type;	/* net change in the window */
+	uint64_t gn;			/* generation of the last change */
+	uid_t uid;
+	gid_t gid;
+	uint32_t perm;
+	void *bin;			/* binary record */
+	size_t bin_len;
+	char *json;			/* JSON record */
+	size_t json_len;
+	char name[OVIS_FLEX];
+};
+TAILQ_HEAD(ldms_dir_change_list, ldms_dir_change);
+
+extern void __ldms_dir_log(struct ldms_set *set, enum ldms_dir_type type);
+extern uint64_t __ldms_dir_session(void);
+extern uint64_t __ldms_dir_gn(void);
+extern uint64_t __ldms_dir_wait(uint64_t gn);
+extern int __ldms_dir_changes(uint64_t since, uint64_t *gn,
+			      struct ldms_dir_change_list *list);
+extern int __ldms_dir_all(struct ldms_dir_change_list *list);
+extern int __ldms_dir_change_format(struct ldms_dir_change *c, int json);
+extern void __ldms_dir_change_list_free(struct ldms_dir_change_list *list);
+/* NOTE: set->lock must be held */
+extern size_t __ldms_dir_bin_format_set(struct ldms_set *set,
+					enum ldms_dir_type type,
+					void *buf, size_t buf_size);
+extern int __ldms_dir_bin_decode(const void *buf, size_t len,
+				 uint64_t *session, uint64_t *gn,
+				 ldms_dir_t *pdir, uint8_t **ptypes);
+extern char *__ldms_format_set_for_dir(struct ldms_set *set, size_t *buf_sz);
+extern void __ldms_format_perm(uint32_t perm, char *buf);
+extern void __ldms_format_set_state(struct ldms_set *set, char *state);
+
+/* The directory cache of a peer (ldms_dir_cache_t) */
+extern void __ldms_dir_cache_lock(ldms_dir_cache_t c);
+extern void __ldms_dir_cache_unlock(ldms_dir_cache_t c);
+extern void __ldms_dir_cache_gn_get(ldms_dir_cache_t c, uint64_t *session, uint64_t *gn);
+extern void __ldms_dir_cache_gn_set(ldms_dir_cache_t c, uint64_t session, uint64_t gn);
+extern void __ldms_dir_cache_mark(ldms_dir_cache_t c);
+extern void __ldms_dir_cache_sweep(ldms_dir_cache_t c);
+extern int __ldms_dir_cache_apply(ldms_dir_cache_t c, ldms_dir_set_t dset,
+				  enum ldms_dir_type type, int *found);
+extern ldms_dir_t __ldms_dir_cache_list(ldms_dir_cache_t c);
+
 extern uint32_t __ldms_set_size_get(struct ldms_set *s);
+extern uint32_t __ldms_set_wire_size_get(struct ldms_set *s);
+extern int __ldms_set_meta_share(struct ldms_set *s);
+extern int __ldms_set_meta_land_get(struct ldms_set *s);
+extern int __ldms_set_meta_land_apply(struct ldms_set *s);
+extern void __ldms_set_meta_land_put(struct ldms_set *s);
+extern int __ldms_set_wire_read(struct ldms_set *s, size_t off,
+				void *buf, size_t len);
+extern void __ldms_set_wire_write(struct ldms_set *s, size_t off,
+				  const void *buf, size_t len);
+extern zap_map_t __ldms_set_export_map(struct ldms_set *s);
+extern void __ldms_set_export_sync(struct ldms_set *s);
 extern void __ldms_metric_size_get(const char *name, const char *unit,
 				   enum ldms_value_type t,
 				   uint32_t count, size_t *meta_sz, size_t *data_sz);
@@ -210,6 +307,8 @@ extern struct ldms_set *__ldms_local_set_first(void);
 extern struct ldms_set *__ldms_local_set_next(struct ldms_set *);
 
 extern int __ldms_remote_update(ldms_t t, ldms_set_t s, ldms_update_cb_t cb, void *arg);
+extern int __ldms_remote_update_batch(ldms_t t, struct ldms_update_batch_ent_s *ents,
+				      int count, ldms_update_cb_t cb);
 extern void __ldms_set_tree_lock();
 extern void __ldms_set_tree_unlock();
 
@@ -231,6 +330,18 @@ struct ldms_data_hdr *__ldms_set_array_get(struct ldms_set *s, int idx)
 	return __set_array_get(s, idx);
 }
 
+/*
+ * A set looked up from a peer is in the set index before its meta-data is
+ * read and, if it is shared, replaced (see __ldms_set_meta_share()). The
+ * readers that reach a set through the index skip it until it is published.
+ */
+static inline
+int __ldms_set_published(struct ldms_set *s)
+{
+	return !!(__atomic_load_n(&s->flags, __ATOMIC_ACQUIRE) &
+		  LDMS_SET_F_PUBLISHED);
+}
+
 struct ldms_context *__ldms_alloc_ctxt(struct ldms_xprt *x, size_t sz, ldms_context_type_t type, ...);
 void __ldms_free_ctxt(struct ldms_xprt *x, struct ldms_context *ctxt);
 
@@ -92,7 +92,8 @@ static void __rail_close(ldms_t _r);
 static int __rail_send(ldms_t _r, char *msg_buf, size_t msg_len,
 				  struct ldms_op_ctxt *op_ctxt);
 static size_t __rail_msg_max(ldms_t x);
-static int __rail_dir(ldms_t _r, ldms_dir_cb_t cb, void *cb_arg, uint32_t flags);
+static int __rail_dir(ldms_t _r, ldms_dir_cb_t cb, void *cb_arg, uint32_t flags,
+		      ldms_dir_cache_t cache);
 static int __rail_dir_cancel(ldms_t _r);
 static int __rail_lookup(ldms_t _r, const char *name, enum ldms_lookup_flags flags,
 	       ldms_lookup_cb_t cb, void *cb_arg, struct ldms_op_ctxt *op_ctxt);
@@ -110,6 +111,8 @@ static void __rail_priority_set(ldms_t _r, int prio);
 static void __rail_cred_get(ldms_t _r, ldms_cred_t lcl, ldms_cred_t rmt);
 static int __rail_update(ldms_t _r, struct ldms_set *set, ldms_update_cb_t cb, void *arg,
                                                            struct ldms_op_ctxt *op_ctxt);
+static int __rail_update_batch(ldms_t _r, struct ldms_update_batch_ent_s *ents,
+			       int count, ldms_update_cb_t cb);
 static int __rail_get_threads(ldms_t _r, pthread_t *out, int n);
 static ldms_set_t __rail_set_by_name(ldms_t x, const char *set_name);
 
@@ -138,6 +141,7 @@ static struct ldms_xprt_ops_s __rail_ops = {
 	.cred_get     = __rail_cred_get,
 
 	.update       = __rail_update,
+	.update_batch = __rail_update_batch,
 	.get_threads  = __rail_get_threads,
 	.get_zap_ep   = __rail_get_zap_ep,
 
@@ -1188,7 +1192,8 @@ void __rail_dir_cb(ldms_t x, int status, ldms_dir_t dir, void *cb_arg)
 		free(dc);
 }
 
-static int __rail_dir(ldms_t _r, ldms_dir_cb_t cb, void *cb_arg, uint32_t flags)
+static int __rail_dir(ldms_t _r, ldms_dir_cb_t cb, void *cb_arg, uint32_t flags,
+		      ldms_dir_cache_t cache)
 {
 	ldms_rail_t r = (ldms_rail_t)_r;
 	ldms_rail_dir_ctxt_t dc = calloc(1, sizeof(*dc));
@@ -1204,7 +1209,7 @@ static int __rail_dir(ldms_t _r, ldms_dir_cb_t cb, void *cb_arg, uint32_t flags)
 		TAILQ_INSERT_TAIL(&r->dir_notify_tq, dc, tqe);
 		pthread_mutex_unlock(&r->mutex);
 	}
-	rc = ldms_xprt_dir(r->eps[0].ep, __rail_dir_cb, dc, flags);
+	rc = ldms_xprt_dir_cached(r->eps[0].ep, __rail_dir_cb, dc, flags, cache);
 	if (rc) {
 		/* synchronous error, clean up the context */
 		free(dc);
@@ -1431,13 +1436,32 @@ static void __rail_cred_get(ldms_t _r, ldms_cred_t lcl, ldms_cred_t rmt)
 	ldms_xprt_cred_get(r->eps[0].ep, lcl, rmt);
 }
 
+typedef struct ldms_rail_update_batch_s *ldms_rail_update_batch_t;
+
 typedef
 struct ldms_rail_update_ctxt_s {
 	ldms_rail_t r;
 	ldms_update_cb_t app_cb;
 	void *cb_arg;
+	ldms_rail_update_batch_t batch; /* NULL if not part of a batch */
 } *ldms_rail_update_ctxt_t;
 
+/*
+ * The update contexts of all sets in an ldms_xprt_update_batch() call are
+ * allocated in one block. The block is freed when the last set of the batch
+ * completes its update.
+ */
+struct ldms_rail_update_batch_s {
+	int ref; /* outstanding updates + 1 for __rail_update_batch() */
+	struct ldms_rail_update_ctxt_s uc[OVIS_FLEX];
+};
+
+static void __rail_update_batch_put(ldms_rail_update_batch_t b)
+{
+	if (0 == __atomic_sub_fetch(&b->ref, 1, __ATOMIC_SEQ_CST))
+		free(b);
+}
+
 void __rail_update_cb(ldms_t x, ldms_set_t s, int flags, void *arg)
 {
 	struct ldms_rail_ep_s *rep = ldms_xprt_ctxt_get(x);
@@ -1450,7 +1474,10 @@ void __rail_update_cb(ldms_t x, ldms_set_t s, int flags, void *arg)
 	}
 	uc->app_cb((ldms_t)rep->rail, s, flags, uc->cb_arg);
 	if (!(flags & LDMS_UPD_F_MORE)) {
-		free(uc);
+		if (uc->batch)
+			__rail_update_batch_put(uc->batch);
+		else
+			free(uc);
 	}
 }
 
@@ -1486,6 +1513,69 @@ static int __rail_update(ldms_t _r, struct ldms_set *set, ldms_update_cb_t cb,
 	return rc;
 }
 
+static int __rail_update_batch(ldms_t _r, struct ldms_update_batch_ent_s *ents,
+			       int count, ldms_update_cb_t cb)
+{
+	ldms_rail_t r = (void*)_r;
+	ldms_rail_update_batch_t b;
+	struct ldms_update_batch_ent_s *ep_ents;
+	int *ep_idx;
+	ldms_t ep;
+	int i, j, n, rc = 0;
+
+	/* The per-endpoint scratch arrays are carved from the same block */
+	b = malloc(sizeof(*b) + count * (sizeof(b->uc[0]) +
+				sizeof(*ep_ents) + sizeof(*ep_idx)));
+	if (!b) {
+		rc = errno;
+		for (i = 0; i < count; i++)
+			ents[i].rc = rc;
+		return rc;
+	}
+	b->ref = count + 1;
+	ep_ents = (void*)&b->uc[count];
+	ep_idx = (void*)&ep_ents[count];
+	for (i = 0; i < count; i++) {
+		b->uc[i].r = r;
+		b->uc[i].app_cb = cb;
+		b->uc[i].cb_arg = ents[i].cb_arg;
+		b->uc[i].batch = b;
+		/* Until the set is issued on one of the rail endpoints */
+		ents[i].rc = EINVAL;
+	}
+
+	for (j = 0; j < r->n_eps; j++) {
+		ep = r->eps[j].ep;
+		if (!ep)
+			continue;
+		n = 0;
+		for (i = 0; i < count; i++) {
+			if (ents[i].set->xprt != ep)
+				continue;
+			ep_ents[n].set = ents[i].set;
+			ep_ents[n].cb_arg = &b->uc[i];
+			ep_idx[n] = i;
+			n++;
+		}
+		if (!n)
+			continue;
+		ep->ops.update_batch(ep, ep_ents, n, __rail_update_cb);
+		for (i = 0; i < n; i++)
+			ents[ep_idx[i]].rc = ep_ents[i].rc;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (!ents[i].rc)
+			continue;
+		/* synchronous error, no completion will come for this set */
+		if (!rc)
+			rc = ents[i].rc;
+		__rail_update_batch_put(b);
+	}
+	__rail_update_batch_put(b);
+	return rc;
+}
+
 static int __rail_get_threads(ldms_t _r, pthread_t *out, int n)
 {
 	ldms_rail_t r = (void*)_r;
@@ -1820,9 +1910,7 @@ static ldms_set_t __rail_set_by_name(ldms_t _x, const char *set_name)
 
 	assert(XTYPE_IS_RAIL(r->xtype));
 
-	__ldms_set_tree_lock();
 	set = __ldms_find_local_set(set_name);
-	__ldms_set_tree_unlock();
 	if (!set)
 		return NULL;
 	for (i = 0; i < r->n_eps; i++) {
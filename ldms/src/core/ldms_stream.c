@@ -413,15 +413,446 @@ __remote_client_cb(ldms_stream_event_t ev, void *cb_arg)
 	return rc;
 }
 
+/*
+ * Stream name matcher for regex clients.
+ *
+ * When a new stream name appears, every regex client has to be checked
+ * against it. Instead of calling regexec() for every client, each regex is
+ * analyzed once at subscribe time for a literal that any matching name must
+ * contain:
+ *
+ *   - `^lit...` : `lit` must be a prefix of the name. These clients are kept
+ *                 in the prefix trie `__smatch_prefix`.
+ *   - `...lit...`: `lit` must occur in the name. These clients are kept in
+ *                 `__smatch_ac`, an Aho-Corasick automaton over the literals.
+ *   - otherwise (alternation, no literal): `__smatch_residual_tq`.
+ *
+ * A single pass over the name walks the prefix trie and the automaton and
+ * yields the candidate clients (plus the residual ones); only those are
+ * confirmed with regexec(). The literal is a necessary condition, so the
+ * set of clients bound to a stream is exactly the same as with a regexec()
+ * of every client.
+ *
+ * The nodes are added as clients subscribe. The failure links of the
+ * automaton are recomputed lazily (`__smatch_ac_dirty`) before the next
+ * match. All of the matcher state is protected by __stream_rwlock (write).
+ */
+struct __smatch_child {
+	unsigned char ch;
+	struct __smatch_node *node;
+};
+
+struct __smatch_node {
+	struct __smatch_node *parent;
+	struct __smatch_node *fail; /* Aho-Corasick failure link */
+	struct __smatch_node *out;  /* nearest node on the fail chain with clients */
+	unsigned char ch;           /* edge label from parent */
+	int n_child, a_child;
+	struct __smatch_child *child; /* sorted by ch */
+	TAILQ_HEAD(, ldms_stream_client_s) client_tq;
+};
+
+static struct __smatch_node __smatch_prefix = {
+	.client_tq = TAILQ_HEAD_INITIALIZER(__smatch_prefix.client_tq),
+};
+static struct __smatch_node __smatch_ac = {
+	.client_tq = TAILQ_HEAD_INITIALIZER(__smatch_ac.client_tq),
+};
+static int __smatch_ac_n_nodes = 1;
+static int __smatch_ac_dirty = 0;
+static uint64_t __smatch_gn = 0;
+static TAILQ_HEAD(, ldms_stream_client_s)
+	__smatch_residual_tq = TAILQ_HEAD_INITIALIZER(__smatch_residual_tq);
+
+static const char *__smatch_meta = ".[]()*+?{}|^$\\";
+
+/*
+ * Determine a literal that the names matching the extended regular
+ * expression `re` must contain. The literal is written into `lit` (which
+ * must be as large as `re`). Returns the length of the literal, or 0 if no
+ * literal can be safely determined. `*anchored` is set if the literal must
+ * be a prefix of the name.
+ *
+ * The analysis is conservative: anything it does not fully understand
+ * ends the current literal run or stops the scan.
+ */
+static int __smatch_re_literal(const char *re, char *lit, int *anchored)
+{
+	const char *p = re;
+	char *run = lit + strlen(re) + 1; /* scratch, see __client_alloc() */
+	int run_len = 0, best_len = 0, prefix_len = 0;
+	int is_prefix = 0, opt;
+	char c;
+
+	*anchored = 0;
+	if (strchr(re, '|'))
+		return 0; /* alternation; no literal is required */
+	if (*p == '^') {
+		is_prefix = 1;
+		p++;
+	}
+
+#define __END_RUN() do { \
+		if (is_prefix) { \
+			prefix_len = run_len; \
+			memcpy(lit, run, run_len); \
+			is_prefix = 0; \
+		} else if (!prefix_len && run_len > best_len) { \
+			best_len = run_len; \
+			memcpy(lit, run, run_len); \
+		} \
+		run_len = 0; \
+	} while (0)
+
+	while ((c = *p)) {
+		switch (c) {
+		case '\\':
+			if (!p[1])
+				return 0;
+			if (strchr(__smatch_meta, p[1])) {
+				run[run_len++] = p[1];
+			} else {
+				/* GNU escapes (\w, \b, \1, ...) */
+				__END_RUN();
+			}
+			p += 2;
+			continue;
+		case '*':
+		case '?':
+		case '{':
+		case '+':
+			/*
+			 * The previous atom may repeat. It is optional unless
+			 * all of the (stacked) quantifiers are '+'.
+			 */
+			for (opt = 0; *p && strchr("*?{+", *p); p++) {
+				if (*p != '+')
+					opt = 1;
+				if (*p == '{')
+					break;
+			}
+			if (opt && run_len)
+				run_len--;
+			__END_RUN();
+			if (*p == '{')
+				goto out;
+			continue;
+		case '[':
+			__END_RUN();
+			/* skip the bracket expression */
+			p++;
+			if (*p == '^')
+				p++;
+			if (*p == ']')
+				p++;
+			while (*p && *p != ']') {
+				if (*p == '[' && (p[1] == ':' || p[1] == '=' || p[1] == '.')) {
+					char t = p[1];
+					p += 2;
+					while (*p && !(p[0] == t && p[1] == ']'))
+						p++;
+					if (!*p)
+						goto out;
+					p++;
+				}
+				p++;
+			}
+			if (!*p)
+				goto out;
+			break;
+		case '(':
+			__END_RUN();
+			goto out;
+		case '.':
+		case ')':
+		case '^':
+		case '$':
+			__END_RUN();
+			break;
+		default:
+			run[run_len++] = c;
+			break;
+		}
+		p++;
+	}
+ out:
+	__END_RUN();
+#undef __END_RUN
+	if (prefix_len) {
+		*anchored = 1;
+		return prefix_len;
+	}
+	return best_len;
+}
+
+static struct __smatch_node *
+__smatch_child_find(struct __smatch_node *n, unsigned char ch)
+{
+	int lo = 0, hi = n->n_child - 1, mid;
+	while (lo <= hi) {
+		mid = (lo + hi) / 2;
+		if (n->child[mid].ch == ch)
+			return n->child[mid].node;
+		if (n->child[mid].ch < ch)
+			lo = mid + 1;
+		else
+			hi = mid - 1;
+	}
+	return NULL;
+}
+
+static struct __smatch_node *
+__smatch_child_add(struct __smatch_node *n, unsigned char ch)
+{
+	struct __smatch_node *c;
+	struct __smatch_child *child;
+	int i;
+
+	if (n->n_child == n->a_child) {
+		child = realloc(n->child, (n->a_child + 4) * sizeof(*child));
+		if (!child)
+			return NULL;
+		n->child = child;
+		n->a_child += 4;
+	}
+	c = calloc(1, sizeof(*c));
+	if (!c)
+		return NULL;
+	c->parent = n;
+	c->ch = ch;
+	TAILQ_INIT(&c->client_tq);
+	for (i = n->n_child; i > 0 && n->child[i-1].ch > ch; i--)
+		n->child[i] = n->child[i-1];
+	n->child[i].ch = ch;
+	n->child[i].node = c;
+	n->n_child++;
+	return c;
+}
+
+/*
+ * Remove the node `n` if it is a leaf with no clients, and so on upward.
+ * Returns the number of nodes removed.
+ */
+static int __smatch_node_prune(struct __smatch_node *n)
+{
+	struct __smatch_node *p;
+	int i, count = 0;
+
+	while ((p = n->parent) && !n->n_child && TAILQ_EMPTY(&n->client_tq)) {
+		for (i = 0; i < p->n_child && p->child[i].node != n; i++)
+			;
+		assert(i < p->n_child);
+		memmove(&p->child[i], &p->child[i+1],
+			(p->n_child - i - 1) * sizeof(p->child[0]));
+		p->n_child--;
+		free(n->child);
+		free(n);
+		count++;
+		n = p;
+	}
+	return count;
+}
+
+/* Caller must hold __stream_rwlock (write) */
+static int __smatch_add(struct ldms_stream_client_s *c)
+{
+	struct __smatch_node *n, *cn;
+	int i, count;
+
+	if (!c->lit_len) {
+		TAILQ_INSERT_TAIL(&__smatch_residual_tq, c, smatch_entry);
+		c->smatch_node = NULL;
+		return 0;
+	}
+	n = c->lit_anchored ? &__smatch_prefix : &__smatch_ac;
+	for (i = 0; i < c->lit_len; i++) {
+		cn = __smatch_child_find(n, c->lit[i]);
+		if (!cn) {
+			cn = __smatch_child_add(n, c->lit[i]);
+			if (!cn) {
+				count = __smatch_node_prune(n);
+				if (!c->lit_anchored)
+					__smatch_ac_n_nodes -= count;
+				return ENOMEM;
+			}
+			if (!c->lit_anchored)
+				__smatch_ac_n_nodes++;
+		}
+		n = cn;
+	}
+	TAILQ_INSERT_TAIL(&n->client_tq, c, smatch_entry);
+	c->smatch_node = n;
+	if (!c->lit_anchored)
+		__smatch_ac_dirty = 1;
+	return 0;
+}
+
+/* Caller must hold __stream_rwlock (write) */
+static void __smatch_del(struct ldms_stream_client_s *c)
+{
+	struct __smatch_node *n = c->smatch_node;
+	int count;
+
+	if (!n) {
+		TAILQ_REMOVE(&__smatch_residual_tq, c, smatch_entry);
+		return;
+	}
+	TAILQ_REMOVE(&n->client_tq, c, smatch_entry);
+	c->smatch_node = NULL;
+	count = __smatch_node_prune(n);
+	if (!c->lit_anchored) {
+		__smatch_ac_n_nodes -= count;
+		__smatch_ac_dirty = 1;
+	}
+}
+
+/* Recompute the failure and output links of the automaton (BFS). */
+static int __smatch_ac_build(void)
+{
+	struct __smatch_node **q, *u, *v, *f;
+	int head = 0, tail = 0, i;
+
+	q = malloc(__smatch_ac_n_nodes * sizeof(*q));
+	if (!q)
+		return ENOMEM;
+	__smatch_ac.fail = NULL;
+	__smatch_ac.out = NULL;
+	q[tail++] = &__smatch_ac;
+	while (head < tail) {
+		u = q[head++];
+		for (i = 0; i < u->n_child; i++) {
+			v = u->child[i].node;
+			if (u == &__smatch_ac) {
+				v->fail = &__smatch_ac;
+			} else {
+				f = u->fail;
+				while (f && !__smatch_child_find(f, v->ch))
+					f = f->fail;
+				v->fail = f ? __smatch_child_find(f, v->ch)
+					    : &__smatch_ac;
+			}
+			v->out = TAILQ_EMPTY(&v->fail->client_tq) ?
+					v->fail->out : v->fail;
+			assert(tail < __smatch_ac_n_nodes);
+			q[tail++] = v;
+		}
+	}
+	free(q);
+	__smatch_ac_dirty = 0;
+	return 0;
+}
+
+typedef int (*__smatch_cb_t)(struct ldms_stream_client_s *c, void *arg);
+
+static int __smatch_visit(struct __smatch_node *n, __smatch_cb_t cb, void *arg)
+{
+	struct ldms_stream_client_s *c;
+	int rc;
+	TAILQ_FOREACH(c, &n->client_tq, smatch_entry) {
+		if (c->smatch_gn == __smatch_gn)
+			continue; /* literal found again */
+		c->smatch_gn = __smatch_gn;
+		rc = cb(c, arg);
+		if (rc)
+			return rc;
+	}
+	return 0;
+}
+
+/*
+ * Call `cb()` for each regex client that may match `name`, each client at
+ * most once. Caller must hold __stream_rwlock (write).
+ */
+static int __smatch_foreach(const char *name, __smatch_cb_t cb, void *arg)
+{
+	struct ldms_stream_client_s *c;
+	struct __smatch_node *n, *t;
+	const unsigned char *p;
+	int rc;
+
+	__smatch_gn++;
+
+	/* anchored literals */
+	n = &__smatch_prefix;
+	for (p = (const unsigned char *)name; *p; p++) {
+		n = __smatch_child_find(n, *p);
+		if (!n)
+			break;
+		rc = __smatch_visit(n, cb, arg);
+		if (rc)
+			return rc;
+	}
+
+	/* unanchored literals */
+	if (__smatch_ac_dirty && __smatch_ac_build()) {
+		/* out of memory; check every client not visited yet */
+		TAILQ_FOREACH(c, &__regex_client_tq, entry) {
+			if (c->smatch_gn == __smatch_gn)
+				continue;
+			c->smatch_gn = __smatch_gn;
+			rc = cb(c, arg);
+			if (rc)
+				return rc;
+		}
+		return 0;
+	}
+	n = &__smatch_ac;
+	for (p = (const unsigned char *)name; *p && __smatch_ac.n_child; p++) {
+		while (n != &__smatch_ac && !__smatch_child_find(n, *p))
+			n = n->fail;
+		t = __smatch_child_find(n, *p);
+		if (!t)
+			continue;
+		n = t;
+		if (TAILQ_EMPTY(&t->client_tq))
+			t = t->out;
+		for (; t; t = t->out) {
+			rc = __smatch_visit(t, cb, arg);
+			if (rc)
+				return rc;
+		}
+	}
+
+	TAILQ_FOREACH(c, &__smatch_residual_tq, smatch_entry) {
+		rc = cb(c, arg);
+		if (rc)
+			return rc;
+	}
+	return 0;
+}
+
+/* Quick check of the regex literal of the client against `name` */
+static inline int __smatch_lit_check(struct ldms_stream_client_s *c,
+				     const char *name)
+{
+	if (!c->lit_len)
+		return 1;
+	if (c->lit_anchored)
+		return 0 == strncmp(name, c->lit, c->lit_len);
+	return NULL != strstr(name, c->lit);
+}
+
 static int
 __client_stream_bind(ldms_stream_client_t c, struct ldms_stream_s *s);
 
+static int __stream_regex_bind_cb(struct ldms_stream_client_s *c, void *arg)
+{
+	struct ldms_stream_s *s = arg;
+	if (regexec(&c->regex, s->name, 0, NULL, 0))
+		return 0; /* does not match */
+	/* matched; add the client into the stream client list */
+	return __client_stream_bind(c, s);
+}
+
 /* must NOT hold __stream_rwlock */
 static struct ldms_stream_s *
 __stream_get(const char *stream_name, int *is_new)
 {
 	struct ldms_stream_s *s;
+	struct ldms_stream_client_entry_s *sce;
+	struct ldms_stream_client_s *c;
 	int name_len = strlen(stream_name) + 1;
+	int rc;
 	__STREAM_RDLOCK();
 	s = (void*)rbt_find(&__stream_rbt, stream_name);
 	__STREAM_UNLOCK();
@@ -443,26 +874,19 @@ __stream_get(const char *stream_name, int *is_new)
 	s->name_len = name_len;
 	memcpy(s->name, stream_name, name_len);
 	rbt_ins(&__stream_rbt, &s->rbn);
-	if (is_new)
-		*is_new = 1;
 
 	rbt_init(&s->src_stats_rbt, __ldms_addr_rbn_cmp);
 	s->rx.first_ts = __TIMESPEC_MAX;
 	s->rx.last_ts  = __TIMESPEC_MIN;
 
 	/* We need to go through the _regex_ clients to see if we match
-	 * any. */
-	struct ldms_stream_client_s *c;
-	int rc;
-	TAILQ_FOREACH(c, &__regex_client_tq, entry) {
-		rc = regexec(&c->regex, stream_name, 0, NULL, 0);
-		if (rc) /* does not match */
-			continue;
-		/* matched; add the client into the stream client list */
-		rc = __client_stream_bind(c, s);
-		if (rc)
-			goto out_1;
-	}
+	 * any. The matcher yields only the clients whose regex literal
+	 * is in the name. */
+	rc = __smatch_foreach(s->name, __stream_regex_bind_cb, s);
+	if (rc)
+		goto err;
+	if (is_new)
+		*is_new = 1;
 
 	/* Don't have to go through the NON _regex_ clients b/c the
 	 * non-regex clients already create the stream structure and
@@ -471,6 +895,26 @@ __stream_get(const char *stream_name, int *is_new)
 	__STREAM_UNLOCK();
  out_0:
 	return s;
+
+ err:
+	/* drop the entries of the regex clients bound so far; nobody else
+	 * has seen `s`, and the clients are alive */
+	while ((sce = TAILQ_FIRST(&s->client_tq))) {
+		c = sce->client;
+		TAILQ_REMOVE(&s->client_tq, sce, stream_client_entry);
+		pthread_rwlock_wrlock(&c->rwlock);
+		TAILQ_REMOVE(&c->stream_tq, sce, client_stream_entry);
+		pthread_rwlock_unlock(&c->rwlock);
+		ref_put(&sce->ref, "stream_client_entry");
+		ref_put(&sce->ref, "client_stream_entry");
+		ref_put(&c->ref, "client_entry");
+	}
+	rbt_del(&__stream_rbt, &s->rbn);
+	pthread_rwlock_destroy(&s->rwlock);
+	free(s);
+	__STREAM_UNLOCK();
+	errno = rc;
+	return NULL;
 }
 
 static void __sce_ref_free(void *arg)
@@ -594,6 +1038,415 @@ int __cred_allowed_as(struct ldms_cred *cred, struct ldms_cred *as)
 	return rc;
 }
 
+/* ==== Per-client delivery ring ==== */
+
+/* the number of messages a ring consumer delivers before yielding */
+#define __RING_BATCH 64
+
+struct __ring_ev_s {
+	struct ldms_stream_ring_s *ring;
+};
+
+static ev_type_t __ring_ev_type;
+
+static void __ring_msg_free(void *arg)
+{
+	free(arg);
+}
+
+/* copy the stream data for the delivery rings */
+static struct ldms_stream_rmsg_s *__ring_msg_new(struct ldms_stream_event_s *ev)
+{
+	struct ldms_stream_rmsg_s *m;
+	size_t name_len = ev->recv.name_len;
+
+	m = malloc(sizeof(*m) + name_len + ev->recv.data_len);
+	if (!m)
+		return NULL;
+	ref_init(&m->ref, "init", __ring_msg_free, m);
+	m->ev = *ev;
+	memcpy(m->buf, ev->recv.name, name_len);
+	memcpy(m->buf + name_len, ev->recv.data, ev->recv.data_len);
+	m->ev.recv.name = m->buf;
+	m->ev.recv.data = m->buf + name_len;
+	m->ev.recv.client = NULL;
+	m->ev.recv.json = NULL;
+	return m;
+}
+
+static int __ring_push(struct ldms_stream_ring_s *q,
+		       struct ldms_stream_rmsg_s *m,
+		       struct ldms_stream_client_entry_s *sce)
+{
+	struct ldms_stream_ring_cell_s *cell;
+	uint64_t pos, seq;
+	int64_t dif;
+
+	pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+	for (;;) {
+		cell = &q->cell[pos & q->mask];
+		seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+		dif = (int64_t)(seq - pos);
+		if (dif == 0) {
+			if (__atomic_compare_exchange_n(&q->tail, &pos, pos + 1,
+					1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		} else if (dif < 0) {
+			return ENOSPC; /* full */
+		} else {
+			pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+		}
+	}
+	cell->msg = m;
+	cell->sce = sce;
+	__atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+	return 0;
+}
+
+static int __ring_pop(struct ldms_stream_ring_s *q,
+		      struct ldms_stream_rmsg_s **m,
+		      struct ldms_stream_client_entry_s **sce)
+{
+	struct ldms_stream_ring_cell_s *cell;
+	uint64_t pos, seq;
+	int64_t dif;
+
+	pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+	for (;;) {
+		cell = &q->cell[pos & q->mask];
+		seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+		dif = (int64_t)(seq - (pos + 1));
+		if (dif == 0) {
+			if (__atomic_compare_exchange_n(&q->head, &pos, pos + 1,
+					1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		} else if (dif < 0) {
+			return ENOENT; /* empty */
+		} else {
+			pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+		}
+	}
+	*m = cell->msg;
+	*sce = cell->sce;
+	__atomic_store_n(&cell->seq, pos + q->mask + 1, __ATOMIC_RELEASE);
+	return 0;
+}
+
+static int __ring_empty(struct ldms_stream_ring_s *q)
+{
+	uint64_t pos = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+	struct ldms_stream_ring_cell_s *cell = &q->cell[pos & q->mask];
+	return (int64_t)(__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) - (pos + 1)) < 0;
+}
+
+static uint64_t __ring_lag(struct ldms_stream_ring_s *q)
+{
+	uint64_t head = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+	uint64_t tail = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+	return (tail > head)?(tail - head):(0);
+}
+
+/* post the drain event, holding a client reference while it is posted */
+static void __ring_ev_post(struct ldms_stream_ring_s *q)
+{
+	ref_get(&q->c->ref, "ring_ev");
+	if (ev_post(NULL, q->worker, q->ev, NULL))
+		ref_put(&q->c->ref, "ring_ev"); /* already posted */
+}
+
+/* wake the consumer up after a push */
+static void __ring_wake(struct ldms_stream_ring_s *q)
+{
+	if (q->worker) {
+		__ring_ev_post(q);
+		return;
+	}
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (!__atomic_load_n(&q->sleeping, __ATOMIC_RELAXED))
+		return;
+	pthread_mutex_lock(&q->mutex);
+	pthread_cond_broadcast(&q->cond);
+	pthread_mutex_unlock(&q->mutex);
+}
+
+/* release the producers waiting for room after a pop */
+static void __ring_unblock(struct ldms_stream_ring_s *q)
+{
+	if (q->policy != LDMS_STREAM_RING_BLOCK)
+		return;
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (!__atomic_load_n(&q->blocked, __ATOMIC_RELAXED))
+		return;
+	pthread_mutex_lock(&q->mutex);
+	pthread_cond_broadcast(&q->cond);
+	pthread_mutex_unlock(&q->mutex);
+}
+
+static void __ring_drop(struct ldms_stream_ring_s *q,
+			struct ldms_stream_rmsg_s *m,
+			struct ldms_stream_client_entry_s *sce)
+{
+	struct ldms_stream_client_s *c = q->c;
+	struct timespec now;
+
+	if (__stream_stats_level > 0) {
+		clock_gettime(CLOCK_REALTIME, &now);
+		pthread_rwlock_wrlock(&c->rwlock);
+		__counters_update(&sce->drops, &now, m->ev.recv.data_len);
+		__counters_update(&c->drops, &now, m->ev.recv.data_len);
+		__counters_update(&q->drops, &now, m->ev.recv.data_len);
+		pthread_rwlock_unlock(&c->rwlock);
+	}
+	ref_put(&sce->ref, "ring");
+	ref_put(&m->ref, "ring");
+}
+
+/* queue `m` for the client; the overflow policy applies if the ring is full */
+static int __ring_enqueue(struct ldms_stream_ring_s *q,
+			  struct ldms_stream_rmsg_s *m,
+			  struct ldms_stream_client_entry_s *sce)
+{
+	struct ldms_stream_rmsg_s *om;
+	struct ldms_stream_client_entry_s *osce;
+	uint64_t lag, max_lag;
+	int rc;
+
+	ref_get(&m->ref, "ring");
+	ref_get(&sce->ref, "ring");
+ again:
+	rc = __ring_push(q, m, sce);
+	if (!rc)
+		goto queued;
+	switch (q->policy) {
+	case LDMS_STREAM_RING_DROP_OLDEST:
+		if (0 == __ring_pop(q, &om, &osce)) {
+			__ring_drop(q, om, osce);
+			__ring_unblock(q);
+		}
+		goto again;
+	case LDMS_STREAM_RING_BLOCK:
+		__ring_wake(q);
+		pthread_mutex_lock(&q->mutex);
+		__atomic_add_fetch(&q->blocked, 1, __ATOMIC_SEQ_CST);
+		while (!q->term) {
+			rc = __ring_push(q, m, sce);
+			if (!rc)
+				break;
+			pthread_cond_wait(&q->cond, &q->mutex);
+		}
+		__atomic_sub_fetch(&q->blocked, 1, __ATOMIC_SEQ_CST);
+		pthread_mutex_unlock(&q->mutex);
+		if (!rc)
+			goto queued;
+		/* the client is closing */
+		break;
+	default:
+		break;
+	}
+	__ring_drop(q, m, sce);
+	return rc;
+
+ queued:
+	lag = __ring_lag(q);
+	max_lag = __atomic_load_n(&q->max_lag, __ATOMIC_RELAXED);
+	while (lag > max_lag) {
+		if (__atomic_compare_exchange_n(&q->max_lag, &max_lag, lag, 1,
+					__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+			break;
+	}
+	__ring_wake(q);
+	return 0;
+}
+
+/* deliver up to `max` messages from the ring; returns the number delivered */
+static int __ring_drain(struct ldms_stream_ring_s *q, int max)
+{
+	struct ldms_stream_client_s *c = q->c;
+	struct ldms_stream_client_entry_s *sce;
+	struct ldms_stream_rmsg_s *m;
+	struct ldms_stream_event_s ev;
+	struct json_parser_s *jp;
+	json_entity_t json;
+	struct timespec now;
+	int n, rc;
+
+	for (n = 0; n < max; n++) {
+		if (__ring_pop(q, &m, &sce))
+			break;
+		__ring_unblock(q);
+		ev = m->ev;
+		ev.recv.client = c;
+		json = NULL;
+		rc = 0;
+		if (ev.recv.type == LDMS_STREAM_JSON && !c->raw_json) {
+			/* each client gets its own json object */
+			jp = json_parser_new(0);
+			if (jp) {
+				rc = json_parse_buffer(jp, (void*)ev.recv.data,
+						       ev.recv.data_len, &json);
+				json_parser_free(jp);
+			} else {
+				rc = ENOMEM;
+			}
+			ev.recv.json = json;
+		}
+		if (!rc)
+			rc = c->cb_fn(&ev, c->cb_arg);
+		if (json)
+			json_entity_free(json);
+		if (__stream_stats_level > 0) {
+			clock_gettime(CLOCK_REALTIME, &now);
+			pthread_rwlock_wrlock(&c->rwlock);
+			if (rc) {
+				__counters_update(&sce->drops, &now, ev.recv.data_len);
+				__counters_update(&c->drops, &now, ev.recv.data_len);
+			} else {
+				__counters_update(&sce->tx, &now, ev.recv.data_len);
+				__counters_update(&c->tx, &now, ev.recv.data_len);
+			}
+			pthread_rwlock_unlock(&c->rwlock);
+		}
+		ref_put(&sce->ref, "ring");
+		ref_put(&m->ref, "ring");
+	}
+	return n;
+}
+
+/* deliver the CLOSE event of a closed client and drop its "init" reference */
+static void __client_close_ev(struct ldms_stream_client_s *c)
+{
+	struct ldms_stream_event_s ev;
+
+	ev.r = c->x;
+	ev.type = LDMS_STREAM_EVENT_CLOSE;
+	ev.close.client = c;
+
+	ref_get(&c->ref, "cb");
+	c->cb_fn(&ev, c->cb_arg);
+	ref_put(&c->ref, "cb");
+
+	ref_put(&c->ref, "init");
+}
+
+/* ring consumer on an ev worker */
+static int __ring_actor(ev_worker_t src, ev_worker_t dst, ev_status_t status, ev_t e)
+{
+	struct ldms_stream_ring_s *q = EV_DATA(e, struct __ring_ev_s)->ring;
+	struct ldms_stream_client_s *c = q->c;
+	int closing;
+
+	if (__atomic_load_n(&q->done, __ATOMIC_ACQUIRE))
+		goto out; /* posted by a late publisher; the client is closed */
+	if (__RING_BATCH == __ring_drain(q, __RING_BATCH) || !__ring_empty(q)) {
+		/* let the other events of the worker run */
+		__ring_ev_post(q);
+		goto out;
+	}
+	if (__atomic_load_n(&q->term, __ATOMIC_SEQ_CST)) {
+		pthread_mutex_lock(&q->mutex);
+		__atomic_store_n(&q->done, 1, __ATOMIC_RELEASE);
+		pthread_cond_broadcast(&q->cond);
+		closing = q->closing;
+		pthread_mutex_unlock(&q->mutex);
+		if (closing)
+			__client_close_ev(c);
+	}
+ out:
+	ref_put(&c->ref, "ring_ev");
+	return 0;
+}
+
+/* ring consumer thread */
+static void *__ring_proc(void *arg)
+{
+	struct ldms_stream_ring_s *q = arg;
+	struct ldms_stream_client_s *c = q->c;
+	int closing;
+
+	for (;;) {
+		if (__ring_drain(q, __RING_BATCH))
+			continue;
+		pthread_mutex_lock(&q->mutex);
+		__atomic_store_n(&q->sleeping, 1, __ATOMIC_SEQ_CST);
+		if (!__ring_empty(q))
+			goto next;
+		if (q->term) {
+			q->done = 1;
+			pthread_cond_broadcast(&q->cond);
+			closing = q->closing;
+			pthread_mutex_unlock(&q->mutex);
+			/* `q` may be freed by the CLOSE event */
+			if (closing)
+				__client_close_ev(c);
+			break;
+		}
+		pthread_cond_wait(&q->cond, &q->mutex);
+	next:
+		__atomic_store_n(&q->sleeping, 0, __ATOMIC_RELAXED);
+		pthread_mutex_unlock(&q->mutex);
+	}
+	return NULL;
+}
+
+/* deliver the queued messages and stop the consumer */
+static void __ring_stop(struct ldms_stream_ring_s *q)
+{
+	pthread_mutex_lock(&q->mutex);
+	__atomic_store_n(&q->term, 1, __ATOMIC_SEQ_CST);
+	pthread_cond_broadcast(&q->cond);
+	pthread_mutex_unlock(&q->mutex);
+	if (!q->worker) {
+		pthread_join(q->thread, NULL);
+		q->joinable = 0;
+		return;
+	}
+	__ring_ev_post(q);
+	pthread_mutex_lock(&q->mutex);
+	while (!q->done)
+		pthread_cond_wait(&q->cond, &q->mutex);
+	pthread_mutex_unlock(&q->mutex);
+}
+
+/*
+ * Stop the consumer of a closed client without waiting. The consumer
+ * delivers the queued messages, then the CLOSE event, on its own thread so
+ * that a slow client does not delay the CLOSE events of the others.
+ */
+static void __ring_close(struct ldms_stream_ring_s *q)
+{
+	pthread_mutex_lock(&q->mutex);
+	q->closing = 1;
+	__atomic_store_n(&q->term, 1, __ATOMIC_SEQ_CST);
+	pthread_cond_broadcast(&q->cond);
+	pthread_mutex_unlock(&q->mutex);
+	if (q->worker)
+		__ring_ev_post(q);
+}
+
+static void __ring_free(struct ldms_stream_ring_s *q)
+{
+	struct ldms_stream_rmsg_s *m;
+	struct ldms_stream_client_entry_s *sce;
+
+	if (q->joinable) {
+		/* the last reference may be dropped by the consumer itself */
+		if (pthread_equal(q->thread, pthread_self()))
+			pthread_detach(q->thread);
+		else
+			pthread_join(q->thread, NULL);
+	}
+	/* messages queued after the consumer stopped */
+	while (0 == __ring_pop(q, &m, &sce)) {
+		ref_put(&sce->ref, "ring");
+		ref_put(&m->ref, "ring");
+	}
+	if (q->ev)
+		ev_put(q->ev);
+	pthread_mutex_destroy(&q->mutex);
+	pthread_cond_destroy(&q->cond);
+	free(q);
+}
+
 /* deliver stream data to all clients */
 /* must NOT hold __stream_mutex */
 static int
@@ -609,6 +1462,8 @@ __stream_deliver(struct __stream_buf_s *sbuf, uint64_t msg_gn,
 	struct ldms_stream_s *s;
 	struct ldms_stream_client_entry_s *sce, *next_sce;
 	struct ldms_stream_client_s *c;
+	struct ldms_stream_ring_s *q;
+	struct ldms_stream_rmsg_s *rmsg = NULL;
 	struct timespec now;
 	size_t sz;
 
@@ -705,7 +1560,26 @@ __stream_deliver(struct __stream_buf_s *sbuf, uint64_t msg_gn,
 			gc = 1;
 			continue;
 		}
-		if (!json && stream_type == LDMS_STREAM_JSON && !c->x) {
+		q = __atomic_load_n(&c->ring, __ATOMIC_ACQUIRE);
+		if (q) {
+			/* the client drains its own ring; copy the data only
+			 * once for all of the ring clients */
+			if (!rmsg) {
+				rmsg = __ring_msg_new(&_ev.pub);
+				if (!rmsg) {
+					rc = ENOMEM;
+					goto cleanup;
+				}
+			}
+			ref_get(&c->ref, "callback");
+			pthread_rwlock_unlock(&s->rwlock);
+			__ring_enqueue(q, rmsg, sce);
+			ref_put(&c->ref, "callback");
+			pthread_rwlock_rdlock(&s->rwlock);
+			continue;
+		}
+		if (!json && stream_type == LDMS_STREAM_JSON && !c->x &&
+		    !c->raw_json) {
 			/* json object is only required to parse once for
 			 * the local client */
 			struct json_parser_s *jp = json_parser_new(0);
@@ -723,6 +1597,7 @@ __stream_deliver(struct __stream_buf_s *sbuf, uint64_t msg_gn,
 		ref_get(&c->ref, "callback");
 		pthread_rwlock_unlock(&s->rwlock);
 		_ev.pub.recv.client = c;
+		_ev.pub.recv.json = c->raw_json ? NULL : json;
 		rc = c->cb_fn(&_ev.pub, c->cb_arg);
 		if (__stream_stats_level > 0) {
 			pthread_rwlock_wrlock(&c->rwlock);
@@ -742,6 +1617,8 @@ __stream_deliver(struct __stream_buf_s *sbuf, uint64_t msg_gn,
  cleanup:
 	if (json)
 		json_entity_free(json);
+	if (rmsg)
+		ref_put(&rmsg->ref, "init");
 	pthread_rwlock_unlock(&s->rwlock);
 	if (gc) {
 		/* remove unbound sce from s->client_tq */
@@ -1006,6 +1883,8 @@ static void __client_ref_free(void *arg)
 {
 	struct ldms_stream_client_s *c = arg;
 	struct ldms_stream_client_entry_s *sce;
+	if (c->ring)
+		__ring_free(c->ring);
 	while ((sce = TAILQ_FIRST(&c->stream_tq))) {
 		assert(sce->stream == NULL);
 		TAILQ_REMOVE(&c->stream_tq, sce, client_stream_entry);
@@ -1028,10 +1907,17 @@ __client_subscribe(struct ldms_stream_client_s *c)
 
 	if (c->is_regex) {
 		__STREAM_WRLOCK();
+		rc = __smatch_add(c);
+		if (rc) {
+			__STREAM_UNLOCK();
+			goto out;
+		}
 		TAILQ_INSERT_TAIL(&__regex_client_tq, c, entry);
 		ref_get(&c->ref, "__regex_client_tq");
 		RBT_FOREACH(rbn, &__stream_rbt) {
 			s = container_of(rbn, struct ldms_stream_s, rbn);
+			if (!__smatch_lit_check(c, s->name))
+				continue; /* not matched */
 			if (regexec(&c->regex, s->name, 0, NULL, 0))
 				continue; /* not matched */
 			/* matched; bind the client */
@@ -1059,6 +1945,7 @@ __client_subscribe(struct ldms_stream_client_s *c)
 		__client_stream_unbind(sce);
 	}
 	if (c->is_regex) {
+		__smatch_del(c);
 		TAILQ_REMOVE(&__regex_client_tq, c, entry);
 		ref_put(&c->ref, "__regex_client_tq");
 	}
@@ -1075,7 +1962,8 @@ __client_alloc(const char *stream, int is_regex,
 	ldms_stream_client_t c;
 	int rc, slen = strlen(stream) + 1;
 	int dlen = (desc?strlen(desc):0) + 1;
-	c = calloc(1, sizeof(*c) + slen + dlen);
+	/* a regex client also needs room for its literal (and scratch) */
+	c = calloc(1, sizeof(*c) + slen + dlen + (is_regex ? 2 * slen : 0));
 	if (!c)
 		goto out;
 	pthread_rwlock_init(&c->rwlock, NULL);
@@ -1096,6 +1984,10 @@ __client_alloc(const char *stream, int is_regex,
 		rc = regcomp(&c->regex, c->match, REG_EXTENDED|REG_NOSUB);
 		if (rc)
 			goto err_0;
+		c->lit = &c->desc[c->desc_len];
+		c->lit_len = __smatch_re_literal(c->match, c->lit,
+						 &c->lit_anchored);
+		c->lit[c->lit_len] = '\0';
 	}
 
 	LDMS_STREAM_COUNTERS_INIT(&c->tx);
@@ -1156,6 +2048,7 @@ void ldms_stream_close(ldms_stream_client_t c)
 		__client_stream_unbind(sce);
 	}
 	if (c->is_regex) {
+		__smatch_del(c);
 		TAILQ_REMOVE(&__regex_client_tq, c, entry);
 		ref_put(&c->ref, "__regex_client_tq");
 	}
@@ -1168,6 +2061,100 @@ void ldms_stream_close(ldms_stream_client_t c)
 	pthread_mutex_unlock(&__stream_close_mutex);
 }
 
+static void __ring_ev_type_init(void)
+{
+	__ring_ev_type = ev_type_new("ldms_stream:ring", sizeof(struct __ring_ev_s));
+	if (__ring_ev_type) /* keep the drain of a ring on one thread */
+		ev_type_affinity_set(__ring_ev_type, EV_AFFINITY_ORDERED);
+}
+
+int ldms_stream_client_raw_json_set(ldms_stream_client_t c, int raw)
+{
+	if (c->x)
+		return EINVAL;
+	c->raw_json = !!raw;
+	return 0;
+}
+
+int ldms_stream_client_ring_set(ldms_stream_client_t c, uint32_t size,
+				ldms_stream_ring_policy_t policy,
+				ev_worker_t worker)
+{
+	static pthread_once_t once = PTHREAD_ONCE_INIT;
+	struct ldms_stream_ring_s *q, *nil = NULL;
+	uint64_t n, i;
+	void *p;
+	int rc;
+
+	if (c->x || !size)
+		return EINVAL;
+	switch (policy) {
+	case LDMS_STREAM_RING_DROP_OLDEST:
+	case LDMS_STREAM_RING_DROP_NEWEST:
+	case LDMS_STREAM_RING_BLOCK:
+		break;
+	default:
+		return EINVAL;
+	}
+	if (__atomic_load_n(&c->ring, __ATOMIC_ACQUIRE))
+		return EBUSY;
+	for (n = 1; n < size; n <<= 1)
+		;
+	rc = posix_memalign(&p, 64, sizeof(*q) + n * sizeof(q->cell[0]));
+	if (rc)
+		return rc;
+	q = p;
+	memset(q, 0, sizeof(*q));
+	for (i = 0; i < n; i++) {
+		q->cell[i].seq = i;
+		q->cell[i].msg = NULL;
+		q->cell[i].sce = NULL;
+	}
+	q->mask = n - 1;
+	q->policy = policy;
+	q->c = c;
+	q->worker = worker;
+	LDMS_STREAM_COUNTERS_INIT(&q->drops);
+	pthread_mutex_init(&q->mutex, NULL);
+	pthread_cond_init(&q->cond, NULL);
+
+	if (worker) {
+		pthread_once(&once, __ring_ev_type_init);
+		if (!__ring_ev_type) {
+			rc = ENOMEM;
+			goto err;
+		}
+		q->ev = ev_new(__ring_ev_type);
+		if (!q->ev) {
+			rc = ENOMEM;
+			goto err;
+		}
+		EV_DATA(q->ev, struct __ring_ev_s)->ring = q;
+		rc = ev_dispatch(worker, __ring_ev_type, __ring_actor);
+		if (rc)
+			goto err;
+	} else {
+		rc = pthread_create(&q->thread, NULL, __ring_proc, q);
+		if (rc)
+			goto err;
+		q->joinable = 1;
+		pthread_setname_np(q->thread, "ldms_strm_ring");
+	}
+
+	if (!__atomic_compare_exchange_n(&c->ring, &nil, q, 0,
+				__ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+		/* lost the race to another ring_set() */
+		__ring_stop(q);
+		__ring_free(q);
+		return EBUSY;
+	}
+	return 0;
+
+ err:
+	__ring_free(q);
+	return rc;
+}
+
 struct __sub_req_ctxt_s {
 	ldms_stream_event_cb_t cb_fn;
 	void *cb_arg;
@@ -2083,10 +3070,25 @@ ldms_stream_client_get_stats(ldms_stream_client_t cli, int is_reset)
 	cs->drops = cli->drops;
 	cs->tx = cli->tx;
 	cs->is_regex = cli->is_regex;
+	if (cli->ring) {
+		cs->ring_size = cli->ring->mask + 1;
+		cs->ring_lag = __ring_lag(cli->ring);
+		cs->ring_max_lag = __atomic_load_n(&cli->ring->max_lag, __ATOMIC_RELAXED);
+		cs->ring_drops = cli->ring->drops;
+	} else {
+		cs->ring_size = 0;
+		cs->ring_lag = 0;
+		cs->ring_max_lag = 0;
+		LDMS_STREAM_COUNTERS_INIT(&cs->ring_drops);
+	}
 
 	if (is_reset) {
 		LDMS_STREAM_COUNTERS_INIT(&cli->tx);
 		LDMS_STREAM_COUNTERS_INIT(&cli->drops);
+		if (cli->ring) {
+			__atomic_store_n(&cli->ring->max_lag, 0, __ATOMIC_RELAXED);
+			LDMS_STREAM_COUNTERS_INIT(&cli->ring->drops);
+		}
 	}
 
 	TAILQ_FOREACH(sce, &cli->stream_tq, client_stream_entry) {
@@ -2221,6 +3223,16 @@ int __client_stats_buff_append(struct ldms_stream_client_stats_s *cs,
 	     __counters_buff_append(&cs->tx, buff) ||
 	     ovis_buff_appendf(buff, ",\"drops\":") ||
 	     __counters_buff_append(&cs->drops, buff) ||
+	     ovis_buff_appendf(buff, ",\"ring\":{"
+		"\"size\":%u"
+		",\"lag\":%lu"
+		",\"max_lag\":%lu"
+		",\"drops\":",
+		cs->ring_size,
+		cs->ring_lag,
+		cs->ring_max_lag) ||
+	     __counters_buff_append(&cs->ring_drops, buff) ||
+	     ovis_buff_appendf(buff, "}") ||
 	     ovis_buff_appendf(buff, ",\"streams\":") ||
 	     __pair_tq_buff_append(&cs->pair_tq, buff);
 	if (rc)
@@ -2358,7 +3370,6 @@ static void __ldms_stream_init();
 static void *__stream_close_proc(void *arg)
 {
 	struct ldms_stream_client_s *c;
-	struct ldms_stream_event_s ev;
 
 	pthread_atfork(NULL, NULL, __ldms_stream_init); /* re-initialize at fork */
 
@@ -2372,15 +3383,10 @@ static void *__stream_close_proc(void *arg)
 	TAILQ_REMOVE(&__stream_close_tq, c, entry);
 	pthread_mutex_unlock(&__stream_close_mutex);
 
-	ev.r = c->x;
-	ev.type = LDMS_STREAM_EVENT_CLOSE;
-	ev.close.client = c;
-
-	ref_get(&c->ref, "cb");
-	c->cb_fn(&ev, c->cb_arg);
-	ref_put(&c->ref, "cb");
-
-	ref_put(&c->ref, "init");
+	if (c->ring) /* the ring delivers the queued data, then CLOSE */
+		__ring_close(c->ring);
+	else
+		__client_close_ev(c);
 
 	pthread_mutex_lock(&__stream_close_mutex);
 	goto loop;
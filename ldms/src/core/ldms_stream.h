@@ -93,6 +93,48 @@ struct ldms_stream_client_entry_s {
 	struct ldms_stream_counters_s drops;
 };
 
+/* a stream message copied once for the delivery rings of the clients */
+struct ldms_stream_rmsg_s {
+	struct ref_s ref;
+	struct ldms_stream_event_s ev; /* the RECV event without client and json */
+	char buf[OVIS_FLEX]; /* stream name followed by the data */
+};
+
+struct ldms_stream_ring_cell_s {
+	uint64_t seq; /* the ring position this cell is ready for */
+	struct ldms_stream_rmsg_s *msg;
+	struct ldms_stream_client_entry_s *sce;
+};
+
+/*
+ * Per-client bounded delivery ring (see ldms_stream_client_ring_set()).
+ *
+ * The publishers are the producers and the draining thread (or ev worker) is
+ * the consumer. A producer may also dequeue to evict the oldest message, so
+ * the cells carry a sequence number like in an MPMC bounded queue.
+ */
+struct ldms_stream_ring_s {
+	uint64_t tail __attribute__((aligned(64))); /* next enqueue position */
+	uint64_t head __attribute__((aligned(64))); /* next dequeue position */
+	uint64_t max_lag __attribute__((aligned(64)));
+	uint64_t mask;
+	ldms_stream_ring_policy_t policy;
+	struct ldms_stream_client_s *c;
+	ev_worker_t worker; /* NULL if drained by `thread` */
+	ev_t ev; /* drain event posted to `worker` */
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond; /* consumer wakeup, blocked producers and stop */
+	int sleeping; /* `thread` is waiting for messages */
+	int blocked; /* the number of producers waiting for room */
+	int term; /* the client is closing */
+	int done; /* the consumer has stopped */
+	int closing; /* the consumer delivers the CLOSE event when done */
+	int joinable; /* `thread` is neither joined nor detached */
+	struct ldms_stream_counters_s drops; /* protected by c->rwlock */
+	struct ldms_stream_ring_cell_s cell[OVIS_FLEX];
+};
+
 struct ldms_stream_client_s {
 	TAILQ_ENTRY(ldms_stream_client_s) entry; /* for __regex_client_tq */
 
@@ -118,8 +160,22 @@ struct ldms_stream_client_s {
 	regex_t regex;
 	struct ref_s ref;
 
+	/* regex pre-filter (see the stream name matcher in ldms_stream.c) */
+	TAILQ_ENTRY(ldms_stream_client_s) smatch_entry; /* node or residual list */
+	struct __smatch_node *smatch_node; /* NULL if on the residual list */
+	uint64_t smatch_gn; /* last match pass that visited this client */
+	int lit_len; /* length of the required literal, 0 if none */
+	int lit_anchored; /* `lit` must be a prefix of the stream name */
+	char *lit; /* literal required by the regex, next to c->desc */
+
 	struct ldms_rail_rate_quota_s rate_quota;
 
+	/* delivery ring; NULL if the data is delivered by the publisher */
+	struct ldms_stream_ring_s *ring;
+
+	/* deliver LDMS_STREAM_JSON data without parsing it */
+	int raw_json;
+
 	int desc_len;
 	char *desc; /* a short description at &match[match_len] */
 	int match_len; /* length of c->match[], including '\0' */
@@ -449,61 +449,121 @@ void __ldms_free_ctxt(struct ldms_xprt *x, struct ldms_context *ctxt)
 	free(ctxt);
 }
 
-static void send_dir_update(struct ldms_xprt *x,
-			    enum ldms_dir_type t,
-			    char *json, size_t json_sz)
-{
-	size_t hdr_len;
-	size_t buf_len;
-	size_t json_data_len;
-	struct ldms_reply *reply = NULL;
-
-	if (!ldms_xprt_connected(x))
-		return;
-	assert(t != LDMS_DIR_LIST);
+/*
+ * Directory messages are sent in frames of at most ldms_xprt_msg_max()
+ * bytes; all but the last frame of a directory have `more` set.
+ */
+struct dir_frame {
+	struct ldms_xprt *x;
+	struct ldms_reply *reply;
+	size_t max;		/* size of the reply buffer */
+	size_t cnt;		/* bytes in dir.json_data */
+	int count;		/* sets in the frame */
+	int binary;
+	uint64_t session;
+	uint64_t gn;
+};
 
-	hdr_len = sizeof(struct ldms_reply_hdr)
-		+ sizeof(struct ldms_dir_reply);
-	json_data_len = strlen("{ \"directory\" : [  ]}") + strlen(json) + 1;
-	buf_len = hdr_len + json_data_len;
+#define DIR_FRAME_HDRLEN (sizeof(struct ldms_reply_hdr) + \
+			  sizeof(struct ldms_dir_reply))
+#define DIR_FRAME_JSON_HEAD "{ \"directory\" : ["
+#define DIR_FRAME_JSON_TAIL "]}"
 
-	if (buf_len >= ldms_xprt_msg_max(x)) {
-		XPRT_LOG(x, OVIS_LERROR, "Directory message is too large (%lu) "
-				"for the max transport message (%lu).\n",
-				buf_len, ldms_xprt_msg_max(x));
-		return;
-	}
-
-	reply = malloc(buf_len);
-	if (!reply) {
-		XPRT_LOG(x, OVIS_LCRIT, "Out of memory\n");
-		return;
-	}
+static void dir_frame_reset(struct dir_frame *f)
+{
+	f->count = 0;
+	if (f->binary)
+		f->cnt = sizeof(struct ldms_dir_bin_hdr);
+	else
+		f->cnt = sprintf(f->reply->dir.json_data, DIR_FRAME_JSON_HEAD);
+}
 
-	reply->hdr.xid = x->remote_dir_xid;
-	reply->hdr.cmd = htonl(LDMS_CMD_DIR_UPDATE_REPLY);
-	reply->hdr.rc = 0;
-	reply->dir.more = 0;
-	reply->dir.type = htonl(t);
-	reply->dir.json_data_len = htonl(json_data_len);
-	reply->hdr.len = htonl(buf_len);
-	(void)snprintf(reply->dir.json_data, json_data_len,
-				"{ \"directory\" : [ %s ]}", json);
+static int dir_frame_init(struct dir_frame *f, struct ldms_xprt *x, int cmd,
+			  uint32_t type, uint64_t xid, uint64_t session,
+			  uint64_t gn)
+{
+	f->x = x;
+	f->max = ldms_xprt_msg_max(x);
+	f->binary = !!(type & LDMS_DIR_REPLY_F_BINARY);
+	f->session = session;
+	f->gn = gn;
+	if (f->max < DIR_FRAME_HDRLEN + sizeof(struct ldms_dir_bin_hdr) +
+		     sizeof(DIR_FRAME_JSON_HEAD DIR_FRAME_JSON_TAIL))
+		return EINVAL;
+	f->reply = malloc(f->max);
+	if (!f->reply)
+		return ENOMEM;
+	f->reply->hdr.xid = xid;
+	f->reply->hdr.cmd = htonl(cmd);
+	f->reply->hdr.rc = 0;
+	f->reply->dir.type = htonl(type);
+	dir_frame_reset(f);
+	return 0;
+}
 
-	XPRT_LOG(x, OVIS_LDEBUG, "%s(): x %p: remote dir ctxt %p\n",
-				__func__, x, (void *)x->remote_dir_xid);
+static void dir_frame_free(struct dir_frame *f)
+{
+	free(f->reply);
+	f->reply = NULL;
+}
 
+static zap_err_t dir_frame_send(struct dir_frame *f, int more)
+{
+	struct ldms_dir_bin_hdr *bh;
 	zap_err_t zerr;
-	zerr = zap_send(x->zap_ep, reply, buf_len);
+
+	if (f->binary) {
+		bh = (void *)f->reply->dir.json_data;
+		bh->session = htobe64(f->session);
+		bh->gn = htobe64(f->gn);
+		bh->rec_count = htonl(f->count);
+		bh->reserved = 0;
+	} else {
+		f->cnt += sprintf(&f->reply->dir.json_data[f->cnt],
+				  DIR_FRAME_JSON_TAIL);
+	}
+	f->reply->hdr.len = htonl(DIR_FRAME_HDRLEN + f->cnt);
+	f->reply->dir.json_data_len = htonl(f->cnt);
+	f->reply->dir.more = htonl(more);
+	zerr = zap_send(f->x->zap_ep, f->reply, DIR_FRAME_HDRLEN + f->cnt);
 	if (zerr != ZAP_ERR_OK) {
-		x->zerrno = zerr;
-		XPRT_LOG(x, OVIS_LERROR, "%s: x %p: "
-				"zap_send synchronously error. '%s'\n",
-				__func__, x, zap_err_str(zerr));
-		ldms_xprt_close(x);
+		f->x->zerrno = zerr;
+		XPRT_LOG(f->x, OVIS_LERROR, "%s: x %p: "
+			 "zap_send synchronous error. '%s'\n",
+			 __func__, f->x, zap_err_str(zerr));
 	}
-	free(reply);
-	return;
+	dir_frame_reset(f);
+	return zerr;
+}
+
+/* Add a binary or JSON set record, sending the frame first if it is full */
+static zap_err_t dir_frame_add(struct dir_frame *f, const char *rec, size_t len)
+{
+	size_t room = f->max - DIR_FRAME_HDRLEN - 1;
+	zap_err_t zerr;
+
+	if (!f->binary)
+		room -= sizeof(DIR_FRAME_JSON_TAIL);
+	if (f->cnt + len > room) {
+		if (!f->count)
+			goto too_big;
+		zerr = dir_frame_send(f, 1);
+		if (zerr)
+			return zerr;
+		if (f->cnt + len > room)
+			goto too_big;
+	}
+	memcpy(&f->reply->dir.json_data[f->cnt], rec, len);
+	if (!f->binary && f->count)
+		/* JSON records are formatted without the separating comma */
+		f->reply->dir.json_data[f->cnt] = ',';
+	f->cnt += len;
+	f->count++;
+	return ZAP_ERR_OK;
+ too_big:
+	XPRT_LOG(f->x, OVIS_LERROR, "Directory record is too large (%zu) "
+		 "for the max transport message (%zu).\n", len, f->max);
+	return ZAP_ERR_OK;
 }
 
 static void send_req_notify_reply(struct ldms_xprt *x,
@@ -568,35 +628,220 @@ char *__ldms_format_set_for_dir(struct ldms_set *set, size_t *buf_sz)
 	return json_buf;
 }
 
-static void dir_update(struct ldms_set *set, enum ldms_dir_type t)
+/*
+ * The directory changes are sent to the peers registered for directory
+ * updates by the flusher thread. It wakes up on the first change after
+ * the last flush, waits LDMS_DIR_BATCH_USEC for more changes, and sends
+ * the net changes in as few messages as possible.
+ *
+ * dir_flush_lock orders the flushes with the directory replies of
+ * process_dir_request() so that a peer is sent every change after the
+ * directory it was given exactly once.
+ */
+static pthread_mutex_t dir_flush_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t dir_flush_once = PTHREAD_ONCE_INIT;
+static uint64_t dir_flushed_gn;
+static long dir_batch_usec = 10000;
+
+static int dir_change_access(struct ldms_xprt *x, struct ldms_dir_change *c)
+{
+	return 0 == ldms_access_check(x, LDMS_ACCESS_READ,
+				      c->uid, c->gid, c->perm);
+}
+
+static zap_err_t dir_flush_bin(struct ldms_xprt *x, struct ldms_dir_change_list *list,
+			       uint64_t session, uint64_t gn)
 {
-	char *json_buf = NULL;
-	size_t json_cnt;
+	struct dir_frame f;
+	struct ldms_dir_change *c;
+	zap_err_t zerr = ZAP_ERR_OK;
+
+	if (dir_frame_init(&f, x, LDMS_CMD_DIR_UPDATE_REPLY,
+			   LDMS_DIR_UPD | LDMS_DIR_REPLY_F_BINARY,
+			   x->remote_dir_xid, session, gn))
+		return ZAP_ERR_RESOURCE;
+	TAILQ_FOREACH(c, list, entry) {
+		if (c->gn <= x->dir_gn || !c->bin || !dir_change_access(x, c))
+			continue;
+		zerr = dir_frame_add(&f, c->bin, c->bin_len);
+		if (zerr)
+			goto out;
+	}
+	if (f.count)
+		zerr = dir_frame_send(&f, 0);
+ out:
+	dir_frame_free(&f);
+	return zerr;
+}
+
+/*
+ * Peers without the binary directory get an LDMS_DIR_ADD and an
+ * LDMS_DIR_UPD message. They learn about deleted sets from the set delete
+ * handshake.
+ */
+static zap_err_t dir_flush_json(struct ldms_xprt *x, struct ldms_dir_change_list *list)
+{
+	struct dir_frame f;
+	struct ldms_dir_change *c;
+	enum ldms_dir_type t;
+	zap_err_t zerr = ZAP_ERR_OK;
+
+	for (t = LDMS_DIR_ADD; t <= LDMS_DIR_UPD; t++) {
+		if (dir_frame_init(&f, x, LDMS_CMD_DIR_UPDATE_REPLY, t,
+				   x->remote_dir_xid, 0, 0))
+			return ZAP_ERR_RESOURCE;
+		TAILQ_FOREACH(c, list, entry) {
+			if (c->type != t || c->gn <= x->dir_gn || !c->json ||
+			    !dir_change_access(x, c))
+				continue;
+			zerr = dir_frame_add(&f, c->json, c->json_len);
+			if (zerr)
+				break;
+		}
+		if (!zerr && f.count)
+			zerr = dir_frame_send(&f, 0);
+		dir_frame_free(&f);
+		if (zerr)
+			break;
+	}
+	return zerr;
+}
+
+/*
+ * NOTE: dir_flush_lock is held
+ *
+ * dir_flushed_gn and the dir_gn of a peer only advance once the changes
+ * are formatted and sent, so that the changes are sent again by the next
+ * flush if they could not be. Returns 0 if every peer is up to date.
+ */
+static int dir_flush(void)
+{
+	struct ldms_dir_change_list list = TAILQ_HEAD_INITIALIZER(list);
+	struct ldms_dir_change *c;
 	struct ldms_xprt *x;
+	uint64_t session = __ldms_dir_session();
+	uint64_t gn;
+	int bin_peers = 0, json_peers = 0;
+	zap_err_t zerr;
+	int rc;
+
+	rc = __ldms_dir_changes(dir_flushed_gn, &gn, &list);
+	if (rc == ESTALE) {
+		/*
+		 * More changes than the log holds: send every set, and a
+		 * session the peers do not know so that their next directory
+		 * request is not answered with changes only.
+		 */
+		ovis_log(xlog, OVIS_LWARN, "The directory log overflowed, "
+			 "consider increasing LDMS_DIR_LOG_SIZE.\n");
+		__ldms_dir_change_list_free(&list);
+		session = 0;
+		gn = __ldms_dir_gn();
+		rc = __ldms_dir_all(&list);
+	}
+	if (rc)
+		goto err;
 
 	pthread_mutex_lock(&xprt_list_lock);
 	LIST_FOREACH(x, &xprt_list, xprt_link) {
-		if (x->remote_dir_xid) {
-			if (!json_buf) {
-				/* Only build the JSON resonse if there is a
-				 * transport that has registered for updates */
-				json_buf = __ldms_format_set_for_dir(set, &json_cnt);
-				if (!json_buf) {
-					XPRT_LOG(x, OVIS_LCRIT, "%s: memory allocation error\n", __func__);
-					goto out;
-				}
-			}
-			send_dir_update(x, t, json_buf, json_cnt);
+		if (!x->remote_dir_xid)
+			continue;
+		if (x->dir_caps & LDMS_DIR_CAP_BINARY)
+			bin_peers = 1;
+		else
+			json_peers = 1;
+	}
+	pthread_mutex_unlock(&xprt_list_lock);
+
+	/* The records are formatted without xprt_list_lock; it is taken
+	 * with the set lock held in __ldms_dir_del_set(). */
+	TAILQ_FOREACH(c, &list, entry) {
+		if (bin_peers) {
+			rc = __ldms_dir_change_format(c, 0);
+			if (rc)
+				goto err;
+		}
+		if (json_peers && c->type != LDMS_DIR_DEL) {
+			rc = __ldms_dir_change_format(c, 1);
+			if (rc == ENOENT)
+				rc = 0; /* deleted since, no JSON record */
+			if (rc)
+				goto err;
+		}
+	}
+
+	pthread_mutex_lock(&xprt_list_lock);
+	LIST_FOREACH(x, &xprt_list, xprt_link) {
+		if (!x->remote_dir_xid || !ldms_xprt_connected(x))
+			continue;
+		if (x->dir_caps & LDMS_DIR_CAP_BINARY)
+			zerr = dir_flush_bin(x, &list, session, gn);
+		else
+			zerr = dir_flush_json(x, &list);
+		if (zerr == ZAP_ERR_OK) {
+			x->dir_gn = gn;
+		} else if (zerr == ZAP_ERR_RESOURCE) {
+			XPRT_LOG(x, OVIS_LCRIT, "%s: memory allocation error\n", __func__);
+			rc = ENOMEM;
+		} else {
+			ldms_xprt_close(x);
 		}
 	}
-	free(json_buf);
-out:
 	pthread_mutex_unlock(&xprt_list_lock);
+	if (rc)
+		goto err;
+	dir_flushed_gn = gn;
+	__ldms_dir_change_list_free(&list);
+	return 0;
+ err:
+	ovis_log(xlog, OVIS_LERROR, "The directory updates could not be "
+		 "sent, error %d. Retrying.\n", rc);
+	__ldms_dir_change_list_free(&list);
+	return rc;
+}
+
+/* the delay before a failed flush is retried */
+#define DIR_FLUSH_RETRY_USEC 100000
+
+static void *dir_flush_proc(void *arg)
+{
+	int rc;
+
+	for (;;) {
+		(void)__ldms_dir_wait(dir_flushed_gn);
+		if (dir_batch_usec)
+			usleep(dir_batch_usec);
+		pthread_mutex_lock(&dir_flush_lock);
+		rc = dir_flush();
+		pthread_mutex_unlock(&dir_flush_lock);
+		if (rc)
+			usleep(DIR_FLUSH_RETRY_USEC);
+	}
+	return NULL;
+}
+
+static void dir_flush_init(void)
+{
+	pthread_t thr;
+	char *s = getenv("LDMS_DIR_BATCH_USEC");
+	int rc;
+
+	if (s)
+		dir_batch_usec = atol(s);
+	dir_flushed_gn = __ldms_dir_gn();
+	rc = pthread_create(&thr, NULL, dir_flush_proc, NULL);
+	if (rc) {
+		ovis_log(xlog, OVIS_LCRIT, "Cannot create the directory "
+			 "update thread, error %d\n", rc);
+		return;
+	}
+	pthread_setname_np(thr, "ldms_dir");
+	pthread_detach(thr);
 }
 
 void __ldms_dir_add_set(struct ldms_set *set)
 {
-	dir_update(set, LDMS_DIR_ADD);
+	__ldms_dir_log(set, LDMS_DIR_ADD);
 }
 
 static void __set_delete_cb(ldms_t xprt, int status, ldms_set_t rbd, void *cb_arg)
@@ -632,6 +877,9 @@ void __ldms_dir_del_set(struct ldms_set *set)
 	 */
 	struct ldms_xprt *x;
 	ldms_t r;
+	/* Peers with the binary directory are also sent a DEL record
+	 * so that their directory caches stay current. */
+	__ldms_dir_log(set, LDMS_DIR_DEL);
 	pthread_mutex_lock(&xprt_list_lock);
 	LIST_FOREACH(x, &xprt_list, xprt_link) {
 		if (x->remote_dir_xid) {
@@ -648,7 +896,7 @@ void __ldms_dir_del_set(struct ldms_set *set)
 
 void __ldms_dir_upd_set(struct ldms_set *set)
 {
-	dir_update(set, LDMS_DIR_UPD);
+	__ldms_dir_log(set, LDMS_DIR_UPD);
 }
 
 static void __ldms_xprt_close(ldms_t x)
@@ -755,9 +1003,7 @@ static void process_set_delete_request(struct ldms_xprt *x, struct ldms_request
 	 * Always notify the application about peer set delete. If we happened
 	 * not to have the set yet, `event.set_delete.set` will be NULL.
 	 */
-	__ldms_set_tree_lock();
 	set = __ldms_find_local_set(req->set_delete.inst_name);
-	__ldms_set_tree_unlock();
 	if (set) {
 		if (set->xprt != x) {
 			assert(set->xprt != x);
@@ -816,6 +1062,103 @@ struct make_dir_arg {
 	ssize_t set_list_len;	/* current length of this buffer */
 };
 
+/*
+ * Reply to a requester that decodes the binary directory. If it holds the
+ * directory of this process as of generation `gn`, only the net changes
+ * since are sent (LDMS_DIR_REPLY_F_DELTA); otherwise every set is.
+ */
+static void process_dir_bin_request(struct ldms_xprt *x, struct ldms_request *req)
+{
+	struct ldms_dir_change_list list = TAILQ_HEAD_INITIALIZER(list);
+	struct ldms_dir_change *c;
+	uint64_t session = be64toh(req->dir.session);
+	uint64_t gn = be64toh(req->dir.gn);
+	uint32_t type = LDMS_DIR_LIST | LDMS_DIR_REPLY_F_BINARY;
+	struct dir_frame f;
+	struct ldms_reply reply;
+	zap_err_t zerr;
+	int rc;
+
+	pthread_mutex_lock(&dir_flush_lock);
+	if (gn && session == __ldms_dir_session() &&
+	    0 == __ldms_dir_changes(gn, &gn, &list)) {
+		type |= LDMS_DIR_REPLY_F_DELTA;
+	} else {
+		__ldms_dir_change_list_free(&list);
+		gn = __ldms_dir_gn();
+		rc = __ldms_dir_all(&list);
+		if (rc)
+			goto err;
+	}
+	rc = dir_frame_init(&f, x, LDMS_CMD_DIR_REPLY, type, req->hdr.xid,
+			    __ldms_dir_session(), gn);
+	if (rc)
+		goto err;
+	x->dir_caps = ntohl(req->dir.caps);
+	x->dir_gn = gn;
+	if (req->dir.flags)
+		/* Register for directory updates */
+		x->remote_dir_xid = req->hdr.xid;
+	else
+		/* Cancel any previous dir update */
+		x->remote_dir_xid = 0;
+	zerr = ZAP_ERR_OK;
+	TAILQ_FOREACH(c, &list, entry) {
+		rc = __ldms_dir_change_format(c, 0);
+		if (rc) {
+			XPRT_LOG(x, OVIS_LERROR, "%s: cannot format the directory "
+				 "record of set '%s', error %d\n",
+				 __func__, c->name, rc);
+			break;
+		}
+		if (!dir_change_access(x, c)) {
+			ovis_log(xlog, OVIS_LINFO,
+				"Access %o denied to user %d:%d for set '%s'.\n",
+				c->perm, c->uid, c->gid, c->name);
+			continue;
+		}
+		zerr = dir_frame_add(&f, c->bin, c->bin_len);
+		if (zerr)
+			break;
+		/* the record is not needed past this frame */
+		free(c->bin);
+		c->bin = NULL;
+	}
+	if (!rc && !zerr)
+		zerr = dir_frame_send(&f, 0);
+	dir_frame_free(&f);
+	if (rc || zerr) {
+		/* the peer does not have the directory */
+		x->remote_dir_xid = 0;
+		x->dir_gn = 0;
+	}
+	if (rc)
+		/* end the reply with the error rather than a partial list */
+		goto err;
+	pthread_mutex_unlock(&dir_flush_lock);
+	__ldms_dir_change_list_free(&list);
+	if (zerr)
+		ldms_xprt_close(x);
+	return;
+ err:
+	pthread_mutex_unlock(&dir_flush_lock);
+	__ldms_dir_change_list_free(&list);
+	reply.hdr.xid = req->hdr.xid;
+	reply.hdr.cmd = htonl(LDMS_CMD_DIR_REPLY);
+	reply.hdr.rc = htonl(rc);
+	reply.hdr.len = htonl(DIR_FRAME_HDRLEN);
+	reply.dir.more = 0;
+	reply.dir.type = htonl(LDMS_DIR_LIST);
+	reply.dir.json_data_len = 0;
+	zerr = zap_send(x->zap_ep, &reply, DIR_FRAME_HDRLEN);
+	if (zerr != ZAP_ERR_OK) {
+		x->zerrno = zerr;
+		XPRT_LOG(x, OVIS_LERROR, "%s: zap_send synchronously error."
+				" '%s'\n", __func__, zap_err_str(zerr));
+		ldms_xprt_close(x);
+	}
+}
+
 static void process_dir_request(struct ldms_xprt *x, struct ldms_request *req)
 {
 	size_t len;
@@ -831,6 +1174,17 @@ static void process_dir_request(struct ldms_xprt *x, struct ldms_request *req)
 
 	(void)clock_gettime(CLOCK_REALTIME, &start);
 
+	pthread_once(&dir_flush_once, dir_flush_init);
+	if (ntohl(req->hdr.len) >= sizeof(struct ldms_request_hdr) +
+				   sizeof(struct ldms_dir_cmd_param) &&
+	    (ntohl(req->dir.caps) & LDMS_DIR_CAP_BINARY)) {
+		process_dir_bin_request(x, req);
+		goto stats;
+	}
+
+	pthread_mutex_lock(&dir_flush_lock);
+	x->dir_caps = 0;
+	x->dir_gn = __ldms_dir_gn();
 	if (req->dir.flags)
 		/* Register for directory updates */
 		x->remote_dir_xid = req->hdr.xid;
@@ -887,18 +1241,19 @@ static void process_dir_request(struct ldms_xprt *x, struct ldms_request *req)
 				 __FUNCTION__, x, zap_err_str(zerr));
 		}
 		free(reply);
+		pthread_mutex_unlock(&dir_flush_lock);
 		return;
 	}
 	struct ldms_set *set;
 	LIST_FOREACH(name, &name_list, entry) {
-		__ldms_set_tree_lock();
 		set = __ldms_find_local_set(name->name);
-		__ldms_set_tree_unlock();
 		if (!set)
 			continue;
+		pthread_mutex_lock(&set->lock);
 		uid = __le32_to_cpu(set->meta->uid);
 		gid = __le32_to_cpu(set->meta->gid);
 		perm = __le32_to_cpu(set->meta->perm);
+		pthread_mutex_unlock(&set->lock);
 		last_set = (LIST_NEXT(name, entry) == 0);
 	restart:
 		last_cnt = cnt;	/* save current end of json */
@@ -974,6 +1329,8 @@ static void process_dir_request(struct ldms_xprt *x, struct ldms_request *req)
 	}
 	free(reply);
 	__ldms_empty_name_list(&name_list);
+	pthread_mutex_unlock(&dir_flush_lock);
+ stats:
 	(void)clock_gettime(CLOCK_REALTIME, &end);
 	dur_us = ldms_timespec_diff_us(&start, &end);
 	if (e->min_us > dur_us)
@@ -986,6 +1343,7 @@ static void process_dir_request(struct ldms_xprt *x, struct ldms_request *req)
 	e->mean_us /= e->count;
 	return;
 out:
+	pthread_mutex_unlock(&dir_flush_lock);
 	if (reply)
 		free(reply);
 	reply = &reply_;
@@ -1385,6 +1743,12 @@ static int __send_lookup_reply(struct ldms_xprt *x, struct ldms_set *set,
 	struct timespec *req_recv_ts, *share_ts;
 	char *prfl_marker;
 	size_t prfl_marker_len = strlen(LU_PARAM_PRFL_MARKER) + 1;
+	zap_map_t map;
+
+	/* A set with shared meta-data is served from its full wire image */
+	map = __ldms_set_export_map(set);
+	if (!map)
+		return ENOMEM;
 
 	pthread_mutex_lock(&set->lock);
 	__get_set_info_sz(set, &set_info_cnt, &set_info_len);
@@ -1427,7 +1791,7 @@ static int __send_lookup_reply(struct ldms_xprt *x, struct ldms_set *set,
 	msg->lookup.array_card = htonl(__le32_to_cpu(set->meta->array_card));
 	XPRT_LOG(x, OVIS_LDEBUG, "%s(): x %p: sharing ... remote lookup ctxt %p\n",
 							   __func__, x, (void *)xid);
-	zap_err_t zerr = zap_share(x->zap_ep, set->lmap, (const char *)msg, msg_len);
+	zap_err_t zerr = zap_share(x->zap_ep, map, (const char *)msg, msg_len);
 	if (zerr != ZAP_ERR_OK) {
 		x->zerrno = zerr;
 		rc = zap_zerr2errno(zerr);
@@ -1463,7 +1827,8 @@ static struct ldms_set *__next_re_match(struct ldms_set *set,
 					regex_t *regex, const char *regex_str, int flags)
 {
 	for (; set; set = __ldms_local_set_next(set)) {
-		if (__re_match(set, regex, regex_str, flags))
+		if (__ldms_set_published(set) &&
+		    __re_match(set, regex, regex_str, flags))
 			break;
 	}
 	return set;
@@ -1496,17 +1861,19 @@ static void process_lookup_request_re(struct ldms_xprt *x, struct ldms_request *
 			goto err_0;
 		}
 	} else if (0 == (flags & LDMS_LOOKUP_BY_SCHEMA)) {
-		__ldms_set_tree_lock();
 		set = __ldms_find_local_set(req->lookup.path);
+		if (set && !__ldms_set_published(set)) {
+			ref_put(&set->ref, "__ldms_find_local_set");
+			set = NULL;
+		}
 		if (!set) {
 			rc = ENOENT;
-			goto err_1;
+			goto err_0;
 		}
-		__ldms_set_tree_unlock();
 		rc = __send_lookup_reply(x, set, req->hdr.xid, 0);
 		ref_put(&set->ref, "__ldms_find_local_set");
 		if (rc)
-			goto err_1;
+			goto err_0;
 		return;
 	}
 
@@ -1626,7 +1993,15 @@ static int do_read_meta(ldms_t x, ldms_set_t s, ldms_update_cb_t cb, void *arg)
 	struct ldms_context *ctxt;
 	int rc;
 	uint32_t meta_sz = __le32_to_cpu(s->meta->meta_sz);
+	zap_map_t lmap = s->lmap;
 
+	if (s->meta_shr) {
+		/* The wire meta-data is read into a landing buffer */
+		rc = __ldms_set_meta_land_get(s);
+		if (rc)
+			return rc;
+		lmap = s->land_map;
+	}
 	ctxt = __ldms_alloc_ctxt(x, sizeof(*ctxt), LDMS_CONTEXT_UPDATE_META,
 							s, cb, arg, 0, 0);
 	if (!ctxt) {
@@ -1649,7 +2024,7 @@ static int do_read_meta(ldms_t x, ldms_set_t s, ldms_update_cb_t cb, void *arg)
 		}
 	}
 	rc = zap_read(x->zap_ep, s->rmap, zap_map_addr(s->rmap),
-			s->lmap, zap_map_addr(s->lmap), meta_sz, ctxt);
+			lmap, zap_map_addr(lmap), meta_sz, ctxt);
 	if (rc) {
 		x->zerrno = rc;
 		__ldms_free_ctxt(x, ctxt);
@@ -1666,7 +2041,7 @@ static int do_read_data(ldms_t x, ldms_set_t s, int idx_from, int idx_to,
 	int rc;
 	uint32_t data_sz;
 	struct ldms_context *ctxt;
-	size_t doff, dlen;
+	size_t roff, doff, dlen;
 
 	ctxt = __ldms_alloc_ctxt(x, sizeof(*ctxt), LDMS_CONTEXT_UPDATE,
 						s, cb, arg, idx_from, idx_to);
@@ -1675,6 +2050,8 @@ static int do_read_data(ldms_t x, ldms_set_t s, int idx_from, int idx_to,
 		goto out;
 	}
 	data_sz = __le32_to_cpu(s->meta->data_sz);
+	/* The local set omits the descriptors if they are shared */
+	roff = __le32_to_cpu(s->meta->meta_sz) + idx_from * data_sz;
 	doff = (uint8_t *)s->data_array - (uint8_t *)s->meta
 							+ idx_from * data_sz;
 	dlen = (idx_to - idx_from + 1) * data_sz;
@@ -1694,7 +2071,7 @@ static int do_read_data(ldms_t x, ldms_set_t s, int idx_from, int idx_to,
 			 */
 		}
 	}
-	rc = zap_read(x->zap_ep, s->rmap, zap_map_addr(s->rmap) + doff,
+	rc = zap_read(x->zap_ep, s->rmap, zap_map_addr(s->rmap) + roff,
 		      s->lmap, zap_map_addr(s->lmap) + doff, dlen, ctxt);
 	if (rc) {
 		x->zerrno = rc;
@@ -1715,18 +2092,12 @@ out:
  * they don't match, then the meta data is fetched and then the data
  * is fetched again.
  */
-int __ldms_remote_update(ldms_t x, ldms_set_t s, ldms_update_cb_t cb, void *arg)
+static int __remote_update_issue(ldms_t x, ldms_set_t s,
+				 ldms_update_cb_t cb, void *arg)
 {
-	assert(x == s->xprt);
-	if (!ldms_xprt_connected(x))
-		return ENOTCONN;
-
+	int rc;
 	if (!s->lmap || !s->rmap)
 		return EINVAL;
-
-	if (LDMS_XPRT_AUTH_GUARD(x))
-		return EPERM;
-	int rc;
 	uint32_t meta_meta_gn = __le32_to_cpu(s->meta->meta_gn);
 	uint32_t data_meta_gn = __le32_to_cpu(s->data->meta_gn);
 	uint32_t n = __le32_to_cpu(s->meta->array_card);
@@ -1738,7 +2109,7 @@ int __ldms_remote_update(ldms_t x, ldms_set_t s, ldms_update_cb_t cb, void *arg)
 	int idx_from, idx_to, idx_next, idx_curr;
 	zap_get_ep(x->zap_ep, "ldms_xprt:set_update", __func__, __LINE__);		/* Released in handle_zap_read_complete() */
 	if (meta_meta_gn == 0 || meta_meta_gn != data_meta_gn) {
-		if (s->curr_idx == (n-1)) {
+		if (s->curr_idx == (n-1) && !s->meta_shr) {
 			/* We can update the metadata along with the data */
 			rc = do_read_all(x, s, cb, arg);
 		} else {
@@ -1762,6 +2133,50 @@ int __ldms_remote_update(ldms_t x, ldms_set_t s, ldms_update_cb_t cb, void *arg)
 	return rc;
 }
 
+int __ldms_remote_update(ldms_t x, ldms_set_t s, ldms_update_cb_t cb, void *arg)
+{
+	assert(x == s->xprt);
+	if (!ldms_xprt_connected(x))
+		return ENOTCONN;
+
+	if (LDMS_XPRT_AUTH_GUARD(x))
+		return EPERM;
+
+	return __remote_update_issue(x, s, cb, arg);
+}
+
+/*
+ * Issue the update reads of a batch of sets looked up on the endpoint \c x.
+ *
+ * The connection and authentication state of the endpoint are checked once
+ * for the whole batch. The per-set status is returned in \c ents[i].rc. The
+ * caller must hold \c x->lock.
+ */
+int __ldms_remote_update_batch(ldms_t x, struct ldms_update_batch_ent_s *ents,
+			       int count, ldms_update_cb_t cb)
+{
+	int i, rc = 0;
+
+	if (!ldms_xprt_connected(x))
+		rc = ENOTCONN;
+	else if (LDMS_XPRT_AUTH_GUARD(x))
+		rc = EPERM;
+	if (rc) {
+		for (i = 0; i < count; i++)
+			ents[i].rc = rc;
+		return rc;
+	}
+
+	for (i = 0; i < count; i++) {
+		assert(x == ents[i].set->xprt);
+		ents[i].rc = __remote_update_issue(x, ents[i].set,
+						   cb, ents[i].cb_arg);
+		if (ents[i].rc && !rc)
+			rc = ents[i].rc;
+	}
+	return rc;
+}
+
 void __rail_process_send_quota(ldms_t x, struct ldms_request *req);
 void __rail_process_quota_reconfig(ldms_t x, struct ldms_request *req);
 void __rail_process_rate_reconfig(ldms_t x, struct ldms_request *req);
@@ -1890,100 +2305,84 @@ void process_dir_cancel_reply(struct ldms_xprt *x, struct ldms_reply *reply,
 }
 
 static int __process_dir_set_info(struct ldms_set *lset, enum ldms_dir_type type,
-				ldms_dir_set_t dset, json_entity_t info_list)
+				ldms_dir_set_t dset)
 {
-	json_entity_t info_entity, k, v;
 	int j, rc = 0  ;
 	int dir_upd = 0;
 	struct ldms_set_info_pair *pair, *nxt_pair;
 
-	if (lset)
-		pthread_mutex_lock(&lset->lock);
-	for (j = 0, info_entity = json_item_first(info_list); info_entity;
-	     info_entity = json_item_next(info_entity), j++) {
-		k = json_value_find(info_entity, "key");
-		v = json_value_find(info_entity, "value");
-		char *nkey = strdup(json_value_str(k)->str);
-		char *nvalue = strdup(json_value_str(v)->str);
-		if (!nkey || !nvalue) {
-			free(nkey);
-			free(nvalue);
-			rc = ENOMEM;
-			goto out;
-		}
-		dset->info[j].key = nkey;
-		dset->info[j].value = nvalue;
-
-		if (lset) {
-			const char *key = dset->info[j].key;
-			const char *val = dset->info[j].value;
-			rc = __ldms_set_info_set(&lset->remote_info, key, val);
-			if (rc > 0)
-				goto out;
-			else if (rc == 0)
-				dir_upd = 1;
-			else
-				rc = 0; /* no change */
-		}
-	}
 	if (!lset)
 		return 0;
 
+	pthread_mutex_lock(&lset->lock);
+	for (j = 0; j < dset->info_count; j++) {
+		const char *key = dset->info[j].key;
+		const char *val = dset->info[j].value;
+		rc = __ldms_set_info_set(&lset->remote_info, key, val);
+		if (rc > 0)
+			goto out;
+		else if (rc == 0)
+			dir_upd = 1;
+		else
+			rc = 0; /* no change */
+	}
+
 	pair = LIST_FIRST(&lset->remote_info);
 	while (pair) {
 		nxt_pair = LIST_NEXT(pair, entry);
-		for (j = 0, info_entity = json_item_first(info_list); info_entity;
-				info_entity = json_item_next(info_entity)) {
-			k = json_value_find(info_entity, "key");
-			if (0 == strcmp(pair->key, json_value_str(k)->str))
+		for (j = 0; j < dset->info_count; j++) {
+			if (0 == strcmp(pair->key, dset->info[j].key))
 				break;
 		}
-		if (!info_entity) {
+		if (j == dset->info_count) {
 			__ldms_set_info_unset(pair);
 			dir_upd = 1;
 		}
 		pair = nxt_pair;
 	}
 out:
-	if (lset) {
-		pthread_mutex_unlock(&lset->lock);
-		if (!rc) {
-			if ((type == LDMS_DIR_UPD) && dir_upd &&
-					(lset->flags & LDMS_SET_F_PUBLISHED)) {
-				__ldms_dir_upd_set(lset);
-			}
+	pthread_mutex_unlock(&lset->lock);
+	if (!rc) {
+		if ((type == LDMS_DIR_UPD) && dir_upd &&
+				(lset->flags & LDMS_SET_F_PUBLISHED)) {
+			__ldms_dir_upd_set(lset);
 		}
 	}
 	return rc;
 }
 
+/* If this set is in our local set tree, update it's set info */
+static int __process_dir_local_set(enum ldms_dir_type type, ldms_dir_set_t dset)
+{
+	struct ldms_set *lset;
+	int rc;
+
+	if (!dset->info_count)
+		return 0;
+	__ldms_set_tree_lock();
+	lset = __ldms_find_local_set(dset->inst_name);
+	rc = __process_dir_set_info(lset, type, dset);
+	if (lset)
+		ref_put(&lset->ref, "__ldms_find_local_set");
+	__ldms_set_tree_unlock();
+	return rc;
+}
+
 static
-void __process_dir_reply(struct ldms_xprt *x, struct ldms_reply *reply,
-		       struct ldms_context *ctxt, int more)
+int __process_dir_json_reply(struct ldms_xprt *x, struct ldms_reply *reply,
+			     int more, ldms_dir_t *pdir)
 {
 	enum ldms_dir_type type = ntohl(reply->dir.type);
-	int i, rc = ntohl(reply->hdr.rc);
+	int i, j, rc;
 	size_t count, json_data_len;
 	ldms_dir_t dir = NULL;
 	json_parser_t p = NULL;
-	json_entity_t dir_attr, dir_list, set_entity, info_list;
+	json_entity_t dir_attr, dir_list, set_entity, info_list, info_entity;
 	json_entity_t dir_entity = NULL;
-	struct ldms_set *lset;
-	ldms_stats_entry_t e = &x->stats.ops[LDMS_XPRT_OP_DIR_REQ];
-	int64_t dur_us;
-	struct timespec end, start;
 
 	json_data_len = ntohl(reply->hdr.len) - sizeof(struct ldms_reply_hdr)
 				- sizeof(struct ldms_dir_reply);
 
-	if (!ctxt->dir.cb)
-		return;
-
-	if (rc)
-		goto out;
-
-	(void)clock_gettime(CLOCK_REALTIME, &start);
-
 	p = json_parser_new(0);
 	if (!p) {
 		rc = ENOMEM;
@@ -2007,7 +2406,7 @@ void __process_dir_reply(struct ldms_xprt *x, struct ldms_reply *reply,
 	}
 	count = json_list_len(dir_list);
 
-	dir = malloc(sizeof (*dir) +
+	dir = calloc(1, sizeof (*dir) +
 		     (count * sizeof(void *)) +
 		     (count * sizeof(struct ldms_dir_set_s)));
 	rc = ENOMEM;
@@ -2088,31 +2487,220 @@ void __process_dir_reply(struct ldms_xprt *x, struct ldms_reply *reply,
 			dir->set_data[i].info = NULL;
 			continue;
 		}
-		dir->set_data[i].info = malloc(sizeof(struct ldms_key_value_s) * info_count);
+		dir->set_data[i].info = calloc(info_count, sizeof(struct ldms_key_value_s));
 		if (!dir->set_data[i].info) {
 			rc = ENOMEM;
 			goto out;
 		}
-
-		/* If this set is in our local set tree, update it's set info */
-		__ldms_set_tree_lock();
 		dir->set_data[i].info_count = info_count;
-		lset = __ldms_find_local_set(dir->set_data[i].inst_name);
-		rc = __process_dir_set_info(lset, type, &dir->set_data[i], info_list);
-		if (lset)
-			ref_put(&lset->ref, "__ldms_find_local_set");
-		__ldms_set_tree_unlock();
+		for (j = 0, info_entity = json_item_first(info_list); info_entity;
+		     info_entity = json_item_next(info_entity), j++) {
+			e = json_value_find(info_entity, "key");
+			dir->set_data[i].info[j].key = strdup(json_value_str(e)->str);
+			e = json_value_find(info_entity, "value");
+			dir->set_data[i].info[j].value = strdup(json_value_str(e)->str);
+			if (!dir->set_data[i].info[j].key ||
+			    !dir->set_data[i].info[j].value) {
+				rc = ENOMEM;
+				goto out;
+			}
+		}
+
+		rc = __process_dir_local_set(type, &dir->set_data[i]);
 		if (rc)
 			break;
 	}
 
 out:
-	/* Callback owns dir memory. */
-	ctxt->dir.cb((ldms_t)x, rc, rc ? NULL : dir, ctxt->dir.cb_arg);
 	json_entity_free(dir_entity);
 	json_parser_free(p);
-	if (rc && dir)
+	if (rc && dir) {
+		ldms_xprt_dir_free(x, dir);
+		dir = NULL;
+	}
+	*pdir = dir;
+	return rc;
+}
+
+/*
+ * Hand the records of type `type` in `dir` to the application in a
+ * directory of their own; the records are moved out of `dir`.
+ */
+static void __dir_deliver_type(struct ldms_xprt *x, struct ldms_context *ctxt,
+			       ldms_dir_t dir, uint8_t *types,
+			       enum ldms_dir_type type)
+{
+	ldms_dir_t tdir;
+	int i, count = 0;
+
+	for (i = 0; i < dir->set_count; i++) {
+		if (types[i] == type)
+			count++;
+	}
+	if (!count)
+		return;
+	tdir = malloc(sizeof(*tdir) + count * sizeof(struct ldms_dir_set_s));
+	if (!tdir) {
+		ctxt->dir.cb((ldms_t)x, ENOMEM, NULL, ctxt->dir.cb_arg);
+		return;
+	}
+	tdir->type = type;
+	tdir->more = 0;
+	tdir->set_count = 0;
+	for (i = 0; i < dir->set_count; i++) {
+		if (types[i] != type)
+			continue;
+		tdir->set_data[tdir->set_count++] = dir->set_data[i];
+		memset(&dir->set_data[i], 0, sizeof(dir->set_data[i]));
+	}
+	/* Callback owns dir memory. */
+	ctxt->dir.cb((ldms_t)x, 0, tdir, ctxt->dir.cb_arg);
+}
+
+/*
+ * A binary directory is one or more LDMS_DIR_LIST frames, or an update
+ * with ADD, UPD and DEL records. With a directory cache the application
+ * is given the complete cached directory at the end of the list.
+ */
+static
+void __process_dir_bin_reply(struct ldms_xprt *x, struct ldms_reply *reply,
+			     struct ldms_context *ctxt)
+{
+	uint32_t rtype = ntohl(reply->dir.type);
+	enum ldms_dir_type type = rtype & LDMS_DIR_REPLY_TYPE_MASK;
+	int more = ntohl(reply->dir.more);
+	ldms_dir_cache_t c = ctxt->dir.cache;
+	ldms_dir_t dir = NULL, list;
+	uint8_t *types = NULL;
+	uint64_t session, gn;
+	size_t len;
+	int i, found, rc;
+
+	len = ntohl(reply->hdr.len) - DIR_FRAME_HDRLEN;
+	rc = __ldms_dir_bin_decode(reply->dir.json_data, len,
+				   &session, &gn, &dir, &types);
+	if (rc)
+		goto err;
+	for (i = 0; i < dir->set_count; i++) {
+		if (types[i] == LDMS_DIR_DEL)
+			continue;
+		rc = __process_dir_local_set(type, &dir->set_data[i]);
+		if (rc)
+			goto err;
+	}
+
+	if (type == LDMS_DIR_LIST && !c) {
+		dir->type = LDMS_DIR_LIST;
+		dir->more = more;
+		ctxt->dir.cb((ldms_t)x, 0, dir, ctxt->dir.cb_arg);
+		goto out;
+	}
+
+	if (type == LDMS_DIR_LIST) {
+		__ldms_dir_cache_lock(c);
+		if (!ctxt->dir.in_list) {
+			ctxt->dir.in_list = 1;
+			if (!(rtype & LDMS_DIR_REPLY_F_DELTA))
+				__ldms_dir_cache_mark(c);
+		}
+		for (i = 0; i < dir->set_count; i++)
+			(void)__ldms_dir_cache_apply(c, &dir->set_data[i],
+						     types[i], &found);
+		if (more) {
+			__ldms_dir_cache_unlock(c);
+			goto out;
+		}
+		ctxt->dir.in_list = 0;
+		if (!(rtype & LDMS_DIR_REPLY_F_DELTA))
+			__ldms_dir_cache_sweep(c);
+		__ldms_dir_cache_gn_set(c, session, gn);
+		list = __ldms_dir_cache_list(c);
+		__ldms_dir_cache_unlock(c);
+		if (!list) {
+			rc = ENOMEM;
+			goto err;
+		}
+		ctxt->dir.cb((ldms_t)x, 0, list, ctxt->dir.cb_arg);
+		goto out;
+	}
+
+	if (c) {
+		__ldms_dir_cache_lock(c);
+		for (i = 0; i < dir->set_count; i++) {
+			(void)__ldms_dir_cache_apply(c, &dir->set_data[i],
+						     types[i], &found);
+			/* the set may have been in the directory reply */
+			if (types[i] == LDMS_DIR_ADD && found)
+				types[i] = LDMS_DIR_UPD;
+			else if (types[i] == LDMS_DIR_UPD && !found)
+				types[i] = LDMS_DIR_ADD;
+		}
+		if (session)
+			__ldms_dir_cache_gn_set(c, session, gn);
+		else
+			/* the peer could not keep track of its changes */
+			__ldms_dir_cache_gn_set(c, 0, 0);
+		__ldms_dir_cache_unlock(c);
+	}
+	/* deleted sets are reported by the set delete handshake */
+	__dir_deliver_type(x, ctxt, dir, types, LDMS_DIR_ADD);
+	__dir_deliver_type(x, ctxt, dir, types, LDMS_DIR_UPD);
+	ldms_xprt_dir_free(x, dir);
+	goto out;
+
+ err:
+	ldms_xprt_dir_free(x, dir);
+	dir = NULL;
+	if (c) {
+		__ldms_dir_cache_lock(c);
+		ctxt->dir.in_list = 0;
+		__ldms_dir_cache_gn_set(c, 0, 0);
+		__ldms_dir_cache_unlock(c);
+	}
+	ctxt->dir.cb((ldms_t)x, rc, NULL, ctxt->dir.cb_arg);
+ out:
+	if (type == LDMS_DIR_LIST && c && dir)
 		ldms_xprt_dir_free(x, dir);
+	free(types);
+}
+
+static
+void __process_dir_reply(struct ldms_xprt *x, struct ldms_reply *reply,
+		       struct ldms_context *ctxt, int more)
+{
+	int rc = ntohl(reply->hdr.rc);
+	ldms_dir_t dir = NULL;
+	ldms_stats_entry_t e = &x->stats.ops[LDMS_XPRT_OP_DIR_REQ];
+	int64_t dur_us;
+	struct timespec end, start;
+
+	if (!ctxt->dir.cb)
+		return;
+
+	(void)clock_gettime(CLOCK_REALTIME, &start);
+
+	if (rc) {
+		if (ctxt->dir.cache) {
+			/* the list may have ended early with the error */
+			__ldms_dir_cache_lock(ctxt->dir.cache);
+			ctxt->dir.in_list = 0;
+			__ldms_dir_cache_gn_set(ctxt->dir.cache, 0, 0);
+			__ldms_dir_cache_unlock(ctxt->dir.cache);
+		}
+		ctxt->dir.cb((ldms_t)x, rc, NULL, ctxt->dir.cb_arg);
+		goto out;
+	}
+
+	if (ntohl(reply->dir.type) & LDMS_DIR_REPLY_F_BINARY) {
+		__process_dir_bin_reply(x, reply, ctxt);
+		goto out;
+	}
+
+	rc = __process_dir_json_reply(x, reply, more, &dir);
+	/* Callback owns dir memory. */
+	ctxt->dir.cb((ldms_t)x, rc, rc ? NULL : dir, ctxt->dir.cb_arg);
+
+out:
 	(void)clock_gettime(CLOCK_REALTIME, &end);
 	dur_us = ldms_timespec_diff_us(&start, &end);
 	if (e->min_us > dur_us)
@@ -2197,10 +2785,8 @@ static void process_push_reply(struct ldms_xprt *x, struct ldms_reply *reply,
 		return; /* NOTE should we terminate the xprt? */
 
 	/* Copy the data to the metric set */
-	if (data_len) {
-		memcpy((char *)set->meta + data_off,
-					reply->push.data, data_len);
-	}
+	if (data_len)
+		__ldms_set_wire_write(set, data_off, reply->push.data, data_len);
 	if (set->push_cb &&
 		(0 == (ntohl(reply->push.flags) & LDMS_CMD_PUSH_REPLY_F_MORE))) {
 		set->push_cb(x, set, ntohl(reply->push.flags), set->push_cb_arg);
@@ -2498,6 +3084,7 @@ static void __handle_update_data(ldms_t x, struct ldms_context *ctxt,
 		goto cleanup;
 	}
 	n = __le32_to_cpu(set->meta->array_card);
+	__ldms_set_export_sync(set);
 
 	data = __ldms_set_array_get(set, ctxt->update.idx_from);
 	prev_data = __ldms_set_array_get(set, set->curr_idx);
@@ -2567,7 +3154,17 @@ static void __handle_update_meta(ldms_t x, struct ldms_context *ctxt,
 	ldms_set_t set = ctxt->update.s;
 	int idx = (set->curr_idx + 1) % __le32_to_cpu(set->meta->array_card);
 
-	rc = do_read_data(x, set, idx, idx, ctxt->update.cb, ctxt->update.cb_arg);
+	rc = 0;
+	if (set->meta_shr) {
+		/* Copy the landed meta-data into the set */
+		if (ev->status == ZAP_ERR_OK)
+			rc = __ldms_set_meta_land_apply(set);
+		else
+			rc = zap_zerr2errno(ev->status);
+		__ldms_set_meta_land_put(set);
+	}
+	if (!rc)
+		rc = do_read_data(x, set, idx, idx, ctxt->update.cb, ctxt->update.cb_arg);
 	if (rc) {
 		ctxt->update.cb(x, set, LDMS_UPD_ERROR(rc), ctxt->update.cb_arg);
 		zap_put_ep(x->zap_ep, "ldms_xprt:set_update", __func__, __LINE__);
@@ -2599,6 +3196,8 @@ static void __handle_lookup(ldms_t x, struct ldms_context *ctxt,
 		 */
 		__ldms_set_delete(ctxt->lu_read.s, 0);
 	} else {
+		/* Share the meta-data with sets of the same schema if enabled */
+		(void)__ldms_set_meta_share(ctxt->lu_read.s);
 		ldms_set_publish(ctxt->lu_read.s);
 	}
 	ctxt->lu_read.cb((ldms_t)x, status, ctxt->lu_read.more,
@@ -2797,9 +3396,7 @@ static void handle_rendezvous_lookup(zap_ep_t zep, zap_event_t ev,
 	schema_name = (ldms_name_t)lu->set_info;
 	inst_name = (ldms_name_t)&(schema_name->name[schema_name->len]);
 
-	__ldms_set_tree_lock();
 	lset = __ldms_find_local_set(inst_name->name);
-	__ldms_set_tree_unlock();
 
 	if (lset) {
 		rc = EEXIST;
@@ -3398,7 +3995,8 @@ static void __ldms_xprt_close(ldms_t x);
 static int __ldms_xprt_send(ldms_t x, char *msg_buf, size_t msg_len,
 					struct ldms_op_ctxt *op_ctxt);
 static size_t __ldms_xprt_msg_max(ldms_t x);
-static int __ldms_xprt_dir(ldms_t x, ldms_dir_cb_t cb, void *cb_arg, uint32_t flags);
+static int __ldms_xprt_dir(ldms_t x, ldms_dir_cb_t cb, void *cb_arg, uint32_t flags,
+			   ldms_dir_cache_t cache);
 static int __ldms_xprt_lookup(ldms_t x, const char *path, enum ldms_lookup_flags flags,
 		     ldms_lookup_cb_t cb, void *cb_arg, struct ldms_op_ctxt *op_ctxt);
 static int __ldms_xprt_stats(ldms_t x, ldms_xprt_stats_t stats, int mask, int is_reset);
@@ -3415,6 +4013,8 @@ static void __ldms_xprt_cred_get(ldms_t x, ldms_cred_t lcl, ldms_cred_t rmt);
 static void __ldms_xprt_event_cb_set(ldms_t x, ldms_event_cb_t cb, void *cb_arg);
 int __ldms_xprt_update(ldms_t x, struct ldms_set *set, ldms_update_cb_t cb, void *arg,
                                                          struct ldms_op_ctxt *op_ctxt);
+int __ldms_xprt_update_batch(ldms_t x, struct ldms_update_batch_ent_s *ents,
+			     int count, ldms_update_cb_t cb);
 int __ldms_xprt_get_threads(ldms_t x, pthread_t *out, int n);
 zap_ep_t __ldms_xprt_get_zap_ep(ldms_t x);
 static ldms_set_t __ldms_xprt_set_by_name(ldms_t x, const char *set_name);
@@ -3442,6 +4042,7 @@ static const struct ldms_xprt_ops_s ldms_xprt_ops = {
 	.cred_get     = __ldms_xprt_cred_get,
 
 	.update       = __ldms_xprt_update,
+	.update_batch = __ldms_xprt_update_batch,
 
 	.get_threads  = __ldms_xprt_get_threads,
 	.get_zap_ep   = __ldms_xprt_get_zap_ep,
@@ -3601,12 +4202,15 @@ size_t format_lookup_req(struct ldms_request *req, enum ldms_lookup_flags flags,
 }
 
 size_t format_dir_req(struct ldms_request *req, uint64_t xid,
-		      uint32_t flags)
+		      uint32_t flags, uint64_t session, uint64_t gn)
 {
 	size_t len;
 	req->hdr.xid = xid;
 	req->hdr.cmd = htonl(LDMS_CMD_DIR);
 	req->dir.flags = htonl(flags);
+	req->dir.caps = htonl(LDMS_DIR_CAP_BINARY);
+	req->dir.session = htobe64(session);
+	req->dir.gn = htobe64(gn);
 	len = sizeof(struct ldms_request_hdr) +
 		sizeof(struct ldms_dir_cmd_param);
 	req->hdr.len = htonl(len);
@@ -3744,11 +4348,13 @@ size_t ldms_xprt_msg_max(ldms_t x)
 	return x->ops.msg_max(x);
 }
 
-int __ldms_remote_dir(ldms_t _x, ldms_dir_cb_t cb, void *cb_arg, uint32_t flags)
+int __ldms_remote_dir(ldms_t _x, ldms_dir_cb_t cb, void *cb_arg,
+		      uint32_t flags, ldms_dir_cache_t cache)
 {
 	struct ldms_xprt *x = _x;
 	struct ldms_request *req;
 	struct ldms_context *ctxt;
+	uint64_t session = 0, gn = 0;
 	size_t len;
 
 	if (!ldms_xprt_connected(x))
@@ -3772,8 +4378,12 @@ int __ldms_remote_dir(ldms_t _x, ldms_dir_cb_t cb, void *cb_arg, uint32_t flags)
 		ldms_xprt_put(x, "dir");
 		return ENOMEM;
 	}
+	ctxt->dir.cache = cache;
+	if (cache)
+		__ldms_dir_cache_gn_get(cache, &session, &gn);
 	req = (struct ldms_request *)(ctxt + 1);
-	len = format_dir_req(req, (uint64_t)(unsigned long)ctxt, flags);
+	len = format_dir_req(req, (uint64_t)(unsigned long)ctxt, flags,
+			     session, gn);
 	if (flags)
 		x->local_dir_xid = (uint64_t)ctxt;
 	pthread_mutex_unlock(&x->lock);
@@ -3800,14 +4410,21 @@ int __ldms_remote_dir(ldms_t _x, ldms_dir_cb_t cb, void *cb_arg, uint32_t flags)
 	return zap_zerr2errno(zerr);
 }
 
-static int __ldms_xprt_dir(ldms_t x, ldms_dir_cb_t cb, void *cb_arg, uint32_t flags)
+static int __ldms_xprt_dir(ldms_t x, ldms_dir_cb_t cb, void *cb_arg,
+			   uint32_t flags, ldms_dir_cache_t cache)
 {
-	return __ldms_remote_dir(x, cb, cb_arg, flags);
+	return __ldms_remote_dir(x, cb, cb_arg, flags, cache);
 }
 
 int ldms_xprt_dir(ldms_t x, ldms_dir_cb_t cb, void *cb_arg, uint32_t flags)
 {
-	return x->ops.dir(x, cb, cb_arg, flags);
+	return x->ops.dir(x, cb, cb_arg, flags, NULL);
+}
+
+int ldms_xprt_dir_cached(ldms_t x, ldms_dir_cb_t cb, void *cb_arg,
+			 uint32_t flags, ldms_dir_cache_t cache)
+{
+	return x->ops.dir(x, cb, cb_arg, flags, cache);
 }
 
 /* This request has no reply */
@@ -3883,9 +4500,7 @@ int __ldms_remote_lookup(ldms_t _x, const char *path,
 	if (LDMS_XPRT_AUTH_GUARD(x))
 		return EPERM;
 
-	__ldms_set_tree_lock();
 	struct ldms_set *set = __ldms_find_local_set(path);
-	__ldms_set_tree_unlock();
 	if (set) {
 		ldms_set_put(set);
 		return EEXIST;
@@ -4384,7 +4999,8 @@ int __ldms_xprt_push(ldms_set_t set, int push_flags)
 			doff = 0;
 		} else {
 			len = meta_data_heap_sz;
-			doff = (uint8_t *)set->data - (uint8_t *)set->meta;
+			doff = meta_meta_sz + ((uint8_t *)set->data
+					       - (uint8_t *)set->data_array);
 		}
 		size_t hdr_len = sizeof(struct ldms_reply_hdr)
 			+ sizeof(struct ldms_push_reply);
@@ -4418,7 +5034,9 @@ int __ldms_xprt_push(ldms_set_t set, int push_flags)
 			reply->push.flags |= htonl(LDMS_UPD_F_PUSH);
 			if (p->push_flags & LDMS_RBD_F_PUSH_CANCEL)
 				reply->push.flags |= htonl(LDMS_UPD_F_PUSH_LAST);
-			memcpy(reply->push.data, (unsigned char *)set->meta + doff, data_len);
+			rc = __ldms_set_wire_read(set, doff, reply->push.data, data_len);
+			if (rc)
+				break;
 			rc = zap_send(x->zap_ep, reply, hdr_len + data_len);
 			if (rc)
 				break;
@@ -4529,9 +5147,7 @@ static ldms_set_t __ldms_xprt_set_by_name(ldms_t x, const char *set_name)
 
 	assert(XTYPE_IS_LEGACY(x->xtype));
 
-	__ldms_set_tree_lock();
 	set = __ldms_find_local_set(set_name);
-	__ldms_set_tree_unlock();
 	if (!set)
 		return NULL;
 	pthread_mutex_lock(&x->lock);
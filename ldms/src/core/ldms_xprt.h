@@ -193,8 +193,18 @@ struct ldms_lookup_cmd_param {
 
 struct ldms_dir_cmd_param {
 	uint32_t flags;		/*! Directory update flags */
+	/*
+	 * The fields below are not sent by peers older than the binary
+	 * directory (see hdr.len); those peers also ignore them.
+	 */
+	uint32_t caps;		/*! LDMS_DIR_CAP_* the requester can decode */
+	uint64_t session;	/*! Peer directory session of the cached directory */
+	uint64_t gn;		/*! Peer directory generation of the cached directory */
 };
 
+/* The requester decodes the binary directory records */
+#define LDMS_DIR_CAP_BINARY	0x1
+
 struct ldms_set_delete_cmd_param {
 	uint32_t inst_name_len;
 	char inst_name[OVIS_FLEX];
@@ -319,6 +329,47 @@ struct ldms_dir_reply {
 	char json_data[OVIS_FLEX];
 };
 
+/*
+ * Binary directory messages are only sent to requesters that asked for
+ * LDMS_DIR_CAP_BINARY; the flags below are or'ed into ldms_dir_reply.type
+ * and json_data holds an ldms_dir_bin_hdr followed by the set records.
+ */
+#define LDMS_DIR_REPLY_TYPE_MASK	0xff
+#define LDMS_DIR_REPLY_F_BINARY		0x100
+#define LDMS_DIR_REPLY_F_DELTA		0x200	/* changes since the requester's gn */
+
+struct ldms_dir_bin_hdr {
+	uint64_t session;	/* directory session of the sender */
+	uint64_t gn;		/* directory generation after this message */
+	uint32_t rec_count;	/* number of records */
+	uint32_t reserved;
+	char recs[OVIS_FLEX];	/* struct ldms_dir_bin_rec ... */
+};
+
+struct ldms_dir_bin_rec {
+	uint32_t rec_len;	/* record length with strings, 8-byte aligned */
+	uint8_t type;		/* enum ldms_dir_type of the record */
+	char flags[3];		/* set state flags (ldms_dir_set_s.flags) */
+	uint32_t meta_sz;
+	uint32_t data_sz;
+	uint32_t heap_sz;
+	uint32_t uid;
+	uint32_t gid;
+	uint32_t perm;
+	uint32_t card;
+	uint32_t array_card;
+	uint64_t meta_gn;
+	uint64_t data_gn;
+	struct ldms_timestamp timestamp;
+	struct ldms_timestamp duration;
+	uint16_t name_len;	/* with the terminating '\0' */
+	uint16_t schema_len;	/* with the terminating '\0' */
+	uint16_t info_count;	/* key/value string pairs after schema */
+	uint16_t has_digest;
+	uint8_t digest[LDMS_DIGEST_LENGTH];
+	char strs[OVIS_FLEX];	/* name, schema, key, value, ... */
+};
+
 struct ldms_req_notify_reply {
 	struct ldms_notify_event_s event;
 };
@@ -391,6 +442,8 @@ struct ldms_context {
 		struct {
 			ldms_dir_cb_t cb;
 			void *cb_arg;
+			ldms_dir_cache_t cache;
+			int in_list; /* receiving the frames of a binary LIST */
 		} dir;
 		struct {
 			ldms_lookup_cb_t cb;
@@ -461,7 +514,8 @@ struct ldms_xprt_ops_s {
 	void (*close)(ldms_t x);
 	int (*send)(ldms_t x, char *msg_buf, size_t msg_len, struct ldms_op_ctxt *op_ctxt);
 	size_t (*msg_max)(ldms_t x);
-	int (*dir)(ldms_t x, ldms_dir_cb_t cb, void *cb_arg, uint32_t flags);
+	int (*dir)(ldms_t x, ldms_dir_cb_t cb, void *cb_arg, uint32_t flags,
+		   ldms_dir_cache_t cache);
 	int (*dir_cancel)(ldms_t x);
 	int (*lookup)(ldms_t t, const char *name, enum ldms_lookup_flags flags,
 		       ldms_lookup_cb_t cb, void *cb_arg, struct ldms_op_ctxt *op_ctxt);
@@ -477,6 +531,8 @@ struct ldms_xprt_ops_s {
 	void (*cred_get)(ldms_t x, ldms_cred_t lcl, ldms_cred_t rmt);
 	int (*update)(ldms_t x, struct ldms_set *set, ldms_update_cb_t cb, void *arg,
 	                                               struct ldms_op_ctxt *op_ctxt);
+	int (*update_batch)(ldms_t x, struct ldms_update_batch_ent_s *ents,
+			    int count, ldms_update_cb_t cb);
 
 	int (*get_threads)(ldms_t x, pthread_t *out, int n);
 
@@ -516,6 +572,9 @@ struct ldms_xprt {
 	uint64_t local_dir_xid;
 	/* This is the peers local_dir_xid that we provide when providing dir updates */
 	uint64_t remote_dir_xid;
+	/* LDMS_DIR_CAP_* of the peer and the directory generation it has */
+	uint32_t dir_caps;
+	uint64_t dir_gn;
 
 #ifdef DEBUG
 	int active_dir; /* Number of outstanding dir requests */
@@ -603,18 +603,13 @@ static int as_is_decompose(ldmsd_strgp_t strgp, ldms_set_t set,
 	TAILQ_HEAD(, _list_entry) list_cols;
 	int row_more_le;
 	struct ldms_timestamp ts;
-	const char *set_schema;
-	int row_schema_name_len;
 	ldms_mval_t phony;
-	char *row_schema_name = NULL;
 
 	if (!TAILQ_EMPTY(row_list))
 		return EINVAL;
 
 	ts = ldms_transaction_timestamp_get(set);
 
-	set_schema = ldms_set_schema_name_get(set);
-
 	TAILQ_INIT(&list_cols);
 	ldms_digest = ldms_set_digest_get(set);
 
@@ -624,16 +619,9 @@ static int as_is_decompose(ldmsd_strgp_t strgp, ldms_set_t set,
 	 * The schema format is "<schema_name>_<short_sha>", where the
 	 * "<short_sha>" is the first 7 characters of the hex string
 	 * representation of the SHA (similar to git short commit ID).
+	 * The name is made once per schema digest by get_row_cfg().
 	 *
 	 */
-	row_schema_name_len = asprintf(&row_schema_name, "%s_%02hhx%02hhx%02hhx%hhx", set_schema,
-			ldms_digest->digest[0],
-			ldms_digest->digest[1],
-			ldms_digest->digest[2],
-			(unsigned char)(ldms_digest->digest[3] >> 4));
-	if (row_schema_name_len < 0)
-		return errno;
-
 	drow = get_row_cfg(dcfg, set);
 	if (!drow)
 		return errno;
@@ -645,7 +633,8 @@ static int as_is_decompose(ldmsd_strgp_t strgp, ldms_set_t set,
 	/* col_mvals is a temporary scratch paper to create rows from
 	 * a set with records. col_mvals is freed at the end of
 	 * `make_row`. */
-	col_mvals = calloc(col_count, sizeof(col_mvals[0]));
+	ldmsd_row_arena_reserve(col_count * sizeof(col_mvals[0]) + drow->row_sz);
+	col_mvals = ldmsd_row_arena_alloc(col_count * sizeof(col_mvals[0]));
 	if (!col_mvals) {
 		rc = ENOMEM;
 		goto err_0;
@@ -735,7 +724,7 @@ static int as_is_decompose(ldmsd_strgp_t strgp, ldms_set_t set,
 	}
 
  make_row: /* make/expand rows according to col_mvals */
-	row = calloc( 1, drow->row_sz );
+	row = ldmsd_row_arena_alloc(drow->row_sz);
 	if (!row) {
 		rc = errno;
 		goto err_0;
@@ -839,13 +828,13 @@ static int as_is_decompose(ldmsd_strgp_t strgp, ldms_set_t set,
 	row = NULL;
 	if (row_more_le)
 		goto make_row;
-	free(col_mvals);
+	ldmsd_row_arena_free(col_mvals);
 	col_mvals = NULL;
 	return 0;
  err_0:
 	/* clean up stuff here */
 	if (col_mvals)
-		free(col_mvals);
+		ldmsd_row_arena_free(col_mvals);
 	as_is_release_rows(strgp, row_list);
 	return rc;
 }
@@ -856,6 +845,6 @@ static void as_is_release_rows(ldmsd_strgp_t strgp,
 	ldmsd_row_t row;
 	while ((row = TAILQ_FIRST(row_list))) {
 		TAILQ_REMOVE(row_list, row, entry);
-		free(row);
+		ldmsd_row_arena_free(row);
 	}
 }
@@ -730,7 +730,8 @@ static void flex_release_rows(ldmsd_strgp_t strgp,
 	ldmsd_row_t row;
 	while ((row = TAILQ_FIRST(row_list))) {
 		TAILQ_REMOVE(row_list, row, entry);
-		free(row);
+		/* rows of the static and as_is decomposers are from the arena */
+		ldmsd_row_arena_free(row);
 	}
 }
 
@@ -63,6 +63,7 @@
 
 #include "ldmsd.h"
 #include "ldmsd_request.h"
+#include "decomp_static_kernel.h"
 
 static ovis_log_t static_log;
 /* convenient macro to put error message in both ldmsd log and `reqc` */
@@ -262,6 +263,7 @@ typedef struct decomp_static_col_cfg_s {
 	int fill_len; /* if fill is an array */
 	union ldms_value __fill; /* storing a non-array primitive fill value */
 	enum ldmsd_decomp_op op;
+	decomp_static_kernel_t kernel; /* op kernel for the column type */
 	size_t mval_offset;
 	size_t mval_size;
 } *decomp_static_col_cfg_t;
@@ -1119,6 +1121,19 @@ commit:
 	/* update mval_offset */
 	ctxt->mval_offset += LDMS_ROUNDUP(cfg_col->mval_size, sizeof(uint64_t));
 
+	/* the column type is known now; pick the operator kernel */
+	if (cfg_col->op != LDMSD_DECOMP_OP_NONE && !cfg_col->kernel) {
+		cfg_col->kernel = decomp_static_kernel_get(cfg_col->op, cfg_col->type);
+		if (!cfg_col->kernel)
+			ovis_log(static_log, OVIS_LWARNING,
+				 "strgp '%s': functional operator '%s' is not "
+				 "supported on column '%s' of type %s, the "
+				 "column value is stored unmodified.\n",
+				 ctxt->strgp->obj.name,
+				 ldmsd_decomp_op_to_string(cfg_col->op),
+				 cfg_col->dst, ldms_metric_type_to_str(cfg_col->type));
+	}
+
 next:
 
 	ASSERT_RETURN(special || cfg_col->mval_size);
@@ -1185,7 +1200,7 @@ row_cache_dup(decomp_static_row_cfg_t cfg_row,
 	ldmsd_row_t dup_row = NULL;
 	decomp_static_col_cfg_t cfg_col;
 
-	dup_row = calloc(1, cfg_row->row_sz + cfg_row->mval_size);
+	dup_row = ldmsd_row_arena_alloc(cfg_row->row_sz + cfg_row->mval_size);
 	if (!dup_row)
 		goto out;
 
@@ -1347,493 +1362,19 @@ static void assign_value(ldmsd_col_t dst, ldmsd_col_t src)
 	}
 }
 
-typedef int (*ldmsd_functional_op_t)(ldmsd_row_list_t row_list, ldmsd_row_t dest_row, int col_id);
-static int none_op(ldmsd_row_list_t row_list, ldmsd_row_t dest_row, int col_id)
+/*
+ * Columns without an operator take the value of the newest row; the others
+ * are computed by the column's kernel over the value ring of the row cache
+ * group (see decomp_static_kernel.c).
+ */
+static void none_op(ldmsd_row_group_t group, ldmsd_row_t dest_row, int col_id)
 {
-	ldmsd_row_t src_row = TAILQ_FIRST(row_list);
+	ldmsd_row_t src_row = ldmsd_row_group_row(group, 0);
 	ldmsd_col_t src_col = &src_row->cols[col_id];
 	ldmsd_col_t dst_col = &dest_row->cols[col_id];
 	assign_value(dst_col, src_col);
-	return 0;
-}
-
-static int diff_op(ldmsd_row_list_t row_list, ldmsd_row_t dest_row, int col_id)
-{
-	ldmsd_row_t src_row = TAILQ_FIRST(row_list);
-	ldmsd_row_t prev_row = TAILQ_NEXT(src_row, entry);
-	ldmsd_col_t dst_col = &dest_row->cols[col_id];
-	struct ldmsd_col_s zero_col;
-	union ldms_value zero;
-        uint64_t src_time;
-        uint64_t prev_time;
-        uint64_t diff_time;
-
-	memset(&zero, 0, sizeof(zero));
-	zero_col.mval = &zero;
-	zero_col.array_len = 1;
-	zero_col.type = LDMS_V_U64;
-	/* dst_col->mval = src_row->cols[col_id].mval - prev_row->cols[col_id].mval; */
-	if (!prev_row) {
-		assign_value(dst_col, &zero_col);
-		return 0;
-	}
-	switch (dst_col->type) {
-	case LDMS_V_U8:
-		dst_col->mval->v_u8 =
-			src_row->cols[col_id].mval->v_u8 -
-			prev_row->cols[col_id].mval->v_u8;
-		break;
-	case LDMS_V_S8:
-		dst_col->mval->v_s8 =
-			src_row->cols[col_id].mval->v_s8 -
-			prev_row->cols[col_id].mval->v_s8;
-		break;
-	case LDMS_V_U16:
-		dst_col->mval->v_u16 =
-			src_row->cols[col_id].mval->v_u16 -
-			prev_row->cols[col_id].mval->v_u16;
-		break;
-	case LDMS_V_S16:
-		dst_col->mval->v_s16 =
-			src_row->cols[col_id].mval->v_s16 -
-			prev_row->cols[col_id].mval->v_s16;
-		break;
-	case LDMS_V_U32:
-		dst_col->mval->v_u32 =
-			src_row->cols[col_id].mval->v_u32 -
-			prev_row->cols[col_id].mval->v_u32;
-		break;
-	case LDMS_V_S32:
-		dst_col->mval->v_s32 =
-			src_row->cols[col_id].mval->v_s32 -
-			prev_row->cols[col_id].mval->v_s32;
-		break;
-	case LDMS_V_U64:
-		dst_col->mval->v_u64 =
-			src_row->cols[col_id].mval->v_u64 -
-			prev_row->cols[col_id].mval->v_u64;
-		break;
-	case LDMS_V_S64:
-		dst_col->mval->v_s64 =
-			src_row->cols[col_id].mval->v_s64 -
-			prev_row->cols[col_id].mval->v_s64;
-		break;
-	case LDMS_V_F32:
-		dst_col->mval->v_f =
-			src_row->cols[col_id].mval->v_f -
-			prev_row->cols[col_id].mval->v_f;
-		break;
-	case LDMS_V_D64:
-		dst_col->mval->v_d =
-			src_row->cols[col_id].mval->v_d -
-			prev_row->cols[col_id].mval->v_d;
-		break;
-	case LDMS_V_TIMESTAMP:
-                src_time = (src_row->cols[col_id].mval->v_ts.sec * 1000000) + src_row->cols[col_id].mval->v_ts.usec;
-                prev_time = (prev_row->cols[col_id].mval->v_ts.sec * 1000000) + prev_row->cols[col_id].mval->v_ts.usec;
-                diff_time = src_time - prev_time;
-                dst_col->mval->v_ts.sec = (uint32_t)(diff_time / 1000000);
-                dst_col->mval->v_ts.usec = (uint32_t)(diff_time % 1000000);
-		break;
-	default:
-		return EINVAL;
-	}
-	return 0;
-}
-
-static int mean_op(ldmsd_row_list_t row_list, ldmsd_row_t dest_row, int col_id)
-{
-	ldmsd_row_t src_row = TAILQ_FIRST(row_list);
-	ldmsd_col_t dst_col = &dest_row->cols[col_id];
-	union ldms_value *x;
-	int64_t bi, r, g;
-	double bd;
-        uint64_t tm;
-	int n;
-
-	switch (dst_col->type) {
-	case LDMS_V_CHAR:
-	case LDMS_V_U8: case LDMS_V_S8:
-	case LDMS_V_U16: case LDMS_V_S16:
-	case LDMS_V_U32: case LDMS_V_S32:
-	case LDMS_V_U64: case LDMS_V_S64:
-	case LDMS_V_F32: case LDMS_V_D64:
-	case LDMS_V_TIMESTAMP:
-		/* OK */
-		break;
-	default:
-		return EINVAL;
-	}
-
-	/* calculate average iteratively (similar to simple moving average)
-	 * to reduce the chance of value overflow or underflow.
-	 *
-	 * NOTE:
-	 *  A is an average series (real value)
-	 *  B is the integer part of A
-	 *  R is the residual part
-	 *  Namely: A[n] = B[n] + (R[n])/n
-	 *
-	 *   A[n+1] = (n*A[n] + x[n+1]) / (n+1)
-	 *          = ( (n+1)A[n] - A[n] + x[n+1] ) / (n+1)
-	 *          = (n+1)A[n]/(n+1) - A[n]/(n+1) + x[n+1]/(n+1)
-	 *          = A[n] + (x[n+1] - A[n])/(n+1)
-	 *          = B[n] + (R[n])/n + (x[n+1] - B[n] - (R[n])/n)/(n+1)
-	 *          = B[n] + ( (n+1)R[n]/n + x[n+1] - B[n] - R[n]/n )/(n+1)
-	 *          = B[n] + ( R[n] + x[n+1] - B[n] )/(n+1)
-	 *
-	 *   In the calculation below
-	 *   `bi` is integer-type B[n] on LHS, and is B[n+1] on RHS
-	 *   `bd` is double-type  B[n] on LHS, and is B[n+1] on RHS
-	 *   `r` is R[n] on LHS, and is R[n+1] on RHS
-	 *   `g` refers to the term R[n]+x[n+1]-B[n]
-	 */
-	r = 0;
-	n = 0;
-	bi = 0;
-	bd = 0;
-	while (src_row)
-	{
-		x = src_row->cols[col_id].mval;
-		switch (dst_col->type) {
-		case LDMS_V_U8:
-			g = r + x->v_u8 - bi;
-			bi = bi + g/(n+1);
-			r = g % (n+1);
-			break;
-		case LDMS_V_S8:
-			g = r + x->v_s8 - bi;
-			bi = bi + g/(n+1);
-			r = g % (n+1);
-			break;
-		case LDMS_V_U16:
-			g = r + x->v_u16 - bi;
-			bi = bi + g/(n+1);
-			r = g % (n+1);
-			break;
-		case LDMS_V_S16:
-			g = r + x->v_s16 - bi;
-			bi = bi + g/(n+1);
-			r = g % (n+1);
-			break;
-		case LDMS_V_U32:
-			g = r + x->v_u32 - bi;
-			bi = bi + g/(n+1);
-			r = g % (n+1);
-			break;
-		case LDMS_V_S32:
-			g = r + x->v_s32 - bi;
-			bi = bi + g/(n+1);
-			r = g % (n+1);
-			break;
-		case LDMS_V_U64:
-			/* make small terms to prevent over/under flow */
-			g = x->v_u64/(n+1) - bi/(n+1);
-			r = r + (x->v_u64 % (n+1)) - (bi%(n+1));
-			bi = bi + g + r/(n+1);
-			r = r % (n+1);
-			break;
-		case LDMS_V_S64:
-			/* make small terms to prevent over/under flow */
-			g = x->v_s64/(n+1) - bi/(n+1);
-			r = r + (x->v_s64 % (n+1)) - (bi%(n+1));
-			bi = bi + g + r/(n+1);
-			r = r % (n+1);
-			break;
-		case LDMS_V_F32:
-			bd = bd + (x->v_f - bd)/(n+1);
-			break;
-		case LDMS_V_D64:
-			bd = bd + (x->v_d - bd)/(n+1);
-			break;
-		case LDMS_V_TIMESTAMP:
-			/* do as u64 usecs and convert back later */
-			tm = (x->v_ts.sec * 1000000) + x->v_ts.usec;
-			g = r + tm - bi;
-			bi = bi + g/(n+1);
-			r = g % (n+1);
-			break;
-		default:
-			return EINVAL;
-		}
-		n += 1;
-		src_row = TAILQ_NEXT(src_row, entry);
-	}
-	/* residue with opposite sign of the result */
-	if (r < 0 && bi > 0) {
-		bi -= 1;
-	} else if (r > 0 && bi < 0) {
-		bi += 1;
-	}
-	switch (dst_col->type) {
-	case LDMS_V_U8:
-		dst_col->mval->v_u8 = bi;
-		break;
-	case LDMS_V_S8:
-		dst_col->mval->v_s8 = bi;
-		break;
-	case LDMS_V_U16:
-		dst_col->mval->v_u16 = bi;
-		break;
-	case LDMS_V_S16:
-		dst_col->mval->v_s16 = bi;
-		break;
-	case LDMS_V_U32:
-		dst_col->mval->v_u32 = bi;
-		break;
-	case LDMS_V_S32:
-		dst_col->mval->v_s32 = bi;
-		break;
-	case LDMS_V_U64:
-		dst_col->mval->v_u64 = bi;
-		break;
-	case LDMS_V_S64:
-		dst_col->mval->v_s64 = bi;
-		break;
-	case LDMS_V_F32:
-		dst_col->mval->v_f = bd;
-		break;
-	case LDMS_V_D64:
-		dst_col->mval->v_d = bd;
-		break;
-	case LDMS_V_TIMESTAMP:
-		dst_col->mval->v_ts.sec  = bi / 1000000;
-		dst_col->mval->v_ts.usec = bi % 1000000;
-		break;
-	default:
-		return EINVAL;
-	}
-	return 0;
-}
-
-static int max_op(ldmsd_row_list_t row_list, ldmsd_row_t dest_row, int col_id)
-{
-	ldmsd_row_t src_row = TAILQ_FIRST(row_list);
-	ldmsd_col_t dst_col = &dest_row->cols[col_id];
-	union ldms_value max;
-	struct ldmsd_col_s max_col;
-
-	max_col.mval = &max;
-	max_col.type = dst_col->type;
-	max_col.array_len = 1;
-
-	assign_value(&max_col, &src_row->cols[col_id]);
-	src_row = TAILQ_NEXT(src_row, entry);
-	while (src_row)
-	{
-		switch (dst_col->type) {
-		case LDMS_V_U8:
-			if (max.v_u8 < src_row->cols[col_id].mval->v_u8)
-				max.v_u8 = src_row->cols[col_id].mval->v_u8;
-			break;
-		case LDMS_V_S8:
-			if (max.v_s8 < src_row->cols[col_id].mval->v_s8)
-				max.v_s8 = src_row->cols[col_id].mval->v_s8;
-			break;
-		case LDMS_V_U16:
-			if (max.v_u16 < src_row->cols[col_id].mval->v_u16)
-				max.v_u16 = src_row->cols[col_id].mval->v_u16;
-			break;
-		case LDMS_V_S16:
-			if (max.v_s16 < src_row->cols[col_id].mval->v_s16)
-				max.v_s16 = src_row->cols[col_id].mval->v_s16;
-			break;
-		case LDMS_V_U32:
-			if (max.v_u32 < src_row->cols[col_id].mval->v_u32)
-				max.v_u32 = src_row->cols[col_id].mval->v_u32;
-			break;
-		case LDMS_V_S32:
-			if (max.v_s32 < src_row->cols[col_id].mval->v_s32)
-				max.v_s32 = src_row->cols[col_id].mval->v_s32;
-			break;
-		case LDMS_V_U64:
-			if (max.v_u64 < src_row->cols[col_id].mval->v_u64)
-				max.v_u64 = src_row->cols[col_id].mval->v_u64;
-			break;
-		case LDMS_V_S64:
-			if (max.v_s64 < src_row->cols[col_id].mval->v_s64)
-				max.v_s64 = src_row->cols[col_id].mval->v_s64;
-			break;
-		case LDMS_V_F32:
-			if (max.v_f < src_row->cols[col_id].mval->v_f)
-				max.v_f = src_row->cols[col_id].mval->v_f;
-			break;
-		case LDMS_V_D64:
-			if (max.v_d < src_row->cols[col_id].mval->v_d)
-				max.v_d = src_row->cols[col_id].mval->v_d;
-			break;
-		case LDMS_V_TIMESTAMP:
-			if (max.v_ts.sec < src_row->cols[col_id].mval->v_ts.sec) {
-				max.v_ts = src_row->cols[col_id].mval->v_ts;
-			} else if (max.v_ts.sec == src_row->cols[col_id].mval->v_ts.sec) {
-				if (max.v_ts.usec < src_row->cols[col_id].mval->v_ts.usec) {
-					max.v_ts = src_row->cols[col_id].mval->v_ts;
-				}
-			}
-			break;
-		default:
-			return EINVAL;
-		}
-		src_row = TAILQ_NEXT(src_row, entry);
-	}
-	switch (dst_col->type) {
-	case LDMS_V_U8:
-		dst_col->mval->v_u8 = max.v_u8;
-		break;
-	case LDMS_V_S8:
-		dst_col->mval->v_s8 = max.v_s8;
-		break;
-	case LDMS_V_U16:
-		dst_col->mval->v_u16 = max.v_u16;
-		break;
-	case LDMS_V_S16:
-		dst_col->mval->v_s16 = max.v_s16;
-		break;
-	case LDMS_V_U32:
-		dst_col->mval->v_u32 = max.v_u32;
-		break;
-	case LDMS_V_S32:
-		dst_col->mval->v_s32 = max.v_s32;
-		break;
-	case LDMS_V_U64:
-		dst_col->mval->v_u64 = max.v_u64;
-		break;
-	case LDMS_V_S64:
-		dst_col->mval->v_s64 = max.v_s64;
-		break;
-	case LDMS_V_F32:
-		dst_col->mval->v_f = max.v_f;
-		break;
-	case LDMS_V_D64:
-		dst_col->mval->v_d = max.v_d;
-		break;
-	case LDMS_V_TIMESTAMP:
-		dst_col->mval->v_ts = max.v_ts;
-		break;
-	default:
-		return EINVAL;
-	}
-	return 0;
-}
-
-static int min_op(ldmsd_row_list_t row_list, ldmsd_row_t dest_row, int col_id)
-{
-	ldmsd_row_t src_row = TAILQ_FIRST(row_list);
-	ldmsd_col_t dst_col = &dest_row->cols[col_id];
-	union ldms_value min;
-	struct ldmsd_col_s min_col;
-
-	min_col.mval = &min;
-	min_col.type = dst_col->type;
-	min_col.array_len = 1;
-
-	assign_value(&min_col, &src_row->cols[col_id]);
-	src_row = TAILQ_NEXT(src_row, entry);
-	while (src_row)
-	{
-		switch (dst_col->type) {
-		case LDMS_V_U8:
-			if (min.v_u8 > src_row->cols[col_id].mval->v_u8)
-				min.v_u8 = src_row->cols[col_id].mval->v_u8;
-			break;
-		case LDMS_V_S8:
-			if (min.v_s8 > src_row->cols[col_id].mval->v_s8)
-				min.v_s8 = src_row->cols[col_id].mval->v_s8;
-			break;
-		case LDMS_V_U16:
-			if (min.v_u16 > src_row->cols[col_id].mval->v_u16)
-				min.v_u16 = src_row->cols[col_id].mval->v_u16;
-			break;
-		case LDMS_V_S16:
-			if (min.v_s16 > src_row->cols[col_id].mval->v_s16)
-				min.v_s16 = src_row->cols[col_id].mval->v_s16;
-			break;
-		case LDMS_V_U32:
-			if (min.v_u32 > src_row->cols[col_id].mval->v_u32)
-				min.v_u32 = src_row->cols[col_id].mval->v_u32;
-			break;
-		case LDMS_V_S32:
-			if (min.v_s32 > src_row->cols[col_id].mval->v_s32)
-				min.v_s32 = src_row->cols[col_id].mval->v_s32;
-			break;
-		case LDMS_V_U64:
-			if (min.v_u64 > src_row->cols[col_id].mval->v_u64)
-				min.v_u64 = src_row->cols[col_id].mval->v_u64;
-			break;
-		case LDMS_V_S64:
-			if (min.v_s64 > src_row->cols[col_id].mval->v_s64)
-				min.v_s64 = src_row->cols[col_id].mval->v_s64;
-			break;
-		case LDMS_V_F32:
-			if (min.v_f > src_row->cols[col_id].mval->v_f)
-				min.v_f = src_row->cols[col_id].mval->v_f;
-			break;
-		case LDMS_V_D64:
-			if (min.v_d > src_row->cols[col_id].mval->v_d)
-				min.v_d = src_row->cols[col_id].mval->v_d;
-			break;
-		case LDMS_V_TIMESTAMP:
-			if (min.v_ts.sec > src_row->cols[col_id].mval->v_ts.sec) {
-				min.v_ts = src_row->cols[col_id].mval->v_ts;
-			} else if (min.v_ts.sec == src_row->cols[col_id].mval->v_ts.sec) {
-				if (min.v_ts.usec > src_row->cols[col_id].mval->v_ts.usec) {
-					min.v_ts = src_row->cols[col_id].mval->v_ts;
-				}
-			}
-			break;
-		default:
-			return EINVAL;
-		}
-		src_row = TAILQ_NEXT(src_row, entry);
-	}
-	switch (dst_col->type) {
-	case LDMS_V_U8:
-		dst_col->mval->v_u8 = min.v_u8;
-		break;
-	case LDMS_V_S8:
-		dst_col->mval->v_s8 = min.v_s8;
-		break;
-	case LDMS_V_U16:
-		dst_col->mval->v_u16 = min.v_u16;
-		break;
-	case LDMS_V_S16:
-		dst_col->mval->v_s16 = min.v_s16;
-		break;
-	case LDMS_V_U32:
-		dst_col->mval->v_u32 = min.v_u32;
-		break;
-	case LDMS_V_S32:
-		dst_col->mval->v_s32 = min.v_s32;
-		break;
-	case LDMS_V_U64:
-		dst_col->mval->v_u64 = min.v_u64;
-		break;
-	case LDMS_V_S64:
-		dst_col->mval->v_s64 = min.v_s64;
-		break;
-	case LDMS_V_F32:
-		dst_col->mval->v_f = min.v_f;
-		break;
-	case LDMS_V_D64:
-		dst_col->mval->v_d = min.v_d;
-		break;
-	case LDMS_V_TIMESTAMP:
-		dst_col->mval->v_ts = min.v_ts;
-		break;
-	default:
-		return EINVAL;
-	}
-	return 0;
 }
 
-static ldmsd_functional_op_t op_table[] = {
-	[LDMSD_DECOMP_OP_NONE] = none_op,
-	[LDMSD_DECOMP_OP_DIFF] = diff_op,
-	[LDMSD_DECOMP_OP_MEAN] = mean_op,
-	[LDMSD_DECOMP_OP_MIN] = min_op,
-	[LDMSD_DECOMP_OP_MAX] = max_op,
-};
-
 static int decomp_static_decompose(ldmsd_strgp_t strgp, ldms_set_t set,
 				   ldmsd_row_list_t row_list, int *row_count,
 				   void **decomp_ctxt)
@@ -1873,10 +1414,21 @@ static int decomp_static_decompose(ldmsd_strgp_t strgp, ldms_set_t set,
 	const char *schema;
 	int producer_len, instance_len, schema_len;
 	union ldms_value zfill = {0}; /* zero value as default "fill" */
+	size_t arena_sz;
 
 	if (!TAILQ_EMPTY(row_list))
 		return EINVAL;
 
+	/* One row per row config is the common case (no list expansion) */
+	arena_sz = 0;
+	for (i = 0; i < dcfg->row_count; i++) {
+		cfg_row = &dcfg->rows[i];
+		arena_sz += cfg_row->col_count * sizeof(*col_mvals);
+		if (!cfg_row->op_present)
+			arena_sz += cfg_row->row_sz + cfg_row->mval_size;
+	}
+	ldmsd_row_arena_reserve(arena_sz);
+
 	ts = ldms_transaction_timestamp_get(set);
 	producer = ldms_set_producer_name_get(set);
 	producer_len = strlen(producer) + 1;
@@ -1929,7 +1481,7 @@ static int decomp_static_decompose(ldmsd_strgp_t strgp, ldms_set_t set,
 		 * a set with records. col_mvals is freed at the end of
 		 * `make_row`.
 		 */
-		col_mvals = calloc(1, cfg_row->col_count * sizeof(*col_mvals));
+		col_mvals = ldmsd_row_arena_alloc(cfg_row->col_count * sizeof(*col_mvals));
 		if (!col_mvals) {
 			rc = ENOMEM;
 			goto err_0;
@@ -2079,7 +1631,11 @@ static int decomp_static_decompose(ldmsd_strgp_t strgp, ldms_set_t set,
 		}
 
 	make_row: /* make/expand rows according to col_mvals */
-		row = calloc(1, cfg_row->row_sz + cfg_row->mval_size);
+		if (cfg_row->op_present)
+			/* the row is kept in the row cache */
+			row = calloc(1, cfg_row->row_sz + cfg_row->mval_size);
+		else
+			row = ldmsd_row_arena_alloc(cfg_row->row_sz + cfg_row->mval_size);
 		if (!row) {
 			rc = errno;
 			goto err_0;
@@ -2226,7 +1782,9 @@ static int decomp_static_decompose(ldmsd_strgp_t strgp, ldms_set_t set,
 			ldmsd_row_cache_idx_t group_idx;
 			ldmsd_row_cache_idx_t row_idx;
 			ldmsd_row_cache_key_t *keys;
+			ldmsd_row_group_t group;
 			ldmsd_row_t dup_row;
+			ldms_mval_t *kern_src;
 
 			/* Build the group key */
 			keys = calloc(cfg_row->group_count, sizeof(*keys));
@@ -2255,7 +1813,7 @@ static int decomp_static_decompose(ldmsd_strgp_t strgp, ldms_set_t set,
 			}
 
 			/* Cache the current, unmodified row */
-			rc = ldmsd_row_cache(strgp->row_cache, group_idx, row_idx, row);
+			rc = ldmsd_row_cache(strgp->row_cache, group_idx, row_idx, row, &group);
 			if (rc)
 				goto err_0;
 
@@ -2263,18 +1821,24 @@ static int decomp_static_decompose(ldmsd_strgp_t strgp, ldms_set_t set,
 			 * row we just cached or it will be useless for the next
 			 * sample */
 			dup_row = row_cache_dup(cfg_row, mid_rbn, row);
+			kern_src = ldmsd_row_arena_alloc(group->count * sizeof(*kern_src));
+			if (!dup_row || !kern_src) {
+				ldmsd_row_arena_free(kern_src);
+				ldmsd_row_arena_free(dup_row);
+				ldmsd_row_cache_idx_free(group_idx);
+				rc = ENOMEM;
+				goto err_0;
+			}
 
 			/* Apply functional operators to columns */
-                        struct ldmsd_row_list_s tmp_row_list;
-                        int count;
-                        count = ldmsd_row_cache_make_list(&tmp_row_list,
-                                                          cfg_row->row_limit,
-                                                          strgp->row_cache,
-                                                          group_idx);
+                        int count = group->count;
 			for (j = 0; j < row->col_count; j++) {
 				cfg_col = &cfg_row->cols[j];
-				if (cfg_col->op != LDMSD_DECOMP_OP_NONE
-                                    && count < cfg_row->row_limit)
+				if (cfg_col->op == LDMSD_DECOMP_OP_NONE) {
+					none_op(group, dup_row, j);
+					continue;
+				}
+				if (count < cfg_row->row_limit)
 					ovis_log(static_log, OVIS_LDEBUG,
                                                   "strgp '%s': insufficient rows (%d of %d) in "
                                                   "cache to satisfy functional operator '%s' "
@@ -2282,8 +1846,14 @@ static int decomp_static_decompose(ldmsd_strgp_t strgp, ldms_set_t set,
                                                   strgp->obj.name, count, cfg_row->row_limit,
                                                   ldmsd_decomp_op_to_string(cfg_col->op),
                                                   cfg_col->dst);
-				rc = op_table[cfg_col->op](&tmp_row_list, dup_row, j);
+				if (!cfg_col->kernel)
+					continue;
+				for (k = 0; k < count; k++)
+					kern_src[k] = ldmsd_row_group_val(group, j, k);
+				cfg_col->kernel(dup_row->cols[j].mval, kern_src, count,
+						dup_row->cols[j].array_len);
 			}
+			ldmsd_row_arena_free(kern_src);
 			ldmsd_row_cache_idx_free(group_idx);
 			row = dup_row;
 		}
@@ -2292,13 +1862,13 @@ static int decomp_static_decompose(ldmsd_strgp_t strgp, ldms_set_t set,
 		row = NULL;
 		if (row_more_le)
 			goto make_row;
-		free(col_mvals);
+		ldmsd_row_arena_free(col_mvals);
 		col_mvals = NULL;
 	}
 	return 0;
  err_0:
 	/* clean up stuff here */
-	free(col_mvals);
+	ldmsd_row_arena_free(col_mvals);
 	decomp_static_release_rows(strgp, row_list);
 	return rc;
 }
@@ -2309,6 +1879,6 @@ static void decomp_static_release_rows(ldmsd_strgp_t strgp,
 	ldmsd_row_t row;
 	while ((row = TAILQ_FIRST(row_list))) {
 		TAILQ_REMOVE(row_list, row, entry);
-		free(row);
+		ldmsd_row_arena_free(row);
 	}
 }
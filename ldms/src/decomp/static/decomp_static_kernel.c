@@ -0,0 +1,298 @@
+/* -*- c-basic-offset: 8 -*-
+ * Copyright (c) 2026 National Technology & Engineering Solutions
+ * of Sandia, LLC (NTESS). Under the terms of Contract DE-NA0003525 with
+ * NTESS, the U.S. Government retains certain rights in this software.
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Functional operator kernels of the static decomposition.
+ *
+ * There is one kernel per (operator, element type) pair so that the inner
+ * loops carry no type switch; scalars are arrays of one element. The loops
+ * are plain restrict-qualified element loops that the compiler vectorizes
+ * (the library is built with -ftree-vectorize). On x86_64 each kernel is
+ * also cloned for AVX2 and the best clone is picked by the loader, so no
+ * hand-written intrinsics are needed here.
+ */
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <string.h>
+
+#include "decomp_static_kernel.h"
+
+/* elements per mean accumulator block */
+#define KBLK 256
+
+#if defined(__x86_64__) && defined(__GLIBC__) && defined(__has_attribute)
+#if __has_attribute(target_clones)
+#define KERNEL_CLONES __attribute__((target_clones("avx2", "default")))
+#endif
+#endif
+#ifndef KERNEL_CLONES
+#define KERNEL_CLONES
+#endif
+
+/* dst = src[0] - src[1]; 0 if there is only one value */
+#define DIFF_KERNEL(NAME, T) \
+static KERNEL_CLONES void diff_##NAME(ldms_mval_t dst, ldms_mval_t *src, \
+				      int n, int len) \
+{ \
+	T *restrict d = (T *)dst; \
+	const T *restrict a, *restrict b; \
+	int i; \
+	if (n < 2) { \
+		memset(d, 0, len * sizeof(T)); \
+		return; \
+	} \
+	a = (const T *)src[0]; \
+	b = (const T *)src[1]; \
+	for (i = 0; i < len; i++) \
+		d[i] = a[i] - b[i]; \
+}
+
+/* dst = element-wise min (CMP <) or max (CMP >) of src[0..n-1] */
+#define MINMAX_KERNEL(OP, NAME, T, CMP) \
+static KERNEL_CLONES void OP##_##NAME(ldms_mval_t dst, ldms_mval_t *src, \
+				      int n, int len) \
+{ \
+	T *restrict d = (T *)dst; \
+	const T *restrict x; \
+	int r, i; \
+	memcpy(d, src[0], len * sizeof(T)); \
+	for (r = 1; r < n; r++) { \
+		x = (const T *)src[r]; \
+		for (i = 0; i < len; i++) \
+			d[i] = x[i] CMP d[i] ? x[i] : d[i]; \
+	} \
+}
+
+/*
+ * dst = mean of src[0..n-1], accumulated in ACC. Integer means are
+ * truncated toward zero; the sums of the 8, 16 and 32-bit types cannot
+ * overflow the 64-bit accumulator for any row_limit that fits an int.
+ */
+#define MEAN_KERNEL(NAME, T, ACC) \
+static KERNEL_CLONES void mean_##NAME(ldms_mval_t dst, ldms_mval_t *src, \
+				      int n, int len) \
+{ \
+	T *restrict d = (T *)dst; \
+	const T *restrict x; \
+	ACC acc[KBLK]; \
+	int r, i, k, m; \
+	for (i = 0; i < len; i += KBLK) { \
+		m = len - i < KBLK ? len - i : KBLK; \
+		for (k = 0; k < m; k++) \
+			acc[k] = 0; \
+		for (r = 0; r < n; r++) { \
+			x = (const T *)src[r] + i; \
+			for (k = 0; k < m; k++) \
+				acc[k] += x[k]; \
+		} \
+		for (k = 0; k < m; k++) \
+			d[i+k] = acc[k] / n; \
+	} \
+}
+
+/*
+ * 64-bit integer mean. The sum could overflow, so the 32-bit halves of the
+ * values are summed separately and recombined in the division; the signed
+ * values are biased by 2^63 to sum them as unsigned. Both sums fit 64 bits
+ * for any row_limit that fits an int.
+ */
+#define MEAN64_KERNEL(NAME, T, BIAS) \
+static KERNEL_CLONES void mean_##NAME(ldms_mval_t dst, ldms_mval_t *src, \
+				      int n, int len) \
+{ \
+	T *restrict d = (T *)dst; \
+	const T *restrict x; \
+	uint64_t lo[KBLK], hi[KBLK], u, q, rem; \
+	int r, i, k, m; \
+	T v; \
+	for (i = 0; i < len; i += KBLK) { \
+		m = len - i < KBLK ? len - i : KBLK; \
+		for (k = 0; k < m; k++) \
+			lo[k] = hi[k] = 0; \
+		for (r = 0; r < n; r++) { \
+			x = (const T *)src[r] + i; \
+			for (k = 0; k < m; k++) { \
+				u = (uint64_t)x[k] ^ (BIAS); \
+				lo[k] += u & 0xffffffff; \
+				hi[k] += u >> 32; \
+			} \
+		} \
+		for (k = 0; k < m; k++) { \
+			q = hi[k] / n; \
+			rem = ((hi[k] % n) << 32) + lo[k]; \
+			q = (q << 32) + rem / n; \
+			v = (T)(q ^ (BIAS)); \
+			/* q is the floor; truncate negative means toward zero */ \
+			if ((BIAS) && rem % n && v < 0) \
+				v += 1; \
+			d[i+k] = v; \
+		} \
+	} \
+}
+
+#define INT_KERNELS(NAME, T, ACC) \
+	DIFF_KERNEL(NAME, T) \
+	MINMAX_KERNEL(min, NAME, T, <) \
+	MINMAX_KERNEL(max, NAME, T, >) \
+	MEAN_KERNEL(NAME, T, ACC)
+
+#define INT64_KERNELS(NAME, T, BIAS) \
+	DIFF_KERNEL(NAME, T) \
+	MINMAX_KERNEL(min, NAME, T, <) \
+	MINMAX_KERNEL(max, NAME, T, >) \
+	MEAN64_KERNEL(NAME, T, BIAS)
+
+INT_KERNELS(char, char, int64_t)
+INT_KERNELS(u8, uint8_t, int64_t)
+INT_KERNELS(s8, int8_t, int64_t)
+INT_KERNELS(u16, uint16_t, int64_t)
+INT_KERNELS(s16, int16_t, int64_t)
+INT_KERNELS(u32, uint32_t, int64_t)
+INT_KERNELS(s32, int32_t, int64_t)
+INT64_KERNELS(u64, uint64_t, 0)
+INT64_KERNELS(s64, int64_t, 1ULL << 63)
+INT_KERNELS(f32, float, double)
+INT_KERNELS(d64, double, double)
+
+/*
+ * Timestamps are scalars only; they are computed in microseconds and
+ * converted back.
+ */
+static inline uint64_t ts_usec(ldms_mval_t v)
+{
+	return (uint64_t)v->v_ts.sec * 1000000 + v->v_ts.usec;
+}
+
+static inline void ts_set(ldms_mval_t v, uint64_t usec)
+{
+	v->v_ts.sec = usec / 1000000;
+	v->v_ts.usec = usec % 1000000;
+}
+
+static void diff_ts(ldms_mval_t dst, ldms_mval_t *src, int n, int len)
+{
+	ts_set(dst, n < 2 ? 0 : ts_usec(src[0]) - ts_usec(src[1]));
+}
+
+static void min_ts(ldms_mval_t dst, ldms_mval_t *src, int n, int len)
+{
+	uint64_t min = ts_usec(src[0]), v;
+	int r;
+	for (r = 1; r < n; r++) {
+		v = ts_usec(src[r]);
+		if (v < min)
+			min = v;
+	}
+	ts_set(dst, min);
+}
+
+static void max_ts(ldms_mval_t dst, ldms_mval_t *src, int n, int len)
+{
+	uint64_t max = ts_usec(src[0]), v;
+	int r;
+	for (r = 1; r < n; r++) {
+		v = ts_usec(src[r]);
+		if (v > max)
+			max = v;
+	}
+	ts_set(dst, max);
+}
+
+static void mean_ts(ldms_mval_t dst, ldms_mval_t *src, int n, int len)
+{
+	uint64_t q = 0, rem = 0, v;
+	int r;
+	for (r = 0; r < n; r++) {
+		v = ts_usec(src[r]);
+		q += v / n;
+		rem += v % n;
+	}
+	ts_set(dst, q + rem / n);
+}
+
+#define KERNEL_ROW(NAME) { \
+	[LDMSD_DECOMP_OP_DIFF] = diff_##NAME, \
+	[LDMSD_DECOMP_OP_MEAN] = mean_##NAME, \
+	[LDMSD_DECOMP_OP_MIN]  = min_##NAME, \
+	[LDMSD_DECOMP_OP_MAX]  = max_##NAME, \
+}
+
+static decomp_static_kernel_t kernel_table[][LDMSD_DECOMP_OP_MAX + 1] = {
+	[LDMS_V_CHAR]      = KERNEL_ROW(char),
+	[LDMS_V_U8]        = KERNEL_ROW(u8),
+	[LDMS_V_S8]        = KERNEL_ROW(s8),
+	[LDMS_V_U16]       = KERNEL_ROW(u16),
+	[LDMS_V_S16]       = KERNEL_ROW(s16),
+	[LDMS_V_U32]       = KERNEL_ROW(u32),
+	[LDMS_V_S32]       = KERNEL_ROW(s32),
+	[LDMS_V_U64]       = KERNEL_ROW(u64),
+	[LDMS_V_S64]       = KERNEL_ROW(s64),
+	[LDMS_V_F32]       = KERNEL_ROW(f32),
+	[LDMS_V_D64]       = KERNEL_ROW(d64),
+	[LDMS_V_U8_ARRAY]  = KERNEL_ROW(u8),
+	[LDMS_V_S8_ARRAY]  = KERNEL_ROW(s8),
+	[LDMS_V_U16_ARRAY] = KERNEL_ROW(u16),
+	[LDMS_V_S16_ARRAY] = KERNEL_ROW(s16),
+	[LDMS_V_U32_ARRAY] = KERNEL_ROW(u32),
+	[LDMS_V_S32_ARRAY] = KERNEL_ROW(s32),
+	[LDMS_V_U64_ARRAY] = KERNEL_ROW(u64),
+	[LDMS_V_S64_ARRAY] = KERNEL_ROW(s64),
+	[LDMS_V_F32_ARRAY] = KERNEL_ROW(f32),
+	[LDMS_V_D64_ARRAY] = KERNEL_ROW(d64),
+	[LDMS_V_TIMESTAMP] = KERNEL_ROW(ts),
+};
+
+decomp_static_kernel_t decomp_static_kernel_get(enum ldmsd_decomp_op op,
+						enum ldms_value_type type)
+{
+	if (op > LDMSD_DECOMP_OP_MAX || type < 0 ||
+	    type >= sizeof(kernel_table) / sizeof(kernel_table[0]))
+		return NULL;
+	return kernel_table[type][op];
+}
@@ -0,0 +1,234 @@
+/* -*- c-basic-offset: 8 -*-
+ * Copyright (c) 2026 National Technology & Engineering Solutions
+ * of Sandia, LLC (NTESS). Under the terms of Contract DE-NA0003525 with
+ * NTESS, the U.S. Government retains certain rights in this software.
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Benchmark of the decomp_static functional operator kernels.
+ *
+ * For u64 and d64 arrays of 64 to 4096 elements, each operator is run over
+ * ROWS cached values with a reference implementation that switches on the
+ * value type for every element (the way the operators used to work on
+ * scalars) and with the kernel from decomp_static_kernel_get(). The results
+ * are compared and the time per call of both is reported.
+ *
+ *   decomp_static_kernel_bench [ROWS [ELEMENTS_PER_RUN]]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "decomp_static_kernel.h"
+
+static const char *op_str[] = {
+	[LDMSD_DECOMP_OP_DIFF] = "diff",
+	[LDMSD_DECOMP_OP_MEAN] = "mean",
+	[LDMSD_DECOMP_OP_MIN]  = "min",
+	[LDMSD_DECOMP_OP_MAX]  = "max",
+};
+
+/* element-at-a-time reference with the type switch in the inner loop */
+static void ref_op(enum ldmsd_decomp_op op, enum ldms_value_type type,
+		   ldms_mval_t dst, ldms_mval_t *src, int n, int len)
+{
+	int i, r;
+	int64_t bi, g, rem;
+	double bd;
+
+	for (i = 0; i < len; i++) {
+		switch (op) {
+		case LDMSD_DECOMP_OP_DIFF:
+			switch (type) {
+			case LDMS_V_U64_ARRAY:
+				dst->a_u64[i] = n < 2 ? 0 :
+					src[0]->a_u64[i] - src[1]->a_u64[i];
+				break;
+			case LDMS_V_D64_ARRAY:
+				dst->a_d[i] = n < 2 ? 0 :
+					src[0]->a_d[i] - src[1]->a_d[i];
+				break;
+			default:
+				break;
+			}
+			break;
+		case LDMSD_DECOMP_OP_MIN:
+		case LDMSD_DECOMP_OP_MAX:
+			for (r = 0; r < n; r++) {
+				switch (type) {
+				case LDMS_V_U64_ARRAY:
+					if (r == 0 ||
+					    (op == LDMSD_DECOMP_OP_MIN ?
+					     src[r]->a_u64[i] < dst->a_u64[i] :
+					     src[r]->a_u64[i] > dst->a_u64[i]))
+						dst->a_u64[i] = src[r]->a_u64[i];
+					break;
+				case LDMS_V_D64_ARRAY:
+					if (r == 0 ||
+					    (op == LDMSD_DECOMP_OP_MIN ?
+					     src[r]->a_d[i] < dst->a_d[i] :
+					     src[r]->a_d[i] > dst->a_d[i]))
+						dst->a_d[i] = src[r]->a_d[i];
+					break;
+				default:
+					break;
+				}
+			}
+			break;
+		case LDMSD_DECOMP_OP_MEAN:
+			/* the iterative integer/residue mean */
+			bi = rem = 0;
+			bd = 0;
+			for (r = 0; r < n; r++) {
+				switch (type) {
+				case LDMS_V_U64_ARRAY:
+					g = src[r]->a_u64[i]/(r+1) - bi/(r+1);
+					rem = rem + (src[r]->a_u64[i] % (r+1)) - (bi%(r+1));
+					bi = bi + g + rem/(r+1);
+					rem = rem % (r+1);
+					break;
+				case LDMS_V_D64_ARRAY:
+					bd = bd + (src[r]->a_d[i] - bd)/(r+1);
+					break;
+				default:
+					break;
+				}
+			}
+			if (rem < 0 && bi > 0)
+				bi -= 1;
+			else if (rem > 0 && bi < 0)
+				bi += 1;
+			if (type == LDMS_V_U64_ARRAY)
+				dst->a_u64[i] = bi;
+			else
+				dst->a_d[i] = bd;
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int check(enum ldms_value_type type, ldms_mval_t a, ldms_mval_t b, int len)
+{
+	int i;
+	for (i = 0; i < len; i++) {
+		if (type == LDMS_V_U64_ARRAY && a->a_u64[i] != b->a_u64[i])
+			return i;
+		if (type == LDMS_V_D64_ARRAY &&
+		    fabs(a->a_d[i] - b->a_d[i]) > 1e-9 * fabs(a->a_d[i]))
+			return i;
+	}
+	return -1;
+}
+
+int main(int argc, char **argv)
+{
+	int rows = (argc > 1)?atoi(argv[1]):8;
+	long elements = (argc > 2)?atol(argv[2]):(1L << 25);
+	enum ldms_value_type types[] = { LDMS_V_U64_ARRAY, LDMS_V_D64_ARRAY };
+	enum ldmsd_decomp_op op;
+	decomp_static_kernel_t kernel;
+	ldms_mval_t *src, ref, out;
+	double t0, t1, t2;
+	int t, len, r, i, it, iters, bad, rc = 0;
+
+	src = calloc(rows, sizeof(*src));
+	for (r = 0; r < rows; r++) {
+		src[r] = malloc(4096 * sizeof(uint64_t));
+		for (i = 0; i < 4096; i++)
+			src[r]->a_u64[i] = ((uint64_t)random() << 32) | random();
+	}
+	ref = malloc(4096 * sizeof(uint64_t));
+	out = malloc(4096 * sizeof(uint64_t));
+
+	printf("%-5s %-4s %5s %12s %12s %8s\n",
+	       "type", "op", "len", "ref ns/call", "kern ns/call", "speedup");
+	for (t = 0; t < 2; t++) {
+		if (types[t] == LDMS_V_D64_ARRAY) {
+			for (r = 0; r < rows; r++) {
+				for (i = 0; i < 4096; i++)
+					src[r]->a_d[i] = (double)random() / 1000;
+			}
+		}
+		for (op = LDMSD_DECOMP_OP_DIFF; op <= LDMSD_DECOMP_OP_MAX; op++) {
+			kernel = decomp_static_kernel_get(op, types[t]);
+			for (len = 64; len <= 4096; len *= 4) {
+				iters = elements / ((long)len * rows);
+				if (iters < 1)
+					iters = 1;
+				t0 = now();
+				for (it = 0; it < iters; it++)
+					ref_op(op, types[t], ref, src, rows, len);
+				t1 = now();
+				for (it = 0; it < iters; it++)
+					kernel(out, src, rows, len);
+				t2 = now();
+				bad = check(types[t], ref, out, len);
+				if (bad >= 0) {
+					printf("%s %s len %d: mismatch at %d\n",
+					       ldms_metric_type_to_str(types[t]),
+					       op_str[op], len, bad);
+					rc = 1;
+				}
+				printf("%-5s %-4s %5d %12.1f %12.1f %7.1fx\n",
+				       t ? "d64" : "u64", op_str[op], len,
+				       (t1 - t0) * 1e9 / iters,
+				       (t2 - t1) * 1e9 / iters,
+				       (t1 - t0) / (t2 - t1));
+			}
+		}
+	}
+	return rc;
+}
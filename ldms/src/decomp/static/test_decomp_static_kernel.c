@@ -0,0 +1,162 @@
+/* -*- c-basic-offset: 8 -*-
+ * Copyright (c) 2026 National Technology & Engineering Solutions
+ * of Sandia, LLC (NTESS). Under the terms of Contract DE-NA0003525 with
+ * NTESS, the U.S. Government retains certain rights in this software.
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*
+ * Check of the decomp_static functional operator kernels.
+ *
+ * Every scalar type and every numeric array type must have a kernel for
+ * each operator. The kernels are then run over the values of a CHAR
+ * metric taken from ROWS sets, one set per cached row, and compared with
+ * the expected results.
+ *
+ *   test_decomp_static_kernel
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "decomp_static_kernel.h"
+
+#define ROWS 4
+
+static const char *op_str[] = {
+	[LDMSD_DECOMP_OP_DIFF] = "diff",
+	[LDMSD_DECOMP_OP_MEAN] = "mean",
+	[LDMSD_DECOMP_OP_MIN]  = "min",
+	[LDMSD_DECOMP_OP_MAX]  = "max",
+};
+
+static enum ldms_value_type types[] = {
+	LDMS_V_CHAR,
+	LDMS_V_U8, LDMS_V_S8, LDMS_V_U16, LDMS_V_S16,
+	LDMS_V_U32, LDMS_V_S32, LDMS_V_U64, LDMS_V_S64,
+	LDMS_V_F32, LDMS_V_D64,
+	LDMS_V_U8_ARRAY, LDMS_V_S8_ARRAY, LDMS_V_U16_ARRAY, LDMS_V_S16_ARRAY,
+	LDMS_V_U32_ARRAY, LDMS_V_S32_ARRAY, LDMS_V_U64_ARRAY, LDMS_V_S64_ARRAY,
+	LDMS_V_F32_ARRAY, LDMS_V_D64_ARRAY,
+	LDMS_V_TIMESTAMP,
+};
+
+int main(int argc, char **argv)
+{
+	/* the newest row first */
+	char vals[ROWS] = { 'd', 'a', 'c', 'b' };
+	char expect[] = {
+		[LDMSD_DECOMP_OP_DIFF] = 'd' - 'a',
+		[LDMSD_DECOMP_OP_MEAN] = ('d' + 'a' + 'c' + 'b') / ROWS,
+		[LDMSD_DECOMP_OP_MIN]  = 'a',
+		[LDMSD_DECOMP_OP_MAX]  = 'd',
+	};
+	enum ldmsd_decomp_op op;
+	decomp_static_kernel_t kernel;
+	ldms_schema_t schema;
+	ldms_set_t set[ROWS];
+	ldms_mval_t src[ROWS];
+	union ldms_value out;
+	char name[32];
+	int i, mid, rc = 0;
+
+	for (i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+		for (op = LDMSD_DECOMP_OP_DIFF; op <= LDMSD_DECOMP_OP_MAX; op++) {
+			if (decomp_static_kernel_get(op, types[i]))
+				continue;
+			printf("no %s kernel for %s\n", op_str[op],
+			       ldms_metric_type_to_str(types[i]));
+			rc = 1;
+		}
+	}
+
+	ldms_init(1024 * 1024);
+	schema = ldms_schema_new("char_test");
+	if (!schema) {
+		printf("ldms_schema_new failed\n");
+		return 1;
+	}
+	mid = ldms_schema_metric_add(schema, "c", LDMS_V_CHAR);
+	if (mid < 0) {
+		printf("ldms_schema_metric_add error %d\n", -mid);
+		return 1;
+	}
+	for (i = 0; i < ROWS; i++) {
+		snprintf(name, sizeof(name), "char_test/%d", i);
+		set[i] = ldms_set_new(name, schema);
+		if (!set[i]) {
+			printf("ldms_set_new '%s' error %d\n", name, errno);
+			return 1;
+		}
+		ldms_transaction_begin(set[i]);
+		ldms_metric_set_char(set[i], mid, vals[i]);
+		ldms_transaction_end(set[i]);
+		src[i] = ldms_metric_get(set[i], mid);
+	}
+
+	for (op = LDMSD_DECOMP_OP_DIFF; op <= LDMSD_DECOMP_OP_MAX; op++) {
+		kernel = decomp_static_kernel_get(op, LDMS_V_CHAR);
+		if (!kernel)
+			continue;
+		memset(&out, 0, sizeof(out));
+		kernel(&out, src, ROWS, 1);
+		if (out.v_char != expect[op]) {
+			printf("char %s: %d, expected %d\n", op_str[op],
+			       out.v_char, expect[op]);
+			rc = 1;
+		}
+		/* a single row */
+		kernel(&out, src, 1, 1);
+		if (out.v_char != (op == LDMSD_DECOMP_OP_DIFF ? 0 : vals[0])) {
+			printf("char %s of one row: %d\n", op_str[op], out.v_char);
+			rc = 1;
+		}
+	}
+
+	for (i = 0; i < ROWS; i++)
+		ldms_set_delete(set[i]);
+	ldms_schema_delete(schema);
+	printf("%s\n", rc ? "FAILED" : "PASSED");
+	return rc;
+}
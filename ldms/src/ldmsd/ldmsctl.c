@@ -942,6 +942,9 @@ static void help_updtr_add()
 		"                       the given interval and offset values. If not\n"
 		"                       specified, the value is `false`.\n"
 		"     [perm=]      The permission to modify the updater in the future.\n"
+		"     [batch=]     The maximum number of sets of a producer updated\n"
+		"                  in one batch. 0 (default) updates each set separately.\n"
+		"                  `batch` cannot be used with `push`.\n"
 		);
 
 }
@@ -1298,7 +1301,18 @@ static void help_strgp_add()
 		"     [flush=]     The interval between calls to the storage plugin flush method.\n"
 		"                  By default, the flush method is not called.\n"
 		"     [perm=]      The permission to modify the storage policy in the future.\n"
-		"     [decomposition=]   The path to the decomposition configuration file.\n");
+		"     [decomposition=]   The path to the decomposition configuration file.\n"
+		"     [queue_depth=]     The maximum number of stores queued for the store\n"
+		"                        threads. 0 (default) stores on the update threads.\n"
+		"     [queue_policy=]    block|drop, what to do with an update when the\n"
+		"                        queue is full. The default is block.\n");
+}
+
+static void help_store_threads()
+{
+	printf( "\nSet the number of threads serving the storage policy queues\n\n"
+		"Parameters:\n"
+		"     num=   The number of threads (default 1)\n");
 }
 
 static void help_strgp_del()
@@ -1358,6 +1372,79 @@ static void help_strgp_stop()
 		"     name=   The storage policy name\n");
 }
 
+static void __print_strgp_hist(const char *label, json_entity_t hist)
+{
+	json_entity_t b;
+	int i;
+
+	printf("    %s:", label);
+	for (i = 0, b = json_item_first(hist); b; b = json_item_next(b), i++) {
+		if (!json_value_int(b))
+			continue;
+		if (i)
+			printf(" <%ld:%ld", 1L << i, json_value_int(b));
+		else
+			printf(" <1:%ld", json_value_int(b));
+	}
+	printf("\n");
+}
+
+static void __print_strgp_queue(json_entity_t q)
+{
+	json_entity_t depth, max_depth, policy, enq, cmp, drop, coal, wait, store;
+	json_entity_t bp;
+
+	if (!q || q->type != JSON_DICT_VALUE)
+		return; /* older ldmsd */
+	depth = json_value_find(q, "depth");
+	max_depth = json_value_find(q, "max_depth");
+	policy = json_value_find(q, "policy");
+	enq = json_value_find(q, "enqueued");
+	cmp = json_value_find(q, "completed");
+	drop = json_value_find(q, "dropped");
+	coal = json_value_find(q, "coalesced");
+	wait = json_value_find(q, "wait_us_hist");
+	store = json_value_find(q, "store_us_hist");
+	if (!depth || !max_depth || !policy || !enq || !cmp || !drop ||
+	    !coal || !wait || !store) {
+		printf("---Invalid result format---\n");
+		return;
+	}
+	bp = json_value_find(q, "backpressure"); /* may be an older ldmsd */
+	if (!json_value_int(max_depth)) {
+		/* inline store */
+		if (bp && json_value_int(bp))
+			printf("       store backpressure %ld\n", json_value_int(bp));
+		return;
+	}
+	printf("       queue: depth %ld/%ld policy %s enqueued %ld completed %ld "
+	       "dropped %ld coalesced %ld backpressure %ld\n",
+	       json_value_int(depth), json_value_int(max_depth),
+	       json_value_str(policy)->str, json_value_int(enq),
+	       json_value_int(cmp), json_value_int(drop), json_value_int(coal),
+	       bp ? json_value_int(bp) : 0);
+	__print_strgp_hist(" wait(usec)", wait);
+	__print_strgp_hist("store(usec)", store);
+}
+
+static void __print_strgp_row_arena(json_entity_t ra)
+{
+	json_entity_t hwm, avoided;
+
+	if (!ra || ra->type != JSON_DICT_VALUE)
+		return; /* older ldmsd */
+	hwm = json_value_find(ra, "hwm");
+	avoided = json_value_find(ra, "allocs_avoided");
+	if (!hwm || !avoided) {
+		printf("---Invalid result format---\n");
+		return;
+	}
+	if (!json_value_int(avoided))
+		return; /* no decomposition or not stored yet */
+	printf("   row arena: high-water mark %ld bytes, allocations avoided %ld\n",
+	       json_value_int(hwm), json_value_int(avoided));
+}
+
 void __print_strgp_status(json_entity_t strgp)
 {
 	if (strgp->type != JSON_DICT_VALUE)
@@ -1415,6 +1502,9 @@ void __print_strgp_status(json_entity_t strgp)
 		printf(" %s", json_value_str(metric)->str);
 	}
 	printf("\n");
+
+	__print_strgp_queue(json_value_find(strgp, "queue"));
+	__print_strgp_row_arena(json_value_find(strgp, "row_arena"));
 	return;
 
 invalid_result_format:
@@ -2149,9 +2239,11 @@ static void resp_set_stats(ldmsd_req_hdr_t resp, size_t len, uint32_t rsp_err)
 	else
 		printf("Set Stats - N/A\n");
 
-	char *names[5] = { "active_count", "deleting_count",
+	char *names[] = { "active_count", "deleting_count",
 			   "mem_total_kb", "mem_used_kb",
-			   "mem_free_kb"
+			   "mem_free_kb", "meta_shared_sets",
+			   "meta_shared_blocks", "meta_export_sets",
+			   "meta_saved_kb"
 	};
 
 	a = json_value_find(stats, "summary");
@@ -2161,7 +2253,7 @@ static void resp_set_stats(ldmsd_req_hdr_t resp, size_t len, uint32_t rsp_err)
 		 */
 		num_attr = 2;
 	} else {
-		num_attr = 5;
+		num_attr = sizeof(names) / sizeof(names[0]);
 	}
 	printf("%-20s %-16s\n", "Name", "Count");
 	printf("-------------------- ----------------\n");
@@ -2429,6 +2521,7 @@ static struct command command_tbl[] = {
 	{ "source", LDMSCTL_SOURCE, handle_source, help_source, resp_generic },
 	{ "start", LDMSD_PLUGN_START_REQ, NULL, help_start, resp_generic },
 	{ "stop", LDMSD_PLUGN_STOP_REQ, NULL, help_stop, resp_generic },
+	{ "store_threads", LDMSD_STORE_THR_SET_REQ, NULL, help_store_threads, resp_generic },
 	{ "stream_client_dump", LDMSD_STREAM_CLIENT_DUMP_REQ, NULL, help_stream_client_dump, resp_stream_client_dump },
 	{ "stream_status", LDMSD_STREAM_STATUS_REQ, NULL, help_stream_status, resp_stream_status },
 	{ "strgp_add", LDMSD_STRGP_ADD_REQ, NULL, help_strgp_add, resp_generic },
@@ -233,6 +233,7 @@ typedef struct ldmsd_prdcr {
 	unsigned short port_no;		/* Port number */
 	char *xprt_name;	/* Transport name */
 	ldms_t xprt;
+	ldms_dir_cache_t dir_cache;	/* Directory of the peer across reconnects */
 	long conn_intrvl_us;	/* connect interval */
 	char *conn_auth_dom_name;		/* auth domain name */
 	char *conn_auth;			/* auth plugin for the connection */
@@ -350,6 +351,7 @@ typedef struct ldmsd_strgp *ldmsd_strgp_t;
 typedef struct ldmsd_strgp_ref {
 	ldmsd_strgp_t strgp;
 	void *decomp_ctxt;
+	int store_pending; /* a store work of this set is in the strgp queue */
 	LIST_ENTRY(ldmsd_strgp_ref) entry;
 } *ldmsd_strgp_ref_t;
 
@@ -411,6 +413,9 @@ typedef struct ldmsd_prdcr_set {
 	int oversampled_cnt;
 	uint64_t zap_thread_id; /* A thread handling the update completion event. */
 
+	int store_pending;	/* Number of queued strgp store works */
+	int store_set_ready;	/* Move to READY when the store works are done */
+
 	int ref_count;
 	struct timespec lookup_complete_ts;
 } *ldmsd_prdcr_set_t;
@@ -545,6 +550,14 @@ typedef struct ldmsd_updtr {
 	 */
 	struct rbt prdcr_tree;
 	LIST_HEAD(updtr_match_list, ldmsd_name_match) match_list;
+
+	/*
+	 * The maximum number of sets of a producer updated with a single
+	 * ldms_xprt_update_batch() call. If this value is 0, each set is
+	 * updated with its own ldms_xprt_update() call.
+	 */
+	int batch_sz;
+	struct ldms_update_batch_ent_s *batch;
 } *ldmsd_updtr_t;
 
 typedef struct ldmsd_name_match {
@@ -574,34 +587,54 @@ typedef struct ldmsd_strgp_metric {
 	TAILQ_ENTRY(ldmsd_strgp_metric) entry;
 } *ldmsd_strgp_metric_t;
 
+typedef struct ldmsd_row_s *ldmsd_row_t;
+typedef struct ldmsd_row_cache_idx_s *ldmsd_row_cache_idx_t;
+
+/*
+ * A group of cached rows. The rows are kept in a ring of \c cap slots in
+ * the order of their row keys; \c head is the slot of the row with the
+ * greatest key (the newest). The numeric column values (scalars, arrays
+ * and timestamps) of the cached rows are copied into \c vals, one ring of
+ * \c cap values per column, so that the functional operators can work on
+ * the column without touching the rows.
+ */
 typedef struct ldmsd_row_group_s {
-	ldmsd_strgp_t strgp;
-	int row_key_count;
-	struct rbt row_tree;	/* Tree of ldmsd_row_cache_entry_t */
-	struct rbn rbn;
+	uint64_t hash;
+	ldmsd_row_cache_idx_t key;	/* group key */
+	int cap;			/* ring capacity, a power of 2 > row_limit */
+	int count;			/* number of rows in the ring */
+	int head;			/* slot of the newest row */
+	int col_count;
+	ldmsd_row_t *rows;		/* [cap] */
+	ldmsd_row_cache_idx_t *row_keys;	/* [cap] */
+	struct ldmsd_row_group_col_s {
+		size_t off;		/* offset of the column ring in vals */
+		size_t size;		/* size of a value, 0 if not numeric */
+	} *cols;			/* [col_count] */
+	uint8_t *vals;
 	LIST_ENTRY( ldmsd_row_group_s ) bucket_entry;
 	struct timespec last_update; /* informational */
 } *ldmsd_row_group_t;
 
+/*
+ * The groups are kept in a hash table (open addressing, linear probing).
+ * The cache is used under the strgp lock.
+ */
 typedef struct ldmsd_row_cache_s {
 	ldmsd_strgp_t strgp;
 	int row_limit;
-	struct rbt group_tree;	/* Tree of ldmsd_row_group_t */
-	pthread_mutex_t lock;
+	struct timespec cfg_timeout; /* timeout for each bucket */
+	ldmsd_row_group_t *slots;
+	size_t slot_count;		/* a power of 2 */
+	size_t group_count;
 	LIST_HEAD(, ldmsd_row_group_s) group_bucket[3];
 	int gb_idx; /* current group bucket index: 0, 1, or 2 */
 	struct timespec bucket_ts; /* timestamp to trigger the bucket change */
-	struct timespec cfg_timeout; /* timeout for each bucket */
+	/* a row dropped as soon as it was cached, freed on the next call */
+	ldmsd_row_t dropped_row;
+	ldmsd_row_cache_idx_t dropped_key;
 } *ldmsd_row_cache_t;
 
-typedef struct ldmsd_row_s *ldmsd_row_t;
-typedef struct ldmsd_row_cache_idx_s *ldmsd_row_cache_idx_t;
-typedef struct ldmsd_row_cache_entry_s {
-	ldmsd_row_t row;
-	ldmsd_row_cache_idx_t idx;
-	struct rbn rbn;
-} *ldmsd_row_cache_entry_t;
-
 typedef struct ldmsd_row_cache_key_s {
 	enum ldms_value_type type;
 	size_t count;			/* The element count if an array */
@@ -614,7 +647,6 @@ struct ldmsd_row_cache_idx_s {
 	ldmsd_row_cache_key_t *keys;	/* Array of ldmsd_row_cache_key_t */
 };
 
-typedef struct ldmsd_row_s *ldmsd_row_t;
 typedef struct ldmsd_row_list_s *ldmsd_row_list_t;
 
 ldmsd_row_cache_t ldmsd_row_cache_create(ldmsd_strgp_t strgp, int row_count,
@@ -622,17 +654,95 @@ ldmsd_row_cache_t ldmsd_row_cache_create(ldmsd_strgp_t strgp, int row_count,
 ldmsd_row_cache_key_t ldmsd_row_cache_key_create(enum ldms_value_type type, size_t len);
 ldmsd_row_cache_idx_t ldmsd_row_cache_idx_create(int key_count, ldmsd_row_cache_key_t *keys);
 void ldmsd_row_cache_idx_free(ldmsd_row_cache_idx_t idx);
+
+/**
+ * \brief Cache \c row in the group \c group_key
+ *
+ * The cache takes the ownership of \c row and \c row_key. The \c group_key
+ * is copied if the group is new. The row is inserted in the order of the
+ * row keys, then, if the group has more than \c row_limit rows, the row
+ * with the smallest row key is dropped; this is \c row itself if it is
+ * older than all of the cached rows of a full group. \c row remains valid
+ * until the next \c ldmsd_row_cache() call on \c rcache in any case.
+ *
+ * \param [out] group The group of the row. It remains valid until the next
+ *                    \c ldmsd_row_cache() call on \c rcache.
+ *
+ * \retval 0     If succeeded.
+ * \retval errno If there is an error.
+ */
 int ldmsd_row_cache(ldmsd_row_cache_t rcache,
 		ldmsd_row_cache_idx_t group_key,
 		ldmsd_row_cache_idx_t row_key,
-		ldmsd_row_t row);
+		ldmsd_row_t row, ldmsd_row_group_t *group);
 ldmsd_row_t ldmsd_row_dup(ldmsd_row_t);
-int ldmsd_row_cache_make_list(ldmsd_row_list_t row_list, int row_count,
-	ldmsd_row_cache_t cache, ldmsd_row_cache_idx_t group_key);
+
+/** The slot of the \c i-th newest row of the \c group */
+static inline int ldmsd_row_group_slot(ldmsd_row_group_t group, int i)
+{
+	return (group->head - i) & (group->cap - 1);
+}
+
+/** The \c i-th newest row of the \c group */
+static inline ldmsd_row_t ldmsd_row_group_row(ldmsd_row_group_t group, int i)
+{
+	return group->rows[ldmsd_row_group_slot(group, i)];
+}
+
+/**
+ * The value of the column \c col_id of the \c i-th newest row of the
+ * \c group. Only numeric columns (numbers, arrays of numbers, char and
+ * timestamp) have values; others are 0.
+ */
+static inline ldms_mval_t ldmsd_row_group_val(ldmsd_row_group_t group, int col_id, int i)
+{
+	struct ldmsd_row_group_col_s *col = &group->cols[col_id];
+	return (ldms_mval_t)&group->vals[col->off +
+				ldmsd_row_group_slot(group, i) * col->size];
+}
 
 typedef void (*strgp_update_fn_t)(ldmsd_strgp_t strgp, ldmsd_prdcr_set_t prd_set, void **ctxt);
 typedef struct ldmsd_cfgobj_store *ldmsd_cfgobj_store_t;
 
+/**
+ * A store of a producer set update by a storage policy that is deferred to
+ * the strgp worker threads.
+ */
+typedef struct ldmsd_strgp_work {
+	ldmsd_strgp_t strgp;
+	ldmsd_prdcr_set_t prd_set;
+	struct timespec enqueue_ts;
+	TAILQ_ENTRY(ldmsd_strgp_work) entry;
+} *ldmsd_strgp_work_t;
+TAILQ_HEAD(ldmsd_strgp_work_list, ldmsd_strgp_work);
+
+/* Histogram buckets of the store latencies, bucket i counts [2^(i-1), 2^i) usec */
+#define LDMSD_STRGP_HIST_LEN 20
+
+enum ldmsd_strgp_queue_policy {
+	LDMSD_STRGP_QUEUE_BLOCK,	/* block the update until there is room */
+	LDMSD_STRGP_QUEUE_DROP,		/* drop the store of the update */
+};
+
+struct ldmsd_strgp_queue {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;		/* signaled when a work is dequeued */
+	struct ldmsd_strgp_work_list work_list;
+	int depth;			/* Number of works in the queue */
+	int max_depth;			/* 0 means the store is done inline */
+	enum ldmsd_strgp_queue_policy policy;
+	int scheduled;			/* The strgp is on the worker run queue */
+	TAILQ_ENTRY(ldmsd_strgp) run_entry;
+
+	uint64_t enqueued;
+	uint64_t completed;
+	uint64_t dropped;
+	uint64_t coalesced;		/* Updates covered by a pending work */
+	uint64_t backpressure;		/* Stores the store could not queue */
+	uint64_t wait_hist[LDMSD_STRGP_HIST_LEN];	/* queueing latency */
+	uint64_t store_hist[LDMSD_STRGP_HIST_LEN];	/* store latency */
+};
+
 struct ldmsd_strgp {
 	 struct ldmsd_cfgobj obj;
 
@@ -687,6 +797,15 @@ struct ldmsd_strgp {
 
 	int row_cache_init;
 	ldmsd_row_cache_t row_cache;
+
+	/** Store work queue served by the strgp worker threads */
+	struct ldmsd_strgp_queue queue;
+
+	/** Row arena usage of the decomposition, protected by the strgp lock */
+	struct {
+		size_t hwm;		/* the most bytes used by one update */
+		uint64_t allocs_avoided;
+	} row_arena;
 };
 
 
@@ -896,6 +1015,27 @@ int ldmsd_row_to_json_array(ldmsd_row_t row, char **str, int *len);
  */
 int ldmsd_row_to_json_object(ldmsd_row_t row, char **str, int *len);
 
+/**
+ * Append a JSON text object from an ldmsd_row_t to a reusable buffer
+ *
+ * Same as \c ldmsd_row_to_json_object() except that the text is written to
+ * the caller's buffer \c *buf of \c *sz bytes at offset \c *off. The buffer
+ * is grown with realloc() when it is too small, so \c *buf may be \c NULL
+ * (and \c *sz 0) initially. The caller keeps the buffer for the next rows and
+ * frees it when done.
+ *
+ * \param          row The row handle.
+ * \param [in,out] buf The output buffer.
+ * \param [in,out] sz  The size of \c *buf.
+ * \param [in,out] off The offset at which the text is written. On success,
+ *                     it is advanced to the terminating '\0' of the text.
+ *
+ * \retval 0     If succeded.
+ * \retval errno If there is an error.
+ */
+int ldmsd_row_to_json_object_buf(ldmsd_row_t row, char **buf, size_t *sz,
+				 size_t *off);
+
 /**
  * Create an Avro schema definition from an ldmsd_row_t
  *
@@ -947,6 +1087,51 @@ char *ldmsd_avro_name_get(const char *ldms_name);
  */
 int ldmsd_decomp_config(ldmsd_strgp_t strgp, const char *json_path, ldmsd_req_ctxt_t reqc);
 
+/*
+ * Row arena
+ *
+ * Decomposers carve the rows (and their scratch memory) of an update from a
+ * per-thread slab instead of calloc()/free() of each of them. The slab is
+ * reset in one shot when the last piece is freed, i.e. when the storage
+ * policy releases the rows after commit(). Allocations that do not fit in
+ * the slab fall back to the heap; the slab grows to the demand of the
+ * previous update at the next ldmsd_row_arena_reserve().
+ *
+ * Memory from the arena must not outlive the update (e.g. rows given to
+ * the row cache must come from the heap) and must be freed on the thread
+ * that allocated it.
+ */
+
+/**
+ * \brief Make sure the arena of this thread can hold \c size bytes.
+ *
+ * This is a hint given by a decomposer before decomposing a set. It takes
+ * effect only if the arena is empty.
+ */
+void ldmsd_row_arena_reserve(size_t size);
+
+/**
+ * \brief Allocate \c size zeroed bytes from the arena of this thread.
+ *
+ * \retval ptr  The memory.
+ * \retval NULL If out of memory.
+ */
+void *ldmsd_row_arena_alloc(size_t size);
+
+/**
+ * \brief Free the memory from \c ldmsd_row_arena_alloc().
+ */
+void ldmsd_row_arena_free(void *ptr);
+
+/**
+ * \brief Get the arena usage of this thread.
+ *
+ * \param [out] used    The bytes requested since the arena was reset.
+ * \param [out] avoided The number of allocations served by the slab
+ *                      since the thread started.
+ */
+void ldmsd_row_arena_usage(size_t *used, uint64_t *avoided);
+
 typedef struct ldmsd_xprt_ctxt {
 	char *name;
 } *ldmsd_xprt_ctxt_t;
@@ -995,6 +1180,10 @@ struct ldmsd_store {
 	int (*flush)(ldmsd_plug_handle_t handle, ldmsd_store_handle_t sh);
 	int (*store)(ldmsd_plug_handle_t handle, ldmsd_store_handle_t sh,
 		     ldms_set_t set, int *, size_t count);
+	/*
+	 * Returns EAGAIN if the store is not keeping up and did not store any
+	 * of the rows; the strgp waits and commits the same rows again.
+	 */
 	int (*commit)(ldmsd_plug_handle_t handle, ldmsd_strgp_t strgp, ldms_set_t set,
 		      ldmsd_row_list_t row_list, int row_count);
 };
@@ -1382,6 +1571,7 @@ ldmsd_updtr_new_with_auth(const char *name, char *interval_str, char *offset_str
 					int push_flags, int is_auto_task,
 					uid_t uid, gid_t gid, int perm);
 int ldmsd_updtr_del(const char *updtr_name, ldmsd_sec_ctxt_t ctxt);
+int ldmsd_updtr_batch_set(ldmsd_updtr_t updtr, int batch_sz);
 ldmsd_updtr_t ldmsd_updtr_first();
 ldmsd_updtr_t ldmsd_updtr_next(struct ldmsd_updtr *updtr);
 ldmsd_name_match_t ldmsd_updtr_match_first(ldmsd_updtr_t updtr);
@@ -1453,6 +1643,43 @@ static inline void ldmsd_strgp_lock(ldmsd_strgp_t strgp) {
 static inline void ldmsd_strgp_unlock(ldmsd_strgp_t strgp) {
 	ldmsd_cfgobj_unlock(&strgp->obj);
 }
+/**
+ * \brief Configure the store work queue of a storage policy
+ *
+ * \param strgp The storage policy
+ * \param depth The maximum number of queued stores; 0 stores inline
+ * \param policy "block" or "drop", the action when the queue is full
+ *
+ * \retval 0 If succeeded
+ * \retval EINVAL If \c depth or \c policy is invalid
+ * \retval EBUSY If the storage policy is running
+ */
+int ldmsd_strgp_queue_config(ldmsd_strgp_t strgp, int depth, const char *policy);
+const char *ldmsd_strgp_queue_policy_str(enum ldmsd_strgp_queue_policy policy);
+/**
+ * \brief Set the number of strgp worker threads
+ *
+ * The threads are created when the first store work is queued. The number
+ * can only be increased after that.
+ */
+int ldmsd_strgp_worker_count_set(int count);
+int ldmsd_strgp_worker_count_get();
+/**
+ * \brief Create a store work of \c prd_set for the strgp of \c ref
+ *
+ * Must be called with the producer set lock held.
+ *
+ * \retval work The work to give to ldmsd_strgp_work_submit()
+ * \retval NULL If a store of the set is already pending, or out of memory
+ */
+ldmsd_strgp_work_t ldmsd_strgp_work_new(ldmsd_prdcr_set_t prd_set, ldmsd_strgp_ref_t ref);
+/**
+ * \brief Queue the store work
+ *
+ * Must be called without the producer set lock held. Depending on the queue
+ * policy, this blocks until there is room in the queue or drops the work.
+ */
+void ldmsd_strgp_work_submit(ldmsd_strgp_work_t work);
 static inline ldmsd_strgp_t ldmsd_strgp_find(const char *name) {
 	return (ldmsd_strgp_t)ldmsd_cfgobj_find_get(name, LDMSD_CFGOBJ_STRGP);
 }
@@ -273,45 +273,46 @@ err_0:
 	return rc;
 }
 
+/*
+ * A single growable output buffer. The buffer may be supplied (and kept) by
+ * the caller so that formatting many rows reuses the same memory.
+ */
 typedef struct strbuf_s {
-	TAILQ_ENTRY(strbuf_s) entry;
+	char *buf;
 	int off; /* current write offset */
 	int remain; /* remaining bytes */
-	char buf[];
 } *strbuf_t;
-TAILQ_HEAD(strbuf_tailq_s, strbuf_s);
-typedef struct strbuf_tailq_s *strbuf_tailq_t;
 
-void strbuf_purge(strbuf_tailq_t h)
+void strbuf_purge(strbuf_t b)
 {
-	strbuf_t b;
-	while ((b = TAILQ_FIRST(h))) {
-		TAILQ_REMOVE(h, b, entry);
-		free(b);
-	}
+	free(b->buf);
+	b->buf = NULL;
+	b->off = 0;
+	b->remain = 0;
 }
 
 __attribute__(( format(printf, 2, 3) ))
-int strbuf_printf(strbuf_tailq_t h, const char *fmt, ...)
+int strbuf_printf(strbuf_t b, const char *fmt, ...)
 {
 	va_list ap;
-	int len;
-	strbuf_t b = TAILQ_LAST(h, strbuf_tailq_s);
+	int len, sz;
+	char *buf;
 
-	if (b)
+	if (b->remain)
 		goto print;
 
-	/* no buffer, allocate one */
+	/* no room, grow the buffer */
 	len = BUFSIZ;
 
  alloc:
-	len = (len + BUFSIZ - 1) & ~(BUFSIZ-1);
-	b = malloc(sizeof(*b) + len);
-	if (!b)
+	sz = (b->off + len + 1 + BUFSIZ - 1) & ~(BUFSIZ-1);
+	if (sz < 2 * (b->off + b->remain))
+		sz = 2 * (b->off + b->remain);
+	buf = realloc(b->buf, sz);
+	if (!buf)
 		return ENOMEM;
-	b->remain = len;
-	b->off = 0;
-	TAILQ_INSERT_TAIL(h, b, entry);
+	b->buf = buf;
+	b->remain = sz - b->off;
 
  print:
 	va_start(ap, fmt);
@@ -326,95 +327,74 @@ int strbuf_printf(strbuf_tailq_t h, const char *fmt, ...)
 	return 0;
 }
 
-static int strbuf_str(strbuf_tailq_t h, char **out_str, int *out_len)
-{
-	int len = 0, off = 0;
-	char *str;
-	strbuf_t b;
-	TAILQ_FOREACH(b, h, entry) {
-		len += b->off;
-	}
-	str = malloc(len + 1);
-	if (!str)
-		return ENOMEM;
-	TAILQ_FOREACH(b, h, entry) {
-		memcpy(str + off, b->buf, b->off);
-		off += b->off;
-	}
-	str[len] = '\0';
-	*out_str = str;
-	*out_len = len;
-	return 0;
-}
-
-static int strbuf_printcol_s8(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_s8(strbuf_t h, ldmsd_col_t col)
 {
 	return strbuf_printf(h, "%hhd", col->mval->v_s8);
 }
 
-static int strbuf_printcol_u8(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_u8(strbuf_t h, ldmsd_col_t col)
 {
 	return strbuf_printf(h, "%hhu", col->mval->v_u8);
 }
 
-static int strbuf_printcol_s16(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_s16(strbuf_t h, ldmsd_col_t col)
 {
 	return strbuf_printf(h, "%hd", col->mval->v_s16);
 }
 
-static int strbuf_printcol_u16(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_u16(strbuf_t h, ldmsd_col_t col)
 {
 	return strbuf_printf(h, "%hu", col->mval->v_u16);
 }
 
-static int strbuf_printcol_s32(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_s32(strbuf_t h, ldmsd_col_t col)
 {
 	return strbuf_printf(h, "%d", col->mval->v_s32);
 }
 
-static int strbuf_printcol_u32(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_u32(strbuf_t h, ldmsd_col_t col)
 {
 	return strbuf_printf(h, "%u", col->mval->v_u32);
 }
 
-static int strbuf_printcol_s64(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_s64(strbuf_t h, ldmsd_col_t col)
 {
 	return strbuf_printf(h, "%ld", col->mval->v_s64);
 }
 
-static int strbuf_printcol_u64(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_u64(strbuf_t h, ldmsd_col_t col)
 {
 	return strbuf_printf(h, "%lu", col->mval->v_u64);
 }
 
-static int strbuf_printcol_f(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_f(strbuf_t h, ldmsd_col_t col)
 {
 	return strbuf_printf(h, "%.9g", col->mval->v_f);
 }
 
-static int strbuf_printcol_d(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_d(strbuf_t h, ldmsd_col_t col)
 {
 	return strbuf_printf(h, "%.17g", col->mval->v_d);
 }
 
-static int strbuf_printcol_char(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_char(strbuf_t h, ldmsd_col_t col)
 {
 	return strbuf_printf(h, "\"%c\"", col->mval->v_char);
 }
 
-static int strbuf_printcol_str(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_str(strbuf_t h, ldmsd_col_t col)
 {
 	return strbuf_printf(h, "\"%s\"", col->mval->a_char);
 }
 
-static int strbuf_printcol_ts(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_ts(strbuf_t h, ldmsd_col_t col)
 {
 	/* print TS as float */
 	return strbuf_printf(h, "%u.%06u", col->mval->v_ts.sec,
 					   col->mval->v_ts.usec);
 }
 
-static int strbuf_printcol_s8_array(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_s8_array(strbuf_t h, ldmsd_col_t col)
 {
 	int rc;
 	int i;
@@ -433,7 +413,7 @@ static int strbuf_printcol_s8_array(strbuf_tailq_t h, ldmsd_col_t col)
 	return rc;
 }
 
-static int strbuf_printcol_u8_array(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_u8_array(strbuf_t h, ldmsd_col_t col)
 {
 	int rc;
 	int i;
@@ -452,7 +432,7 @@ static int strbuf_printcol_u8_array(strbuf_tailq_t h, ldmsd_col_t col)
 	return rc;
 }
 
-static int strbuf_printcol_s16_array(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_s16_array(strbuf_t h, ldmsd_col_t col)
 {
 	int rc;
 	int i;
@@ -471,7 +451,7 @@ static int strbuf_printcol_s16_array(strbuf_tailq_t h, ldmsd_col_t col)
 	return rc;
 }
 
-static int strbuf_printcol_u16_array(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_u16_array(strbuf_t h, ldmsd_col_t col)
 {
 	int rc;
 	int i;
@@ -490,7 +470,7 @@ static int strbuf_printcol_u16_array(strbuf_tailq_t h, ldmsd_col_t col)
 	return rc;
 }
 
-static int strbuf_printcol_s32_array(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_s32_array(strbuf_t h, ldmsd_col_t col)
 {
 	int rc;
 	int i;
@@ -509,7 +489,7 @@ static int strbuf_printcol_s32_array(strbuf_tailq_t h, ldmsd_col_t col)
 	return rc;
 }
 
-static int strbuf_printcol_u32_array(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_u32_array(strbuf_t h, ldmsd_col_t col)
 {
 	int rc;
 	int i;
@@ -528,7 +508,7 @@ static int strbuf_printcol_u32_array(strbuf_tailq_t h, ldmsd_col_t col)
 	return rc;
 }
 
-static int strbuf_printcol_s64_array(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_s64_array(strbuf_t h, ldmsd_col_t col)
 {
 	int rc;
 	int i;
@@ -547,7 +527,7 @@ static int strbuf_printcol_s64_array(strbuf_tailq_t h, ldmsd_col_t col)
 	return rc;
 }
 
-static int strbuf_printcol_u64_array(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_u64_array(strbuf_t h, ldmsd_col_t col)
 {
 	int rc;
 	int i;
@@ -566,7 +546,7 @@ static int strbuf_printcol_u64_array(strbuf_tailq_t h, ldmsd_col_t col)
 	return rc;
 }
 
-static int strbuf_printcol_f_array(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_f_array(strbuf_t h, ldmsd_col_t col)
 {
 	int rc;
 	int i;
@@ -585,7 +565,7 @@ static int strbuf_printcol_f_array(strbuf_tailq_t h, ldmsd_col_t col)
 	return rc;
 }
 
-static int strbuf_printcol_d_array(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_d_array(strbuf_t h, ldmsd_col_t col)
 {
 	int rc;
 	int i;
@@ -604,7 +584,7 @@ static int strbuf_printcol_d_array(strbuf_tailq_t h, ldmsd_col_t col)
 	return rc;
 }
 
-typedef int (*printcol_fn)(strbuf_tailq_t h, ldmsd_col_t col);
+typedef int (*printcol_fn)(strbuf_t h, ldmsd_col_t col);
 printcol_fn printcol_tbl[] = {
 	[LDMS_V_S8] = strbuf_printcol_s8,
 	[LDMS_V_U8] = strbuf_printcol_u8,
@@ -632,7 +612,7 @@ printcol_fn printcol_tbl[] = {
 	[LDMS_V_LAST+1] = NULL,
 };
 
-static int strbuf_printcol(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol(strbuf_t h, ldmsd_col_t col)
 {
 	printcol_fn fn;
 	if (col->type > LDMS_V_LAST)
@@ -645,7 +625,7 @@ static int strbuf_printcol(strbuf_tailq_t h, ldmsd_col_t col)
 
 int ldmsd_row_to_json_array(ldmsd_row_t row, char **str, int *len)
 {
-	struct strbuf_tailq_s h = TAILQ_HEAD_INITIALIZER(h);
+	struct strbuf_s h = {0};
 	ldmsd_col_t col;
 	int i, rc;
 
@@ -667,48 +647,66 @@ int ldmsd_row_to_json_array(ldmsd_row_t row, char **str, int *len)
 	if (rc)
 		goto err_0;
 
-	rc = strbuf_str(&h, str, len);
-	strbuf_purge(&h);
-	return rc;
+	*str = h.buf;
+	*len = h.off;
+	return 0;
 
  err_0:
 	strbuf_purge(&h);
 	return rc;
 }
 
-int ldmsd_row_to_json_object(ldmsd_row_t row, char **str, int *len)
+static int __row_to_json_object(strbuf_t h, ldmsd_row_t row)
 {
-	struct strbuf_tailq_s h = TAILQ_HEAD_INITIALIZER(h);
 	ldmsd_col_t col;
 	int i, rc;
 
-	rc = strbuf_printf(&h, "{");
+	rc = strbuf_printf(h, "{");
 	if (rc)
-		goto err_0;
+		return rc;
 	for (i = 0; i < row->col_count; i++) {
 		col = &row->cols[i];
-		if (i) { /* comma */
-			rc = strbuf_printf(&h, ",");
-			if (rc)
-				goto err_0;
-		}
-		rc = strbuf_printf(&h, "\"%s\":", col->name);
+		rc = strbuf_printf(h, i?",\"%s\":":"\"%s\":", col->name);
 		if (rc)
-			goto err_0;
-		rc = strbuf_printcol(&h, col);
+			return rc;
+		rc = strbuf_printcol(h, col);
 		if (rc)
-			goto err_0;
+			return rc;
 	}
-	rc = strbuf_printf(&h, "}");
-	if (rc)
-		goto err_0;
+	return strbuf_printf(h, "}");
+}
 
-	rc = strbuf_str(&h, str, len);
-	strbuf_purge(&h);
-	return rc;
+int ldmsd_row_to_json_object(ldmsd_row_t row, char **str, int *len)
+{
+	struct strbuf_s h = {0};
+	int rc;
 
- err_0:
-	strbuf_purge(&h);
+	rc = __row_to_json_object(&h, row);
+	if (rc) {
+		strbuf_purge(&h);
+		return rc;
+	}
+	*str = h.buf;
+	*len = h.off;
+	return 0;
+}
+
+int ldmsd_row_to_json_object_buf(ldmsd_row_t row, char **buf, size_t *sz,
+				 size_t *off)
+{
+	struct strbuf_s h = {
+		.buf = *buf,
+		.off = *off,
+		.remain = *buf ? *sz - *off : 0,
+	};
+	int rc;
+
+	rc = __row_to_json_object(&h, row);
+	/* the buffer may have moved even if the formatting failed */
+	*buf = h.buf;
+	*sz = h.off + h.remain;
+	if (!rc)
+		*off = h.off;
 	return rc;
 }
 
@@ -806,7 +804,7 @@ char *ldmsd_avro_name_get(const char *ldms_name)
 int ldmsd_row_to_json_avro_schema(ldmsd_row_t row, char **str, size_t *len)
 {
 	char *avro_name = NULL;
-	struct strbuf_tailq_s h = TAILQ_HEAD_INITIALIZER(h);
+	struct strbuf_s h = {0};
 	ldmsd_col_t col;
 	int i, rc;
 
@@ -888,10 +886,10 @@ int ldmsd_row_to_json_avro_schema(ldmsd_row_t row, char **str, size_t *len)
 	if (rc)
 		goto err_0;
 
-	rc = strbuf_str(&h, str, (int *)len);
-	strbuf_purge(&h);
+	*str = h.buf;
+	*len = h.off;
 	free(avro_name);
-	return rc;
+	return 0;
 
  err_0:
 	if (avro_name)
@@ -938,3 +936,115 @@ ldmsd_phony_metric_id_t ldmsd_phony_metric_resolve(const char *str)
 		return LDMSD_PHONY_METRIC_ID_UNKNOWN;
 	return ent->id;
 }
+
+/* ==== Row arena ==== */
+
+#define ROW_ARENA_ALIGN 16
+#define ROW_ARENA_MIN_SZ 4096
+
+typedef struct row_arena_s {
+	char *slab;
+	size_t slab_sz;
+	size_t off;		/* bytes carved from the slab */
+	size_t demand;		/* bytes requested since the slab was reset */
+	int live;		/* pieces of the slab not yet freed */
+	uint64_t avoided;	/* allocations served by the slab */
+} *row_arena_t;
+
+static pthread_key_t row_arena_key;
+static pthread_once_t row_arena_once = PTHREAD_ONCE_INIT;
+
+static void row_arena_destroy(void *arg)
+{
+	row_arena_t a = arg;
+	free(a->slab);
+	free(a);
+}
+
+static void row_arena_key_init(void)
+{
+	(void)pthread_key_create(&row_arena_key, row_arena_destroy);
+}
+
+static row_arena_t row_arena_get(void)
+{
+	row_arena_t a;
+
+	pthread_once(&row_arena_once, row_arena_key_init);
+	a = pthread_getspecific(row_arena_key);
+	if (a)
+		return a;
+	a = calloc(1, sizeof(*a));
+	if (!a)
+		return NULL;
+	if (pthread_setspecific(row_arena_key, a)) {
+		free(a);
+		return NULL;
+	}
+	return a;
+}
+
+void ldmsd_row_arena_reserve(size_t size)
+{
+	row_arena_t a = row_arena_get();
+	char *slab;
+
+	if (!a || a->live)
+		return;
+	a->off = 0;
+	if (size < a->demand)
+		size = a->demand;
+	a->demand = 0;
+	if (size <= a->slab_sz)
+		return;
+	if (size < ROW_ARENA_MIN_SZ)
+		size = ROW_ARENA_MIN_SZ;
+	size = (size + ROW_ARENA_MIN_SZ - 1) & ~((size_t)ROW_ARENA_MIN_SZ - 1);
+	slab = malloc(size);
+	if (!slab)
+		return; /* keep the old slab */
+	free(a->slab);
+	a->slab = slab;
+	a->slab_sz = size;
+}
+
+void *ldmsd_row_arena_alloc(size_t size)
+{
+	row_arena_t a = row_arena_get();
+	void *p;
+
+	size = (size + ROW_ARENA_ALIGN - 1) & ~((size_t)ROW_ARENA_ALIGN - 1);
+	if (!a)
+		return calloc(1, size);
+	a->demand += size;
+	if (a->off + size > a->slab_sz)
+		return calloc(1, size);
+	p = &a->slab[a->off];
+	a->off += size;
+	a->live++;
+	a->avoided++;
+	memset(p, 0, size);
+	return p;
+}
+
+void ldmsd_row_arena_free(void *ptr)
+{
+	row_arena_t a;
+
+	pthread_once(&row_arena_once, row_arena_key_init);
+	a = pthread_getspecific(row_arena_key);
+	if (a && (char *)ptr >= a->slab && (char *)ptr < a->slab + a->slab_sz) {
+		if (0 == --a->live)
+			a->off = 0;
+		return;
+	}
+	free(ptr);
+}
+
+void ldmsd_row_arena_usage(size_t *used, uint64_t *avoided)
+{
+	row_arena_t a = row_arena_get();
+
+	*used = a ? a->demand : 0;
+	*avoided = a ? a->avoided : 0;
+}
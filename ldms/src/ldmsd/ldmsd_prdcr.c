@@ -93,6 +93,7 @@ void ldmsd_prdcr___del(ldmsd_cfgobj_t obj)
 	free(prdcr->conn_auth_dom_name);
 	if (prdcr->conn_auth_args)
 		av_free(prdcr->conn_auth_args);
+	ldms_dir_cache_free(prdcr->dir_cache);
 	ldmsd_cfgobj___del(obj);
 }
 
@@ -738,8 +739,8 @@ static int __agg_routine(ldms_t x, ldms_xprt_event_t e, ldmsd_prdcr_t prdcr)
 				  "Could not subscribe to stream data on producer %s\n",
 				  prdcr->obj.name);
 		}
-		rc = ldms_xprt_dir(prdcr->xprt, prdcr_dir_cb, prdcr,
-						LDMS_DIR_F_NOTIFY);
+		rc = ldms_xprt_dir_cached(prdcr->xprt, prdcr_dir_cb, prdcr,
+					  LDMS_DIR_F_NOTIFY, prdcr->dir_cache);
 		if (rc)
 			ldms_xprt_close(prdcr->xprt);
 		ldmsd_task_stop(&prdcr->task);
@@ -1044,6 +1045,8 @@ ldmsd_prdcr_new_with_auth(const char *name, const char *xprt_name,
 	if (!prdcr->host_name)
 		goto out;
 	prdcr->xprt_name = strdup(xprt_name);
+	/* Without the cache the whole directory is sent on every reconnect */
+	prdcr->dir_cache = ldms_dir_cache_new();
 	if ((type == LDMSD_PRDCR_TYPE_ACTIVE) || (type == LDMSD_PRDCR_TYPE_BRIDGE)) {
 		/* The producer needs the port information to send the connection request */
 		/* Verify that the port_no exists. */
@@ -310,6 +310,7 @@ static int publish_kernel_handler(ldmsd_req_ctxt_t reqc);
 static int daemon_name_set_handler(ldmsd_req_ctxt_t reqc);
 static int worker_threads_set_handler(ldmsd_req_ctxt_t reqc);
 static int default_quota_set_handler(ldmsd_req_ctxt_t reqc);
+static int store_threads_set_handler(ldmsd_req_ctxt_t reqc);
 static int pid_file_handler(ldmsd_req_ctxt_t reqc);
 static int banner_mode_handler(ldmsd_req_ctxt_t reqc);
 
@@ -700,6 +701,9 @@ static struct request_handler_entry request_handler[] = {
 	[LDMSD_DEFAULT_QUOTA_REQ] = {
 		LDMSD_DEFAULT_QUOTA_REQ, default_quota_set_handler, XUG
 	},
+	[LDMSD_STORE_THR_SET_REQ] = {
+		LDMSD_STORE_THR_SET_REQ, store_threads_set_handler, XUG
+	},
 	[LDMSD_PID_FILE_REQ] = {
 		LDMSD_PID_FILE_REQ, pid_file_handler, XUG
 	},
@@ -2618,6 +2622,8 @@ static int strgp_add_handler(ldmsd_req_ctxt_t reqc)
 {
 	char *attr_name, *name, *plugin, *container, *schema, *interval, *regex;
 	char *decomp = NULL;
+	char *qdepth = NULL;
+	char *qpolicy = NULL;
 	name = plugin = container = schema = interval = regex = NULL;
 	size_t cnt = 0;
 	uid_t uid;
@@ -2738,6 +2744,19 @@ static int strgp_add_handler(ldmsd_req_ctxt_t reqc)
 
 	strgp->flush_interval = flush_interval;
 
+	qdepth = ldmsd_req_attr_str_value_get_by_id(reqc, LDMSD_ATTR_SIZE);
+	qpolicy = ldmsd_req_attr_str_value_get_by_id(reqc, LDMSD_ATTR_TYPE);
+	if (qdepth || qpolicy) {
+		rc = ldmsd_strgp_queue_config(strgp, qdepth ? atoi(qdepth) : 0, qpolicy);
+		if (rc) {
+			reqc->errcode = rc;
+			cnt = Snprintf(&reqc->line_buf, &reqc->line_len,
+				       "Invalid queue_depth '%s' or queue_policy '%s'.",
+				       qdepth ? qdepth : "", qpolicy ? qpolicy : "");
+			goto send_reply;
+		}
+	}
+
 	if (decomp) {
 		strgp->decomp_path = strdup(decomp);
 		if (!strgp->decomp_path)
@@ -2750,13 +2769,15 @@ static int strgp_add_handler(ldmsd_req_ctxt_t reqc)
 	}
 	if (reqc->line_buf[0] == '\0' || reqc->line_buf[0] == '0')
 		__dlog(DLOG_CFGOK, "strgp_add name=%s plugin=%s container=%s"
-			"%s%s" "%s%s" "%s%s" "%s%s" "%s%s\n",
+			"%s%s" "%s%s" "%s%s" "%s%s" "%s%s" "%s%s" "%s%s\n",
 			name, plugin, container,
 			schema ? " schema=" : "", schema ? schema : "",
 			regex ? " regex=" : "", regex ? regex : "",
 			decomp ? " decomp=" : "", decomp ? decomp : "",
 			interval ? " flush=" : "", interval ? interval : "",
-			perm_s ? " perm=" : "", perm_s ? perm_s : ""
+			perm_s ? " perm=" : "", perm_s ? perm_s : "",
+			qdepth ? " queue_depth=" : "", qdepth ? qdepth : "",
+			qpolicy ? " queue_policy=" : "", qpolicy ? qpolicy : ""
 			);
 
 	goto send_reply;
@@ -2798,6 +2819,8 @@ send_reply:
 	free(perm_s);
 	free(interval);
 	free(decomp);
+	free(qdepth);
+	free(qpolicy);
 	return 0;
 }
 
@@ -3201,6 +3224,61 @@ send_reply:
 	return 0;
 }
 
+static int __hist_json(ldmsd_req_ctxt_t reqc, const char *name, uint64_t *hist)
+{
+	int i, rc;
+	rc = linebuf_printf(reqc, "\"%s\":[", name);
+	for (i = 0; !rc && i < LDMSD_STRGP_HIST_LEN; i++)
+		rc = linebuf_printf(reqc, "%s%" PRIu64, i ? "," : "", hist[i]);
+	if (!rc)
+		rc = linebuf_printf(reqc, "]");
+	return rc;
+}
+
+/*
+ * "queue": { "max_depth": 0 means stores are done by the update threads,
+ *            "backpressure": stores and commits that returned EAGAIN,
+ *            "wait_us_hist"/"store_us_hist": bucket i counts the stores
+ *            that waited/took [2^(i-1), 2^i) microseconds }
+ */
+static int __strgp_queue_json(ldmsd_req_ctxt_t reqc, ldmsd_strgp_t strgp)
+{
+	struct ldmsd_strgp_queue *q = &strgp->queue;
+	int rc;
+
+	pthread_mutex_lock(&q->lock);
+	rc = linebuf_printf(reqc,
+		       "\"queue\":{"
+		       "\"depth\":%d,"
+		       "\"max_depth\":%d,"
+		       "\"policy\":\"%s\","
+		       "\"enqueued\":%" PRIu64 ","
+		       "\"completed\":%" PRIu64 ","
+		       "\"dropped\":%" PRIu64 ","
+		       "\"coalesced\":%" PRIu64 ","
+		       "\"backpressure\":%" PRIu64 ",",
+		       q->depth, q->max_depth,
+		       ldmsd_strgp_queue_policy_str(q->policy),
+		       q->enqueued, q->completed, q->dropped,
+		       __atomic_load_n(&q->coalesced, __ATOMIC_SEQ_CST),
+		       __atomic_load_n(&q->backpressure, __ATOMIC_SEQ_CST));
+	if (rc)
+		goto out;
+	rc = __hist_json(reqc, "wait_us_hist", q->wait_hist);
+	if (rc)
+		goto out;
+	rc = linebuf_printf(reqc, ",");
+	if (rc)
+		goto out;
+	rc = __hist_json(reqc, "store_us_hist", q->store_hist);
+	if (rc)
+		goto out;
+	rc = linebuf_printf(reqc, "}");
+out:
+	pthread_mutex_unlock(&q->lock);
+	return rc;
+}
+
 int __strgp_status_json_obj(ldmsd_req_ctxt_t reqc, ldmsd_strgp_t strgp,
 							int strgp_cnt)
 {
@@ -3268,7 +3346,18 @@ int __strgp_status_json_obj(ldmsd_req_ctxt_t reqc, ldmsd_strgp_t strgp,
 		if (rc)
 			goto out;
 	}
-	rc = linebuf_printf(reqc, "]}");
+	rc = linebuf_printf(reqc, "],");
+	if (rc)
+		goto out;
+	rc = __strgp_queue_json(reqc, strgp);
+	if (rc)
+		goto out;
+	rc = linebuf_printf(reqc,
+		       ",\"row_arena\":{"
+		       "\"hwm\":%zu,"
+		       "\"allocs_avoided\":%" PRIu64 "}}",
+		       strgp->row_arena.hwm,
+		       strgp->row_arena.allocs_avoided);
 out:
 	ldmsd_strgp_unlock(strgp);
 	return rc;
@@ -3360,7 +3449,9 @@ static int updtr_add_handler(ldmsd_req_ctxt_t reqc)
 	gid_t gid;
 	int perm;
 	char *perm_s = NULL;
+	char *batch_s = NULL;
 	int push_flags, is_auto_task;
+	int batch_sz = 0;
 	long interval, offset;
 
 	reqc->errcode = 0;
@@ -3495,6 +3586,25 @@ static int updtr_add_handler(ldmsd_req_ctxt_t reqc)
 		}
 		is_auto_task = 0;
 	}
+	batch_s = ldmsd_req_attr_str_value_get_by_name(reqc, "batch");
+	if (batch_s) {
+		char *end;
+		batch_sz = strtol(batch_s, &end, 0);
+		if (('\0' == batch_s[0]) || ('\0' != *end) || (batch_sz < 0)) {
+			reqc->errcode = EINVAL;
+			cnt = Snprintf(&reqc->line_buf, &reqc->line_len,
+				       "The 'batch' attribute must be a "
+				       "non-negative integer, got '%s'", batch_s);
+			goto send_reply;
+		}
+		if (push) {
+			reqc->errcode = EINVAL;
+			cnt = Snprintf(&reqc->line_buf, &reqc->line_len,
+					"batch and push are "
+					"incompatible options");
+			goto send_reply;
+		}
+	}
 	ldmsd_updtr_t updtr = ldmsd_updtr_new_with_auth(name, interval_str,
 							offset_str ? offset_str : "0",
 							push_flags,
@@ -3515,13 +3625,25 @@ static int updtr_add_handler(ldmsd_req_ctxt_t reqc)
 				       "The updtr could not be created.");
 		}
 	} else {
+		if (batch_sz) {
+			reqc->errcode = ldmsd_updtr_batch_set(updtr, batch_sz);
+			if (reqc->errcode) {
+				(void)ldmsd_updtr_del(name, &sctxt);
+				cnt = Snprintf(&reqc->line_buf, &reqc->line_len,
+					"Failed to set the update batch size "
+					"of updtr %s, error %d", name,
+					reqc->errcode);
+				goto send_reply;
+			}
+		}
 		__dlog(DLOG_CFGOK, "updtr_add name=%s interval=%s offset=%s%s%s"
-			"%s%s%s%s\n", name, interval_str,
+			"%s%s%s%s%s%s\n", name, interval_str,
 			offset_str ? offset_str : "0",
 			auto_interval ? " auto_interval=" : "",
 			auto_interval ? auto_interval : "",
 			push ? " push=" : "", push ? push : "",
-			perm_s ? " perm" : "", perm_s ? perm_s : "");
+			perm_s ? " perm" : "", perm_s ? perm_s : "",
+			batch_s ? " batch=" : "", batch_s ? batch_s : "");
 	}
 
 send_reply:
@@ -3532,6 +3654,7 @@ send_reply:
 	free(offset_str);
 	free(push);
 	free(perm_s);
+	free(batch_s);
 	return 0;
 }
 
@@ -6414,6 +6537,7 @@ static int dump_cfg_handler(ldmsd_req_ctxt_t reqc)
 
 	/* Worker threads */
 	fprintf(fp, "worker_threads num=%d\n", ev_thread_count);
+	fprintf(fp, "store_threads num=%d\n", ldmsd_strgp_worker_count_get());
 
 	/* Default credits */
 	fprintf(fp, "default_credits credits=%d\n", ldmsd_quota);
@@ -6533,6 +6657,8 @@ static int dump_cfg_handler(ldmsd_req_ctxt_t reqc)
 		if (updtr_mode)
 			fprintf(fp, " %s", updtr_mode);
 		fprintf(fp, " interval=%ld", updtr->default_task.task.sched_us);
+		if (updtr->batch_sz)
+			fprintf(fp, " batch=%d", updtr->batch_sz);
 		if (updtr->default_task.task_flags & LDMSD_TASK_F_SYNCHRONOUS)
 		    fprintf(fp, " offset=%ld\n", updtr->default_task.task.offset_us);
 		else
@@ -6584,6 +6710,10 @@ static int dump_cfg_handler(ldmsd_req_ctxt_t reqc)
 			fprintf(fp, " schema=%s", strgp->schema);
 		if (strgp->decomp)
 			fprintf(fp, " decomposition=%s", strgp->decomp_path);
+		if (strgp->queue.max_depth)
+			fprintf(fp, " queue_depth=%d queue_policy=%s",
+				strgp->queue.max_depth,
+				ldmsd_strgp_queue_policy_str(strgp->queue.policy));
 		fprintf(fp, "\n");
 		LIST_FOREACH(match, &strgp->prdcr_list, entry) {
 			fprintf(fp, "strgp_prdcr_add name=%s regex=%s\n",
@@ -7805,6 +7935,7 @@ static char * __set_stats_as_json(size_t *json_sz, int is_summary)
 	char *buff, *s;
 	size_t sz = __APPEND_SZ;
 	struct mm_stat stats;
+	struct ldms_meta_share_stats shr;
 	int rc;
 	double freq;
 	double set_load = 0;
@@ -7826,6 +7957,7 @@ static char * __set_stats_as_json(size_t *json_sz, int is_summary)
 	}
 
 	mm_stats(&stats);
+	ldms_meta_share_stats_get(&shr);
 
 	ldmsd_cfg_lock(LDMSD_CFGOBJ_UPDTR);
 	for (updtr = ldmsd_updtr_first(); updtr;
@@ -7889,6 +8021,10 @@ do_json:
 	__APPEND(" \"mem_free_kb\": %g,\n", (double)(stats.bytes * stats.grain) / 1024.0);
 	__APPEND(" \"mem_used_kb\": %g,\n", (double)(stats.size - (stats.bytes * stats.grain)) / 1024.0);
 	__APPEND(" \"set_load\": %g,\n", set_load);
+	__APPEND(" \"meta_shared_sets\": %" PRIu64 ",\n", shr.sets);
+	__APPEND(" \"meta_shared_blocks\": %" PRIu64 ",\n", shr.blocks);
+	__APPEND(" \"meta_export_sets\": %" PRIu64 ",\n", shr.export_sets);
+	__APPEND(" \"meta_saved_kb\": %" PRId64 ",\n", shr.saved_bytes / 1024);
 done_json:
 	(void)clock_gettime(CLOCK_REALTIME, &end);
 	uint64_t compute_time = ldms_timespec_diff_us(&start, &end);
@@ -7914,8 +8050,9 @@ static int set_stats_handler(ldmsd_req_ctxt_t req)
 	__dlog(DLOG_QUERY, "set_stats\n");
 
 	value = ldmsd_req_attr_str_value_get_by_id(req, LDMSD_ATTR_SUMMARY);
-	if (0 == strcasecmp(value, "true"))
+	if (value && 0 == strcasecmp(value, "true"))
 		is_summary = 1;
+	free(value);
 
 	json_s = __set_stats_as_json(&json_sz, is_summary);
 	if (!json_s)
@@ -9209,6 +9346,33 @@ send_reply:
 	return rc;
 }
 
+static int store_threads_set_handler(ldmsd_req_ctxt_t reqc)
+{
+	int rc = 0;
+	char *value = NULL;
+
+	value = ldmsd_req_attr_str_value_get_by_id(reqc, LDMSD_ATTR_SIZE);
+	if (!value) {
+		reqc->errcode = EINVAL;
+		reqc->line_off = snprintf(reqc->line_buf, reqc->line_len,
+					  "The attribute 'num' is missing.");
+		goto send_reply;
+	}
+	reqc->errcode = ldmsd_strgp_worker_count_set(atoi(value));
+	if (reqc->errcode == EBUSY) {
+		reqc->line_off = snprintf(reqc->line_buf, reqc->line_len,
+					  "The number of store threads cannot be "
+					  "reduced after the threads are started.");
+	} else if (reqc->errcode) {
+		reqc->line_off = snprintf(reqc->line_buf, reqc->line_len,
+					  "Failed to process the 'store_threads' command");
+	}
+send_reply:
+	ldmsd_send_req_response(reqc, reqc->line_buf);
+	free(value);
+	return rc;
+}
+
 static int default_quota_set_handler(ldmsd_req_ctxt_t reqc)
 {
 	int rc = 0;
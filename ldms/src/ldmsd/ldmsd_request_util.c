@@ -140,6 +140,7 @@ struct req_str_id req_str_id_table[] = {
 	{  "setgroup_rm",        LDMSD_SETGROUP_RM_REQ  },
 	{  "start",              LDMSD_PLUGN_START_REQ  },
 	{  "stop",               LDMSD_PLUGN_STOP_REQ  },
+	{  "store_threads",      LDMSD_STORE_THR_SET_REQ  },
 	{  "stream_client_dump", LDMSD_STREAM_CLIENT_DUMP_REQ  },
 	{  "stream_status",         LDMSD_STREAM_STATUS_REQ  },
 	{  "strgp_add",          LDMSD_STRGP_ADD_REQ  },
@@ -186,6 +187,7 @@ struct req_str_id attr_str_id_table[] = {
 	{  "auto_interval",     LDMSD_ATTR_AUTO_INTERVAL  },
 	{  "auto_switch",       LDMSD_ATTR_AUTO_SWITCH  },
 	{  "base",              LDMSD_ATTR_BASE  },
+	{  "batch",             LDMSD_ATTR_SIZE  },
 	{  "cache_ip",          LDMSD_ATTR_IP  },
 	{  "container",         LDMSD_ATTR_CONTAINER  },
 	{  "decomposition",     LDMSD_ATTR_DECOMP  },
@@ -213,6 +215,8 @@ struct req_str_id attr_str_id_table[] = {
 	{  "port",              LDMSD_ATTR_PORT  },
 	{  "producer",          LDMSD_ATTR_PRODUCER  },
 	{  "push",              LDMSD_ATTR_PUSH  },
+	{  "queue_depth",       LDMSD_ATTR_SIZE  },
+	{  "queue_policy",      LDMSD_ATTR_TYPE  },
 	{  "quota",             LDMSD_ATTR_QUOTA  },
 	{  "rail",              LDMSD_ATTR_RAIL  },
 	{  "reconnect",         LDMSD_ATTR_INTERVAL  },
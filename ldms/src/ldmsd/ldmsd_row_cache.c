@@ -15,26 +15,30 @@
  *
  *   "group" : { ..., "index" : [ "component_id", "name" ], ... }
  *
- * Each group is itself a tree of rows. This tree is ordered by the "order"
- * key in the "group" dictionary. This tree is maintained with a maximum
- * number of entries that is limited by the "limit" keyword. In this
- * example the json is:
+ * Each group is itself a ring of rows. The ring is ordered by the "order"
+ * key in the "group" dictionary. The ring holds at most the number of rows
+ * specified by the "limit" keyword. In this example the json is:
  *
  *   "group" : { ..., "limit" : 2, "order" : [ "timestamp" ] ... }
  *
- * When the limit is reached, the row with the min key in the tree is
- * removed and the new row added.
+ * When the limit is exceeded, the new row having been added, the row with
+ * the min key in the ring is removed.
  *
  * Putting all together, the json is as follows:
  *
  *   "group" : { "index" : [ "component_id", "name" ],
  *               "order" : [ "timstamp" ], "limit" : 2 }
+ *
+ * The groups are kept in a hash table. The cache is not locked; it is
+ * only used by the decomposition of its strgp, under the strgp lock. Rows
+ * usually arrive in order, so a new row normally goes to the head of the
+ * ring without moving the other rows.
  */
 
 /*
  * The same comparator can be used for both groups and rows
 */
-static int tree_comparator(void *a, const void *b)
+static int idx_cmp(const void *a, const void *b)
 {
 	int i;
 	ldmsd_row_cache_idx_t key_a = (ldmsd_row_cache_idx_t)a;
@@ -137,11 +141,52 @@ static int tree_comparator(void *a, const void *b)
 	return 0;
 }
 
+#define ROW_CACHE_MIN_SLOTS 64
+
+/* FNV-1a over the key values; must agree with idx_cmp() */
+static uint64_t idx_hash(ldmsd_row_cache_idx_t idx)
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+	ldmsd_row_cache_key_t k;
+	const unsigned char *p;
+	size_t i, len;
+	int j;
+
+	for (j = 0; j < idx->key_count; j++) {
+		k = idx->keys[j];
+		p = (const unsigned char *)k->mval;
+		len = k->mval_size;
+		switch (k->type) {
+		case LDMS_V_CHAR_ARRAY:
+			len = strnlen(k->mval->a_char, k->count);
+			break;
+		case LDMS_V_F32:
+			if (k->mval->v_f == 0)
+				len = 0; /* -0.0 == 0.0 */
+			break;
+		case LDMS_V_D64:
+			if (k->mval->v_d == 0)
+				len = 0;
+			break;
+		default:
+			break;
+		}
+		for (i = 0; i < len; i++) {
+			h ^= p[i];
+			h *= 0x100000001b3ULL;
+		}
+		h ^= 0xff; /* key separator */
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
+
 /**
- * @brief Cache a row to a group
+ * @brief Create a row cache
  *
  * @param strgp - The owning storage policy
  * @param row_limit - The limit of rows to cache in each group
+ * @param timeout - Groups not updated for this long are dropped, or NULL
  * @return ldmsd_row_cache_t
  */
 ldmsd_row_cache_t ldmsd_row_cache_create(ldmsd_strgp_t strgp, int row_limit,
@@ -152,17 +197,20 @@ ldmsd_row_cache_t ldmsd_row_cache_create(ldmsd_strgp_t strgp, int row_limit,
 		return NULL;
 
 	rcache->strgp = strgp;
-	rcache->row_limit = row_limit;
-	rbt_init(&rcache->group_tree, tree_comparator);
-	pthread_mutex_init(&rcache->lock, NULL);
+	rcache->row_limit = (row_limit > 0)?row_limit:1;
+	if (timeout)
+		rcache->cfg_timeout = *timeout;
+
 	LIST_INIT(&rcache->group_bucket[0]);
 	LIST_INIT(&rcache->group_bucket[1]);
 	LIST_INIT(&rcache->group_bucket[2]);
 	rcache->gb_idx = 0;
-
-	if (timeout)
-		rcache->cfg_timeout = *timeout;
-
+	rcache->slot_count = ROW_CACHE_MIN_SLOTS;
+	rcache->slots = calloc(rcache->slot_count, sizeof(rcache->slots[0]));
+	if (!rcache->slots) {
+		free(rcache);
+		return NULL;
+	}
 	return rcache;
 }
 
@@ -254,35 +302,255 @@ void ldmsd_row_cache_idx_free(ldmsd_row_cache_idx_t idx)
 	free(idx);
 }
 
-/* NOTE: rcache->lock is held */
+static ldmsd_row_group_t row_group_new(ldmsd_row_cache_t rcache, uint64_t hash,
+				       ldmsd_row_cache_idx_t group_key,
+				       ldmsd_row_t row)
+{
+	ldmsd_row_group_t g;
+	ldmsd_col_t col;
+	size_t off;
+	int c, cap = 1;
+
+	/* room for the new row before the oldest one is dropped */
+	while (cap <= rcache->row_limit)
+		cap <<= 1;
+	g = calloc(1, sizeof(*g));
+	if (!g)
+		return NULL;
+	g->hash = hash;
+	g->cap = cap;
+	g->head = cap - 1;
+	g->col_count = row->col_count;
+	g->rows = calloc(cap, sizeof(g->rows[0]));
+	g->row_keys = calloc(cap, sizeof(g->row_keys[0]));
+	g->cols = calloc(g->col_count, sizeof(g->cols[0]));
+	g->key = ldmsd_row_cache_idx_dup(group_key);
+	if (!g->rows || !g->row_keys || !g->cols || !g->key)
+		goto err;
+	/* the value layout of the group is taken from its first row */
+	off = 0;
+	for (c = 0; c < g->col_count; c++) {
+		col = &row->cols[c];
+		g->cols[c].off = off;
+		switch (col->type) {
+		case LDMS_V_CHAR:
+		case LDMS_V_U8: case LDMS_V_S8:
+		case LDMS_V_U16: case LDMS_V_S16:
+		case LDMS_V_U32: case LDMS_V_S32:
+		case LDMS_V_U64: case LDMS_V_S64:
+		case LDMS_V_F32: case LDMS_V_D64:
+		case LDMS_V_TIMESTAMP:
+		case LDMS_V_U8_ARRAY: case LDMS_V_S8_ARRAY:
+		case LDMS_V_U16_ARRAY: case LDMS_V_S16_ARRAY:
+		case LDMS_V_U32_ARRAY: case LDMS_V_S32_ARRAY:
+		case LDMS_V_U64_ARRAY: case LDMS_V_S64_ARRAY:
+		case LDMS_V_F32_ARRAY: case LDMS_V_D64_ARRAY:
+			g->cols[c].size = LDMS_ROUNDUP(ldms_metric_value_size_get(
+						col->type, col->array_len),
+						sizeof(uint64_t));
+			break;
+		default:
+			g->cols[c].size = 0;
+			break;
+		}
+		off += cap * g->cols[c].size;
+	}
+	g->vals = calloc(1, off ? off : 1);
+	if (!g->vals)
+		goto err;
+	return g;
+ err:
+	if (g->key)
+		ldmsd_row_cache_idx_free(g->key);
+	free(g->rows);
+	free(g->row_keys);
+	free(g->cols);
+	free(g);
+	return NULL;
+}
+
+static void row_group_free(ldmsd_row_group_t g)
+{
+	int i, slot;
+	for (i = 0; i < g->count; i++) {
+		slot = ldmsd_row_group_slot(g, i);
+		ldmsd_row_cache_idx_free(g->row_keys[slot]);
+		free(g->rows[slot]);
+	}
+	ldmsd_row_cache_idx_free(g->key);
+	free(g->rows);
+	free(g->row_keys);
+	free(g->cols);
+	free(g->vals);
+	free(g);
+}
+
+static ldmsd_row_group_t group_find(ldmsd_row_cache_t rcache, uint64_t hash,
+				    ldmsd_row_cache_idx_t group_key)
+{
+	size_t mask = rcache->slot_count - 1;
+	size_t i = hash & mask;
+	ldmsd_row_group_t g;
+
+	while ((g = rcache->slots[i])) {
+		if (g->hash == hash && 0 == idx_cmp(g->key, group_key))
+			return g;
+		i = (i + 1) & mask;
+	}
+	return NULL;
+}
+
+static void __group_put(ldmsd_row_group_t *slots, size_t slot_count,
+			ldmsd_row_group_t g)
+{
+	size_t mask = slot_count - 1;
+	size_t i = g->hash & mask;
+	while (slots[i])
+		i = (i + 1) & mask;
+	slots[i] = g;
+}
+
+static int group_insert(ldmsd_row_cache_t rcache, ldmsd_row_group_t g)
+{
+	ldmsd_row_group_t *slots;
+	size_t i, count;
+
+	if ((rcache->group_count + 1) * 4 > rcache->slot_count * 3) {
+		count = rcache->slot_count * 2;
+		slots = calloc(count, sizeof(*slots));
+		if (!slots)
+			return ENOMEM;
+		for (i = 0; i < rcache->slot_count; i++) {
+			if (rcache->slots[i])
+				__group_put(slots, count, rcache->slots[i]);
+		}
+		free(rcache->slots);
+		rcache->slots = slots;
+		rcache->slot_count = count;
+	}
+	__group_put(rcache->slots, rcache->slot_count, g);
+	rcache->group_count++;
+	return 0;
+}
+
+static void group_remove(ldmsd_row_cache_t rcache, ldmsd_row_group_t g)
+{
+	size_t mask = rcache->slot_count - 1;
+	size_t i = g->hash & mask;
+	size_t j, home;
+
+	while (rcache->slots[i] != g)
+		i = (i + 1) & mask;
+	/* backward shift deletion, no tombstones */
+	j = i;
+	while (1) {
+		j = (j + 1) & mask;
+		if (!rcache->slots[j])
+			break;
+		home = rcache->slots[j]->hash & mask;
+		/* move slots[j] to i unless its home is cyclically in (i, j] */
+		if (i <= j ? (i < home && home <= j) : (i < home || home <= j))
+			continue;
+		rcache->slots[i] = rcache->slots[j];
+		i = j;
+	}
+	rcache->slots[i] = NULL;
+	rcache->group_count--;
+}
+
 void ldmsd_row_group_bucket_cleanup(ldmsd_row_cache_t rcache, int ci)
 {
 	ldmsd_row_group_t g;
-	struct ldmsd_row_cache_entry_s *cent;
-	struct rbn *rbn;
 	while((g = LIST_FIRST(&rcache->group_bucket[ci]))) {
 		LIST_REMOVE(g, bucket_entry);
-		rbt_del(&rcache->group_tree, &g->rbn);
-		while ((rbn = rbt_min(&g->row_tree))) {
-			rbt_del(&g->row_tree, rbn);
-			cent = container_of(rbn, struct ldmsd_row_cache_entry_s, rbn);
-			ldmsd_row_cache_idx_free(cent->idx);
-			free(cent->row);
-			free(cent);
+		group_remove(rcache, g);
+		row_group_free(g);
+	}
+}
+
+static void row_group_slot_swap(ldmsd_row_group_t g, int a, int b)
+{
+	ldmsd_row_t row;
+	ldmsd_row_cache_idx_t key;
+	uint8_t *va, *vb, v;
+	size_t i;
+	int c;
+
+	row = g->rows[a];
+	g->rows[a] = g->rows[b];
+	g->rows[b] = row;
+	key = g->row_keys[a];
+	g->row_keys[a] = g->row_keys[b];
+	g->row_keys[b] = key;
+	for (c = 0; c < g->col_count; c++) {
+		va = &g->vals[g->cols[c].off + a * g->cols[c].size];
+		vb = &g->vals[g->cols[c].off + b * g->cols[c].size];
+		for (i = 0; i < g->cols[c].size; i++) {
+			v = va[i];
+			va[i] = vb[i];
+			vb[i] = v;
 		}
-		ldmsd_row_cache_idx_free(g->rbn.key); /* group_key */
-		free(g);
 	}
 }
 
+/*
+ * Put the row into the ring keeping the ring ordered by the row keys, then
+ * drop the row with the smallest key if the group is over the limit.
+ */
+static void row_group_add(ldmsd_row_cache_t rcache, ldmsd_row_group_t g,
+			  ldmsd_row_cache_idx_t row_key, ldmsd_row_t row)
+{
+	int i, c, slot, next;
+	ldmsd_col_t col;
+	uint8_t *v;
+	size_t sz;
+
+	g->head = (g->head + 1) & (g->cap - 1);
+	g->count++;
+	g->rows[g->head] = row;
+	g->row_keys[g->head] = row_key;
+	for (c = 0; c < g->col_count && c < row->col_count; c++) {
+		if (!g->cols[c].size)
+			continue;
+		col = &row->cols[c];
+		v = &g->vals[g->cols[c].off + g->head * g->cols[c].size];
+		sz = ldms_metric_value_size_get(col->type, col->array_len);
+		if (sz > g->cols[c].size)
+			sz = g->cols[c].size;
+		memcpy(v, col->mval, sz);
+		memset(v + sz, 0, g->cols[c].size - sz);
+	}
+	/* the rare out-of-order row */
+	for (i = 0; i + 1 < g->count; i++) {
+		slot = ldmsd_row_group_slot(g, i);
+		next = ldmsd_row_group_slot(g, i + 1);
+		if (idx_cmp(g->row_keys[slot], g->row_keys[next]) >= 0)
+			break;
+		row_group_slot_swap(g, slot, next);
+	}
+	if (g->count <= rcache->row_limit)
+		return;
+	/* drop the row with the min key */
+	slot = ldmsd_row_group_slot(g, g->count - 1);
+	if (g->rows[slot] == row) {
+		/* the caller still uses it */
+		rcache->dropped_row = row;
+		rcache->dropped_key = row_key;
+	} else {
+		ldmsd_row_cache_idx_free(g->row_keys[slot]);
+		free(g->rows[slot]);
+	}
+	g->count--;
+}
+
 int ldmsd_row_cache(ldmsd_row_cache_t rcache,
 		ldmsd_row_cache_idx_t group_key,
 		ldmsd_row_cache_idx_t row_key,
-		ldmsd_row_t row)
+		ldmsd_row_t row, ldmsd_row_group_t *pgroup)
 {
 	ldmsd_row_group_t group;
-	struct rbn *group_rbn;
 	struct timespec ts;
+	uint64_t hash;
 	int rc = 0;
 	int ci;
 	int count;
@@ -292,18 +560,16 @@ int ldmsd_row_cache(ldmsd_row_cache_t rcache,
                 return EINVAL;
         }
 
-	/* Insert the row_list into the tree using rcache->row_key */
-	ldmsd_row_cache_entry_t entry = calloc(1, sizeof(*entry));
-	if (!entry)
-		return ENOMEM;
-
-	pthread_mutex_lock(&rcache->lock);
+	if (rcache->dropped_row) {
+		ldmsd_row_cache_idx_free(rcache->dropped_key);
+		free(rcache->dropped_row);
+		rcache->dropped_row = NULL;
+		rcache->dropped_key = NULL;
+	}
 
 	rc = clock_gettime(CLOCK_REALTIME, &ts);
-	if (rc) {
-		rc = errno;
-		goto out;
-	}
+	if (rc)
+		return errno;
 
 	if (rcache->cfg_timeout.tv_sec == 0 && rcache->cfg_timeout.tv_nsec == 0)
 		goto skip_cleanup;
@@ -365,37 +631,23 @@ int ldmsd_row_cache(ldmsd_row_cache_t rcache,
 
  skip_cleanup:
 	/* Look up the group */
-	group_rbn = rbt_find(&rcache->group_tree, group_key);
-	if (!group_rbn) {
-		/* Create a new group and add it to the tree */
-		group = calloc(1, sizeof(*group));
-		group->row_key_count = row_key->key_count;
-		rbt_init(&group->row_tree, tree_comparator);
-		group_key = ldmsd_row_cache_idx_dup(group_key);
-		rbn_init(&group->rbn, group_key);
-		rbt_ins(&rcache->group_tree, &group->rbn);
-		group_rbn = &group->rbn;
+	hash = idx_hash(group_key);
+	group = group_find(rcache, hash, group_key);
+	if (!group) {
+		/* Create a new group and add it to the table */
+		group = row_group_new(rcache, hash, group_key, row);
+		if (!group)
+			return ENOMEM;
+		rc = group_insert(rcache, group);
+		if (rc) {
+			row_group_free(group);
+			return rc;
+		}
 		LIST_INSERT_HEAD(&rcache->group_bucket[rcache->gb_idx],
 				 group, bucket_entry);
 	}
 
-	group = container_of(group_rbn, struct ldmsd_row_group_s, rbn);
-
-	if (rbt_card(&group->row_tree) == rcache->row_limit) {
-		ldmsd_row_cache_entry_t cent;
-		struct rbn *rbn;
-		rbn = rbt_min(&group->row_tree);
-		cent = container_of(rbn, struct ldmsd_row_cache_entry_s, rbn);
-		rbt_del(&group->row_tree, rbn);
-		ldmsd_row_cache_idx_free(cent->idx);
-		free(cent->row);
-		free(cent);
-	}
-
-	rbn_init(&entry->rbn, row_key);
-	entry->row = row;
-	entry->idx = row_key;
-	rbt_ins(&group->row_tree, &entry->rbn);
+	row_group_add(rcache, group, row_key, row);
 
 	/* informational */
 	group->last_update = ts;
@@ -403,55 +655,6 @@ int ldmsd_row_cache(ldmsd_row_cache_t rcache,
 	/* move group to CURRENT bucket */
 	LIST_REMOVE(group, bucket_entry);
 	LIST_INSERT_HEAD(&rcache->group_bucket[rcache->gb_idx], group, bucket_entry);
-
- out:
-	pthread_mutex_unlock(&rcache->lock);
-
-	return rc;
-}
-
-/**
- * @brief Return a list containing the most recent \c count rows from the cache
- *
- * Adds the newest rows from the row cache into the list. The rows are not
- * removed from the cache
- *
- * @param row_list - The row list into which rows will be inserted
- * @param row_count - The number of rows to insert into the row list
- * @param cache - The row cache handle
- * @param group_key - The group from which the rows will be taken
- * @returns The number of rows inserted
- */
-int ldmsd_row_cache_make_list(ldmsd_row_list_t row_list, int row_count,
-				ldmsd_row_cache_t cache,
-				ldmsd_row_cache_idx_t group_key
-				)
-{
-	int count = 0;
-	struct rbn *rbn;
-	ldmsd_row_group_t group;
-	ldmsd_row_cache_entry_t entry;
-	TAILQ_INIT(row_list);
-
-	pthread_mutex_lock(&cache->lock);
-
-	rbn = rbt_find(&cache->group_tree, group_key);
-	if (!rbn)
-		goto out;
-	group = container_of(rbn, struct ldmsd_row_group_s, rbn);
-	rbn = rbt_max(&group->row_tree);
-	if (!rbn)
-		goto out;
-	entry = container_of(rbn, struct ldmsd_row_cache_entry_s, rbn);
-	while (count < row_count) {
-		TAILQ_INSERT_TAIL(row_list, entry->row, entry);
-		count += 1;
-		rbn = rbn_pred(rbn);
-		if (!rbn)
-			break;
-		entry = container_of(rbn, struct ldmsd_row_cache_entry_s, rbn);
-	}
-out:
-	pthread_mutex_unlock(&cache->lock);
-	return count;
+	*pgroup = group;
+	return 0;
 }
@@ -0,0 +1,174 @@
+/* -*- c-basic-offset: 8 -*-
+ * Copyright (c) 2026 National Technology & Engineering Solutions
+ * of Sandia, LLC (NTESS). Under the terms of Contract DE-NA0003525 with
+ * NTESS, the U.S. Government retains certain rights in this software.
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Benchmark of the row cache with the 'diff' functional operator.
+ *
+ * Each round caches one row for each of the groups (component_id) and
+ * computes the difference of the value column between the two newest rows
+ * of the group, the way decomp_static does with "limit": 2 and
+ * "order": [ "timestamp" ].
+ *
+ *   ldmsd_row_cache_bench [GROUPS [ROUNDS]]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ldmsd.h"
+
+/* from ldmsd_strgp.c */
+int ldmsd_timespec_cmp(struct timespec *a, struct timespec *b)
+{
+	if (a->tv_sec < b->tv_sec)
+		return -1;
+	if (a->tv_sec > b->tv_sec)
+		return 1;
+	if (a->tv_nsec < b->tv_nsec)
+		return -1;
+	if (a->tv_nsec > b->tv_nsec)
+		return 1;
+	return 0;
+}
+
+void ldmsd_timespec_add(struct timespec *a, struct timespec *b, struct timespec *result)
+{
+	result->tv_sec = a->tv_sec + b->tv_sec;
+	result->tv_nsec = a->tv_nsec + b->tv_nsec;
+	if (result->tv_nsec >= 1000000000) {
+		result->tv_sec += 1;
+		result->tv_nsec -= 1000000000;
+	}
+}
+
+#define COL_COMP_ID	0
+#define COL_TS		1
+#define COL_VALUE	2
+#define COL_COUNT	3
+
+static ldmsd_row_t row_new(uint64_t comp_id, uint32_t sec, uint64_t value)
+{
+	ldmsd_row_t row;
+	union ldms_value *mvals;
+
+	row = calloc(1, sizeof(*row) + COL_COUNT * sizeof(row->cols[0]) +
+			COL_COUNT * sizeof(*mvals));
+	if (!row)
+		return NULL;
+	mvals = (void*)&row->cols[COL_COUNT];
+	row->col_count = COL_COUNT;
+	row->cols[COL_COMP_ID].type = LDMS_V_U64;
+	row->cols[COL_COMP_ID].mval = &mvals[COL_COMP_ID];
+	row->cols[COL_COMP_ID].mval->v_u64 = comp_id;
+	row->cols[COL_TS].type = LDMS_V_TIMESTAMP;
+	row->cols[COL_TS].mval = &mvals[COL_TS];
+	row->cols[COL_TS].mval->v_ts.sec = sec;
+	row->cols[COL_VALUE].type = LDMS_V_U64;
+	row->cols[COL_VALUE].mval = &mvals[COL_VALUE];
+	row->cols[COL_VALUE].mval->v_u64 = value;
+	return row;
+}
+
+static ldmsd_row_cache_idx_t idx_new(ldmsd_row_t row, int col)
+{
+	ldmsd_row_cache_key_t *keys = calloc(1, sizeof(*keys));
+	keys[0] = ldmsd_row_cache_key_create(row->cols[col].type, 1);
+	memcpy(keys[0]->mval, row->cols[col].mval, keys[0]->mval_size);
+	return ldmsd_row_cache_idx_create(1, keys);
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv)
+{
+	int groups = (argc > 1)?atoi(argv[1]):100000;
+	int rounds = (argc > 2)?atoi(argv[2]):20;
+	ldmsd_row_cache_t rcache;
+	ldmsd_row_cache_idx_t group_idx, row_idx;
+	ldmsd_row_group_t group;
+	ldmsd_row_t row;
+	uint64_t sum = 0;
+	double t0, t1;
+	int g, r, rc;
+
+	rcache = ldmsd_row_cache_create(NULL, 2, NULL);
+	if (!rcache) {
+		printf("ldmsd_row_cache_create() failed\n");
+		return 1;
+	}
+	t0 = now();
+	for (r = 0; r < rounds; r++) {
+		for (g = 0; g < groups; g++) {
+			row = row_new(g, r, (uint64_t)r * g);
+			group_idx = idx_new(row, COL_COMP_ID);
+			row_idx = idx_new(row, COL_TS);
+			rc = ldmsd_row_cache(rcache, group_idx, row_idx, row, &group);
+			ldmsd_row_cache_idx_free(group_idx);
+			if (rc) {
+				printf("ldmsd_row_cache() error: %d\n", rc);
+				return 1;
+			}
+			if (group->count < 2)
+				continue;
+			/* diff */
+			sum += ldmsd_row_group_val(group, COL_VALUE, 0)->v_u64 -
+			       ldmsd_row_group_val(group, COL_VALUE, 1)->v_u64;
+		}
+	}
+	t1 = now();
+	printf("groups: %d, rounds: %d, %.1f ns/row (cache + diff), checksum %lu\n",
+	       groups, rounds, (t1 - t0) * 1e9 / ((double)groups * rounds),
+	       (unsigned long)sum);
+	return 0;
+}
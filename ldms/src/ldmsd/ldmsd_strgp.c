@@ -54,6 +54,7 @@
 #include <errno.h>
 #include <assert.h>
 #include <time.h>
+#include <unistd.h>
 #include <ctype.h>
 #include <coll/rbt.h>
 #include <ovis_util/util.h>
@@ -64,6 +65,13 @@
 /* Defined in ldmsd.c */
 extern ovis_log_t store_log;
 
+/*
+ * How long a commit is retried while the store returns EAGAIN, the wait
+ * starts at STRGP_BACKPRESSURE_WAIT_US and doubles.
+ */
+#define STRGP_BACKPRESSURE_WAIT_US	1000
+#define STRGP_BACKPRESSURE_MAX_US	1000000
+
 void ldmsd_strgp___del(ldmsd_cfgobj_t obj)
 {
 	ldmsd_strgp_t strgp = (ldmsd_strgp_t)obj;
@@ -96,6 +104,8 @@ void ldmsd_strgp___del(ldmsd_cfgobj_t obj)
 	if (strgp->decomp_path)
 		free(strgp->decomp_path);
 	free(strgp->digest);
+	pthread_mutex_destroy(&strgp->queue.lock);
+	pthread_cond_destroy(&strgp->queue.cond);
 	ldmsd_cfgobj___del(obj);
 }
 
@@ -180,29 +190,63 @@ static void strgp_decompose(ldmsd_strgp_t strgp, ldmsd_prdcr_set_t prd_set, void
 {
 	struct ldmsd_row_list_s row_list = TAILQ_HEAD_INITIALIZER(row_list);
 	int row_count, rc;
+	size_t used;
+	uint64_t avoided0, avoided1;
+	useconds_t wait_us, waited_us;
+
+	/* No rows of this thread are outstanding, start a new arena cycle */
+	ldmsd_row_arena_reserve(0);
+	ldmsd_row_arena_usage(&used, &avoided0);
 	rc = strgp->decomp->decompose(strgp, prd_set->set, &row_list, &row_count, ctxt);
+	ldmsd_row_arena_usage(&used, &avoided1);
+	if (used > strgp->row_arena.hwm)
+		strgp->row_arena.hwm = used;
+	strgp->row_arena.allocs_avoided += avoided1 - avoided0;
 	if (rc) {
 		ovis_log(store_log, OVIS_LERROR,
 			 "decompose error: %d for set '%s'\n", rc, prd_set->inst_name);
 		return;
 	}
-        if (strgp->store->api->commit != NULL) {
-                rc = strgp->store->api->commit(strgp->store,
-					       strgp, prd_set->set, &row_list, row_count);
-        } else {
+        if (strgp->store->api->commit == NULL) {
                 ovis_log(store_log, OVIS_LERROR,
                          "store plugin \"%s\" does not support decomposition commit()\n",
                          ldmsd_plug_name_get(strgp->store));
+		goto out;
         }
-	if (rc) {
+	wait_us = STRGP_BACKPRESSURE_WAIT_US;
+	waited_us = 0;
+	while (EAGAIN == (rc = strgp->store->api->commit(strgp->store, strgp,
+					prd_set->set, &row_list, row_count))) {
+		/*
+		 * The store is not keeping up with the rows (e.g. its producer
+		 * queue is full) and did not take any of them. Hold the rows,
+		 * and so the updates queued behind them, until it catches up.
+		 */
+		if (!waited_us)
+			__atomic_fetch_add(&strgp->queue.backpressure, 1, __ATOMIC_SEQ_CST);
+		if (waited_us >= STRGP_BACKPRESSURE_MAX_US)
+			break;
+		usleep(wait_us);
+		waited_us += wait_us;
+		if (wait_us < STRGP_BACKPRESSURE_MAX_US / 16)
+			wait_us <<= 1;
+	}
+	if (rc == EAGAIN) {
+		ovis_log(store_log, OVIS_LWARN, "strgp '%s': store backpressure, "
+			 "rows of set '%s' were not stored\n",
+			 strgp->obj.name, prd_set->inst_name);
+	} else if (rc) {
 		ovis_log(store_log, OVIS_LERROR, "strgp row commit error: %d\n", rc);
 	}
+ out:
 	strgp->decomp->release_rows(strgp, &row_list);
 }
 
 /* protected by strgp lock */
 static void strgp_update_fn(ldmsd_strgp_t strgp, ldmsd_prdcr_set_t prd_set, void **ctxt)
 {
+	int rc;
+
 	if (strgp->state != LDMSD_STRGP_STATE_RUNNING)
 		return;
 
@@ -220,8 +264,12 @@ static void strgp_update_fn(ldmsd_strgp_t strgp, ldmsd_prdcr_set_t prd_set, void
 		return;
 	}
         if (strgp->store->api->store != NULL) {
-                strgp->store->api->store(strgp->store, strgp->store_handle, prd_set->set,
+                rc = strgp->store->api->store(strgp->store, strgp->store_handle, prd_set->set,
                                          strgp->metric_arry, strgp->metric_count);
+		if (rc == EAGAIN) {
+			/* The store is not keeping up, see strgp_decompose() */
+			__atomic_fetch_add(&strgp->queue.backpressure, 1, __ATOMIC_SEQ_CST);
+		}
         } else {
                 ovis_log(store_log, OVIS_LERROR,
                          "store plugin \"%s\" does not support non-decomposition store()\n",
@@ -257,6 +305,10 @@ ldmsd_strgp_new_with_auth(const char *name, uid_t uid, gid_t gid, int perm)
 	strgp->last_flush.tv_sec = 0;
 	strgp->last_flush.tv_nsec = 0;
 	strgp->update_fn = strgp_update_fn;
+	pthread_mutex_init(&strgp->queue.lock, NULL);
+	pthread_cond_init(&strgp->queue.cond, NULL);
+	TAILQ_INIT(&strgp->queue.work_list);
+	strgp->queue.policy = LDMSD_STRGP_QUEUE_BLOCK;
 	LIST_INIT(&strgp->prdcr_list);
 	TAILQ_INIT(&strgp->metric_list);
 	ldmsd_task_init(&strgp->task);
@@ -843,3 +895,290 @@ next:
 		strgp = ldmsd_strgp_next(strgp);
 	}
 }
+
+/*
+ * Store work queues
+ *
+ * A strgp with a non-zero queue depth does not store on the thread that
+ * delivered the update. updtr_update_cb() creates a work for it while
+ * holding the producer set lock and submits the work after releasing the
+ * lock. The strgp is put on the worker run queue when it has works. A worker
+ * takes one work of a strgp at a time and puts the strgp back at the tail
+ * of the run queue if it has more, so the stores of a strgp are serialized
+ * and a slow strgp does not starve the others.
+ *
+ * The producer set stays in the UPDATING state until its store works are
+ * done so that the next update does not overwrite the set data while it is
+ * being stored.
+ *
+ * Lock order: prd_set->lock, strgp lock, strgp->queue.lock, strgp_worker_lock
+ */
+static pthread_mutex_t strgp_worker_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t strgp_worker_cond = PTHREAD_COND_INITIALIZER;
+static TAILQ_HEAD(, ldmsd_strgp) strgp_run_q = TAILQ_HEAD_INITIALIZER(strgp_run_q);
+static int strgp_worker_count = 1;	/* configured */
+static int strgp_worker_started;	/* running threads */
+
+const char *ldmsd_strgp_queue_policy_str(enum ldmsd_strgp_queue_policy policy)
+{
+	switch (policy) {
+	case LDMSD_STRGP_QUEUE_BLOCK:
+		return "block";
+	case LDMSD_STRGP_QUEUE_DROP:
+		return "drop";
+	}
+	return "unknown";
+}
+
+int ldmsd_strgp_queue_config(ldmsd_strgp_t strgp, int depth, const char *policy)
+{
+	enum ldmsd_strgp_queue_policy p = strgp->queue.policy;
+
+	if (depth < 0)
+		return EINVAL;
+	if (policy) {
+		if (0 == strcasecmp(policy, "block"))
+			p = LDMSD_STRGP_QUEUE_BLOCK;
+		else if (0 == strcasecmp(policy, "drop"))
+			p = LDMSD_STRGP_QUEUE_DROP;
+		else
+			return EINVAL;
+	}
+	if (strgp->state != LDMSD_STRGP_STATE_STOPPED)
+		return EBUSY;
+	pthread_mutex_lock(&strgp->queue.lock);
+	strgp->queue.max_depth = depth;
+	strgp->queue.policy = p;
+	pthread_mutex_unlock(&strgp->queue.lock);
+	return 0;
+}
+
+static inline int __hist_idx(struct timespec *start, struct timespec *end)
+{
+	int64_t us = (end->tv_sec - start->tv_sec) * 1000000 +
+		     (end->tv_nsec - start->tv_nsec) / 1000;
+	int i;
+	if (us <= 0)
+		return 0;
+	i = 64 - __builtin_clzll(us);
+	return (i < LDMSD_STRGP_HIST_LEN)?i:(LDMSD_STRGP_HIST_LEN - 1);
+}
+
+ldmsd_strgp_work_t ldmsd_strgp_work_new(ldmsd_prdcr_set_t prd_set, ldmsd_strgp_ref_t ref)
+{
+	ldmsd_strgp_t strgp = ref->strgp;
+	ldmsd_strgp_work_t work;
+
+	if (ref->store_pending) {
+		/* The pending work will store the latest set data. */
+		__atomic_fetch_add(&strgp->queue.coalesced, 1, __ATOMIC_SEQ_CST);
+		return NULL;
+	}
+	work = calloc(1, sizeof(*work));
+	if (!work) {
+		ovis_log(store_log, OVIS_LCRITICAL, "strgp '%s': out of memory, "
+			 "set '%s' is not stored.\n", strgp->obj.name,
+			 prd_set->inst_name);
+		return NULL;
+	}
+	work->strgp = ldmsd_strgp_get(strgp, "strgp_work");
+	ldmsd_prdcr_set_ref_get(prd_set);
+	work->prd_set = prd_set;
+	ref->store_pending = 1;
+	prd_set->store_pending++;
+	return work;
+}
+
+/*
+ * Finish the work on the producer set side and free it. The caller puts the
+ * "strgp_work" reference of the strgp when it is done with the strgp.
+ */
+static void strgp_work_done(ldmsd_strgp_work_t work)
+{
+	ldmsd_prdcr_set_t prd_set = work->prd_set;
+
+	pthread_mutex_lock(&prd_set->lock);
+	if (0 == --prd_set->store_pending && prd_set->store_set_ready) {
+		prd_set->store_set_ready = 0;
+		if (prd_set->state == LDMSD_PRDCR_SET_STATE_UPDATING)
+			prd_set->state = LDMSD_PRDCR_SET_STATE_READY;
+	}
+	pthread_mutex_unlock(&prd_set->lock);
+	ldmsd_prdcr_set_ref_put(prd_set);
+	free(work);
+}
+
+/* The work will not be executed; the next update needs a new one */
+static void strgp_work_drop(ldmsd_strgp_work_t work)
+{
+	ldmsd_prdcr_set_t prd_set = work->prd_set;
+	ldmsd_strgp_ref_t ref;
+
+	pthread_mutex_lock(&prd_set->lock);
+	ref = strgp_ref_find(prd_set, work->strgp);
+	if (ref)
+		ref->store_pending = 0;
+	pthread_mutex_unlock(&prd_set->lock);
+	strgp_work_done(work);
+}
+
+static void strgp_work_exec(ldmsd_strgp_work_t work)
+{
+	ldmsd_prdcr_set_t prd_set = work->prd_set;
+	ldmsd_strgp_t strgp = work->strgp;
+	ldmsd_strgp_ref_t ref;
+	struct timespec start, end;
+
+	clock_gettime(CLOCK_REALTIME, &start);
+	pthread_mutex_lock(&prd_set->lock);
+	ref = strgp_ref_find(prd_set, strgp);
+	if (ref)
+		ref->store_pending = 0; /* later updates need a new work */
+	if (ref && prd_set->set) {
+		ldmsd_strgp_lock(strgp);
+		strgp->update_fn(strgp, prd_set, &ref->decomp_ctxt);
+		clock_gettime(CLOCK_REALTIME, &end);
+		if (prd_set->store_stat.start.tv_sec == 0)
+			prd_set->store_stat.start = start;
+		prd_set->store_stat.end = end;
+		ldmsd_stat_update(&prd_set->store_stat, &start, &end);
+		ldmsd_strgp_unlock(strgp);
+	} else {
+		/* The strgp was stopped or the set is gone */
+		end = start;
+	}
+	pthread_mutex_unlock(&prd_set->lock);
+
+	pthread_mutex_lock(&strgp->queue.lock);
+	strgp->queue.completed++;
+	strgp->queue.wait_hist[__hist_idx(&work->enqueue_ts, &start)]++;
+	strgp->queue.store_hist[__hist_idx(&start, &end)]++;
+	pthread_mutex_unlock(&strgp->queue.lock);
+}
+
+static void *strgp_worker_proc(void *arg)
+{
+	ldmsd_strgp_t strgp;
+	ldmsd_strgp_work_t work;
+
+	while (1) {
+		pthread_mutex_lock(&strgp_worker_lock);
+		while (TAILQ_EMPTY(&strgp_run_q))
+			pthread_cond_wait(&strgp_worker_cond, &strgp_worker_lock);
+		strgp = TAILQ_FIRST(&strgp_run_q);
+		TAILQ_REMOVE(&strgp_run_q, strgp, queue.run_entry);
+		pthread_mutex_unlock(&strgp_worker_lock);
+
+		pthread_mutex_lock(&strgp->queue.lock);
+		work = TAILQ_FIRST(&strgp->queue.work_list);
+		TAILQ_REMOVE(&strgp->queue.work_list, work, entry);
+		strgp->queue.depth--;
+		pthread_cond_signal(&strgp->queue.cond);
+		pthread_mutex_unlock(&strgp->queue.lock);
+
+		strgp_work_exec(work);
+		strgp_work_done(work);
+
+		/*
+		 * The strgp is off the run queue while its work is executed,
+		 * so no other worker stores for it concurrently.
+		 */
+		pthread_mutex_lock(&strgp->queue.lock);
+		if (TAILQ_EMPTY(&strgp->queue.work_list)) {
+			strgp->queue.scheduled = 0;
+		} else {
+			pthread_mutex_lock(&strgp_worker_lock);
+			TAILQ_INSERT_TAIL(&strgp_run_q, strgp, queue.run_entry);
+			pthread_cond_signal(&strgp_worker_cond);
+			pthread_mutex_unlock(&strgp_worker_lock);
+		}
+		pthread_mutex_unlock(&strgp->queue.lock);
+		ldmsd_strgp_put(strgp, "strgp_work");
+	}
+	return NULL;
+}
+
+/* Must hold strgp_worker_lock */
+static int __strgp_worker_spawn(int count)
+{
+	pthread_t t;
+	char tname[16];
+	int rc;
+
+	while (strgp_worker_started < count) {
+		rc = pthread_create(&t, NULL, strgp_worker_proc, NULL);
+		if (rc) {
+			ovis_log(store_log, OVIS_LERROR, "Error %d creating "
+				 "a strgp worker thread.\n", rc);
+			return rc;
+		}
+		snprintf(tname, sizeof(tname), "ldmsd_strgp_%d", strgp_worker_started);
+		pthread_setname_np(t, tname);
+		pthread_detach(t);
+		strgp_worker_started++;
+	}
+	return 0;
+}
+
+int ldmsd_strgp_worker_count_set(int count)
+{
+	int rc = 0;
+
+	if (count < 1)
+		return EINVAL;
+	pthread_mutex_lock(&strgp_worker_lock);
+	if (strgp_worker_started && count < strgp_worker_started) {
+		rc = EBUSY;
+		goto out;
+	}
+	strgp_worker_count = count;
+	if (strgp_worker_started)
+		rc = __strgp_worker_spawn(count);
+ out:
+	pthread_mutex_unlock(&strgp_worker_lock);
+	return rc;
+}
+
+int ldmsd_strgp_worker_count_get()
+{
+	return strgp_worker_count;
+}
+
+void ldmsd_strgp_work_submit(ldmsd_strgp_work_t work)
+{
+	ldmsd_strgp_t strgp = work->strgp;
+	struct ldmsd_strgp_queue *q = &strgp->queue;
+	int max_depth;
+
+	clock_gettime(CLOCK_REALTIME, &work->enqueue_ts);
+	pthread_mutex_lock(&q->lock);
+	/* the queue may have been reconfigured after the work was created */
+	max_depth = q->max_depth ? q->max_depth : 1;
+	if (q->depth >= max_depth) {
+		if (q->policy == LDMSD_STRGP_QUEUE_DROP) {
+			q->dropped++;
+			pthread_mutex_unlock(&q->lock);
+			ovis_log(store_log, OVIS_LDEBUG, "strgp '%s': queue full, "
+				 "dropped the store of set '%s'\n",
+				 strgp->obj.name, work->prd_set->inst_name);
+			strgp_work_drop(work);
+			ldmsd_strgp_put(strgp, "strgp_work");
+			return;
+		}
+		while (q->depth >= max_depth)
+			pthread_cond_wait(&q->cond, &q->lock);
+	}
+	TAILQ_INSERT_TAIL(&q->work_list, work, entry);
+	q->depth++;
+	q->enqueued++;
+	if (!q->scheduled) {
+		q->scheduled = 1;
+		pthread_mutex_lock(&strgp_worker_lock);
+		if (!strgp_worker_started)
+			(void)__strgp_worker_spawn(strgp_worker_count);
+		TAILQ_INSERT_TAIL(&strgp_run_q, strgp, queue.run_entry);
+		pthread_cond_signal(&strgp_worker_cond);
+		pthread_mutex_unlock(&strgp_worker_lock);
+	}
+	pthread_mutex_unlock(&q->lock);
+}
@@ -84,6 +84,7 @@ void ldmsd_updtr___del(ldmsd_cfgobj_t obj)
 		ldmsd_cfgobj_put(&prdcr_ref->prdcr->obj, "init");
 		free(prdcr_ref);
 	}
+	free(updtr->batch);
 	ldmsd_cfgobj___del(obj);
 }
 
@@ -218,6 +219,8 @@ static void updtr_update_cb(ldms_t t, ldms_set_t set, int status, void *arg)
 	int errcode;
 	struct timespec start;
 	struct timespec end;
+	struct ldmsd_strgp_work_list work_list = TAILQ_HEAD_INITIALIZER(work_list);
+	ldmsd_strgp_work_t work;
 
 	pthread_mutex_lock(&prd_set->lock);
 	clock_gettime(CLOCK_REALTIME, &prd_set->updt_stat.end);
@@ -257,6 +260,13 @@ static void updtr_update_cb(ldms_t t, ldms_set_t set, int status, void *arg)
 	LIST_FOREACH(str_ref, &prd_set->strgp_list, entry) {
 		ldmsd_strgp_t strgp = str_ref->strgp;
 
+		if (strgp->queue.max_depth) {
+			/* Stored by the strgp workers */
+			work = ldmsd_strgp_work_new(prd_set, str_ref);
+			if (work)
+				TAILQ_INSERT_TAIL(&work_list, work, entry);
+			continue;
+		}
 		ldmsd_strgp_lock(strgp);
 		clock_gettime(CLOCK_REALTIME, &start);
 		strgp->update_fn(strgp, prd_set, &str_ref->decomp_ctxt);
@@ -268,11 +278,20 @@ static void updtr_update_cb(ldms_t t, ldms_set_t set, int status, void *arg)
 		ldmsd_strgp_unlock(strgp);
 	}
 set_ready:
-	if ((status & LDMS_UPD_F_MORE) == 0)
+	if ((status & LDMS_UPD_F_MORE) == 0) {
 		/* No more data pending move prdcr_set state UPDATING --> READY */
-		prd_set->state = LDMSD_PRDCR_SET_STATE_READY;
+		if (prd_set->store_pending)
+			/* after the queued stores are done */
+			prd_set->store_set_ready = 1;
+		else
+			prd_set->state = LDMSD_PRDCR_SET_STATE_READY;
+	}
 out:
 	pthread_mutex_unlock(&prd_set->lock);
+	while ((work = TAILQ_FIRST(&work_list))) {
+		TAILQ_REMOVE(&work_list, work, entry);
+		ldmsd_strgp_work_submit(work);
+	}
 	if (0 == errcode && push_it) {
 		ovis_log(updtr_log, OVIS_LDEBUG, "Pushing set %p %s\n",
 			  prd_set->set, prd_set->inst_name);
@@ -567,6 +586,59 @@ out:
 	return;
 }
 
+/*
+ * Issue the updates of the sets accumulated in updtr->batch.
+ *
+ * The prd_set references and states were taken by batch_set_add(). Undo them
+ * for the sets that failed synchronously, as schedule_set_updates() does.
+ */
+static void batch_flush(ldmsd_updtr_t updtr, int count)
+{
+	int i;
+	ldmsd_prdcr_set_t prd_set;
+
+	if (!count)
+		return;
+	(void)ldms_xprt_update_batch(updtr->batch, count, updtr_update_cb);
+	for (i = 0; i < count; i++) {
+		if (!updtr->batch[i].rc)
+			continue;
+		prd_set = updtr->batch[i].cb_arg;
+		ovis_log(updtr_log, OVIS_LINFO, "Synchronous error %d: "
+				"Updating Set %s\n",
+				updtr->batch[i].rc, prd_set->inst_name);
+		ldmsd_prdcr_set_ref_put(prd_set);
+	}
+}
+
+/*
+ * Add \c prd_set to the update batch of \c updtr if it can be batched.
+ *
+ * Returns 1 if the set is added to the batch. Returns 0 if the set must be
+ * updated with schedule_set_updates(), e.g. it is a setgroup.
+ */
+static int batch_set_add(ldmsd_updtr_t updtr, ldmsd_prdcr_set_t prd_set,
+			 int *count)
+{
+	if (ldmsd_group_check(prd_set->set) & LDMSD_GROUP_IS_GROUP)
+		return 0;
+	ovis_log(updtr_log, OVIS_LDEBUG, "Batch an update for set %s\n",
+					prd_set->inst_name);
+	clock_gettime(CLOCK_REALTIME, &prd_set->updt_stat.start);
+	prd_set->state = LDMSD_PRDCR_SET_STATE_UPDATING;
+	/* The reference will be put back in update_cb */
+	ldmsd_prdcr_set_ref_get(prd_set);
+	updtr->batch[*count].set = prd_set->set;
+	updtr->batch[*count].cb_arg = prd_set;
+	updtr->batch[*count].rc = 0;
+	(*count)++;
+	if (*count == updtr->batch_sz) {
+		batch_flush(updtr, *count);
+		*count = 0;
+	}
+	return 1;
+}
+
 /* Implemented in ldmsd.c */
 extern double ts_diff_usec(struct timespec *a, struct timespec *b);
 static void schedule_prdcr_updates(ldmsd_updtr_task_t task,
@@ -574,6 +646,8 @@ static void schedule_prdcr_updates(ldmsd_updtr_task_t task,
 {
 	ldmsd_updtr_t updtr = task->updtr;
 	struct timespec ts;
+	int batch_cnt = 0;
+	int use_batch = (updtr->batch_sz && !updtr->push_flags);
 	ldmsd_prdcr_lock(prdcr);
 	if (prdcr->conn_state != LDMSD_PRDCR_STATE_CONNECTED || prdcr->xprt->disconnected)
 		goto out;
@@ -651,6 +725,8 @@ static void schedule_prdcr_updates(ldmsd_updtr_task_t task,
 			goto next_prd_set;
 		}
 
+		if (use_batch && batch_set_add(updtr, prd_set, &batch_cnt))
+			goto next_prd_set;
 		schedule_set_updates(prd_set, task);
 
 next_prd_set:
@@ -659,6 +735,7 @@ next_prd_set:
 		else
 			prd_set = ldmsd_prdcr_set_next(prd_set);
 	}
+	batch_flush(updtr, batch_cnt);
 out:
 	ldmsd_prdcr_unlock(prdcr);
 }
@@ -962,6 +1039,39 @@ ldmsd_updtr_new(const char *name, char *interval_str,
 				sctxt.crd.uid, sctxt.crd.gid, 0777);
 }
 
+/*
+ * Set the maximum number of sets of a producer that are updated with a
+ * single ldms_xprt_update_batch() call. 0 disables batching.
+ *
+ * The updater must be in the STOPPED state.
+ */
+int ldmsd_updtr_batch_set(ldmsd_updtr_t updtr, int batch_sz)
+{
+	struct ldms_update_batch_ent_s *batch = NULL;
+	int rc = 0;
+
+	if (batch_sz < 0)
+		return EINVAL;
+	ldmsd_updtr_lock(updtr);
+	if (updtr->state != LDMSD_UPDTR_STATE_STOPPED) {
+		rc = EBUSY;
+		goto out;
+	}
+	if (batch_sz) {
+		batch = calloc(batch_sz, sizeof(*batch));
+		if (!batch) {
+			rc = ENOMEM;
+			goto out;
+		}
+	}
+	free(updtr->batch);
+	updtr->batch = batch;
+	updtr->batch_sz = batch_sz;
+out:
+	ldmsd_updtr_unlock(updtr);
+	return rc;
+}
+
 extern struct rbt *cfgobj_trees[];
 ldmsd_cfgobj_t __cfgobj_find(const char *name, ldmsd_cfgobj_type_t type);
 
@@ -114,6 +114,54 @@ typedef struct js_set_s {
 	struct rbn rbn;	/* The schema->s_set_tree entry */
 } *js_set_t;
 
+/*
+ * The fast path (see js_fast_update()) splits the message into a tape of
+ * tokens in the document order without creating the JSON entities. The
+ * token types are the JSON value types. A dictionary token is followed by
+ * the key and the value tokens of its attributes, and a list token by the
+ * tokens of its items.
+ */
+struct js_tok {
+	enum json_value_e type;
+	int len;		/* The string or number length, 0 or 1 for a
+				   boolean, the number of attributes or items
+				   for a container */
+	const char *s;		/* The string content or the number text */
+	int end;		/* Containers: the index past the last child */
+};
+
+struct js_tape {
+	int n;			/* Number of tokens */
+	int sz;			/* Number of allocated tokens */
+	struct js_tok *tok;
+};
+
+#define JS_TAPE_DEPTH 32	/* Deeper messages use the JSON entity path */
+
+/*
+ * The compiled plan of a schema maps the attribute names to the metric
+ * indices in the set, and the attributes of the dictionaries to the member
+ * indices of their records. The fields are moved to the position at which
+ * the last message had them, so looking up the attributes of the messages
+ * of the same shape is one compare each.
+ */
+struct js_plan_field {
+	char *name;
+	int name_len;
+	int idx;		/* The metric or record member index */
+	enum json_value_e type;	/* The expected JSON value type */
+	size_t array_len;	/* JSON_STRING_VALUE: the array length */
+	int rec_idx;		/* JSON_LIST_VALUE: the record type index of
+				   the dictionary items, -1 if not known */
+	struct js_plan_s *rec;	/* The plan of the record members of a
+				   dictionary, or of the dictionary items */
+};
+
+typedef struct js_plan_s {
+	int n;
+	struct js_plan_field f[OVIS_FLEX];
+} *js_plan_t;
+
 typedef struct js_schema_s {
 	char *s_name;		/* The schema name from JSON object */
 	long s_msgs;		/* Number of JSON messages received for this schema */
@@ -121,12 +169,13 @@ typedef struct js_schema_s {
 	struct rbt s_attr_tree;	/* This tree maps JSON object
 				   attributes to conversion functions */
 	struct rbt s_set_tree;	/* The metric sets for this schema */
+	js_plan_t s_plan;	/* The compiled plan, NULL until the first
+				   fast path update */
 	struct rbn rbn;		/* js->sch_tree entry */
 } *js_schema_t;
 
 typedef struct js_stream_sampler_s *js_stream_sampler_t;
 struct js_stream_sampler_s {
-	int initialized;	/* 0 if 1st config */
 	char *stream_name;	/* stream msgs received from */
 	size_t heap_sz;		/* heap size for created sets */
 	char *prod_name;	/* producer name */
@@ -139,6 +188,10 @@ struct js_stream_sampler_s {
 	pthread_mutex_t sch_tree_lock;
 	struct rbt sch_tree;
 	LIST_HEAD(, js_entry_s) set_list;
+	int fast_path;		/* Update the sets from the raw messages */
+	struct js_tape tape;	/* The fast path tape */
+	int closed;		/* The CLOSE event of stream_client was delivered */
+	pthread_cond_t closed_cond;
 	pthread_mutex_t lock;
 };
 
@@ -148,7 +201,7 @@ static const char *usage(ldmsd_plug_handle_t handle)
 	"config name=js_stream_sampler producer=<prod_name> \n"
 	"         heap_sz=<int> stream=<stream_name>\n"
 	"         [instance=<inst_fmt>] [component_id=<component_id>] [perm=<permissions>]\n"
-	"         [uid=<user_name>] [gid=<group_name>]\n"
+	"         [uid=<user_name>] [gid=<group_name>] [fast_path=0|1]\n"
 	"     producer      A unique name for the host providing the data\n"
 	"     stream        A stream name to subscribe to.\n"
 	"     heap_sz       The number of bytes to reserve for the set heap.\n"
@@ -158,7 +211,9 @@ static const char *usage(ldmsd_plug_handle_t handle)
 	"                   The default is 0\n"
 	"     uid           The user-id of the set's owner (defaults to geteuid())\n"
 	"     gid           The group id of the set's owner (defaults to getegid())\n"
-	"     perm          The set's access permissions (defaults to 0777)\n";
+	"     perm          The set's access permissions (defaults to 0777)\n"
+	"     fast_path     0 to build the JSON objects of all messages\n"
+	"                   (defaults to 1)\n";
 }
 
 static int make_record_array(ldms_record_t record, json_entity_t list_attr)
@@ -363,7 +418,8 @@ int JSON_FLOAT_VALUE_setter(ldms_set_t set, ldms_mval_t mval, json_entity_t enti
 int JSON_STRING_VALUE_setter(ldms_set_t set, ldms_mval_t mval, json_entity_t entity, void *ctxt)
 {
 	json_str_t v = json_value_str(entity);
-	ldms_mval_array_set_str(mval, v->str, v->str_len);
+	/* including the '\0', the value may be shorter than the last one */
+	ldms_mval_array_set_str(mval, v->str, v->str_len + 1);
 	return 0;
 }
 
@@ -802,6 +858,581 @@ static int get_schema_for_json(js_stream_sampler_t js, char *name, json_entity_t
 	return rc;
 }
 
+static js_schema_t js_schema_find(js_stream_sampler_t js, const char *name)
+{
+	struct rbn *rbn;
+
+	pthread_mutex_lock(&js->sch_tree_lock);
+	rbn = rbt_find(&js->sch_tree, name);
+	pthread_mutex_unlock(&js->sch_tree_lock);
+	if (!rbn)
+		return NULL;
+	return container_of(rbn, struct js_schema_s, rbn);
+}
+
+#define JS_WS(_c_) ((_c_) == ' ' || (_c_) == '\t' || (_c_) == '\n' || (_c_) == '\r')
+#define JS_DIGIT(_c_) ((_c_) >= '0' && (_c_) <= '9')
+
+static struct js_tok *js_tok_new(struct js_tape *t)
+{
+	struct js_tok *tok;
+	int sz;
+
+	if (t->n == t->sz) {
+		sz = t->sz ? 2 * t->sz : 256;
+		tok = realloc(t->tok, sz * sizeof(*tok));
+		if (!tok)
+			return NULL;
+		t->tok = tok;
+		t->sz = sz;
+	}
+	return &t->tok[t->n++];
+}
+
+/* The index of the token following the value at index i */
+static inline int js_tok_next(struct js_tape *t, int i)
+{
+	switch (t->tok[i].type) {
+	case JSON_DICT_VALUE:
+	case JSON_LIST_VALUE:
+		return t->tok[i].end;
+	default:
+		return i + 1;
+	}
+}
+
+/*
+ * Scan a double-quoted string. The escapes are checked as the lexer does;
+ * the content is kept as is, like the JSON string entities.
+ */
+static const char *js_str_scan(struct js_tok *tok, const char *s, const char *end)
+{
+	const char *p = s + 1;
+
+	for (;;) {
+		while (p < end && *p != '"' && *p != '\\')
+			p++;
+		if (p >= end)
+			return NULL;
+		if (*p == '"')
+			break;
+		if (++p >= end)
+			return NULL;
+		switch (*p) {
+		case '"': case '\\': case '/':
+		case 'b': case 'f': case 'n': case 'r': case 't':
+			p++;
+			break;
+		case 'u':
+			if (end - p < 5 || !isxdigit(p[1]) || !isxdigit(p[2])
+			    || !isxdigit(p[3]) || !isxdigit(p[4]))
+				return NULL;
+			p += 5;
+			break;
+		default:
+			return NULL;
+		}
+	}
+	tok->type = JSON_STRING_VALUE;
+	tok->s = s + 1;
+	tok->len = p - s - 1;
+	return p + 1;
+}
+
+/*
+ * Scan a number. Only the plain decimal forms are accepted; the numbers the
+ * lexer reads differently (e.g. a leading 0 is octal) are left to it.
+ */
+static const char *js_num_scan(struct js_tok *tok, const char *s, const char *end)
+{
+	const char *p = s;
+
+	tok->type = JSON_INT_VALUE;
+	if (p < end && (*p == '-' || *p == '+'))
+		p++;
+	if (p >= end || !JS_DIGIT(*p))
+		return NULL;
+	if (*p == '0' && p + 1 < end && JS_DIGIT(p[1]))
+		return NULL;
+	while (p < end && JS_DIGIT(*p))
+		p++;
+	if (p < end && *p == '.') {
+		p++;
+		if (p >= end || !JS_DIGIT(*p))
+			return NULL;
+		while (p < end && JS_DIGIT(*p))
+			p++;
+		tok->type = JSON_FLOAT_VALUE;
+	}
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		p++;
+		if (p < end && (*p == '-' || *p == '+'))
+			p++;
+		if (p >= end || !JS_DIGIT(*p))
+			return NULL;
+		while (p < end && JS_DIGIT(*p))
+			p++;
+		tok->type = JSON_FLOAT_VALUE;
+	}
+	tok->s = s;
+	tok->len = p - s;
+	return p;
+}
+
+/*
+ * Split the JSON dictionary in s[0..len) into tokens. Returns EINVAL if the
+ * message is not a dictionary, or if it is anything the tape does not
+ * describe exactly as the JSON parser would.
+ */
+static int js_tape_parse(struct js_tape *t, const char *s, size_t len)
+{
+	const char *end = s + len;
+	int stack[JS_TAPE_DEPTH];
+	int depth = 0;
+	struct js_tok *tok, *c;
+
+	t->n = 0;
+	while (s < end && JS_WS(*s))
+		s++;
+	if (s >= end || *s != '{')
+		return EINVAL;
+ value:
+	while (s < end && JS_WS(*s))
+		s++;
+	if (s >= end)
+		return EINVAL;
+	tok = js_tok_new(t);
+	if (!tok)
+		return ENOMEM;
+	switch (*s) {
+	case '{':
+	case '[':
+		if (depth == JS_TAPE_DEPTH)
+			return EINVAL;
+		tok->type = (*s == '{') ? JSON_DICT_VALUE : JSON_LIST_VALUE;
+		tok->s = s;
+		tok->len = 0;
+		stack[depth++] = t->n - 1;
+		s++;
+		while (s < end && JS_WS(*s))
+			s++;
+		if (s < end && *s == (tok->type == JSON_DICT_VALUE ? '}' : ']')) {
+			s++;
+			goto close;
+		}
+		if (tok->type == JSON_DICT_VALUE)
+			goto key;
+		goto value;
+	case '"':
+		s = js_str_scan(tok, s, end);
+		break;
+	case 't':
+		tok->type = JSON_BOOL_VALUE;
+		tok->len = 1;
+		s = (end - s >= 4 && 0 == memcmp(s, "true", 4)) ? s + 4 : NULL;
+		break;
+	case 'f':
+		tok->type = JSON_BOOL_VALUE;
+		tok->len = 0;
+		s = (end - s >= 5 && 0 == memcmp(s, "false", 5)) ? s + 5 : NULL;
+		break;
+	case 'n':
+		tok->type = JSON_NULL_VALUE;
+		s = (end - s >= 4 && 0 == memcmp(s, "null", 4)) ? s + 4 : NULL;
+		break;
+	default:
+		s = js_num_scan(tok, s, end);
+		break;
+	}
+	if (!s)
+		return EINVAL;
+ next:
+	if (!depth)
+		goto done;
+	c = &t->tok[stack[depth - 1]];
+	c->len++;
+	while (s < end && JS_WS(*s))
+		s++;
+	if (s >= end)
+		return EINVAL;
+	if (*s == ',') {
+		s++;
+		if (c->type == JSON_DICT_VALUE)
+			goto key;
+		goto value;
+	}
+	if (*s != (c->type == JSON_DICT_VALUE ? '}' : ']'))
+		return EINVAL;
+	s++;
+ close:
+	depth--;
+	t->tok[stack[depth]].end = t->n;
+	goto next;
+ key:
+	while (s < end && JS_WS(*s))
+		s++;
+	if (s >= end || *s != '"')
+		return EINVAL;
+	tok = js_tok_new(t);
+	if (!tok)
+		return ENOMEM;
+	s = js_str_scan(tok, s, end);
+	if (!s)
+		return EINVAL;
+	while (s < end && JS_WS(*s))
+		s++;
+	if (s >= end || *s != ':')
+		return EINVAL;
+	s++;
+	goto value;
+ done:
+	/* the publishers usually send the terminating '\0' too */
+	while (s < end && (JS_WS(*s) || *s == '\0'))
+		s++;
+	return (s < end) ? EINVAL : 0;
+}
+
+/* The value of the last "schema" attribute, as json_value_find() has it */
+static struct js_tok *js_tape_schema(struct js_tape *t)
+{
+	struct js_tok *v = NULL;
+	int i, n;
+
+	for (n = 0, i = 1; n < t->tok[0].len; n++) {
+		if (t->tok[i].len == 6 && 0 == memcmp(t->tok[i].s, "schema", 6))
+			v = &t->tok[i + 1];
+		i = js_tok_next(t, i + 1);
+	}
+	return v;
+}
+
+static void js_plan_free(js_plan_t plan)
+{
+	int i;
+
+	if (!plan)
+		return;
+	for (i = 0; i < plan->n; i++) {
+		free(plan->f[i].name);
+		js_plan_free(plan->f[i].rec);
+	}
+	free(plan);
+}
+
+static js_plan_t js_plan_new(int n)
+{
+	return calloc(1, sizeof(struct js_plan_s) + n * sizeof(struct js_plan_field));
+}
+
+static int js_plan_field_init(struct js_plan_field *f, const char *name,
+			      int idx, enum json_value_e type, size_t array_len)
+{
+	f->name = strdup(name);
+	if (!f->name)
+		return ENOMEM;
+	f->name_len = strlen(name);
+	f->idx = idx;
+	f->type = type;
+	f->array_len = array_len;
+	f->rec_idx = -1;
+	return 0;
+}
+
+/*
+ * The plan of the top-level attributes. The attributes whose metric is not
+ * what the JSON value type was encoded as are left out, so the messages
+ * having them are updated by update_set_data().
+ */
+static js_plan_t js_plan_compile(js_schema_t j_schema, ldms_set_t set)
+{
+	enum ldms_value_type vt;
+	struct attr_entry *ae;
+	struct rbn *rbn;
+	js_plan_t plan;
+	size_t array_len;
+	int n = 0;
+
+	RBT_FOREACH(rbn, &j_schema->s_attr_tree)
+		n++;
+	plan = js_plan_new(n);
+	if (!plan)
+		return NULL;
+	RBT_FOREACH(rbn, &j_schema->s_attr_tree) {
+		ae = container_of(rbn, struct attr_entry, rbn);
+		/* S_uid, S_gid and S_perm are not message attributes */
+		if (ae->midx < 3)
+			continue;
+		vt = ldms_metric_type_get(set, ae->midx);
+		array_len = 0;
+		switch (ae->type) {
+		case JSON_INT_VALUE:
+			n = (vt == LDMS_V_S64);
+			break;
+		case JSON_BOOL_VALUE:
+			n = (vt == LDMS_V_S8);
+			break;
+		case JSON_FLOAT_VALUE:
+			n = (vt == LDMS_V_D64);
+			break;
+		case JSON_STRING_VALUE:
+			n = (vt == LDMS_V_CHAR_ARRAY);
+			array_len = ldms_metric_array_get_len(set, ae->midx);
+			break;
+		case JSON_LIST_VALUE:
+			n = (vt == LDMS_V_LIST);
+			break;
+		case JSON_DICT_VALUE:
+			n = (vt == LDMS_V_RECORD_ARRAY);
+			break;
+		default:
+			n = 0;
+			break;
+		}
+		if (!n)
+			continue;
+		if (js_plan_field_init(&plan->f[plan->n], ae->name, ae->midx,
+				       ae->type, array_len)) {
+			js_plan_free(plan);
+			return NULL;
+		}
+		plan->n++;
+	}
+	return plan;
+}
+
+/*
+ * The plan of the scalar members of a record. The arrays (the lists in the
+ * dictionary) are left to JSON_DICT_VALUE_setter().
+ */
+static js_plan_t js_plan_rec_compile(ldms_mval_t rec_inst)
+{
+	enum json_value_e type;
+	js_plan_t plan;
+	size_t array_len;
+	int i, n;
+
+	n = ldms_record_card(rec_inst);
+	plan = js_plan_new(n);
+	if (!plan)
+		return NULL;
+	for (i = 0; i < n; i++) {
+		switch (ldms_record_metric_type_get(rec_inst, i, &array_len)) {
+		case LDMS_V_S64:
+			type = JSON_INT_VALUE;
+			break;
+		case LDMS_V_S8:
+			type = JSON_BOOL_VALUE;
+			break;
+		case LDMS_V_D64:
+			type = JSON_FLOAT_VALUE;
+			break;
+		case LDMS_V_CHAR_ARRAY:
+			type = JSON_STRING_VALUE;
+			break;
+		default:
+			continue;
+		}
+		if (js_plan_field_init(&plan->f[plan->n],
+				       ldms_record_metric_name_get(rec_inst, i),
+				       i, type, array_len)) {
+			js_plan_free(plan);
+			return NULL;
+		}
+		plan->n++;
+	}
+	return plan;
+}
+
+/*
+ * Find the field of the key at position pos of its dictionary, and move it
+ * to that position for the next message.
+ */
+static struct js_plan_field *js_plan_find(js_plan_t plan, int pos, struct js_tok *key)
+{
+	struct js_plan_field f;
+	int i;
+
+	if (pos < plan->n && plan->f[pos].name_len == key->len
+	    && 0 == memcmp(plan->f[pos].name, key->s, key->len))
+		return &plan->f[pos];
+	for (i = 0; i < plan->n; i++) {
+		if (plan->f[i].name_len != key->len
+		    || memcmp(plan->f[i].name, key->s, key->len))
+			continue;
+		if (i < pos)
+			return &plan->f[i]; /* duplicate key */
+		f = plan->f[pos];
+		plan->f[pos] = plan->f[i];
+		plan->f[i] = f;
+		return &plan->f[pos];
+	}
+	return NULL;
+}
+
+/* Set a scalar value the way the JSON_*_VALUE_setter() functions do */
+static int js_tok_set(ldms_mval_t mval, struct js_tok *v, size_t array_len)
+{
+	switch (v->type) {
+	case JSON_INT_VALUE:
+		ldms_mval_set_s64(mval, strtoll(v->s, NULL, 0));
+		break;
+	case JSON_BOOL_VALUE:
+		ldms_mval_set_s8(mval, (int8_t)v->len);
+		break;
+	case JSON_FLOAT_VALUE:
+		ldms_mval_set_double(mval, (double)strtold(v->s, NULL));
+		break;
+	case JSON_STRING_VALUE:
+		if (v->len >= array_len)
+			return EINVAL;
+		ldms_mval_array_set_str(mval, v->s, v->len);
+		ldms_mval_array_set_char(mval, v->len, '\0');
+		break;
+	default:
+		return EINVAL;
+	}
+	return 0;
+}
+
+/* The JSON_DICT_VALUE_setter() of the dictionary at tape index i */
+static int js_plan_dict_apply(js_plan_t *pplan, ldms_mval_t rec_inst,
+			      struct js_tape *t, int i)
+{
+	struct js_plan_field *f;
+	struct js_tok *key, *v;
+	int n, len, rc;
+
+	if (!*pplan) {
+		*pplan = js_plan_rec_compile(rec_inst);
+		if (!*pplan)
+			return ENOMEM;
+	}
+	len = t->tok[i].len;
+	for (n = 0, i++; n < len; n++, i = js_tok_next(t, i + 1)) {
+		key = &t->tok[i];
+		v = &t->tok[i + 1];
+		f = js_plan_find(*pplan, n, key);
+		if (!f)
+			return ENOENT;
+		if (v->type == JSON_NULL_VALUE)
+			continue;
+		if (v->type != f->type)
+			return EINVAL;
+		rc = js_tok_set(ldms_record_metric_get(rec_inst, f->idx), v,
+				f->array_len);
+		if (rc)
+			return rc;
+	}
+	return 0;
+}
+
+/* The JSON_LIST_VALUE_setter() of the list at tape index i */
+static int js_plan_list_apply(ldms_set_t set, struct js_plan_field *f,
+			      ldms_mval_t list_mval, struct js_tape *t, int i)
+{
+	char *rec_type_name;
+	ldms_mval_t item_mval;
+	struct js_tok *v;
+	int n, len, rc;
+
+	ldms_list_purge(set, list_mval);
+	len = t->tok[i].len;
+	for (n = 0, i++; n < len; n++, i = js_tok_next(t, i)) {
+		v = &t->tok[i];
+		switch (v->type) {
+		case JSON_INT_VALUE:
+			item_mval = ldms_list_append_item(set, list_mval, LDMS_V_S64, 1);
+			break;
+		case JSON_BOOL_VALUE:
+			item_mval = ldms_list_append_item(set, list_mval, LDMS_V_S8, 1);
+			break;
+		case JSON_FLOAT_VALUE:
+			item_mval = ldms_list_append_item(set, list_mval, LDMS_V_D64, 1);
+			break;
+		case JSON_STRING_VALUE:
+			if (v->len >= DEFAULT_CHAR_ARRAY_LEN)
+				return EINVAL;
+			item_mval = ldms_list_append_item(set, list_mval,
+							  LDMS_V_CHAR_ARRAY,
+							  DEFAULT_CHAR_ARRAY_LEN);
+			break;
+		case JSON_DICT_VALUE:
+			if (f->rec_idx < 0) {
+				if (asprintf(&rec_type_name, "%s_record", f->name) < 0)
+					return ENOMEM;
+				f->rec_idx = ldms_metric_by_name(set, rec_type_name);
+				free(rec_type_name);
+				if (f->rec_idx < 0)
+					return ENOENT;
+			}
+			item_mval = ldms_record_alloc(set, f->rec_idx);
+			if (!item_mval)
+				return ENOMEM;
+			rc = ldms_list_append_record(set, list_mval, item_mval);
+			if (!rc)
+				rc = js_plan_dict_apply(&f->rec, item_mval, t, i);
+			if (rc)
+				return rc;
+			continue;
+		default:
+			return EINVAL;
+		}
+		if (!item_mval) {
+			LERROR("NULL list item %d mval\n", n);
+			continue;
+		}
+		(void)js_tok_set(item_mval, v, DEFAULT_CHAR_ARRAY_LEN);
+	}
+	return 0;
+}
+
+/*
+ * The update_set_data() of the message on the tape. A non-zero return means
+ * that the message does not match the plan; the values already set are then
+ * set again by update_set_data() in the same transaction.
+ */
+static int js_plan_apply(js_schema_t j_schema, ldms_set_t set, struct js_tape *t)
+{
+	struct js_plan_field *f;
+	struct js_tok *key, *v;
+	ldms_mval_t mval;
+	int n, i, rc;
+
+	if (!j_schema->s_plan) {
+		j_schema->s_plan = js_plan_compile(j_schema, set);
+		if (!j_schema->s_plan)
+			return ENOMEM;
+	}
+	for (n = 0, i = 1; n < t->tok[0].len; n++, i = js_tok_next(t, i + 1)) {
+		key = &t->tok[i];
+		v = &t->tok[i + 1];
+		f = js_plan_find(j_schema->s_plan, n, key);
+		if (!f)
+			return ENOENT;
+		if (v->type == JSON_NULL_VALUE)
+			continue;
+		if (v->type != f->type)
+			return EINVAL;
+		mval = ldms_metric_get(set, f->idx);
+		switch (f->type) {
+		case JSON_DICT_VALUE:
+			rc = js_plan_dict_apply(&f->rec,
+					ldms_record_array_get_inst(mval, 0),
+					t, i + 1);
+			break;
+		case JSON_LIST_VALUE:
+			rc = js_plan_list_apply(set, f, mval, t, i + 1);
+			break;
+		default:
+			rc = js_tok_set(mval, v, f->array_len);
+			break;
+		}
+		if (rc)
+			return rc;
+	}
+	return 0;
+}
+
 static int json_recv_cb(ldms_stream_event_t ev, void *arg);
 
 #define DEFAULT_HEAP_SZ 512
@@ -817,12 +1448,6 @@ static int config(ldmsd_plug_handle_t handle, struct attr_value_list *kwl,
 	char *value;
 	int rc;
 
-	if (__sync_bool_compare_and_swap(&js->initialized, 0, 1)) {
-		pthread_mutex_init(&js->lock, NULL);
-		pthread_mutex_init(&js->sch_tree_lock, NULL);
-		rbt_init(&js->sch_tree, str_cmp);
-
-	}
 	pthread_mutex_lock(&js->lock);
 	if (js->stream_client) {
 		LERROR("The plugin configuration '%s' has been configured "
@@ -912,6 +1537,9 @@ static int config(ldmsd_plug_handle_t handle, struct attr_value_list *kwl,
 	else
 		js->perm = strdup("0660");
 
+	value = av_value(avl, "fast_path");
+	js->fast_path = value ? atoi(value) : 1;
+
 	js->stream_client = ldms_stream_subscribe(js->stream_name, 0,
 				json_recv_cb, handle, "js_stream_sampler");
 	if (!js->stream_client) {
@@ -919,6 +1547,9 @@ static int config(ldmsd_plug_handle_t handle, struct attr_value_list *kwl,
 		rc = errno;
 		goto err_0;
 	}
+	/* The fast path reads the raw message */
+	if (js->fast_path)
+		ldms_stream_client_raw_json_set(js->stream_client, 1);
 	pthread_mutex_unlock(&js->lock);
 	return 0;
  err_0:
@@ -1034,6 +1665,13 @@ static void update_set_data(js_stream_sampler_t js, ldms_set_t l_set,
 			continue;
 		}
 		struct attr_entry *ae = container_of(rbn, struct attr_entry, rbn);
+		if (type == JSON_NULL_VALUE)
+			continue; /* leave the value as is, as in a dictionary */
+		if (type != ae->type) {
+			LERROR("Ignoring the %s value of '%s' encoded as %s\n",
+			       json_type_name(type), name, json_type_name(ae->type));
+			continue;
+		}
 		LDEBUG("Updating midx %d with json attribute '%s' of type %d\n",
 		       ae->midx, name, type);
 
@@ -1057,17 +1695,143 @@ static void update_set_data(js_stream_sampler_t js, ldms_set_t l_set,
 	}
 }
 
-static void js_set_free(ldmsd_cfgobj_store_t self, js_set_t j_set)
+/* Find or create the set of the message; js->lock is held */
+static int js_set_get(js_stream_sampler_t js, ldmsd_plug_handle_t handle,
+		      ldms_stream_event_t ev, json_entity_t entity,
+		      js_schema_t j_schema, ldms_set_t *l_set)
+{
+	char *inst_name;
+	struct rbn *rbn;
+	js_set_t j_set;
+	int rc = 0;
+
+	inst_name = get_inst_name(js, entity, j_schema,
+					ev->recv.cred.uid, ev->recv.cred.gid,
+					ev->recv.perm);
+	if (!inst_name) {
+		rc = errno;
+		LERROR("Error %d constructing set name from instance format '%s'.\n",
+			errno, js->inst_fmt);
+		return rc;
+	}
+	rbn = rbt_find(&j_schema->s_set_tree, inst_name);
+	if (rbn) {
+		j_set = container_of(rbn, struct js_set_s, rbn);
+		*l_set = j_set->set;
+		goto out;
+	}
+	j_set = malloc(sizeof(*j_set));
+	if (!j_set) {
+		rc = ENOMEM;
+		goto out;
+	}
+	j_set->name = strdup(inst_name);
+	if (!j_set->name) {
+		rc = ENOMEM;
+		free(j_set);
+		goto out;
+	}
+	j_set->set = *l_set = ldms_set_create(
+					inst_name,
+					j_schema->s_schema,
+					ev->recv.cred.uid,
+					ev->recv.cred.gid,
+					0444, // ev->recv.perm,
+					js->heap_sz);
+				/*
+				js->uid, js->gid,
+				js->perm, js->heap_sz);
+				*/
+	if (!*l_set) {
+		rc = errno;
+		LERROR("Error %d creating the set '%s' with schema '%s'\n",
+		       errno, inst_name, j_schema->s_name);
+		free(j_set->name);
+		free(j_set);
+		goto out;
+	}
+	LINFO("Created the set '%s' with schema '%s'\n",
+		inst_name, j_schema->s_name);
+	ldmsd_set_register(*l_set, ldmsd_plug_cfg_name_get(handle));
+	ldms_set_publish(*l_set);
+
+	rbn_init(&j_set->rbn, j_set->name);
+	rbt_ins(&j_schema->s_set_tree, &j_set->rbn);
+ out:
+	free(inst_name);
+	return rc;
+}
+
+/*
+ * Update the set of the message from the raw message data with the plan of
+ * its schema. Returns ENOENT if the message has to take the JSON entity
+ * path: it is not a dictionary the tape describes, or its schema is new.
+ * A message of a known schema that does not match the plan is parsed and
+ * given to update_set_data().
+ */
+static int js_fast_update(js_stream_sampler_t js, ldmsd_plug_handle_t handle,
+			  ldms_stream_event_t ev)
+{
+	char name[DEFAULT_CHAR_ARRAY_LEN + 1];
+	json_parser_t parser;
+	json_entity_t entity;
+	js_schema_t j_schema;
+	ldms_set_t l_set;
+	struct js_tok *v;
+	int rc;
+
+	if (js_tape_parse(&js->tape, ev->recv.data, ev->recv.data_len))
+		return ENOENT;
+	v = js_tape_schema(&js->tape);
+	if (!v || v->type != JSON_STRING_VALUE || v->len > DEFAULT_CHAR_ARRAY_LEN)
+		return ENOENT;
+	memcpy(name, v->s, v->len);
+	name[v->len] = '\0';
+	j_schema = js_schema_find(js, name);
+	if (!j_schema)
+		return ENOENT;
+	rc = js_set_get(js, handle, ev, NULL, j_schema, &l_set);
+	if (rc)
+		return rc;
+	ldms_transaction_begin(l_set);
+	ldms_metric_set_s32(l_set, 0, ev->recv.cred.uid);
+	ldms_metric_set_s32(l_set, 1, ev->recv.cred.gid);
+	ldms_metric_set_s32(l_set, 2, ev->recv.perm);
+	if (js_plan_apply(j_schema, l_set, &js->tape)) {
+		LDEBUG("%s: The message does not match the plan of '%s'.\n",
+		       ev->recv.name, j_schema->s_name);
+		parser = json_parser_new(0);
+		if (!parser) {
+			rc = ENOMEM;
+			goto out;
+		}
+		rc = json_parse_buffer(parser, (char *)ev->recv.data,
+				       ev->recv.data_len, &entity);
+		json_parser_free(parser);
+		if (rc) {
+			LERROR("%s: Error %d parsing the JSON message.\n",
+			       ev->recv.name, rc);
+			goto out;
+		}
+		update_set_data(js, l_set, entity, j_schema);
+		json_entity_free(entity);
+	}
+ out:
+	ldms_transaction_end(l_set);
+	return rc;
+}
+
+static void js_set_free(ldmsd_plug_handle_t handle, js_set_t j_set)
 {
 	if (j_set->set) {
-		ldmsd_set_deregister(j_set->name, self->cfg.name);
+		ldmsd_set_deregister(j_set->name, ldmsd_plug_cfg_name_get(handle));
 		ldms_set_delete(j_set->set);
 	}
 	free(j_set->name);
 	free(j_set);
 }
 
-static void js_schema_free(ldmsd_cfgobj_store_t scfg, js_schema_t j_schema)
+static void js_schema_free(ldmsd_plug_handle_t handle, js_schema_t j_schema)
 {
 	struct rbn *rbn;
 	js_set_t j_set;
@@ -1075,7 +1839,7 @@ static void js_schema_free(ldmsd_cfgobj_store_t scfg, js_schema_t j_schema)
 	while (( rbn = rbt_min(&j_schema->s_set_tree) )) {
 		rbt_del(&j_schema->s_set_tree, rbn);
 		j_set = container_of(rbn, struct js_set_s, rbn);
-		js_set_free(scfg, j_set);
+		js_set_free(handle, j_set);
 	}
 	while (( rbn = rbt_min(&j_schema->s_attr_tree) )) {
 		rbt_del(&j_schema->s_attr_tree, rbn);
@@ -1083,38 +1847,43 @@ static void js_schema_free(ldmsd_cfgobj_store_t scfg, js_schema_t j_schema)
 		free(ae->name);
 		free(ae);
 	}
+	js_plan_free(j_schema->s_plan);
 	free(j_schema);
 }
 
-static void purge_schema_tree(ldmsd_cfgobj_store_t scfg, js_stream_sampler_t js)
+static void purge_schema_tree(ldmsd_plug_handle_t handle, js_stream_sampler_t js)
 {
 	struct rbn *rbn;
 	js_schema_t j_schema;
 	while (( rbn = rbt_min(&js->sch_tree) )) {
 		rbt_del(&js->sch_tree, rbn);
 		j_schema = container_of(rbn, struct js_schema_s, rbn);
-		js_schema_free(scfg, j_schema);
+		js_schema_free(handle, j_schema);
 	}
 }
 
-static int __stream_close(ldms_stream_event_t ev, ldmsd_cfgobj_store_t scfg)
+static int __stream_close(ldms_stream_event_t ev, ldmsd_plug_handle_t handle)
 {
-	js_stream_sampler_t js = scfg->context;
-	purge_schema_tree(scfg, js);
+	js_stream_sampler_t js = ldmsd_plug_ctxt_get(handle);
+	pthread_mutex_lock(&js->lock);
+	purge_schema_tree(handle, js);
+	js->closed = 1;
+	pthread_cond_broadcast(&js->closed_cond);
+	pthread_mutex_unlock(&js->lock);
 	return 0;
 }
 
-static int __stream_recv(ldms_stream_event_t ev, ldmsd_cfgobj_store_t scfg)
+static int __stream_recv(ldms_stream_event_t ev, ldmsd_plug_handle_t handle)
 {
-	js_stream_sampler_t js = scfg->context;
+	js_stream_sampler_t js = ldmsd_plug_ctxt_get(handle);
+	json_parser_t parser = NULL;
+	json_entity_t parsed = NULL;
 	const char *msg;
 	json_entity_t entity;
 	int rc = EINVAL;
 	js_schema_t j_schema = NULL;
 	json_entity_t schema_name;
-	struct rbn *rbn;
 	ldms_set_t l_set;
-	js_set_t j_set;
 
 	if (ev->type != LDMS_STREAM_EVENT_RECV)
 		return 0;
@@ -1127,12 +1896,33 @@ static int __stream_recv(ldms_stream_event_t ev, ldmsd_cfgobj_store_t scfg)
 	msg = ev->recv.data;
 	entity = ev->recv.json;
 
+	pthread_mutex_lock(&js->lock);
+	if (!entity) {
+		/* The stream client delivers the raw data to the fast path */
+		rc = js_fast_update(js, handle, ev);
+		if (rc != ENOENT)
+			goto out;
+		parser = json_parser_new(0);
+		if (!parser) {
+			rc = ENOMEM;
+			goto out;
+		}
+		rc = json_parse_buffer(parser, (char *)msg, ev->recv.data_len,
+				       &parsed);
+		if (rc) {
+			LERROR("%s: Error %d parsing the JSON message.\n",
+			       ev->recv.name, rc);
+			goto out;
+		}
+		entity = parsed;
+	}
+
 	/* Find/create the schema for this JSON object */
 	if (JSON_DICT_VALUE != json_entity_type(entity)) {
 		rc = EINVAL;
 		LERROR("%s: Ignoring message that is not a JSON dictionary.\n",
 				ev->recv.name);
-		goto err_0;
+		goto out;
 	}
 
 	schema_name = json_value_find(entity, "schema");
@@ -1140,80 +1930,41 @@ static int __stream_recv(ldms_stream_event_t ev, ldmsd_cfgobj_store_t scfg)
 		rc = EINVAL;
 		LERROR("%s: Ignoring message with 'schema' attribute that is "
 		       "missing or not a string.\n", ev->recv.name);
-		goto err_0;
+		goto out;
 	}
 	rc = get_schema_for_json(js, json_value_str(schema_name)->str, entity, &j_schema);
 	if (rc) {
 		LERROR("%s: Error %d creating an LDMS schema for the JSON object '%s'\n",
 		       ev->recv.name, rc, msg);
-		goto err_0;
-	}
-	char *inst_name = get_inst_name(js, entity, j_schema,
-					ev->recv.cred.uid, ev->recv.cred.gid,
-					ev->recv.perm);
-	if (!inst_name) {
-		LERROR("Error %d constructing set name from instance format '%s'.\n",
-			errno, js->inst_fmt);
-		goto err_0;
-	}
-	rbn = rbt_find(&j_schema->s_set_tree, inst_name);
-	if (!rbn) {
-		j_set = malloc(sizeof(*j_set));
-		j_set->name = strdup(inst_name);
-		j_set->set = l_set = ldms_set_create(
-						inst_name,
-						j_schema->s_schema,
-						ev->recv.cred.uid,
-						ev->recv.cred.gid,
-						0444, // ev->recv.perm,
-						js->heap_sz);
-					/*
-					js->uid, js->gid,
-					js->perm, js->heap_sz);
-					*/
-		if (!l_set) {
-			LERROR("Error %d creating the set '%s' with schema '%s'\n",
-			       errno, inst_name, j_schema->s_name);
-			rc = errno;
-			goto err_1;
-		}
-		LINFO("Created the set '%s' with schema '%s'\n",
-			inst_name, j_schema->s_name);
-		ldmsd_set_register(l_set, scfg->cfg.name);
-		ldms_set_publish(l_set);
-
-		rbn_init(&j_set->rbn, j_set->name);
-		rbt_ins(&j_schema->s_set_tree, &j_set->rbn);
-	} else {
-		j_set = container_of(rbn, struct js_set_s, rbn);
-		l_set = j_set->set;
+		goto out;
 	}
+	rc = js_set_get(js, handle, ev, entity, j_schema, &l_set);
+	if (rc)
+		goto out;
 	ldms_transaction_begin(l_set);
 	ldms_metric_set_s32(l_set, 0, ev->recv.cred.uid);
 	ldms_metric_set_s32(l_set, 1, ev->recv.cred.gid);
 	ldms_metric_set_s32(l_set, 2, ev->recv.perm);
 	update_set_data(js, l_set, entity, j_schema);
 	ldms_transaction_end(l_set);
+ out:
 	pthread_mutex_unlock(&js->lock);
-	free(inst_name);
-	return 0;
-err_1:
-	free(j_set);
-err_0:
-	pthread_mutex_unlock(&js->lock);
-	free(inst_name);
+	if (parsed)
+		json_entity_free(parsed);
+	if (parser)
+		json_parser_free(parser);
 	return rc;
 }
 
 static int json_recv_cb(ldms_stream_event_t ev, void *arg)
 {
-	ldmsd_cfgobj_store_t scfg = arg;
+	ldmsd_plug_handle_t handle = arg;
 
 	switch (ev->type)  {
 	case LDMS_STREAM_EVENT_CLOSE:
-		return __stream_close(ev, scfg);
+		return __stream_close(ev, handle);
 	case LDMS_STREAM_EVENT_RECV:
-		return __stream_recv(ev, scfg);
+		return __stream_recv(ev, handle);
 	default:
 		/* ignore other events */
 		return 0;
@@ -1227,13 +1978,56 @@ static void term(ldmsd_plug_handle_t handle)
 		ldms_stream_close(js->stream_client); /* CLOSE event will clean up `p` */
 }
 
+static int constructor(ldmsd_plug_handle_t handle)
+{
+	js_stream_sampler_t js = calloc(1, sizeof(*js));
+	if (!js)
+		return ENOMEM;
+	pthread_mutex_init(&js->lock, NULL);
+	pthread_cond_init(&js->closed_cond, NULL);
+	pthread_mutex_init(&js->sch_tree_lock, NULL);
+	rbt_init(&js->sch_tree, str_cmp);
+	js->fast_path = 1;
+	ldmsd_plug_ctxt_set(handle, js);
+	return 0;
+}
+
+static void destructor(ldmsd_plug_handle_t handle)
+{
+	js_stream_sampler_t js = ldmsd_plug_ctxt_get(handle);
+
+	/* json_recv_cb() must not run after `js` is freed */
+	if (js->stream_client) {
+		ldms_stream_close(js->stream_client);
+		pthread_mutex_lock(&js->lock);
+		while (!js->closed)
+			pthread_cond_wait(&js->closed_cond, &js->lock);
+		pthread_mutex_unlock(&js->lock);
+	}
+	purge_schema_tree(handle, js);
+	pthread_cond_destroy(&js->closed_cond);
+	pthread_mutex_destroy(&js->sch_tree_lock);
+	pthread_mutex_destroy(&js->lock);
+	free(js->stream_name);
+	free(js->prod_name);
+	free(js->inst_fmt);
+	free(js->comp_id);
+	free(js->uid);
+	free(js->gid);
+	free(js->perm);
+	free(js->tape.tok);
+	free(js);
+}
+
 static struct ldmsd_sampler js_stream_sampler = {
 	.base = {
 		.name = SAMP,
 		.type = LDMSD_PLUGIN_SAMPLER,
 		.term = term,
 		.config = config,
-		.usage = usage
+		.usage = usage,
+		.constructor = constructor,
+		.destructor = destructor,
 	},
 };
 
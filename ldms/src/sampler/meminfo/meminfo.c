@@ -65,6 +65,7 @@
 #include "ldmsd.h"
 #include "ldmsd_plug_api.h"
 #include "sampler_base.h"
+#include "sampler_procfile.h"
 
 #define PROC_FILE "/proc/meminfo"
 #define SAMP "meminfo"
@@ -72,28 +73,33 @@
 typedef struct meminfo_s {
 	ovis_log_t log;
 	ldms_set_t set;
-	FILE *mf;
-	int metric_offset;
+	procfile_t pf;
+	procfile_keytab_t kt;
 	base_data_t base;
 } *meminfo_t;
 
-#define LBUFSZ 256
 static int create_metric_set(meminfo_t mi)
 {
-	ldms_schema_t schema;
-	int rc, i;
+	ldms_schema_t schema = NULL;
+	int rc, line;
 	uint64_t metric_value;
-	char *s;
-	char lbuf[LBUFSZ];
-	char metric_name[LBUFSZ];
+	const char *s, *key;
+	char *l;
+	size_t len;
+	char metric_name[256];
 
-	mi->mf = fopen(PROC_FILE, "r");
-	if (!mi->mf) {
+	mi->pf = procfile_open(PROC_FILE);
+	if (!mi->pf) {
 		ovis_log(mi->log, OVIS_LERROR,
 			 "Could not open the " SAMP " file "
 			 "'%s'...exiting sampler\n", PROC_FILE);
 		return ENOENT;
 	}
+	mi->kt = procfile_keytab_new();
+	if (!mi->kt) {
+		rc = ENOMEM;
+		goto err;
+	}
 
 	schema = base_schema_new(mi->base);
 	if (!schema) {
@@ -104,34 +110,30 @@ static int create_metric_set(meminfo_t mi)
 		goto err;
 	}
 
-	/* Location of first metric from proc/meminfo file */
-	mi->metric_offset = ldms_schema_metric_count_get(schema);
-
 	/*
 	 * Process the file to define all the metrics.
 	 */
-	fseek(mi->mf, 0, SEEK_SET);
-	do {
-		s = fgets(lbuf, sizeof(lbuf), mi->mf);
-		if (!s)
+	rc = procfile_read(mi->pf);
+	if (rc)
+		goto err;
+	for (line = 0; (l = procfile_line(mi->pf, NULL)); line++) {
+		s = procfile_key(l, &key, &len);
+		if (!s || len >= sizeof(metric_name))
 			break;
-
-		rc = sscanf(lbuf, "%s %" PRIu64,
-			    metric_name, &metric_value);
-		if (rc < 2)
+		if (!procfile_u64(s, &metric_value))
 			break;
-
-		/* Strip the colon from metric name if present */
-		i = strlen(metric_name);
-		if (i && metric_name[i-1] == ':')
-			metric_name[i-1] = '\0';
+		memcpy(metric_name, key, len);
+		metric_name[len] = '\0';
 
 		rc = ldms_schema_metric_add(schema, metric_name, LDMS_V_U64);
 		if (rc < 0) {
 			rc = ENOMEM;
 			goto err;
 		}
-	} while (s);
+		rc = procfile_keytab_add(mi->kt, key, len, rc);
+		if (rc)
+			goto err;
+	}
 
 	mi->set = base_set_new(mi->base);
 	if (!mi->set) {
@@ -144,10 +146,10 @@ static int create_metric_set(meminfo_t mi)
  err:
 	if (schema)
 		base_schema_delete(mi->base);
-	if (mi->mf) {
-		fclose(mi->mf);
-		mi->mf = NULL;
-	}
+	procfile_keytab_free(mi->kt);
+	mi->kt = NULL;
+	procfile_close(mi->pf);
+	mi->pf = NULL;
 	return rc;
 }
 
@@ -187,12 +189,11 @@ static int config(ldmsd_plug_handle_t handle,
 static int sample(ldmsd_plug_handle_t handle)
 {
 	meminfo_t mi = ldmsd_plug_ctxt_get(handle);
-	int rc;
-	int metric_no;
-	char *s;
-	char lbuf[256];
-	char metric_name[LBUFSZ];
-	union ldms_value v;
+	int rc, line, idx;
+	const char *s, *key;
+	char *l;
+	size_t len;
+	uint64_t v;
 
 	if (!mi->set) {
 		ovis_log(mi->log, OVIS_LDEBUG, "plugin not initialized\n");
@@ -200,21 +201,20 @@ static int sample(ldmsd_plug_handle_t handle)
 	}
 
 	base_sample_begin(mi->base);
-	metric_no = mi->metric_offset;
-	fseek(mi->mf, 0, SEEK_SET);
-	do {
-		s = fgets(lbuf, sizeof(lbuf), mi->mf);
-		if (!s)
-			break;
-		rc = sscanf(lbuf, "%s %"PRIu64, metric_name, &v.v_u64);
-		if (rc != 2 && rc != 3) {
+	rc = procfile_read(mi->pf);
+	if (rc)
+		goto out;
+	for (line = 0; (l = procfile_line(mi->pf, NULL)); line++) {
+		s = procfile_key(l, &key, &len);
+		if (!s || !procfile_u64(s, &v)) {
 			rc = EINVAL;
 			goto out;
 		}
-
-		ldms_metric_set(mi->set, metric_no, &v);
-		metric_no++;
-	} while (s);
+		idx = procfile_keytab_find(mi->kt, line, key, len);
+		if (idx < 0)
+			continue; /* appeared after the set was created */
+		ldms_metric_set_u64(mi->set, idx, v);
+	}
  out:
 	base_sample_end(mi->base);
 	return 0;
@@ -233,8 +233,8 @@ static int constructor(ldmsd_plug_handle_t handle)
 static void destructor(ldmsd_plug_handle_t handle)
 {
 	meminfo_t mi = ldmsd_plug_ctxt_get(handle);
-	if (mi->mf)
-		fclose(mi->mf);
+	procfile_close(mi->pf);
+	procfile_keytab_free(mi->kt);
 	if (mi->base)
 		base_del(mi->base);
 	if (mi->set)
@@ -0,0 +1,344 @@
+/* -*- c-basic-offset: 8 -*-
+ * Copyright (c) 2026 National Technology & Engineering Solutions
+ * of Sandia, LLC (NTESS). Under the terms of Contract DE-NA0003525 with
+ * NTESS, the U.S. Government retains certain rights in this software.
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * \file procfile_bench.c
+ * \brief Compare stdio/sscanf parsing of /proc files with sampler_procfile
+ *
+ * For each of the files read by the meminfo, vmstat, procstat2 and
+ * procnetdev2 samplers, run the parsing loop the sampler used to have
+ * (fseek + fgets/fscanf + sscanf) and the sampler_procfile loop the sampler
+ * uses now, and report the average time per sample in microseconds.
+ *
+ * Usage: procfile_bench [-n ITERATIONS]
+ */
+#define _GNU_SOURCE
+#include <inttypes.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "sampler_procfile.h"
+
+#define MAX_VALS 4096
+
+static uint64_t vals[MAX_VALS];
+static uint64_t checksum;
+
+/* meminfo and vmstat: "key[:] value [unit]" */
+static int kv_stdio(FILE *f)
+{
+	char lbuf[256];
+	char name[256];
+	uint64_t v;
+	int n = 0;
+
+	fseek(f, 0, SEEK_SET);
+	while (fgets(lbuf, sizeof(lbuf), f)) {
+		if (sscanf(lbuf, "%s %" PRIu64, name, &v) < 2)
+			return -1;
+		vals[n++ % MAX_VALS] = v;
+	}
+	return n;
+}
+
+static int kv_procfile(procfile_t pf, procfile_keytab_t kt)
+{
+	const char *s, *key;
+	char *l;
+	size_t len;
+	uint64_t v;
+	int line, idx, n = 0;
+
+	if (procfile_read(pf))
+		return -1;
+	for (line = 0; (l = procfile_line(pf, NULL)); line++) {
+		s = procfile_key(l, &key, &len);
+		if (!s || !procfile_u64(s, &v))
+			return -1;
+		idx = procfile_keytab_find(kt, line, key, len);
+		if (idx < 0)
+			continue;
+		vals[idx % MAX_VALS] = v;
+		n++;
+	}
+	return n;
+}
+
+static procfile_keytab_t kv_keytab(procfile_t pf)
+{
+	procfile_keytab_t kt = procfile_keytab_new();
+	const char *key;
+	char *l;
+	size_t len;
+	int idx = 0;
+
+	if (!kt || procfile_read(pf))
+		return NULL;
+	while ((l = procfile_line(pf, NULL))) {
+		if (!procfile_key(l, &key, &len))
+			break;
+		procfile_keytab_add(kt, key, len, idx++);
+	}
+	return kt;
+}
+
+/* /proc/stat: a key followed by a variable number of values */
+static int stat_stdio(FILE *f)
+{
+	char tok[128];
+	uint64_t v;
+	int n = 0;
+
+	fseek(f, 0, SEEK_SET);
+	while (1 == fscanf(f, "%s", tok)) {
+		while (1 == fscanf(f, "%" PRIu64, &v))
+			vals[n++ % MAX_VALS] = v;
+	}
+	return n;
+}
+
+static int stat_procfile(procfile_t pf)
+{
+	const char *s, *key;
+	char *l;
+	size_t len;
+	uint64_t v;
+	int n = 0;
+
+	if (procfile_read(pf))
+		return -1;
+	while ((l = procfile_line(pf, NULL))) {
+		s = procfile_key(l, &key, &len);
+		if (!s)
+			continue;
+		while ((s = procfile_u64(s, &v)))
+			vals[n++ % MAX_VALS] = v;
+	}
+	return n;
+}
+
+/* /proc/net/dev: 2 header lines, then "iface: 16 values" */
+static int netdev_stdio(FILE *f)
+{
+	char lbuf[256];
+	char iface[256];
+	uint64_t v[16];
+	char *p;
+	int i, n = 0;
+
+	fseek(f, 0, SEEK_SET);
+	if (!fgets(lbuf, sizeof(lbuf), f) || !fgets(lbuf, sizeof(lbuf), f))
+		return -1;
+	while (fgets(lbuf, sizeof(lbuf), f)) {
+		p = strchr(lbuf, ':');
+		if (p)
+			*p = ' ';
+		if (17 != sscanf(lbuf, "%s %" PRIu64 " %" PRIu64 " %" PRIu64
+				 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64
+				 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64
+				 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64
+				 " %" PRIu64, iface, &v[0], &v[1], &v[2], &v[3],
+				 &v[4], &v[5], &v[6], &v[7], &v[8], &v[9],
+				 &v[10], &v[11], &v[12], &v[13], &v[14], &v[15]))
+			continue;
+		for (i = 0; i < 16; i++)
+			vals[n++ % MAX_VALS] = v[i];
+	}
+	return n;
+}
+
+static int netdev_procfile(procfile_t pf)
+{
+	const char *s, *key;
+	char *l;
+	size_t len;
+	uint64_t v[16];
+	int i, n = 0;
+
+	if (procfile_read(pf))
+		return -1;
+	procfile_skip_lines(pf, 2);
+	while ((l = procfile_line(pf, NULL))) {
+		s = procfile_key(l, &key, &len);
+		if (!s || procfile_u64_n(&s, v, 16) != 16)
+			continue;
+		for (i = 0; i < 16; i++)
+			vals[n++ % MAX_VALS] = v[i];
+	}
+	return n;
+}
+
+enum bench_type {
+	BENCH_KV,
+	BENCH_STAT,
+	BENCH_NETDEV,
+};
+
+struct bench {
+	const char *sampler;
+	const char *path;
+	enum bench_type type;
+} benches[] = {
+	{ "meminfo",     "/proc/meminfo", BENCH_KV     },
+	{ "vmstat",      "/proc/vmstat",  BENCH_KV     },
+	{ "procstat2",   "/proc/stat",    BENCH_STAT   },
+	{ "procnetdev2", "/proc/net/dev", BENCH_NETDEV },
+};
+
+static double now_us()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void usage(const char *prog)
+{
+	printf("Usage: %s [-n ITERATIONS]\n", prog);
+}
+
+int main(int argc, char **argv)
+{
+	int iter = 10000;
+	int i, k, n0, n1, o;
+	FILE *f;
+	procfile_t pf;
+	procfile_keytab_t kt = NULL;
+	double t0, t1, t2;
+	struct bench *b;
+
+	while ((o = getopt(argc, argv, "n:h")) != -1) {
+		switch (o) {
+		case 'n':
+			iter = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+			return o == 'h' ? 0 : EINVAL;
+		}
+	}
+	if (iter <= 0) {
+		usage(argv[0]);
+		return EINVAL;
+	}
+
+	printf("%-12s %-14s %8s %12s %12s %8s\n", "sampler", "file", "values",
+	       "stdio(us)", "procfile(us)", "speedup");
+	for (k = 0; k < sizeof(benches) / sizeof(benches[0]); k++) {
+		b = &benches[k];
+		f = fopen(b->path, "r");
+		pf = procfile_open(b->path);
+		if (!f || !pf) {
+			printf("%-12s %-14s skipped: %s\n", b->sampler, b->path,
+			       strerror(errno));
+			if (f)
+				fclose(f);
+			procfile_close(pf);
+			continue;
+		}
+		if (b->type == BENCH_KV) {
+			kt = kv_keytab(pf);
+			if (!kt) {
+				printf("%-12s %-14s skipped: keytab\n",
+				       b->sampler, b->path);
+				fclose(f);
+				procfile_close(pf);
+				continue;
+			}
+		}
+		n0 = n1 = 0;
+		t0 = now_us();
+		for (i = 0; i < iter; i++) {
+			switch (b->type) {
+			case BENCH_KV:
+				n0 = kv_stdio(f);
+				break;
+			case BENCH_STAT:
+				n0 = stat_stdio(f);
+				break;
+			case BENCH_NETDEV:
+				n0 = netdev_stdio(f);
+				break;
+			}
+			checksum += vals[0];
+		}
+		t1 = now_us();
+		for (i = 0; i < iter; i++) {
+			switch (b->type) {
+			case BENCH_KV:
+				n1 = kv_procfile(pf, kt);
+				break;
+			case BENCH_STAT:
+				n1 = stat_procfile(pf);
+				break;
+			case BENCH_NETDEV:
+				n1 = netdev_procfile(pf);
+				break;
+			}
+			checksum += vals[0];
+		}
+		t2 = now_us();
+		if (n0 != n1)
+			printf("warning: %s: value count mismatch, "
+			       "stdio %d, procfile %d\n", b->sampler, n0, n1);
+		printf("%-12s %-14s %8d %12.2f %12.2f %7.2fx\n", b->sampler,
+		       b->path, n1, (t1 - t0) / iter, (t2 - t1) / iter,
+		       (t1 - t0) / (t2 - t1));
+		fclose(f);
+		procfile_close(pf);
+		procfile_keytab_free(kt);
+		kt = NULL;
+	}
+	/* keep the parsing from being optimized out */
+	if (checksum == 1)
+		printf("\n");
+	return 0;
+}
@@ -68,6 +68,7 @@
 #include "ldmsd.h"
 #include "ldmsd_plug_api.h"
 #include "../sampler_base.h"
+#include "../sampler_procfile.h"
 
 #ifndef ARRAY_LEN
 #define ARRAY_LEN(a) (sizeof(a) / sizeof(*a))
@@ -130,8 +131,9 @@ typedef struct procnetdev2_s {
 	char iface[MAXIFACE][20];
 	int excount;
 	char exclude[MAXIFACE][20];
+	procfile_keytab_t iface_kt; /* ifaces if ifcount, else exclude */
 
-	FILE *mf;
+	procfile_t pf;
 	base_data_t base;
 } *procnetdev2_t;
 
@@ -141,16 +143,34 @@ static int create_metric_set(procnetdev2_t p, base_data_t base)
 {
 	ldms_schema_t schema;
 	ldms_record_t rec_def;
-	int rc;
+	int rc, i;
 
-	p->mf = fopen(procfile, "r");
-	if (!p->mf) {
+	p->pf = procfile_open(procfile);
+	if (!p->pf) {
 		ovis_log(mylog, OVIS_LERROR, "Could not open " SAMP " file "
 				"'%s'...exiting\n",
 				procfile);
 		return ENOENT;
 	}
 
+	p->iface_kt = procfile_keytab_new();
+	if (!p->iface_kt) {
+		rc = ENOMEM;
+		goto err1;
+	}
+	for (i = 0; i < p->ifcount; i++) {
+		rc = procfile_keytab_add(p->iface_kt, p->iface[i],
+					 strnlen(p->iface[i], 20), i);
+		if (rc && rc != EEXIST)
+			goto err1;
+	}
+	for (i = 0; !p->ifcount && i < p->excount; i++) {
+		rc = procfile_keytab_add(p->iface_kt, p->exclude[i],
+					 strnlen(p->exclude[i], 20), i);
+		if (rc && rc != EEXIST)
+			goto err1;
+	}
+
 	/* Create a metric set of the required size */
 	schema = base_schema_new(p->base);
 	if (!schema) {
@@ -199,9 +219,10 @@ err2:
 	base_schema_delete(p->base);
 	p->base = NULL;
 err1:
-	if (p->mf)
-		fclose(p->mf);
-	p->mf = NULL;
+	procfile_keytab_free(p->iface_kt);
+	p->iface_kt = NULL;
+	procfile_close(p->pf);
+	p->pf = NULL;
 
 	return rc;
 }
@@ -339,10 +360,10 @@ static int sample(ldmsd_plug_handle_t handle)
 {
 	procnetdev2_t p = ldmsd_plug_ctxt_get(handle);
 	int rc;
-	char *s;
-	char lbuf[256];
-	char curriface[IFNAMSIZ];
-	union ldms_value v[REC_METRICS_LEN];
+	const char *s, *key;
+	char *l;
+	size_t len;
+	uint64_t v[REC_METRICS_LEN];
 	int i;
 	ldms_mval_t lh, rec_inst, name_mval;
 
@@ -351,9 +372,9 @@ static int sample(ldmsd_plug_handle_t handle)
 		return EINVAL;
 	}
 
-	if (!p->mf)
-		p->mf = fopen(procfile, "r");
-	if (!p->mf) {
+	if (!p->pf)
+		p->pf = procfile_open(procfile);
+	if (!p->pf) {
 		ovis_log(mylog, OVIS_LERROR, "Could not open /proc/net/dev file "
 				"'%s'...exiting\n", procfile);
 		return ENOENT;
@@ -366,70 +387,47 @@ begin:
 	/* reset device data */
 	ldms_list_purge(p->base->set, lh);
 
-	fseek(p->mf, 0, SEEK_SET); //seek should work if get to EOF
-	s = fgets(lbuf, sizeof(lbuf), p->mf);
-	s = fgets(lbuf, sizeof(lbuf), p->mf);
+	rc = procfile_read(p->pf);
+	if (rc) {
+		base_sample_end(p->base);
+		return rc;
+	}
+	/* skip the 2 header lines */
+	procfile_skip_lines(p->pf, 2);
 
 	/* data */
-	do {
-		s = fgets(lbuf, sizeof(lbuf), p->mf);
-		if (!s)
-			break;
-
-		char *pch = strchr(lbuf, ':');
-		if (pch != NULL){
-			*pch = ' ';
-		}
-
-		int rc = sscanf(lbuf, "%s %" PRIu64 " %" PRIu64 " %" PRIu64
-				" %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64
-				" %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64
-				" %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64
-				" %" PRIu64 "\n", curriface, &v[1].v_u64,
-				&v[2].v_u64, &v[3].v_u64, &v[4].v_u64,
-				&v[5].v_u64, &v[6].v_u64, &v[7].v_u64,
-				&v[8].v_u64, &v[9].v_u64, &v[10].v_u64,
-				&v[11].v_u64, &v[12].v_u64, &v[13].v_u64,
-				&v[14].v_u64, &v[15].v_u64, &v[16].v_u64);
-		if (rc != 17){
+	while ((l = procfile_line(p->pf, NULL))) {
+		s = procfile_key(l, &key, &len);
+		if (!s || len >= IFNAMSIZ ||
+		    procfile_u64_n(&s, &v[1], REC_METRICS_LEN - 1) != REC_METRICS_LEN - 1) {
 			ovis_log(mylog, OVIS_LINFO,
-				"wrong number of fields in sscanf\n");
+				"wrong number of fields in %s\n", procfile);
 			continue;
 		}
 
 		if (p->ifcount) {
 			/* ifaces list was given in config */
-			for (i = 0; i < p->ifcount; i++) {
-				if (strcmp(curriface, p->iface[i]) == 0)
-					goto rec;
-			}
-			/* not in the ifaces list */
-			continue;
-		}
-
-		if (p->excount) {
+			if (procfile_keytab_find(p->iface_kt, -1, key, len) < 0)
+				continue;
+		} else if (p->excount) {
 			/* exclude list was given in the config */
-			int excluded = 0;
-			for (i = 0; i < p->excount && !excluded; i++) {
-				if (0 == strcmp(curriface, p->exclude[i]))
-					excluded = 1;
-			}
-			if (excluded)
+			if (procfile_keytab_find(p->iface_kt, -1, key, len) >= 0)
 				continue;
 		}
-	rec:
+
 		rec_inst = ldms_record_alloc(p->base->set, p->rec_def_idx);
 		if (!rec_inst)
 			goto resize;
 		/* iface name */
 		name_mval = ldms_record_metric_get(rec_inst, p->rec_metric_ids[0]);
-		snprintf(name_mval->a_char, IFNAMSIZ, "%s", curriface);
+		memcpy(name_mval->a_char, key, len);
+		name_mval->a_char[len] = '\0';
 		/* metrics */
 		for (i = 1; i < REC_METRICS_LEN; i++) {
-			ldms_record_set_u64(rec_inst, p->rec_metric_ids[i], v[i].v_u64);
+			ldms_record_set_u64(rec_inst, p->rec_metric_ids[i], v[i]);
 		}
 		ldms_list_append_record(p->base->set, lh, rec_inst);
-	} while (s);
+	}
 
 	base_sample_end(p->base);
 	return 0;
@@ -463,10 +461,10 @@ static int constructor(ldmsd_plug_handle_t handle)
 static void destructor(ldmsd_plug_handle_t handle)
 {
 	procnetdev2_t p = ldmsd_plug_ctxt_get(handle);
-	if (p->mf) {
-		fclose(p->mf);
-		p->mf = NULL;
-	}
+	procfile_close(p->pf);
+	p->pf = NULL;
+	procfile_keytab_free(p->iface_kt);
+	p->iface_kt = NULL;
 	base_set_delete(p->base);
 	base_del(p->base);
 	free(p);
@@ -127,6 +127,7 @@
 #include "ldmsd.h"
 #include "ldmsd_plug_api.h"
 #include "../sampler_base.h"
+#include "../sampler_procfile.h"
 #define PROC_FILE "/proc/stat"
 
 static char *procfile = PROC_FILE;
@@ -135,7 +136,7 @@ static int collect_softirq = 0;
 static ldms_set_t set = NULL;
 static ldms_set_t intr_set = NULL;
 static ldms_set_t softirq_set = NULL;
-static FILE *mf = 0;
+static procfile_t pf;
 #define SAMP "procstat2"
 static int metric_offset;
 static base_data_t base;
@@ -194,17 +195,16 @@ enum stat_row {
 
 static int intr_max = -1; /* determine from current intr */
 
-/* big lbuf for (potentially) big "intr" line */
-#define LBUFSZ 65536
-static char lbuf[LBUFSZ];
-
 static int create_metric_sets()
 {
 	ldms_schema_t core_schema = NULL;
 	ldms_schema_t intr_schema = NULL;
 	ldms_schema_t softirq_schema = NULL;
 	int rc;
-	char *s;
+	const char *s, *key;
+	char *l;
+	size_t len;
+	uint64_t u64;
 	ldms_record_t rec_def;
 	int n_cpu;
 	size_t sz;
@@ -215,8 +215,8 @@ static int create_metric_sets()
 	if (!rec_def)
 		return errno;
 
-	mf = fopen(procfile, "r");
-	if (!mf) {
+	pf = procfile_open(procfile);
+	if (!pf) {
 		ovis_log(mylog, OVIS_LERROR, "Could not open the " SAMP " file "
 				"'%s'...exiting sampler\n", procfile);
 		rc = ENOENT;
@@ -259,21 +259,23 @@ static int create_metric_sets()
 	n_cpu = 0;
 	nr_irqs = 0;
 	nr_softirqs = 0;
-	fseek(mf, 0, SEEK_SET);
-	do {
-		s = fgets(lbuf, sizeof(lbuf), mf);
+	rc = procfile_read(pf);
+	if (rc)
+		goto err;
+	while ((l = procfile_line(pf, NULL))) {
+		s = procfile_key(l, &key, &len);
 		if (!s)
-			break;
-		if (0 == strncmp(s, "cpu", 3)) {
+			continue;
+		if (len >= 3 && 0 == strncmp(key, "cpu", 3)) {
 			n_cpu++;
-		} else if (0 == strncmp(s, "intr", 4)) {
-			for (; *s; s++)
-				nr_irqs += (*s == ' ');
-		} else if (0 == strncmp(s, "softirq", 7)) {
-			for (; *s; s++)
-				nr_softirqs += (*s == ' ');
+		} else if (len == 4 && 0 == strncmp(key, "intr", 4)) {
+			while ((s = procfile_u64(s, &u64)))
+				nr_irqs++;
+		} else if (len == 7 && 0 == strncmp(key, "softirq", 7)) {
+			while ((s = procfile_u64(s, &u64)))
+				nr_softirqs++;
 		}
-	} while (s);
+	}
 
 	if (intr_max < 0) {
 		intr_max = nr_irqs;
@@ -327,8 +329,7 @@ static int create_metric_sets()
 	return 0;
 
  err:
-	if (mf)
-		fclose(mf);
+	procfile_close(pf);
 	if (rec_def) {
 		ldms_record_delete(rec_def);
 		rec_def = NULL;
@@ -341,7 +342,7 @@ static int create_metric_sets()
 		ldms_set_delete(intr_set);
 	if (softirq_set)
 		ldms_set_delete(softirq_set);
-	mf = NULL;
+	pf = NULL;
 	return rc;
 }
 
@@ -509,6 +510,9 @@ static int sample(ldmsd_plug_handle_t handle)
 {
 	int i, rc;
 	char tok[128];
+	const char *s, *key;
+	char *l;
+	size_t len;
 	int n;
 	struct stat_row_ent *ent;
 	uint64_t u64, data[16];
@@ -530,8 +534,17 @@ begin:
 	cpu_list = ldms_metric_get(set, sch_metric_ids[STAT_CPU]);
 	assert(cpu_list >= 0);
 	cpu_rec = ldms_list_first(set, cpu_list, NULL, NULL);
-	fseek(mf, 0, SEEK_SET);
-	while (1 == fscanf(mf, "%s", tok)) {
+	rc = procfile_read(pf);
+	if (rc)
+		goto out;
+	while ((l = procfile_line(pf, NULL))) {
+		s = procfile_key(l, &key, &len);
+		if (!s)
+			continue;
+		if (len >= sizeof(tok))
+			len = sizeof(tok) - 1;
+		memcpy(tok, key, len);
+		tok[len] = '\0';
 		ent = bsearch(tok, stat_row_ents, ARRAY_LEN(stat_row_ents),
 				sizeof(stat_row_ents[0]), stat_row_cmp);
 		if (!ent) {
@@ -553,13 +566,7 @@ begin:
 				}
 				ldms_list_append_record(set, cpu_list, cpu_rec);
 			}
-			n = fscanf(mf,  " %"PRIu64 " %"PRIu64 " %"PRIu64
-					" %"PRIu64 " %"PRIu64 " %"PRIu64
-					" %"PRIu64 " %"PRIu64 " %"PRIu64
-					" %"PRIu64,
-				&data[0], &data[1], &data[2], &data[3],
-				&data[4], &data[5], &data[6], &data[7],
-				&data[8], &data[9]);
+			n = procfile_u64_n(&s, data, 10);
 			if (n != 10) {
 				rc = EINVAL;
 				goto out;
@@ -576,15 +583,12 @@ begin:
 		case STAT_INTR:
 			/* interrupt set */
 			if (!collect_intr) {
-				/* Read the whole interrupt line */
-				while (1 == fscanf(mf, "%"PRIu64, &u64))
-					continue;
 				/* do nothing */
 				break;
 			}
 			lh = ldms_metric_get(intr_set, metric_offset);
 			mval = ldms_list_first(intr_set, lh, NULL, NULL);
-			while (1 == fscanf(mf, "%"PRIu64, &u64)) {
+			while ((s = procfile_u64(s, &u64))) {
 				if (!mval) {
 					mval = ldms_list_append_item(intr_set, lh, LDMS_V_U64, 1);
 					if (!mval) {
@@ -610,13 +614,7 @@ begin:
 		case STAT_SOFTIRQ:
 			/* soft interrupt set */
 			/* Read the whole soft interrupt line. */
-			n = fscanf(mf,  " %"PRIu64 " %"PRIu64 " %"PRIu64
-					" %"PRIu64 " %"PRIu64 " %"PRIu64
-					" %"PRIu64 " %"PRIu64 " %"PRIu64
-					" %"PRIu64 " %"PRIu64,
-				&data[0], &data[1], &data[2], &data[3],
-				&data[4], &data[5], &data[6], &data[7],
-				&data[8], &data[9], &data[10]);
+			n = procfile_u64_n(&s, data, 11);
 			if (!collect_softirq) {
 				/* Do nothing */
 				break;
@@ -649,8 +647,7 @@ begin:
 		case STAT_PROCESSES:
 		case STAT_PROCS_RUNNING:
 		case STAT_PROCS_BLOCKED:
-			n = fscanf(mf, "%"PRIu64 , &u64);
-			if (n != 1) {
+			if (!procfile_u64(s, &u64)) {
 				rc = ENODATA;
 				goto out;
 			}
@@ -673,9 +670,9 @@ begin:
 
 static void term(ldmsd_plug_handle_t handle)
 {
-	if (mf) {
-		fclose(mf);
-		mf = NULL;
+	if (pf) {
+		procfile_close(pf);
+		pf = NULL;
 	}
 	if (base) {
 		base_del(base);
@@ -0,0 +1,269 @@
+/* -*- c-basic-offset: 8 -*-
+ * Copyright (c) 2026 National Technology & Engineering Solutions
+ * of Sandia, LLC (NTESS). Under the terms of Contract DE-NA0003525 with
+ * NTESS, the U.S. Government retains certain rights in this software.
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * \file sampler_procfile.c
+ * \brief Low overhead parsing helpers for /proc style text files
+ */
+#define _GNU_SOURCE
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sampler_procfile.h"
+
+#define PROCFILE_BUF_INIT 4096
+
+procfile_t procfile_open(const char *path)
+{
+	procfile_t pf = calloc(1, sizeof(*pf));
+	if (!pf)
+		goto err0;
+	pf->path = strdup(path);
+	if (!pf->path)
+		goto err1;
+	pf->buf_sz = PROCFILE_BUF_INIT;
+	pf->buf = malloc(pf->buf_sz);
+	if (!pf->buf)
+		goto err2;
+	pf->buf[0] = '\0';
+	pf->cur = pf->buf;
+	pf->fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (pf->fd < 0)
+		goto err3;
+	return pf;
+ err3:
+	free(pf->buf);
+ err2:
+	free(pf->path);
+ err1:
+	free(pf);
+ err0:
+	return NULL;
+}
+
+void procfile_close(procfile_t pf)
+{
+	if (!pf)
+		return;
+	if (pf->fd >= 0)
+		close(pf->fd);
+	free(pf->buf);
+	free(pf->path);
+	free(pf);
+}
+
+int procfile_read(procfile_t pf)
+{
+	ssize_t n;
+	size_t off = 0;
+	char *buf;
+
+	/*
+	 * /proc files report st_size 0, so read until a short read and grow
+	 * the buffer whenever it fills up. The buffer is kept at its largest
+	 * size so that the steady state is a single pread().
+	 */
+	while (1) {
+		n = pread(pf->fd, pf->buf + off, pf->buf_sz - off - 1, off);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return errno;
+		}
+		off += n;
+		if (n == 0 || off < pf->buf_sz - 1)
+			break;
+		buf = realloc(pf->buf, pf->buf_sz * 2);
+		if (!buf)
+			return ENOMEM;
+		pf->buf = buf;
+		pf->buf_sz *= 2;
+	}
+	pf->buf[off] = '\0';
+	pf->len = off;
+	pf->cur = pf->buf;
+	return 0;
+}
+
+char *procfile_line(procfile_t pf, size_t *len)
+{
+	char *s = pf->cur;
+	char *e;
+
+	if (s >= pf->buf + pf->len)
+		return NULL;
+	e = memchr(s, '\n', pf->buf + pf->len - s);
+	if (e) {
+		pf->cur = e + 1;
+	} else {
+		e = pf->buf + pf->len;
+		pf->cur = e;
+	}
+	if (len)
+		*len = e - s;
+	return s;
+}
+
+void procfile_skip_lines(procfile_t pf, int n)
+{
+	while (n-- > 0 && procfile_line(pf, NULL))
+		;
+}
+
+static inline uint32_t __keytab_hash(const char *key, size_t len)
+{
+	/* FNV-1a */
+	uint32_t h = 2166136261u;
+	while (len--) {
+		h ^= (unsigned char)*key++;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+procfile_keytab_t procfile_keytab_new(void)
+{
+	return calloc(1, sizeof(struct procfile_keytab_s));
+}
+
+void procfile_keytab_free(procfile_keytab_t kt)
+{
+	int i;
+	if (!kt)
+		return;
+	for (i = 0; i < kt->count; i++)
+		free(kt->ent[i].key);
+	free(kt->ent);
+	free(kt->hash);
+	free(kt);
+}
+
+static int __keytab_rehash(procfile_keytab_t kt, uint32_t hsz)
+{
+	int *hash;
+	int i;
+	uint32_t h;
+	struct procfile_keytab_ent *e;
+
+	hash = calloc(hsz, sizeof(*hash));
+	if (!hash)
+		return ENOMEM;
+	for (i = 0; i < kt->count; i++) {
+		e = &kt->ent[i];
+		h = __keytab_hash(e->key, e->len) & (hsz - 1);
+		while (hash[h])
+			h = (h + 1) & (hsz - 1);
+		hash[h] = i + 1;
+	}
+	free(kt->hash);
+	kt->hash = hash;
+	kt->hmask = hsz - 1;
+	return 0;
+}
+
+int __procfile_keytab_lookup(procfile_keytab_t kt, const char *key, size_t len)
+{
+	uint32_t h;
+	struct procfile_keytab_ent *e;
+
+	if (!kt->hash)
+		return -1;
+	h = __keytab_hash(key, len) & kt->hmask;
+	while (kt->hash[h]) {
+		e = &kt->ent[kt->hash[h] - 1];
+		if (e->len == len && 0 == memcmp(e->key, key, len))
+			return e->idx;
+		h = (h + 1) & kt->hmask;
+	}
+	return -1;
+}
+
+int procfile_keytab_add(procfile_keytab_t kt, const char *key, size_t len,
+			int idx)
+{
+	struct procfile_keytab_ent *ent;
+	uint32_t hsz, h;
+	int rc;
+
+	if (__procfile_keytab_lookup(kt, key, len) >= 0)
+		return EEXIST;
+	if (kt->count == kt->alloc) {
+		ent = realloc(kt->ent, (kt->alloc + 64) * sizeof(*ent));
+		if (!ent)
+			return ENOMEM;
+		kt->ent = ent;
+		kt->alloc += 64;
+	}
+	ent = &kt->ent[kt->count];
+	ent->key = strndup(key, len);
+	if (!ent->key)
+		return ENOMEM;
+	ent->len = len;
+	ent->idx = idx;
+	kt->count++;
+	/* keep the load factor at or below 1/2 */
+	hsz = kt->hash ? kt->hmask + 1 : 32;
+	while (2 * kt->count > hsz)
+		hsz *= 2;
+	if (!kt->hash || hsz != kt->hmask + 1) {
+		rc = __keytab_rehash(kt, hsz);
+		if (rc) {
+			kt->count--;
+			free(ent->key);
+			return rc;
+		}
+		return 0;
+	}
+	h = __keytab_hash(key, len) & kt->hmask;
+	while (kt->hash[h])
+		h = (h + 1) & kt->hmask;
+	kt->hash[h] = kt->count;
+	return 0;
+}
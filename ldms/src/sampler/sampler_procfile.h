@@ -0,0 +1,284 @@
+/* -*- c-basic-offset: 8 -*-
+ * Copyright (c) 2026 National Technology & Engineering Solutions
+ * of Sandia, LLC (NTESS). Under the terms of Contract DE-NA0003525 with
+ * NTESS, the U.S. Government retains certain rights in this software.
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * \file sampler_procfile.h
+ * \brief Low overhead parsing helpers for /proc style text files
+ *
+ * Samplers that read the same /proc file every sample interval spend most
+ * of their time in stdio buffering and \c sscanf() format interpretation.
+ * The helpers here keep the file descriptor open, \c pread() the whole file
+ * into a buffer that is reused across samples, and provide hand-written
+ * scanners for the "key value ..." line format used by most of /proc.
+ *
+ * A \c procfile_keytab_t maps keys (e.g. "MemFree" in /proc/meminfo) to
+ * metric indices. It is built once at config time. Lookups first compare
+ * against the key that was on the same line when the table was built, so
+ * the common case (the file layout did not change) costs one \c memcmp().
+ */
+#ifndef SAMPLER_PROCFILE_H
+#define SAMPLER_PROCFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef struct procfile_s {
+	int fd;
+	char *path;
+	char *buf;		/* file contents, always '\0' terminated */
+	size_t buf_sz;		/* allocated size of buf */
+	size_t len;		/* length of data read by procfile_read() */
+	char *cur;		/* procfile_line() cursor */
+} *procfile_t;
+
+/**
+ * \brief Open a /proc file for repeated sampling
+ *
+ * \param path The path of the file
+ *
+ * \retval pf The handle
+ * \retval NULL If there is an error; \c errno is set
+ */
+procfile_t procfile_open(const char *path);
+
+/**
+ * \brief Close the file and free the handle
+ */
+void procfile_close(procfile_t pf);
+
+/**
+ * \brief Read the whole file from offset 0 into the handle buffer
+ *
+ * The buffer grows as needed, so files like /proc/stat with a very long
+ * "intr" line are read in full. The line cursor is reset to the beginning
+ * of the data.
+ *
+ * \retval 0 If succeeded
+ * \retval errno If failed
+ */
+int procfile_read(procfile_t pf);
+
+/**
+ * \brief Get the next line from the data read by procfile_read()
+ *
+ * The returned line is not '\0' terminated; it ends with '\n' or with the
+ * '\0' at the end of the buffer. All scanners below stop at either one.
+ *
+ * \param pf The handle
+ * \param[out] len The length of the line without the '\n' (may be NULL)
+ *
+ * \retval line The pointer to the beginning of the line
+ * \retval NULL If there are no more lines
+ */
+char *procfile_line(procfile_t pf, size_t *len);
+
+/**
+ * \brief Skip \c n lines (e.g. table headers)
+ */
+void procfile_skip_lines(procfile_t pf, int n);
+
+/**
+ * \brief Skip spaces and tabs (but not the end of line)
+ */
+static inline const char *procfile_skip_blank(const char *s)
+{
+	while (*s == ' ' || *s == '\t')
+		s++;
+	return s;
+}
+
+/**
+ * \brief Scan an unsigned decimal integer, skipping leading blanks
+ *
+ * \param s The scan position
+ * \param[out] v The value
+ *
+ * \retval next The position right after the last digit
+ * \retval NULL If there is no integer at \c s (e.g. end of line)
+ */
+static inline const char *procfile_u64(const char *s, uint64_t *v)
+{
+	uint64_t x;
+	s = procfile_skip_blank(s);
+	if ((unsigned)(*s - '0') > 9)
+		return NULL;
+	x = 0;
+	do {
+		x = x * 10 + (*s - '0');
+		s++;
+	} while ((unsigned)(*s - '0') <= 9);
+	*v = x;
+	return s;
+}
+
+/**
+ * \brief Scan up to \c n unsigned integers
+ *
+ * \retval count The number of integers scanned
+ */
+static inline int procfile_u64_n(const char **s, uint64_t *v, int n)
+{
+	int i;
+	const char *p = *s;
+	const char *q;
+	for (i = 0; i < n; i++) {
+		q = procfile_u64(p, &v[i]);
+		if (!q)
+			break;
+		p = q;
+	}
+	*s = p;
+	return i;
+}
+
+/**
+ * \brief Scan a key, skipping leading blanks
+ *
+ * The key ends at a blank, ':' or the end of line. A ':' right after the
+ * key is consumed but is not part of the key.
+ *
+ * \param s The scan position
+ * \param[out] key The beginning of the key
+ * \param[out] len The key length
+ *
+ * \retval next The position after the key (and its ':')
+ * \retval NULL If the line has no key
+ */
+static inline const char *procfile_key(const char *s, const char **key,
+				       size_t *len)
+{
+	const char *k;
+	s = procfile_skip_blank(s);
+	k = s;
+	while (*s && *s != ' ' && *s != '\t' && *s != ':' && *s != '\n')
+		s++;
+	if (s == k)
+		return NULL;
+	*key = k;
+	*len = s - k;
+	if (*s == ':')
+		s++;
+	return s;
+}
+
+/**
+ * \brief Key to metric index table
+ */
+struct procfile_keytab_ent {
+	char *key;
+	size_t len;
+	int idx;
+};
+
+typedef struct procfile_keytab_s {
+	int count;
+	int alloc;
+	struct procfile_keytab_ent *ent; /* in the order they were added */
+	uint32_t hmask;
+	int *hash;		/* open addressing, ent index + 1, 0 is empty */
+} *procfile_keytab_t;
+
+/**
+ * \brief Create an empty key table
+ *
+ * \retval kt The table
+ * \retval NULL If there is not enough memory
+ */
+procfile_keytab_t procfile_keytab_new(void);
+
+/**
+ * \brief Free the key table
+ */
+void procfile_keytab_free(procfile_keytab_t kt);
+
+/**
+ * \brief Add a key
+ *
+ * Keys should be added in the order they appear in the file so that
+ * procfile_keytab_find() with the line number as the hint succeeds without
+ * a hash lookup.
+ *
+ * \param kt The table
+ * \param key The key (need not be '\0' terminated)
+ * \param len The key length
+ * \param idx The value associated with the key, usually a metric index
+ *
+ * \retval 0 If succeeded
+ * \retval EEXIST If the key is already in the table
+ * \retval ENOMEM If there is not enough memory
+ */
+int procfile_keytab_add(procfile_keytab_t kt, const char *key, size_t len,
+			int idx);
+
+int __procfile_keytab_lookup(procfile_keytab_t kt, const char *key, size_t len);
+
+/**
+ * \brief Find the value associated with \c key
+ *
+ * \param kt The table
+ * \param hint The expected position of the key (e.g. the line number)
+ * \param key The key
+ * \param len The key length
+ *
+ * \retval idx The value given to procfile_keytab_add()
+ * \retval -1 If the key is not in the table
+ */
+static inline int procfile_keytab_find(procfile_keytab_t kt, int hint,
+				       const char *key, size_t len)
+{
+	struct procfile_keytab_ent *e;
+	if (hint >= 0 && hint < kt->count) {
+		e = &kt->ent[hint];
+		if (e->len == len && 0 == memcmp(e->key, key, len))
+			return e->idx;
+	}
+	return __procfile_keytab_lookup(kt, key, len);
+}
+
+#endif
@@ -65,6 +65,7 @@
 #include "ldmsd.h"
 #include "ldmsd_plug_api.h"
 #include "sampler_base.h"
+#include "sampler_procfile.h"
 
 #define PROC_FILE "/proc/vmstat"
 
@@ -72,28 +73,33 @@ static char *procfile = PROC_FILE;
 
 static ldms_set_t set;
 #define SAMP "vmstat"
-static FILE *mf = 0;
-static int metric_offset = 1;
+static procfile_t pf;
+static procfile_keytab_t kt;
 static base_data_t base;
 
 static ovis_log_t mylog;
 
-#define LBUFSZ 256
 static int create_metric_set(base_data_t base)
 {
-	int rc;
+	int rc, line;
 	uint64_t metric_value;
-	char *s;
-	char lbuf[LBUFSZ];
-	char metric_name[LBUFSZ];
+	const char *s, *key;
+	char *l;
+	size_t len;
+	char metric_name[256];
 	ldms_schema_t schema;
 
-	mf = fopen(procfile, "r");
-	if (!mf) {
+	pf = procfile_open(procfile);
+	if (!pf) {
 		ovis_log(mylog, OVIS_LERROR, "Could not open the " SAMP " file "
 				"'%s'...exiting\n", procfile);
 		return ENOENT;
 	}
+	kt = procfile_keytab_new();
+	if (!kt) {
+		rc = ENOMEM;
+		goto err;
+	}
 
 	schema = base_schema_new(base);
 	if (!schema) {
@@ -104,21 +110,25 @@ static int create_metric_set(base_data_t base)
 		goto err;
 	}
 
-	/* Location of first metric from proc/vmstat file */
-	metric_offset = ldms_schema_metric_count_get(schema);
-
-	fseek(mf, 0, SEEK_SET);
-	do {
-		s = fgets(lbuf, sizeof(lbuf), mf);
-		if (!s)
-			break;
-		rc = sscanf(lbuf, "%s %" PRIu64 "\n", metric_name, &metric_value);
-		if (rc < 2)
+	rc = procfile_read(pf);
+	if (rc)
+		goto err;
+	for (line = 0; (l = procfile_line(pf, NULL)); line++) {
+		s = procfile_key(l, &key, &len);
+		if (!s || len >= sizeof(metric_name) ||
+		    !procfile_u64(s, &metric_value)) {
+			rc = EINVAL;
 			goto err;
+		}
+		memcpy(metric_name, key, len);
+		metric_name[len] = '\0';
 		rc = ldms_schema_metric_add(schema, metric_name, LDMS_V_U64);
 		if (rc < 0)
 			goto err;
-	} while (s);
+		rc = procfile_keytab_add(kt, key, len, rc);
+		if (rc)
+			goto err;
+	}
 
 	set = base_set_new(base);
 	if (!set) {
@@ -128,9 +138,10 @@ static int create_metric_set(base_data_t base)
 	return 0;
 
  err:
-	if (mf)
-		fclose(mf);
-	mf = NULL;
+	procfile_keytab_free(kt);
+	kt = NULL;
+	procfile_close(pf);
+	pf = NULL;
 	return rc;
 }
 
@@ -192,12 +203,11 @@ static int config(ldmsd_plug_handle_t handle, struct attr_value_list *kwl, struc
 
 static int sample(ldmsd_plug_handle_t handle)
 {
-	int rc;
-	int metric_no;
-	char *s;
-	char lbuf[LBUFSZ];
-	char metric_name[LBUFSZ];
-	union ldms_value v;
+	int rc, line, idx;
+	const char *s, *key;
+	char *l;
+	size_t len;
+	uint64_t v;
 
 	if (!set) {
 		ovis_log(ldmsd_plug_log_get(handle), OVIS_LDEBUG, "plugin not initialized\n");
@@ -205,20 +215,20 @@ static int sample(ldmsd_plug_handle_t handle)
 	}
 
 	base_sample_begin(base);
-	metric_no = metric_offset;
-	fseek(mf, 0, SEEK_SET);
-	do {
-		s = fgets(lbuf, sizeof(lbuf), mf);
-		if (!s)
-			break;
-		rc = sscanf(lbuf, "%s %" PRIu64 "\n", metric_name, &v.v_u64);
-		if (rc != 2) {
+	rc = procfile_read(pf);
+	if (rc)
+		goto out;
+	for (line = 0; (l = procfile_line(pf, NULL)); line++) {
+		s = procfile_key(l, &key, &len);
+		if (!s || !procfile_u64(s, &v)) {
 			rc = EINVAL;
 			goto out;
 		}
-		ldms_metric_set(set, metric_no, &v);
-		metric_no++;
-	} while (s);
+		idx = procfile_keytab_find(kt, line, key, len);
+		if (idx < 0)
+			continue; /* appeared after the set was created */
+		ldms_metric_set_u64(set, idx, v);
+	}
 	rc = 0;
  out:
 	base_sample_end(base);
@@ -227,9 +237,10 @@ static int sample(ldmsd_plug_handle_t handle)
 
 static void term(ldmsd_plug_handle_t handle)
 {
-	if (mf)
-		fclose(mf);
-	mf = NULL;
+	procfile_close(pf);
+	pf = NULL;
+	procfile_keytab_free(kt);
+	kt = NULL;
 	if (base)
 		base_del(base);
 	base = NULL;
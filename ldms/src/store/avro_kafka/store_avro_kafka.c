@@ -44,6 +44,10 @@ static ovis_log_t aks_log = NULL;
 #define LOG_WARN(FMT, ...) LOG(OVIS_LWARNING, FMT, ##__VA_ARGS__)
 #define LOG_DEBUG(FMT, ...) LOG(OVIS_LDEBUG, FMT, ##__VA_ARGS__)
 
+/* How long a batch waits for room in a full producer queue */
+#define AKS_QUEUE_FULL_WAIT_MS	10
+#define AKS_QUEUE_FULL_RETRY	100
+
 typedef struct store_kafka_s {
 	pthread_mutex_t sk_lock;
 	rd_kafka_conf_t *g_rd_conf;
@@ -67,8 +71,21 @@ typedef struct aks_handle_s
 	store_kafka_t sf;
 
 	struct rbt schema_tree;
+	struct rbt topic_tree;	   /* aks_topic by name */
+	struct str_s *topic_str;   /* topic name expansion buffer */
+	int queue_max;		   /* queue.buffering.max.messages of rd */
 } *aks_handle_t;
 
+/*
+ * Topic handles are cached by name for the life of the store handle,
+ * rd_kafka_topic_new() is too expensive to call for every row.
+ */
+struct aks_topic {
+	struct rbn rbn;
+	rd_kafka_topic_t *rkt;
+	char name[];
+};
+
 static const char *_help_str =
     "   config name=store_avro_kafka [path=JSON_FILE]\n"
     "       encoding=MODE"
@@ -407,11 +424,63 @@ out:
 	return rc;
 }
 
+static void str_free(struct str_s *str);
+static struct str_s *str_new(size_t len);
+
+static int topic_cmp(void *a, const void *b)
+{
+	return strcmp(a, b);
+}
+
+static rd_kafka_topic_t *__topic_get(aks_handle_t sh, const char *name)
+{
+	struct aks_topic *t;
+	struct rbn *rbn;
+	size_t len;
+
+	rbn = rbt_find(&sh->topic_tree, name);
+	if (rbn)
+		return container_of(rbn, struct aks_topic, rbn)->rkt;
+	len = strlen(name) + 1;
+	t = malloc(sizeof(*t) + len);
+	if (!t)
+		return NULL;
+	memcpy(t->name, name, len);
+	t->rkt = rd_kafka_topic_new(sh->rd, name, NULL);
+	if (!t->rkt) {
+		LOG_ERROR("rd_kafka_topic_new(\"%s\") failed, "
+			  "errno: %d\n", name, errno);
+		free(t);
+		return NULL;
+	}
+	LOG_DEBUG("topic name %s\n", name);
+	rbn_init(&t->rbn, t->name);
+	rbt_ins(&sh->topic_tree, &t->rbn);
+	return t->rkt;
+}
+
+static void __topic_purge(aks_handle_t sh)
+{
+	struct aks_topic *t;
+	struct rbn *rbn;
+
+	while ((rbn = rbt_min(&sh->topic_tree))) {
+		rbt_del(&sh->topic_tree, rbn);
+		t = container_of(rbn, struct aks_topic, rbn);
+		rd_kafka_topic_destroy(t->rkt);
+		free(t);
+	}
+}
+
 /* protected by strgp->lock */
 static void close_store(ldmsd_plug_handle_t handle, ldmsd_store_handle_t _sh)
 {
 	/* This is called when strgp is stopped to clean up resources */
 	aks_handle_t sh = _sh;
+	__topic_purge(sh);
+	if (sh->topic_str)
+		str_free(sh->topic_str);
+	free(sh->topic_fmt);
 	if (sh->rd) {
 		rd_kafka_destroy(sh->rd);
 	}
@@ -421,6 +490,17 @@ static void close_store(ldmsd_plug_handle_t handle, ldmsd_store_handle_t _sh)
 	free(sh);
 }
 
+static int __queue_max_get(rd_kafka_t *rd)
+{
+	char val[32];
+	size_t sz = sizeof(val);
+
+	if (rd_kafka_conf_get(rd_kafka_conf(rd), "queue.buffering.max.messages",
+			      val, &sz) != RD_KAFKA_CONF_OK)
+		return 0;
+	return atoi(val);
+}
+
 static aks_handle_t __handle_new(ldmsd_plug_handle_t handle, ldmsd_strgp_t strgp)
 {
 	store_kafka_t sk = ldmsd_plug_ctxt_get(handle);
@@ -433,10 +513,14 @@ static aks_handle_t __handle_new(ldmsd_plug_handle_t handle, ldmsd_strgp_t strgp
 		goto err_0;
 	}
 	rbt_init(&sh->schema_tree, schema_cmp);
+	rbt_init(&sh->topic_tree, topic_cmp);
 	sh->encoding = sk->g_serdes_encoding;
 	sh->topic_fmt = strdup(sk->g_topic_fmt);
 	if (!sh->topic_fmt)
 		goto err_1;
+	sh->topic_str = str_new(256);
+	if (!sh->topic_str)
+		goto err_1;
 
 	sh->rd_conf = rd_kafka_conf_dup(sk->g_rd_conf);
 	if (!sh->rd_conf)
@@ -472,6 +556,7 @@ static aks_handle_t __handle_new(ldmsd_plug_handle_t handle, ldmsd_strgp_t strgp
 		goto err_2;
 	}
 	sh->rd_conf = NULL; /* rd_kafka_new consumed and freed the conf */
+	sh->queue_max = __queue_max_get(sh->rd);
 
 	return sh;
 
@@ -480,6 +565,8 @@ err_3:
 err_2:
 	rd_kafka_conf_destroy(sh->rd_conf);
 err_1:
+	if (sh->topic_str)
+		str_free(sh->topic_str);
 	free(sh->topic_fmt);
 	free(sh);
 err_0:
@@ -730,7 +817,7 @@ static char valid_topic_char(char c)
 
 static char *str_cat_c(str_t str, char c)
 {
-	if (str->cur_pos >= str->buf_len) {
+	if (str->cur_pos + 1 >= str->buf_len) {
 		str->buf_len += 256;
 		str->buf_ptr = realloc(str->buf_ptr, str->buf_len);
 		if (!str->buf_ptr)
@@ -777,7 +864,14 @@ out:
 static char *str_str(str_t str)
 {
 	str->buf_ptr[str->cur_pos] = '\0';
-	return strdup(str->buf_ptr);
+	return str->buf_ptr;
+}
+
+static void str_reset(str_t str)
+{
+	str->cur_ptr = str->buf_ptr;
+	str->cur_pos = 0;
+	str->buf_ptr[0] = '\0';
 }
 
 static void str_free(str_t str)
@@ -831,17 +925,22 @@ static char *access_string(int perm)
 	return perm_str;
 }
 
-static char *get_topic_name(aks_handle_t sh, ldms_set_t set, ldmsd_row_t row)
+/*
+ * Expand the topic format for the row. The returned name is in the handle's
+ * expansion buffer and is valid until the next call.
+ */
+static const char *get_topic_name(aks_handle_t sh, ldms_set_t set, ldmsd_row_t row)
 {
 	char *topic_fmt = sh->topic_fmt;
-	str_t str = str_new(256);
+	str_t str = sh->topic_str;
 	char *topic = NULL;
 	struct passwd *pwd;
 	struct group *grp;
 
 	if (!topic_fmt || topic_fmt[0] == '\0') {
-		return strdup(row->schema_name);
+		return row->schema_name;
 	}
+	str_reset(str);
 
 	while (*topic_fmt != '\0') {
 		while (*topic_fmt != '\0' && *topic_fmt != '%')
@@ -896,7 +995,6 @@ static char *get_topic_name(aks_handle_t sh, ldms_set_t set, ldmsd_row_t row)
 		topic_fmt ++;
 	}
 	topic = str_str(str);
-	str_free(str);
 	return topic;
 }
 
@@ -944,15 +1042,134 @@ out1:
         return rc;
 }
 
+/*
+ * Per-thread produce batch. Runs of rows with the same topic are handed to
+ * rd_kafka_produce_batch() at once. JSON rows are serialized back to back
+ * into one buffer that is kept for the next commit of the thread and copied
+ * by librdkafka; Avro payloads are allocated by serdes and handed over to
+ * librdkafka (RD_KAFKA_MSG_F_FREE).
+ */
+typedef struct aks_batch_s {
+	char *buf;
+	size_t buf_sz;
+	rd_kafka_message_t *msgs;
+	int msgs_sz;
+} *aks_batch_t;
+
+static pthread_key_t aks_batch_key;
+static pthread_once_t aks_batch_once = PTHREAD_ONCE_INIT;
+
+static void aks_batch_destroy(void *arg)
+{
+	aks_batch_t b = arg;
+	free(b->buf);
+	free(b->msgs);
+	free(b);
+}
+
+static void aks_batch_key_init(void)
+{
+	(void)pthread_key_create(&aks_batch_key, aks_batch_destroy);
+}
+
+static aks_batch_t aks_batch_get(int row_count)
+{
+	rd_kafka_message_t *msgs;
+	aks_batch_t b;
+
+	pthread_once(&aks_batch_once, aks_batch_key_init);
+	b = pthread_getspecific(aks_batch_key);
+	if (!b) {
+		b = calloc(1, sizeof(*b));
+		if (!b)
+			return NULL;
+		if (pthread_setspecific(aks_batch_key, b)) {
+			free(b);
+			return NULL;
+		}
+	}
+	if (row_count > b->msgs_sz) {
+		msgs = realloc(b->msgs, row_count * sizeof(*msgs));
+		if (!msgs)
+			return NULL;
+		b->msgs = msgs;
+		b->msgs_sz = row_count;
+	}
+	return b;
+}
+
+/*
+ * Produce the \c n messages of \c b that were serialized for \c rkt.
+ *
+ * The messages rejected because the producer queue is full are produced
+ * again after serving the queue for AKS_QUEUE_FULL_WAIT_MS, at most
+ * AKS_QUEUE_FULL_RETRY times. Returns the number of messages dropped.
+ */
+static int __produce_run(aks_handle_t sh, aks_batch_t b,
+			 rd_kafka_topic_t *rkt, int n)
+{
+	rd_kafka_message_t *m;
+	int i, cnt, flags, retry, full;
+
+	if (sh->encoding == AKS_ENCODING_JSON) {
+		/* the buffer does not move anymore, turn the offsets into pointers */
+		for (i = 0; i < n; i++)
+			b->msgs[i].payload = b->buf + (uintptr_t)b->msgs[i].payload;
+		flags = RD_KAFKA_MSG_F_COPY;
+	} else {
+		flags = RD_KAFKA_MSG_F_FREE;
+	}
+	for (retry = 0; ; retry++) {
+		cnt = rd_kafka_produce_batch(rkt, RD_KAFKA_PARTITION_UA, flags,
+					     b->msgs, n);
+		if (cnt == n)
+			return 0;
+		/* keep the messages rejected by a full queue for the retry */
+		for (i = 0, full = 0; i < n; i++) {
+			m = &b->msgs[i];
+			if (!m->err)
+				continue;
+			if (m->err == RD_KAFKA_RESP_ERR__QUEUE_FULL) {
+				b->msgs[full] = *m;
+				b->msgs[full++].err = 0;
+				continue;
+			}
+			LOG_ERROR("rd_kafka_produce_batch(\"%s\") failed, "
+				  "\"%s\"\n", rd_kafka_topic_name(rkt),
+				  rd_kafka_err2str(m->err));
+			/* librdkafka did not take the payload */
+			if (flags == RD_KAFKA_MSG_F_FREE)
+				free(m->payload);
+		}
+		if (!full)
+			return 0;
+		if (retry == AKS_QUEUE_FULL_RETRY)
+			break;
+		rd_kafka_poll(sh->rd, AKS_QUEUE_FULL_WAIT_MS);
+		n = full;
+	}
+	if (flags == RD_KAFKA_MSG_F_FREE) {
+		for (i = 0; i < full; i++)
+			free(b->msgs[i].payload);
+	}
+	return full;
+}
+
 /* protected by strgp->lock */
 static int
 commit_rows(ldmsd_plug_handle_t handle, ldmsd_strgp_t strgp, ldms_set_t set, ldmsd_row_list_t row_list,
 	    int row_count)
 {
 	aks_handle_t sh;
-	rd_kafka_topic_t *rkt;
+	rd_kafka_topic_t *rkt = NULL, *run_rkt = NULL;
+	rd_kafka_message_t *m;
+	const char *schema_name = NULL;
+	const char *topic_name;
 	ldmsd_row_t row;
-	int rc;
+	aks_batch_t b;
+	void *ser_buf;
+	size_t ser_buf_size, off = 0, start;
+	int rc, n = 0, dropped = 0;
 
 	sh = strgp->store_handle;
 	if (!sh)
@@ -963,63 +1180,86 @@ commit_rows(ldmsd_plug_handle_t handle, ldmsd_strgp_t strgp, ldms_set_t set, ldm
 		strgp->store_handle = sh;
 	}
 
+	/*
+	 * Nothing is produced if the rows do not fit in the producer queue,
+	 * so that the strgp can commit them again (see ldmsd_store.commit).
+	 */
+	if (row_count <= sh->queue_max &&
+	    rd_kafka_outq_len(sh->rd) + row_count > sh->queue_max) {
+		rd_kafka_poll(sh->rd, 0);
+		return EAGAIN;
+	}
+
+	b = aks_batch_get(row_count);
+	if (!b)
+		return ENOMEM;
+
 	TAILQ_FOREACH(row, row_list, entry)
 	{
-		void *ser_buf = NULL;
-		size_t ser_buf_size;
-                int ser_size;
-
-		char *topic_name = get_topic_name(sh, set, row);
-		if (!topic_name) {
-			LOG_ERROR("get_topic_name failed for schema '%s'\n", row->schema_name);
-			continue;
+		/*
+		 * All the rows come from the same set, so only the schema of the
+		 * row changes the topic name.
+		 */
+		if (!schema_name || strcmp(schema_name, row->schema_name)) {
+			schema_name = row->schema_name;
+			topic_name = get_topic_name(sh, set, row);
+			if (!topic_name) {
+				LOG_ERROR("get_topic_name failed for schema '%s'\n",
+					  row->schema_name);
+				rkt = NULL;
+			} else {
+				rkt = __topic_get(sh, topic_name);
+			}
 		}
-		LOG_DEBUG("topic name %s\n", topic_name);
-		rkt = rd_kafka_topic_new(sh->rd, topic_name, NULL);
 		if (!rkt)
-		{
-			LOG_ERROR("rd_kafka_topic_new(\"%s\") failed, "
-				  "errno: %d\n",
-				  topic_name, errno);
-			goto skip_row_0;
+			continue;
+		if (rkt != run_rkt) {
+			if (n)
+				dropped += __produce_run(sh, b, run_rkt, n);
+			run_rkt = rkt;
+			n = 0;
+			off = 0;
 		}
 		switch (sh->encoding) {
 		case AKS_ENCODING_AVRO:
-                        rc = row_to_avro_payload(sh, row, &ser_buf, &ser_buf_size);
+			ser_buf = NULL;
+			rc = row_to_avro_payload(sh, row, &ser_buf, &ser_buf_size);
 			if (rc) {
 				LOG_ERROR("Failed to serialize row as AVRO object, error: %d", rc);
-				goto skip_row_1;
+				continue;
 			}
 			break;
 		case AKS_ENCODING_JSON:
 			/* Encode row as a JSON text object */
-			rc = ldmsd_row_to_json_object(row, (char **)&ser_buf, &ser_size);
+			start = off;
+			rc = ldmsd_row_to_json_object_buf(row, &b->buf, &b->buf_sz, &off);
 			if (rc) {
 				LOG_ERROR("Failed to serialize row as JSON object, error: %d", rc);
-				goto skip_row_1;
+				off = start;
+				continue;
 			}
-			ser_buf_size = (size_t)ser_size;
+			ser_buf = (void *)(uintptr_t)start; /* the buffer may move */
+			ser_buf_size = off - start;
 			break;
 		default:
 			assert(0 == "Invalid/unsupported serialization encoding");
 		}
-
-		/* Publish the Avro serialized buffer */
-		rc = rd_kafka_produce(rkt, RD_KAFKA_PARTITION_UA,
-				      RD_KAFKA_MSG_F_FREE,
-				      ser_buf, ser_buf_size, NULL, 0, NULL);
-		if (rc) {
-			LOG_ERROR("rd_kafka_produce(\"%s\") failed, "
-				  "\"%s\"\n", topic_name,
-				  rd_kafka_err2str(rd_kafka_last_error()));
-			free(ser_buf);
-		}
-	skip_row_1:
-		rd_kafka_topic_destroy(rkt);
-	skip_row_0:
-		free(topic_name);
+		m = &b->msgs[n++];
+		memset(m, 0, sizeof(*m));
+		m->partition = RD_KAFKA_PARTITION_UA;
+		m->payload = ser_buf;
+		m->len = ser_buf_size;
 	}
+	if (n)
+		dropped += __produce_run(sh, b, run_rkt, n);
 
+	/* serve the delivery reports and errors without blocking */
+	rd_kafka_poll(sh->rd, 0);
+
+	if (dropped) {
+		LOG_ERROR("%d rows dropped, the producer queue is full\n", dropped);
+		return ENOBUFS;
+	}
 	return 0;
 }
 
@@ -0,0 +1,824 @@
+/* -*- c-basic-offset: 8 -*-
+ * Copyright (c) 2026 National Technology & Engineering Solutions
+ * of Sandia, LLC (NTESS). Under the terms of Contract DE-NA0003525 with
+ * NTESS, the U.S. Government retains certain rights in this software.
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include "ldms_columnar.h"
+
+#define ALIGN_UP(x) (((x) + LCOL_ALIGN - 1) & ~((size_t)LCOL_ALIGN - 1))
+
+static const char zeros[LCOL_ALIGN];
+
+static const size_t __type_size[] = {
+	[LDMS_V_CHAR]       = 1,
+	[LDMS_V_U8]         = 1,
+	[LDMS_V_S8]         = 1,
+	[LDMS_V_U16]        = 2,
+	[LDMS_V_S16]        = 2,
+	[LDMS_V_U32]        = 4,
+	[LDMS_V_S32]        = 4,
+	[LDMS_V_U64]        = 8,
+	[LDMS_V_S64]        = 8,
+	[LDMS_V_F32]        = 4,
+	[LDMS_V_D64]        = 8,
+	[LDMS_V_CHAR_ARRAY] = 1,
+	[LDMS_V_U8_ARRAY]   = 1,
+	[LDMS_V_S8_ARRAY]   = 1,
+	[LDMS_V_U16_ARRAY]  = 2,
+	[LDMS_V_S16_ARRAY]  = 2,
+	[LDMS_V_U32_ARRAY]  = 4,
+	[LDMS_V_S32_ARRAY]  = 4,
+	[LDMS_V_U64_ARRAY]  = 8,
+	[LDMS_V_S64_ARRAY]  = 8,
+	[LDMS_V_F32_ARRAY]  = 4,
+	[LDMS_V_D64_ARRAY]  = 8,
+	[LDMS_V_TIMESTAMP]  = 8,
+};
+
+size_t lcol_type_size(enum ldms_value_type type)
+{
+	if (type < 0 || type > LDMS_V_LAST)
+		return 0;
+	return __type_size[type];
+}
+
+static int __type_is_array(enum ldms_value_type type)
+{
+	return type >= LDMS_V_CHAR_ARRAY && type <= LDMS_V_D64_ARRAY;
+}
+
+/*
+ * Writer
+ */
+struct lcol_writer_s {
+	int fd;
+	char *path;
+	struct lcol_file_hdr *hdr;	/* the file header, with the names */
+	size_t hdr_len;
+	int col_count;
+	int chunk_rows;
+	int rows;			/* rows in the current chunk */
+	uint64_t *ts;			/* [chunk_rows] */
+	uint8_t **vals;			/* [col_count][chunk_rows * width] */
+	struct lcol_chunk_ftr *ftr;	/* footer of the current chunk */
+	size_t ftr_len;
+	struct iovec *iov;		/* [2 * col_count + 3] */
+	uint64_t file_len;
+	uint64_t row_total;
+	uint64_t byte_total;
+};
+
+static struct lcol_file_hdr *__hdr_new(const char *schema,
+				       const unsigned char *digest,
+				       int col_count,
+				       const struct lcol_col_def *cols,
+				       size_t *len_out)
+{
+	struct lcol_file_hdr *hdr;
+	size_t len, off;
+	size_t esz;
+	int i;
+
+	len = sizeof(*hdr) + col_count * sizeof(hdr->cols[0]);
+	off = len;
+	len += strlen(schema) + 1;
+	for (i = 0; i < col_count; i++)
+		len += strlen(cols[i].name) + 1;
+	len = ALIGN_UP(len);
+	if (len > UINT32_MAX) {
+		errno = E2BIG;
+		return NULL;
+	}
+	hdr = calloc(1, len);
+	if (!hdr)
+		return NULL;
+	memcpy(hdr->magic, LCOL_MAGIC, sizeof(LCOL_MAGIC));
+	hdr->version = LCOL_VERSION;
+	hdr->byte_order = LCOL_BYTE_ORDER;
+	hdr->hdr_len = len;
+	hdr->col_count = col_count;
+	if (digest)
+		memcpy(hdr->digest, digest, LCOL_DIGEST_LEN);
+	hdr->schema_off = off;
+	strcpy((char *)hdr + off, schema);
+	off += strlen(schema) + 1;
+	for (i = 0; i < col_count; i++) {
+		esz = lcol_type_size(cols[i].type);
+		if (!esz)
+			goto einval;
+		hdr->cols[i].type = cols[i].type;
+		if (__type_is_array(cols[i].type)) {
+			if (cols[i].array_len <= 0)
+				goto einval;
+			hdr->cols[i].array_len = cols[i].array_len;
+		} else {
+			hdr->cols[i].array_len = 1;
+		}
+		hdr->cols[i].width = esz * hdr->cols[i].array_len;
+		hdr->cols[i].name_off = off;
+		strcpy((char *)hdr + off, cols[i].name);
+		off += strlen(cols[i].name) + 1;
+	}
+	*len_out = len;
+	return hdr;
+ einval:
+	free(hdr);
+	errno = EINVAL;
+	return NULL;
+}
+
+/* Returns the length of the valid chunk at \c off, or 0 */
+static uint64_t __chunk_len_at(int fd, uint64_t off, uint64_t size,
+			       int col_count)
+{
+	struct lcol_chunk_hdr chdr;
+	struct lcol_chunk_ftr ftr;
+
+	if (off + sizeof(chdr) > size)
+		return 0;
+	if (pread(fd, &chdr, sizeof(chdr), off) != sizeof(chdr))
+		return 0;
+	if (memcmp(chdr.magic, LCOL_CHUNK_MAGIC, sizeof(chdr.magic)))
+		return 0;
+	if (chdr.chunk_len > size - off ||
+	    chdr.ftr_off + sizeof(ftr) +
+	    col_count * sizeof(ftr.cols[0]) != chdr.chunk_len)
+		return 0;
+	if (pread(fd, &ftr, sizeof(ftr), off + chdr.ftr_off) != sizeof(ftr))
+		return 0;
+	if (memcmp(ftr.magic, LCOL_FTR_MAGIC, sizeof(ftr.magic)) ||
+	    ftr.col_count != col_count)
+		return 0;
+	return chdr.chunk_len;
+}
+
+/*
+ * Open (or create) \c path for the schema in \c hdr. On success, \c fd_out
+ * and \c len_out are the descriptor and the length of the valid part of the
+ * file, where the next chunk goes.
+ */
+static int __file_open(const char *path, mode_t mode,
+		       const struct lcol_file_hdr *hdr, size_t hdr_len,
+		       int *fd_out, uint64_t *len_out)
+{
+	struct stat st;
+	uint64_t off, len;
+	void *buf = NULL;
+	int fd, rc;
+
+	fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, mode);
+	if (fd < 0)
+		return errno;
+	if (fstat(fd, &st)) {
+		rc = errno;
+		goto err;
+	}
+	if (st.st_size == 0) {
+		if (pwrite(fd, hdr, hdr_len, 0) != hdr_len) {
+			rc = errno ? errno : EIO;
+			(void)ftruncate(fd, 0);
+			goto err;
+		}
+		off = hdr_len;
+		goto out;
+	}
+	/* appending to an existing file; it must be of the same schema */
+	rc = EEXIST;
+	if (st.st_size < hdr_len)
+		goto err;
+	buf = malloc(hdr_len);
+	if (!buf) {
+		rc = ENOMEM;
+		goto err;
+	}
+	if (pread(fd, buf, hdr_len, 0) != hdr_len || memcmp(buf, hdr, hdr_len))
+		goto err;
+	free(buf);
+	off = hdr_len;
+	while ((len = __chunk_len_at(fd, off, st.st_size, hdr->col_count)))
+		off += len;
+	if (off < st.st_size) {
+		/* drop the incomplete chunk left by an earlier writer */
+		if (ftruncate(fd, off)) {
+			rc = errno;
+			goto err;
+		}
+	}
+ out:
+	*fd_out = fd;
+	*len_out = off;
+	return 0;
+ err:
+	free(buf);
+	close(fd);
+	return rc;
+}
+
+static void __chunk_reset(lcol_writer_t w)
+{
+	int i;
+	for (i = 0; i < w->col_count; i++) {
+		memset(w->vals[i], 0, (size_t)w->rows * w->hdr->cols[i].width);
+		w->ftr->cols[i].flags = 0;
+	}
+	w->ftr->ts_min = UINT64_MAX;
+	w->ftr->ts_max = 0;
+	w->rows = 0;
+}
+
+lcol_writer_t lcol_writer_open(const char *path, mode_t mode,
+			       const char *schema,
+			       const unsigned char *digest,
+			       int col_count, const struct lcol_col_def *cols,
+			       int chunk_rows)
+{
+	lcol_writer_t w;
+	int i, rc;
+
+	if (col_count <= 0 || chunk_rows <= 0) {
+		errno = EINVAL;
+		return NULL;
+	}
+	w = calloc(1, sizeof(*w));
+	if (!w)
+		return NULL;
+	w->fd = -1;
+	w->col_count = col_count;
+	w->chunk_rows = chunk_rows;
+	w->hdr = __hdr_new(schema, digest, col_count, cols, &w->hdr_len);
+	if (!w->hdr)
+		goto err;
+	w->ts = malloc(chunk_rows * sizeof(*w->ts));
+	w->vals = calloc(col_count, sizeof(*w->vals));
+	w->ftr_len = sizeof(*w->ftr) + col_count * sizeof(w->ftr->cols[0]);
+	w->ftr = calloc(1, w->ftr_len);
+	w->iov = calloc(2 * col_count + 3, sizeof(*w->iov));
+	if (!w->ts || !w->vals || !w->ftr || !w->iov)
+		goto err;
+	for (i = 0; i < col_count; i++) {
+		w->vals[i] = calloc(chunk_rows, w->hdr->cols[i].width);
+		if (!w->vals[i])
+			goto err;
+	}
+	memcpy(w->ftr->magic, LCOL_FTR_MAGIC, sizeof(LCOL_FTR_MAGIC));
+	w->ftr->col_count = col_count;
+	__chunk_reset(w);
+
+	w->path = strdup(path);
+	if (!w->path)
+		goto err;
+	rc = __file_open(path, mode, w->hdr, w->hdr_len, &w->fd, &w->file_len);
+	if (rc) {
+		errno = rc;
+		goto err;
+	}
+	return w;
+ err:
+	rc = errno;
+	(void)lcol_writer_close(w);
+	errno = rc;
+	return NULL;
+}
+
+void lcol_writer_row_begin(lcol_writer_t w, uint64_t ts_usec)
+{
+	w->ts[w->rows] = ts_usec;
+	if (ts_usec < w->ftr->ts_min)
+		w->ftr->ts_min = ts_usec;
+	if (ts_usec > w->ftr->ts_max)
+		w->ftr->ts_max = ts_usec;
+}
+
+#define __STAT(T, FIELD) do { \
+	const T *__p = (const T *)dst; \
+	for (k = 0; k < cnt; k++) { \
+		T __x = __p[k]; \
+		if (__x != __x) \
+			continue; /* NaN */ \
+		if (!(st->flags & LCOL_STAT_MINMAX)) { \
+			st->min.FIELD = st->max.FIELD = __x; \
+			st->flags |= LCOL_STAT_MINMAX; \
+		} else if (__x < st->min.FIELD) { \
+			st->min.FIELD = __x; \
+		} else if (__x > st->max.FIELD) { \
+			st->max.FIELD = __x; \
+		} \
+	} \
+} while (0)
+
+void lcol_writer_col(lcol_writer_t w, int col, ldms_mval_t v, int array_len)
+{
+	const struct lcol_col_desc *desc = &w->hdr->cols[col];
+	struct lcol_col_stat *st = &w->ftr->cols[col];
+	uint8_t *dst = w->vals[col] + (size_t)w->rows * desc->width;
+	size_t esz = __type_size[desc->type];
+	size_t cnt, k;
+
+	if (__type_is_array(desc->type)) {
+		cnt = array_len < 0 ? 0 : array_len;
+		if (cnt > desc->array_len)
+			cnt = desc->array_len;
+	} else {
+		cnt = 1;
+	}
+	memcpy(dst, v, cnt * esz);
+
+	switch (desc->type) {
+	case LDMS_V_U8:
+	case LDMS_V_U8_ARRAY:
+		__STAT(uint8_t, u);
+		break;
+	case LDMS_V_S8:
+	case LDMS_V_S8_ARRAY:
+		__STAT(int8_t, i);
+		break;
+	case LDMS_V_U16:
+	case LDMS_V_U16_ARRAY:
+		__STAT(uint16_t, u);
+		break;
+	case LDMS_V_S16:
+	case LDMS_V_S16_ARRAY:
+		__STAT(int16_t, i);
+		break;
+	case LDMS_V_U32:
+	case LDMS_V_U32_ARRAY:
+		__STAT(uint32_t, u);
+		break;
+	case LDMS_V_S32:
+	case LDMS_V_S32_ARRAY:
+		__STAT(int32_t, i);
+		break;
+	case LDMS_V_U64:
+	case LDMS_V_U64_ARRAY:
+		__STAT(uint64_t, u);
+		break;
+	case LDMS_V_S64:
+	case LDMS_V_S64_ARRAY:
+		__STAT(int64_t, i);
+		break;
+	case LDMS_V_F32:
+	case LDMS_V_F32_ARRAY:
+		__STAT(float, d);
+		break;
+	case LDMS_V_D64:
+	case LDMS_V_D64_ARRAY:
+		__STAT(double, d);
+		break;
+	case LDMS_V_TIMESTAMP: {
+		uint64_t usec = (uint64_t)v->v_ts.sec * 1000000 + v->v_ts.usec;
+		dst = (void *)&usec;
+		__STAT(uint64_t, u);
+		break;
+	}
+	default:
+		/* no statistics for characters */
+		break;
+	}
+}
+
+/* Write the whole iovec at \c off */
+static int __pwritev_all(int fd, struct iovec *iov, int cnt, off_t off)
+{
+	ssize_t n;
+
+	while (cnt) {
+		n = pwritev(fd, iov, cnt < IOV_MAX ? cnt : IOV_MAX, off);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return errno;
+		}
+		if (n == 0)
+			return EIO;
+		off += n;
+		while (cnt && n >= (ssize_t)iov->iov_len) {
+			n -= iov->iov_len;
+			iov++;
+			cnt--;
+		}
+		if (cnt && n) {
+			iov->iov_base = (char *)iov->iov_base + n;
+			iov->iov_len -= n;
+		}
+	}
+	return 0;
+}
+
+static int __chunk_write(lcol_writer_t w)
+{
+	struct lcol_chunk_hdr chdr;
+	struct iovec *iov = w->iov;
+	size_t off, len;
+	int i, n = 0, rc;
+
+	if (!w->rows)
+		return 0;
+	if (w->fd < 0)
+		return EBADF;
+
+	memcpy(chdr.magic, LCOL_CHUNK_MAGIC, sizeof(LCOL_CHUNK_MAGIC));
+	iov[n].iov_base = &chdr;
+	iov[n++].iov_len = sizeof(chdr);
+	off = sizeof(chdr);
+
+	w->ftr->ts_off = off;
+	w->ftr->row_count = w->rows;
+	iov[n].iov_base = w->ts;
+	iov[n++].iov_len = w->rows * sizeof(*w->ts);
+	off += w->rows * sizeof(*w->ts);
+
+	for (i = 0; i < w->col_count; i++) {
+		len = (size_t)w->rows * w->hdr->cols[i].width;
+		w->ftr->cols[i].off = off;
+		iov[n].iov_base = w->vals[i];
+		iov[n++].iov_len = len;
+		off += len;
+		if (ALIGN_UP(len) != len) {
+			iov[n].iov_base = (void *)zeros;
+			iov[n++].iov_len = ALIGN_UP(len) - len;
+			off += ALIGN_UP(len) - len;
+		}
+	}
+	chdr.ftr_off = off;
+	chdr.chunk_len = off + w->ftr_len;
+	iov[n].iov_base = w->ftr;
+	iov[n++].iov_len = w->ftr_len;
+
+	rc = __pwritev_all(w->fd, iov, n, w->file_len);
+	if (rc) {
+		/* keep the file ending with a whole chunk */
+		(void)ftruncate(w->fd, w->file_len);
+	} else {
+		w->file_len += chdr.chunk_len;
+		w->byte_total += chdr.chunk_len;
+	}
+	/* the rows of a failed chunk are dropped */
+	__chunk_reset(w);
+	return rc;
+}
+
+int lcol_writer_row_end(lcol_writer_t w)
+{
+	w->rows++;
+	w->row_total++;
+	if (w->rows < w->chunk_rows)
+		return 0;
+	return __chunk_write(w);
+}
+
+int lcol_writer_flush(lcol_writer_t w)
+{
+	return __chunk_write(w);
+}
+
+int lcol_writer_roll(lcol_writer_t w, const char *path, mode_t mode)
+{
+	uint64_t len;
+	char *p;
+	int fd, rc, flush_rc;
+
+	flush_rc = __chunk_write(w);
+	p = strdup(path);
+	if (!p)
+		return ENOMEM;
+	rc = __file_open(path, mode, w->hdr, w->hdr_len, &fd, &len);
+	if (rc) {
+		free(p);
+		return rc;
+	}
+	if (w->fd >= 0)
+		close(w->fd);
+	free(w->path);
+	w->fd = fd;
+	w->path = p;
+	w->file_len = len;
+	w->row_total = 0;
+	w->byte_total = 0;
+	return flush_rc;
+}
+
+int lcol_writer_close(lcol_writer_t w)
+{
+	int i, rc = 0;
+
+	if (!w)
+		return 0;
+	if (w->fd >= 0) {
+		rc = __chunk_write(w);
+		close(w->fd);
+	}
+	if (w->vals) {
+		for (i = 0; i < w->col_count; i++)
+			free(w->vals[i]);
+		free(w->vals);
+	}
+	free(w->iov);
+	free(w->ftr);
+	free(w->ts);
+	free(w->hdr);
+	free(w->path);
+	free(w);
+	return rc;
+}
+
+const char *lcol_writer_path(lcol_writer_t w)
+{
+	return w->path;
+}
+
+const unsigned char *lcol_writer_digest(lcol_writer_t w)
+{
+	return w->hdr->digest;
+}
+
+uint64_t lcol_writer_rows(lcol_writer_t w)
+{
+	return w->row_total;
+}
+
+uint64_t lcol_writer_bytes(lcol_writer_t w)
+{
+	return w->byte_total;
+}
+
+/*
+ * Reader
+ */
+struct lcol_file_s {
+	const uint8_t *map;
+	size_t map_len;
+	const struct lcol_file_hdr *hdr;
+	int chunk_count;
+	uint64_t *chunk_off;	/* [chunk_count] */
+};
+
+static int __str_ok(lcol_file_t f, uint32_t off)
+{
+	return off < f->hdr->hdr_len &&
+		memchr(f->map + off, 0, f->hdr->hdr_len - off);
+}
+
+static int __hdr_check(lcol_file_t f)
+{
+	const struct lcol_file_hdr *hdr = f->hdr;
+	const struct lcol_col_desc *d;
+	size_t esz;
+	int i;
+
+	if (f->map_len < sizeof(*hdr) ||
+	    memcmp(hdr->magic, LCOL_MAGIC, sizeof(LCOL_MAGIC)))
+		return EINVAL;
+	if (hdr->version != LCOL_VERSION || hdr->byte_order != LCOL_BYTE_ORDER)
+		return ENOTSUP;
+	if (hdr->hdr_len > f->map_len ||
+	    sizeof(*hdr) + (uint64_t)hdr->col_count * sizeof(*d) > hdr->hdr_len)
+		return EINVAL;
+	if (!__str_ok(f, hdr->schema_off))
+		return EINVAL;
+	for (i = 0; i < hdr->col_count; i++) {
+		d = &hdr->cols[i];
+		esz = lcol_type_size(d->type);
+		if (!esz || !d->array_len ||
+		    d->width != esz * (uint64_t)d->array_len ||
+		    !__str_ok(f, d->name_off))
+			return EINVAL;
+	}
+	return 0;
+}
+
+/* Returns the length of the valid chunk at \c off, or 0 */
+static uint64_t __chunk_check(lcol_file_t f, uint64_t off)
+{
+	const struct lcol_chunk_hdr *chdr;
+	const struct lcol_chunk_ftr *ftr;
+	uint64_t rest = f->map_len - off;
+	uint32_t col_count = f->hdr->col_count;
+	int i;
+
+	if (rest < sizeof(*chdr))
+		return 0;
+	chdr = (const void *)(f->map + off);
+	if (memcmp(chdr->magic, LCOL_CHUNK_MAGIC, sizeof(chdr->magic)) ||
+	    chdr->chunk_len > rest || chdr->ftr_off % LCOL_ALIGN ||
+	    chdr->ftr_off + sizeof(*ftr) + col_count * sizeof(ftr->cols[0])
+			!= chdr->chunk_len)
+		return 0;
+	ftr = (const void *)(f->map + off + chdr->ftr_off);
+	if (memcmp(ftr->magic, LCOL_FTR_MAGIC, sizeof(ftr->magic)) ||
+	    ftr->col_count != col_count ||
+	    ftr->ts_off + (uint64_t)ftr->row_count * sizeof(uint64_t)
+			> chdr->ftr_off)
+		return 0;
+	for (i = 0; i < col_count; i++) {
+		if (ftr->cols[i].off % LCOL_ALIGN ||
+		    ftr->cols[i].off + (uint64_t)ftr->row_count *
+		    f->hdr->cols[i].width > chdr->ftr_off)
+			return 0;
+	}
+	return chdr->chunk_len;
+}
+
+lcol_file_t lcol_open(const char *path)
+{
+	struct stat st;
+	lcol_file_t f;
+	uint64_t off, len;
+	uint64_t *p;
+	int fd, rc, cap = 0;
+
+	f = calloc(1, sizeof(*f));
+	if (!f)
+		return NULL;
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		goto err;
+	if (fstat(fd, &st)) {
+		rc = errno;
+		close(fd);
+		errno = rc;
+		goto err;
+	}
+	if (st.st_size < sizeof(struct lcol_file_hdr)) {
+		close(fd);
+		errno = EINVAL;
+		goto err;
+	}
+	f->map_len = st.st_size;
+	f->map = mmap(NULL, f->map_len, PROT_READ, MAP_SHARED, fd, 0);
+	rc = errno;
+	close(fd);
+	if (f->map == MAP_FAILED) {
+		f->map = NULL;
+		errno = rc;
+		goto err;
+	}
+	f->hdr = (const void *)f->map;
+	rc = __hdr_check(f);
+	if (rc) {
+		errno = rc;
+		goto err;
+	}
+	off = f->hdr->hdr_len;
+	while ((len = __chunk_check(f, off))) {
+		if (f->chunk_count == cap) {
+			cap = cap ? cap * 2 : 64;
+			p = realloc(f->chunk_off, cap * sizeof(*p));
+			if (!p)
+				goto err;
+			f->chunk_off = p;
+		}
+		f->chunk_off[f->chunk_count++] = off;
+		off += len;
+	}
+	return f;
+ err:
+	rc = errno;
+	lcol_close(f);
+	errno = rc;
+	return NULL;
+}
+
+void lcol_close(lcol_file_t f)
+{
+	if (!f)
+		return;
+	if (f->map)
+		munmap((void *)f->map, f->map_len);
+	free(f->chunk_off);
+	free(f);
+}
+
+const struct lcol_file_hdr *lcol_hdr(lcol_file_t f)
+{
+	return f->hdr;
+}
+
+const char *lcol_schema_name(lcol_file_t f)
+{
+	return (const char *)f->map + f->hdr->schema_off;
+}
+
+int lcol_col_count(lcol_file_t f)
+{
+	return f->hdr->col_count;
+}
+
+const struct lcol_col_desc *lcol_col(lcol_file_t f, int col)
+{
+	return &f->hdr->cols[col];
+}
+
+const char *lcol_col_name(lcol_file_t f, int col)
+{
+	return (const char *)f->map + f->hdr->cols[col].name_off;
+}
+
+int lcol_col_find(lcol_file_t f, const char *name)
+{
+	int i;
+	for (i = 0; i < f->hdr->col_count; i++) {
+		if (0 == strcmp(lcol_col_name(f, i), name))
+			return i;
+	}
+	return -1;
+}
+
+int lcol_chunk_count(lcol_file_t f)
+{
+	return f->chunk_count;
+}
+
+const struct lcol_chunk_ftr *lcol_chunk(lcol_file_t f, int chunk)
+{
+	const struct lcol_chunk_hdr *chdr;
+	chdr = (const void *)(f->map + f->chunk_off[chunk]);
+	return (const void *)((const uint8_t *)chdr + chdr->ftr_off);
+}
+
+const uint64_t *lcol_chunk_ts(lcol_file_t f, int chunk)
+{
+	return (const void *)(f->map + f->chunk_off[chunk] +
+			      lcol_chunk(f, chunk)->ts_off);
+}
+
+const void *lcol_chunk_col(lcol_file_t f, int chunk, int col)
+{
+	return f->map + f->chunk_off[chunk] + lcol_chunk(f, chunk)->cols[col].off;
+}
+
+int lcol_scan(lcol_file_t f, uint64_t ts_begin, uint64_t ts_end,
+	      lcol_scan_fn_t fn, void *arg)
+{
+	const struct lcol_chunk_ftr *ftr;
+	const uint64_t *ts;
+	int c, r, rc;
+
+	for (c = 0; c < f->chunk_count; c++) {
+		ftr = lcol_chunk(f, c);
+		if (ftr->ts_max < ts_begin || ftr->ts_min >= ts_end)
+			continue;
+		ts = lcol_chunk_ts(f, c);
+		for (r = 0; r < ftr->row_count; r++) {
+			if (ts[r] < ts_begin || ts[r] >= ts_end)
+				continue;
+			rc = fn(f, c, r, arg);
+			if (rc)
+				return rc;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,255 @@
+/* -*- c-basic-offset: 8 -*-
+ * Copyright (c) 2026 National Technology & Engineering Solutions
+ * of Sandia, LLC (NTESS). Under the terms of Contract DE-NA0003525 with
+ * NTESS, the U.S. Government retains certain rights in this software.
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * \file ldms_columnar.h
+ * \brief Columnar binary file format of store_columnar, with its writer and
+ *        reader.
+ *
+ * A file holds the rows of one decomposition row schema. It starts with a
+ * file header describing the columns, followed by a sequence of chunks:
+ *
+ *   [lcol_file_hdr][lcol_col_desc x col_count][names]
+ *   [chunk] [chunk] ...
+ *
+ * A chunk stores up to \c chunk_rows rows column by column:
+ *
+ *   [lcol_chunk_hdr][timestamps][column 0]...[column N-1][lcol_chunk_ftr]
+ *
+ * Every column block is \c row_count values of the column's fixed width,
+ * so the value of row \c r of a column is at <tt>block + r * width</tt>.
+ * The timestamp block holds the set transaction time of each row in
+ * microseconds since the epoch. The footer carries the time range of the
+ * chunk and the min/max of every numeric column, so a reader can skip a
+ * chunk without touching its column blocks. All blocks are 8-byte
+ * aligned and values are in the byte order of the writer
+ * (\c lcol_file_hdr::byte_order), so the file can be used in place through
+ * mmap().
+ *
+ * Chunks are only appended whole. A chunk that was cut short (e.g. by a
+ * crash) ends the readable part of the file and is dropped when the writer
+ * reopens the file.
+ */
+#ifndef __LDMS_COLUMNAR_H__
+#define __LDMS_COLUMNAR_H__
+
+#include <stdint.h>
+#include <sys/types.h>
+#include "ldms_core.h"
+
+#define LCOL_MAGIC		"LDMSCOL"
+#define LCOL_CHUNK_MAGIC	"LCOLCHK"
+#define LCOL_FTR_MAGIC		"LCOLFTR"
+#define LCOL_VERSION		1
+#define LCOL_BYTE_ORDER		0x01020304
+#define LCOL_DIGEST_LEN		32
+#define LCOL_ALIGN		8
+
+struct lcol_col_desc {
+	uint32_t type;		/* enum ldms_value_type */
+	uint32_t array_len;	/* 1 for scalars */
+	uint32_t width;		/* bytes per row */
+	uint32_t name_off;	/* from the start of the file */
+};
+
+struct lcol_file_hdr {
+	char magic[8];		/* LCOL_MAGIC */
+	uint32_t version;
+	uint32_t byte_order;	/* LCOL_BYTE_ORDER, as written */
+	uint32_t hdr_len;	/* the first chunk starts here */
+	uint32_t col_count;
+	uint32_t schema_off;	/* row schema name, from the start of the file */
+	uint32_t pad;
+	unsigned char digest[LCOL_DIGEST_LEN]; /* row schema digest */
+	struct lcol_col_desc cols[];
+};
+
+struct lcol_chunk_hdr {
+	char magic[8];		/* LCOL_CHUNK_MAGIC */
+	uint64_t chunk_len;	/* header to the end of the footer */
+	uint64_t ftr_off;	/* from the start of the chunk */
+};
+
+union lcol_val {
+	int64_t i;		/* signed types */
+	uint64_t u;		/* unsigned types, char and timestamp (usec) */
+	double d;		/* LDMS_V_F32, LDMS_V_D64 */
+};
+
+#define LCOL_STAT_MINMAX 0x1	/* min/max are valid */
+
+struct lcol_col_stat {
+	uint64_t off;		/* column block, from the start of the chunk */
+	uint32_t flags;
+	uint32_t pad;
+	union lcol_val min;
+	union lcol_val max;
+};
+
+struct lcol_chunk_ftr {
+	char magic[8];		/* LCOL_FTR_MAGIC */
+	uint64_t ts_min;	/* usec */
+	uint64_t ts_max;	/* usec */
+	uint64_t ts_off;	/* timestamp block, from the start of the chunk */
+	uint32_t row_count;
+	uint32_t col_count;
+	struct lcol_col_stat cols[];
+};
+
+/** Bytes per element of \c type, 0 if \c type cannot be stored */
+size_t lcol_type_size(enum ldms_value_type type);
+
+/*
+ * Writer
+ */
+typedef struct lcol_writer_s *lcol_writer_t;
+
+/** Column definition given to lcol_writer_open() */
+struct lcol_col_def {
+	const char *name;
+	enum ldms_value_type type;
+	int array_len;		/* ignored for scalars */
+};
+
+/**
+ * \brief Open \c path for appending rows of the given schema.
+ *
+ * A new file is created with \c mode. An existing file is appended to if
+ * it was written for the same schema (names, types, array lengths and
+ * digest), after dropping an incomplete trailing chunk.
+ *
+ * \retval NULL with errno set on error; \c EEXIST means that \c path holds
+ *         a different schema.
+ */
+lcol_writer_t lcol_writer_open(const char *path, mode_t mode,
+			       const char *schema,
+			       const unsigned char *digest,
+			       int col_count, const struct lcol_col_def *cols,
+			       int chunk_rows);
+
+/**
+ * \brief Start a new row timestamped \c ts_usec.
+ *
+ * Set every column with lcol_writer_col() and finish with
+ * lcol_writer_row_end(). Columns that are not set are zero.
+ */
+void lcol_writer_row_begin(lcol_writer_t w, uint64_t ts_usec);
+
+/**
+ * Set column \c col of the current row. Arrays longer than the column are
+ * truncated, shorter ones are zero padded.
+ */
+void lcol_writer_col(lcol_writer_t w, int col, ldms_mval_t v, int array_len);
+
+/** Finish the row; writes the chunk out once it is full. */
+int lcol_writer_row_end(lcol_writer_t w);
+
+/** Write the rows of a partial chunk out. */
+int lcol_writer_flush(lcol_writer_t w);
+
+/**
+ * Flush and move on to a new file at \c path with the same schema. If
+ * \c path cannot be opened, the writer keeps writing to its current file
+ * and the error is returned; otherwise the result of the flush is.
+ */
+int lcol_writer_roll(lcol_writer_t w, const char *path, mode_t mode);
+
+/** Flush and close. */
+int lcol_writer_close(lcol_writer_t w);
+
+const char *lcol_writer_path(lcol_writer_t w);
+const unsigned char *lcol_writer_digest(lcol_writer_t w);
+/** Rows appended since the file was opened */
+uint64_t lcol_writer_rows(lcol_writer_t w);
+/** Bytes written to the file since it was opened */
+uint64_t lcol_writer_bytes(lcol_writer_t w);
+
+/*
+ * Reader
+ */
+typedef struct lcol_file_s *lcol_file_t;
+
+/**
+ * \brief Map the chunks of \c path that are complete at the time of the call.
+ * \retval NULL with errno set on error.
+ */
+lcol_file_t lcol_open(const char *path);
+void lcol_close(lcol_file_t f);
+
+const struct lcol_file_hdr *lcol_hdr(lcol_file_t f);
+const char *lcol_schema_name(lcol_file_t f);
+int lcol_col_count(lcol_file_t f);
+const struct lcol_col_desc *lcol_col(lcol_file_t f, int col);
+const char *lcol_col_name(lcol_file_t f, int col);
+/** Index of the column named \c name, or -1 */
+int lcol_col_find(lcol_file_t f, const char *name);
+
+int lcol_chunk_count(lcol_file_t f);
+const struct lcol_chunk_ftr *lcol_chunk(lcol_file_t f, int chunk);
+/** \c row_count timestamps (usec) of the chunk */
+const uint64_t *lcol_chunk_ts(lcol_file_t f, int chunk);
+/** \c row_count values of \c width bytes; the pages are only touched on use */
+const void *lcol_chunk_col(lcol_file_t f, int chunk, int col);
+
+/**
+ * Called by lcol_scan() for every row in range. A non-zero return stops
+ * the scan and is returned by lcol_scan().
+ */
+typedef int (*lcol_scan_fn_t)(lcol_file_t f, int chunk, int row, void *arg);
+
+/**
+ * \brief Call \c fn for every row with \c ts_begin <= ts < \c ts_end (usec).
+ *
+ * Chunks whose footer time range does not overlap are skipped, and only the
+ * timestamp block of the other chunks is read; the callback touches just
+ * the columns it asks for.
+ */
+int lcol_scan(lcol_file_t f, uint64_t ts_begin, uint64_t ts_end,
+	      lcol_scan_fn_t fn, void *arg);
+
+#endif
@@ -0,0 +1,358 @@
+/* -*- c-basic-offset: 8 -*-
+ * Copyright (c) 2026 National Technology & Engineering Solutions
+ * of Sandia, LLC (NTESS). Under the terms of Contract DE-NA0003525 with
+ * NTESS, the U.S. Government retains certain rights in this software.
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * ldms_columnar_query prints the rows of store_columnar files that fall in a
+ * time range as CSV. Only the timestamp block of the chunks overlapping the
+ * range and the blocks of the requested columns are read.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <getopt.h>
+#include "ldms_columnar.h"
+
+#define FMT "b:e:c:Hsh"
+
+static void usage(char *argv[])
+{
+	printf("%s [-b BEGIN] [-e END] [-c COL[,COL...]] [-H] [-s] FILE...\n"
+	       "    -b BEGIN  Print rows at or after BEGIN (seconds since the epoch).\n"
+	       "    -e END    Print rows before END (seconds since the epoch).\n"
+	       "    -c COLS   Comma-separated columns to print (default: all).\n"
+	       "    -H        Print a header line.\n"
+	       "    -s        Print the schema and the chunk footers instead of rows.\n",
+	       argv[0]);
+}
+
+static const char *type_names[] = {
+	[LDMS_V_CHAR]       = "char",
+	[LDMS_V_U8]         = "u8",
+	[LDMS_V_S8]         = "s8",
+	[LDMS_V_U16]        = "u16",
+	[LDMS_V_S16]        = "s16",
+	[LDMS_V_U32]        = "u32",
+	[LDMS_V_S32]        = "s32",
+	[LDMS_V_U64]        = "u64",
+	[LDMS_V_S64]        = "s64",
+	[LDMS_V_F32]        = "f32",
+	[LDMS_V_D64]        = "d64",
+	[LDMS_V_CHAR_ARRAY] = "char[]",
+	[LDMS_V_U8_ARRAY]   = "u8[]",
+	[LDMS_V_S8_ARRAY]   = "s8[]",
+	[LDMS_V_U16_ARRAY]  = "u16[]",
+	[LDMS_V_S16_ARRAY]  = "s16[]",
+	[LDMS_V_U32_ARRAY]  = "u32[]",
+	[LDMS_V_S32_ARRAY]  = "s32[]",
+	[LDMS_V_U64_ARRAY]  = "u64[]",
+	[LDMS_V_S64_ARRAY]  = "s64[]",
+	[LDMS_V_F32_ARRAY]  = "f32[]",
+	[LDMS_V_D64_ARRAY]  = "d64[]",
+	[LDMS_V_TIMESTAMP]  = "timestamp",
+};
+
+struct query {
+	int col_count;
+	int *cols;	/* column indices of the current file */
+	char **names;	/* requested names, NULL for all */
+	int name_count;
+};
+
+static void print_val(const struct lcol_col_desc *d, const void *p)
+{
+	const union ldms_value *v = p;
+	int i, n = d->array_len;
+
+	switch (d->type) {
+	case LDMS_V_CHAR:
+		printf("%c", v->v_char);
+		return;
+	case LDMS_V_CHAR_ARRAY:
+		printf("%.*s", n, v->a_char);
+		return;
+	case LDMS_V_TIMESTAMP:
+		printf("%"PRIu32".%06"PRIu32, v->v_ts.sec, v->v_ts.usec);
+		return;
+	default:
+		break;
+	}
+	if (n > 1 || d->type >= LDMS_V_CHAR_ARRAY)
+		printf("\"");
+	for (i = 0; i < n; i++) {
+		if (i)
+			printf(",");
+		switch (d->type) {
+		case LDMS_V_U8:
+		case LDMS_V_U8_ARRAY:
+			printf("%hhu", v->a_u8[i]);
+			break;
+		case LDMS_V_S8:
+		case LDMS_V_S8_ARRAY:
+			printf("%hhd", v->a_s8[i]);
+			break;
+		case LDMS_V_U16:
+		case LDMS_V_U16_ARRAY:
+			printf("%hu", v->a_u16[i]);
+			break;
+		case LDMS_V_S16:
+		case LDMS_V_S16_ARRAY:
+			printf("%hd", v->a_s16[i]);
+			break;
+		case LDMS_V_U32:
+		case LDMS_V_U32_ARRAY:
+			printf("%"PRIu32, v->a_u32[i]);
+			break;
+		case LDMS_V_S32:
+		case LDMS_V_S32_ARRAY:
+			printf("%"PRId32, v->a_s32[i]);
+			break;
+		case LDMS_V_U64:
+		case LDMS_V_U64_ARRAY:
+			printf("%"PRIu64, v->a_u64[i]);
+			break;
+		case LDMS_V_S64:
+		case LDMS_V_S64_ARRAY:
+			printf("%"PRId64, v->a_s64[i]);
+			break;
+		case LDMS_V_F32:
+		case LDMS_V_F32_ARRAY:
+			printf("%.9g", v->a_f[i]);
+			break;
+		case LDMS_V_D64:
+		case LDMS_V_D64_ARRAY:
+			printf("%.17g", v->a_d[i]);
+			break;
+		default:
+			break;
+		}
+	}
+	if (n > 1 || d->type >= LDMS_V_CHAR_ARRAY)
+		printf("\"");
+}
+
+static void print_stat(const struct lcol_col_desc *d, const union lcol_val *v)
+{
+	switch (d->type) {
+	case LDMS_V_S8: case LDMS_V_S8_ARRAY:
+	case LDMS_V_S16: case LDMS_V_S16_ARRAY:
+	case LDMS_V_S32: case LDMS_V_S32_ARRAY:
+	case LDMS_V_S64: case LDMS_V_S64_ARRAY:
+		printf("%"PRId64, v->i);
+		break;
+	case LDMS_V_F32: case LDMS_V_F32_ARRAY:
+	case LDMS_V_D64: case LDMS_V_D64_ARRAY:
+		printf("%.17g", v->d);
+		break;
+	default:
+		printf("%"PRIu64, v->u);
+		break;
+	}
+}
+
+static void print_summary(const char *path, lcol_file_t f)
+{
+	const struct lcol_chunk_ftr *ftr;
+	const struct lcol_col_desc *d;
+	int c, i;
+
+	printf("file: %s\nschema: %s\ncolumns:\n", path, lcol_schema_name(f));
+	for (i = 0; i < lcol_col_count(f); i++) {
+		d = lcol_col(f, i);
+		printf("  %d: %s %s", i, lcol_col_name(f, i),
+		       type_names[d->type]);
+		if (d->type >= LDMS_V_CHAR_ARRAY && d->type <= LDMS_V_D64_ARRAY)
+			printf(" array_len %u", d->array_len);
+		printf("\n");
+	}
+	for (c = 0; c < lcol_chunk_count(f); c++) {
+		ftr = lcol_chunk(f, c);
+		printf("chunk %d: rows %u ts %"PRIu64".%06"PRIu64
+		       " - %"PRIu64".%06"PRIu64"\n", c, ftr->row_count,
+		       ftr->ts_min / 1000000, ftr->ts_min % 1000000,
+		       ftr->ts_max / 1000000, ftr->ts_max % 1000000);
+		for (i = 0; i < lcol_col_count(f); i++) {
+			if (!(ftr->cols[i].flags & LCOL_STAT_MINMAX))
+				continue;
+			d = lcol_col(f, i);
+			printf("  %s: min ", lcol_col_name(f, i));
+			print_stat(d, &ftr->cols[i].min);
+			printf(" max ");
+			print_stat(d, &ftr->cols[i].max);
+			printf("\n");
+		}
+	}
+}
+
+static int print_row(lcol_file_t f, int chunk, int row, void *arg)
+{
+	struct query *q = arg;
+	const struct lcol_col_desc *d;
+	const uint8_t *p;
+	uint64_t ts = lcol_chunk_ts(f, chunk)[row];
+	int i;
+
+	printf("%"PRIu64".%06"PRIu64, ts / 1000000, ts % 1000000);
+	for (i = 0; i < q->col_count; i++) {
+		d = lcol_col(f, q->cols[i]);
+		p = lcol_chunk_col(f, chunk, q->cols[i]);
+		printf(",");
+		print_val(d, p + (size_t)row * d->width);
+	}
+	printf("\n");
+	return 0;
+}
+
+static int query_cols(lcol_file_t f, struct query *q)
+{
+	int i;
+
+	q->col_count = q->names ? q->name_count : lcol_col_count(f);
+	free(q->cols);
+	q->cols = calloc(q->col_count, sizeof(*q->cols));
+	if (!q->cols)
+		return ENOMEM;
+	for (i = 0; i < q->col_count; i++) {
+		if (!q->names) {
+			q->cols[i] = i;
+			continue;
+		}
+		q->cols[i] = lcol_col_find(f, q->names[i]);
+		if (q->cols[i] < 0) {
+			fprintf(stderr, "column '%s' not found\n", q->names[i]);
+			return ENOENT;
+		}
+	}
+	return 0;
+}
+
+static int split_names(char *str, struct query *q)
+{
+	char *tok, *ptr;
+
+	for (tok = strtok_r(str, ",", &ptr); tok;
+	     tok = strtok_r(NULL, ",", &ptr)) {
+		q->names = realloc(q->names, (q->name_count + 1) * sizeof(char *));
+		if (!q->names)
+			return ENOMEM;
+		q->names[q->name_count++] = tok;
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	uint64_t ts_begin = 0, ts_end = UINT64_MAX;
+	struct query q = {0};
+	int header = 0, summary = 0;
+	lcol_file_t f;
+	int op, i, j, rc = 0;
+
+	while ((op = getopt(argc, argv, FMT)) != -1) {
+		switch (op) {
+		case 'b':
+			ts_begin = strtod(optarg, NULL) * 1e6;
+			break;
+		case 'e':
+			ts_end = strtod(optarg, NULL) * 1e6;
+			break;
+		case 'c':
+			if (split_names(optarg, &q)) {
+				fprintf(stderr, "Out of memory\n");
+				return 1;
+			}
+			break;
+		case 'H':
+			header = 1;
+			break;
+		case 's':
+			summary = 1;
+			break;
+		default:
+			usage(argv);
+			return op == 'h' ? 0 : 1;
+		}
+	}
+	if (optind >= argc) {
+		usage(argv);
+		return 1;
+	}
+	for (i = optind; i < argc; i++) {
+		f = lcol_open(argv[i]);
+		if (!f) {
+			fprintf(stderr, "%s: cannot open: %s\n", argv[i],
+				strerror(errno));
+			rc = 1;
+			continue;
+		}
+		if (summary) {
+			print_summary(argv[i], f);
+			lcol_close(f);
+			continue;
+		}
+		if (query_cols(f, &q)) {
+			lcol_close(f);
+			rc = 1;
+			continue;
+		}
+		if (header) {
+			printf("#timestamp");
+			for (j = 0; j < q.col_count; j++)
+				printf(",%s", lcol_col_name(f, q.cols[j]));
+			printf("\n");
+			header = 0;
+		}
+		lcol_scan(f, ts_begin, ts_end, print_row, &q);
+		lcol_close(f);
+	}
+	free(q.cols);
+	free(q.names);
+	return rc;
+}
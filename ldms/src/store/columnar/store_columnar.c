@@ -0,0 +1,742 @@
+/* -*- c-basic-offset: 8 -*-
+ * Copyright (c) 2026 National Technology & Engineering Solutions
+ * of Sandia, LLC (NTESS). Under the terms of Contract DE-NA0003525 with
+ * NTESS, the U.S. Government retains certain rights in this software.
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * store_columnar writes the rows of a decomposition to columnar binary files
+ * (see ldms_columnar.h), one file per container and row schema:
+ *
+ *   <path>/<container>/<schema>[.<epoch>]
+ *
+ * The rows are buffered per file and written out one chunk at a time.
+ * Rollover follows store_csv: the same rolltype, rollover, rollagain and
+ * rollempty options, with the epoch of the roll appended to the file name.
+ */
+#define _GNU_SOURCE
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <limits.h>
+#include <assert.h>
+#include <coll/rbt.h>
+#include <ovis_util/util.h>
+#include "ldms.h"
+#include "ldmsd.h"
+#include "ldmsd_plug_api.h"
+#include "ldms_columnar.h"
+
+#define PNAME "store_columnar"
+
+static ovis_log_t mylog;
+
+#define LOG(LVL, FMT, ...) ovis_log(mylog, LVL, PNAME ": " FMT, ## __VA_ARGS__)
+#define LOG_ERROR(FMT, ...) LOG(OVIS_LERROR, FMT, ## __VA_ARGS__)
+#define LOG_INFO(FMT, ...) LOG(OVIS_LINFO, FMT, ## __VA_ARGS__)
+#define LOG_WARN(FMT, ...) LOG(OVIS_LWARNING, FMT, ## __VA_ARGS__)
+
+#define DEFAULT_CHUNK_ROWS 4096
+
+/* rollover, as in store_csv */
+#define MAXROLLTYPE 5
+#define MINROLLTYPE 1
+#define DEFAULT_ROLLTYPE -1
+#define MIN_ROLL_1 10
+#define MIN_ROLL_RECORDS 3
+#define MIN_ROLL_BYTES 1024
+#define ROLL_LIMIT_INTERVAL 60
+
+typedef struct store_columnar_s {
+	pthread_mutex_t lock;
+	char *path;
+	int chunk_rows;
+	int rollover;
+	int rollagain;
+	bool rollempty;
+	int rolltype;
+	pthread_t rothread;
+	int rothread_used;
+	struct rbt file_tree;	/* scol_file_t by key; protected by lock */
+} *store_columnar_t;
+
+/* An output file; shared by the strgps storing the same container/schema */
+typedef struct scol_file_s {
+	struct rbn rbn;
+	char *key;		/* <container>/<schema> */
+	char *base;		/* <path>/<container>/<schema> */
+	int ref_count;		/* protected by store_columnar_s.lock */
+	pthread_mutex_t lock;
+	lcol_writer_t w;
+	int col_count;
+	time_t otime;		/* time of the last roll */
+	int err_warned;
+} *scol_file_t;
+
+/* A row schema of a strgp, and the file its rows go to */
+typedef struct scol_ref_s {
+	struct rbn rbn;
+	scol_file_t f;
+	char name[OVIS_FLEX];
+} *scol_ref_t;
+
+/* strgp->store_handle */
+typedef struct scol_handle_s {
+	store_columnar_t sc;
+	struct rbt ref_tree;	/* scol_ref_t by row schema name */
+} *scol_handle_t;
+
+static int str_cmp(void *tree_key, const void *key)
+{
+	return strcmp(tree_key, key);
+}
+
+static const char *usage(ldmsd_plug_handle_t handle)
+{
+	return
+"    config name=" PNAME " path=<path> [chunk_rows=<N>]\n"
+"           [rolltype=<rolltype> rollover=<N> [rollagain=<N>] [rollempty=<0/1>]]\n"
+"         - Set the root path and options of the columnar store.\n"
+"         path        The root directory. Files are <path>/<container>/<schema>.\n"
+"         chunk_rows  Rows per chunk (default 4096).\n"
+"         rolltype    Same as store_csv:\n"
+"                     1: wake approximately every rollover seconds and roll.\n"
+"                     2: wake daily at rollover seconds after midnight (>=0) and roll.\n"
+"                     3: roll after approximately rollover records are written.\n"
+"                     4: roll after approximately rollover bytes are written.\n"
+"                     5: wake daily at rollover seconds after midnight and every rollagain seconds thereafter.\n"
+"         rollover    Rollover argument of the rolltype.\n"
+"         rollagain   Interval of rolltype 5 (> max(rollover, 10)).\n"
+"         rollempty   Also roll files that got no rows (default 0).\n"
+"\n"
+"    strgp_add name=<strgp> plugin=" PNAME " container=<container> \\\n"
+"              decomposition=<decomp.json>\n";
+}
+
+/* caller must hold f->lock */
+static void __file_roll(store_columnar_t sc, scol_file_t f, time_t appx)
+{
+	char *path;
+	int rc;
+
+	if (!f->w) {
+		/* nothing open; the next file is named after this roll */
+		f->otime = appx;
+		return;
+	}
+	switch (sc->rolltype) {
+	case 1:
+	case 2:
+	case 5:
+		if (!lcol_writer_rows(f->w) && !sc->rollempty)
+			return; /* skip rollover of empty files */
+		break;
+	case 3:
+		if (lcol_writer_rows(f->w) < sc->rollover)
+			return;
+		break;
+	case 4:
+		if (lcol_writer_bytes(f->w) < sc->rollover)
+			return;
+		break;
+	default:
+		return;
+	}
+	if (asprintf(&path, "%s.%ld", f->base, (long)appx) < 0) {
+		LOG_ERROR("Out of memory rolling '%s'\n", f->base);
+		return;
+	}
+	rc = lcol_writer_roll(f->w, path, LDMSD_DEFAULT_FILE_PERM);
+	if (rc)
+		LOG_ERROR("Error %d rolling '%s' over to '%s'\n", rc,
+			  lcol_writer_path(f->w), path);
+	else
+		f->otime = appx;
+	free(path);
+}
+
+static void handleRollover(store_columnar_t sc)
+{
+	struct rbn *rbn;
+	scol_file_t f;
+	time_t appx = time(NULL);
+
+	pthread_mutex_lock(&sc->lock);
+	RBT_FOREACH(rbn, &sc->file_tree) {
+		f = container_of(rbn, struct scol_file_s, rbn);
+		pthread_mutex_lock(&f->lock);
+		__file_roll(sc, f, appx);
+		pthread_mutex_unlock(&f->lock);
+	}
+	pthread_mutex_unlock(&sc->lock);
+}
+
+static int __sec_since_midnight(void)
+{
+	time_t rawtime;
+	struct tm info;
+
+	time(&rawtime);
+	localtime_r(&rawtime, &info);
+	return info.tm_hour*3600 + info.tm_min*60 + info.tm_sec;
+}
+
+static void *rolloverThreadInit(void *m)
+{
+	store_columnar_t sc = m;
+	int tsleep, s, oldstate;
+
+	while (1) {
+		switch (sc->rolltype) {
+		case 1:
+			tsleep = (sc->rollover < MIN_ROLL_1) ?
+				 MIN_ROLL_1 : sc->rollover;
+			break;
+		case 2:
+			tsleep = 86400 - __sec_since_midnight() + sc->rollover;
+			if (tsleep < MIN_ROLL_1) {
+				/* if we just did a roll then skip this one */
+				tsleep += 86400;
+			}
+			break;
+		case 3:
+			if (sc->rollover < MIN_ROLL_RECORDS)
+				sc->rollover = MIN_ROLL_RECORDS;
+			tsleep = ROLL_LIMIT_INTERVAL;
+			break;
+		case 4:
+			if (sc->rollover < MIN_ROLL_BYTES)
+				sc->rollover = MIN_ROLL_BYTES;
+			tsleep = ROLL_LIMIT_INTERVAL;
+			break;
+		case 5:
+			s = __sec_since_midnight();
+			if (s < sc->rollover) {
+				tsleep = sc->rollover - s;
+			} else {
+				tsleep = ((s - sc->rollover) / sc->rollagain + 1) *
+					 sc->rollagain + sc->rollover - s;
+			}
+			if (tsleep < MIN_ROLL_1)
+				tsleep += sc->rollagain;
+			break;
+		default:
+			tsleep = 60;
+			break;
+		}
+		sleep(tsleep);
+		pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &oldstate);
+		handleRollover(sc);
+		pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &oldstate);
+	}
+	return NULL;
+}
+
+static int __int_value(struct attr_value_list *avl, const char *name,
+		       int *out)
+{
+	char *value, *end;
+	long v;
+
+	value = av_value(avl, name);
+	if (!value)
+		return ENOENT;
+	errno = 0;
+	v = strtol(value, &end, 0);
+	if (errno || end == value || *end || v < INT_MIN || v > INT_MAX) {
+		LOG_ERROR("improper %s= input '%s'.\n", name, value);
+		return EINVAL;
+	}
+	*out = v;
+	return 0;
+}
+
+static int config(ldmsd_plug_handle_t handle, struct attr_value_list *kwl,
+		  struct attr_value_list *avl)
+{
+	store_columnar_t sc = ldmsd_plug_ctxt_get(handle);
+	int rollmethod = DEFAULT_ROLLTYPE;
+	int roll = -1, ragain = 0, rows = DEFAULT_CHUNK_ROWS;
+	char *value;
+	int rc;
+
+	pthread_mutex_lock(&sc->lock);
+	if (sc->path) {
+		LOG_ERROR("reconfiguration is not supported\n");
+		rc = EINVAL;
+		goto out;
+	}
+	value = av_value(avl, "path");
+	if (!value) {
+		LOG_ERROR("path= is required\n");
+		rc = EINVAL;
+		goto out;
+	}
+
+	rc = __int_value(avl, "chunk_rows", &rows);
+	if (rc == EINVAL)
+		goto out;
+	if (rows <= 0) {
+		LOG_ERROR("bad chunk_rows= value %d\n", rows);
+		rc = EINVAL;
+		goto out;
+	}
+	rc = __int_value(avl, "rollagain", &ragain);
+	if (rc == EINVAL)
+		goto out;
+	if (ragain < 0) {
+		LOG_ERROR("bad rollagain= value %d\n", ragain);
+		rc = EINVAL;
+		goto out;
+	}
+	rc = __int_value(avl, "rollover", &roll);
+	if (rc == EINVAL)
+		goto out;
+	if (!rc && roll < 0) {
+		LOG_ERROR("bad rollover= value %d\n", roll);
+		rc = EINVAL;
+		goto out;
+	}
+	rc = __int_value(avl, "rolltype", &rollmethod);
+	if (rc == EINVAL)
+		goto out;
+	if (!rc) {
+		if (roll < 0) {
+			/* rolltype not valid without rollover also */
+			LOG_ERROR("rolltype given without rollover.\n");
+			rc = EINVAL;
+			goto out;
+		}
+		if (rollmethod < MINROLLTYPE || rollmethod > MAXROLLTYPE) {
+			LOG_ERROR("rolltype out of range.\n");
+			rc = EINVAL;
+			goto out;
+		}
+		if (rollmethod == 5 && (ragain < roll || ragain < MIN_ROLL_1)) {
+			LOG_ERROR("rolltype=5 needs rollagain > max(rollover,10); "
+				  "rollagain=%d rollover=%d\n", ragain, roll);
+			rc = EINVAL;
+			goto out;
+		}
+	}
+	value = av_value(avl, "rollempty");
+	if (value)
+		sc->rollempty = !!atoi(value);
+
+	sc->path = strdup(av_value(avl, "path"));
+	if (!sc->path) {
+		rc = ENOMEM;
+		goto out;
+	}
+	sc->chunk_rows = rows;
+	sc->rollover = roll;
+	sc->rollagain = ragain;
+	rc = 0;
+	if (rollmethod >= MINROLLTYPE) {
+		sc->rolltype = rollmethod;
+		rc = pthread_create(&sc->rothread, NULL, rolloverThreadInit, sc);
+		if (rc)
+			LOG_ERROR("cannot start the rollover thread: %d\n", rc);
+		else
+			sc->rothread_used = 1;
+	}
+ out:
+	pthread_mutex_unlock(&sc->lock);
+	return rc;
+}
+
+/* caller must hold f->lock */
+static int __file_open(store_columnar_t sc, scol_file_t f, ldmsd_row_t row)
+{
+	struct lcol_col_def *defs;
+	char *path = NULL;
+	int i, rc;
+
+	defs = calloc(row->col_count, sizeof(*defs));
+	if (!defs)
+		return ENOMEM;
+	for (i = 0; i < row->col_count; i++) {
+		defs[i].name = row->cols[i].name;
+		defs[i].type = row->cols[i].type;
+		defs[i].array_len = row->cols[i].array_len;
+	}
+	if (sc->rolltype >= MINROLLTYPE)
+		rc = asprintf(&path, "%s.%ld", f->base, (long)f->otime);
+	else
+		rc = asprintf(&path, "%s", f->base);
+	if (rc < 0) {
+		path = NULL;
+		rc = ENOMEM;
+		goto out;
+	}
+	f->w = lcol_writer_open(path, LDMSD_DEFAULT_FILE_PERM, row->schema_name,
+				row->schema_digest ?
+				row->schema_digest->digest : NULL,
+				row->col_count, defs, sc->chunk_rows);
+	if (!f->w && errno == EEXIST) {
+		/* the file holds another schema; start a new one next to it */
+		LOG_INFO("'%s' holds another version of schema '%s'\n",
+			 path, row->schema_name);
+		free(path);
+		f->otime = time(NULL);
+		if (asprintf(&path, "%s.%ld", f->base, (long)f->otime) < 0) {
+			path = NULL;
+			rc = ENOMEM;
+			goto out;
+		}
+		f->w = lcol_writer_open(path, LDMSD_DEFAULT_FILE_PERM,
+					row->schema_name,
+					row->schema_digest ?
+					row->schema_digest->digest : NULL,
+					row->col_count, defs, sc->chunk_rows);
+	}
+	if (!f->w) {
+		rc = errno;
+		if (!f->err_warned) {
+			LOG_ERROR("cannot open '%s' for schema '%s': %d\n",
+				  path, row->schema_name, rc);
+			f->err_warned = 1;
+		}
+		goto out;
+	}
+	f->col_count = row->col_count;
+	f->err_warned = 0;
+	rc = 0;
+ out:
+	free(path);
+	free(defs);
+	return rc;
+}
+
+/* caller must hold f->lock */
+static int __file_row_write(store_columnar_t sc, scol_file_t f,
+			    uint64_t ts_usec, ldmsd_row_t row)
+{
+	int i, rc;
+
+	if (f->w && (f->col_count != row->col_count ||
+		     (row->schema_digest &&
+		      memcmp(lcol_writer_digest(f->w), row->schema_digest->digest,
+			     LCOL_DIGEST_LEN)))) {
+		/* the row schema changed; it goes to a new file */
+		rc = lcol_writer_close(f->w);
+		if (rc)
+			LOG_ERROR("Error %d closing '%s'\n", rc, f->base);
+		f->w = NULL;
+		f->otime = time(NULL);
+	}
+	if (!f->w) {
+		rc = __file_open(sc, f, row);
+		if (rc)
+			return rc;
+	}
+	lcol_writer_row_begin(f->w, ts_usec);
+	for (i = 0; i < row->col_count; i++)
+		lcol_writer_col(f->w, i, row->cols[i].mval,
+				row->cols[i].array_len);
+	rc = lcol_writer_row_end(f->w);
+	if (rc)
+		LOG_ERROR("Error %d writing to '%s'\n", rc,
+			  lcol_writer_path(f->w));
+	return rc;
+}
+
+/* caller must hold sc->lock */
+static scol_file_t __file_get(store_columnar_t sc, const char *container,
+			      const char *schema)
+{
+	struct rbn *rbn;
+	scol_file_t f;
+	char *dir = NULL;
+	int rc;
+
+	f = calloc(1, sizeof(*f));
+	if (!f)
+		return NULL;
+	if (asprintf(&f->key, "%s/%s", container, schema) < 0) {
+		f->key = NULL;
+		goto err;
+	}
+	rbn = rbt_find(&sc->file_tree, f->key);
+	if (rbn) {
+		free(f->key);
+		free(f);
+		f = container_of(rbn, struct scol_file_s, rbn);
+		f->ref_count++;
+		return f;
+	}
+	if (asprintf(&dir, "%s/%s", sc->path, container) < 0) {
+		dir = NULL;
+		goto err;
+	}
+	rc = f_mkdir_p(dir, 0777);
+	if (rc && rc != EEXIST) {
+		LOG_ERROR("cannot create directory '%s': %d\n", dir, rc);
+		errno = rc;
+		goto err;
+	}
+	if (asprintf(&f->base, "%s/%s", dir, schema) < 0) {
+		f->base = NULL;
+		goto err;
+	}
+	free(dir);
+	pthread_mutex_init(&f->lock, NULL);
+	f->otime = time(NULL);
+	f->ref_count = 1;
+	rbn_init(&f->rbn, f->key);
+	rbt_ins(&sc->file_tree, &f->rbn);
+	return f;
+ err:
+	free(dir);
+	free(f->base);
+	free(f->key);
+	free(f);
+	return NULL;
+}
+
+/* caller must hold sc->lock */
+static void __file_put(store_columnar_t sc, scol_file_t f)
+{
+	int rc;
+
+	assert(f->ref_count > 0);
+	if (--f->ref_count)
+		return;
+	rbt_del(&sc->file_tree, &f->rbn);
+	if (f->w) {
+		rc = lcol_writer_close(f->w);
+		if (rc)
+			LOG_ERROR("Error %d closing '%s'\n", rc, f->base);
+	}
+	pthread_mutex_destroy(&f->lock);
+	free(f->base);
+	free(f->key);
+	free(f);
+}
+
+/* protected by strgp->lock */
+static scol_file_t __ref_file(scol_handle_t sh, ldmsd_strgp_t strgp,
+			      const char *schema)
+{
+	store_columnar_t sc = sh->sc;
+	struct rbn *rbn;
+	scol_ref_t ref;
+
+	rbn = rbt_find(&sh->ref_tree, schema);
+	if (rbn)
+		return container_of(rbn, struct scol_ref_s, rbn)->f;
+	ref = calloc(1, sizeof(*ref) + strlen(schema) + 1);
+	if (!ref)
+		return NULL;
+	strcpy(ref->name, schema);
+	pthread_mutex_lock(&sc->lock);
+	ref->f = __file_get(sc, strgp->container, schema);
+	pthread_mutex_unlock(&sc->lock);
+	if (!ref->f) {
+		free(ref);
+		return NULL;
+	}
+	rbn_init(&ref->rbn, ref->name);
+	rbt_ins(&sh->ref_tree, &ref->rbn);
+	return ref->f;
+}
+
+/* protected by strgp->lock */
+static int
+commit_rows(ldmsd_plug_handle_t handle, ldmsd_strgp_t strgp, ldms_set_t set,
+	    ldmsd_row_list_t row_list, int row_count)
+{
+	store_columnar_t sc = ldmsd_plug_ctxt_get(handle);
+	struct ldms_timestamp ts = ldms_transaction_timestamp_get(set);
+	uint64_t ts_usec = (uint64_t)ts.sec * 1000000 + ts.usec;
+	scol_handle_t sh;
+	scol_file_t f;
+	ldmsd_row_t row;
+
+	if (!sc->path) {
+		LOG_ERROR("config not called. cannot store.\n");
+		return EINVAL;
+	}
+	sh = strgp->store_handle;
+	if (!sh) {
+		sh = calloc(1, sizeof(*sh));
+		if (!sh)
+			return ENOMEM;
+		sh->sc = sc;
+		rbt_init(&sh->ref_tree, str_cmp);
+		strgp->store_handle = sh;
+	}
+	TAILQ_FOREACH(row, row_list, entry) {
+		f = __ref_file(sh, strgp, row->schema_name);
+		if (!f) {
+			LOG_ERROR("cannot get the file of '%s/%s': %d\n",
+				  strgp->container, row->schema_name, errno);
+			continue;
+		}
+		pthread_mutex_lock(&f->lock);
+		(void)__file_row_write(sc, f, ts_usec, row);
+		pthread_mutex_unlock(&f->lock);
+	}
+	return 0;
+}
+
+static int flush_store(ldmsd_plug_handle_t handle, ldmsd_store_handle_t _sh)
+{
+	scol_handle_t sh = _sh;
+	struct rbn *rbn;
+	scol_file_t f;
+	int rc, ret = 0;
+
+	if (!sh)
+		return 0;
+	RBT_FOREACH(rbn, &sh->ref_tree) {
+		f = container_of(rbn, struct scol_ref_s, rbn)->f;
+		pthread_mutex_lock(&f->lock);
+		if (f->w) {
+			rc = lcol_writer_flush(f->w);
+			if (rc) {
+				LOG_ERROR("Error %d writing to '%s'\n", rc,
+					  lcol_writer_path(f->w));
+				ret = rc;
+			}
+		}
+		pthread_mutex_unlock(&f->lock);
+	}
+	return ret;
+}
+
+static void close_store(ldmsd_plug_handle_t handle, ldmsd_store_handle_t _sh)
+{
+	store_columnar_t sc = ldmsd_plug_ctxt_get(handle);
+	scol_handle_t sh = _sh;
+	struct rbn *rbn;
+	scol_ref_t ref;
+
+	if (!sh)
+		return;
+	pthread_mutex_lock(&sc->lock);
+	while ((rbn = rbt_min(&sh->ref_tree))) {
+		rbt_del(&sh->ref_tree, rbn);
+		ref = container_of(rbn, struct scol_ref_s, rbn);
+		__file_put(sc, ref->f);
+		free(ref);
+	}
+	pthread_mutex_unlock(&sc->lock);
+	free(sh);
+}
+
+static int constructor(ldmsd_plug_handle_t handle)
+{
+	store_columnar_t sc;
+
+	sc = calloc(1, sizeof(*sc));
+	if (!sc) {
+		ovis_log(NULL, OVIS_LERROR,
+			 "Failed to allocate context in plugin " PNAME ": %d\n",
+			 errno);
+		return ENOMEM;
+	}
+	pthread_mutex_init(&sc->lock, NULL);
+	rbt_init(&sc->file_tree, str_cmp);
+	sc->rolltype = DEFAULT_ROLLTYPE;
+	sc->chunk_rows = DEFAULT_CHUNK_ROWS;
+	ldmsd_plug_ctxt_set(handle, sc);
+	return 0;
+}
+
+static void destructor(ldmsd_plug_handle_t handle)
+{
+	store_columnar_t sc = ldmsd_plug_ctxt_get(handle);
+	struct rbn *rbn;
+	scol_file_t f;
+
+	if (sc->rothread_used) {
+		pthread_cancel(sc->rothread);
+		pthread_join(sc->rothread, NULL);
+	}
+	/* the strgps have closed their handles; this is for the stragglers */
+	pthread_mutex_lock(&sc->lock);
+	while ((rbn = rbt_min(&sc->file_tree))) {
+		f = container_of(rbn, struct scol_file_s, rbn);
+		f->ref_count = 1;
+		__file_put(sc, f);
+	}
+	pthread_mutex_unlock(&sc->lock);
+	pthread_mutex_destroy(&sc->lock);
+	free(sc->path);
+	free(sc);
+}
+
+static struct ldmsd_store store_columnar = {
+	.base.type   = LDMSD_PLUGIN_STORE,
+	.base.flags  = LDMSD_PLUGIN_MULTI_INSTANCE,
+	.base.name   = PNAME,
+	.base.config = config,
+	.base.usage  = usage,
+	.base.constructor = constructor,
+	.base.destructor = destructor,
+	.flush       = flush_store,
+	.close       = close_store,
+	.commit      = commit_rows,
+};
+
+struct ldmsd_plugin *get_plugin()
+{
+	int rc;
+	mylog = ovis_log_register("store."PNAME, "The log subsystem of '" PNAME "' plugin");
+	if (!mylog) {
+		rc = errno;
+		ovis_log(NULL, OVIS_LWARN, "Failed to create the log subsystem "
+				"of '" PNAME "' plugin. Error %d\n", rc);
+	}
+	return &store_columnar.base;
+}
@@ -0,0 +1,254 @@
+/* -*- c-basic-offset: 8 -*-
+ * Copyright (c) 2026 National Technology & Engineering Solutions
+ * of Sandia, LLC (NTESS). Under the terms of Contract DE-NA0003525 with
+ * NTESS, the U.S. Government retains certain rights in this software.
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * Round trip of the columnar file format: write rows of several column
+ * types across a few chunks, reopen the file for appending, cut the last
+ * chunk short, and check what the reader gets back.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "ldms_columnar.h"
+
+#define CHUNK_ROWS 64
+#define ARRAY_LEN 3
+#define TS0 1700000000000000ULL
+
+#define TEST(cond) do { \
+	if (!(cond)) { \
+		printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+		exit(1); \
+	} \
+} while (0)
+
+static const struct lcol_col_def cols[] = {
+	{ "component_id", LDMS_V_U64 },
+	{ "delta", LDMS_V_S32 },
+	{ "load", LDMS_V_D64 },
+	{ "cpu", LDMS_V_U16_ARRAY, ARRAY_LEN },
+	{ "name", LDMS_V_CHAR_ARRAY, 8 },
+	{ "stamp", LDMS_V_TIMESTAMP },
+};
+#define COL_COUNT (sizeof(cols) / sizeof(cols[0]))
+
+static const unsigned char digest[LCOL_DIGEST_LEN] = { 1, 2, 3 };
+
+static void write_rows(lcol_writer_t w, int first, int count)
+{
+	union ldms_value v;
+	uint16_t cpu[ARRAY_LEN];
+	char name[16];
+	int r, j;
+
+	for (r = first; r < first + count; r++) {
+		lcol_writer_row_begin(w, TS0 + r * 1000000ULL);
+		v.v_u64 = r % 10;
+		lcol_writer_col(w, 0, &v, 1);
+		v.v_s32 = 50 - r;
+		lcol_writer_col(w, 1, &v, 1);
+		v.v_d = r / 4.0;
+		lcol_writer_col(w, 2, &v, 1);
+		for (j = 0; j < ARRAY_LEN; j++)
+			cpu[j] = r + j;
+		/* every other row is one element short */
+		lcol_writer_col(w, 3, (void *)cpu, ARRAY_LEN - (r & 1));
+		snprintf(name, sizeof(name), "node%05d", r);
+		lcol_writer_col(w, 4, (void *)name, strlen(name) + 1);
+		v.v_ts.sec = r;
+		v.v_ts.usec = 7;
+		lcol_writer_col(w, 5, &v, 1);
+		TEST(0 == lcol_writer_row_end(w));
+	}
+}
+
+struct check {
+	int rows;
+	int next;
+};
+
+static int check_row(lcol_file_t f, int chunk, int row, void *arg)
+{
+	struct check *c = arg;
+	const uint64_t *ts = lcol_chunk_ts(f, chunk);
+	const uint16_t *cpu;
+	const struct ldms_timestamp *stamp;
+	int r = (ts[row] - TS0) / 1000000;
+	char name[16];
+
+	TEST(r == c->next);
+	TEST(((const uint64_t *)lcol_chunk_col(f, chunk, 0))[row] == r % 10);
+	TEST(((const int32_t *)lcol_chunk_col(f, chunk, 1))[row] == 50 - r);
+	TEST(((const double *)lcol_chunk_col(f, chunk, 2))[row] == r / 4.0);
+	cpu = (const uint16_t *)lcol_chunk_col(f, chunk, 3) + row * ARRAY_LEN;
+	TEST(cpu[0] == r && cpu[1] == r + 1);
+	TEST(cpu[2] == ((r & 1) ? 0 : r + 2));
+	/* "node%05d" is truncated to the 8 characters of the column */
+	snprintf(name, sizeof(name), "node%05d", r);
+	TEST(0 == memcmp((const char *)lcol_chunk_col(f, chunk, 4) + row * 8,
+			 name, 8));
+	stamp = (const struct ldms_timestamp *)lcol_chunk_col(f, chunk, 5) + row;
+	TEST(stamp->sec == r && stamp->usec == 7);
+	c->rows++;
+	c->next++;
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	char path[] = "/tmp/test_columnar.XXXXXX";
+	char path2[sizeof(path) + 8];
+	const struct lcol_chunk_ftr *ftr;
+	struct lcol_col_def other[COL_COUNT];
+	struct check c = {0};
+	lcol_writer_t w;
+	lcol_file_t f;
+	int fd;
+
+	fd = mkstemp(path);
+	TEST(fd >= 0);
+	close(fd);
+	snprintf(path2, sizeof(path2), "%s.rolled", path);
+
+	/* 2 full chunks and a partial one */
+	w = lcol_writer_open(path, 0600, "test", digest, COL_COUNT, cols,
+			     CHUNK_ROWS);
+	TEST(w);
+	write_rows(w, 0, 2 * CHUNK_ROWS + 10);
+	TEST(lcol_writer_rows(w) == 2 * CHUNK_ROWS + 10);
+	TEST(0 == lcol_writer_close(w));
+
+	/* appending takes the same schema only */
+	memcpy(other, cols, sizeof(other));
+	other[3].array_len = ARRAY_LEN + 1;
+	w = lcol_writer_open(path, 0600, "test", digest, COL_COUNT, other,
+			     CHUNK_ROWS);
+	TEST(!w && errno == EEXIST);
+	w = lcol_writer_open(path, 0600, "test", digest, COL_COUNT, cols,
+			     CHUNK_ROWS);
+	TEST(w);
+	write_rows(w, 2 * CHUNK_ROWS + 10, 20);
+	TEST(0 == lcol_writer_close(w));
+
+	/* a torn chunk at the end is ignored by the reader ... */
+	fd = open(path, O_WRONLY | O_APPEND);
+	TEST(fd >= 0);
+	TEST(write(fd, "LCOLCHK\0garbage", 16) == 16);
+	close(fd);
+
+	f = lcol_open(path);
+	TEST(f);
+	TEST(0 == strcmp(lcol_schema_name(f), "test"));
+	TEST(lcol_col_count(f) == COL_COUNT);
+	TEST(lcol_col_find(f, "cpu") == 3);
+	TEST(lcol_col_find(f, "nope") == -1);
+	TEST(lcol_col(f, 3)->width == ARRAY_LEN * sizeof(uint16_t));
+	TEST(0 == memcmp(lcol_hdr(f)->digest, digest, sizeof(digest)));
+	TEST(lcol_chunk_count(f) == 4);
+
+	ftr = lcol_chunk(f, 0);
+	TEST(ftr->row_count == CHUNK_ROWS);
+	TEST(ftr->ts_min == TS0 && ftr->ts_max == TS0 + (CHUNK_ROWS - 1) * 1000000ULL);
+	TEST(ftr->cols[0].flags & LCOL_STAT_MINMAX);
+	TEST(ftr->cols[0].min.u == 0 && ftr->cols[0].max.u == 9);
+	TEST(ftr->cols[1].min.i == 50 - (CHUNK_ROWS - 1) && ftr->cols[1].max.i == 50);
+	TEST(ftr->cols[2].min.d == 0 && ftr->cols[2].max.d == (CHUNK_ROWS - 1) / 4.0);
+	TEST(ftr->cols[3].min.u == 0 && ftr->cols[3].max.u == CHUNK_ROWS);
+	TEST(!(ftr->cols[4].flags & LCOL_STAT_MINMAX));
+	TEST(ftr->cols[5].max.u == (CHUNK_ROWS - 1) * 1000000ULL + 7);
+	TEST(lcol_chunk(f, 2)->row_count == 10);
+	TEST(lcol_chunk(f, 3)->row_count == 20);
+
+	/* all rows, then a range inside the second chunk */
+	TEST(0 == lcol_scan(f, 0, UINT64_MAX, check_row, &c));
+	TEST(c.rows == 2 * CHUNK_ROWS + 30);
+	c.rows = 0;
+	c.next = CHUNK_ROWS + 5;
+	TEST(0 == lcol_scan(f, TS0 + (CHUNK_ROWS + 5) * 1000000ULL,
+			    TS0 + (CHUNK_ROWS + 15) * 1000000ULL, check_row, &c));
+	TEST(c.rows == 10);
+	lcol_close(f);
+
+	/* ... and dropped by the next writer */
+	w = lcol_writer_open(path, 0600, "test", digest, COL_COUNT, cols,
+			     CHUNK_ROWS);
+	TEST(w);
+	write_rows(w, 2 * CHUNK_ROWS + 30, 1);
+	TEST(0 == lcol_writer_roll(w, path2, 0600));
+	TEST(0 == strcmp(lcol_writer_path(w), path2));
+	TEST(lcol_writer_rows(w) == 0);
+	write_rows(w, 2 * CHUNK_ROWS + 31, 1);
+	TEST(0 == lcol_writer_close(w));
+
+	f = lcol_open(path);
+	TEST(f);
+	TEST(lcol_chunk_count(f) == 5);
+	c.rows = c.next = 0;
+	TEST(0 == lcol_scan(f, 0, UINT64_MAX, check_row, &c));
+	TEST(c.rows == 2 * CHUNK_ROWS + 31);
+	lcol_close(f);
+
+	f = lcol_open(path2);
+	TEST(f);
+	TEST(lcol_chunk_count(f) == 1);
+	c.rows = 0;
+	c.next = 2 * CHUNK_ROWS + 31;
+	TEST(0 == lcol_scan(f, 0, UINT64_MAX, check_row, &c));
+	TEST(c.rows == 1);
+	lcol_close(f);
+
+	unlink(path);
+	unlink(path2);
+	printf("PASSED\n");
+	return 0;
+}
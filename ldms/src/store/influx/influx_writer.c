@@ -0,0 +1,651 @@
+/* -*- c-basic-offset: 8 -*-
+ * Copyright (c) 2026 National Technology & Engineering Solutions
+ * of Sandia, LLC (NTESS). Under the terms of Contract DE-NA0003525 with
+ * NTESS, the U.S. Government retains certain rights in this software.
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/queue.h>
+#include <curl/curl.h>
+#include <zlib.h>
+#include "influx_writer.h"
+
+#define IW_POLL_MAX_MS		1000
+#define IW_POST_TIMEOUT_MS	30000
+
+struct iw_batch {
+	struct influx_writer_s *w;
+	char *data;		/* the POST body, gzip'ed if cfg.gzip */
+	size_t len;
+	size_t raw_len;		/* the bytes of lines in the batch */
+	uint64_t lines;
+	int attempts;
+	uint64_t due_us;	/* when to retry */
+	CURL *easy;
+	TAILQ_ENTRY(iw_batch) entry;
+};
+TAILQ_HEAD(iw_batch_tq, iw_batch);
+
+struct influx_writer_s {
+	char *url;
+	struct influx_writer_cfg cfg;
+	ovis_log_t log;
+	struct curl_slist *headers;
+	int ref;		/* protected by iw.lock */
+	int closing;		/* protected by iw.lock */
+
+	pthread_mutex_t lock;	/* protects the fields below */
+	char *buf;
+	size_t len;
+	size_t cap;
+	uint64_t buf_lines;
+	uint64_t first_us;	/* when the oldest line in buf was appended */
+	int flush_req;
+	int full;		/* dropping lines */
+	size_t unsent;		/* bytes cut from buf and not posted yet */
+	struct influx_writer_stats stats;
+
+	/* used by the writer thread only */
+	int batches;		/* batches of the writer in any state */
+	struct iw_batch_tq retry_q;
+	LIST_ENTRY(influx_writer_s) entry;
+};
+
+static struct {
+	pthread_mutex_t lock;
+	LIST_HEAD(, influx_writer_s) writers;
+	int started;
+	int stopping;
+	pthread_cond_t stopped;	/* signaled when stopping is cleared */
+	uint64_t deadline_us;
+	pthread_t thread;
+	int wake_fd[2];
+	int woken;
+	CURLM *multi;
+	struct iw_batch_tq inflight;	/* writer thread only */
+} iw = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.stopped = PTHREAD_COND_INITIALIZER,
+	.wake_fd = { -1, -1 },
+};
+
+static uint64_t iw_now_us(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static void iw_wake(void)
+{
+	ssize_t rc;
+	if (__atomic_exchange_n(&iw.woken, 1, __ATOMIC_SEQ_CST))
+		return; /* already pending */
+	rc = write(iw.wake_fd[1], "", 1);
+	(void)rc;
+}
+
+static size_t iw_discard(char *ptr, size_t sz, size_t n, void *arg)
+{
+	return sz * n;
+}
+
+static void iw_batch_free(struct iw_batch *b)
+{
+	b->w->batches--;
+	if (b->easy)
+		curl_easy_cleanup(b->easy);
+	free(b->data);
+	free(b);
+}
+
+/* Account the lines of a batch that will not be posted */
+static void iw_batch_drop(struct iw_batch *b)
+{
+	struct influx_writer_s *w = b->w;
+	pthread_mutex_lock(&w->lock);
+	w->stats.dropped += b->lines;
+	w->unsent -= b->raw_len;
+	pthread_mutex_unlock(&w->lock);
+	iw_batch_free(b);
+}
+
+static int iw_gzip(struct iw_batch *b)
+{
+	z_stream zs = {0};
+	uLong sz;
+	char *out;
+	int rc;
+
+	rc = deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+			  15 + 16 /* gzip header */, 8, Z_DEFAULT_STRATEGY);
+	if (rc != Z_OK)
+		return ENOMEM;
+	sz = deflateBound(&zs, b->len);
+	out = malloc(sz);
+	if (!out) {
+		deflateEnd(&zs);
+		return ENOMEM;
+	}
+	zs.next_in = (Bytef *)b->data;
+	zs.avail_in = b->len;
+	zs.next_out = (Bytef *)out;
+	zs.avail_out = sz;
+	rc = deflate(&zs, Z_FINISH);
+	deflateEnd(&zs);
+	if (rc != Z_STREAM_END) {
+		free(out);
+		return EIO;
+	}
+	free(b->data);
+	b->data = out;
+	b->len = zs.total_out;
+	return 0;
+}
+
+static void iw_batch_start(struct iw_batch *b)
+{
+	struct influx_writer_s *w = b->w;
+	int rc;
+
+	if (!b->easy) {
+		/* first attempt */
+		if (w->cfg.gzip) {
+			rc = iw_gzip(b);
+			if (rc) {
+				ovis_log(w->log, OVIS_LERROR, "influx: cannot gzip "
+					 "%lu lines for %s, error %d; the lines "
+					 "are dropped.\n",
+					 (unsigned long)b->lines, w->url, rc);
+				iw_batch_drop(b);
+				return;
+			}
+		}
+		b->easy = curl_easy_init();
+		if (!b->easy)
+			goto err;
+		curl_easy_setopt(b->easy, CURLOPT_URL, w->url);
+		curl_easy_setopt(b->easy, CURLOPT_HTTPHEADER, w->headers);
+		curl_easy_setopt(b->easy, CURLOPT_POSTFIELDS, b->data);
+		curl_easy_setopt(b->easy, CURLOPT_POSTFIELDSIZE_LARGE,
+				 (curl_off_t)b->len);
+		curl_easy_setopt(b->easy, CURLOPT_WRITEFUNCTION, iw_discard);
+		curl_easy_setopt(b->easy, CURLOPT_TIMEOUT_MS, IW_POST_TIMEOUT_MS);
+		curl_easy_setopt(b->easy, CURLOPT_NOSIGNAL, 1L);
+		curl_easy_setopt(b->easy, CURLOPT_PRIVATE, b);
+	}
+	if (curl_multi_add_handle(iw.multi, b->easy) != CURLM_OK)
+		goto err;
+	b->attempts++;
+	TAILQ_INSERT_TAIL(&iw.inflight, b, entry);
+	return;
+ err:
+	ovis_log(w->log, OVIS_LERROR, "influx: cannot start the POST to %s; "
+		 "%lu lines are dropped.\n", w->url, (unsigned long)b->lines);
+	iw_batch_drop(b);
+}
+
+static void iw_batch_done(struct iw_batch *b, CURLcode result)
+{
+	struct influx_writer_s *w = b->w;
+	long code = 0;
+	int retry;
+
+	curl_easy_getinfo(b->easy, CURLINFO_RESPONSE_CODE, &code);
+	curl_multi_remove_handle(iw.multi, b->easy);
+	TAILQ_REMOVE(&iw.inflight, b, entry);
+
+	if (result == CURLE_OK && code >= 200 && code < 300) {
+		pthread_mutex_lock(&w->lock);
+		w->stats.posts++;
+		w->unsent -= b->raw_len;
+		pthread_mutex_unlock(&w->lock);
+		iw_batch_free(b);
+		return;
+	}
+	/* 4xx other than 429 means the request itself is bad */
+	retry = (result != CURLE_OK || code == 429 || code >= 500);
+	if (retry && b->attempts <= w->cfg.max_retries) {
+		b->due_us = iw_now_us() + (w->cfg.retry_us << (b->attempts - 1));
+		TAILQ_INSERT_TAIL(&w->retry_q, b, entry);
+		pthread_mutex_lock(&w->lock);
+		w->stats.retries++;
+		pthread_mutex_unlock(&w->lock);
+		return;
+	}
+	if (result != CURLE_OK)
+		ovis_log(w->log, OVIS_LERROR, "influx: POST to %s failed: %s; "
+			 "%lu lines are dropped.\n", w->url,
+			 curl_easy_strerror(result), (unsigned long)b->lines);
+	else
+		ovis_log(w->log, OVIS_LERROR, "influx: POST to %s failed: "
+			 "HTTP %ld; %lu lines are dropped.\n", w->url, code,
+			 (unsigned long)b->lines);
+	iw_batch_drop(b);
+}
+
+/*
+ * Cut the buffered lines of \c w into a batch if they are due.
+ * Called with iw.lock held.
+ */
+static void iw_cut(struct influx_writer_s *w, uint64_t now, int stopping,
+		   struct iw_batch_tq *ready, int *timeout)
+{
+	struct iw_batch *b;
+	uint64_t age;
+	int ms;
+
+	pthread_mutex_lock(&w->lock);
+	if (!w->len)
+		goto out;
+	age = now - w->first_us;
+	if (w->len < w->cfg.batch_bytes && age < w->cfg.flush_us &&
+	    !w->flush_req && !w->closing && !stopping) {
+		ms = (w->cfg.flush_us - age + 999) / 1000;
+		if (ms < *timeout)
+			*timeout = ms;
+		goto out;
+	}
+	b = calloc(1, sizeof(*b));
+	if (!b) {
+		*timeout = 0; /* try again */
+		goto out;
+	}
+	b->w = w;
+	b->data = w->buf;
+	b->len = b->raw_len = w->len;
+	b->lines = w->buf_lines;
+	w->unsent += w->len;
+	w->buf = NULL;
+	w->len = w->cap = 0;
+	w->buf_lines = 0;
+	w->flush_req = 0;
+	w->batches++;
+	TAILQ_INSERT_TAIL(ready, b, entry);
+ out:
+	pthread_mutex_unlock(&w->lock);
+}
+
+/* Move the batches of \c w that are due for a retry to \c ready */
+static void iw_retry_due(struct influx_writer_s *w, uint64_t now,
+			 struct iw_batch_tq *ready, int *timeout)
+{
+	struct iw_batch *b, *next;
+	int ms;
+
+	for (b = TAILQ_FIRST(&w->retry_q); b; b = next) {
+		next = TAILQ_NEXT(b, entry);
+		if (b->due_us <= now) {
+			TAILQ_REMOVE(&w->retry_q, b, entry);
+			TAILQ_INSERT_TAIL(ready, b, entry);
+			continue;
+		}
+		ms = (b->due_us - now + 999) / 1000;
+		if (ms < *timeout)
+			*timeout = ms;
+	}
+}
+
+static void iw_writer_free(struct influx_writer_s *w)
+{
+	struct iw_batch *b;
+
+	while ((b = TAILQ_FIRST(&w->retry_q))) {
+		TAILQ_REMOVE(&w->retry_q, b, entry);
+		iw_batch_drop(b);
+	}
+	if (w->len || w->stats.dropped)
+		ovis_log(w->log, OVIS_LWARNING, "influx: %s: %lu lines were "
+			 "dropped.\n", w->url,
+			 (unsigned long)(w->stats.dropped + w->buf_lines));
+	curl_slist_free_all(w->headers);
+	pthread_mutex_destroy(&w->lock);
+	free(w->buf);
+	free(w->url);
+	free(w);
+}
+
+static void *iw_proc(void *arg)
+{
+	struct iw_batch_tq ready = TAILQ_HEAD_INITIALIZER(ready);
+	struct influx_writer_s *w, *next;
+	struct curl_waitfd wfd;
+	struct iw_batch *b;
+	CURLMsg *msg;
+	uint64_t now;
+	int timeout, running, left, busy, done;
+	long ctmo;
+	char c;
+
+	for (;;) {
+		now = iw_now_us();
+		timeout = IW_POLL_MAX_MS;
+		busy = 0;
+		pthread_mutex_lock(&iw.lock);
+		for (w = LIST_FIRST(&iw.writers); w; w = next) {
+			next = LIST_NEXT(w, entry);
+			iw_cut(w, now, iw.stopping, &ready, &timeout);
+			iw_retry_due(w, now, &ready, &timeout);
+			if (w->batches) {
+				busy = 1;
+			} else if (w->closing) {
+				LIST_REMOVE(w, entry);
+				iw_writer_free(w);
+			}
+		}
+		done = iw.stopping && (!busy || now >= iw.deadline_us);
+		pthread_mutex_unlock(&iw.lock);
+		if (done)
+			break;
+
+		while ((b = TAILQ_FIRST(&ready))) {
+			TAILQ_REMOVE(&ready, b, entry);
+			iw_batch_start(b);
+		}
+		curl_multi_perform(iw.multi, &running);
+		while ((msg = curl_multi_info_read(iw.multi, &left))) {
+			if (msg->msg != CURLMSG_DONE)
+				continue;
+			curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &b);
+			iw_batch_done(b, msg->data.result);
+			timeout = 0; /* a retry or a free may be due */
+		}
+		if (!curl_multi_timeout(iw.multi, &ctmo) &&
+		    ctmo >= 0 && ctmo < timeout)
+			timeout = ctmo;
+		wfd.fd = iw.wake_fd[0];
+		wfd.events = CURL_WAIT_POLLIN;
+		wfd.revents = 0;
+		curl_multi_wait(iw.multi, &wfd, 1, timeout, NULL);
+		if (wfd.revents) {
+			/*
+			 * Drain before re-arming iw_wake(): a wake byte written
+			 * after the clear must stay in the pipe. A wake between
+			 * the drain and the clear is seen by the queue scan at
+			 * the top of the loop, which runs before the next wait.
+			 */
+			while (read(iw.wake_fd[0], &c, 1) == 1)
+				;
+			__atomic_store_n(&iw.woken, 0, __ATOMIC_RELEASE);
+		}
+	}
+
+	/* stopping; drop what could not be posted in time */
+	while ((b = TAILQ_FIRST(&ready))) {
+		TAILQ_REMOVE(&ready, b, entry);
+		iw_batch_drop(b);
+	}
+	while ((b = TAILQ_FIRST(&iw.inflight))) {
+		TAILQ_REMOVE(&iw.inflight, b, entry);
+		curl_multi_remove_handle(iw.multi, b->easy);
+		iw_batch_drop(b);
+	}
+	/* the writers still referenced are kept for the next start */
+	pthread_mutex_lock(&iw.lock);
+	for (w = LIST_FIRST(&iw.writers); w; w = next) {
+		next = LIST_NEXT(w, entry);
+		if (!w->closing)
+			continue;
+		LIST_REMOVE(w, entry);
+		iw_writer_free(w);
+	}
+	pthread_mutex_unlock(&iw.lock);
+	return NULL;
+}
+
+/* Called with iw.lock held */
+static int iw_start(void)
+{
+	int rc;
+
+	if (iw.started)
+		return 0;
+	if (pipe2(iw.wake_fd, O_NONBLOCK | O_CLOEXEC))
+		return errno;
+	iw.multi = curl_multi_init();
+	if (!iw.multi) {
+		rc = ENOMEM;
+		goto err_0;
+	}
+	TAILQ_INIT(&iw.inflight);
+	iw.woken = 0;
+	iw.stopping = 0;
+	rc = pthread_create(&iw.thread, NULL, iw_proc, NULL);
+	if (rc)
+		goto err_1;
+	pthread_setname_np(iw.thread, "influx_writer");
+	iw.started = 1;
+	return 0;
+ err_1:
+	curl_multi_cleanup(iw.multi);
+	iw.multi = NULL;
+ err_0:
+	close(iw.wake_fd[0]);
+	close(iw.wake_fd[1]);
+	iw.wake_fd[0] = iw.wake_fd[1] = -1;
+	return rc;
+}
+
+influx_writer_t influx_writer_get(const char *url,
+				  const struct influx_writer_cfg *cfg,
+				  ovis_log_t log)
+{
+	struct influx_writer_s *w;
+	struct curl_slist *h;
+	int rc;
+
+	pthread_mutex_lock(&iw.lock);
+	/* a stopping thread would not serve the writer */
+	while (iw.stopping)
+		pthread_cond_wait(&iw.stopped, &iw.lock);
+	rc = iw_start();
+	if (rc)
+		goto err_0;
+	LIST_FOREACH(w, &iw.writers, entry) {
+		if (!w->closing && 0 == strcmp(w->url, url)) {
+			w->ref++;
+			goto out;
+		}
+	}
+	rc = ENOMEM;
+	w = calloc(1, sizeof(*w));
+	if (!w)
+		goto err_0;
+	w->url = strdup(url);
+	if (!w->url)
+		goto err_1;
+	w->cfg = *cfg;
+	w->log = log;
+	h = curl_slist_append(NULL, "Content-Type: application/influx");
+	if (!h)
+		goto err_2;
+	w->headers = h;
+	if (cfg->gzip) {
+		h = curl_slist_append(w->headers, "Content-Encoding: gzip");
+		if (!h)
+			goto err_3;
+		w->headers = h;
+	}
+	pthread_mutex_init(&w->lock, NULL);
+	TAILQ_INIT(&w->retry_q);
+	w->ref = 1;
+	LIST_INSERT_HEAD(&iw.writers, w, entry);
+ out:
+	pthread_mutex_unlock(&iw.lock);
+	return w;
+ err_3:
+	curl_slist_free_all(w->headers);
+ err_2:
+	free(w->url);
+ err_1:
+	free(w);
+ err_0:
+	pthread_mutex_unlock(&iw.lock);
+	errno = rc;
+	return NULL;
+}
+
+/*
+ * Stop the writer thread, if \c idle only if no writer is referenced.
+ * Called with iw.lock held, which is dropped while the thread drains.
+ */
+static void iw_stop(int timeout_ms, int idle)
+{
+	struct influx_writer_s *w;
+
+	if (!iw.started || iw.stopping)
+		return;
+	if (idle) {
+		LIST_FOREACH(w, &iw.writers, entry) {
+			if (w->ref)
+				return;
+		}
+	}
+	iw.stopping = 1;
+	iw.deadline_us = iw_now_us() + (uint64_t)timeout_ms * 1000;
+	pthread_mutex_unlock(&iw.lock);
+	iw_wake();
+	pthread_join(iw.thread, NULL);
+
+	pthread_mutex_lock(&iw.lock);
+	/* no wake-ups until the next start; the pipe is going away */
+	__atomic_store_n(&iw.woken, 1, __ATOMIC_SEQ_CST);
+	curl_multi_cleanup(iw.multi);
+	iw.multi = NULL;
+	close(iw.wake_fd[0]);
+	close(iw.wake_fd[1]);
+	iw.wake_fd[0] = iw.wake_fd[1] = -1;
+	iw.started = 0;
+	iw.stopping = 0;
+	pthread_cond_broadcast(&iw.stopped);
+}
+
+void influx_writer_put(influx_writer_t w)
+{
+	pthread_mutex_lock(&iw.lock);
+	if (--w->ref == 0) {
+		w->closing = 1;
+		/* the last writer; post its lines and stop the thread */
+		iw_stop(INFLUX_WRITER_SHUTDOWN_MS, 1);
+	}
+	if (iw.started)
+		iw_wake();
+	pthread_mutex_unlock(&iw.lock);
+}
+
+int influx_writer_append(influx_writer_t w, const char *line, size_t len)
+{
+	size_t cap;
+	char *buf;
+	int kick;
+
+	pthread_mutex_lock(&w->lock);
+	if (w->len + w->unsent + len + 1 > w->cfg.max_bytes) {
+		if (!w->full)
+			ovis_log(w->log, OVIS_LWARNING, "influx: %s is not "
+				 "keeping up, dropping lines.\n", w->url);
+		w->full = 1;
+		w->stats.dropped++;
+		pthread_mutex_unlock(&w->lock);
+		return EAGAIN;
+	}
+	w->full = 0;
+	if (w->len + len + 1 > w->cap) {
+		cap = w->cap ? 2 * w->cap : w->cfg.batch_bytes + 4096;
+		while (cap < w->len + len + 1)
+			cap *= 2;
+		buf = realloc(w->buf, cap);
+		if (!buf) {
+			w->stats.dropped++;
+			pthread_mutex_unlock(&w->lock);
+			return ENOMEM;
+		}
+		w->buf = buf;
+		w->cap = cap;
+	}
+	/* the thread has to learn about the age of a new buffer too */
+	kick = !w->len;
+	if (!w->len)
+		w->first_us = iw_now_us();
+	memcpy(w->buf + w->len, line, len);
+	w->buf[w->len + len] = '\n';
+	w->len += len + 1;
+	w->buf_lines++;
+	w->stats.lines++;
+	kick |= (w->len >= w->cfg.batch_bytes);
+	pthread_mutex_unlock(&w->lock);
+	if (kick)
+		iw_wake();
+	return 0;
+}
+
+void influx_writer_flush(influx_writer_t w)
+{
+	pthread_mutex_lock(&w->lock);
+	w->flush_req = 1;
+	pthread_mutex_unlock(&w->lock);
+	iw_wake();
+}
+
+void influx_writer_stats_get(influx_writer_t w, struct influx_writer_stats *s)
+{
+	pthread_mutex_lock(&w->lock);
+	*s = w->stats;
+	pthread_mutex_unlock(&w->lock);
+}
+
+void influx_writer_shutdown(int timeout_ms)
+{
+	pthread_mutex_lock(&iw.lock);
+	iw_stop(timeout_ms, 0);
+	pthread_mutex_unlock(&iw.lock);
+}
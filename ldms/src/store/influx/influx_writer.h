@@ -0,0 +1,150 @@
+/* -*- c-basic-offset: 8 -*-
+ * Copyright (c) 2026 National Technology & Engineering Solutions
+ * of Sandia, LLC (NTESS). Under the terms of Contract DE-NA0003525 with
+ * NTESS, the U.S. Government retains certain rights in this software.
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * Asynchronous InfluxDB line-protocol writer.
+ *
+ * The stores append lines to a writer; one writer is shared by all the
+ * stores posting to the same URL (host_port and container). The lines are
+ * accumulated and POSTed by a single writer thread through a curl multi
+ * handle when the buffer reaches a size or when its oldest line reaches an
+ * age, so the store threads never wait on the network.
+ */
+#ifndef __INFLUX_WRITER_H__
+#define __INFLUX_WRITER_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "ovis_log/ovis_log.h"
+
+struct influx_writer_cfg {
+	size_t batch_bytes;	/* POST once this many bytes are buffered */
+	uint64_t flush_us;	/* POST the lines that are this old */
+	int gzip;		/* Content-Encoding: gzip */
+	int max_retries;	/* for connection errors, 429 and 5xx */
+	uint64_t retry_us;	/* first retry delay, doubled on each retry */
+	size_t max_bytes;	/* bound of the buffered and unsent bytes */
+};
+
+#define INFLUX_WRITER_BATCH_BYTES	(64 * 1024)
+#define INFLUX_WRITER_FLUSH_US		1000000
+#define INFLUX_WRITER_MAX_RETRIES	3
+#define INFLUX_WRITER_RETRY_US		500000
+#define INFLUX_WRITER_MAX_BYTES		(16 * 1024 * 1024)
+#define INFLUX_WRITER_SHUTDOWN_MS	5000
+
+struct influx_writer_stats {
+	uint64_t lines;		/* lines appended */
+	uint64_t posts;		/* successful POSTs */
+	uint64_t retries;	/* POSTs retried */
+	uint64_t dropped;	/* lines dropped, buffer full or POST failed */
+};
+
+typedef struct influx_writer_s *influx_writer_t;
+
+/**
+ * \brief Get the writer posting to \c url
+ *
+ * The writer is created, and the writer thread started, if there is no
+ * writer for \c url yet. Otherwise a reference on the existing writer is
+ * taken and \c cfg is ignored.
+ *
+ * \param url The InfluxDB write URL, e.g. http://host:8086/write?db=ldms
+ * \param cfg The writer configuration.
+ * \param log The log to report the POST errors to.
+ *
+ * \retval writer The writer handle.
+ * \retval NULL   If there is an error. \c errno is set.
+ */
+influx_writer_t influx_writer_get(const char *url,
+				  const struct influx_writer_cfg *cfg,
+				  ovis_log_t log);
+
+/**
+ * \brief Put the reference of the writer
+ *
+ * When the last reference is put, the buffered lines are posted and the
+ * writer is freed by the writer thread. When no writer is referenced
+ * anymore, the writer thread is stopped as by influx_writer_shutdown()
+ * with INFLUX_WRITER_SHUTDOWN_MS; the caller waits for it.
+ */
+void influx_writer_put(influx_writer_t w);
+
+/**
+ * \brief Append a line to the writer
+ *
+ * \c line does not include the terminating newline.
+ *
+ * \retval 0      If the line is buffered.
+ * \retval EAGAIN If the writer is holding \c max_bytes already. The line is
+ *                dropped.
+ * \retval ENOMEM If the buffer cannot be grown. The line is dropped.
+ */
+int influx_writer_append(influx_writer_t w, const char *line, size_t len);
+
+/**
+ * \brief Ask the writer thread to POST the buffered lines now
+ *
+ * This does not wait for the POST.
+ */
+void influx_writer_flush(influx_writer_t w);
+
+void influx_writer_stats_get(influx_writer_t w, struct influx_writer_stats *s);
+
+/**
+ * \brief Stop the writer thread
+ *
+ * The buffered lines of all the writers are posted and the thread waits up
+ * to \c timeout_ms for the POSTs (and their retries) to complete before it
+ * exits. The lines that are still unsent are dropped. The writers that are
+ * still referenced stay valid; the thread is started again by the next
+ * influx_writer_get().
+ */
+void influx_writer_shutdown(int timeout_ms);
+
+#endif
@@ -58,8 +58,17 @@
 #include <curl/curl.h>
 #include "ldms.h"
 #include "ldmsd.h"
+#include "influx_writer.h"
 
 static char host_port[64];	/* hostname:port_no for influxdb */
+static struct influx_writer_cfg writer_cfg = {
+	.batch_bytes = INFLUX_WRITER_BATCH_BYTES,
+	.flush_us = INFLUX_WRITER_FLUSH_US,
+	.gzip = 0,
+	.max_retries = INFLUX_WRITER_MAX_RETRIES,
+	.retry_us = INFLUX_WRITER_RETRY_US,
+	.max_bytes = INFLUX_WRITER_MAX_BYTES,
+};
 struct influx_store {
 	char *host_port;
 	char *schema;
@@ -68,7 +77,7 @@ struct influx_store {
 	int job_mid;
 	int comp_mid;
 	char **metric_name;
-	CURL *curl;
+	influx_writer_t writer; /* shared by the stores of the container */
 	LIST_ENTRY(influx_store) entry;
 	size_t measurement_limit;
 	char measurement[0];
@@ -164,18 +173,41 @@ influx_value_set_fn influx_value_set[] = {
 	[LDMS_V_CHAR_ARRAY] = set_str_fn
 };
 
+static int config_u64(ldmsd_plug_handle_t handle, struct attr_value_list *avl,
+		      const char *name, uint64_t *value)
+{
+	char *str, *end;
+	uint64_t v;
+
+	str = av_value(avl, name);
+	if (!str)
+		return 0;
+	v = strtoull(str, &end, 0);
+	if (*end != '\0' || end == str) {
+		ovis_log(ldmsd_plug_log_get(handle), OVIS_LERROR,
+			 "'%s' is not a valid '%s' value\n", str, name);
+		return EINVAL;
+	}
+	*value = v;
+	return 0;
+}
+
 /**
  * \brief Configuration
  */
 static int config(ldmsd_plug_handle_t handle, struct attr_value_list *kwl, struct attr_value_list *avl)
 {
+	struct influx_writer_cfg cfg = writer_cfg;
+	uint64_t v;
 	char *value;
+	int rc;
 	pthread_mutex_lock(&cfg_lock);
 
 	value = av_value(avl, "host_port");
 	if (!value) {
 		ovis_log(ldmsd_plug_log_get(handle),
 			 OVIS_LERROR, "The 'host_port' keyword is required.\n");
+		pthread_mutex_unlock(&cfg_lock);
 		return EINVAL;
 	}
 	strncpy(host_port, value, sizeof(host_port));
@@ -192,13 +224,58 @@ static int config(ldmsd_plug_handle_t handle, struct attr_value_list *kwl, struc
 		}
 	}
 
+	v = cfg.batch_bytes;
+	rc = config_u64(handle, avl, "batch_size", &v);
+	if (rc)
+		goto out;
+	cfg.batch_bytes = v;
+	rc = config_u64(handle, avl, "flush_interval", &cfg.flush_us);
+	if (rc)
+		goto out;
+	v = cfg.gzip;
+	rc = config_u64(handle, avl, "gzip", &v);
+	if (rc)
+		goto out;
+	cfg.gzip = !!v;
+	v = cfg.max_retries;
+	rc = config_u64(handle, avl, "retries", &v);
+	if (rc)
+		goto out;
+	cfg.max_retries = v;
+	rc = config_u64(handle, avl, "retry_interval", &cfg.retry_us);
+	if (rc)
+		goto out;
+	v = cfg.max_bytes;
+	rc = config_u64(handle, avl, "max_buffer", &v);
+	if (rc)
+		goto out;
+	cfg.max_bytes = v;
+	/* applies to the containers opened from now on */
+	writer_cfg = cfg;
+ out:
 	pthread_mutex_unlock(&cfg_lock);
-	return 0;
+	return rc;
 }
 
 static const char *usage(ldmsd_plug_handle_t handle)
 {
-	return  "    config name=influx host_port=<hostname>':'<port_no>\n";
+	return  "    config name=influx host_port=<hostname>':'<port_no>\n"
+		"           [measurement_limit=<bytes>] [batch_size=<bytes>]\n"
+		"           [flush_interval=<usec>] [gzip=0|1] [retries=<num>]\n"
+		"           [retry_interval=<usec>] [max_buffer=<bytes>]\n"
+		"       measurement_limit The maximum length of a line (default 4096).\n"
+		"       batch_size     POST once this many bytes of lines are buffered\n"
+		"                      for a container (default 65536).\n"
+		"       flush_interval POST the lines that are buffered for this long\n"
+		"                      (default 1000000).\n"
+		"       gzip           Compress the POST bodies (default 0).\n"
+		"       retries        The number of times a POST that failed to\n"
+		"                      connect or got a 429 or 5xx is retried (default 3).\n"
+		"       retry_interval The delay before the first retry, doubled on each\n"
+		"                      retry (default 500000).\n"
+		"       max_buffer     The lines are dropped when this many bytes are\n"
+		"                      waiting to be posted for a container\n"
+		"                      (default 16777216).\n";
 }
 
 static ldmsd_store_handle_t
@@ -206,6 +283,7 @@ open_store(ldmsd_plug_handle_t s, const char *container, const char *schema,
 	   struct ldmsd_strgp_metric_list *metric_list)
 {
 	struct influx_store *is = NULL;
+	char url[PATH_MAX];
 
 	is = malloc(sizeof(*is) + measurement_limit);
 	if (!is)
@@ -224,13 +302,18 @@ open_store(ldmsd_plug_handle_t s, const char *container, const char *schema,
 	is->job_mid = -1;
 	is->comp_mid = -1;
 
-	is->curl = curl_easy_init();
-	if (!is->curl)
-		goto err3;
+	snprintf(url, sizeof(url), "http://%s/write?db=%s", is->host_port, is->container);
 	pthread_mutex_lock(&cfg_lock);
+	is->writer = influx_writer_get(url, &writer_cfg, ldmsd_plug_log_get(s));
+	if (!is->writer) {
+		pthread_mutex_unlock(&cfg_lock);
+		goto err4;
+	}
 	LIST_INSERT_HEAD(&store_list, is, entry);
 	pthread_mutex_unlock(&cfg_lock);
 	return is;
+ err4:
+	free(is->host_port);
  err3:
 	free(is->schema);
  err2:
@@ -333,13 +416,6 @@ store(ldmsd_plug_handle_t handle, ldmsd_store_handle_t _sh, ldms_set_t set, int
 			goto err;
 	}
 
-	char url[128];
-	snprintf(url, sizeof(url), "http://%s/write?db=%s", is->host_port, is->container);
-	curl_easy_setopt(is->curl, CURLOPT_URL, url);
-
-	struct curl_slist *headers = NULL;
-	headers = curl_slist_append(headers, "Content-Type: application/influx");
-
 	measurement = is->measurement;
 	cnt = snprintf(measurement, is->measurement_limit,
 		       "%s,job_id=%lui,component_id=%lui ",
@@ -387,13 +463,10 @@ store(ldmsd_plug_handle_t handle, ldmsd_store_handle_t _sh, ldms_set_t set, int
 	cnt = snprintf(&measurement[off], is->measurement_limit - off, " %lld", ts);
 	off += cnt;
 
-	curl_easy_setopt(is->curl, CURLOPT_POSTFIELDS, measurement);
-	curl_easy_setopt(is->curl, CURLOPT_POSTFIELDSIZE, off);
-	curl_easy_setopt(is->curl, CURLOPT_HTTPHEADER, headers);
-	curl_easy_perform(is->curl);
-	curl_slist_free_all(headers);
+	/* posted by the writer thread */
+	rc = influx_writer_append(is->writer, measurement, off);
 	pthread_mutex_unlock(&is->lock);
-	return 0;
+	return rc;
 err:
 	pthread_mutex_unlock(&is->lock);
 
@@ -413,11 +486,23 @@ static void close_store(ldmsd_plug_handle_t handle, ldmsd_store_handle_t _sh)
 	LIST_REMOVE(is, entry);
 	pthread_mutex_unlock(&cfg_lock);
 
+	influx_writer_put(is->writer);
+	free(is->host_port);
 	free(is->container);
 	free(is->schema);
 	free(is);
 }
 
+static int flush_store(ldmsd_plug_handle_t handle, ldmsd_store_handle_t _sh)
+{
+	struct influx_store *is = _sh;
+
+	if (!is)
+		return EINVAL;
+	influx_writer_flush(is->writer);
+	return 0;
+}
+
 static struct ldmsd_store store_influx = {
 	.base = {
 		.name = "influx",
@@ -427,6 +512,7 @@ static struct ldmsd_store store_influx = {
 	},
 	.open = open_store,
 	.store = store,
+	.flush = flush_store,
 	.close = close_store,
 };
 
@@ -0,0 +1,308 @@
+/* -*- c-basic-offset: 8 -*-
+ * Copyright (c) 2026 National Technology & Engineering Solutions
+ * of Sandia, LLC (NTESS). Under the terms of Contract DE-NA0003525 with
+ * NTESS, the U.S. Government retains certain rights in this software.
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * Test of the asynchronous InfluxDB writer against a local HTTP stand-in.
+ *
+ * The stand-in accepts POSTs on 127.0.0.1, inflates the gzip'ed bodies and
+ * counts the lines. It answers 503 to the first FAILS requests so that the
+ * retries are exercised, and 204 to the rest.
+ *
+ *   test_influx_writer [LINES [FAILS]]
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <curl/curl.h>
+#include <zlib.h>
+#include "influx_writer.h"
+
+static int srv_fd;
+static int srv_fails;
+static int srv_requests;
+static int srv_gzip_requests;
+static uint64_t srv_lines;
+static pthread_mutex_t srv_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t count_lines(const char *buf, size_t len)
+{
+	uint64_t n = 0;
+	size_t i;
+	for (i = 0; i < len; i++)
+		n += (buf[i] == '\n');
+	return n;
+}
+
+static uint64_t gunzip_lines(const char *buf, size_t len)
+{
+	char out[65536];
+	z_stream zs = {0};
+	uint64_t n = 0;
+	int rc;
+
+	if (inflateInit2(&zs, 15 + 16) != Z_OK)
+		return 0;
+	zs.next_in = (Bytef *)buf;
+	zs.avail_in = len;
+	do {
+		zs.next_out = (Bytef *)out;
+		zs.avail_out = sizeof(out);
+		rc = inflate(&zs, Z_NO_FLUSH);
+		n += count_lines(out, sizeof(out) - zs.avail_out);
+	} while (rc == Z_OK);
+	inflateEnd(&zs);
+	return (rc == Z_STREAM_END)?n:0;
+}
+
+/* Serve the requests of one (keep-alive) connection */
+static void serve(int fd)
+{
+	static const char ok[] = "HTTP/1.1 204 No Content\r\n\r\n";
+	static const char busy[] = "HTTP/1.1 503 Service Unavailable\r\n"
+				   "Content-Length: 0\r\n\r\n";
+	char *buf = NULL, *hdr_end, *p;
+	size_t len = 0, cap = 0, body_len, req_len;
+	ssize_t cnt;
+	uint64_t lines;
+	int gzip, fail;
+
+	for (;;) {
+		hdr_end = buf ? memmem(buf, len, "\r\n\r\n", 4) : NULL;
+		if (hdr_end) {
+			body_len = 0;
+			p = strcasestr(buf, "\r\nContent-Length:");
+			if (p && p < hdr_end)
+				body_len = strtoul(p + 17, NULL, 10);
+			p = strcasestr(buf, "\r\nContent-Encoding: gzip");
+			gzip = (p && p < hdr_end);
+			req_len = hdr_end + 4 - buf + body_len;
+			if (len >= req_len) {
+				if (gzip)
+					lines = gunzip_lines(hdr_end + 4, body_len);
+				else
+					lines = count_lines(hdr_end + 4, body_len);
+				pthread_mutex_lock(&srv_lock);
+				fail = (srv_requests++ < srv_fails);
+				if (!fail) {
+					srv_lines += lines;
+					srv_gzip_requests += gzip;
+				}
+				pthread_mutex_unlock(&srv_lock);
+				if (fail)
+					cnt = write(fd, busy, sizeof(busy) - 1);
+				else
+					cnt = write(fd, ok, sizeof(ok) - 1);
+				memmove(buf, buf + req_len, len - req_len);
+				len -= req_len;
+				buf[len] = '\0';
+				continue;
+			}
+		}
+		if (len + 4096 + 1 > cap) {
+			cap = cap ? 2 * cap : 65536;
+			buf = realloc(buf, cap);
+			if (!buf)
+				break;
+		}
+		cnt = read(fd, buf + len, cap - len - 1);
+		if (cnt <= 0)
+			break;
+		len += cnt;
+		buf[len] = '\0';
+	}
+	free(buf);
+	close(fd);
+}
+
+static void *serve_proc(void *arg)
+{
+	serve((int)(long)arg);
+	return NULL;
+}
+
+static void *accept_proc(void *arg)
+{
+	pthread_t t;
+	int fd;
+
+	while ((fd = accept(srv_fd, NULL, NULL)) >= 0) {
+		pthread_create(&t, NULL, serve_proc, (void *)(long)fd);
+		pthread_detach(t);
+	}
+	return NULL;
+}
+
+static int server_start(int *port)
+{
+	struct sockaddr_in sin = {
+		.sin_family = AF_INET,
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+	socklen_t slen = sizeof(sin);
+	pthread_t t;
+
+	srv_fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (srv_fd < 0)
+		return errno;
+	if (bind(srv_fd, (void *)&sin, sizeof(sin)) ||
+	    listen(srv_fd, 16) ||
+	    getsockname(srv_fd, (void *)&sin, &slen))
+		return errno;
+	*port = ntohs(sin.sin_port);
+	return pthread_create(&t, NULL, accept_proc, NULL);
+}
+
+static uint64_t server_lines(void)
+{
+	uint64_t n;
+	pthread_mutex_lock(&srv_lock);
+	n = srv_lines;
+	pthread_mutex_unlock(&srv_lock);
+	return n;
+}
+
+static int run(int port, const char *db, int gzip, int lines, int fails)
+{
+	struct influx_writer_cfg cfg = {
+		.batch_bytes = 16384,
+		.flush_us = 100000,
+		.gzip = gzip,
+		.max_retries = fails + 1,
+		.retry_us = 10000,
+		.max_bytes = INFLUX_WRITER_MAX_BYTES,
+	};
+	struct influx_writer_stats st;
+	influx_writer_t w;
+	char url[128], line[256];
+	uint64_t base;
+	int i, len, rc = 0;
+
+	pthread_mutex_lock(&srv_lock);
+	srv_requests = 0;
+	srv_fails = fails;
+	srv_gzip_requests = 0;
+	base = srv_lines;
+	pthread_mutex_unlock(&srv_lock);
+
+	snprintf(url, sizeof(url), "http://127.0.0.1:%d/write?db=%s", port, db);
+	w = influx_writer_get(url, &cfg, NULL);
+	if (!w) {
+		printf("influx_writer_get() error: %d\n", errno);
+		return 1;
+	}
+
+	/* a few lines go out by age alone */
+	for (i = 0; i < 3; i++) {
+		len = snprintf(line, sizeof(line), "meminfo,job_id=0i,"
+			       "component_id=%di MemFree=%di %d", i, i, i);
+		influx_writer_append(w, line, len);
+	}
+	usleep(500000);
+	if (server_lines() - base != 3) {
+		printf("%s: the lines were not flushed by age: %lu/3\n", db,
+		       (unsigned long)(server_lines() - base));
+		rc = 1;
+	}
+
+	for (i = 3; i < lines; i++) {
+		len = snprintf(line, sizeof(line), "meminfo,job_id=0i,"
+			       "component_id=%di MemFree=%di %d", i, i, i);
+		if (influx_writer_append(w, line, len)) {
+			printf("%s: influx_writer_append() failed\n", db);
+			rc = 1;
+		}
+	}
+	influx_writer_stats_get(w, &st);
+	/* the last reference posts the lines and stops the thread */
+	influx_writer_put(w);
+
+	printf("%s: gzip %d, lines %lu/%d, posts %lu, retries %lu, "
+	       "dropped %lu, gzip'ed requests %d\n", db, gzip,
+	       (unsigned long)(server_lines() - base), lines,
+	       (unsigned long)st.posts, (unsigned long)st.retries,
+	       (unsigned long)st.dropped, srv_gzip_requests);
+	if (server_lines() - base != lines) {
+		printf("%s: lines are missing\n", db);
+		rc = 1;
+	}
+	if (fails && !st.retries) {
+		printf("%s: no retries\n", db);
+		rc = 1;
+	}
+	if (gzip && !srv_gzip_requests) {
+		printf("%s: no gzip'ed request\n", db);
+		rc = 1;
+	}
+	return rc;
+}
+
+int main(int argc, char **argv)
+{
+	int lines = (argc > 1)?atoi(argv[1]):100000;
+	int fails = (argc > 2)?atoi(argv[2]):2;
+	int port, rc;
+
+	curl_global_init(CURL_GLOBAL_DEFAULT);
+	rc = server_start(&port);
+	if (rc) {
+		printf("cannot start the HTTP stand-in: %d\n", rc);
+		return 1;
+	}
+	rc = run(port, "plain", 0, lines, fails);
+	rc |= run(port, "gzip", 1, lines, fails);
+	printf("%s\n", rc?"FAILED":"PASSED");
+	return rc;
+}
@@ -71,6 +71,10 @@
 
 static ovis_log_t mylog;
 
+/* How long a batch waits for room in a full producer queue */
+#define SK_QUEUE_FULL_WAIT_MS	10
+#define SK_QUEUE_FULL_RETRY	100
+
 #define LOG(LVL, FMT, ...) ovis_log(mylog, LVL, "store_kafka: " FMT, ## __VA_ARGS__)
 
 #define LOG_ERROR(FMT, ...) LOG(OVIS_LERROR, FMT, ## __VA_ARGS__)
@@ -279,17 +283,74 @@ static void term(ldmsd_plug_handle_t handle)
 	pthread_mutex_unlock(&sk_lock);
 }
 
+/*
+ * Topic handles are cached by name for the life of the store handle,
+ * rd_kafka_topic_new() is too expensive to call for every row.
+ */
+struct sk_topic {
+	struct rbn rbn;
+	rd_kafka_topic_t *rkt;
+	char name[];
+};
+
 typedef struct store_kafka_handle_s {
 	rd_kafka_t *rk; /* The Kafka handle */
 	rd_kafka_conf_t *rconf; /* The Kafka configuration */
+	struct rbt topic_tree; /* sk_topic by name, protected by strgp->lock */
+	int queue_max; /* queue.buffering.max.messages of rk */
 } *store_kafka_handle_t;
 
+static int topic_cmp(void *a, const void *b)
+{
+	return strcmp(a, b);
+}
+
+static rd_kafka_topic_t *__topic_get(store_kafka_handle_t sh, const char *name)
+{
+	struct sk_topic *t;
+	struct rbn *rbn;
+	size_t len;
+
+	rbn = rbt_find(&sh->topic_tree, name);
+	if (rbn)
+		return container_of(rbn, struct sk_topic, rbn)->rkt;
+	len = strlen(name) + 1;
+	t = malloc(sizeof(*t) + len);
+	if (!t)
+		return NULL;
+	memcpy(t->name, name, len);
+	t->rkt = rd_kafka_topic_new(sh->rk, name, NULL);
+	if (!t->rkt) {
+		LOG_ERROR("rd_kafka_topic_new(\"%s\") failed, "
+			  "errno: %d\n", name, errno);
+		free(t);
+		return NULL;
+	}
+	rbn_init(&t->rbn, t->name);
+	rbt_ins(&sh->topic_tree, &t->rbn);
+	return t->rkt;
+}
+
+static void __topic_purge(store_kafka_handle_t sh)
+{
+	struct sk_topic *t;
+	struct rbn *rbn;
+
+	while ((rbn = rbt_min(&sh->topic_tree))) {
+		rbt_del(&sh->topic_tree, rbn);
+		t = container_of(rbn, struct sk_topic, rbn);
+		rd_kafka_topic_destroy(t->rkt);
+		free(t);
+	}
+}
+
 static void close_store(ldmsd_plug_handle_t handle, ldmsd_store_handle_t _sh)
 {
 	/* NOTE: _sh is strgp->store_handle */
 
 	/* This is called when strgp stopped to clean up resources */
 	store_kafka_handle_t sh = _sh;
+	__topic_purge(sh);
 	if (sh->rk) {
 		rd_kafka_destroy(sh->rk);
 	}
@@ -299,6 +360,17 @@ static void close_store(ldmsd_plug_handle_t handle, ldmsd_store_handle_t _sh)
 	free(sh);
 }
 
+static int __queue_max_get(rd_kafka_t *rk)
+{
+	char val[32];
+	size_t sz = sizeof(val);
+
+	if (rd_kafka_conf_get(rd_kafka_conf(rk), "queue.buffering.max.messages",
+			      val, &sz) != RD_KAFKA_CONF_OK)
+		return 0;
+	return atoi(val);
+}
+
 static store_kafka_handle_t __handle_new(ldmsd_strgp_t strgp)
 {
 	char err_str[512];
@@ -307,6 +379,7 @@ static store_kafka_handle_t __handle_new(ldmsd_strgp_t strgp)
 	store_kafka_handle_t sh = calloc(1, sizeof(*sh));
 	if (!sh)
 		goto err_0;
+	rbt_init(&sh->topic_tree, topic_cmp);
 	sh->rconf = rd_kafka_conf_dup(common_rconf);
 	if (!sh->rconf)
 		goto err_1;
@@ -327,6 +400,7 @@ static store_kafka_handle_t __handle_new(ldmsd_strgp_t strgp)
 		goto err_2;
 	}
 	sh->rconf = NULL; /* rd_kafka_new consumed and freed the conf */
+	sh->queue_max = __queue_max_get(sh->rk);
 
 	return sh;
 
@@ -338,16 +412,112 @@ static store_kafka_handle_t __handle_new(ldmsd_strgp_t strgp)
 	return NULL;
 }
 
+/*
+ * Per-thread produce batch. The rows of a commit are serialized back to back
+ * into one buffer that is kept for the next commit of the thread, and runs of
+ * rows with the same topic are handed to rd_kafka_produce_batch() at once.
+ * The payloads are copied by librdkafka (RD_KAFKA_MSG_F_COPY).
+ */
+typedef struct sk_batch_s {
+	char *buf;
+	size_t buf_sz;
+	rd_kafka_message_t *msgs;
+	int msgs_sz;
+} *sk_batch_t;
+
+static pthread_key_t sk_batch_key;
+static pthread_once_t sk_batch_once = PTHREAD_ONCE_INIT;
+
+static void sk_batch_destroy(void *arg)
+{
+	sk_batch_t b = arg;
+	free(b->buf);
+	free(b->msgs);
+	free(b);
+}
+
+static void sk_batch_key_init(void)
+{
+	(void)pthread_key_create(&sk_batch_key, sk_batch_destroy);
+}
+
+static sk_batch_t sk_batch_get(int row_count)
+{
+	rd_kafka_message_t *msgs;
+	sk_batch_t b;
+
+	pthread_once(&sk_batch_once, sk_batch_key_init);
+	b = pthread_getspecific(sk_batch_key);
+	if (!b) {
+		b = calloc(1, sizeof(*b));
+		if (!b)
+			return NULL;
+		if (pthread_setspecific(sk_batch_key, b)) {
+			free(b);
+			return NULL;
+		}
+	}
+	if (row_count > b->msgs_sz) {
+		msgs = realloc(b->msgs, row_count * sizeof(*msgs));
+		if (!msgs)
+			return NULL;
+		b->msgs = msgs;
+		b->msgs_sz = row_count;
+	}
+	return b;
+}
+
+/*
+ * Produce the \c n messages of \c b that were serialized for \c rkt.
+ *
+ * The messages rejected because the producer queue is full are produced
+ * again after serving the queue for SK_QUEUE_FULL_WAIT_MS, at most
+ * SK_QUEUE_FULL_RETRY times. Returns the number of messages dropped.
+ */
+static int __produce_run(store_kafka_handle_t sh, sk_batch_t b,
+			 rd_kafka_topic_t *rkt, int n)
+{
+	rd_kafka_message_t *m;
+	int i, cnt, retry, full;
+
+	/* the buffer does not move anymore, turn the offsets into pointers */
+	for (i = 0; i < n; i++)
+		b->msgs[i].payload = b->buf + (uintptr_t)b->msgs[i].payload;
+	for (retry = 0; ; retry++) {
+		cnt = rd_kafka_produce_batch(rkt, RD_KAFKA_PARTITION_UA,
+					     RD_KAFKA_MSG_F_COPY, b->msgs, n);
+		if (cnt == n)
+			return 0;
+		/* keep the messages rejected by a full queue for the retry */
+		for (i = 0, full = 0; i < n; i++) {
+			m = &b->msgs[i];
+			if (m->err == RD_KAFKA_RESP_ERR__QUEUE_FULL) {
+				b->msgs[full] = *m;
+				b->msgs[full++].err = 0;
+			} else if (m->err)
+				LOG_ERROR("rd_kafka_produce_batch(\"%s\") failed, "
+					  "\"%s\"\n", rd_kafka_topic_name(rkt),
+					  rd_kafka_err2str(m->err));
+		}
+		if (!full || retry == SK_QUEUE_FULL_RETRY)
+			return full;
+		rd_kafka_poll(sh->rk, SK_QUEUE_FULL_WAIT_MS);
+		n = full;
+	}
+}
+
 /* protected by strgp->lock */
 static int
 commit_rows(ldmsd_plug_handle_t handle, ldmsd_strgp_t strgp, ldms_set_t set, ldmsd_row_list_t row_list,
 	    int row_count)
 {
 	store_kafka_handle_t sh;
-	rd_kafka_topic_t *rkt;
+	rd_kafka_topic_t *rkt, *run_rkt = NULL;
+	rd_kafka_message_t *m;
 	ldmsd_row_t row;
-	char *buf;
-	int rc, len;
+	sk_batch_t b;
+	size_t off = 0, start;
+	int rc, n = 0, dropped = 0;
 
 	sh = strgp->store_handle;
 	if (!sh) {
@@ -357,32 +527,55 @@ commit_rows(ldmsd_plug_handle_t handle, ldmsd_strgp_t strgp, ldms_set_t set, ldm
 		strgp->store_handle = sh;
 	}
 
-	TAILQ_FOREACH(row, row_list, entry) {
-		rc = ldmsd_row_to_json_object(row, &buf, &len);
-		if (rc) {
-			LOG_ERROR("ldmsd_row_to_json_object() error: %d\n", rc);
-			continue;
-		}
+	/*
+	 * Nothing is produced if the rows do not fit in the producer queue,
+	 * so that the strgp can commit them again (see ldmsd_store.commit).
+	 */
+	if (row_count <= sh->queue_max &&
+	    rd_kafka_outq_len(sh->rk) + row_count > sh->queue_max) {
+		rd_kafka_poll(sh->rk, 0);
+		return EAGAIN;
+	}
+
+	b = sk_batch_get(row_count);
+	if (!b)
+		return ENOMEM;
 
+	TAILQ_FOREACH(row, row_list, entry) {
 		/* row schema is the "topic" */
-		rkt = rd_kafka_topic_new(sh->rk, row->schema_name, NULL);
-		if (!rkt) {
-			LOG_ERROR("rd_kafka_topic_new(\"%s\") failed, "
-				  "errno: %d\n", row->schema_name, errno);
-			free(buf);
+		rkt = __topic_get(sh, row->schema_name);
+		if (!rkt)
 			continue;
+		if (rkt != run_rkt) {
+			if (n)
+				dropped += __produce_run(sh, b, run_rkt, n);
+			run_rkt = rkt;
+			n = 0;
+			off = 0;
 		}
-
-		rc = rd_kafka_produce(rkt, RD_KAFKA_PARTITION_UA,
-				RD_KAFKA_MSG_F_FREE, buf, len, NULL, 0, NULL);
+		start = off;
+		rc = ldmsd_row_to_json_object_buf(row, &b->buf, &b->buf_sz, &off);
 		if (rc) {
-			LOG_ERROR("rd_kafka_produce(\"%s\") failed, "
-				  "errno: %d\n", row->schema_name, rc);
-			free(buf);
+			LOG_ERROR("ldmsd_row_to_json_object_buf() error: %d\n", rc);
+			off = start;
+			continue;
 		}
-		rd_kafka_topic_destroy(rkt);
+		m = &b->msgs[n++];
+		memset(m, 0, sizeof(*m));
+		m->partition = RD_KAFKA_PARTITION_UA;
+		m->payload = (void *)(uintptr_t)start; /* the buffer may move */
+		m->len = off - start;
 	}
+	if (n)
+		dropped += __produce_run(sh, b, run_rkt, n);
+
+	/* serve the delivery reports and errors without blocking */
+	rd_kafka_poll(sh->rk, 0);
 
+	if (dropped) {
+		LOG_ERROR("%d rows dropped, the producer queue is full\n", dropped);
+		return ENOBUFS;
+	}
 	return 0;
 }
 
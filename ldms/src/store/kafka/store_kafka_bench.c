@@ -0,0 +1,202 @@
+/* -*- c-basic-offset: 8 -*-
+ * Copyright (c) 2026 National Technology & Engineering Solutions
+ * of Sandia, LLC (NTESS). Under the terms of Contract DE-NA0003525 with
+ * NTESS, the U.S. Government retains certain rights in this software.
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Benchmark of the store_kafka commit path against the librdkafka mock
+ * cluster (test.mock.num.brokers), so no Kafka broker is needed.
+ *
+ * The plugin is compiled in and configured as ldmsd would; each commit hands
+ * ROWS rows of one schema to its commit() like strgp_decompose() does,
+ * committing the rows again after a millisecond while the store returns
+ * EAGAIN. The rate includes the final flush of the producer queue.
+ *
+ *   store_kafka_bench [ROWS [COMMITS [QUEUE_MAX]]]
+ */
+#include <unistd.h>
+#include "store_kafka.c"
+
+/* from ldmsd.c and ldmsd_request.c, for ldmsd_decomp.c */
+ovis_log_t store_log;
+
+int linebuf_printf(struct ldmsd_req_ctxt *reqc, char *fmt, ...)
+{
+	return 0;
+}
+
+#define TOPIC		"bench"
+#define COL_COUNT	16
+
+static const char *col_names[COL_COUNT] = {
+	"timestamp", "component_id", "job_id", "app_id",
+	"m0", "m1", "m2", "m3", "m4", "m5", "m6", "m7",
+	"m8", "m9", "m10", "m11",
+};
+
+static ldmsd_row_t row_new(uint64_t comp_id)
+{
+	ldmsd_row_t row;
+	union ldms_value *mvals;
+	int i;
+
+	row = calloc(1, sizeof(*row) + COL_COUNT * sizeof(row->cols[0]) +
+			COL_COUNT * sizeof(*mvals));
+	if (!row)
+		return NULL;
+	mvals = (void*)&row->cols[COL_COUNT];
+	row->schema_name = TOPIC;
+	row->col_count = COL_COUNT;
+	for (i = 0; i < COL_COUNT; i++) {
+		row->cols[i].name = col_names[i];
+		row->cols[i].mval = &mvals[i];
+		row->cols[i].type = LDMS_V_U64;
+		mvals[i].v_u64 = comp_id * 1000003 + i;
+	}
+	row->cols[0].type = LDMS_V_TIMESTAMP;
+	mvals[0].v_ts.sec = 1700000000;
+	mvals[0].v_ts.usec = comp_id % 1000000;
+	return row;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* the store_kafka configuration file for the mock cluster */
+static int plugin_config(int queue_max)
+{
+	char path[] = "/tmp/store_kafka_bench.XXXXXX";
+	struct attr_value_list *kwl = NULL, *avl = NULL;
+	char buf[128];
+	int fd, len, rc;
+
+	fd = mkstemp(path);
+	if (fd < 0)
+		return errno;
+	len = snprintf(buf, sizeof(buf), "{ \"test.mock.num.brokers\": \"1\",\n"
+			"  \"queue.buffering.max.messages\": \"%d\" }\n",
+			queue_max);
+	if (write(fd, buf, len) != len) {
+		rc = errno;
+		goto out;
+	}
+	kwl = av_new(1);
+	avl = av_new(1);
+	if (!kwl || !avl || av_add(avl, "path", path)) {
+		rc = ENOMEM;
+		goto out;
+	}
+	rc = store_kafka.base.config(NULL, kwl, avl);
+ out:
+	av_free(kwl);
+	av_free(avl);
+	close(fd);
+	unlink(path);
+	return rc;
+}
+
+int main(int argc, char **argv)
+{
+	int rows = (argc > 1)?atoi(argv[1]):100;
+	int commits = (argc > 2)?atoi(argv[2]):2000;
+	int queue_max = (argc > 3)?atoi(argv[3]):100000;
+	struct ldmsd_row_list_s row_list = TAILQ_HEAD_INITIALIZER(row_list);
+	struct ldmsd_strgp strgp;
+	store_kafka_handle_t sh;
+	uint64_t eagain = 0;
+	double t0, t1;
+	ldmsd_row_t row;
+	int c, i, rc;
+
+	for (i = 0; i < rows; i++) {
+		row = row_new(i);
+		if (!row) {
+			printf("out of memory\n");
+			return 1;
+		}
+		TAILQ_INSERT_TAIL(&row_list, row, entry);
+	}
+	get_plugin();
+	rc = plugin_config(queue_max);
+	if (rc) {
+		printf("store_kafka config error: %d\n", rc);
+		return 1;
+	}
+	memset(&strgp, 0, sizeof(strgp));
+	strgp.container = "localhost"; /* replaced by the mock cluster */
+
+	t0 = now();
+	for (c = 0; c < commits; c++) {
+		while (EAGAIN == (rc = store_kafka.commit(NULL, &strgp, NULL,
+							  &row_list, rows))) {
+			eagain++;
+			usleep(1000);
+		}
+		if (rc) {
+			printf("commit error: %d\n", rc);
+			return 1;
+		}
+	}
+	sh = strgp.store_handle;
+	rd_kafka_flush(sh->rk, 60000);
+	t1 = now();
+	printf("rows: %d, commits: %d, %.0f rows/sec, EAGAIN: %lu, "
+	       "undelivered: %d\n", rows, commits,
+	       (double)rows * commits / (t1 - t0), (unsigned long)eagain,
+	       rd_kafka_outq_len(sh->rk));
+	store_kafka.close(NULL, sh);
+	store_kafka.base.term(NULL);
+	while ((row = TAILQ_FIRST(&row_list))) {
+		TAILQ_REMOVE(&row_list, row, entry);
+		free(row);
+	}
+	return 0;
+}
@@ -74,6 +74,7 @@
 #include "ldmsd_plugattr.h"
 #include "store_common.h"
 #include "store_csv_common.h"
+#include "store_csv_obuf.h"
 
 #define TV_SEC_COL	0
 #define TV_USEC_COL	1
@@ -177,6 +178,7 @@ struct csv_store_handle {
 	int64_t lastflush;
 	int64_t store_count;
 	int64_t byte_count;
+	struct csv_obuf obuf; /* rows not yet written to file */
 	int num_lists; /* Number of list metrics */
 	struct csv_lent *lents;
 	int ref_count; /* number of strgp using the csv file; protected by cfg_lock */
@@ -232,6 +234,15 @@ static char* allocStoreKey(const char* container, const char* schema){
 }
 
 
+/* caller must hold sh->lock */
+static void __csv_drain(struct csv_store_handle *sh)
+{
+	int rc = csv_obuf_drain(&sh->obuf, sh->file);
+	if (rc)
+		ovis_log(mylog, OVIS_LERROR, "Error %d writing to '%s'\n",
+		       rc, sh->path);
+}
+
 struct roll_cb_arg {
 	struct csv_plugin_static *cps;
 	time_t appx;
@@ -289,6 +300,7 @@ static void roll_cb(void *obj, void *cb_arg)
 	}
 
 
+	__csv_drain(s_handle);
 	if (s_handle->file)
 		fflush(s_handle->file);
 	if (s_handle->headerfile)
@@ -883,6 +895,8 @@ static int print_header_from_row(struct csv_store_handle *s_handle,
 	}
 	s_handle->printheader = DONT_PRINT_HEADER;
 
+	/* rows still buffered for the data file go out ahead of the header */
+	__csv_drain(s_handle);
 	fp = s_handle->headerfile;
 	if (!fp){
 		ovis_log(mylog, OVIS_LERROR, "Cannot print header. No headerfile\n");
@@ -942,6 +956,8 @@ static int print_header_from_store(struct csv_store_handle *s_handle, ldms_set_t
 	}
 	s_handle->printheader = DONT_PRINT_HEADER;
 
+	/* rows still buffered for the data file go out ahead of the header */
+	__csv_drain(s_handle);
 	fp = s_handle->headerfile;
 	if (!fp){
 		ovis_log(mylog, OVIS_LERROR, "Cannot print header. No headerfile\n");
@@ -1023,425 +1039,135 @@ open_store(ldmsd_plug_handle_t handle, const char *container, const char* schema
 	return s_handle;
 }
 
-static inline void __print_check(struct csv_store_handle *sh, int rc)
+static inline void __put_udata(struct csv_store_handle *sh, uint64_t udata)
 {
-	if (rc < 0) {
-		ovis_log(mylog, OVIS_LERROR, "Error %d writing to '%s'\n",
-		       rc, sh->path);
-	} else {
-		sh->byte_count += rc;
+	if (sh->udata) {
+		csv_obuf_c(&sh->obuf, ',');
+		csv_obuf_u64(&sh->obuf, udata);
 	}
 }
 
+/* ",<v>", preceded by the udata column if enabled */
+#define __STORE_SCALAR(sh, udata, put, v) do { \
+	__put_udata(sh, udata); \
+	csv_obuf_c(&(sh)->obuf, ','); \
+	put(&(sh)->obuf, v); \
+} while (0)
+
+/*
+ * An array either expands to one column (with its own udata) per element,
+ * or becomes a single quoted column with one udata.
+ */
+#define __STORE_ARRAY(sh, udata, count, put, a, lq, sep, rq) do { \
+	struct csv_obuf *__ob = &(sh)->obuf; \
+	if ((sh)->expand_array) { \
+		for (i = 0; i < (count); i++) { \
+			__put_udata(sh, udata); \
+			csv_obuf_c(__ob, ','); \
+			put(__ob, (a)[i]); \
+		} \
+	} else { \
+		__put_udata(sh, udata); \
+		for (i = 0; i < (count); i++) { \
+			if (i == 0) { \
+				csv_obuf_c(__ob, ','); \
+				csv_obuf_c(__ob, lq); \
+			} else { \
+				csv_obuf_c(__ob, sep); \
+			} \
+			put(__ob, (a)[i]); \
+		} \
+		csv_obuf_c(__ob, rq); \
+	} \
+} while (0)
+
+#define __STORE_CSV_ARRAY(sh, udata, count, put, a) \
+	__STORE_ARRAY(sh, udata, count, put, a, \
+		      (sh)->array_lquote, (sh)->array_sep, (sh)->array_rquote)
+
+/*
+ * Appends the metric to the handle output buffer; the caller accounts for
+ * the bytes in byte_count.
+ */
 static void
 store_metric(struct csv_store_handle *sh, const char *wsqt, uint64_t udata,
 		enum ldms_value_type mtype, size_t count, ldms_mval_t mval)
 {
-	int rc, i;
+	int i;
 	ldms_mval_t v;
 	switch (mtype) {
 	case LDMS_V_CHAR_ARRAY:
-		if (sh->udata) {
-			rc = fprintf(sh->file, ",%"PRIu64, udata);
-			__print_check(sh, rc);
-		}
+		__put_udata(sh, udata);
 		/* our csv does not included embedded nuls */
-		rc = fprintf(sh->file, ",%s%s%s", wsqt, mval->a_char, wsqt);
-		__print_check(sh, rc);
+		csv_obuf_c(&sh->obuf, ',');
+		csv_obuf_str(&sh->obuf, wsqt);
+		csv_obuf_str(&sh->obuf, mval->a_char);
+		csv_obuf_str(&sh->obuf, wsqt);
 		break;
 	case LDMS_V_CHAR:
-		if (sh->udata) {
-			rc = fprintf(sh->file, ",%"PRIu64, udata);
-			__print_check(sh, rc);
-		}
-		rc = fprintf(sh->file, ",%c", mval->v_char);
-		__print_check(sh, rc);
+		__STORE_SCALAR(sh, udata, csv_obuf_c, mval->v_char);
 		break;
 	case LDMS_V_U8_ARRAY:
-		if (sh->expand_array) {
-			for (i = 0; i < count; i++){
-				if (sh->udata) {
-					rc = fprintf(sh->file, ",%"PRIu64, udata);
-					__print_check(sh, rc);
-				}
-				rc = fprintf(sh->file, ",%hhu", mval->a_u8[i]);
-				__print_check(sh, rc);
-			}
-		} else {
-			if (sh->udata) {
-				rc = fprintf(sh->file, ",%"PRIu64, udata);
-				__print_check(sh, rc);
-			}
-			for (i = 0; i < count; i++) {
-				if (i == 0) {
-					rc = fprintf(sh->file, ",%c%hhu",
-							sh->array_lquote,
-							mval->a_u8[i]);
-				} else {
-					rc = fprintf(sh->file, "%c%hhu",
-							sh->array_sep,
-							mval->a_u8[i]);
-				}
-				__print_check(sh, rc);
-			}
-			rc = fprintf(sh->file, "%c", sh->array_rquote);
-			__print_check(sh, rc);
-		}
+		__STORE_CSV_ARRAY(sh, udata, count, csv_obuf_u64, mval->a_u8);
 		break;
 	case LDMS_V_U8:
-		if (sh->udata) {
-			rc = fprintf(sh->file, ",%"PRIu64, udata);
-			__print_check(sh, rc);
-		}
-		rc = fprintf(sh->file, ",%hhu", mval->v_u8);
-		__print_check(sh, rc);
+		__STORE_SCALAR(sh, udata, csv_obuf_u64, mval->v_u8);
 		break;
 	case LDMS_V_S8_ARRAY:
-		if (sh->expand_array) {
-			for (i = 0; i < count; i++) {
-				if (sh->udata) {
-					rc = fprintf(sh->file, ",%"PRIu64, udata);
-					__print_check(sh, rc);
-				}
-				rc = fprintf(sh->file, ",%hhd", mval->a_s8[i]);
-				__print_check(sh, rc);
-			}
-		} else {
-			if (sh->udata) {
-				rc = fprintf(sh->file, ",%"PRIu64, udata);
-				__print_check(sh, rc);
-			}
-			for (i = 0; i < count; i++) {
-				if (i == 0) {
-					rc = fprintf(sh->file, ",%c%hhd",
-							sh->array_lquote,
-							mval->a_s8[i]);
-				} else {
-					rc = fprintf(sh->file, "%c%hhd",
-							sh->array_sep,
-							mval->a_s8[i]);
-				}
-				__print_check(sh, rc);
-			}
-			rc = fprintf(sh->file, "%c", sh->array_rquote);
-			__print_check(sh, rc);
-		}
+		__STORE_CSV_ARRAY(sh, udata, count, csv_obuf_s64, mval->a_s8);
 		break;
 	case LDMS_V_S8:
-		if (sh->udata) {
-			rc = fprintf(sh->file, ",%"PRIu64, udata);
-			__print_check(sh, rc);
-		}
-		rc = fprintf(sh->file, ",%hhd", mval->v_s8);
-		__print_check(sh, rc);
+		__STORE_SCALAR(sh, udata, csv_obuf_s64, mval->v_s8);
 		break;
 	case LDMS_V_U16_ARRAY:
-		if (sh->expand_array) {
-			for (i = 0; i < count; i++) {
-				if (sh->udata) {
-					rc = fprintf(sh->file, ",%"PRIu64, udata);
-					__print_check(sh, rc);
-				}
-				rc = fprintf(sh->file, ",%hu", mval->a_u16[i]);
-				__print_check(sh, rc);
-			}
-		} else {
-			if (sh->udata) {
-				rc = fprintf(sh->file, ",%"PRIu64, udata);
-				__print_check(sh, rc);
-			}
-			for (i = 0; i < count; i++) {
-				if (i == 0) {
-					rc = fprintf(sh->file, ",%c%hu",
-							sh->array_lquote,
-							mval->a_u16[i]);
-				} else {
-					rc = fprintf(sh->file, "%c%hu",
-							sh->array_sep,
-							mval->a_u16[i]);
-				}
-				__print_check(sh, rc);
-			}
-			rc = fprintf(sh->file, "%c", sh->array_rquote);
-			__print_check(sh, rc);
-		}
+		__STORE_CSV_ARRAY(sh, udata, count, csv_obuf_u64, mval->a_u16);
 		break;
 	case LDMS_V_U16:
-		if (sh->udata) {
-			rc = fprintf(sh->file, ",%"PRIu64, udata);
-			__print_check(sh, rc);
-		}
-		rc = fprintf(sh->file, ",%hu", mval->v_u16);
-		__print_check(sh, rc);
+		__STORE_SCALAR(sh, udata, csv_obuf_u64, mval->v_u16);
 		break;
 	case LDMS_V_S16_ARRAY:
-		if (sh->expand_array) {
-			for (i = 0; i < count; i++) {
-				if (sh->udata) {
-					rc = fprintf(sh->file, ",%"PRIu64, udata);
-					__print_check(sh, rc);
-				}
-				rc = fprintf(sh->file, ",%hd", mval->a_s16[i]);
-				__print_check(sh, rc);
-			}
-		} else {
-			if (sh->udata) {
-				rc = fprintf(sh->file, ",%"PRIu64, udata);
-				__print_check(sh, rc);
-			}
-			for (i = 0; i < count; i++) {
-				if (i == 0) {
-					rc = fprintf(sh->file, ",%c%hd",
-							sh->array_lquote,
-							mval->a_s16[i]);
-				} else {
-					rc = fprintf(sh->file, "%c%hd",
-							sh->array_sep,
-							mval->a_s16[i]);
-				}
-				__print_check(sh, rc);
-			}
-			rc = fprintf(sh->file, "%c", sh->array_rquote);
-			__print_check(sh, rc);
-		}
+		__STORE_CSV_ARRAY(sh, udata, count, csv_obuf_s64, mval->a_s16);
 		break;
 	case LDMS_V_S16:
-		if (sh->udata) {
-			rc = fprintf(sh->file, ",%"PRIu64, udata);
-			__print_check(sh, rc);
-		}
-		rc = fprintf(sh->file, ",%hd", mval->v_s16);
-		__print_check(sh, rc);
+		__STORE_SCALAR(sh, udata, csv_obuf_s64, mval->v_s16);
 		break;
 	case LDMS_V_U32_ARRAY:
-		if (sh->expand_array) {
-			for (i = 0; i < count; i++) {
-				if (sh->udata) {
-					rc = fprintf(sh->file, ",%"PRIu64, udata);
-					__print_check(sh, rc);
-				}
-				rc = fprintf(sh->file, ",%" PRIu32, mval->a_u32[i]);
-				__print_check(sh, rc);
-			}
-		} else {
-			if (sh->udata) {
-				rc = fprintf(sh->file, ",%"PRIu64, udata);
-				__print_check(sh, rc);
-			}
-			for (i = 0; i < count; i++) {
-				if (i == 0) {
-					rc = fprintf(sh->file, ",%c%" PRIu32,
-							sh->array_lquote,
-							mval->a_u32[i]);
-				} else {
-					rc = fprintf(sh->file, "%c%" PRIu32,
-							sh->array_sep,
-							mval->a_u32[i]);
-				}
-				__print_check(sh, rc);
-			}
-			rc = fprintf(sh->file, "%c", sh->array_rquote);
-			__print_check(sh, rc);
-		}
+		__STORE_CSV_ARRAY(sh, udata, count, csv_obuf_u64, mval->a_u32);
 		break;
 	case LDMS_V_U32:
-		if (sh->udata) {
-			rc = fprintf(sh->file, ",%"PRIu64, udata);
-			__print_check(sh, rc);
-		}
-		rc = fprintf(sh->file, ",%" PRIu32, mval->v_u32);
-		__print_check(sh, rc);
+		__STORE_SCALAR(sh, udata, csv_obuf_u64, mval->v_u32);
 		break;
 	case LDMS_V_S32_ARRAY:
-		if (sh->expand_array) {
-			for (i = 0; i < count; i++) {
-				if (sh->udata) {
-					rc = fprintf(sh->file, ",%"PRIu64, udata);
-					__print_check(sh, rc);
-				}
-				rc = fprintf(sh->file, ",%" PRId32, mval->a_s32[i]);
-				__print_check(sh, rc);
-			}
-		} else {
-			if (sh->udata) {
-				rc = fprintf(sh->file, ",%"PRIu64, udata);
-				__print_check(sh, rc);
-			}
-			for (i = 0; i < count; i++) {
-				if (i == 0) {
-					rc = fprintf(sh->file, ",%c%" PRId32,
-							sh->array_lquote,
-							mval->a_s32[i]);
-				} else {
-					rc = fprintf(sh->file, "%c%" PRId32,
-							sh->array_sep,
-							mval->a_s32[i]);
-				}
-				__print_check(sh, rc);
-			}
-			rc = fprintf(sh->file, "%c", sh->array_rquote);
-			__print_check(sh, rc);
-		}
+		__STORE_CSV_ARRAY(sh, udata, count, csv_obuf_s64, mval->a_s32);
 		break;
 	case LDMS_V_S32:
-		if (sh->udata) {
-			rc = fprintf(sh->file, ",%"PRIu64, udata);
-			__print_check(sh, rc);
-		}
-		rc = fprintf(sh->file, ",%" PRId32, mval->v_s32);
-		__print_check(sh, rc);
+		__STORE_SCALAR(sh, udata, csv_obuf_s64, mval->v_s32);
 		break;
 	case LDMS_V_U64_ARRAY:
-		if (sh->expand_array) {
-			for (i = 0; i < count; i++) {
-				if (sh->udata) {
-					rc = fprintf(sh->file, ",%"PRIu64, udata);
-					__print_check(sh, rc);
-				}
-				rc = fprintf(sh->file, ",%" PRIu64, mval->a_u64[i]);
-				__print_check(sh, rc);
-			}
-		} else {
-			if (sh->udata) {
-				rc = fprintf(sh->file, ",%"PRIu64, udata);
-				__print_check(sh, rc);
-			}
-			for (i = 0; i < count; i++) {
-				if (i == 0) {
-					rc = fprintf(sh->file, ",%c%" PRIu64,
-							sh->array_lquote,
-							mval->a_u64[i]);
-				} else {
-					rc = fprintf(sh->file, "%c%" PRIu64,
-							sh->array_sep,
-							mval->a_u64[i]);
-				}
-				__print_check(sh, rc);
-			}
-			rc = fprintf(sh->file, "%c", sh->array_rquote);
-			__print_check(sh, rc);
-		}
+		__STORE_CSV_ARRAY(sh, udata, count, csv_obuf_u64, mval->a_u64);
 		break;
 	case LDMS_V_U64:
-		if (sh->udata) {
-			rc = fprintf(sh->file, ",%"PRIu64, udata);
-			__print_check(sh, rc);
-		}
-		rc = fprintf(sh->file, ",%"PRIu64, mval->v_u64);
-		__print_check(sh, rc);
+		__STORE_SCALAR(sh, udata, csv_obuf_u64, mval->v_u64);
 		break;
 	case LDMS_V_S64_ARRAY:
-		if (sh->expand_array) {
-			for (i = 0; i < count; i++) {
-				if (sh->udata) {
-					rc = fprintf(sh->file, ",%"PRIu64, udata);
-					__print_check(sh, rc);
-				}
-				rc = fprintf(sh->file, ",%" PRId64, mval->a_s64[i]);
-				__print_check(sh, rc);
-			}
-		} else {
-			if (sh->udata) {
-				rc = fprintf(sh->file, ",%"PRIu64, udata);
-				__print_check(sh, rc);
-			}
-			for (i = 0; i < count; i++) {
-				if (i == 0) {
-					rc = fprintf(sh->file, ",\"%" PRId64, mval->a_s64[i]);
-				} else {
-					rc = fprintf(sh->file, ",%" PRId64, mval->a_s64[i]);
-				}
-				__print_check(sh, rc);
-			}
-			rc = fprintf(sh->file, "\"");
-			__print_check(sh, rc);
-		}
+		/* s64 arrays have always been written with '"' and ',' */
+		__STORE_ARRAY(sh, udata, count, csv_obuf_s64, mval->a_s64,
+			      '"', ',', '"');
 		break;
 	case LDMS_V_S64:
-		if (sh->udata) {
-			rc = fprintf(sh->file, ",%"PRIu64, udata);
-			__print_check(sh, rc);
-		}
-		rc = fprintf(sh->file, ",%" PRId64, mval->v_s64);
-		__print_check(sh, rc);
+		__STORE_SCALAR(sh, udata, csv_obuf_s64, mval->v_s64);
 		break;
 	case LDMS_V_F32_ARRAY:
-		if (sh->expand_array) {
-			for (i = 0; i < count; i++) {
-				if (sh->udata) {
-					rc = fprintf(sh->file, ",%"PRIu64, udata);
-					__print_check(sh, rc);
-				}
-				rc = fprintf(sh->file, ",%.9g", mval->a_f[i]);
-				__print_check(sh, rc);
-			}
-		} else {
-			if (sh->udata) {
-				rc = fprintf(sh->file, ",%"PRIu64, udata);
-				__print_check(sh, rc);
-			}
-			for (i = 0; i < count; i++) {
-				if (i == 0) {
-					rc = fprintf(sh->file, ",%c%.9g",
-							sh->array_lquote,
-							mval->a_f[i]);
-				} else {
-					rc = fprintf(sh->file, "%c%.9g",
-							sh->array_sep,
-							mval->a_f[i]);
-				}
-				__print_check(sh, rc);
-			}
-			rc = fprintf(sh->file, "%c", sh->array_rquote);
-			__print_check(sh, rc);
-		}
+		__STORE_CSV_ARRAY(sh, udata, count, csv_obuf_f32, mval->a_f);
 		break;
 	case LDMS_V_F32:
-		if (sh->udata) {
-			rc = fprintf(sh->file, ",%"PRIu64, udata);
-			__print_check(sh, rc);
-		}
-		rc = fprintf(sh->file, ",%.9g", mval->v_f);
-		__print_check(sh, rc);
+		__STORE_SCALAR(sh, udata, csv_obuf_f32, mval->v_f);
 		break;
 	case LDMS_V_D64_ARRAY:
-		if (sh->expand_array) {
-			for (i = 0; i < count; i++) {
-				if (sh->udata) {
-					rc = fprintf(sh->file, ",%"PRIu64, udata);
-					__print_check(sh, rc);
-				}
-				rc = fprintf(sh->file, ",%.17g", mval->a_d[i]);
-				__print_check(sh, rc);
-			}
-		} else {
-			if (sh->udata) {
-				rc = fprintf(sh->file, ",%"PRIu64, udata);
-				__print_check(sh, rc);
-			}
-			for (i = 0; i < count; i++) {
-				if (i == 0) {
-					rc = fprintf(sh->file, ",%c%.17g",
-							sh->array_lquote,
-							mval->a_d[i]);
-				} else {
-					rc = fprintf(sh->file, "%c%.17g",
-							sh->array_sep,
-							mval->a_d[i]);
-				}
-				__print_check(sh, rc);
-			}
-			rc = fprintf(sh->file, "%c", sh->array_rquote);
-			__print_check(sh, rc);
-		}
+		__STORE_CSV_ARRAY(sh, udata, count, csv_obuf_d64, mval->a_d);
 		break;
 	case LDMS_V_D64:
-		if (sh->udata) {
-			rc = fprintf(sh->file, ",%"PRIu64, udata);
-			__print_check(sh, rc);
-		}
-		rc = fprintf(sh->file, ",%.17g", mval->v_d);
-		__print_check(sh, rc);
+		__STORE_SCALAR(sh, udata, csv_obuf_d64, mval->v_d);
 		break;
 	case LDMS_V_RECORD_INST:
 		for (i = 0; i < ldms_record_card(mval); i++) {
@@ -1453,12 +1179,9 @@ store_metric(struct csv_store_handle *sh, const char *wsqt, uint64_t udata,
 	default:
 		ovis_log(mylog, OVIS_LERROR, "Received unrecognized metric value type %d\n", mtype);
 		/* print no value */
-		if (sh->udata) {
-			rc = fprintf(sh->file, ",");
-			__print_check(sh, rc);
-		}
-		rc = fprintf(sh->file, ",");
-		__print_check(sh, rc);
+		if (sh->udata)
+			csv_obuf_c(&sh->obuf, ',');
+		csv_obuf_c(&sh->obuf, ',');
 		break;
 	}
 }
@@ -1471,21 +1194,24 @@ store_time_job_app(struct csv_store_handle *sh, const struct ldms_timestamp *ts,
 	if (sh->time_format == TF_MILLISEC) {
 		/* Alternate time format. First field is milliseconds-since-epoch,
 		   and the second field is the left-over microseconds */
-		fprintf(sh->file, "%"PRIu64",%"PRIu32,
-			((uint64_t)ts->sec * 1000) + (ts->usec / 1000),
-			ts->usec % 1000);
+		csv_obuf_u64(&sh->obuf,
+			((uint64_t)ts->sec * 1000) + (ts->usec / 1000));
+		csv_obuf_c(&sh->obuf, ',');
+		csv_obuf_u64(&sh->obuf, ts->usec % 1000);
 	} else {
 		/* Traditional time format, where the first field is
 		   <seconds>.<microseconds>, second is microseconds repeated */
-		fprintf(sh->file, "%"PRIu32".%06"PRIu32 ",%"PRIu32,
-			ts->sec, ts->usec, ts->usec);
+		csv_obuf_u64(&sh->obuf, ts->sec);
+		csv_obuf_c(&sh->obuf, '.');
+		csv_obuf_u64w(&sh->obuf, ts->usec, 6);
+		csv_obuf_c(&sh->obuf, ',');
+		csv_obuf_u64(&sh->obuf, ts->usec);
 	}
 	pname = ldms_set_producer_name_get(set);
+	csv_obuf_c(&sh->obuf, ',');
 	if (pname != NULL){
-		fprintf(sh->file, ",%s", pname);
+		csv_obuf_str(&sh->obuf, pname);
 		sh->byte_count += strlen(pname);
-	} else {
-		fprintf(sh->file, ",");
 	}
 }
 
@@ -1594,7 +1320,9 @@ static int store(ldmsd_plug_handle_t handle, ldmsd_store_handle_t _s_handle, ldm
 	struct csv_lent *lents = s_handle->lents;
 	do {
 		int lidx = 0;
+		size_t row_off;
 		store_time_job_app(s_handle, ts, set);
+		row_off = s_handle->obuf.len;
 		for (i = 0; i < metric_count; i++) {
 			mval = ldms_metric_get(set, metric_array[i]);
 			udata = ldms_metric_user_data_get(set, metric_array[i]);
@@ -1653,7 +1381,8 @@ static int store(ldmsd_plug_handle_t handle, ldmsd_store_handle_t _s_handle, ldm
 					     metric_type, count, mval);
 			}
 		}
-		fprintf(s_handle->file,"\n");
+		s_handle->byte_count += s_handle->obuf.len - row_off;
+		csv_obuf_c(&s_handle->obuf, '\n');
 	} while (done < s_handle->num_lists);
 
 	s_handle->store_count++;
@@ -1670,8 +1399,12 @@ static int store(ldmsd_plug_handle_t handle, ldmsd_store_handle_t _s_handle, ldm
 		doflush = 1;
 	}
 	if ((s_handle->buffer_sz == 0) || doflush){
+		__csv_drain(s_handle);
 		fflush(s_handle->file);
 		fsync(fileno(s_handle->file));
+	} else if (s_handle->obuf.len >= CSV_OBUF_DRAIN_SZ ||
+		   s_handle->obuf.err) {
+		__csv_drain(s_handle);
 	}
 	pthread_mutex_unlock(&s_handle->lock);
 
@@ -1686,6 +1419,7 @@ static int flush_store(ldmsd_plug_handle_t handle, ldmsd_store_handle_t _s_handl
 		return -1;
 	}
 	pthread_mutex_lock(&s_handle->lock);
+	__csv_drain(s_handle);
 	fflush(s_handle->file);
 	pthread_mutex_unlock(&s_handle->lock);
 	return 0;
@@ -1697,6 +1431,8 @@ static void __csv_handle_close(struct csv_store_handle *s_handle)
 	pthread_mutex_lock(&s_handle->lock);
 	ovis_log(mylog, OVIS_LDEBUG, "Closing with path <%s>\n",
 	       s_handle->path);
+	__csv_drain(s_handle);
+	csv_obuf_free(&s_handle->obuf);
 	fflush(s_handle->file);
 	if (s_handle->path)
 		free(s_handle->path);
@@ -2000,135 +1736,149 @@ typedef struct csv_store_col_info_s {
 	int i;
 } *csv_store_col_info_t;
 
-typedef int (*csv_store_col_fn)(csv_store_col_info_t ci);
+typedef void (*csv_store_col_fn)(csv_store_col_info_t ci);
 
-static int store_col_char(csv_store_col_info_t ci)
+/* appends "<udata><sep>" and returns the handle output buffer */
+static inline struct csv_obuf *store_col_prefix(csv_store_col_info_t ci)
 {
-	return fprintf(ci->s_handle->file, "%s%s%c", ci->ustr, ci->sep, ci->v->v_char);
+	struct csv_obuf *ob = &ci->s_handle->obuf;
+	csv_obuf_str(ob, ci->ustr);
+	csv_obuf_str(ob, ci->sep);
+	return ob;
 }
 
-static int store_col_u8(csv_store_col_info_t ci)
+static void store_col_char(csv_store_col_info_t ci)
 {
-	return fprintf(ci->s_handle->file, "%s%s%hhu", ci->ustr, ci->sep, ci->v->v_u8);
+	csv_obuf_c(store_col_prefix(ci), ci->v->v_char);
 }
 
-static int store_col_s8(csv_store_col_info_t ci)
+static void store_col_u8(csv_store_col_info_t ci)
 {
-	return fprintf(ci->s_handle->file, "%s%s%hhd", ci->ustr, ci->sep, ci->v->v_s8);
+	csv_obuf_u64(store_col_prefix(ci), ci->v->v_u8);
 }
 
-static int store_col_u16(csv_store_col_info_t ci)
+static void store_col_s8(csv_store_col_info_t ci)
 {
-	return fprintf(ci->s_handle->file, "%s%s%hu", ci->ustr, ci->sep, ci->v->v_u16);
+	csv_obuf_s64(store_col_prefix(ci), ci->v->v_s8);
 }
 
-static int store_col_s16(csv_store_col_info_t ci)
+static void store_col_u16(csv_store_col_info_t ci)
 {
-	return fprintf(ci->s_handle->file, "%s%s%hd", ci->ustr, ci->sep, ci->v->v_s16);
+	csv_obuf_u64(store_col_prefix(ci), ci->v->v_u16);
 }
 
-static int store_col_u32(csv_store_col_info_t ci)
+static void store_col_s16(csv_store_col_info_t ci)
 {
-	return fprintf(ci->s_handle->file, "%s%s%u", ci->ustr, ci->sep, ci->v->v_u32);
+	csv_obuf_s64(store_col_prefix(ci), ci->v->v_s16);
 }
 
-static int store_col_s32(csv_store_col_info_t ci)
+static void store_col_u32(csv_store_col_info_t ci)
 {
-	return fprintf(ci->s_handle->file, "%s%s%d", ci->ustr, ci->sep, ci->v->v_s32);
+	csv_obuf_u64(store_col_prefix(ci), ci->v->v_u32);
 }
 
-static int store_col_u64(csv_store_col_info_t ci)
+static void store_col_s32(csv_store_col_info_t ci)
 {
-	return fprintf(ci->s_handle->file, "%s%s%lu", ci->ustr, ci->sep, ci->v->v_u64);
+	csv_obuf_s64(store_col_prefix(ci), ci->v->v_s32);
 }
 
-static int store_col_s64(csv_store_col_info_t ci)
+static void store_col_u64(csv_store_col_info_t ci)
 {
-	return fprintf(ci->s_handle->file, "%s%s%ld", ci->ustr, ci->sep, ci->v->v_s64);
+	csv_obuf_u64(store_col_prefix(ci), ci->v->v_u64);
 }
 
-static int store_col_f(csv_store_col_info_t ci)
+static void store_col_s64(csv_store_col_info_t ci)
 {
-	return fprintf(ci->s_handle->file, "%s%s%f", ci->ustr, ci->sep, ci->v->v_f);
+	csv_obuf_s64(store_col_prefix(ci), ci->v->v_s64);
 }
 
-static int store_col_d(csv_store_col_info_t ci)
+static void store_col_f(csv_store_col_info_t ci)
 {
-	return fprintf(ci->s_handle->file, "%s%s%f", ci->ustr, ci->sep, ci->v->v_d);
+	csv_obuf_fixed(store_col_prefix(ci), ci->v->v_f);
 }
 
-static int store_col_ts(csv_store_col_info_t ci)
+static void store_col_d(csv_store_col_info_t ci)
 {
+	csv_obuf_fixed(store_col_prefix(ci), ci->v->v_d);
+}
+
+static void store_col_ts(csv_store_col_info_t ci)
+{
+	struct csv_obuf *ob = store_col_prefix(ci);
 	if (ci->s_handle->time_format == TF_MILLISEC) {
 		/* Alternate time format. First field is milliseconds-since-epoch,
 		   and the second field is the left-over microseconds */
-		return fprintf(ci->s_handle->file, "%s%s%lu,%u",
-				ci->ustr, ci->sep,
-				((uint64_t)ci->v->v_ts.sec * 1000) + (ci->v->v_ts.usec / 1000),
-				ci->v->v_ts.usec % 1000);
+		csv_obuf_u64(ob, ((uint64_t)ci->v->v_ts.sec * 1000) +
+				 (ci->v->v_ts.usec / 1000));
+		csv_obuf_c(ob, ',');
+		csv_obuf_u64(ob, ci->v->v_ts.usec % 1000);
 	} else {
 		/* Traditional time format, where the first field is
 		   <seconds>.<microseconds>, second is microseconds repeated */
-		return fprintf(ci->s_handle->file, "%s%s%u.%06u,%u",
-				ci->ustr, ci->sep, ci->v->v_ts.sec,
-				ci->v->v_ts.usec, ci->v->v_ts.usec);
+		csv_obuf_u64(ob, ci->v->v_ts.sec);
+		csv_obuf_c(ob, '.');
+		csv_obuf_u64w(ob, ci->v->v_ts.usec, 6);
+		csv_obuf_c(ob, ',');
+		csv_obuf_u64(ob, ci->v->v_ts.usec);
 	}
 }
 
-static int store_col_char_array(csv_store_col_info_t ci)
+static void store_col_char_array(csv_store_col_info_t ci)
 {
-	return fprintf(ci->s_handle->file, "%s%s%s%s%s",
-			ci->ustr, ci->sep, ci->wsqt, ci->v->a_char, ci->wsqt);
+	struct csv_obuf *ob = store_col_prefix(ci);
+	csv_obuf_str(ob, ci->wsqt);
+	csv_obuf_str(ob, ci->v->a_char);
+	csv_obuf_str(ob, ci->wsqt);
 }
 
-static int store_col_u8_array(csv_store_col_info_t ci)
+static void store_col_u8_array(csv_store_col_info_t ci)
 {
-	return fprintf(ci->s_handle->file, "%s%s%hhu", ci->ustr, ci->sep, ci->v->a_u8[ci->i]);
+	csv_obuf_u64(store_col_prefix(ci), ci->v->a_u8[ci->i]);
 }
 
-static int store_col_s8_array(csv_store_col_info_t ci)
+static void store_col_s8_array(csv_store_col_info_t ci)
 {
-	return fprintf(ci->s_handle->file, "%s%s%hhd", ci->ustr, ci->sep, ci->v->a_s8[ci->i]);
+	csv_obuf_s64(store_col_prefix(ci), ci->v->a_s8[ci->i]);
 }
 
-static int store_col_u16_array(csv_store_col_info_t ci)
+static void store_col_u16_array(csv_store_col_info_t ci)
 {
-	return fprintf(ci->s_handle->file, "%s%s%hu", ci->ustr, ci->sep, ci->v->a_u16[ci->i]);
+	csv_obuf_u64(store_col_prefix(ci), ci->v->a_u16[ci->i]);
 }
 
-static int store_col_s16_array(csv_store_col_info_t ci)
+static void store_col_s16_array(csv_store_col_info_t ci)
 {
-	return fprintf(ci->s_handle->file, "%s%s%hd", ci->ustr, ci->sep, ci->v->a_s16[ci->i]);
+	csv_obuf_s64(store_col_prefix(ci), ci->v->a_s16[ci->i]);
 }
 
-static int store_col_u32_array(csv_store_col_info_t ci)
+static void store_col_u32_array(csv_store_col_info_t ci)
 {
-	return fprintf(ci->s_handle->file, "%s%s%u", ci->ustr, ci->sep, ci->v->a_u32[ci->i]);
+	csv_obuf_u64(store_col_prefix(ci), ci->v->a_u32[ci->i]);
 }
 
-static int store_col_s32_array(csv_store_col_info_t ci)
+static void store_col_s32_array(csv_store_col_info_t ci)
 {
-	return fprintf(ci->s_handle->file, "%s%s%d", ci->ustr, ci->sep, ci->v->a_s32[ci->i]);
+	csv_obuf_s64(store_col_prefix(ci), ci->v->a_s32[ci->i]);
 }
 
-static int store_col_u64_array(csv_store_col_info_t ci)
+static void store_col_u64_array(csv_store_col_info_t ci)
 {
-	return fprintf(ci->s_handle->file, "%s%s%lu", ci->ustr, ci->sep, ci->v->a_u64[ci->i]);
+	csv_obuf_u64(store_col_prefix(ci), ci->v->a_u64[ci->i]);
 }
 
-static int store_col_s64_array(csv_store_col_info_t ci)
+static void store_col_s64_array(csv_store_col_info_t ci)
 {
-	return fprintf(ci->s_handle->file, "%s%s%ld", ci->ustr, ci->sep, ci->v->a_s64[ci->i]);
+	csv_obuf_s64(store_col_prefix(ci), ci->v->a_s64[ci->i]);
 }
 
-static int store_col_f_array(csv_store_col_info_t ci)
+static void store_col_f_array(csv_store_col_info_t ci)
 {
-	return fprintf(ci->s_handle->file, "%s%s%.9g", ci->ustr, ci->sep, ci->v->a_f[ci->i]);
+	csv_obuf_f32(store_col_prefix(ci), ci->v->a_f[ci->i]);
 }
 
-static int store_col_d_array(csv_store_col_info_t ci)
+static void store_col_d_array(csv_store_col_info_t ci)
 {
-	return fprintf(ci->s_handle->file, "%s%s%.17g", ci->ustr, ci->sep, ci->v->a_d[ci->i]);
+	csv_obuf_d64(store_col_prefix(ci), ci->v->a_d[ci->i]);
 }
 
 csv_store_col_fn __store_col_fn_tbl[] = {
@@ -2163,7 +1913,8 @@ static int store_col(ldms_set_t set, struct csv_store_handle *s_handle,
 		     ldmsd_col_t col, int is_first)
 {
 	uint64_t udata;
-	int rc = 0, i, len;
+	int rc = 0, i;
+	size_t off = s_handle->obuf.len;
 	const char *ustr = "";
 	char udata_str[64] = "";
 	char udata_str_arr[64] = ""; /* for array elements */
@@ -2196,13 +1947,7 @@ static int store_col(ldms_set_t set, struct csv_store_handle *s_handle,
 		/* array */
 		for (i = 0; i < col->array_len; i++) {
 			ci.i = i;
-			len = col_fn(&ci);
-			if (len < 0) {
-				rc = errno;
-				ERR_LOG("Error %d writing to '%s'\n", errno, s_handle->filename);
-			} else {
-				s_handle->byte_count += len;
-			}
+			col_fn(&ci);
 			if (i == 0) {
 				/* make sure to have "," for the rest */
 				ci.ustr = udata_str_arr;
@@ -2211,13 +1956,13 @@ static int store_col(ldms_set_t set, struct csv_store_handle *s_handle,
 		}
 	} else {
 		/* single value */
-		len = col_fn(&ci);
-		if (len < 0) {
-			rc = errno;
-			ERR_LOG("Error %d writing to '%s'\n", errno, s_handle->filename);
-		} else {
-			s_handle->byte_count += len;
-		}
+		col_fn(&ci);
+	}
+	if (s_handle->obuf.err) {
+		rc = s_handle->obuf.err;
+		ERR_LOG("Error %d writing to '%s'\n", rc, s_handle->filename);
+	} else {
+		s_handle->byte_count += s_handle->obuf.len - off;
 	}
 
 	return rc;
@@ -2261,7 +2006,7 @@ store_row(ldmsd_strgp_t strgp, ldms_set_t set, struct csv_store_handle *s_handle
 		if (col_rc)
 			rc = col_rc;
 	}
-	fprintf(s_handle->file, "\n");
+	csv_obuf_c(&s_handle->obuf, '\n');
 	int doflush = 0;
 	if ((s_handle->buffer_type == 3) &&
 	    ((s_handle->store_count - s_handle->lastflush) >=
@@ -2275,8 +2020,12 @@ store_row(ldmsd_strgp_t strgp, ldms_set_t set, struct csv_store_handle *s_handle
 		doflush = 1;
 	}
 	if ((s_handle->buffer_sz == 0) || doflush){
+		__csv_drain(s_handle);
 		fflush(s_handle->file);
 		fsync(fileno(s_handle->file));
+	} else if (s_handle->obuf.len >= CSV_OBUF_DRAIN_SZ ||
+		   s_handle->obuf.err) {
+		__csv_drain(s_handle);
 	}
  out:
 	pthread_mutex_unlock(&s_handle->lock);
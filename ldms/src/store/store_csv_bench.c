@@ -0,0 +1,377 @@
+/* -*- c-basic-offset: 8 -*-
+ * Copyright (c) 2026 National Technology & Engineering Solutions
+ * of Sandia, LLC (NTESS). Under the terms of Contract DE-NA0003525 with
+ * NTESS, the U.S. Government retains certain rights in this software.
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Benchmark of the store_csv row writer on a 500-column schema.
+ *
+ * The "fprintf" writer is the loop store_metric() used to have: one
+ * fprintf() per value into the data FILE. The "obuf" writer is the current
+ * one: values are formatted into the handle output buffer, which is
+ * drained with write() every CSV_OBUF_DRAIN_SZ bytes. Both write ROWS rows
+ * to a temporary file and the two files must be byte-for-byte identical.
+ * A sweep of edge values (extremes, -0, NaN, Inf, %g/%f boundaries) is
+ * checked against printf as well. Exits non-zero on any mismatch.
+ *
+ *   store_csv_bench [ROWS]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <float.h>
+#include <time.h>
+#include "store_csv_obuf.h"
+
+#define COL_COUNT	500
+#define ARRAY_LEN	4
+
+enum col_type {
+	COL_U64, COL_S64, COL_U32, COL_D64, COL_F32, COL_U64_ARRAY, COL_LAST,
+};
+
+struct col {
+	enum col_type type;
+	union {
+		uint64_t u64;
+		int64_t s64;
+		uint32_t u32;
+		double d;
+		float f;
+		uint64_t a_u64[ARRAY_LEN];
+	};
+};
+
+static struct col cols[COL_COUNT];
+static const char *pname = "node0001";
+
+static uint64_t rnd_state = 88172645463325252ULL;
+static uint64_t rnd(void)
+{
+	rnd_state ^= rnd_state << 13;
+	rnd_state ^= rnd_state >> 7;
+	rnd_state ^= rnd_state << 17;
+	return rnd_state;
+}
+
+/* counter-like values, like most sampler metrics */
+static void cols_update(uint64_t r)
+{
+	int i, j;
+	for (i = 0; i < COL_COUNT; i++) {
+		struct col *c = &cols[i];
+		c->type = i % COL_LAST;
+		switch (c->type) {
+		case COL_U64:
+			c->u64 = r * 4099 + i * 1000003ULL;
+			break;
+		case COL_S64:
+			c->s64 = (int64_t)(rnd() >> 20) - (1LL << 43);
+			break;
+		case COL_U32:
+			c->u32 = rnd() >> 40;
+			break;
+		case COL_D64:
+			c->d = (i & 8) ? (double)(r * 17 + i) :
+				(double)(rnd() >> 11) / (1 << 20);
+			break;
+		case COL_F32:
+			c->f = (i & 8) ? (float)(r % 100000) :
+				(float)(rnd() >> 40) / 977.0f;
+			break;
+		case COL_U64_ARRAY:
+			for (j = 0; j < ARRAY_LEN; j++)
+				c->a_u64[j] = r * 31 + j;
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+static void row_fprintf(FILE *f, uint32_t sec, uint32_t usec)
+{
+	int i, j;
+	fprintf(f, "%"PRIu32".%06"PRIu32 ",%"PRIu32, sec, usec, usec);
+	fprintf(f, ",%s", pname);
+	for (i = 0; i < COL_COUNT; i++) {
+		struct col *c = &cols[i];
+		switch (c->type) {
+		case COL_U64:
+			fprintf(f, ",%"PRIu64, c->u64);
+			break;
+		case COL_S64:
+			fprintf(f, ",%" PRId64, c->s64);
+			break;
+		case COL_U32:
+			fprintf(f, ",%" PRIu32, c->u32);
+			break;
+		case COL_D64:
+			fprintf(f, ",%.17g", c->d);
+			break;
+		case COL_F32:
+			fprintf(f, ",%.9g", c->f);
+			break;
+		case COL_U64_ARRAY:
+			for (j = 0; j < ARRAY_LEN; j++) {
+				if (j == 0)
+					fprintf(f, ",%c%" PRIu64, '"', c->a_u64[j]);
+				else
+					fprintf(f, "%c%" PRIu64, ',', c->a_u64[j]);
+			}
+			fprintf(f, "%c", '"');
+			break;
+		default:
+			break;
+		}
+	}
+	fprintf(f, "\n");
+}
+
+static void row_obuf(struct csv_obuf *ob, uint32_t sec, uint32_t usec)
+{
+	int i, j;
+	csv_obuf_u64(ob, sec);
+	csv_obuf_c(ob, '.');
+	csv_obuf_u64w(ob, usec, 6);
+	csv_obuf_c(ob, ',');
+	csv_obuf_u64(ob, usec);
+	csv_obuf_c(ob, ',');
+	csv_obuf_str(ob, pname);
+	for (i = 0; i < COL_COUNT; i++) {
+		struct col *c = &cols[i];
+		csv_obuf_c(ob, ',');
+		switch (c->type) {
+		case COL_U64:
+			csv_obuf_u64(ob, c->u64);
+			break;
+		case COL_S64:
+			csv_obuf_s64(ob, c->s64);
+			break;
+		case COL_U32:
+			csv_obuf_u64(ob, c->u32);
+			break;
+		case COL_D64:
+			csv_obuf_d64(ob, c->d);
+			break;
+		case COL_F32:
+			csv_obuf_f32(ob, c->f);
+			break;
+		case COL_U64_ARRAY:
+			csv_obuf_c(ob, '"');
+			for (j = 0; j < ARRAY_LEN; j++) {
+				if (j)
+					csv_obuf_c(ob, ',');
+				csv_obuf_u64(ob, c->a_u64[j]);
+			}
+			csv_obuf_c(ob, '"');
+			break;
+		default:
+			break;
+		}
+	}
+	csv_obuf_c(ob, '\n');
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int check(const char *what, struct csv_obuf *ob, const char *expect)
+{
+	size_t n = strlen(expect);
+	if (ob->len != n || memcmp(ob->buf, expect, n)) {
+		printf("MISMATCH %s: expected '%s', got '%.*s'\n",
+		       what, expect, (int)ob->len, ob->buf);
+		ob->len = 0;
+		return 1;
+	}
+	ob->len = 0;
+	return 0;
+}
+
+static int check_values(void)
+{
+	static const uint64_t u[] = {
+		0, 1, 9, 10, 99, 100, 999999, 1000000, 4294967295ULL,
+		9999999999999999999ULL, 10000000000000000000ULL, UINT64_MAX,
+	};
+	static const int64_t s[] = {
+		0, -1, 1, -10, INT32_MIN, INT32_MAX, INT64_MIN, INT64_MAX,
+	};
+	static const double d[] = {
+		0.0, -0.0, 1.0, -1.0, 0.1, 1e16, 1e17 - 1, 1e17, 1e17 + 16,
+		-1e17, 123456789.0, 999999999.0, 1e9, 1e300, -1e-300,
+		DBL_MIN, DBL_MAX, 5e-324, 1.0/3, 2.5, 0.5, -0.5,
+		9.2233720368547758e18, 1.0/0.0, -1.0/0.0,
+	};
+	struct csv_obuf ob = {0};
+	char expect[512];
+	int i, err = 0;
+
+	for (i = 0; i < sizeof(u)/sizeof(u[0]); i++) {
+		snprintf(expect, sizeof(expect), "%"PRIu64, u[i]);
+		csv_obuf_u64(&ob, u[i]);
+		err += check("u64", &ob, expect);
+		snprintf(expect, sizeof(expect), "%06"PRIu64, u[i]);
+		csv_obuf_u64w(&ob, u[i], 6);
+		err += check("u64w", &ob, expect);
+	}
+	for (i = 0; i < sizeof(s)/sizeof(s[0]); i++) {
+		snprintf(expect, sizeof(expect), "%"PRId64, s[i]);
+		csv_obuf_s64(&ob, s[i]);
+		err += check("s64", &ob, expect);
+	}
+	for (i = 0; i < sizeof(d)/sizeof(d[0]); i++) {
+		snprintf(expect, sizeof(expect), "%.17g", d[i]);
+		csv_obuf_d64(&ob, d[i]);
+		err += check("%.17g", &ob, expect);
+		snprintf(expect, sizeof(expect), "%.9g", (float)d[i]);
+		csv_obuf_f32(&ob, d[i]);
+		err += check("%.9g", &ob, expect);
+		snprintf(expect, sizeof(expect), "%f", d[i]);
+		csv_obuf_fixed(&ob, d[i]);
+		err += check("%f", &ob, expect);
+	}
+	snprintf(expect, sizeof(expect), "%.17g", 0.0/0.0);
+	csv_obuf_d64(&ob, 0.0/0.0);
+	err += check("nan", &ob, expect);
+	for (i = 0; i < 1000000; i++) {
+		uint64_t v = rnd() >> (rnd() % 64);
+		double x = (double)(int64_t)v / ((i & 1) ? 1 : 1024);
+		snprintf(expect, sizeof(expect), "%"PRIu64, v);
+		csv_obuf_u64(&ob, v);
+		err += check("u64", &ob, expect);
+		snprintf(expect, sizeof(expect), "%.17g", x);
+		csv_obuf_d64(&ob, x);
+		err += check("%.17g", &ob, expect);
+		if (err > 10)
+			break;
+	}
+	csv_obuf_free(&ob);
+	return err;
+}
+
+static int files_equal(FILE *a, FILE *b)
+{
+	char ba[65536], bb[65536];
+	size_t na, nb;
+
+	rewind(a);
+	rewind(b);
+	do {
+		na = fread(ba, 1, sizeof(ba), a);
+		nb = fread(bb, 1, sizeof(bb), b);
+		if (na != nb || memcmp(ba, bb, na))
+			return 0;
+	} while (na);
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	int rows = argc > 1 ? atoi(argv[1]) : 20000;
+	struct csv_obuf ob = {0};
+	FILE *f_old, *f_new;
+	double t0, t_old, t_new;
+	uint64_t r;
+	long size;
+	int rc;
+
+	if (check_values())
+		return 1;
+
+	f_old = tmpfile();
+	f_new = tmpfile();
+	if (!f_old || !f_new) {
+		perror("tmpfile");
+		return 1;
+	}
+
+	rnd_state = 88172645463325252ULL;
+	t0 = now();
+	for (r = 0; r < rows; r++) {
+		cols_update(r);
+		row_fprintf(f_old, 1700000000 + r, r % 1000000);
+	}
+	fflush(f_old);
+	t_old = now() - t0;
+
+	rnd_state = 88172645463325252ULL;
+	t0 = now();
+	for (r = 0; r < rows; r++) {
+		cols_update(r);
+		row_obuf(&ob, 1700000000 + r, r % 1000000);
+		if (ob.len >= CSV_OBUF_DRAIN_SZ)
+			csv_obuf_drain(&ob, f_new);
+	}
+	rc = csv_obuf_drain(&ob, f_new);
+	t_new = now() - t0;
+	csv_obuf_free(&ob);
+	if (rc) {
+		printf("write error %d\n", rc);
+		return 1;
+	}
+
+	fseek(f_old, 0, SEEK_END);
+	size = ftell(f_old);
+	printf("%d rows x %d columns, %ld bytes\n", rows, COL_COUNT, size);
+	printf("fprintf: %12.0f rows/sec\n", rows / t_old);
+	printf("obuf:    %12.0f rows/sec (%.2fx)\n", rows / t_new,
+	       t_old / t_new);
+	if (!files_equal(f_old, f_new)) {
+		printf("FAIL: output differs\n");
+		return 1;
+	}
+	printf("output identical\n");
+	return 0;
+}
@@ -0,0 +1,311 @@
+/* -*- c-basic-offset: 8 -*-
+ * Copyright (c) 2026 National Technology & Engineering Solutions
+ * of Sandia, LLC (NTESS). Under the terms of Contract DE-NA0003525 with
+ * NTESS, the U.S. Government retains certain rights in this software.
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * Row output buffer for store_csv.
+ *
+ * store_csv used to issue one fprintf() per value, which for wide schemas
+ * spends most of its time in the stdio format parser and stream lock. The
+ * helpers below append text to a growable per-handle buffer instead, and
+ * csv_obuf_drain() hands the accumulated rows to the kernel with write().
+ *
+ * The text produced is byte-for-byte what the printf conversions used
+ * previously would produce. Integers are converted here; floating point
+ * values take a fast path only when the value is integral (where the %g
+ * and %f conversions are plain integer text) and are otherwise formatted
+ * with snprintf() so the rounding stays exactly that of the C library.
+ */
+#ifndef __STORE_CSV_OBUF_H__
+#define __STORE_CSV_OBUF_H__
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <unistd.h>
+
+/* Drain once this much row text is pending */
+#define CSV_OBUF_DRAIN_SZ (64 * 1024)
+#define CSV_OBUF_MIN_SZ 4096
+
+struct csv_obuf {
+	char *buf;
+	size_t len;
+	size_t cap;
+	int err;	/* sticky allocation error; output is dropped */
+};
+
+static const char csv_obuf_digits[] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+static const uint64_t csv_obuf_pow10[20] = {
+	1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+	10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL,
+	100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+	100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+	100000000000000000ULL, 1000000000000000000ULL,
+	10000000000000000000ULL,
+};
+
+static inline void csv_obuf_free(struct csv_obuf *ob)
+{
+	free(ob->buf);
+	ob->buf = NULL;
+	ob->len = ob->cap = 0;
+	ob->err = 0;
+}
+
+/* Make room for \c n more bytes; returns 0 or ENOMEM */
+static inline int csv_obuf_room(struct csv_obuf *ob, size_t n)
+{
+	size_t cap;
+	char *buf;
+
+	if (ob->len + n <= ob->cap)
+		return 0;
+	if (ob->err)
+		return ob->err;
+	cap = ob->cap ? ob->cap : CSV_OBUF_MIN_SZ;
+	while (cap < ob->len + n)
+		cap <<= 1;
+	buf = realloc(ob->buf, cap);
+	if (!buf) {
+		ob->err = ENOMEM;
+		return ENOMEM;
+	}
+	ob->buf = buf;
+	ob->cap = cap;
+	return 0;
+}
+
+/* Number of decimal digits in \c v */
+static inline int csv_u64_ndigits(uint64_t v)
+{
+	int t = ((64 - __builtin_clzll(v | 1)) * 1233) >> 12;
+	return t + 1 - ((v | 1) < csv_obuf_pow10[t]);
+}
+
+/* Write \c v as exactly \c n digits ending at p + n; returns p + n */
+static inline char *csv_fmt_u64(char *p, uint64_t v, int n)
+{
+	char *q = p + n;
+	while (v >= 100) {
+		unsigned i = (v % 100) * 2;
+		v /= 100;
+		q -= 2;
+		memcpy(q, csv_obuf_digits + i, 2);
+	}
+	if (v >= 10) {
+		q -= 2;
+		memcpy(q, csv_obuf_digits + v * 2, 2);
+	} else {
+		*--q = '0' + v;
+	}
+	while (q > p)
+		*--q = '0';
+	return p + n;
+}
+
+static inline void csv_obuf_c(struct csv_obuf *ob, char c)
+{
+	if (csv_obuf_room(ob, 1))
+		return;
+	ob->buf[ob->len++] = c;
+}
+
+static inline void csv_obuf_mem(struct csv_obuf *ob, const void *s, size_t n)
+{
+	if (csv_obuf_room(ob, n))
+		return;
+	memcpy(ob->buf + ob->len, s, n);
+	ob->len += n;
+}
+
+static inline void csv_obuf_str(struct csv_obuf *ob, const char *s)
+{
+	csv_obuf_mem(ob, s, strlen(s));
+}
+
+/* "%0*" PRIu64; a \c width of 0 is plain "%" PRIu64 */
+static inline void csv_obuf_u64w(struct csv_obuf *ob, uint64_t v, int width)
+{
+	int n = csv_u64_ndigits(v);
+	if (n < width)
+		n = width;
+	if (csv_obuf_room(ob, n))
+		return;
+	csv_fmt_u64(ob->buf + ob->len, v, n);
+	ob->len += n;
+}
+
+static inline void csv_obuf_u64(struct csv_obuf *ob, uint64_t v)
+{
+	csv_obuf_u64w(ob, v, 0);
+}
+
+static inline void csv_obuf_s64(struct csv_obuf *ob, int64_t v)
+{
+	if (v < 0) {
+		csv_obuf_c(ob, '-');
+		csv_obuf_u64(ob, 0 - (uint64_t)v);
+	} else {
+		csv_obuf_u64(ob, v);
+	}
+}
+
+__attribute__((format(printf, 2, 3)))
+static inline void csv_obuf_printf(struct csv_obuf *ob, const char *fmt, ...)
+{
+	va_list ap;
+	size_t room;
+	int n;
+
+	if (csv_obuf_room(ob, 64))
+		return;
+	room = ob->cap - ob->len;
+	va_start(ap, fmt);
+	n = vsnprintf(ob->buf + ob->len, room, fmt, ap);
+	va_end(ap);
+	if (n < 0)
+		return;
+	if ((size_t)n >= room) {
+		if (csv_obuf_room(ob, n + 1))
+			return;
+		va_start(ap, fmt);
+		n = vsnprintf(ob->buf + ob->len, n + 1, fmt, ap);
+		va_end(ap);
+	}
+	ob->len += n;
+}
+
+/*
+ * Integral doubles below 10^prec (and not -0) print under "%.<prec>g"
+ * as their integer digits, without a decimal point or exponent.
+ */
+static inline int __csv_dbl_is_int(double d, double lim)
+{
+	return d > -lim && d < lim && d == (double)(int64_t)d &&
+		!(d == 0 && signbit(d));
+}
+
+/* "%.17g" */
+static inline void csv_obuf_d64(struct csv_obuf *ob, double d)
+{
+	if (__csv_dbl_is_int(d, 1e17))
+		csv_obuf_s64(ob, (int64_t)d);
+	else
+		csv_obuf_printf(ob, "%.17g", d);
+}
+
+/* "%.9g" */
+static inline void csv_obuf_f32(struct csv_obuf *ob, float f)
+{
+	if (__csv_dbl_is_int(f, 1e9))
+		csv_obuf_s64(ob, (int64_t)f);
+	else
+		csv_obuf_printf(ob, "%.9g", f);
+}
+
+/* "%f" */
+static inline void csv_obuf_fixed(struct csv_obuf *ob, double d)
+{
+	if (__csv_dbl_is_int(d, 1e17)) {
+		csv_obuf_s64(ob, (int64_t)d);
+		csv_obuf_mem(ob, ".000000", 7);
+	} else {
+		csv_obuf_printf(ob, "%f", d);
+	}
+}
+
+/*
+ * Write the pending text to \c f. Anything the caller wrote to \c f through
+ * stdio (e.g. a header sharing the data file) is flushed first to keep the
+ * output in order. The buffer is emptied even on error, as stdio would
+ * drop a failed buffer. Returns 0 or an errno.
+ */
+static inline int csv_obuf_drain(struct csv_obuf *ob, FILE *f)
+{
+	size_t off = 0;
+	ssize_t n;
+	int rc = ob->err;
+
+	ob->err = 0;
+	if (!ob->len)
+		return rc;
+	if (!f) {
+		ob->len = 0;
+		return rc ? rc : EBADF;
+	}
+	fflush(f);
+	while (off < ob->len) {
+		n = write(fileno(f), ob->buf + off, ob->len - off);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			rc = errno;
+			break;
+		}
+		off += n;
+	}
+	ob->len = 0;
+	return rc;
+}
+
+#endif
@@ -56,6 +56,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
 #include <stdlib.h>
 #include <stdarg.h>
 #include <linux/limits.h>
@@ -102,6 +103,9 @@ static int rollagain = 0;
 /* rolltype determines how to interpret rollover values > 0. */
 #define DEFAULT_ROLLTYPE -1
 static int rolltype = DEFAULT_ROLLTYPE;
+/* delivery ring of the stream clients; 0 to write from the publisher */
+static uint32_t ring_size = 0;
+static ldms_stream_ring_policy_t ring_policy = LDMS_STREAM_RING_BLOCK;
 /* default -- do not roll */
 #define MIN_FLUSH_TIME 120
 /* Interval to invoke orthogonal flush */
@@ -236,9 +240,31 @@ static void _clear_key_info(struct linedata *dataline)
 	dataline->header = NULL;
 }
 
+/* Handles closed but still waiting for their CLOSE event */
+static int closing_count;
+static pthread_mutex_t closing_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t closing_cond = PTHREAD_COND_INITIALIZER;
+
+static void free_streamstore(struct csv_stream_handle *stream_handle)
+{
+	if (stream_handle->file) {
+		fflush(stream_handle->file);
+		fsync(fileno(stream_handle->file));
+		fclose(stream_handle->file);
+	}
+	stream_handle->file = NULL;
+
+	_clear_key_info(&stream_handle->dataline);
+	free(stream_handle->basename);
+	free(stream_handle->stream);
+	pthread_mutex_destroy(&stream_handle->lock);
+	free(stream_handle);
+}
+
 static void close_streamstore(void *obj, void *cb_arg)
 {
 	/* cfg_lock is held outside of this */
+	ldms_stream_client_t client;
 
 	if (!obj)
 		return;
@@ -253,36 +279,33 @@ static void close_streamstore(void *obj, void *cb_arg)
 	ovis_log(mylog, OVIS_LDEBUG, PNAME ": Closing stream store <%s>\n",
 			stream_handle->stream);
 
-	/* unsubscribe */
-	if (stream_handle->client)
-		ldms_stream_close(stream_handle->client);
-	stream_handle->client = NULL;
-
-	if (stream_handle->file) {
-		fflush(stream_handle->file);
-		fsync(fileno(stream_handle->file));
-		fclose(stream_handle->file);
-	}
-	stream_handle->file = NULL;
-
-	_clear_key_info(&stream_handle->dataline);
-	stream_handle->store_count = 0;
-	stream_handle->byte_count = 0;
-	stream_handle->tlastrcv.tv_sec = 0;
-	stream_handle->tlastrcv.tv_usec = 0;
-	free(stream_handle->basename);
-	stream_handle->basename = NULL;
-
 	idx_delete(stream_idx, stream_handle->stream,
 			strlen(stream_handle->stream));
-	free(stream_handle->stream);
-	stream_handle->stream = NULL;
-
+	client = stream_handle->client;
+	stream_handle->client = NULL;
 	pthread_mutex_unlock(&stream_handle->lock);
-	pthread_mutex_destroy(&stream_handle->lock);
-	free(stream_handle);
 
-	return;
+	if (!client) {
+		free_streamstore(stream_handle);
+		return;
+	}
+	/*
+	 * unsubscribe. The messages still queued in the delivery ring are
+	 * written, and the handle is freed by stream_cb() on the CLOSE event.
+	 */
+	pthread_mutex_lock(&closing_lock);
+	closing_count++;
+	pthread_mutex_unlock(&closing_lock);
+	ldms_stream_close(client);
+}
+
+/* wait for the CLOSE events of the closed stream stores */
+static void wait_streamstores_closed()
+{
+	pthread_mutex_lock(&closing_lock);
+	while (closing_count)
+		pthread_cond_wait(&closing_cond, &closing_lock);
+	pthread_mutex_unlock(&closing_lock);
 }
 
 static int _parse_list_for_header(struct linedata *dataline, json_entity_t e)
@@ -748,6 +771,14 @@ static int stream_cb(ldms_stream_event_t ev, void *ctxt)
 	int gottime = 0;
 	int rc = 0;
 
+	if (ev->type == LDMS_STREAM_EVENT_CLOSE) {
+		free_streamstore(ctxt);
+		pthread_mutex_lock(&closing_lock);
+		closing_count--;
+		pthread_cond_broadcast(&closing_cond);
+		pthread_mutex_unlock(&closing_lock);
+		return 0;
+	}
 	if (ev->type != LDMS_STREAM_EVENT_RECV)
 		return 0;
 
@@ -777,17 +808,12 @@ static int stream_cb(ldms_stream_event_t ev, void *ctxt)
 		return -1;
 	}
 
-        pthread_mutex_lock(&cfg_lock);
-        /* really don't need lock since streams cannot be dynamically added */
-	stream_handle = idx_find(stream_idx, (void*) skey, strlen(skey));
-	if (!stream_handle) {
-		ovis_log(mylog, OVIS_LERROR, PNAME ": No stream_store for '%s'\n", skey);
-                pthread_mutex_unlock(&cfg_lock);
-		return -1;
-	}
-
+	/*
+	 * The handle outlives the stream_idx entry until the CLOSE event,
+	 * so that the messages queued in the delivery ring are written.
+	 */
+	stream_handle = ctxt;
 	pthread_mutex_lock(&stream_handle->lock);
-        pthread_mutex_unlock(&cfg_lock);
 	/*
 	 * currently releasing this, since the only way to destroy is in the
 	 * overall shutdown, plus want to be able to do the callback on
@@ -968,6 +994,17 @@ static int open_streamstore(char *stream)
 	ovis_log(mylog, OVIS_LDEBUG, "Subscribing to stream '%s'\n", stream);
 	stream_handle->client = ldms_stream_subscribe(stream, 0, stream_cb,
 					stream_handle, "stream_csv_store");
+	if (stream_handle->client && ring_size) {
+		rc = ldms_stream_client_ring_set(stream_handle->client,
+						 ring_size, ring_policy, NULL);
+		if (rc) {
+			/* the store still works, only synchronously */
+			ovis_log(mylog, OVIS_LWARNING, PNAME ": Error %d "
+				 "setting the delivery ring of stream '%s'\n",
+				 rc, stream);
+			rc = 0;
+		}
+	}
 	idx_add(stream_idx, (void*) stream, strlen(stream), stream_handle);
 	pthread_mutex_unlock(&stream_handle->lock);
 
@@ -1275,6 +1312,29 @@ static int config(ldmsd_plug_handle_t handle, struct attr_value_list *kwl,
 		ovis_log(mylog, OVIS_LDEBUG, PNAME ": setting buffer to '%d'\n", buffer);
 	}
 
+	ring_size = 0;
+	s = av_value(avl, "ring");
+	if (s) {
+		ring_size = strtoul(s, NULL, 0);
+		ovis_log(mylog, OVIS_LDEBUG, PNAME ": setting ring to '%u'\n", ring_size);
+	}
+
+	ring_policy = LDMS_STREAM_RING_BLOCK;
+	s = av_value(avl, "ring_policy");
+	if (s) {
+		if (0 == strcasecmp(s, "block")) {
+			ring_policy = LDMS_STREAM_RING_BLOCK;
+		} else if (0 == strcasecmp(s, "drop_oldest")) {
+			ring_policy = LDMS_STREAM_RING_DROP_OLDEST;
+		} else if (0 == strcasecmp(s, "drop_newest")) {
+			ring_policy = LDMS_STREAM_RING_DROP_NEWEST;
+		} else {
+			ovis_log(mylog, OVIS_LERROR, PNAME ": bad ring_policy '%s'\n", s);
+			rc = EINVAL;
+			goto out;
+		}
+	}
+
 	s = av_value(avl, "stream");
 	if (!s) {
 		ovis_log(mylog, OVIS_LDEBUG, PNAME ": missing stream in config\n");
@@ -1453,6 +1513,8 @@ static void term(ldmsd_plug_handle_t handle)
 		idx_destroy(stream_idx);
 		stream_idx = NULL;
 	}
+	/* stream_cb() must not run after the plugin is unloaded */
+	wait_streamstores_closed();
 
 	free(root_path);
 	root_path = NULL;
@@ -1463,6 +1525,8 @@ static void term(ldmsd_plug_handle_t handle)
 	rollover = 0;
 	rollagain = 0;
 	flushtime = 0;
+	ring_size = 0;
+	ring_policy = LDMS_STREAM_RING_BLOCK;
 
 	cfgstate = CFG_PRE;
 	pthread_mutex_unlock(&cfg_lock);
@@ -1473,6 +1537,7 @@ static const char* usage(ldmsd_plug_handle_t handle)
 {
 	return "    config name=stream_csv_store path=<path> container=<container> stream=<stream> \n"
 			"          [flushtime=<N>] [buffer=<0/1>] [rollover=<N> rolltype=<N>]\n"
+			"          [ring=<N> [ring_policy=<block|drop_oldest|drop_newest>]]\n"
 			"         - Set the root path for the storage of csvs and some default parameters\n"
 			"         - path          The path to the root of the csv directory\n"
 			"         - container     The directory under the path\n"
@@ -1481,6 +1546,8 @@ static const char* usage(ldmsd_plug_handle_t handle)
 			" 	  - buffer        0 to disable buffering, 1 to enable it with autosize (default)\n"
 			"         - rollover      Greater than or equal to zero; enables file rollover and sets interval\n"
 			"         - rolltype      [1-n] Defines the policy used to schedule rollover events.\n"
+			"         - ring          Queue up to N messages per stream and write them from a store thread (default 0: write from the publisher)\n"
+			"         - ring_policy   What to do with new messages when the ring is full (default block)\n"
 	ROLLTYPES
 	"\n";
 }
@@ -0,0 +1,353 @@
+/* -*- c-basic-offset: 8 -*-
+ * Copyright (c) 2026 National Technology & Engineering Solutions
+ * of Sandia, LLC (NTESS). Under the terms of Contract DE-NA0003525 with
+ * NTESS, the U.S. Government retains certain rights in this software.
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Check and measure the directory of a peer kept in an ldms_dir_cache_t.
+ *
+ * The server publishes num_sets sets and every `interval` seconds replaces
+ * `churn` of them with new ones. The client connects `rounds` times with
+ * the same directory cache; after the first round only the changes are
+ * transferred. Every LIST built from the cache is compared with the
+ * directory of a plain ldms_xprt_dir() request made right after it.
+ *
+ * Server: test_ldms_dir -x sock -p 10001 -s -n 10000 -c 100 -i 5
+ * Client: test_ldms_dir -x sock -p 10001 -h localhost -r 5
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <assert.h>
+#include <semaphore.h>
+#include "ldms.h"
+
+#define FMT "x:p:h:sn:c:i:r:"
+
+static char *xprt = "sock";
+static char *host = "localhost";
+static char *port = "10001";
+static int is_server;
+static int num_sets = 1000;
+static int churn = 10;
+static int interval = 5;
+static int rounds = 3;
+
+static sem_t conn_sem;
+static sem_t dir_sem;
+
+struct dir_result {
+	int status;
+	int count;
+	int updates;
+	char **names;
+};
+
+static void usage()
+{
+	printf(
+"	-x xprt		Transport (default: sock)\n"
+"	-p port		Listener port (server) or port to connect to (client)\n"
+"	-h host		Host to connect to (client, default: localhost)\n"
+"	-s		Server mode\n"
+"	-n num_sets	Number of sets (server, default: 1000)\n"
+"	-c churn	Sets replaced every interval (server, default: 10)\n"
+"	-i interval	Seconds between set replacements (server, default: 5)\n"
+"	-r rounds	Number of connections (client, default: 3)\n"
+	);
+}
+
+static void process_args(int argc, char **argv)
+{
+	int op;
+	while ((op = getopt(argc, argv, FMT)) != -1) {
+		switch (op) {
+		case 'x':
+			xprt = strdup(optarg);
+			break;
+		case 'p':
+			port = strdup(optarg);
+			break;
+		case 'h':
+			host = strdup(optarg);
+			break;
+		case 's':
+			is_server = 1;
+			break;
+		case 'n':
+			num_sets = atoi(optarg);
+			break;
+		case 'c':
+			churn = atoi(optarg);
+			break;
+		case 'i':
+			interval = atoi(optarg);
+			break;
+		case 'r':
+			rounds = atoi(optarg);
+			break;
+		default:
+			usage();
+			exit(1);
+		}
+	}
+}
+
+static ldms_set_t new_set(ldms_schema_t schema, int id)
+{
+	char name[64];
+	ldms_set_t set;
+
+	snprintf(name, sizeof(name), "dir_test/%d", id);
+	set = ldms_set_new(name, schema);
+	if (!set) {
+		printf("Failed to create set '%s', error %d\n", name, errno);
+		exit(1);
+	}
+	ldms_set_publish(set);
+	return set;
+}
+
+static void do_server()
+{
+	ldms_schema_t schema;
+	ldms_set_t *sets;
+	ldms_t ldms;
+	int i, rc, next_id, oldest = 0;
+
+	schema = ldms_schema_new("dir_test");
+	assert(schema);
+	rc = ldms_schema_metric_add(schema, "value", LDMS_V_U64);
+	assert(rc >= 0);
+	sets = calloc(num_sets, sizeof(*sets));
+	assert(sets);
+	for (i = 0; i < num_sets; i++)
+		sets[i] = new_set(schema, i);
+	next_id = num_sets;
+
+	ldms = ldms_xprt_new(xprt);
+	if (!ldms) {
+		printf("Failed to create the '%s' transport, error %d\n",
+			xprt, errno);
+		exit(1);
+	}
+	rc = ldms_xprt_listen_by_name(ldms, NULL, port, NULL, NULL);
+	if (rc) {
+		printf("Failed to listen on port %s, error %d\n", port, rc);
+		exit(1);
+	}
+	printf("Listening on port %s with %d sets\n", port, num_sets);
+	while (1) {
+		sleep(interval);
+		for (i = 0; i < churn && i < num_sets; i++) {
+			ldms_set_unpublish(sets[oldest]);
+			ldms_set_delete(sets[oldest]);
+			sets[oldest] = new_set(schema, next_id++);
+			oldest = (oldest + 1) % num_sets;
+		}
+	}
+}
+
+static void conn_cb(ldms_t x, ldms_xprt_event_t e, void *arg)
+{
+	switch (e->type) {
+	case LDMS_XPRT_EVENT_CONNECTED:
+		sem_post(&conn_sem);
+		break;
+	case LDMS_XPRT_EVENT_REJECTED:
+	case LDMS_XPRT_EVENT_ERROR:
+		printf("Connection failed, event %d\n", e->type);
+		exit(1);
+	default:
+		break;
+	}
+}
+
+static int name_cmp(const void *a, const void *b)
+{
+	return strcmp(*(char **)a, *(char **)b);
+}
+
+static void dir_cb(ldms_t x, int status, ldms_dir_t dir, void *arg)
+{
+	struct dir_result *res = arg;
+	int i, n;
+
+	if (status) {
+		res->status = status;
+		sem_post(&dir_sem);
+		return;
+	}
+	if (dir->type != LDMS_DIR_LIST) {
+		res->updates += dir->set_count;
+		ldms_xprt_dir_free(x, dir);
+		return;
+	}
+	n = res->count;
+	res->count += dir->set_count;
+	res->names = realloc(res->names, res->count * sizeof(char *));
+	assert(res->names);
+	for (i = 0; i < dir->set_count; i++)
+		res->names[n + i] = strdup(dir->set_data[i].inst_name);
+	if (!dir->more) {
+		qsort(res->names, res->count, sizeof(char *), name_cmp);
+		sem_post(&dir_sem);
+	}
+	ldms_xprt_dir_free(x, dir);
+}
+
+static void result_reset(struct dir_result *res)
+{
+	int i;
+	for (i = 0; i < res->count; i++)
+		free(res->names[i]);
+	free(res->names);
+	memset(res, 0, sizeof(*res));
+}
+
+static ldms_t connect_peer()
+{
+	ldms_t x = ldms_xprt_new(xprt);
+	int rc;
+
+	if (!x) {
+		printf("Failed to create the '%s' transport, error %d\n",
+			xprt, errno);
+		exit(1);
+	}
+	rc = ldms_xprt_connect_by_name(x, host, port, conn_cb, NULL);
+	if (rc) {
+		printf("ldms_xprt_connect_by_name() error %d\n", rc);
+		exit(1);
+	}
+	sem_wait(&conn_sem);
+	return x;
+}
+
+static double ts_diff(struct timespec *a, struct timespec *b)
+{
+	return (b->tv_sec - a->tv_sec) + (b->tv_nsec - a->tv_nsec) / 1e9;
+}
+
+static int do_client()
+{
+	struct dir_result cached = {0}, plain = {0};
+	struct timespec start, end, pstart, pend;
+	ldms_dir_cache_t cache;
+	ldms_t x, y;
+	int r, i, rc, err = 0;
+
+	sem_init(&conn_sem, 0, 0);
+	sem_init(&dir_sem, 0, 0);
+	cache = ldms_dir_cache_new();
+	assert(cache);
+	for (r = 0; r < rounds; r++) {
+		x = connect_peer();
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		rc = ldms_xprt_dir_cached(x, dir_cb, &cached,
+					  LDMS_DIR_F_NOTIFY, cache);
+		if (rc) {
+			printf("ldms_xprt_dir_cached() error %d\n", rc);
+			exit(1);
+		}
+		sem_wait(&dir_sem);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		if (cached.status) {
+			printf("directory error %d\n", cached.status);
+			exit(1);
+		}
+
+		y = connect_peer();
+		clock_gettime(CLOCK_MONOTONIC, &pstart);
+		rc = ldms_xprt_dir(y, dir_cb, &plain, 0);
+		if (rc) {
+			printf("ldms_xprt_dir() error %d\n", rc);
+			exit(1);
+		}
+		sem_wait(&dir_sem);
+		clock_gettime(CLOCK_MONOTONIC, &pend);
+		ldms_xprt_close(y);
+
+		rc = (cached.count != plain.count);
+		for (i = 0; !rc && i < cached.count; i++)
+			rc = strcmp(cached.names[i], plain.names[i]);
+		printf("round %d: %d sets in %.6f sec (%.6f sec without "
+		       "the cache), directory %s\n",
+		       r, cached.count, ts_diff(&start, &end),
+		       ts_diff(&pstart, &pend), rc ? "MISMATCH" : "ok");
+		if (rc)
+			err = 1;
+		result_reset(&plain);
+
+		/* the directory updates of one interval */
+		sleep(interval);
+		printf("round %d: %d sets added or updated\n", r, cached.updates);
+		ldms_xprt_close(x);
+		result_reset(&cached);
+	}
+	ldms_dir_cache_free(cache);
+	printf("%s\n", err ? "FAILED" : "PASSED");
+	return err;
+}
+
+int main(int argc, char **argv)
+{
+	process_args(argc, argv);
+	if (num_sets <= 0 || rounds <= 0 || interval <= 0) {
+		usage();
+		exit(1);
+	}
+	ldms_init(512 * 1024 * 1024);
+	if (is_server)
+		do_server();
+	return do_client();
+}
@@ -0,0 +1,176 @@
+/* -*- c-basic-offset: 8 -*-
+ * Copyright (c) 2026 National Technology & Engineering Solutions
+ * of Sandia, LLC (NTESS). Under the terms of Contract DE-NA0003525 with
+ * NTESS, the U.S. Government retains certain rights in this software.
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Check and measure metric index resolution by name.
+ *
+ * For schemas of 100, 1000 and 10000 metrics (or the sizes given on the
+ * command line), this verifies that ldms_metric_by_name() and
+ * ldms_metric_ids_by_names() resolve every name of two sets of the same
+ * schema, then reports the average cost per name of:
+ *   - a linear scan of the metric names (the previous implementation),
+ *   - ldms_metric_by_name(),
+ *   - ldms_metric_ids_by_names().
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include "ldms.h"
+
+#define LOOKUPS 2000000
+
+static double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int scan_by_name(ldms_set_t set, const char *name)
+{
+	int i, card = ldms_set_card_get(set);
+	for (i = 0; i < card; i++) {
+		if (0 == strcmp(ldms_metric_name_get(set, i), name))
+			return i;
+	}
+	return -1;
+}
+
+static void verify(ldms_set_t set, char **names, int *ids, int card)
+{
+	int i;
+	for (i = 0; i < card; i++)
+		assert(ldms_metric_by_name(set, names[i]) == i);
+	assert(ldms_metric_by_name(set, "no_such_metric") == -1);
+	assert(ldms_metric_ids_by_names(set, (const char **)names, ids, card) == card);
+	for (i = 0; i < card; i++)
+		assert(ids[i] == i);
+}
+
+static void run(int card)
+{
+	ldms_schema_t schema;
+	ldms_set_t set[2];
+	char buf[64];
+	char **names;
+	int *ids;
+	int i, n, rounds, rc;
+	volatile int sink = 0;
+	double t0, t_scan, t_name, t_bulk;
+
+	snprintf(buf, sizeof(buf), "metric_by_name_%d", card);
+	schema = ldms_schema_new(buf);
+	assert(schema);
+	names = calloc(card, sizeof(*names));
+	ids = calloc(card, sizeof(*ids));
+	assert(names && ids);
+	for (i = 0; i < card; i++) {
+		snprintf(buf, sizeof(buf), "metric_%d", i);
+		names[i] = strdup(buf);
+		assert(names[i]);
+		rc = ldms_schema_metric_add(schema, names[i], LDMS_V_U64);
+		assert(rc == i);
+	}
+	for (i = 0; i < 2; i++) {
+		snprintf(buf, sizeof(buf), "metric_by_name_%d/set%d", card, i);
+		set[i] = ldms_set_new(buf, schema);
+		assert(set[i]);
+		verify(set[i], names, ids, card);
+	}
+
+	/* the linear scan is O(card) per name, keep its run time bounded */
+	rounds = LOOKUPS / card;
+	n = rounds * card;
+
+	t0 = now();
+	for (i = 0; i < LOOKUPS / 10 / card * card; i++)
+		sink += scan_by_name(set[0], names[i % card]);
+	t_scan = (now() - t0) / (LOOKUPS / 10 / card * card);
+
+	t0 = now();
+	for (i = 0; i < n; i++)
+		sink += ldms_metric_by_name(set[i & 1], names[i % card]);
+	t_name = (now() - t0) / n;
+
+	t0 = now();
+	for (i = 0; i < rounds; i++)
+		sink += ldms_metric_ids_by_names(set[i & 1], (const char **)names,
+						 ids, card);
+	t_bulk = (now() - t0) / n;
+
+	printf("%6d metrics: scan %10.1f ns/name, ldms_metric_by_name %6.1f ns/name, "
+	       "ldms_metric_ids_by_names %6.1f ns/name\n",
+	       card, t_scan * 1e9, t_name * 1e9, t_bulk * 1e9);
+
+	for (i = 0; i < 2; i++)
+		ldms_set_delete(set[i]);
+	ldms_schema_delete(schema);
+	for (i = 0; i < card; i++)
+		free(names[i]);
+	free(names);
+	free(ids);
+}
+
+int main(int argc, char **argv)
+{
+	int i;
+
+	ldms_init(256 * 1024 * 1024);
+	if (argc > 1) {
+		for (i = 1; i < argc; i++)
+			run(atoi(argv[i]));
+	} else {
+		run(100);
+		run(1000);
+		run(10000);
+	}
+	return 0;
+}
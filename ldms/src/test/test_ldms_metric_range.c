@@ -0,0 +1,467 @@
+/* -*- c-basic-offset: 8 -*-
+ * Copyright (c) 2026 National Technology & Engineering Solutions
+ * of Sandia, LLC (NTESS). Under the terms of Contract DE-NA0003525 with
+ * NTESS, the U.S. Government retains certain rights in this software.
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Check and measure the range metric accessors.
+ *
+ * Verifies ldms_metric_set_X_range() and ldms_metric_get_X_range() against
+ * the per-metric accessors on a schema mixing types, meta attributes and
+ * data metrics, and their errors, and on sets looked up from a peer with
+ * meta-data sharing enabled mixed with local sets of their schema. Then,
+ * for schemas of 100, 1000 and 10000 LDMS_V_U64 metrics (or the sizes given
+ * on the command line), reports the average cost per metric of a sample
+ * written in a transaction with:
+ *   - ldms_metric_set_u64() for each metric,
+ *   - ldms_metric_set_u64_range() for all metrics,
+ * and of reading it back with ldms_metric_get_u64() and
+ * ldms_metric_get_u64_range().
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <time.h>
+#include <unistd.h>
+#include <semaphore.h>
+#include <sys/wait.h>
+#include "ldms.h"
+
+#define VALUES 20000000
+
+static double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * meta: a0 a1 (u64)
+ * data: u0..u3 (u64) s0 s1 (s64) i0 i1 (u32) arr (u64[4]) d0 d1 (d64)
+ *       f0 (float)
+ */
+static void verify(void)
+{
+	ldms_schema_t schema;
+	ldms_set_t set, set2;
+	uint64_t u[8], v[8];
+	uint32_t w[2], x[2];
+	double d[2], e[2];
+	float f, g;
+	uint64_t gn, meta_gn;
+	int i, a0, u0, i0, arr, d0, f0;
+
+	schema = ldms_schema_new("metric_range_verify");
+	assert(schema);
+	a0 = ldms_schema_meta_add(schema, "a0", LDMS_V_U64);
+	ldms_schema_meta_add(schema, "a1", LDMS_V_U64);
+	u0 = ldms_schema_metric_add(schema, "u0", LDMS_V_U64);
+	ldms_schema_metric_add(schema, "u1", LDMS_V_U64);
+	ldms_schema_metric_add(schema, "u2", LDMS_V_U64);
+	ldms_schema_metric_add(schema, "u3", LDMS_V_U64);
+	ldms_schema_metric_add(schema, "s0", LDMS_V_S64);
+	ldms_schema_metric_add(schema, "s1", LDMS_V_S64);
+	i0 = ldms_schema_metric_add(schema, "i0", LDMS_V_U32);
+	ldms_schema_metric_add(schema, "i1", LDMS_V_U32);
+	arr = ldms_schema_metric_array_add(schema, "arr", LDMS_V_U64_ARRAY, 4);
+	d0 = ldms_schema_metric_add(schema, "d0", LDMS_V_D64);
+	ldms_schema_metric_add(schema, "d1", LDMS_V_D64);
+	f0 = ldms_schema_metric_add(schema, "f0", LDMS_V_F32);
+	/* two data buffers, so gets in a transaction see the previous one */
+	ldms_schema_array_card_set(schema, 2);
+	set = ldms_set_new("metric_range_verify/set", schema);
+	assert(set);
+	ldms_set_data_copy_set(set, 1);
+	ldms_transaction_begin(set);
+	ldms_transaction_end(set);
+
+	/* u64 and s64 metrics in one range */
+	for (i = 0; i < 6; i++)
+		u[i] = 0x1000000000000000ULL + i;
+	gn = ldms_set_data_gn_get(set);
+	assert(0 == ldms_metric_set_u64_range(set, u0, 6, u));
+	assert(ldms_set_data_gn_get(set) == gn + 1);
+	for (i = 0; i < 6; i++)
+		assert(ldms_metric_get_u64(set, u0 + i) == u[i]);
+	memset(v, 0, sizeof(v));
+	assert(0 == ldms_metric_get_u64_range(set, u0, 6, v));
+	assert(0 == memcmp(u, v, 6 * sizeof(u[0])));
+	ldms_metric_set_u64(set, u0 + 2, 7);
+	assert(0 == ldms_metric_get_u64_range(set, u0 + 1, 3, v));
+	assert(v[0] == u[1] && v[1] == 7 && v[2] == u[3]);
+
+	/* meta attributes */
+	meta_gn = ldms_set_meta_gn_get(set);
+	gn = ldms_set_data_gn_get(set);
+	assert(0 == ldms_metric_set_u64_range(set, a0, 2, u));
+	assert(ldms_set_meta_gn_get(set) == meta_gn + 1);
+	assert(ldms_set_data_gn_get(set) == gn);
+	assert(ldms_metric_get_u64(set, a0 + 1) == u[1]);
+
+	w[0] = 0xdeadbeef;
+	w[1] = 1;
+	assert(0 == ldms_metric_set_u32_range(set, i0, 2, w));
+	assert(ldms_metric_get_u32(set, i0) == w[0]);
+	assert(0 == ldms_metric_get_u32_range(set, i0, 2, x));
+	assert(0 == memcmp(w, x, sizeof(w)));
+	/* the neighbors are untouched */
+	assert(ldms_metric_get_s64(set, i0 - 1) == (int64_t)u[5]);
+
+	d[0] = 1.5;
+	d[1] = -2.25;
+	assert(0 == ldms_metric_set_double_range(set, d0, 2, d));
+	assert(ldms_metric_get_double(set, d0 + 1) == d[1]);
+	assert(0 == ldms_metric_get_double_range(set, d0, 2, e));
+	assert(e[0] == d[0] && e[1] == d[1]);
+	f = 3.5;
+	assert(0 == ldms_metric_set_float_range(set, f0, 1, &f));
+	assert(0 == ldms_metric_get_float_range(set, f0, 1, &g));
+	assert(g == f && ldms_metric_get_float(set, f0) == f);
+
+	/* inside a transaction, the get returns the previous sample */
+	ldms_transaction_begin(set);
+	u[0] = 42;
+	assert(0 == ldms_metric_set_u64_range(set, u0, 1, u));
+	assert(0 == ldms_metric_get_u64_range(set, u0, 1, v));
+	assert(v[0] == ldms_metric_get_u64(set, u0) && v[0] != 42);
+	ldms_transaction_end(set);
+	assert(0 == ldms_metric_get_u64_range(set, u0, 1, v));
+	assert(v[0] == 42);
+
+	/* errors */
+	assert(EINVAL == ldms_metric_set_u64_range(set, u0, 7, u));
+	assert(EINVAL == ldms_metric_set_u64_range(set, arr, 1, u));
+	assert(EINVAL == ldms_metric_get_u32_range(set, u0, 1, x));
+	assert(ENOENT == ldms_metric_set_u64_range(set, -1, 2, u));
+	assert(ENOENT == ldms_metric_get_u64_range(set, f0, 2, v));
+	assert(0 == ldms_metric_set_u64_range(set, f0 + 1, 0, u));
+	assert(ldms_metric_get_u64(set, u0) == 42);
+
+	/* a second set of the schema shares the offset table */
+	set2 = ldms_set_new("metric_range_verify/set2", schema);
+	assert(set2);
+	ldms_transaction_begin(set2);
+	assert(0 == ldms_metric_set_u64_range(set2, u0, 6, u));
+	ldms_transaction_end(set2);
+	assert(0 == ldms_metric_get_u64_range(set2, u0, 6, v));
+	assert(0 == memcmp(u, v, 6 * sizeof(u[0])));
+	assert(ldms_metric_get_u64(set2, u0 + 5) == u[5]);
+
+	ldms_set_delete(set2);
+	ldms_set_delete(set);
+	ldms_schema_delete(schema);
+}
+
+/*
+ * meta: m0 m1 (u64)
+ * data: v0..v3 (u64), and v4 (u64) if \c extra
+ */
+static ldms_schema_t shared_schema(int extra)
+{
+	ldms_schema_t schema;
+	char name[16];
+	int i;
+
+	schema = ldms_schema_new(extra ? "metric_range_shared_x" :
+					 "metric_range_shared");
+	assert(schema);
+	assert(0 == ldms_schema_meta_add(schema, "m0", LDMS_V_U64));
+	assert(1 == ldms_schema_meta_add(schema, "m1", LDMS_V_U64));
+	for (i = 0; i < 4 + !!extra; i++) {
+		snprintf(name, sizeof(name), "v%d", i);
+		assert(2 + i == ldms_schema_metric_add(schema, name, LDMS_V_U64));
+	}
+	return schema;
+}
+
+static ldms_set_t shared_set(int extra, const char *name)
+{
+	ldms_schema_t schema = shared_schema(extra);
+	ldms_set_t set;
+	uint64_t u[7] = { 11, 12, 100, 101, 102, 103, 104 };
+
+	set = ldms_set_new(name, schema);
+	assert(set);
+	ldms_schema_delete(schema);
+	ldms_transaction_begin(set);
+	assert(0 == ldms_metric_set_u64_range(set, 0, 6 + !!extra, u));
+	ldms_transaction_end(set);
+	return set;
+}
+
+/*
+ * The peer: serve the sets to look up until \c hold is closed, also when
+ * the test aborts.
+ */
+static void serve(const char *port, int ready, int hold)
+{
+	ldms_t x;
+	char c;
+
+	ldms_init(16 * 1024 * 1024);
+	ldms_set_publish(shared_set(0, "metric_range_shared/peer"));
+	ldms_set_publish(shared_set(1, "metric_range_shared_x/peer"));
+	x = ldms_xprt_new("sock");
+	assert(x);
+	assert(0 == ldms_xprt_listen_by_name(x, NULL, port, NULL, NULL));
+	assert(1 == write(ready, "", 1));
+	while (read(hold, &c, 1) < 0 && errno == EINTR)
+		;
+	exit(0);
+}
+
+static sem_t shared_sem;
+static ldms_set_t shared_lu[2];
+
+static void shared_conn_cb(ldms_t x, ldms_xprt_event_t e, void *arg)
+{
+	if (e->type != LDMS_XPRT_EVENT_CONNECTED &&
+	    e->type != LDMS_XPRT_EVENT_DISCONNECTED) {
+		printf("Connection error, event %d\n", e->type);
+		exit(1);
+	}
+	if (e->type == LDMS_XPRT_EVENT_CONNECTED)
+		sem_post(&shared_sem);
+}
+
+static void shared_lookup_cb(ldms_t x, enum ldms_lookup_status status,
+			     int more, ldms_set_t set, void *arg)
+{
+	if (status != LDMS_LOOKUP_OK) {
+		printf("Lookup failed, status %d\n", status);
+		exit(1);
+	}
+	*(ldms_set_t *)arg = set;
+	sem_post(&shared_sem);
+}
+
+static void shared_update_cb(ldms_t x, ldms_set_t set, int flags, void *arg)
+{
+	if (LDMS_UPD_ERROR(flags)) {
+		printf("Update error %d\n", LDMS_UPD_ERROR(flags));
+		exit(1);
+	}
+	if (!(flags & LDMS_UPD_F_MORE))
+		sem_post(&shared_sem);
+}
+
+/* Read both sets' meta attributes and metrics with the range accessor */
+static void shared_check(ldms_set_t a, ldms_set_t b, int card)
+{
+	uint64_t u[7] = { 11, 12, 100, 101, 102, 103, 104 };
+	uint64_t v[7];
+	ldms_set_t sets[2] = { a, b };
+	int i, j;
+
+	for (i = 0; i < 2; i++) {
+		memset(v, 0, sizeof(v));
+		assert(0 == ldms_metric_get_u64_range(sets[i], 0, 2, v));
+		assert(0 == ldms_metric_get_u64_range(sets[i], 2, card - 2,
+						      &v[2]));
+		assert(0 == memcmp(u, v, card * sizeof(u[0])));
+		for (j = 0; j < card; j++)
+			assert(ldms_metric_get_u64(sets[i], j) == u[j]);
+	}
+}
+
+/*
+ * The sets looked up with meta-data sharing enabled use the offset table
+ * of the local sets of their schema and conversely. The instance names
+ * have the same length so that the sets have the same meta-data size.
+ */
+static void verify_shared(const char *port)
+{
+	struct ldms_meta_share_stats stats;
+	ldms_set_t local, local_x;
+	ldms_t x;
+	char *names[2] = { "metric_range_shared/peer",
+			   "metric_range_shared_x/peer" };
+	int i;
+
+	ldms_meta_share_enable(1);
+	sem_init(&shared_sem, 0, 0);
+	/* the local set uses the table first */
+	local = shared_set(0, "metric_range_shared/self");
+	shared_check(local, local, 6);
+
+	x = ldms_xprt_new("sock");
+	assert(x);
+	assert(0 == ldms_xprt_connect_by_name(x, "localhost", port,
+					      shared_conn_cb, NULL));
+	sem_wait(&shared_sem);
+	for (i = 0; i < 2; i++) {
+		assert(0 == ldms_xprt_lookup(x, names[i], LDMS_LOOKUP_BY_INSTANCE,
+					     shared_lookup_cb, &shared_lu[i]));
+		sem_wait(&shared_sem);
+		assert(0 == ldms_xprt_update(shared_lu[i], shared_update_cb,
+					     NULL));
+		sem_wait(&shared_sem);
+	}
+	ldms_meta_share_stats_get(&stats);
+	assert(stats.sets == 2);
+
+	shared_check(shared_lu[0], local, 6);
+	/* the looked up set uses the table first */
+	shared_check(shared_lu[1], shared_lu[1], 7);
+	local_x = shared_set(1, "metric_range_shared_x/self");
+	shared_check(local_x, shared_lu[1], 7);
+
+	ldms_set_delete(local_x);
+	ldms_set_delete(local);
+	ldms_xprt_close(x);
+}
+
+static void run(int card)
+{
+	ldms_schema_t schema;
+	ldms_set_t set;
+	char buf[64];
+	uint64_t *vals;
+	int i, j, rc, rounds;
+	volatile uint64_t sink = 0;
+	double t0, t_set, t_set_range, t_get, t_get_range;
+
+	snprintf(buf, sizeof(buf), "metric_range_%d", card);
+	schema = ldms_schema_new(buf);
+	assert(schema);
+	for (i = 0; i < card; i++) {
+		snprintf(buf, sizeof(buf), "metric_%d", i);
+		rc = ldms_schema_metric_add(schema, buf, LDMS_V_U64);
+		assert(rc == i);
+	}
+	snprintf(buf, sizeof(buf), "metric_range_%d/set", card);
+	set = ldms_set_new(buf, schema);
+	assert(set);
+	vals = calloc(card, sizeof(*vals));
+	assert(vals);
+	rounds = VALUES / card;
+
+	t0 = now();
+	for (i = 0; i < rounds; i++) {
+		ldms_transaction_begin(set);
+		for (j = 0; j < card; j++)
+			ldms_metric_set_u64(set, j, i + j);
+		ldms_transaction_end(set);
+	}
+	t_set = (now() - t0) / rounds / card;
+
+	t0 = now();
+	for (i = 0; i < rounds; i++) {
+		for (j = 0; j < card; j++)
+			vals[j] = i + j;
+		ldms_transaction_begin(set);
+		rc = ldms_metric_set_u64_range(set, 0, card, vals);
+		ldms_transaction_end(set);
+		assert(rc == 0);
+	}
+	t_set_range = (now() - t0) / rounds / card;
+
+	t0 = now();
+	for (i = 0; i < rounds; i++) {
+		for (j = 0; j < card; j++)
+			sink += ldms_metric_get_u64(set, j);
+	}
+	t_get = (now() - t0) / rounds / card;
+
+	t0 = now();
+	for (i = 0; i < rounds; i++) {
+		rc = ldms_metric_get_u64_range(set, 0, card, vals);
+		assert(rc == 0);
+		sink += vals[i % card];
+	}
+	t_get_range = (now() - t0) / rounds / card;
+
+	for (j = 0; j < card; j++)
+		assert(vals[j] == (uint64_t)rounds - 1 + j);
+
+	printf("%6d metrics: set_u64 %5.2f ns, set_u64_range %5.2f ns, "
+	       "get_u64 %5.2f ns, get_u64_range %5.2f ns per metric\n",
+	       card, t_set * 1e9, t_set_range * 1e9,
+	       t_get * 1e9, t_get_range * 1e9);
+
+	ldms_set_delete(set);
+	ldms_schema_delete(schema);
+	free(vals);
+}
+
+int main(int argc, char **argv)
+{
+	int i, ready[2], hold[2];
+	pid_t pid;
+	char port[16];
+	char c;
+
+	/* the peer of verify_shared() */
+	snprintf(port, sizeof(port), "%d", 20000 + getpid() % 20000);
+	assert(0 == pipe(ready) && 0 == pipe(hold));
+	pid = fork();
+	assert(pid >= 0);
+	if (!pid) {
+		close(hold[1]);
+		serve(port, ready[1], hold[0]);
+	}
+	close(hold[0]);
+	assert(1 == read(ready[0], &c, 1));
+
+	ldms_init(256 * 1024 * 1024);
+	verify();
+	verify_shared(port);
+	close(hold[1]);
+	waitpid(pid, NULL, 0);
+	if (argc > 1) {
+		for (i = 1; i < argc; i++)
+			run(atoi(argv[i]));
+	} else {
+		run(100);
+		run(1000);
+		run(10000);
+	}
+	return 0;
+}
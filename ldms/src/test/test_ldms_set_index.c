@@ -0,0 +1,273 @@
+/* -*- c-basic-offset: 8 -*-
+ * Copyright (c) 2026 National Technology & Engineering Solutions
+ * of Sandia, LLC (NTESS). Under the terms of Contract DE-NA0003525 with
+ * NTESS, the U.S. Government retains certain rights in this software.
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Check and measure concurrent lookups of local sets by name.
+ *
+ * num_sets sets are created up front and must be found by every lookup.
+ * `threads` reader threads look sets up by name with ldms_set_by_name()
+ * while one thread keeps deleting and re-creating `churn` other sets.
+ * At the end the number of lookups per second is reported. Then the
+ * threads race to create RACE_SETS sets of the same names, exactly one
+ * create of each name must succeed.
+ *
+ * test_ldms_set_index -n 10000 -t 8 -c 100 -s 5
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <assert.h>
+#include <pthread.h>
+#include "ldms.h"
+
+#define FMT "n:t:c:s:"
+
+static int num_sets = 10000;
+static int num_threads = 4;
+static int churn = 100;
+static int seconds = 5;
+
+static volatile int done;
+static int failed;
+
+#define RACE_SETS 1000
+static ldms_schema_t schema;
+static ldms_set_t race_sets[RACE_SETS];
+
+static void usage()
+{
+	printf(
+"	-n num_sets	Number of stable sets (default: 10000)\n"
+"	-t threads	Number of lookup threads (default: 4)\n"
+"	-c churn	Number of sets deleted and re-created (default: 100)\n"
+"	-s seconds	Duration of the run (default: 5)\n"
+	);
+}
+
+static void process_args(int argc, char **argv)
+{
+	int op;
+	while ((op = getopt(argc, argv, FMT)) != -1) {
+		switch (op) {
+		case 'n':
+			num_sets = atoi(optarg);
+			break;
+		case 't':
+			num_threads = atoi(optarg);
+			break;
+		case 'c':
+			churn = atoi(optarg);
+			break;
+		case 's':
+			seconds = atoi(optarg);
+			break;
+		default:
+			usage();
+			exit(1);
+		}
+	}
+}
+
+static ldms_set_t new_set(ldms_schema_t schema, int id)
+{
+	char name[64];
+	ldms_set_t set;
+
+	snprintf(name, sizeof(name), "set_index/%d", id);
+	set = ldms_set_new(name, schema);
+	if (!set) {
+		printf("Failed to create set '%s', error %d\n", name, errno);
+		exit(1);
+	}
+	ldms_set_publish(set);
+	return set;
+}
+
+static void *lookup_proc(void *arg)
+{
+	uint64_t *count = arg;
+	unsigned int seed = (unsigned int)(uintptr_t)arg;
+	char name[64];
+	ldms_set_t set;
+	int id;
+
+	while (!done) {
+		id = rand_r(&seed) % (num_sets + churn);
+		snprintf(name, sizeof(name), "set_index/%d", id);
+		set = ldms_set_by_name(name);
+		if (!set) {
+			if (id < num_sets) {
+				printf("Set '%s' not found\n", name);
+				__atomic_store_n(&failed, 1, __ATOMIC_RELAXED);
+			}
+		} else {
+			if (strcmp(ldms_set_instance_name_get(set), name)) {
+				printf("Lookup of '%s' returned '%s'\n", name,
+					ldms_set_instance_name_get(set));
+				__atomic_store_n(&failed, 1, __ATOMIC_RELAXED);
+			}
+			ldms_set_put(set);
+		}
+		(*count)++;
+	}
+	return NULL;
+}
+
+static void *race_proc(void *arg)
+{
+	char name[64];
+	ldms_set_t set;
+	int i;
+
+	for (i = 0; i < RACE_SETS; i++) {
+		snprintf(name, sizeof(name), "set_index/race/%d", i);
+		set = ldms_set_new(name, schema);
+		if (!set) {
+			if (errno != EEXIST) {
+				printf("Failed to create set '%s', error %d\n",
+					name, errno);
+				__atomic_store_n(&failed, 1, __ATOMIC_RELAXED);
+			}
+			continue;
+		}
+		if (__atomic_exchange_n(&race_sets[i], set, __ATOMIC_SEQ_CST)) {
+			printf("Set '%s' was created twice\n", name);
+			__atomic_store_n(&failed, 1, __ATOMIC_RELAXED);
+		}
+	}
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	ldms_set_t *sets;
+	pthread_t *threads;
+	uint64_t *counts, total = 0;
+	struct timespec start, end;
+	double elapsed;
+	int i, rc;
+
+	process_args(argc, argv);
+	if (num_sets <= 0 || num_threads <= 0 || churn < 0 || seconds <= 0) {
+		usage();
+		exit(1);
+	}
+	ldms_init(512 * 1024 * 1024);
+	schema = ldms_schema_new("set_index");
+	assert(schema);
+	rc = ldms_schema_metric_add(schema, "value", LDMS_V_U64);
+	assert(rc >= 0);
+	sets = calloc(num_sets + churn, sizeof(*sets));
+	threads = calloc(num_threads, sizeof(*threads));
+	/* one cache line per counter */
+	counts = calloc(num_threads, 8 * sizeof(*counts));
+	assert(sets && threads && counts);
+	for (i = 0; i < num_sets + churn; i++)
+		sets[i] = new_set(schema, i);
+	if (ldms_set_count() != num_sets + churn) {
+		printf("Expected %d sets, ldms_set_count() is %d\n",
+			num_sets + churn, ldms_set_count());
+		exit(1);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < num_threads; i++) {
+		rc = pthread_create(&threads[i], NULL, lookup_proc, &counts[i * 8]);
+		assert(rc == 0);
+	}
+	do {
+		for (i = num_sets; i < num_sets + churn; i++) {
+			ldms_set_unpublish(sets[i]);
+			ldms_set_delete(sets[i]);
+			sets[i] = new_set(schema, i);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		elapsed = (end.tv_sec - start.tv_sec)
+			+ (end.tv_nsec - start.tv_nsec) / 1e9;
+	} while (elapsed < seconds);
+	done = 1;
+	for (i = 0; i < num_threads; i++) {
+		pthread_join(threads[i], NULL);
+		total += counts[i * 8];
+	}
+	printf("%d threads, %d sets, %d churned: %.0f lookups/s\n",
+		num_threads, num_sets, churn, total / elapsed);
+
+	for (i = 0; i < num_threads; i++) {
+		rc = pthread_create(&threads[i], NULL, race_proc, NULL);
+		assert(rc == 0);
+	}
+	for (i = 0; i < num_threads; i++)
+		pthread_join(threads[i], NULL);
+	for (i = 0; i < RACE_SETS; i++) {
+		if (!race_sets[i]) {
+			printf("No create of 'set_index/race/%d' succeeded\n", i);
+			failed = 1;
+			continue;
+		}
+		ldms_set_delete(race_sets[i]);
+	}
+	if (ldms_set_count() != num_sets + churn) {
+		printf("Expected %d sets after the create race, "
+			"ldms_set_count() is %d\n",
+			num_sets + churn, ldms_set_count());
+		failed = 1;
+	}
+	if (failed) {
+		printf("FAILED\n");
+		return 1;
+	}
+	printf("PASSED\n");
+	return 0;
+}
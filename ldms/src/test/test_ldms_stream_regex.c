@@ -0,0 +1,236 @@
+/* -*- c-basic-offset: 8 -*-
+ * Copyright (c) 2026 National Technology & Engineering Solutions
+ * of Sandia, LLC (NTESS). Under the terms of Contract DE-NA0003525 with
+ * NTESS, the U.S. Government retains certain rights in this software.
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Check and measure the regex stream client matching.
+ *
+ * Subscribes NUM_CLIENTS regex clients with a mix of anchored, unanchored and
+ * alternation patterns, then publishes once to each of NUM_STREAMS new stream
+ * names. The number of messages each client receives must be the same as the
+ * number of names its regex matches with a plain regexec(), which is also
+ * timed as the baseline (the previous per-client regexec() loop).
+ *
+ * usage: test_ldms_stream_regex [-c NUM_CLIENTS] [-s NUM_STREAMS]
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <assert.h>
+#include <regex.h>
+#include <time.h>
+#include "ldms.h"
+
+int num_clients = 1000;
+int num_streams = 10000;
+
+struct client {
+	char re[128];
+	regex_t regex;
+	ldms_stream_client_t c;
+	int expected;
+	int received;
+};
+
+struct client *clients;
+char **names;
+
+static double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int stream_cb(ldms_stream_event_t ev, void *arg)
+{
+	struct client *cl = arg;
+	if (ev->type == LDMS_STREAM_EVENT_RECV)
+		__atomic_fetch_add(&cl->received, 1, __ATOMIC_SEQ_CST);
+	return 0;
+}
+
+static void gen_regex(int i, char *buf, size_t sz)
+{
+	int job = i / 10;
+	switch (i % 10) {
+	case 0:
+	case 5:
+		snprintf(buf, sz, "^job\\.%d\\..*", job);
+		break;
+	case 1:
+	case 6:
+		snprintf(buf, sz, "job%d-rank[0-9]+$", job);
+		break;
+	case 2:
+		snprintf(buf, sz, "^slurm/job%d/(start|end)", job);
+		break;
+	case 3:
+	case 7:
+		snprintf(buf, sz, ".*kokkos.*_job%d$", job);
+		break;
+	case 4:
+	case 8:
+		snprintf(buf, sz, "[a-z]+_metrics_%d", i);
+		break;
+	case 9:
+		snprintf(buf, sz, "^app%d?x*\\.[[:digit:]]", job);
+		break;
+	}
+}
+
+static void gen_name(int i, char *buf, size_t sz)
+{
+	int job = (i / 6) % (num_clients / 5 + 1);
+	switch (i % 6) {
+	case 0:
+		snprintf(buf, sz, "job.%d.rank%d", job, i);
+		break;
+	case 1:
+		snprintf(buf, sz, "job%d-rank%d", job, i);
+		break;
+	case 2:
+		snprintf(buf, sz, "slurm/job%d/%s", job, (i & 1) ? "start" : "end");
+		break;
+	case 3:
+		snprintf(buf, sz, "kokkos_%d_job%d", i, job);
+		break;
+	case 4:
+		snprintf(buf, sz, "node_metrics_%d", i % num_clients);
+		break;
+	case 5:
+		snprintf(buf, sz, "app%d.%d", job, i);
+		break;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	int i, j, rc, err = 0;
+	char buf[128];
+	double t0, t_sub, t_pub, t_naive;
+	long total = 0;
+
+	while ((rc = getopt(argc, argv, "c:s:")) != -1) {
+		switch (rc) {
+		case 'c':
+			num_clients = atoi(optarg);
+			break;
+		case 's':
+			num_streams = atoi(optarg);
+			break;
+		default:
+			printf("usage: %s [-c NUM_CLIENTS] [-s NUM_STREAMS]\n", argv[0]);
+			exit(1);
+		}
+	}
+
+	ldms_init(16 * 1024 * 1024);
+	clients = calloc(num_clients, sizeof(*clients));
+	names = calloc(num_streams, sizeof(*names));
+	assert(clients && names);
+	for (i = 0; i < num_clients; i++) {
+		gen_regex(i, clients[i].re, sizeof(clients[i].re));
+		rc = regcomp(&clients[i].regex, clients[i].re, REG_EXTENDED|REG_NOSUB);
+		assert(rc == 0);
+	}
+	for (i = 0; i < num_streams; i++) {
+		gen_name(i, buf, sizeof(buf));
+		names[i] = strdup(buf);
+		assert(names[i]);
+	}
+
+	/* baseline: every regex against every new name */
+	t0 = now();
+	for (j = 0; j < num_streams; j++) {
+		for (i = 0; i < num_clients; i++) {
+			if (0 == regexec(&clients[i].regex, names[j], 0, NULL, 0))
+				clients[i].expected++;
+		}
+	}
+	t_naive = now() - t0;
+
+	t0 = now();
+	for (i = 0; i < num_clients; i++) {
+		clients[i].c = ldms_stream_subscribe(clients[i].re, 1, stream_cb,
+						     &clients[i], "regex test");
+		assert(clients[i].c);
+	}
+	t_sub = now() - t0;
+
+	t0 = now();
+	for (j = 0; j < num_streams; j++) {
+		rc = ldms_stream_publish(NULL, names[j], LDMS_STREAM_STRING,
+					 NULL, 0444, "x", 2);
+		assert(rc == 0);
+	}
+	t_pub = now() - t0;
+
+	for (i = 0; i < num_clients; i++) {
+		total += clients[i].received;
+		if (clients[i].received != clients[i].expected) {
+			printf("client '%s': received %d, expected %d\n",
+			       clients[i].re, clients[i].received,
+			       clients[i].expected);
+			err = 1;
+		}
+	}
+	printf("%d regex clients x %d stream names, %ld deliveries\n",
+	       num_clients, num_streams, total);
+	printf("regexec() of every client  %8.3f sec\n", t_naive);
+	printf("ldms_stream_subscribe()    %8.3f sec\n", t_sub);
+	printf("ldms_stream_publish()      %8.3f sec (new stream names)\n", t_pub);
+
+	for (i = 0; i < num_clients; i++) {
+		ldms_stream_close(clients[i].c);
+		regfree(&clients[i].regex);
+	}
+	printf("%s\n", err ? "FAILED" : "PASSED");
+	return err;
+}
@@ -0,0 +1,273 @@
+/* -*- c-basic-offset: 8 -*-
+ * Copyright (c) 2026 National Technology & Engineering Solutions
+ * of Sandia, LLC (NTESS). Under the terms of Contract DE-NA0003525 with
+ * NTESS, the U.S. Government retains certain rights in this software.
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Check and measure the stream client delivery rings.
+ *
+ * NUM_PUBS threads publish NUM_MSGS messages each to a stream with a fast
+ * synchronous client and a slow client (SLOW_US microseconds per message).
+ * The slow client is run without a ring, then with a ring of RING_SIZE
+ * messages for each overflow policy, drained by its own thread and by an ev
+ * worker. For each run, the slow client must see the messages of each
+ * publisher in order, the fast client must see all of them, the drops must
+ * match the stats, and the "block" policy must not drop anything.
+ *
+ * usage: test_ldms_stream_ring [-p NUM_PUBS] [-n NUM_MSGS] [-r RING_SIZE]
+ *                              [-u SLOW_US]
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <assert.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <time.h>
+#include "ovis_json/ovis_json.h"
+#include "ldms.h"
+
+int num_pubs = 4;
+int num_msgs = 2000;
+int ring_size = 256;
+int slow_us = 20;
+
+struct slow_client {
+	int *last; /* the last sequence number seen for each publisher */
+	int received;
+	int not_json;
+	int out_of_order;
+	struct ldms_stream_client_stats_s *stats;
+	sem_t closed;
+};
+
+int fast_received;
+const char *stream_name = "ring_test";
+
+static double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int fast_cb(ldms_stream_event_t ev, void *arg)
+{
+	if (ev->type == LDMS_STREAM_EVENT_RECV)
+		__atomic_fetch_add(&fast_received, 1, __ATOMIC_SEQ_CST);
+	return 0;
+}
+
+static int slow_cb(ldms_stream_event_t ev, void *arg)
+{
+	struct slow_client *sc = arg;
+	json_entity_t pub, seq;
+
+	if (ev->type == LDMS_STREAM_EVENT_CLOSE) {
+		sem_post(&sc->closed);
+		return 0;
+	}
+	if (ev->type != LDMS_STREAM_EVENT_RECV)
+		return 0;
+	pub = ev->recv.json ? json_value_find(ev->recv.json, "pub") : NULL;
+	seq = ev->recv.json ? json_value_find(ev->recv.json, "seq") : NULL;
+	if (!pub || !seq) {
+		sc->not_json++;
+		return 0;
+	}
+	if (json_value_int(seq) <= sc->last[json_value_int(pub)])
+		sc->out_of_order++;
+	sc->last[json_value_int(pub)] = json_value_int(seq);
+	__atomic_fetch_add(&sc->received, 1, __ATOMIC_SEQ_CST);
+	usleep(slow_us);
+	return 0;
+}
+
+static void *pub_proc(void *arg)
+{
+	int i, rc, pub = (int)(long)arg;
+	char buf[64];
+
+	for (i = 0; i < num_msgs; i++) {
+		snprintf(buf, sizeof(buf), "{\"pub\":%d,\"seq\":%d}", pub, i);
+		rc = ldms_stream_publish(NULL, stream_name, LDMS_STREAM_JSON,
+					 NULL, 0444, buf, strlen(buf) + 1);
+		assert(rc == 0);
+	}
+	return NULL;
+}
+
+/* returns non-zero on error */
+static int run(const char *label, int use_ring,
+	       ldms_stream_ring_policy_t policy, ev_worker_t worker)
+{
+	struct slow_client sc = {0};
+	ldms_stream_client_t fc, c;
+	pthread_t *th;
+	double t0, t_pub, t_all;
+	uint64_t drops;
+	int i, rc, err = 0, total = num_pubs * num_msgs;
+
+	sc.last = malloc(num_pubs * sizeof(int));
+	th = malloc(num_pubs * sizeof(pthread_t));
+	assert(sc.last && th);
+	for (i = 0; i < num_pubs; i++)
+		sc.last[i] = -1;
+	sem_init(&sc.closed, 0, 0);
+	fast_received = 0;
+
+	fc = ldms_stream_subscribe(stream_name, 0, fast_cb, NULL, "fast");
+	c = ldms_stream_subscribe(stream_name, 0, slow_cb, &sc, "slow");
+	assert(fc && c);
+	if (use_ring) {
+		rc = ldms_stream_client_ring_set(c, ring_size, policy, worker);
+		assert(rc == 0);
+		rc = ldms_stream_client_ring_set(c, ring_size, policy, worker);
+		assert(rc == EBUSY);
+	}
+
+	t0 = now();
+	for (i = 0; i < num_pubs; i++)
+		pthread_create(&th[i], NULL, pub_proc, (void*)(long)i);
+	for (i = 0; i < num_pubs; i++)
+		pthread_join(th[i], NULL);
+	t_pub = now() - t0;
+	/* wait for the ring to drain */
+	for (;;) {
+		sc.stats = ldms_stream_client_get_stats(c, 0);
+		assert(sc.stats);
+		if (sc.stats->tx.count + sc.stats->drops.count == total)
+			break;
+		ldms_stream_client_stats_free(sc.stats);
+		usleep(1000);
+	}
+	t_all = now() - t0;
+	ldms_stream_close(c);
+	sem_wait(&sc.closed);
+	ldms_stream_close(fc);
+
+	drops = total - sc.received;
+	printf("%-24s publish %7.3f sec, delivered %7.3f sec, "
+	       "received %6d, dropped %6lu, max lag %4lu\n",
+	       label, t_pub, t_all, sc.received, drops,
+	       sc.stats->ring_max_lag);
+	if (fast_received != total) {
+		printf("  fast client received %d, expected %d\n",
+		       fast_received, total);
+		err = 1;
+	}
+	if (sc.out_of_order || sc.not_json) {
+		printf("  %d messages out of order, %d without json\n",
+		       sc.out_of_order, sc.not_json);
+		err = 1;
+	}
+	if (sc.stats->drops.count != drops ||
+	    sc.stats->ring_drops.count != drops ||
+	    sc.stats->tx.count != sc.received) {
+		printf("  stats: tx %lu drops %lu ring_drops %lu\n",
+		       sc.stats->tx.count, sc.stats->drops.count,
+		       sc.stats->ring_drops.count);
+		err = 1;
+	}
+	if ((!use_ring || policy == LDMS_STREAM_RING_BLOCK) && drops) {
+		printf("  unexpected drops\n");
+		err = 1;
+	}
+	if (use_ring && (sc.stats->ring_size < ring_size || sc.stats->ring_lag)) {
+		printf("  ring size %u, lag %lu\n", sc.stats->ring_size,
+		       sc.stats->ring_lag);
+		err = 1;
+	}
+	ldms_stream_client_stats_free(sc.stats);
+	sem_destroy(&sc.closed);
+	free(sc.last);
+	free(th);
+	return err;
+}
+
+int main(int argc, char **argv)
+{
+	int rc, err = 0;
+	ev_worker_t w;
+
+	while ((rc = getopt(argc, argv, "p:n:r:u:")) != -1) {
+		switch (rc) {
+		case 'p':
+			num_pubs = atoi(optarg);
+			break;
+		case 'n':
+			num_msgs = atoi(optarg);
+			break;
+		case 'r':
+			ring_size = atoi(optarg);
+			break;
+		case 'u':
+			slow_us = atoi(optarg);
+			break;
+		default:
+			printf("usage: %s [-p NUM_PUBS] [-n NUM_MSGS] "
+			       "[-r RING_SIZE] [-u SLOW_US]\n", argv[0]);
+			exit(1);
+		}
+	}
+
+	ldms_init(16 * 1024 * 1024);
+	w = ev_worker_new("ring_test", NULL);
+	assert(w);
+
+	err |= run("no ring", 0, 0, NULL);
+	err |= run("block", 1, LDMS_STREAM_RING_BLOCK, NULL);
+	err |= run("drop_oldest", 1, LDMS_STREAM_RING_DROP_OLDEST, NULL);
+	err |= run("drop_newest", 1, LDMS_STREAM_RING_DROP_NEWEST, NULL);
+	err |= run("block (ev worker)", 1, LDMS_STREAM_RING_BLOCK, w);
+	err |= run("drop_oldest (ev worker)", 1, LDMS_STREAM_RING_DROP_OLDEST, w);
+	err |= run("drop_newest (ev worker)", 1, LDMS_STREAM_RING_DROP_NEWEST, w);
+
+	printf("%s\n", err ? "FAILED" : "PASSED");
+	return err;
+}
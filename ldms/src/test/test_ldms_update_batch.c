@@ -0,0 +1,375 @@
+/* -*- c-basic-offset: 8 -*-
+ * Copyright (c) 2026 National Technology & Engineering Solutions
+ * of Sandia, LLC (NTESS). Under the terms of Contract DE-NA0003525 with
+ * NTESS, the U.S. Government retains certain rights in this software.
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Compare the update rate (sets/sec) of the per-set ldms_xprt_update() path
+ * and the ldms_xprt_update_batch() path.
+ *
+ * Server: test_ldms_update_batch -x sock -p 10001 -s -n 10000
+ * Client: test_ldms_update_batch -x sock -p 10001 -h localhost -r 20 -b 256
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <assert.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include "ldms.h"
+
+#define FMT "x:p:h:sn:m:r:b:"
+
+static char *xprt = "sock";
+static char *host = "localhost";
+static char *port = "10001";
+static int is_server;
+static int num_sets = 1000;
+static int num_metrics = 16;
+static int rounds = 10;
+static int batch_sz = 256;
+
+static ldms_t ldms;
+static sem_t conn_sem;
+static sem_t lookup_sem;
+static sem_t update_sem;
+
+static pthread_mutex_t set_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct ldms_update_batch_ent_s *ents;
+static int ents_cnt;
+static int ents_len;
+static int pending;
+
+static void usage()
+{
+	printf(
+"	-x xprt		Transport (default: sock)\n"
+"	-p port		Listener port (server) or port to connect to (client)\n"
+"	-h host		Host to connect to (client, default: localhost)\n"
+"	-s		Server mode\n"
+"	-n num_sets	Number of sets (server, default: 1000)\n"
+"	-m num_metrics	Number of u64 metrics in each set (server, default: 16)\n"
+"	-r rounds	Number of update rounds per path (client, default: 10)\n"
+"	-b batch	Number of sets per ldms_xprt_update_batch() call\n"
+"			(client, default: 256)\n"
+	);
+}
+
+static void process_args(int argc, char **argv)
+{
+	int op;
+	while ((op = getopt(argc, argv, FMT)) != -1) {
+		switch (op) {
+		case 'x':
+			xprt = strdup(optarg);
+			break;
+		case 'p':
+			port = strdup(optarg);
+			break;
+		case 'h':
+			host = strdup(optarg);
+			break;
+		case 's':
+			is_server = 1;
+			break;
+		case 'n':
+			num_sets = atoi(optarg);
+			break;
+		case 'm':
+			num_metrics = atoi(optarg);
+			break;
+		case 'r':
+			rounds = atoi(optarg);
+			break;
+		case 'b':
+			batch_sz = atoi(optarg);
+			break;
+		default:
+			usage();
+			exit(1);
+		}
+	}
+}
+
+static void do_server()
+{
+	ldms_schema_t schema;
+	ldms_set_t *sets;
+	char name[64];
+	int i, j, rc;
+	uint64_t v = 0;
+
+	schema = ldms_schema_new("update_batch");
+	assert(schema);
+	for (i = 0; i < num_metrics; i++) {
+		snprintf(name, sizeof(name), "metric_%d", i);
+		rc = ldms_schema_metric_add(schema, name, LDMS_V_U64);
+		assert(rc >= 0);
+	}
+	sets = calloc(num_sets, sizeof(*sets));
+	assert(sets);
+	for (i = 0; i < num_sets; i++) {
+		snprintf(name, sizeof(name), "update_batch/%d", i);
+		sets[i] = ldms_set_new(name, schema);
+		if (!sets[i]) {
+			printf("Failed to create set '%s', error %d\n", name, errno);
+			exit(1);
+		}
+		ldms_set_publish(sets[i]);
+	}
+	rc = ldms_xprt_listen_by_name(ldms, NULL, port, NULL, NULL);
+	if (rc) {
+		printf("Failed to listen on port %s, error %d\n", port, rc);
+		exit(1);
+	}
+	printf("Listening on port %s with %d sets\n", port, num_sets);
+	while (1) {
+		for (i = 0; i < num_sets; i++) {
+			ldms_transaction_begin(sets[i]);
+			for (j = 0; j < num_metrics; j++)
+				ldms_metric_set_u64(sets[i], j, v);
+			ldms_transaction_end(sets[i]);
+		}
+		v++;
+		sleep(1);
+	}
+}
+
+static void update_cb(ldms_t x, ldms_set_t set, int flags, void *arg)
+{
+	if (LDMS_UPD_ERROR(flags)) {
+		printf("Update error %d on set '%s'\n", LDMS_UPD_ERROR(flags),
+			ldms_set_instance_name_get(set));
+		exit(1);
+	}
+	if (flags & LDMS_UPD_F_MORE)
+		return;
+	if (0 == __atomic_sub_fetch(&pending, 1, __ATOMIC_SEQ_CST))
+		sem_post(&update_sem);
+}
+
+static void lookup_cb(ldms_t x, enum ldms_lookup_status status,
+		      int more, ldms_set_t set, void *arg)
+{
+	if (status != LDMS_LOOKUP_OK) {
+		printf("Lookup failed, status %d\n", status);
+		exit(1);
+	}
+	pthread_mutex_lock(&set_lock);
+	if (ents_cnt == ents_len) {
+		ents_len = ents_len ? 2 * ents_len : 1024;
+		ents = realloc(ents, ents_len * sizeof(*ents));
+		assert(ents);
+	}
+	memset(&ents[ents_cnt], 0, sizeof(*ents));
+	ents[ents_cnt++].set = set;
+	pthread_mutex_unlock(&set_lock);
+	if (!more)
+		sem_post(&lookup_sem);
+}
+
+static void conn_cb(ldms_t x, ldms_xprt_event_t e, void *arg)
+{
+	switch (e->type) {
+	case LDMS_XPRT_EVENT_CONNECTED:
+		sem_post(&conn_sem);
+		break;
+	case LDMS_XPRT_EVENT_REJECTED:
+	case LDMS_XPRT_EVENT_ERROR:
+	case LDMS_XPRT_EVENT_DISCONNECTED:
+		printf("Connection failed or disconnected, event %d\n", e->type);
+		exit(1);
+	default:
+		break;
+	}
+}
+
+static double ts_diff(struct timespec *a, struct timespec *b)
+{
+	return (b->tv_sec - a->tv_sec) + (b->tv_nsec - a->tv_nsec) / 1e9;
+}
+
+static double run_per_set()
+{
+	struct timespec start, end;
+	int r, i, rc;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (r = 0; r < rounds; r++) {
+		pending = ents_cnt;
+		for (i = 0; i < ents_cnt; i++) {
+			rc = ldms_xprt_update(ents[i].set, update_cb, NULL);
+			if (rc) {
+				printf("ldms_xprt_update() error %d\n", rc);
+				exit(1);
+			}
+		}
+		sem_wait(&update_sem);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	return (double)rounds * ents_cnt / ts_diff(&start, &end);
+}
+
+static double run_batch()
+{
+	struct timespec start, end;
+	int r, i, n, rc;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (r = 0; r < rounds; r++) {
+		pending = ents_cnt;
+		for (i = 0; i < ents_cnt; i += batch_sz) {
+			n = ents_cnt - i;
+			if (n > batch_sz)
+				n = batch_sz;
+			rc = ldms_xprt_update_batch(&ents[i], n, update_cb);
+			if (rc) {
+				printf("ldms_xprt_update_batch() error %d\n", rc);
+				exit(1);
+			}
+		}
+		sem_wait(&update_sem);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	return (double)rounds * ents_cnt / ts_diff(&start, &end);
+}
+
+/* A local set in a batch fails with EINVAL; the other sets are updated */
+static void check_local_set()
+{
+	struct ldms_update_batch_ent_s b[2] = {{0}};
+	ldms_schema_t schema;
+	ldms_set_t set;
+	int rc;
+
+	schema = ldms_schema_new("update_batch_local");
+	assert(schema);
+	rc = ldms_schema_metric_add(schema, "metric_0", LDMS_V_U64);
+	assert(rc >= 0);
+	set = ldms_set_new("update_batch_local/0", schema);
+	assert(set);
+
+	b[0].set = set;
+	b[1].set = ents[0].set;
+	pending = 1;
+	rc = ldms_xprt_update_batch(b, 2, update_cb);
+	if (rc != EINVAL || b[0].rc != EINVAL || b[1].rc != 0) {
+		printf("ldms_xprt_update_batch() with a local set: rc %d, "
+		       "local rc %d, remote rc %d\n", rc, b[0].rc, b[1].rc);
+		exit(1);
+	}
+	sem_wait(&update_sem);
+
+	rc = ldms_xprt_update_batch(b, 1, update_cb);
+	if (rc != EINVAL || b[0].rc != EINVAL) {
+		printf("ldms_xprt_update_batch() of a local set: rc %d\n", rc);
+		exit(1);
+	}
+	ldms_set_delete(set);
+	ldms_schema_delete(schema);
+}
+
+static void do_client()
+{
+	int rc;
+	double per_set, batch;
+
+	sem_init(&conn_sem, 0, 0);
+	sem_init(&lookup_sem, 0, 0);
+	sem_init(&update_sem, 0, 0);
+	rc = ldms_xprt_connect_by_name(ldms, host, port, conn_cb, NULL);
+	if (rc) {
+		printf("ldms_xprt_connect_by_name() error %d\n", rc);
+		exit(1);
+	}
+	sem_wait(&conn_sem);
+	rc = ldms_xprt_lookup(ldms, "update_batch/.*", LDMS_LOOKUP_RE,
+			      lookup_cb, NULL);
+	if (rc) {
+		printf("ldms_xprt_lookup() error %d\n", rc);
+		exit(1);
+	}
+	sem_wait(&lookup_sem);
+	printf("Looked up %d sets\n", ents_cnt);
+
+	/* warm up, the first update also fetches the metadata */
+	(void)run_per_set();
+	check_local_set();
+
+	per_set = run_per_set();
+	batch = run_batch();
+	printf("%-24s %16.1f sets/sec\n", "ldms_xprt_update", per_set);
+	printf("%-24s %16.1f sets/sec (batch %d, %.2fx)\n",
+		"ldms_xprt_update_batch", batch, batch_sz, batch / per_set);
+}
+
+int main(int argc, char **argv)
+{
+	process_args(argc, argv);
+	if (batch_sz <= 0 || num_sets <= 0 || rounds <= 0) {
+		usage();
+		exit(1);
+	}
+	ldms_init(512 * 1024 * 1024);
+	ldms = ldms_xprt_new(xprt);
+	if (!ldms) {
+		printf("Failed to create the '%s' transport, error %d\n",
+			xprt, errno);
+		exit(1);
+	}
+	if (is_server)
+		do_server();
+	else
+		do_client();
+	return 0;
+}
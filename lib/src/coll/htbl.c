@@ -76,15 +76,30 @@ static uint64_t default_hash_fn(const void *key, size_t key_len)
  */
 htbl_t htbl_alloc(htbl_cmp_fn_t cmp_fn, size_t depth)
 {
-	htbl_t t = malloc(sizeof(struct htbl)
-			  + (depth * sizeof(struct hent_list_head)));
-	if (t) {
-		t->table_depth = depth;
-		t->entry_count = 0;
-		t->cmp_fn = cmp_fn;
-		t->hash_fn = default_hash_fn;
-		memset(t->table, 0, (depth * sizeof(struct hent_list_head)));
-	}
+	void *mem = malloc(htbl_size(depth));
+	if (!mem)
+		return NULL;
+	return htbl_init(mem, cmp_fn, depth);
+}
+
+/**
+ * \brief Initialize a Hash Table in memory owned by the caller
+ *
+ * The table must not be passed to htbl_free().
+ *
+ * \param mem	Memory of at least htbl_size(depth) bytes.
+ * \param cmp_fn	Pointer to the function that compares entries
+ *		in the Hash Table
+ * \param depth	The number of hash buckets
+ */
+htbl_t htbl_init(void *mem, htbl_cmp_fn_t cmp_fn, size_t depth)
+{
+	htbl_t t = mem;
+	t->table_depth = depth;
+	t->entry_count = 0;
+	t->cmp_fn = cmp_fn;
+	t->hash_fn = default_hash_fn;
+	memset(t->table, 0, (depth * sizeof(struct hent_list_head)));
 	return t;
 }
 
@@ -24,6 +24,8 @@ struct htbl {
 };
 
 htbl_t htbl_alloc(htbl_cmp_fn_t cmp_fn, size_t depth);
+htbl_t htbl_init(void *mem, htbl_cmp_fn_t cmp_fn, size_t depth);
+#define htbl_size(depth) (sizeof(struct htbl) + ((depth) * sizeof(struct hent_list_head)))
 void htbl_free(htbl_t t);
 void hent_init(hent_t, const void *, size_t);
 void htbl_ins(htbl_t t, hent_t);
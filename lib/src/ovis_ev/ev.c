@@ -71,6 +71,19 @@ ev_type_t ev_type(ev_t ev)
 	return e->e_type;
 }
 
+int ev_type_affinity_set(ev_type_t t, ev_affinity_t affinity)
+{
+	if (affinity != EV_AFFINITY_NONE && affinity != EV_AFFINITY_ORDERED)
+		return EINVAL;
+	t->t_affinity = affinity;
+	return 0;
+}
+
+ev_affinity_t ev_type_affinity(ev_type_t t)
+{
+	return t->t_affinity;
+}
+
 uint32_t ev_type_id(ev_type_t t)
 {
 	return t->t_id;
@@ -144,19 +157,32 @@ int ev_post(ev_worker_t src, ev_worker_t dst, ev_t ev, struct timespec *to)
 
 	e->e_src = src;
 	e->e_dst = dst;
-	rbn_init(&e->e_to_rbn, &e->e_to);
 
+	if (!to) {
+		/*
+		 * Immediate events do not take the worker lock. The worker
+		 * does not end a flush while a post that saw it running is
+		 * still enqueuing, so the event is flushed too.
+		 */
+		__atomic_add_fetch(&dst->w_posting, 1, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&dst->w_state, __ATOMIC_SEQ_CST) ==
+		    EV_WORKER_FLUSHING) {
+			__atomic_sub_fetch(&dst->w_posting, 1, __ATOMIC_SEQ_CST);
+			e->e_posted = 0;
+			return EBUSY;
+		}
+		ev_get(&e->e_ev);
+		ev_worker_enqueue(dst, e);
+		__atomic_sub_fetch(&dst->w_posting, 1, __ATOMIC_SEQ_CST);
+		return 0;
+	}
+
+	rbn_init(&e->e_to_rbn, &e->e_to);
 	pthread_mutex_lock(&dst->w_lock);
 	if (dst->w_state == EV_WORKER_FLUSHING)
 		goto err;
 	ev_get(&e->e_ev);
-	if (to) {
-		rbt_ins(&dst->w_event_tree, &e->e_to_rbn);
-	} else {
-		__sync_fetch_and_add(&dst->w_ev_list_len, 1);
-		TAILQ_INSERT_TAIL(&dst->w_event_list, e, e_entry);
-
-	}
+	rbt_ins(&dst->w_event_tree, &e->e_to_rbn);
 	rc = (ev_time_cmp(&e->e_to, &dst->w_sem_wait) <= 0);
 	pthread_mutex_unlock(&dst->w_lock);
 	if (rc)
@@ -196,12 +222,10 @@ int ev_cancel(ev_t ev)
 	}
 
 	rbt_del(&e->e_dst->w_event_tree, &e->e_to_rbn);
-	__sync_fetch_and_add(&e->e_dst->w_ev_list_len, 1);
-	TAILQ_INSERT_TAIL(&e->e_dst->w_event_list, e, e_entry);
  out:
 	pthread_mutex_unlock(&e->e_dst->w_lock);
 	if (!rc)
-		sem_post(&e->e_dst->w_sem);
+		ev_worker_enqueue(e->e_dst, e);
 	return rc;
 }
 
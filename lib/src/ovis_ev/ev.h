@@ -22,6 +22,7 @@
  */
 
 typedef struct ev_worker_s *ev_worker_t;
+typedef struct ev_pool_s *ev_pool_t;
 typedef struct ev_type_s *ev_type_t;
 typedef struct ev_s {
 	uint8_t e_data[0];
@@ -32,6 +33,18 @@ typedef enum ev_status_e {
 	EV_FLUSH,
 } ev_status_t;
 
+/**
+ * How the events of a type may be spread over the workers of a pool.
+ *
+ * EV_AFFINITY_NONE events may be stolen by any idle worker of the
+ * pool. EV_AFFINITY_ORDERED events are delivered by the worker that
+ * they were posted to, in the order they were posted by each thread.
+ */
+typedef enum ev_affinity_e {
+	EV_AFFINITY_NONE = 0,
+	EV_AFFINITY_ORDERED,
+} ev_affinity_t;
+
 /**
  * \brief The worker's event callback function
  *
@@ -299,4 +312,87 @@ double ev_time_diff(struct timespec *tsa, const struct timespec *tsb);
  */
 int ev_pending(ev_worker_t w);
 
+/**
+ * \brief Set the pool affinity of an event type
+ * See ev_affinity_t. The default is EV_AFFINITY_NONE. The affinity
+ * only matters for events posted to a worker that belongs to a pool.
+ * \param t The event type handle
+ * \param affinity EV_AFFINITY_NONE or EV_AFFINITY_ORDERED
+ * \retval 0 Success
+ * \retval EINVAL \c affinity is not valid
+ */
+int ev_type_affinity_set(ev_type_t t, ev_affinity_t affinity);
+
+/**
+ * \brief Return the pool affinity of an event type
+ * \param t The event type handle
+ * \returns The affinity
+ */
+ev_affinity_t ev_type_affinity(ev_type_t t);
+
+/**
+ * \brief Create a pool of workers
+ * A pool is \c count workers named "<name>:<index>" that share the
+ * work posted to any of them. A worker that has no events of its own
+ * steals immediate events of EV_AFFINITY_NONE types from the other
+ * workers of the pool. Events with a timeout and events of
+ * EV_AFFINITY_ORDERED types are always delivered by the worker they
+ * were posted to.
+ * Pool names must be unique among pools.
+ * \param name The pool name
+ * \param count The number of workers
+ * \param actor_fn The default actor of the workers
+ * \returns The pool handle or NULL with \c errno set to EINVAL,
+ *          ENOMEM or EEXIST.
+ */
+ev_pool_t ev_pool_new(const char *name, int count, ev_actor_t actor_fn);
+
+/**
+ * \brief Get the pool handle
+ * \param name The pool name
+ * \returns The pool handle or NULL if the pool is not found
+ */
+ev_pool_t ev_pool_get(const char *name);
+
+/**
+ * \brief Return the number of workers in the pool
+ */
+int ev_pool_size(ev_pool_t p);
+
+/**
+ * \brief Return the worker at \c idx in the pool
+ * \returns The worker handle or NULL if \c idx is out of range
+ */
+ev_worker_t ev_pool_worker(ev_pool_t p, int idx);
+
+/**
+ * \brief Dispatch an event type to an actor on every worker of the pool
+ * See ev_dispatch().
+ */
+int ev_pool_dispatch(ev_pool_t p, ev_type_t t, ev_actor_t fn);
+
+/**
+ * \brief Post an event to a pool
+ * Events of EV_AFFINITY_ORDERED types are posted to the worker
+ * selected by \c key, so events posted with the same key are delivered
+ * in order by the same worker. Other events are spread over the
+ * workers round-robin and \c key is ignored. See ev_post() for the
+ * other parameters.
+ * \param src The source worker
+ * \param dst The destination pool
+ * \param ev The event
+ * \param key The ordering key
+ * \param to The scheduled event deliver time (null == now)
+ * \retval 0 Event posted
+ * \retval EBUSY The event is already posted
+ */
+int ev_pool_post(ev_worker_t src, ev_pool_t dst, ev_t ev, uint64_t key,
+		 struct timespec *to);
+
+/**
+ * \brief Flush all events queued to the workers of a pool
+ * See ev_flush().
+ */
+void ev_pool_flush(ev_pool_t p);
+
 #endif
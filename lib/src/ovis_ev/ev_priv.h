@@ -12,6 +12,25 @@ struct ev_type_s {
 	uint64_t t_id;
 	struct rbn t_rbn;
 	size_t t_size;
+	ev_affinity_t t_affinity;
+};
+
+/*
+ * Intrusive multi-producer single-consumer queue (D. Vyukov). Producers
+ * never block one another; a push is one atomic exchange. Only one
+ * thread at a time may pop, see q_busy.
+ */
+struct ev_qnode_s {
+	struct ev_qnode_s *next;
+};
+
+struct ev_queue_s {
+	struct ev_qnode_s *q_head;	/* last pushed, producer side */
+	char q_pad[64 - sizeof(void *)];
+	struct ev_qnode_s *q_tail;	/* next to pop, consumer side */
+	struct ev_qnode_s q_stub;
+	int q_busy;			/* set by the thread that is popping */
+	int q_len;
 };
 
 typedef struct ev__s {
@@ -23,7 +42,7 @@ typedef struct ev__s {
 	ev_status_t e_status;
 	struct timespec e_to;
 	struct rbn e_to_rbn;
-	TAILQ_ENTRY(ev__s) e_entry;
+	struct ev_qnode_s e_qnode;
 	struct ev_s e_ev;
 } *ev__t;
 
@@ -37,20 +56,39 @@ struct ev_worker_s {
 	char *w_name;
 	ev_actor_t w_actor;
 	pthread_t w_thread;
-	enum evw_state_e w_state;
+	enum evw_state_e w_state;	/* written under w_lock, read atomically */
+	int w_posting;		/* immediate posts past the w_state check */
 	struct timespec w_sem_wait;
 	sem_t w_sem;
+	int w_sleeping;		/* the worker is (about to be) in sem_wait */
 	struct rbn w_rbn;
 	pthread_mutex_t w_lock;
 	ev_actor_t *w_dispatch;
 	size_t w_dispatch_len;
-	/* An ordered tree of events with timeouts */
+	/* An ordered tree of events with timeouts, protected by w_lock */
 	struct rbt w_event_tree;
-	/* A list of events without timeouts */
-	TAILQ_HEAD(w_event_list, ev__s) w_event_list;
-	int w_ev_list_len;
+	/* Events without timeouts, other pool workers may steal these */
+	struct ev_queue_s w_queue;
+	/* Events of EV_AFFINITY_ORDERED types posted to a pool worker */
+	struct ev_queue_s w_oqueue;
+	/* The pool this worker belongs to, or NULL */
+	ev_pool_t w_pool;
+	int w_pool_idx;
 };
 
+struct ev_pool_s {
+	char *p_name;
+	struct rbn p_rbn;
+	int p_count;
+	ev_worker_t p_workers[0];
+};
+
+void ev_queue_init(struct ev_queue_s *q);
+void ev_queue_push(struct ev_queue_s *q, ev__t e);
+ev__t ev_queue_pop(struct ev_queue_s *q);
+void ev_worker_wake(ev_worker_t w);
+void ev_worker_enqueue(ev_worker_t w, ev__t e);
+
 #define EV(_e_) container_of(_e_, struct ev__s, e_ev);
 #endif
 
@@ -1,9 +1,11 @@
 #define _GNU_SOURCE
 #include <linux/param.h>
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <errno.h>
 #include <pthread.h>
+#include <sched.h>
 #include <time.h>
 #include <inttypes.h>
 #include <coll/rbt.h>
@@ -44,42 +46,197 @@ int ev_time_cmp(struct timespec *tsa, const struct timespec *tsb)
 }
 
 /*
- * Process all of the events in the worker's event list.
+ * Immediate events are delivered in batches of at most EV_BATCH between
+ * checks of the timed event tree. An idle pool worker steals at most
+ * EV_STEAL_BATCH events from a peer before looking at its own queues
+ * again.
+ */
+#define EV_BATCH	64
+#define EV_STEAL_BATCH	16
+
+void ev_queue_init(struct ev_queue_s *q)
+{
+	q->q_stub.next = NULL;
+	q->q_head = &q->q_stub;
+	q->q_tail = &q->q_stub;
+	q->q_busy = 0;
+	q->q_len = 0;
+}
+
+static void __queue_link(struct ev_queue_s *q, struct ev_qnode_s *n)
+{
+	struct ev_qnode_s *prev;
+
+	n->next = NULL;
+	prev = __atomic_exchange_n(&q->q_head, n, __ATOMIC_ACQ_REL);
+	__atomic_store_n(&prev->next, n, __ATOMIC_RELEASE);
+}
+
+void ev_queue_push(struct ev_queue_s *q, ev__t e)
+{
+	__atomic_add_fetch(&q->q_len, 1, __ATOMIC_SEQ_CST);
+	__queue_link(q, &e->e_qnode);
+}
+
+/*
+ * Remove the oldest event from the queue. The caller must own q_busy.
  *
- * Called with the worker lock held.
+ * Returns NULL if the queue is empty or if a producer has swapped the
+ * head but not yet linked its node; q_len is non-zero in the latter case.
  */
-static void process_immediate_events(ev_worker_t w)
+ev__t ev_queue_pop(struct ev_queue_s *q)
+{
+	struct ev_qnode_s *tail = q->q_tail;
+	struct ev_qnode_s *next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+
+	if (tail == &q->q_stub) {
+		if (!next)
+			return NULL;
+		q->q_tail = next;
+		tail = next;
+		next = __atomic_load_n(&next->next, __ATOMIC_ACQUIRE);
+	}
+	if (next)
+		goto out;
+	if (tail != __atomic_load_n(&q->q_head, __ATOMIC_ACQUIRE))
+		return NULL;
+	__queue_link(q, &q->q_stub);
+	next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+	if (!next)
+		return NULL;
+ out:
+	q->q_tail = next;
+	__atomic_sub_fetch(&q->q_len, 1, __ATOMIC_SEQ_CST);
+	return container_of(tail, struct ev__s, e_qnode);
+}
+
+/*
+ * Pop one event if no other thread is popping from the queue. The
+ * queue is released before the event is delivered so that idle pool
+ * workers can steal the rest while the actor runs.
+ */
+static ev__t queue_take(struct ev_queue_s *q)
 {
 	ev__t e;
-	ev_actor_t actor;
- next:
-	if (TAILQ_EMPTY(&w->w_event_list))
-		return;
 
-	e = TAILQ_FIRST(&w->w_event_list);
-	TAILQ_REMOVE(&w->w_event_list, e, e_entry);
-	__sync_fetch_and_sub(&w->w_ev_list_len, 1);
-	e->e_posted = 0;
+	if (!__atomic_load_n(&q->q_len, __ATOMIC_ACQUIRE))
+		return NULL;
+	if (__atomic_exchange_n(&q->q_busy, 1, __ATOMIC_ACQUIRE))
+		return NULL;
+	e = ev_queue_pop(q);
+	__atomic_store_n(&q->q_busy, 0, __ATOMIC_RELEASE);
+	return e;
+}
 
-	if (w->w_state == EV_WORKER_FLUSHING)
-		e->e_status = EV_FLUSH;
+static int queue_pending(ev_worker_t w)
+{
+	return __atomic_load_n(&w->w_queue.q_len, __ATOMIC_SEQ_CST)
+		+ __atomic_load_n(&w->w_oqueue.q_len, __ATOMIC_SEQ_CST);
+}
 
-	pthread_mutex_unlock(&w->w_lock);
-	actor = NULL;
+/*
+ * Deliver an event with the dispatch table and flush state of the
+ * worker it was posted to, which for a stolen event is not the calling
+ * thread's worker.
+ */
+static void deliver_event(ev__t e)
+{
+	ev_worker_t w = e->e_dst;
+	ev_actor_t actor = NULL;
+
+	e->e_posted = 0;
+	if (__atomic_load_n(&w->w_state, __ATOMIC_ACQUIRE) == EV_WORKER_FLUSHING)
+		e->e_status = EV_FLUSH;
 	if (e->e_type->t_id < w->w_dispatch_len)
 		actor = w->w_dispatch[e->e_type->t_id];
 	if (!actor)
 		actor = w->w_actor;
 	actor(e->e_src, e->e_dst, e->e_status, &e->e_ev);
 	ev_put(&e->e_ev);
-	pthread_mutex_lock(&w->w_lock);
-	goto next;
+}
+
+void ev_worker_wake(ev_worker_t w)
+{
+	if (__atomic_load_n(&w->w_sleeping, __ATOMIC_SEQ_CST) &&
+	    __atomic_exchange_n(&w->w_sleeping, 0, __ATOMIC_SEQ_CST))
+		sem_post(&w->w_sem);
+}
+
+void ev_worker_enqueue(ev_worker_t w, ev__t e)
+{
+	struct ev_queue_s *q = &w->w_queue;
+	ev_pool_t p = w->w_pool;
+	ev_worker_t peer;
+	int i;
+
+	if (p && e->e_type->t_affinity == EV_AFFINITY_ORDERED)
+		q = &w->w_oqueue;
+	ev_queue_push(q, e);
+	ev_worker_wake(w);
+	if (!p || q == &w->w_oqueue
+	    || __atomic_load_n(&q->q_len, __ATOMIC_RELAXED) < 2)
+		return;
+	/* The worker has a backlog that others may steal, wake an idle peer */
+	for (i = 1; i < p->p_count; i++) {
+		peer = p->p_workers[(w->w_pool_idx + i) % p->p_count];
+		if (__atomic_load_n(&peer->w_sleeping, __ATOMIC_RELAXED) &&
+		    __atomic_exchange_n(&peer->w_sleeping, 0, __ATOMIC_SEQ_CST)) {
+			sem_post(&peer->w_sem);
+			break;
+		}
+	}
+}
+
+/*
+ * Deliver up to EV_BATCH events from the worker's queues. Ordered
+ * events go first, they cannot be delivered by anyone else.
+ *
+ * Returns the number of events delivered.
+ */
+static int process_immediate_events(ev_worker_t w)
+{
+	ev__t e;
+	int n;
+
+	for (n = 0; n < EV_BATCH; n++) {
+		e = queue_take(&w->w_oqueue);
+		if (!e)
+			e = queue_take(&w->w_queue);
+		if (!e)
+			break;
+		deliver_event(e);
+	}
+	return n;
+}
+
+/*
+ * Deliver events from the queue of the first pool peer that has any.
+ *
+ * Returns the number of events delivered.
+ */
+static int steal_events(ev_worker_t w)
+{
+	ev_pool_t p = w->w_pool;
+	ev_worker_t peer;
+	ev__t e;
+	int i, n = 0;
+
+	for (i = 1; i < p->p_count && !n; i++) {
+		peer = p->p_workers[(w->w_pool_idx + i) % p->p_count];
+		while (n < EV_STEAL_BATCH && (e = queue_take(&peer->w_queue))) {
+			deliver_event(e);
+			n++;
+		}
+	}
+	return n;
 }
 
 /*
  * Process all of the events in the worker's event tree that have a
  * timeout before or at the current time.
  *
+ * Called with the worker lock held.
+ *
  * Return the 1st event that has a timeout > now
  */
 static ev__t process_to_events(ev_worker_t w)
@@ -87,7 +244,6 @@ static ev__t process_to_events(ev_worker_t w)
 	ev__t e;
 	struct rbn *rbn;
 	struct timespec now;
-	ev_actor_t actor;
 	clock_gettime(CLOCK_REALTIME, &now);
  next:
 	e = NULL;
@@ -104,15 +260,8 @@ static ev__t process_to_events(ev_worker_t w)
 	}
 
 	rbt_del(&w->w_event_tree, &e->e_to_rbn);
-	e->e_posted = 0;
 	pthread_mutex_unlock(&w->w_lock);
-	actor = NULL;
-	if (e->e_type->t_id < w->w_dispatch_len)
-		actor = w->w_dispatch[e->e_type->t_id];
-	if (!actor)
-		actor = w->w_actor;
-	actor(e->e_src, e->e_dst, e->e_status, &e->e_ev);
-	ev_put(&e->e_ev);
+	deliver_event(e);
 	pthread_mutex_lock(&w->w_lock);
 	goto next;
 
@@ -131,22 +280,54 @@ static void *worker_proc(void *arg)
 {
 	ev__t e;
 	ev_worker_t w = arg;
-	w->w_state = EV_WORKER_RUNNING;
-	ev_sched_to(&w->w_sem_wait, 0, 0);
-	sem_timedwait(&w->w_sem, &w->w_sem_wait);
+	int n, flushing;
+
+	pthread_mutex_lock(&w->w_lock);
+	/* an ev_flush() before the thread runs is not lost */
+	if (w->w_state == EV_WORKER_STOPPED)
+		__atomic_store_n(&w->w_state, EV_WORKER_RUNNING, __ATOMIC_SEQ_CST);
+	pthread_mutex_unlock(&w->w_lock);
 	while (1) {
+		n = process_immediate_events(w);
 		pthread_mutex_lock(&w->w_lock);
-		process_immediate_events(w);
 		e = process_to_events(w);
 		if (e) {
 			w->w_sem_wait = e->e_to;
 		} else {
 			ev_sched_to(&w->w_sem_wait, 10, 0);
 		}
-		if (w->w_state == EV_WORKER_FLUSHING)
-			w->w_state = EV_WORKER_RUNNING;
+		flushing = (w->w_state == EV_WORKER_FLUSHING && n < EV_BATCH);
+		if (flushing &&
+		    !__atomic_load_n(&w->w_posting, __ATOMIC_SEQ_CST) &&
+		    !queue_pending(w)) {
+			__atomic_store_n(&w->w_state, EV_WORKER_RUNNING,
+					 __ATOMIC_SEQ_CST);
+			flushing = 0;
+		}
 		pthread_mutex_unlock(&w->w_lock);
+		if (n)
+			continue;
+		if (flushing) {
+			/* a post that raced with ev_flush() is enqueuing */
+			sched_yield();
+			continue;
+		}
+		if (w->w_pool && steal_events(w))
+			continue;
+		/*
+		 * Posters check w_sleeping after pushing, the worker
+		 * checks the queues after setting it, so one of the two
+		 * sees the other.
+		 */
+		__atomic_store_n(&w->w_sleeping, 1, __ATOMIC_SEQ_CST);
+		if (queue_pending(w)) {
+			__atomic_store_n(&w->w_sleeping, 0, __ATOMIC_SEQ_CST);
+			/* a push is in progress */
+			sched_yield();
+			continue;
+		}
 		sem_timedwait(&w->w_sem, &w->w_sem_wait);
+		__atomic_store_n(&w->w_sleeping, 0, __ATOMIC_SEQ_CST);
 	}
 	return NULL;
 }
@@ -154,12 +335,29 @@ static void *worker_proc(void *arg)
 void ev_flush(ev_worker_t w)
 {
 	pthread_mutex_lock(&w->w_lock);
-	w->w_state = EV_WORKER_FLUSHING;
+	__atomic_store_n(&w->w_state, EV_WORKER_FLUSHING, __ATOMIC_SEQ_CST);
 	pthread_mutex_unlock(&w->w_lock);
 	sem_post(&w->w_sem);
 }
 
-ev_worker_t ev_worker_new(const char *name, ev_actor_t actor_fn)
+static int worker_start(ev_worker_t w)
+{
+	int err;
+	size_t namelen, nameoff = 0;
+
+	err = pthread_create(&w->w_thread, NULL, worker_proc, w);
+	if (err)
+		return err;
+	namelen = strlen(w->w_name);
+	if (namelen > 15)
+		/* Use the last 16 chars of the worker name */
+		nameoff = namelen - 15;
+	pthread_setname_np(w->w_thread, &w->w_name[nameoff]);
+	return 0;
+}
+
+static ev_worker_t worker_new(const char *name, ev_actor_t actor_fn,
+			      ev_pool_t pool, int pool_idx)
 {
 	int err = ENOMEM;
 	ev_worker_t w;
@@ -172,6 +370,8 @@ ev_worker_t ev_worker_new(const char *name, ev_actor_t actor_fn)
 	if (!w->w_name)
 		goto err_1;
 	w->w_actor = actor_fn;
+	w->w_pool = pool;
+	w->w_pool_idx = pool_idx;
 	err = sem_init(&w->w_sem, 0, 0);
 	if (err)
 		goto err_2;
@@ -179,7 +379,9 @@ ev_worker_t ev_worker_new(const char *name, ev_actor_t actor_fn)
 	w->w_state = EV_WORKER_STOPPED;
 	pthread_mutex_init(&w->w_lock, NULL);
 	rbt_init(&w->w_event_tree, (int (*)(void *, const void*))ev_time_cmp);
-	TAILQ_INIT(&w->w_event_list);
+	ev_queue_init(&w->w_queue);
+	ev_queue_init(&w->w_oqueue);
+	ev_sched_to(&w->w_sem_wait, 0, 0);
 
 	pthread_mutex_lock(&worker_lock);
 	err = EEXIST;
@@ -190,17 +392,19 @@ ev_worker_t ev_worker_new(const char *name, ev_actor_t actor_fn)
 	rbt_ins(&worker_tree, &w->w_rbn);
 	pthread_mutex_unlock(&worker_lock);
 
-	err = pthread_create(&w->w_thread, NULL, worker_proc, w);
+	if (pool) {
+		/* ev_pool_new() starts the threads once the pool is complete */
+		errno = 0;
+		return w;
+	}
+	err = worker_start(w);
 	if (err)
-		goto err_2;
-	size_t namelen = strlen(w->w_name);
-	size_t nameoff = 0;
-	if (namelen > 15)
-		/* Use the last 16 chars of the worker name */
-		nameoff = namelen - 15;
-	pthread_setname_np(w->w_thread, &w->w_name[nameoff]);
+		goto err_3;
 	errno = 0;
 	return w;
+ err_3:
+	pthread_mutex_lock(&worker_lock);
+	rbt_del(&worker_tree, &w->w_rbn);
  err_2:
 	pthread_mutex_unlock(&worker_lock);
  err_1:
@@ -211,6 +415,11 @@ ev_worker_t ev_worker_new(const char *name, ev_actor_t actor_fn)
 	return NULL;
 }
 
+ev_worker_t ev_worker_new(const char *name, ev_actor_t actor_fn)
+{
+	return worker_new(name, actor_fn, NULL, 0);
+}
+
 ev_worker_t ev_worker_get(const char *name)
 {
 	ev_worker_t w = NULL;
@@ -280,7 +489,139 @@ int ev_pending(ev_worker_t w)
 
 	pthread_mutex_lock(&w->w_lock);
 	count = rbt_card(&w->w_event_tree);
-	count += w->w_ev_list_len;
 	pthread_mutex_unlock(&w->w_lock);
+	count += queue_pending(w);
 	return count;
 }
+
+static struct rbt pool_tree = RBT_INITIALIZER(type_cmp);
+
+ev_pool_t ev_pool_new(const char *name, int count, ev_actor_t actor_fn)
+{
+	char wname[256];
+	ev_pool_t p;
+	int i, err;
+
+	if (count <= 0) {
+		errno = EINVAL;
+		return NULL;
+	}
+	p = calloc(1, sizeof(*p) + count * sizeof(ev_worker_t));
+	if (!p)
+		goto enomem;
+	p->p_name = strdup(name);
+	if (!p->p_name)
+		goto enomem;
+	p->p_count = count;
+
+	pthread_mutex_lock(&worker_lock);
+	if (rbt_find(&pool_tree, name)) {
+		pthread_mutex_unlock(&worker_lock);
+		free(p->p_name);
+		free(p);
+		errno = EEXIST;
+		return NULL;
+	}
+	rbn_init(&p->p_rbn, p->p_name);
+	rbt_ins(&pool_tree, &p->p_rbn);
+	pthread_mutex_unlock(&worker_lock);
+
+	for (i = 0; i < count; i++) {
+		snprintf(wname, sizeof(wname), "%s:%d", name, i);
+		p->p_workers[i] = worker_new(wname, actor_fn, p, i);
+		if (!p->p_workers[i])
+			goto err;
+	}
+	for (i = 0; i < count; i++) {
+		err = worker_start(p->p_workers[i]);
+		if (err) {
+			/* There is no way to stop the threads already started */
+			errno = err;
+			return NULL;
+		}
+	}
+	errno = 0;
+	return p;
+ err:
+	err = errno;
+	pthread_mutex_lock(&worker_lock);
+	while (i--) {
+		rbt_del(&worker_tree, &p->p_workers[i]->w_rbn);
+		sem_destroy(&p->p_workers[i]->w_sem);
+		free(p->p_workers[i]->w_name);
+		free(p->p_workers[i]);
+	}
+	rbt_del(&pool_tree, &p->p_rbn);
+	pthread_mutex_unlock(&worker_lock);
+	free(p->p_name);
+	free(p);
+	errno = err;
+	return NULL;
+ enomem:
+	free(p);
+	errno = ENOMEM;
+	return NULL;
+}
+
+ev_pool_t ev_pool_get(const char *name)
+{
+	ev_pool_t p = NULL;
+	struct rbn *rbn;
+
+	pthread_mutex_lock(&worker_lock);
+	rbn = rbt_find(&pool_tree, name);
+	if (rbn) {
+		p = container_of(rbn, struct ev_pool_s, p_rbn);
+	} else {
+		errno = ENOENT;
+	}
+	pthread_mutex_unlock(&worker_lock);
+	return p;
+}
+
+int ev_pool_size(ev_pool_t p)
+{
+	return p->p_count;
+}
+
+ev_worker_t ev_pool_worker(ev_pool_t p, int idx)
+{
+	if (idx < 0 || idx >= p->p_count)
+		return NULL;
+	return p->p_workers[idx];
+}
+
+int ev_pool_dispatch(ev_pool_t p, ev_type_t t, ev_actor_t fn)
+{
+	int i, rc;
+
+	for (i = 0; i < p->p_count; i++) {
+		rc = ev_dispatch(p->p_workers[i], t, fn);
+		if (rc)
+			return rc;
+	}
+	return 0;
+}
+
+static __thread unsigned int pool_rr;
+
+int ev_pool_post(ev_worker_t src, ev_pool_t dst, ev_t ev, uint64_t key,
+		 struct timespec *to)
+{
+	ev__t e = EV(ev);
+	unsigned int idx;
+
+	if (e->e_type->t_affinity == EV_AFFINITY_ORDERED)
+		idx = ((key * 0x9e3779b97f4a7c15ULL) >> 32) % dst->p_count;
+	else
+		idx = pool_rr++ % dst->p_count;
+	return ev_post(src, dst->p_workers[idx], ev, to);
+}
+
+void ev_pool_flush(ev_pool_t p)
+{
+	int i;
+
+	for (i = 0; i < p->p_count; i++)
+		ev_flush(p->p_workers[i]);
+}
@@ -1,6 +1,8 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <getopt.h>
 #include <time.h>
 #include <pthread.h>
 #include "ev.h"
@@ -38,12 +40,177 @@ static int timer_actor(ev_worker_t src, ev_worker_t dst, ev_status_t status, ev_
 	return 0;
 }
 
+/*
+ * Benchmark: 1 to max_producers threads post events as fast as they can
+ * to a single worker, to a pool (stealable events) and to a pool with
+ * ordered events keyed by producer. Reports delivered events per second.
+ */
+struct bench_s {
+	int producer;
+	uint64_t seq;
+};
+
+static uint64_t bench_delivered;
+static uint64_t bench_out_of_order;
+static uint64_t *bench_last_seq;
+static int bench_events = 1000000;
+static int bench_threads = 4;
+static int bench_max_producers = 32;
+
+struct producer_s {
+	pthread_t thread;
+	int id;
+	int count;
+	ev_type_t type;
+	ev_worker_t worker;
+	ev_pool_t pool;
+};
+
+static int bench_actor(ev_worker_t src, ev_worker_t dst, ev_status_t status, ev_t e)
+{
+	struct bench_s *b = EV_DATA(e, struct bench_s);
+
+	if (ev_type_affinity(ev_type(e)) == EV_AFFINITY_ORDERED) {
+		if (b->seq != bench_last_seq[b->producer] + 1)
+			__atomic_add_fetch(&bench_out_of_order, 1, __ATOMIC_RELAXED);
+		bench_last_seq[b->producer] = b->seq;
+	}
+	__atomic_add_fetch(&bench_delivered, 1, __ATOMIC_RELAXED);
+	return 0;
+}
+
+static void *producer_proc(void *arg)
+{
+	struct producer_s *p = arg;
+	struct bench_s *b;
+	ev_t e;
+	int i;
+
+	for (i = 0; i < p->count; i++) {
+		e = ev_new(p->type);
+		if (!e) {
+			perror("ev_new");
+			exit(1);
+		}
+		b = EV_DATA(e, struct bench_s);
+		b->producer = p->id;
+		b->seq = i + 1;
+		if (p->pool)
+			ev_pool_post(NULL, p->pool, e, p->id, NULL);
+		else
+			ev_post(NULL, p->worker, e, NULL);
+		ev_put(e);
+	}
+	return NULL;
+}
+
+static void bench_run(const char *mode, ev_type_t type,
+		      ev_worker_t worker, ev_pool_t pool, int nproducers)
+{
+	struct producer_s *prod;
+	struct timespec start, end;
+	uint64_t total;
+	double secs;
+	int i;
+
+	prod = calloc(nproducers, sizeof(*prod));
+	if (!prod) {
+		perror("calloc");
+		exit(1);
+	}
+	memset(bench_last_seq, 0, bench_max_producers * sizeof(*bench_last_seq));
+	bench_delivered = 0;
+	bench_out_of_order = 0;
+	total = (uint64_t)(bench_events / nproducers) * nproducers;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < nproducers; i++) {
+		prod[i].id = i;
+		prod[i].count = bench_events / nproducers;
+		prod[i].type = type;
+		prod[i].worker = worker;
+		prod[i].pool = pool;
+		pthread_create(&prod[i].thread, NULL, producer_proc, &prod[i]);
+	}
+	for (i = 0; i < nproducers; i++)
+		pthread_join(prod[i].thread, NULL);
+	while (__atomic_load_n(&bench_delivered, __ATOMIC_RELAXED) < total)
+		usleep(100);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+	printf("%-8s %9d %14.0f %12" PRIu64 "\n", mode, nproducers,
+	       total / secs, bench_out_of_order);
+	free(prod);
+}
+
+static int bench(void)
+{
+	ev_type_t any_t, ordered_t;
+	ev_worker_t w;
+	ev_pool_t p;
+	int n;
+
+	bench_last_seq = calloc(bench_max_producers, sizeof(*bench_last_seq));
+	any_t = ev_type_new("bench_any", sizeof(struct bench_s));
+	ordered_t = ev_type_new("bench_ordered", sizeof(struct bench_s));
+	w = ev_worker_new("bench_worker", bench_actor);
+	p = ev_pool_new("bench_pool", bench_threads, bench_actor);
+	if (!bench_last_seq || !any_t || !ordered_t || !w || !p) {
+		perror("bench setup");
+		return 1;
+	}
+	ev_type_affinity_set(ordered_t, EV_AFFINITY_ORDERED);
+
+	printf("%d events per run, %d pool threads\n", bench_events, bench_threads);
+	printf("%-8s %9s %14s %12s\n", "mode", "producers", "events/s", "out-of-order");
+	for (n = 1; n <= bench_max_producers; n <<= 1)
+		bench_run("worker", any_t, w, NULL, n);
+	for (n = 1; n <= bench_max_producers; n <<= 1)
+		bench_run("pool", any_t, NULL, p, n);
+	for (n = 1; n <= bench_max_producers; n <<= 1)
+		bench_run("ordered", ordered_t, NULL, p, n);
+	return bench_out_of_order ? 1 : 0;
+}
+
+static void usage(char *argv[])
+{
+	printf("usage: %s [-b [-n events] [-t pool_threads] [-p max_producers]]\n"
+	       "    Without -b, run the timer demonstration.\n", argv[0]);
+}
+
 int main(int argc, char *argv[])
 {
 	struct timespec to;
 	ev_worker_t timer, a, b;
 	ev_type_t timeout, request, response;
 	ev_t to_ev, req_ev, resp_ev;
+	int op, do_bench = 0;
+
+	while ((op = getopt(argc, argv, "bn:t:p:")) != -1) {
+		switch (op) {
+		case 'b':
+			do_bench = 1;
+			break;
+		case 'n':
+			bench_events = atoi(optarg);
+			break;
+		case 't':
+			bench_threads = atoi(optarg);
+			break;
+		case 'p':
+			bench_max_producers = atoi(optarg);
+			break;
+		default:
+			usage(argv);
+			return 1;
+		}
+	}
+	if (do_bench) {
+		if (bench_events <= 0 || bench_threads <= 0 || bench_max_producers <= 0) {
+			usage(argv);
+			return 1;
+		}
+		return bench();
+	}
 
 	timer = ev_worker_new("TIMER", timer_actor);
 	a = ev_worker_new("A", timer_actor);
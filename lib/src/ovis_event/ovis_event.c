@@ -54,6 +54,8 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
+#include <limits.h>
 #include <assert.h>
 #include <sys/syscall.h>
 
@@ -65,6 +67,7 @@
 #define USEC 1000000
 
 #define OVIS_EVENT_HEAP_SIZE_DEFAULT 16384
+#define OVIS_EVENT_WHEEL_TICK_US_DEFAULT 1000
 
 static
 void ovis_scheduler_destroy(ovis_scheduler_t m);
@@ -216,6 +219,243 @@ ovis_event_t ovis_event_heap_top(struct ovis_event_heap *h)
 	return NULL;
 }
 
+static inline
+uint64_t __tv_us(const struct timeval *tv)
+{
+	return (uint64_t)tv->tv_sec * USEC + tv->tv_usec;
+}
+
+static inline
+struct ovis_event_wheel *ovis_event_wheel_create(uint64_t tick_us)
+{
+	struct timeval tv;
+	struct ovis_event_wheel *w = calloc(1, sizeof(*w));
+	if (!w)
+		return w;
+	gettimeofday(&tv, NULL);
+	w->tick_us = tick_us;
+	w->cur = __tv_us(&tv) / tick_us;
+	w->wake = UINT64_MAX;
+	w->batch_tail = &w->batch;
+	return w;
+}
+
+static inline
+void ovis_event_wheel_free(struct ovis_event_wheel *w)
+{
+	free(w);
+}
+
+static inline
+void __wheel_link(struct ovis_event_wheel *w, int idx, ovis_event_t ev)
+{
+	ovis_event_t *head = &w->slot[idx];
+	ev->priv.wnext = *head;
+	if (*head)
+		(*head)->priv.wprev = &ev->priv.wnext;
+	*head = ev;
+	ev->priv.wprev = head;
+	ev->priv.idx = idx;
+	w->bmap[idx >> OVIS_WHEEL_BITS] |= 1ULL << (idx & OVIS_WHEEL_MASK);
+}
+
+/* Put \c ev into the slot of its expiration tick \c tick. */
+static inline
+void __wheel_add(struct ovis_event_wheel *w, ovis_event_t ev, uint64_t tick)
+{
+	uint64_t delta;
+	int lvl;
+
+	if (tick < w->cur)
+		tick = w->cur;
+	ev->priv.wtick = tick;
+	delta = tick - w->cur;
+	for (lvl = 0; lvl < OVIS_WHEEL_LEVELS - 1; lvl++) {
+		if (delta < (1ULL << ((lvl + 1) * OVIS_WHEEL_BITS)))
+			break;
+	}
+	if (delta >= (1ULL << (OVIS_WHEEL_LEVELS * OVIS_WHEEL_BITS))) {
+		/* beyond the wheel span; park it in the farthest slot, it will
+		 * be cascaded again until it is in range */
+		tick = w->cur + (1ULL << (OVIS_WHEEL_LEVELS * OVIS_WHEEL_BITS)) - 1;
+	}
+	__wheel_link(w, lvl * OVIS_WHEEL_SLOTS +
+			((tick >> (lvl * OVIS_WHEEL_BITS)) & OVIS_WHEEL_MASK), ev);
+	w->count++;
+}
+
+static inline
+void ovis_event_wheel_insert(struct ovis_event_wheel *w, ovis_event_t ev)
+{
+	/* round up so that the event never fires before ev->priv.tv */
+	__wheel_add(w, ev, (__tv_us(&ev->priv.tv) + w->tick_us - 1) / w->tick_us);
+}
+
+static inline
+void ovis_event_wheel_remove(struct ovis_event_wheel *w, ovis_event_t ev)
+{
+	int idx = ev->priv.idx;
+	if (idx < 0)
+		return;
+	*ev->priv.wprev = ev->priv.wnext;
+	if (ev->priv.wnext)
+		ev->priv.wnext->priv.wprev = ev->priv.wprev;
+	if (idx == OVIS_WHEEL_BATCH_IDX) {
+		if (w->batch_tail == &ev->priv.wnext)
+			w->batch_tail = ev->priv.wprev;
+	} else {
+		w->count--;
+		if (!w->slot[idx])
+			w->bmap[idx >> OVIS_WHEEL_BITS] &=
+					~(1ULL << (idx & OVIS_WHEEL_MASK));
+	}
+	ev->priv.wnext = NULL;
+	ev->priv.wprev = NULL;
+	ev->priv.idx = -1;
+}
+
+static inline
+void ovis_event_wheel_update(struct ovis_event_wheel *w, ovis_event_t ev)
+{
+	ovis_event_wheel_remove(w, ev);
+	ovis_event_wheel_insert(w, ev);
+}
+
+/* Detach the events in the slot \c idx and return them as a list. */
+static inline
+ovis_event_t __wheel_slot_take(struct ovis_event_wheel *w, int idx)
+{
+	ovis_event_t ev = w->slot[idx];
+	w->slot[idx] = NULL;
+	w->bmap[idx >> OVIS_WHEEL_BITS] &= ~(1ULL << (idx & OVIS_WHEEL_MASK));
+	return ev;
+}
+
+/* Redistribute the events of an upper level slot to the lower levels. */
+static
+void ovis_event_wheel_cascade(struct ovis_event_wheel *w, int lvl, int s)
+{
+	ovis_event_t ev, next;
+	ev = __wheel_slot_take(w, lvl * OVIS_WHEEL_SLOTS + s);
+	while (ev) {
+		next = ev->priv.wnext;
+		w->count--;
+		__wheel_add(w, ev, ev->priv.wtick);
+		ev = next;
+	}
+}
+
+/* Move the events of level-0 slot \c s to the tail of the batch. */
+static
+void ovis_event_wheel_harvest(struct ovis_event_wheel *w, int s)
+{
+	ovis_event_t ev, last = NULL;
+	ev = __wheel_slot_take(w, s);
+	if (!ev)
+		return;
+	ev->priv.wprev = w->batch_tail;
+	*w->batch_tail = ev;
+	for (; ev; ev = ev->priv.wnext) {
+		ev->priv.idx = OVIS_WHEEL_BATCH_IDX;
+		w->count--;
+		last = ev;
+	}
+	w->batch_tail = &last->priv.wnext;
+}
+
+/*
+ * The next tick at which an event expires or an upper level slot has to be
+ * cascaded, UINT64_MAX if the wheel is empty.
+ */
+static
+uint64_t ovis_event_wheel_next(struct ovis_event_wheel *w)
+{
+	uint64_t next = UINT64_MAX;
+	uint64_t base, bits, t;
+	int lvl, shift, c;
+
+	for (lvl = 0; lvl < OVIS_WHEEL_LEVELS; lvl++) {
+		if (!w->bmap[lvl])
+			continue;
+		shift = lvl * OVIS_WHEEL_BITS;
+		base = w->cur >> shift;
+		c = base & OVIS_WHEEL_MASK;
+		/* Level-0 slot c is due now, and so is slot c of an upper level
+		 * if the wheel is at its boundary. Otherwise slot c has been
+		 * cascaded already; its events are a full rotation away. */
+		if (lvl == 0 || !(w->cur & ((1ULL << shift) - 1)))
+			bits = w->bmap[lvl] & (~0ULL << c);
+		else if (c < OVIS_WHEEL_MASK)
+			bits = w->bmap[lvl] & (~0ULL << (c + 1));
+		else
+			bits = 0;
+		if (bits)
+			t = (base - c + __builtin_ctzll(bits)) << shift;
+		else
+			t = (base - c + OVIS_WHEEL_SLOTS +
+				__builtin_ctzll(w->bmap[lvl])) << shift;
+		if (t < next)
+			next = t;
+	}
+	return next;
+}
+
+/* Process the ticks up to \c now, collecting the expired events. */
+static
+void ovis_event_wheel_advance(struct ovis_event_wheel *w, uint64_t now)
+{
+	uint64_t next;
+	int lvl, shift;
+
+	while (w->cur <= now) {
+		if (!w->count) {
+			w->cur = now + 1;
+			break;
+		}
+		for (lvl = 1; lvl < OVIS_WHEEL_LEVELS; lvl++) {
+			shift = lvl * OVIS_WHEEL_BITS;
+			if (w->cur & ((1ULL << shift) - 1))
+				break;
+			ovis_event_wheel_cascade(w, lvl,
+					(w->cur >> shift) & OVIS_WHEEL_MASK);
+		}
+		ovis_event_wheel_harvest(w, w->cur & OVIS_WHEEL_MASK);
+		w->cur++;
+		/* skip the ticks with nothing to do */
+		next = ovis_event_wheel_next(w);
+		if (next > w->cur)
+			w->cur = (next <= now)?(next):(now + 1);
+	}
+}
+
+/*
+ * The wall clock went backward; re-insert the events relative to \c now so
+ * that new events do not wait for the wheel to catch up.
+ */
+static
+void ovis_event_wheel_rebase(struct ovis_event_wheel *w, uint64_t now)
+{
+	ovis_event_t list = NULL, ev, next;
+	int idx;
+
+	for (idx = 0; idx < OVIS_WHEEL_LEVELS * OVIS_WHEEL_SLOTS; idx++) {
+		ev = __wheel_slot_take(w, idx);
+		while (ev) {
+			next = ev->priv.wnext;
+			ev->priv.wnext = list;
+			list = ev;
+			ev = next;
+		}
+	}
+	w->count = 0;
+	w->cur = now;
+	while (list) {
+		next = list->priv.wnext;
+		__wheel_add(w, list, list->priv.wtick);
+		list = next;
+	}
+}
+
 static
 void __ovis_event_pipe_cb(ovis_event_t ev)
 {
@@ -241,11 +481,43 @@ static inline int __ovis_event_get_heap_size()
 	return strtoul(sz_str, NULL, 0);
 }
 
+static inline ovis_scheduler_timer_t __ovis_event_get_timer()
+{
+	char *str = getenv("OVIS_EVENT_TIMER");
+	if (str && 0 == strcasecmp(str, "wheel"))
+		return OVIS_SCHEDULER_TIMER_WHEEL;
+	return OVIS_SCHEDULER_TIMER_HEAP;
+}
+
+static inline uint64_t __ovis_event_get_wheel_tick()
+{
+	uint64_t tick_us;
+	char *str = getenv("OVIS_EVENT_WHEEL_TICK_US");
+	if (!str)
+		return OVIS_EVENT_WHEEL_TICK_US_DEFAULT;
+	tick_us = strtoul(str, NULL, 0);
+	if (!tick_us)
+		return OVIS_EVENT_WHEEL_TICK_US_DEFAULT;
+	return tick_us;
+}
+
 ovis_scheduler_t ovis_scheduler_new()
+{
+	return ovis_scheduler_new_timer(__ovis_event_get_timer());
+}
+
+ovis_scheduler_t ovis_scheduler_new_timer(ovis_scheduler_timer_t timer)
 {
 	int rc;
 	uint32_t heap_sz;
-	ovis_scheduler_t m = calloc(1,sizeof(*m));
+	ovis_scheduler_t m;
+
+	if (timer != OVIS_SCHEDULER_TIMER_HEAP &&
+			timer != OVIS_SCHEDULER_TIMER_WHEEL) {
+		errno = EINVAL;
+		return NULL;
+	}
+	m = calloc(1,sizeof(*m));
 	if (!m)
 		goto out;
 
@@ -258,14 +530,25 @@ ovis_scheduler_t ovis_scheduler_new()
 	m->pfd[0] = -1;
 	m->pfd[1] = -1;
 	m->heap = NULL;
+	m->wheel = NULL;
 	m->evcount = 0;
 	m->refcount = 1;
 	m->state = OVIS_EVENT_MANAGER_INIT;
-
-	heap_sz = __ovis_event_get_heap_size();
-	m->heap = ovis_event_heap_create(heap_sz);
-	if (!m->heap)
-		goto err;
+	m->timer = timer;
+
+	switch (timer) {
+	case OVIS_SCHEDULER_TIMER_HEAP:
+		heap_sz = __ovis_event_get_heap_size();
+		m->heap = ovis_event_heap_create(heap_sz);
+		if (!m->heap)
+			goto err;
+		break;
+	case OVIS_SCHEDULER_TIMER_WHEEL:
+		m->wheel = ovis_event_wheel_create(__ovis_event_get_wheel_tick());
+		if (!m->wheel)
+			goto err;
+		break;
+	}
 
 	m->efd = epoll_create(4096); /* size is ignored since Linux 2.6.8 */
 	if (m->efd == -1)
@@ -323,6 +606,9 @@ void ovis_scheduler_destroy(ovis_scheduler_t m)
 	if (m->heap)
 		ovis_event_heap_free(m->heap);
 
+	if (m->wheel)
+		ovis_event_wheel_free(m->wheel);
+
 	pthread_mutex_destroy(&m->mutex);
 	free(m);
 }
@@ -405,6 +691,76 @@ out:
 	return timeout;
 }
 
+/**
+ * Deliver the expired events of the timing wheel and returns
+ * time-to-next-event.
+ *
+ * All events expiring in the ticks up to now are harvested in one pass and
+ * their callbacks are called back to back. Like the heap, each event is
+ * rescheduled before its callback and the callback is called with the
+ * scheduler unlocked, so it may add or delete events (including the other
+ * events of the batch).
+ *
+ * \retval timeout the timeout (milliseconds) to the next event.
+ */
+static
+int ovis_event_wheel_process(ovis_scheduler_t m)
+{
+	struct ovis_event_wheel *w = m->wheel;
+	struct timeval tv;
+	uint64_t now_us, wake_us, now;
+	ovis_event_t ev;
+	int timeout = -1;
+
+	pthread_mutex_lock(&m->mutex);
+loop:
+	gettimeofday(&tv, NULL);
+	now = __tv_us(&tv) / w->tick_us;
+	if (now + 1 < w->cur)
+		ovis_event_wheel_rebase(w, now);
+	ovis_event_wheel_advance(w, now);
+	if (!w->batch)
+		goto out;
+	while ((ev = w->batch)) {
+		ovis_event_wheel_remove(w, ev);
+		gettimeofday(&tv, NULL);
+		__ovis_event_next_wakeup(&tv, ev);
+		ovis_event_wheel_insert(w, ev);
+		if (ev->param.type == OVIS_EVENT_PERIODIC)
+			ev->cb.type = OVIS_EVENT_PERIODIC;
+		else
+			ev->cb.type = OVIS_EVENT_TIMEOUT;
+		pthread_mutex_unlock(&m->mutex);
+		ev->param.cb_fn(ev);
+		pthread_mutex_lock(&m->mutex);
+	}
+	goto loop;
+out:
+	w->wake = ovis_event_wheel_next(w);
+	if (w->wake != UINT64_MAX) {
+		wake_us = w->wake * w->tick_us;
+		now_us = __tv_us(&tv);
+		if (wake_us <= now_us)
+			timeout = 0;
+		else if ((wake_us - now_us + 999)/1000 > INT_MAX)
+			timeout = INT_MAX;
+		else
+			timeout = (wake_us - now_us + 999)/1000;
+	}
+	if (m->state == OVIS_EVENT_MANAGER_RUNNING)
+		m->state = OVIS_EVENT_MANAGER_WAITING;
+	pthread_mutex_unlock(&m->mutex);
+	return timeout;
+}
+
+static
+int ovis_event_timer_process(ovis_scheduler_t m)
+{
+	if (m->timer == OVIS_SCHEDULER_TIMER_WHEEL)
+		return ovis_event_wheel_process(m);
+	return ovis_event_heap_process(m);
+}
+
 static
 int __ovis_event_timer_update(ovis_scheduler_t m, ovis_event_t ev)
 {
@@ -412,7 +768,10 @@ int __ovis_event_timer_update(ovis_scheduler_t m, ovis_event_t ev)
 	pthread_mutex_lock(&m->mutex);
 	gettimeofday(&tv, NULL);
 	timeradd(&tv, &ev->param.timeout, &ev->priv.tv);
-	ovis_event_heap_update(m->heap, ev->priv.idx);
+	if (m->timer == OVIS_SCHEDULER_TIMER_WHEEL)
+		ovis_event_wheel_update(m->wheel, ev);
+	else
+		ovis_event_heap_update(m->heap, ev->priv.idx);
 	pthread_mutex_unlock(&m->mutex);
 	return 0;
 }
@@ -515,6 +874,7 @@ static void __ovis_event_next_wakeup(const struct timeval *now, ovis_event_t ev)
 int ovis_scheduler_event_add(ovis_scheduler_t m, ovis_event_t ev)
 {
 	int rc = 0;
+	int notify = 0;
 	ssize_t wb;
 
 	if (ev->param.type & OVIS_EVENT_EPOLL) {
@@ -541,15 +901,25 @@ int ovis_scheduler_event_add(ovis_scheduler_t m, ovis_event_t ev)
 		/* calculate wake up time */
 		gettimeofday(&tv, NULL);
 		__ovis_event_next_wakeup(&tv, ev);
-		rc = ovis_event_heap_insert(m->heap, ev);
-		if (rc) {
-			pthread_mutex_unlock(&m->mutex);
-			goto out;
+		if (m->timer == OVIS_SCHEDULER_TIMER_WHEEL) {
+			ovis_event_wheel_insert(m->wheel, ev);
+			/* notify only if the new event is due before the
+			 * scheduler wakes up */
+			if (ev->priv.wtick < m->wheel->wake) {
+				m->wheel->wake = ev->priv.wtick;
+				notify = 1;
+			}
+		} else {
+			rc = ovis_event_heap_insert(m->heap, ev);
+			if (rc) {
+				pthread_mutex_unlock(&m->mutex);
+				goto out;
+			}
+			/* notify only if the new event affect the next timeout */
+			notify = (ev->priv.idx == 0);
 		}
 		m->evcount++;
-		/* notify only if the new event affect the next timeout */
-		if (m->state == OVIS_EVENT_MANAGER_WAITING
-				&& ev->priv.idx == 0) {
+		if (m->state == OVIS_EVENT_MANAGER_WAITING && notify) {
 			wb = write(m->pfd[1], &ev, sizeof(ev));
 			if (wb == -1) {
 				rc = errno;
@@ -589,7 +959,10 @@ int ovis_scheduler_event_del(ovis_scheduler_t m, ovis_event_t ev)
 
 	pthread_mutex_lock(&m->mutex);
 	if (ev->priv.idx >= 0) {
-		ovis_event_heap_remove(m->heap, ev);
+		if (m->timer == OVIS_SCHEDULER_TIMER_WHEEL)
+			ovis_event_wheel_remove(m->wheel, ev);
+		else
+			ovis_event_heap_remove(m->heap, ev);
 		m->evcount--;
 		/* notify only last delete event */
 		if (m->state == OVIS_EVENT_MANAGER_WAITING && m->evcount == 0) {
@@ -663,7 +1036,7 @@ int ovis_scheduler_loop(ovis_scheduler_t m, int return_on_empty)
 		goto out;
 
 loop:
-	timeout = ovis_event_heap_process(m);
+	timeout = ovis_event_timer_process(m);
 	pthread_mutex_lock(&m->mutex);
 	if (!m->evcount && return_on_empty) {
 		pthread_mutex_unlock(&m->mutex);
@@ -65,6 +65,7 @@
  * typedef void (*ovis_event_cb)(ovis_event_t ev);
  *
  * ovis_scheduler_t ovis_scheduler_new();
+ * ovis_scheduler_t ovis_scheduler_new_timer(ovis_scheduler_timer_t timer);
  * ovis_event_t ovis_event_epoll_new(ovis_event_cb_fn cb, void *ctxt,
  *                                   int fd, uint32_t epoll_events);
  * ovis_event_t ovis_event_timeout_new(ovis_event_cb_fn cb, void *ctxt,
@@ -252,6 +253,10 @@ struct ovis_event_s {
 	struct {
 		struct timeval tv;
 		int idx;
+		/* timing wheel slot linkage and expiration tick */
+		struct ovis_event_s *wnext;
+		struct ovis_event_s **wprev;
+		uint64_t wtick;
 	} priv; /* private data for ovis_scheduler */
 };
 
@@ -277,6 +282,17 @@ struct ovis_scheduler_thrstats {
 	uint64_t ev_cnt;
 };
 
+/**
+ * Timer backends of the ovis scheduler.
+ * The scheduler keeps timeout and periodic events either in a binary heap
+ * (O(log n) add/delete/reschedule) or in a hierarchical timing wheel (O(1)
+ * add/delete/reschedule with a resolution of one wheel tick).
+ */
+typedef enum ovis_scheduler_timer_e {
+	OVIS_SCHEDULER_TIMER_HEAP = 0,
+	OVIS_SCHEDULER_TIMER_WHEEL,
+} ovis_scheduler_timer_t;
+
 /**
  * Create an OVIS event scheduler.
  *
@@ -292,6 +308,20 @@ struct ovis_scheduler_thrstats {
  */
 ovis_scheduler_t ovis_scheduler_new();
 
+/**
+ * Create an OVIS event scheduler with the given timer backend.
+ * ::ovis_scheduler_new() uses the backend named by the \c OVIS_EVENT_TIMER
+ * environment variable ("heap" or "wheel", the default is "heap"). The wheel
+ * tick is \c OVIS_EVENT_WHEEL_TICK_US microseconds (default 1000). Events
+ * of the wheel never fire early; they fire within one tick after their
+ * wake up time, and events expiring in the same tick are delivered together.
+ * \param timer the timer backend.
+ * \retval m a handle to \c ovis_scheduler.
+ * \retval NULL on failure. In this case, \c errno is also set to describe the
+ *              error.
+ */
+ovis_scheduler_t ovis_scheduler_new_timer(ovis_scheduler_timer_t timer);
+
 /**
  * Destroy the unused event manager.
  *
@@ -64,6 +64,32 @@ struct ovis_event_heap {
 	ovis_event_t ev[OVIS_FLEX];
 };
 
+/*
+ * Hierarchical timing wheel: OVIS_WHEEL_LEVELS levels of OVIS_WHEEL_SLOTS
+ * slots. Level L slot S holds the events expiring within
+ * OVIS_WHEEL_SLOTS^(L+1) ticks whose tick bits [L*BITS, (L+1)*BITS) are S.
+ * The events of a level L > 0 slot cascade down when the wheel reaches the
+ * slot. The bitmap of each level tells the non-empty slots.
+ */
+#define OVIS_WHEEL_BITS 6
+#define OVIS_WHEEL_SLOTS (1 << OVIS_WHEEL_BITS)
+#define OVIS_WHEEL_MASK (OVIS_WHEEL_SLOTS - 1)
+#define OVIS_WHEEL_LEVELS 6
+/* priv.idx of the events harvested from the wheel, pending callback */
+#define OVIS_WHEEL_BATCH_IDX (OVIS_WHEEL_LEVELS * OVIS_WHEEL_SLOTS)
+
+struct ovis_event_wheel {
+	uint64_t tick_us; /* wheel resolution */
+	uint64_t cur; /* the next tick to be processed */
+	uint64_t wake; /* the tick the scheduler sleeps until */
+	uint64_t count; /* number of events in the wheel */
+	uint64_t bmap[OVIS_WHEEL_LEVELS];
+	ovis_event_t slot[OVIS_WHEEL_LEVELS * OVIS_WHEEL_SLOTS];
+	/* expired events waiting for their callbacks */
+	ovis_event_t batch;
+	ovis_event_t *batch_tail;
+};
+
 struct ovis_scheduler_s {
 	const char *name;
 	int evcount;
@@ -73,7 +99,9 @@ struct ovis_scheduler_s {
 	struct ovis_event_s ovis_ev;
 	struct epoll_event ev[MAX_EPOLL_EVENTS];
 	pthread_mutex_t mutex;
+	ovis_scheduler_timer_t timer;
 	struct ovis_event_heap *heap;
+	struct ovis_event_wheel *wheel;
 	enum {
 		OVIS_EVENT_MANAGER_INIT,
 		OVIS_EVENT_MANAGER_RUNNING,
@@ -0,0 +1,226 @@
+/* -*- c-basic-offset: 8 -*-
+ * Copyright (c) 2026 National Technology & Engineering Solutions
+ * of Sandia, LLC (NTESS). Under the terms of Contract DE-NA0003525 with
+ * NTESS, the U.S. Government retains certain rights in this software.
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Compare the heap and the timing wheel timer backends of ovis_scheduler.
+ *
+ * For each backend, N periodic events with phases spread evenly over the
+ * period are added to a scheduler, then deleted and added again
+ * (rescheduled), and the per-event cost of each step is reported. Then the
+ * scheduler loop runs for a few seconds and the number of callbacks, their
+ * lateness and the CPU time of the scheduler thread are reported.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/time.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ovis_event.h"
+
+static int n_events = 100000;
+static int duration = 5;
+static uint64_t period_us = 1000000;
+
+static struct {
+	uint64_t count;
+	uint64_t late_sum;
+	uint64_t late_max;
+} cb_stat;
+
+static struct timespec loop_cpu;
+
+static inline uint64_t ts_ns(const struct timespec *ts)
+{
+	return ts->tv_sec * 1000000000ULL + ts->tv_nsec;
+}
+
+static inline uint64_t now_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts_ns(&ts);
+}
+
+void cb(ovis_event_t ev)
+{
+	struct timeval tv;
+	uint64_t us, late;
+	gettimeofday(&tv, NULL);
+	us = tv.tv_sec * 1000000ULL + tv.tv_usec;
+	late = (us - ev->param.periodic.phase_us) % ev->param.periodic.period_us;
+	cb_stat.count++;
+	cb_stat.late_sum += late;
+	if (late > cb_stat.late_max)
+		cb_stat.late_max = late;
+}
+
+void *loop_proc(void *arg)
+{
+	ovis_scheduler_t sch = arg;
+	ovis_scheduler_loop(sch, 0);
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &loop_cpu);
+	return NULL;
+}
+
+static void bench(const char *name, ovis_scheduler_timer_t timer)
+{
+	ovis_scheduler_t sch;
+	ovis_event_t *ev, tmp;
+	struct ovis_periodic_s p;
+	pthread_t thr;
+	uint64_t t0, t1, t2, t3;
+	int i, j, rc;
+
+	sch = ovis_scheduler_new_timer(timer);
+	assert(sch);
+	ev = calloc(n_events, sizeof(*ev));
+	assert(ev);
+	p.period_us = period_us;
+	for (i = 0; i < n_events; i++) {
+		p.phase_us = (uint64_t)i * period_us / n_events;
+		ev[i] = ovis_event_periodic_new(cb, NULL, &p);
+		assert(ev[i]);
+	}
+	/* tasks are not started in the order of their wake up times */
+	srandom(1);
+	for (i = n_events - 1; i > 0; i--) {
+		j = random() % (i + 1);
+		tmp = ev[i];
+		ev[i] = ev[j];
+		ev[j] = tmp;
+	}
+
+	t0 = now_ns();
+	for (i = 0; i < n_events; i++) {
+		rc = ovis_scheduler_event_add(sch, ev[i]);
+		if (rc) {
+			printf("%s: ovis_scheduler_event_add() error: %d\n",
+			       name, rc);
+			exit(1);
+		}
+	}
+	t1 = now_ns();
+	for (i = 0; i < n_events; i++)
+		ovis_scheduler_event_del(sch, ev[i]);
+	t2 = now_ns();
+	for (i = 0; i < n_events; i++) {
+		ovis_scheduler_event_del(sch, ev[i]);
+		ovis_scheduler_event_add(sch, ev[i]);
+	}
+	t3 = now_ns();
+
+	memset(&cb_stat, 0, sizeof(cb_stat));
+	rc = pthread_create(&thr, NULL, loop_proc, sch);
+	assert(rc == 0);
+	sleep(duration);
+	ovis_scheduler_term(sch);
+	pthread_join(thr, NULL);
+
+	printf("%-6s add %7.1f ns/ev, del %7.1f ns/ev, resched %7.1f ns/ev\n",
+	       name, (double)(t1 - t0)/n_events, (double)(t2 - t1)/n_events,
+	       (double)(t3 - t2)/n_events);
+	printf("%-6s %lu callbacks in %d s, lateness avg %lu us max %lu us, "
+	       "loop cpu %.3f s\n", name, cb_stat.count, duration,
+	       cb_stat.count?(cb_stat.late_sum / cb_stat.count):0,
+	       cb_stat.late_max, ts_ns(&loop_cpu) / 1e9);
+
+	for (i = 0; i < n_events; i++) {
+		ovis_scheduler_event_del(sch, ev[i]);
+		ovis_event_free(ev[i]);
+	}
+	free(ev);
+	ovis_scheduler_free(sch);
+}
+
+static void usage(const char *prog)
+{
+	printf("usage: %s [-n events] [-d seconds] [-p period_us]\n", prog);
+	printf("  The heap size (OVIS_EVENT_HEAP_SIZE) is set to the number of\n"
+	       "  events. The wheel tick is OVIS_EVENT_WHEEL_TICK_US.\n");
+}
+
+int main(int argc, char **argv)
+{
+	char buf[32];
+	int c;
+
+	while ((c = getopt(argc, argv, "n:d:p:h")) != -1) {
+		switch (c) {
+		case 'n':
+			n_events = atoi(optarg);
+			break;
+		case 'd':
+			duration = atoi(optarg);
+			break;
+		case 'p':
+			period_us = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+			return c == 'h' ? 0 : EINVAL;
+		}
+	}
+	if (n_events <= 0 || duration <= 0 || !period_us) {
+		usage(argv[0]);
+		return EINVAL;
+	}
+	snprintf(buf, sizeof(buf), "%d", n_events);
+	setenv("OVIS_EVENT_HEAP_SIZE", buf, 1);
+
+	bench("heap", OVIS_SCHEDULER_TIMER_HEAP);
+	bench("wheel", OVIS_SCHEDULER_TIMER_WHEEL);
+	return 0;
+}
@@ -1,6 +1,7 @@
 #! /bin/bash
 tmp=$(mktemp -t $USER.ovis_json_perf_test.XXXXXX)
 $BIN/ovis_json_perf_test 100000 > $tmp
+rc=$?
 #valgrind -v --track-origins=yes $BIN/ovis_json_perf_test 100 > $tmp
 if ! test -f $tmp; then
 	echo "ERROR: no output file $tmp"
@@ -13,3 +14,13 @@ eslowdown=$(echo "scale=2;$je/$st" |bc)
 bslowdown=$(echo "scale=2;$jb/$st" |bc)
 echo elements/sprintf duration ratio is $eslowdown
 echo bulkfmt/sprintf duration ratio is $bslowdown
+for msg in darshan kokkos kokkos-batch; do
+	lex=$(cat $tmp |grep " $msg .*lex parse" |sed -e 's/.* //g')
+	arena=$(cat $tmp |grep " $msg .*arena parse" |sed -e 's/.* //g')
+	echo $msg lex parse MB/s $lex arena parse MB/s $arena
+done
+if test $rc -ne 0; then
+	cat $tmp
+	echo "ERROR: ovis_json_perf_test failed"
+	exit 1
+fi
@@ -6,6 +6,10 @@
 
 #define JSON_BUF_START_LEN 8192
 
+/* Implementation is in ovis_json_arena.c */
+void json_arena_foreign(json_arena_t a);
+void json_arena_entity_free(json_entity_t e);
+
 
 const char *json_type_name(enum json_value_e typ)
 {
@@ -152,14 +156,14 @@ int attr_cmp(const void *a, const void *b, size_t key_len)
 	return strncmp(a, b, key_len);
 }
 
-#define JSON_HTBL_DEPTH	23
-
 static json_entity_t json_dict_new(void)
 {
 	json_dict_t d = malloc(sizeof *d);
 	if (d) {
 		d->base.type = JSON_DICT_VALUE;
+		d->base.flags = 0;
 		d->base.value.dict_ = d;
+		d->arena = NULL;
 		d->attr_table = htbl_alloc(attr_cmp, JSON_HTBL_DEPTH);
 		if (!d->attr_table) {
 			free(d);
@@ -175,6 +179,7 @@ static json_entity_t json_str_new(const char *s)
 	json_str_t str = malloc(sizeof *str);
 	if (str) {
 		str->base.type = JSON_STRING_VALUE;
+		str->base.flags = 0;
 		str->base.value.str_ = str;
 		str->str = strdup(s);
 		if (!str->str) {
@@ -192,8 +197,10 @@ static json_entity_t json_list_new(void)
 	json_list_t a = malloc(sizeof *a);
 	if (a) {
 		a->base.type = JSON_LIST_VALUE;
+		a->base.flags = 0;
 		a->base.value.list_ = a;
 		a->item_count = 0;
+		a->arena = NULL;
 		TAILQ_INIT(&a->item_list);
 		return &a->base;
 	}
@@ -203,6 +210,8 @@ static json_entity_t json_list_new(void)
 void json_item_add(json_entity_t a, json_entity_t e)
 {
 	assert(a->type == JSON_LIST_VALUE);
+	if (a->value.list_->arena && !(e->flags & JSON_ENTITY_F_ARENA))
+		json_arena_foreign(a->value.list_->arena);
 	a->value.list_->item_count++;
 	TAILQ_INSERT_TAIL(&a->value.list_->item_list, e, item_entry);
 }
@@ -261,6 +270,7 @@ static json_entity_t json_attr_new(const char *name, json_entity_t value)
 	json_attr_t a = malloc(sizeof *a);
 	if (a) {
 		a->base.type = JSON_ATTR_VALUE;
+		a->base.flags = 0;
 		a->base.value.attr_ = a;
 		a->name = s;
 		a->value = value;
@@ -285,6 +295,7 @@ json_entity_t json_entity_new(enum json_value_e type, ...)
 		if (!e)
 			goto out;
 		e->type = type;
+		e->flags = 0;
 		i = va_arg(ap, uint64_t);
 		e->value.int_ = i;
 		break;
@@ -293,6 +304,7 @@ json_entity_t json_entity_new(enum json_value_e type, ...)
 		if (!e)
 			goto out;
 		e->type = type;
+		e->flags = 0;
 		i = va_arg(ap, int);
 		e->value.bool_ = i;
 		break;
@@ -301,6 +313,7 @@ json_entity_t json_entity_new(enum json_value_e type, ...)
 		if (!e)
 			goto out;
 		e->type = type;
+		e->flags = 0;
 		d = va_arg(ap, double);
 		e->value.double_ = d;
 		break;
@@ -324,6 +337,7 @@ json_entity_t json_entity_new(enum json_value_e type, ...)
 		if (!e)
 			goto out;
 		e->type = type;
+		e->flags = 0;
 		e->value.int_ = 0;
 		break;
 	default:
@@ -344,7 +358,7 @@ static jbuf_t __list_dump(jbuf_t jb, json_entity_t e)
 	for (i = json_item_first(e); i; i = json_item_next(i)) {
 		if (count)
 			jb = jbuf_append_str(jb, ",");
-		__entity_dump(jb, i);
+		jb = __entity_dump(jb, i);
 		count++;
 	}
 	jb = jbuf_append_str(jb, "]");
@@ -391,10 +405,10 @@ static jbuf_t __entity_dump(jbuf_t jb, json_entity_t e)
 		jb = __entity_dump(jb, e->value.attr_->value);
 		break;
 	case JSON_LIST_VALUE:
-		__list_dump(jb, e);
+		jb = __list_dump(jb, e);
 		break;
 	case JSON_DICT_VALUE:
-		__dict_dump(jb, e);
+		jb = __dict_dump(jb, e);
 		break;
 	case JSON_NULL_VALUE:
 		jb = jbuf_append_str(jb, "null");
@@ -519,6 +533,8 @@ void __attr_add(json_entity_t d, json_entity_t a)
 	}
 	hent_init(&a->value.attr_->attr_ent, name->str, name->str_len);
 	htbl_ins(d->value.dict_->attr_table, &a->value.attr_->attr_ent);
+	if (d->value.dict_->arena && !(a->flags & JSON_ENTITY_F_ARENA))
+		json_arena_foreign(d->value.dict_->arena);
 }
 
 int json_attr_add(json_entity_t d, const char *name, json_entity_t v)
@@ -586,6 +602,10 @@ static void json_attr_free(json_attr_t a)
 	if (!a)
 		return;
 	assert(a->base.type == JSON_ATTR_VALUE);
+	if (a->base.flags & JSON_ENTITY_F_ARENA) {
+		json_arena_entity_free(&a->base);
+		return;
+	}
 	json_entity_free(a->name);
 	json_entity_free(a->value);
 	free(a);
@@ -614,6 +634,10 @@ void json_entity_free(json_entity_t e)
 {
 	if (!e)
 		return;
+	if (e->flags & JSON_ENTITY_F_ARENA) {
+		json_arena_entity_free(e);
+		return;
+	}
 	switch (e->type) {
 	case JSON_INT_VALUE:
 		free(e);
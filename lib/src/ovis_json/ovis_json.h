@@ -59,6 +59,7 @@ typedef struct json_attr_s *json_attr_t;
 typedef struct json_list_s *json_list_t;
 typedef struct json_dict_s *json_dict_t;
 typedef struct json_entity_s *json_entity_t;
+typedef struct json_arena_s *json_arena_t;
 
 enum json_value_e {
 	JSON_INT_VALUE,
@@ -71,8 +72,13 @@ enum json_value_e {
 	JSON_NULL_VALUE
 };
 
+/* json_entity_s flags */
+#define JSON_ENTITY_F_ARENA	0x1	/* allocated in a json_arena_t */
+#define JSON_ENTITY_F_ARENA_ROOT 0x2	/* frees the arena */
+
 struct json_entity_s {
 	enum json_value_e type;
+	int flags;
 	union {
 		int bool_;
 		int64_t int_;
@@ -95,6 +101,7 @@ struct json_list_s {
 	struct json_entity_s base;
 	int item_count;
 	TAILQ_HEAD(json_item_list, json_entity_s) item_list;
+	json_arena_t arena;
 };
 
 struct json_attr_s {
@@ -104,9 +111,11 @@ struct json_attr_s {
 	struct hent attr_ent;
 };
 
+#define JSON_HTBL_DEPTH	23
 struct json_dict_s {
 	struct json_entity_s base;
 	htbl_t attr_table;
+	json_arena_t arena;
 };
 
 struct json_loc_s {
@@ -117,10 +126,37 @@ struct json_loc_s {
 	char *filename;
 };
 
+/*
+ * JSON_PARSER_LEX is the flex/bison parser; every entity is allocated with
+ * malloc() and freed one by one.
+ *
+ * JSON_PARSER_ARENA first builds an index of the structural characters of
+ * the buffer (64 bytes at a time with SIMD when available) and then builds
+ * the entities from the index into an arena, in one pass. The entities are
+ * the same as the lexer's, but json_entity_free() of the root frees the
+ * whole document at once. An entity of the document must not be used after
+ * the root is freed, even if it was removed from its list or dictionary.
+ * Documents outside the JSON subset the arena parser handles (e.g. single
+ * quoted strings) are given to the lexer, so both backends produce the same
+ * entities, or the same error, for any buffer.
+ *
+ * json_parser_new() uses JSON_PARSER_ARENA if the OVIS_JSON_PARSER
+ * environment variable is "arena", and JSON_PARSER_LEX otherwise.
+ */
+enum json_parser_backend_e {
+	JSON_PARSER_LEX,
+	JSON_PARSER_ARENA,
+};
+
 typedef void *yyscan_t;
 typedef struct json_parser_s {
 	yyscan_t scanner;
 	struct yy_buffer_state *buffer_state;
+	enum json_parser_backend_e backend;
+	uint32_t *idx;		/* structural index, arena backend */
+	size_t idx_len;
+	json_entity_t *stack;	/* open containers, arena backend */
+	size_t stack_len;
 } *json_parser_t;
 
 typedef struct jbuf_s {
@@ -130,6 +166,8 @@ typedef struct jbuf_s {
 } *jbuf_t;
 
 extern json_parser_t json_parser_new(size_t user_data);
+extern json_parser_t json_parser_new_backend(size_t user_data,
+					     enum json_parser_backend_e backend);
 extern void json_parser_free(json_parser_t p);
 extern int json_verify_string(char *s);
 extern void json_entity_free(json_entity_t e);
@@ -0,0 +1,856 @@
+/* -*- c-basic-offset: 8 -*-
+ * Copyright (c) 2026 National Technology & Engineering Solutions
+ * of Sandia, LLC (NTESS). Under the terms of Contract DE-NA0003525 with
+ * NTESS, the U.S. Government retains certain rights in this software.
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * The JSON_PARSER_ARENA backend.
+ *
+ * Stage 1 classifies the buffer 64 bytes at a time into bit masks of the
+ * double quotes, the backslashes and the structural characters ({}[]:,),
+ * drops the escaped quotes, computes the mask of the bytes inside strings
+ * with a prefix XOR of the quotes and records the offsets of the quotes and
+ * of the structural characters outside strings in parser->idx.
+ *
+ * Stage 2 walks the index with a stack of the open containers. A string
+ * lies between two consecutive quotes of the index, and a number, true,
+ * false or null lies between a structural character and the next one, so
+ * the bytes of the buffer are looked at once more only to copy the strings
+ * and to convert the scalars.
+ *
+ * The entities are allocated from an arena whose header is right before
+ * the root entity, so json_entity_free() of the root frees the document by
+ * freeing the arena chunks. The heap entities that the application adds to
+ * the lists and dictionaries of the document are counted, and the document
+ * is walked to free them only if there are any.
+ *
+ * EINVAL means that the buffer is not in the subset of JSON this parser
+ * handles, and json_parse_buffer() gives the buffer to the lexer.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <float.h>
+#include <assert.h>
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
+#include "ovis_json.h"
+
+/* Implementation is in ovis_json.c */
+int attr_cmp(const void *a, const void *b, size_t key_len);
+
+/* The first chunk is this many times the length of the buffer */
+#define JSON_ARENA_RATIO	8
+#define JSON_ARENA_MIN		1024
+#define JSON_ARENA_ALIGN(x)	(((x) + 7) & ~(size_t)7)
+
+struct json_arena_chunk_s {
+	struct json_arena_chunk_s *next;
+};
+
+struct json_arena_s {
+	struct json_arena_chunk_s *chunks; /* the chunks after the first */
+	char *cur;
+	char *end;
+	size_t chunk_len;
+	size_t foreign;		/* heap entities added to the document */
+};
+
+/* the root entity is the first allocation of the first chunk */
+#define JSON_ARENA_HDR	JSON_ARENA_ALIGN(sizeof(struct json_arena_s))
+
+static json_arena_t __arena_new(size_t len)
+{
+	json_arena_t a;
+
+	len = JSON_ARENA_HDR + JSON_ARENA_ALIGN(len);
+	a = malloc(len);
+	if (!a)
+		return NULL;
+	a->chunks = NULL;
+	a->cur = (char *)a + JSON_ARENA_HDR;
+	a->end = (char *)a + len;
+	a->chunk_len = len;
+	a->foreign = 0;
+	return a;
+}
+
+static void *__arena_grow(json_arena_t a, size_t sz)
+{
+	struct json_arena_chunk_s *c;
+	size_t len = a->chunk_len * 2;
+
+	if (len < sz + sizeof(*c))
+		len = sz + sizeof(*c);
+	c = malloc(len);
+	if (!c)
+		return NULL;
+	c->next = a->chunks;
+	a->chunks = c;
+	a->chunk_len = len;
+	a->cur = (char *)(c + 1) + sz;
+	a->end = (char *)c + len;
+	return c + 1;
+}
+
+static inline void *__arena_alloc(json_arena_t a, size_t sz)
+{
+	char *p = a->cur;
+
+	sz = JSON_ARENA_ALIGN(sz);
+	if (sz > (size_t)(a->end - p))
+		return __arena_grow(a, sz);
+	a->cur = p + sz;
+	return p;
+}
+
+static void __arena_free(json_arena_t a)
+{
+	struct json_arena_chunk_s *c;
+
+	while ((c = a->chunks)) {
+		a->chunks = c->next;
+		free(c);
+	}
+	free(a);
+}
+
+void json_arena_foreign(json_arena_t a)
+{
+	a->foreign++;
+}
+
+/* Free the heap entities in the arena entity \c e */
+static void __arena_release(json_entity_t e)
+{
+	json_entity_t i, n;
+	json_attr_t attr;
+	hent_t ent, next;
+
+	switch (e->type) {
+	case JSON_ATTR_VALUE:
+		/* the name is allocated with the attribute */
+		i = e->value.attr_->value;
+		if (!i)
+			break;
+		if (i->flags & JSON_ENTITY_F_ARENA)
+			__arena_release(i);
+		else
+			json_entity_free(i);
+		break;
+	case JSON_LIST_VALUE:
+		if (!e->value.list_->arena->foreign)
+			break;
+		for (i = TAILQ_FIRST(&e->value.list_->item_list); i; i = n) {
+			n = TAILQ_NEXT(i, item_entry);
+			if (i->flags & JSON_ENTITY_F_ARENA)
+				__arena_release(i);
+			else
+				json_entity_free(i);
+		}
+		break;
+	case JSON_DICT_VALUE:
+		if (!e->value.dict_->arena->foreign)
+			break;
+		for (ent = htbl_first(e->value.dict_->attr_table); ent; ent = next) {
+			next = htbl_next(ent);
+			attr = container_of(ent, struct json_attr_s, attr_ent);
+			if (attr->base.flags & JSON_ENTITY_F_ARENA)
+				__arena_release(&attr->base);
+			else
+				json_entity_free(&attr->base);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+void json_arena_entity_free(json_entity_t e)
+{
+	json_arena_t a;
+
+	if (!(e->flags & JSON_ENTITY_F_ARENA_ROOT)) {
+		/* the memory goes with the root */
+		__arena_release(e);
+		return;
+	}
+	a = (json_arena_t)((char *)e - JSON_ARENA_HDR);
+	if (a->foreign)
+		__arena_release(e);
+	__arena_free(a);
+}
+
+static inline json_entity_t __scalar_new(json_arena_t a, enum json_value_e type)
+{
+	json_entity_t e = __arena_alloc(a, sizeof(*e));
+	if (e) {
+		e->type = type;
+		e->flags = JSON_ENTITY_F_ARENA;
+	}
+	return e;
+}
+
+static inline json_entity_t __str_new(json_arena_t a, const char *s, size_t len)
+{
+	json_str_t str = __arena_alloc(a, sizeof(*str) + len + 1);
+	if (!str)
+		return NULL;
+	str->base.type = JSON_STRING_VALUE;
+	str->base.flags = JSON_ENTITY_F_ARENA;
+	str->base.value.str_ = str;
+	str->str = (char *)(str + 1);
+	memcpy(str->str, s, len);
+	str->str[len] = '\0';
+	str->str_len = len;
+	return &str->base;
+}
+
+static inline json_entity_t __list_new(json_arena_t a)
+{
+	json_list_t l = __arena_alloc(a, sizeof(*l));
+	if (!l)
+		return NULL;
+	l->base.type = JSON_LIST_VALUE;
+	l->base.flags = JSON_ENTITY_F_ARENA;
+	l->base.value.list_ = l;
+	l->item_count = 0;
+	TAILQ_INIT(&l->item_list);
+	l->arena = a;
+	return &l->base;
+}
+
+static inline json_entity_t __dict_new(json_arena_t a)
+{
+	json_dict_t d = __arena_alloc(a, sizeof(*d) + htbl_size(JSON_HTBL_DEPTH));
+	if (!d)
+		return NULL;
+	d->base.type = JSON_DICT_VALUE;
+	d->base.flags = JSON_ENTITY_F_ARENA;
+	d->base.value.dict_ = d;
+	d->attr_table = htbl_init(d + 1, attr_cmp, JSON_HTBL_DEPTH);
+	d->arena = a;
+	return &d->base;
+}
+
+/* Add \c e to the container \c c the way json_item_add() and
+ * json_attr_add() do. */
+static inline int __add(json_arena_t a, json_entity_t c, json_entity_t e,
+			const char *key, size_t key_len)
+{
+	json_attr_t attr;
+	json_str_t name;
+	hent_t ent;
+	htbl_t t;
+
+	if (c->type == JSON_LIST_VALUE) {
+		c->value.list_->item_count++;
+		TAILQ_INSERT_TAIL(&c->value.list_->item_list, e, item_entry);
+		return 0;
+	}
+	attr = __arena_alloc(a, sizeof(*attr) + sizeof(*name) + key_len + 1);
+	if (!attr)
+		return ENOMEM;
+	name = (json_str_t)(attr + 1);
+	name->base.type = JSON_STRING_VALUE;
+	name->base.flags = JSON_ENTITY_F_ARENA;
+	name->base.value.str_ = name;
+	name->str = (char *)(name + 1);
+	memcpy(name->str, key, key_len);
+	name->str[key_len] = '\0';
+	name->str_len = key_len;
+	attr->base.type = JSON_ATTR_VALUE;
+	attr->base.flags = JSON_ENTITY_F_ARENA;
+	attr->base.value.attr_ = attr;
+	attr->name = &name->base;
+	attr->value = e;
+
+	t = c->value.dict_->attr_table;
+	ent = htbl_find(t, name->str, key_len);
+	if (ent)
+		htbl_del(t, ent);
+	hent_init(&attr->attr_ent, name->str, key_len);
+	htbl_ins(t, &attr->attr_ent);
+	return 0;
+}
+
+/*
+ * Stage 1
+ */
+struct json_block_s {
+	uint64_t quote;
+	uint64_t bslash;
+	uint64_t squote;
+	uint64_t op;
+};
+
+static inline void __classify(const char *s, struct json_block_s *b)
+{
+#if defined(__AVX2__)
+	const __m256i q = _mm256_set1_epi8('"');
+	const __m256i bs = _mm256_set1_epi8('\\');
+	const __m256i sq = _mm256_set1_epi8('\'');
+	const __m256i lc = _mm256_set1_epi8(0x20);
+	const __m256i lb = _mm256_set1_epi8('{');	/* '[' | 0x20 */
+	const __m256i rb = _mm256_set1_epi8('}');	/* ']' | 0x20 */
+	const __m256i co = _mm256_set1_epi8(':');
+	const __m256i cm = _mm256_set1_epi8(',');
+	__m256i v, l;
+	int k;
+
+	b->quote = b->bslash = b->squote = b->op = 0;
+	for (k = 0; k < 64; k += 32) {
+		v = _mm256_loadu_si256((const __m256i *)(s + k));
+		l = _mm256_or_si256(v, lc);
+		b->quote |= (uint64_t)(uint32_t)_mm256_movemask_epi8(
+				_mm256_cmpeq_epi8(v, q)) << k;
+		b->bslash |= (uint64_t)(uint32_t)_mm256_movemask_epi8(
+				_mm256_cmpeq_epi8(v, bs)) << k;
+		b->squote |= (uint64_t)(uint32_t)_mm256_movemask_epi8(
+				_mm256_cmpeq_epi8(v, sq)) << k;
+		b->op |= (uint64_t)(uint32_t)_mm256_movemask_epi8(
+				_mm256_or_si256(
+				_mm256_or_si256(_mm256_cmpeq_epi8(l, lb),
+						_mm256_cmpeq_epi8(l, rb)),
+				_mm256_or_si256(_mm256_cmpeq_epi8(v, co),
+						_mm256_cmpeq_epi8(v, cm)))) << k;
+	}
+#elif defined(__SSE2__)
+	const __m128i q = _mm_set1_epi8('"');
+	const __m128i bs = _mm_set1_epi8('\\');
+	const __m128i sq = _mm_set1_epi8('\'');
+	const __m128i lc = _mm_set1_epi8(0x20);
+	const __m128i lb = _mm_set1_epi8('{');	/* '[' | 0x20 */
+	const __m128i rb = _mm_set1_epi8('}');	/* ']' | 0x20 */
+	const __m128i co = _mm_set1_epi8(':');
+	const __m128i cm = _mm_set1_epi8(',');
+	__m128i v, l;
+	int k;
+
+	b->quote = b->bslash = b->squote = b->op = 0;
+	for (k = 0; k < 64; k += 16) {
+		v = _mm_loadu_si128((const __m128i *)(s + k));
+		l = _mm_or_si128(v, lc);
+		b->quote |= (uint64_t)_mm_movemask_epi8(
+				_mm_cmpeq_epi8(v, q)) << k;
+		b->bslash |= (uint64_t)_mm_movemask_epi8(
+				_mm_cmpeq_epi8(v, bs)) << k;
+		b->squote |= (uint64_t)_mm_movemask_epi8(
+				_mm_cmpeq_epi8(v, sq)) << k;
+		b->op |= (uint64_t)_mm_movemask_epi8(
+				_mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi8(l, lb),
+					     _mm_cmpeq_epi8(l, rb)),
+				_mm_or_si128(_mm_cmpeq_epi8(v, co),
+					     _mm_cmpeq_epi8(v, cm)))) << k;
+	}
+#else
+	int k;
+
+	b->quote = b->bslash = b->squote = b->op = 0;
+	for (k = 0; k < 64; k++) {
+		switch (s[k]) {
+		case '"':
+			b->quote |= 1ULL << k;
+			break;
+		case '\\':
+			b->bslash |= 1ULL << k;
+			break;
+		case '\'':
+			b->squote |= 1ULL << k;
+			break;
+		case '{': case '}': case '[': case ']': case ':': case ',':
+			b->op |= 1ULL << k;
+			break;
+		}
+	}
+#endif
+}
+
+/* The characters escaped by a backslash. \c carry is set if the block ends
+ * with an unescaped backslash. */
+static inline uint64_t __escaped(uint64_t bslash, uint64_t *carry)
+{
+	uint64_t esc = 0;
+	int k;
+
+	if (*carry) {
+		esc = 1;
+		bslash &= ~1ULL;
+	}
+	*carry = 0;
+	while (bslash) {
+		k = __builtin_ctzll(bslash);
+		if (k == 63) {
+			*carry = 1;
+			break;
+		}
+		esc |= 2ULL << k;
+		/* an escaped backslash escapes nothing */
+		bslash &= ~(3ULL << k);
+	}
+	return esc;
+}
+
+/* bit k of the result is the XOR of bits 0..k of x */
+static inline uint64_t __prefix_xor(uint64_t x)
+{
+#if defined(__PCLMUL__)
+	return _mm_cvtsi128_si64(_mm_clmulepi64_si128(
+			_mm_set_epi64x(0, x), _mm_set1_epi8((char)0xFF), 0));
+#else
+	x ^= x << 1;
+	x ^= x << 2;
+	x ^= x << 4;
+	x ^= x << 8;
+	x ^= x << 16;
+	x ^= x << 32;
+	return x;
+#endif
+}
+
+static int __index(json_parser_t p, const char *buf, size_t len,
+		   size_t *count, int *bslash)
+{
+	uint64_t esc_carry = 0, str_carry = 0, esc, in_str, st, any = 0;
+	struct json_block_s b;
+	char tail[64];
+	uint32_t *idx;
+	size_t i, n = 0;
+
+	if (len >= UINT32_MAX)
+		return EINVAL;
+	if (p->idx_len < len + 1) {
+		idx = realloc(p->idx, (len + 1) * sizeof(*idx));
+		if (!idx)
+			return ENOMEM;
+		p->idx = idx;
+		p->idx_len = len + 1;
+	}
+	idx = p->idx;
+	for (i = 0; i < len; i += 64) {
+		if (len - i >= 64) {
+			__classify(buf + i, &b);
+		} else {
+			memset(tail, 0, sizeof(tail));
+			memcpy(tail, buf + i, len - i);
+			__classify(tail, &b);
+		}
+		if (b.bslash | esc_carry) {
+			any = 1;
+			esc = __escaped(b.bslash, &esc_carry);
+			b.quote &= ~esc;
+		}
+		in_str = __prefix_xor(b.quote) ^ str_carry;
+		str_carry = (uint64_t)((int64_t)in_str >> 63);
+		if (b.squote & ~in_str)
+			return EINVAL;
+		/* the opening quote is in in_str, the closing one is not */
+		st = (b.op & ~in_str) | b.quote;
+		while (st) {
+			idx[n++] = i + __builtin_ctzll(st);
+			st &= st - 1;
+		}
+	}
+	if (str_carry)
+		return EINVAL;
+	idx[n] = len;
+	*count = n;
+	*bslash = any;
+	return 0;
+}
+
+/*
+ * Stage 2
+ */
+static inline size_t __skip_ws(const char *buf, size_t pos, size_t len)
+{
+	while (pos < len) {
+		switch (buf[pos]) {
+		case ' ':
+		case '\t':
+		case '\n':
+		case '\r':
+			pos++;
+			continue;
+		}
+		break;
+	}
+	return pos;
+}
+
+static inline int __is_hex(char c)
+{
+	return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f')
+		|| (c >= 'A' && c <= 'F');
+}
+
+/* The escapes the lexer accepts in a double quoted string */
+static int __str_check(const char *s, size_t len)
+{
+	const char *end = s + len;
+
+	while ((s = memchr(s, '\\', end - s))) {
+		if (++s >= end)
+			return EINVAL;
+		switch (*s) {
+		case '"': case '\\': case '/':
+		case 'b': case 'f': case 'n': case 'r': case 't':
+			s++;
+			break;
+		case 'u':
+			if (end - s < 5 || !__is_hex(s[1]) || !__is_hex(s[2])
+			    || !__is_hex(s[3]) || !__is_hex(s[4]))
+				return EINVAL;
+			s += 5;
+			break;
+		default:
+			return EINVAL;
+		}
+	}
+	return 0;
+}
+
+#if LDBL_MANT_DIG >= 64
+/* exact in a long double of 64 bits of mantissa or more */
+static const long double __p10[] = {
+	1e0L, 1e1L, 1e2L, 1e3L, 1e4L, 1e5L, 1e6L, 1e7L, 1e8L, 1e9L,
+	1e10L, 1e11L, 1e12L, 1e13L, 1e14L, 1e15L, 1e16L, 1e17L, 1e18L, 1e19L,
+	1e20L, 1e21L, 1e22L, 1e23L, 1e24L, 1e25L, 1e26L, 1e27L,
+};
+#define JSON_P10_MAX 27
+#endif
+
+/*
+ * Convert a number the way the lexer does: [-+]?[0-9]+ with strtoll(s,
+ * NULL, 0) and [-+]?[0-9]*\.?[0-9]*([eE][-+]?[0-9]+)? with strtold(). The
+ * conversions of the common short numbers are done here; both give the same
+ * value as the libc ones.
+ */
+static int __number(json_arena_t a, const char *s, size_t len, json_entity_t *pe)
+{
+	const char *p = s, *end = s + len, *digits;
+	char tmp[64];
+	uint64_t m = 0;
+	int neg = 0, n_int, n_frac = 0, n_dig, e10 = 0, e_neg = 0, e_dig = 0;
+	long double ld;
+	json_entity_t e;
+
+	if (*p == '-' || *p == '+') {
+		neg = (*p == '-');
+		p++;
+	}
+	digits = p;
+	while (p < end && *p >= '0' && *p <= '9')
+		m = m * 10 + (*p++ - '0');
+	n_int = p - digits;
+	if (p == end) {
+		if (!n_int)
+			return EINVAL;
+		e = __scalar_new(a, JSON_INT_VALUE);
+		if (!e)
+			return ENOMEM;
+		if (n_int > 18 || (n_int > 1 && *digits == '0')) {
+			/* overflow or octal */
+			if (len >= sizeof(tmp))
+				return EINVAL;
+			memcpy(tmp, s, len);
+			tmp[len] = '\0';
+			e->value.int_ = strtoll(tmp, NULL, 0);
+		} else {
+			e->value.int_ = neg ? -(int64_t)m : (int64_t)m;
+		}
+		*pe = e;
+		return 0;
+	}
+	if (*p == '.') {
+		p++;
+		while (p < end && *p >= '0' && *p <= '9') {
+			m = m * 10 + (*p++ - '0');
+			n_frac++;
+		}
+	}
+	if (!n_int && !n_frac)
+		return EINVAL;
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		p++;
+		if (p < end && (*p == '-' || *p == '+')) {
+			e_neg = (*p == '-');
+			p++;
+		}
+		while (p < end && *p >= '0' && *p <= '9') {
+			if (e10 < 10000)
+				e10 = e10 * 10 + (*p - '0');
+			p++;
+			e_dig++;
+		}
+		if (!e_dig)
+			return EINVAL;
+	}
+	if (p != end)
+		return EINVAL;
+	e = __scalar_new(a, JSON_FLOAT_VALUE);
+	if (!e)
+		return ENOMEM;
+	n_dig = n_int + n_frac;
+	e10 = (e_neg ? -e10 : e10) - n_frac;
+#if LDBL_MANT_DIG >= 64
+	if (n_dig <= 19 && e10 >= -JSON_P10_MAX && e10 <= JSON_P10_MAX) {
+		/* one correctly rounded operation on exact operands */
+		ld = (long double)m;
+		if (e10 >= 0)
+			ld *= __p10[e10];
+		else
+			ld /= __p10[-e10];
+		e->value.double_ = neg ? -ld : ld;
+		*pe = e;
+		return 0;
+	}
+#endif
+	if (len >= sizeof(tmp))
+		return EINVAL;
+	memcpy(tmp, s, len);
+	tmp[len] = '\0';
+	ld = strtold(tmp, NULL);
+	e->value.double_ = ld;
+	*pe = e;
+	return 0;
+}
+
+static int __scalar(json_arena_t a, const char *s, size_t len, json_entity_t *pe)
+{
+	json_entity_t e;
+
+	switch (*s) {
+	case 't':
+		if (len != 4 || memcmp(s, "true", 4))
+			return EINVAL;
+		e = __scalar_new(a, JSON_BOOL_VALUE);
+		if (!e)
+			return ENOMEM;
+		e->value.bool_ = 1;
+		break;
+	case 'f':
+		if (len != 5 || memcmp(s, "false", 5))
+			return EINVAL;
+		e = __scalar_new(a, JSON_BOOL_VALUE);
+		if (!e)
+			return ENOMEM;
+		e->value.bool_ = 0;
+		break;
+	case 'n':
+		if (len != 4 || memcmp(s, "null", 4))
+			return EINVAL;
+		e = __scalar_new(a, JSON_NULL_VALUE);
+		if (!e)
+			return ENOMEM;
+		e->value.int_ = 0;
+		break;
+	default:
+		return __number(a, s, len, pe);
+	}
+	*pe = e;
+	return 0;
+}
+
+int json_arena_parse_buffer(json_parser_t p, char *buf, size_t buf_len,
+			    json_entity_t *pentity)
+{
+	json_arena_t a;
+	json_entity_t root = NULL, c = NULL, e, *stack;
+	const uint32_t *idx;
+	const char *key = NULL;
+	size_t n, i = 0, pos, end, key_len = 0, depth = 0;
+	int rc, bslash;
+
+	*pentity = NULL;
+	rc = __index(p, buf, buf_len, &n, &bslash);
+	if (rc)
+		return rc;
+	idx = p->idx;
+	a = __arena_new(buf_len * JSON_ARENA_RATIO + JSON_ARENA_MIN);
+	if (!a)
+		return ENOMEM;
+
+	pos = __skip_ws(buf, 0, buf_len);
+ value:
+	if (pos >= buf_len)
+		goto einval;
+	switch (buf[pos]) {
+	case '{':
+	case '[':
+		if (idx[i] != pos)
+			goto einval;
+		i++;
+		e = (buf[pos] == '{') ? __dict_new(a) : __list_new(a);
+		if (!e)
+			goto enomem;
+		if (c && __add(a, c, e, key, key_len))
+			goto enomem;
+		if (depth == p->stack_len) {
+			stack = realloc(p->stack, (depth + 32) * sizeof(*stack));
+			if (!stack)
+				goto enomem;
+			p->stack = stack;
+			p->stack_len = depth + 32;
+		}
+		p->stack[depth++] = c;
+		c = e;
+		if (!root)
+			root = e;
+		pos = __skip_ws(buf, pos + 1, buf_len);
+		if (pos < buf_len
+		    && buf[pos] == (c->type == JSON_DICT_VALUE ? '}' : ']'))
+			goto close;
+		if (c->type == JSON_DICT_VALUE)
+			goto key;
+		goto value;
+	case '"':
+		if (idx[i] != pos)
+			goto einval;
+		end = idx[i + 1];
+		i += 2;
+		if (bslash && __str_check(buf + pos + 1, end - pos - 1))
+			goto einval;
+		e = __str_new(a, buf + pos + 1, end - pos - 1);
+		if (!e)
+			goto enomem;
+		pos = end + 1;
+		break;
+	default:
+		end = idx[i];
+		while (end > pos) {
+			switch (buf[end - 1]) {
+			case ' ':
+			case '\t':
+			case '\n':
+			case '\r':
+			case '\0':
+				end--;
+				continue;
+			}
+			break;
+		}
+		if (end == pos)
+			goto einval;
+		rc = __scalar(a, buf + pos, end - pos, &e);
+		if (rc)
+			goto err;
+		pos = idx[i];
+		break;
+	}
+	if (!c) {
+		root = e;
+		goto done;
+	}
+	if (__add(a, c, e, key, key_len))
+		goto enomem;
+ next:
+	pos = __skip_ws(buf, pos, buf_len);
+	if (pos >= buf_len)
+		goto einval;
+	switch (buf[pos]) {
+	case ',':
+		if (idx[i] != pos)
+			goto einval;
+		i++;
+		pos = __skip_ws(buf, pos + 1, buf_len);
+		if (c->type == JSON_DICT_VALUE)
+			goto key;
+		goto value;
+	case '}':
+		if (c->type != JSON_DICT_VALUE)
+			goto einval;
+		goto close;
+	case ']':
+		if (c->type != JSON_LIST_VALUE)
+			goto einval;
+		goto close;
+	default:
+		goto einval;
+	}
+ key:
+	if (pos >= buf_len || buf[pos] != '"' || idx[i] != pos)
+		goto einval;
+	end = idx[i + 1];
+	i += 2;
+	key = buf + pos + 1;
+	key_len = end - pos - 1;
+	if (bslash && __str_check(key, key_len))
+		goto einval;
+	pos = __skip_ws(buf, end + 1, buf_len);
+	if (pos >= buf_len || buf[pos] != ':' || idx[i] != pos)
+		goto einval;
+	i++;
+	pos = __skip_ws(buf, pos + 1, buf_len);
+	goto value;
+ close:
+	if (idx[i] != pos)
+		goto einval;
+	i++;
+	pos++;
+	c = p->stack[--depth];
+	if (c)
+		goto next;
+ done:
+	/* Anything after the document is ignored, as the lexer does. */
+	assert((char *)root == (char *)a + JSON_ARENA_HDR);
+	root->flags |= JSON_ENTITY_F_ARENA_ROOT;
+	*pentity = root;
+	return 0;
+
+ einval:
+	rc = EINVAL;
+	goto err;
+ enomem:
+	rc = ENOMEM;
+ err:
+	__arena_free(a);
+	return rc;
+}
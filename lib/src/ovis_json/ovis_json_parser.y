@@ -132,13 +132,30 @@ item_list: /* empty */ { $$ = new_list_val(); }
 /* Implementation is in ovis_json_lexer.c, generated by ovis_json_lexer.l */
 int yylex_init(yyscan_t *);
 
-json_parser_t json_parser_new(size_t user_data) {
+json_parser_t json_parser_new_backend(size_t user_data,
+				     enum json_parser_backend_e backend)
+{
 	json_parser_t p = calloc(1, sizeof *p + user_data);
-	if (p)
+	if (p) {
 		yylex_init(&p->scanner);
+		p->backend = backend;
+	}
 	return p;
 }
 
+json_parser_t json_parser_new(size_t user_data) {
+	static int backend = -1;
+	const char *s;
+	if (backend < 0) {
+		s = getenv("OVIS_JSON_PARSER");
+		if (s && 0 == strcmp(s, "arena"))
+			backend = JSON_PARSER_ARENA;
+		else
+			backend = JSON_PARSER_LEX;
+	}
+	return json_parser_new_backend(user_data, backend);
+}
+
 /* Implementation is in ovis_json_lexer.c, generated by ovis_json_lexer.l */
 int yylex_destroy(yyscan_t);
 
@@ -147,6 +164,8 @@ void json_parser_free(json_parser_t parser)
 	if (!parser)
 		return;
 	yylex_destroy(parser->scanner);
+	free(parser->idx);
+	free(parser->stack);
 	free(parser);
 }
 
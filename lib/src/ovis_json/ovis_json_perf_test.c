@@ -204,6 +204,86 @@ double ldmsd_timeval_diff(struct timeval *start, struct timeval *end)
         return (end->tv_sec-start->tv_sec)*1000000.0 + (end->tv_usec-start->tv_usec);
 }
 
+/* kokkosConnector message with nkernels kernel events */
+int make_string_kokkos(char *buf, size_t len, int nkernels)
+{
+	int i, cnt;
+	cnt = snprintf(buf, len, "{ \"job-id\" : %d, \"node-name\" : \"%s\", "
+		"\"rank\" : %d, \"timestamp\" : \"%.6f\", "
+		"\"kokkos-perf-data\" : [ ",
+		(int)dC.jobid, hname, 3, 1700000000.123456);
+	for (i = 0; i < nkernels; i++) {
+		cnt += snprintf(buf + cnt, len - cnt, "%s{ \"name\" : "
+			"\"Kokkos::View::initialization [kernel_%d]\", "
+			"\"type\" : %d, \"current-kernel-count\" : %d, "
+			"\"total-kernel-count\" : %d, \"level\" : %d, "
+			"\"current-kernel-time\" : %.9f, "
+			"\"total-kernel-time\" : %.9f }",
+			(i ? ", " : ""), i, i % 3, 100 + i, 1000 + i, 0,
+			0.000123456 * (i + 1), 1.23456789 * (i + 1));
+	}
+	cnt += snprintf(buf + cnt, len - cnt, " ] }\n");
+	return cnt + 1; /* the '\0' is sent with the stream message */
+}
+
+/* parse buf count times, return the time in us */
+double parse_time(enum json_parser_backend_e backend, char *buf, size_t len,
+		  int count, jbuf_t *dump)
+{
+	struct timeval tv1, tv2;
+	json_parser_t p;
+	json_entity_t e;
+	int i, rc;
+
+	p = json_parser_new_backend(0, backend);
+	if (!p)
+		return -1;
+	gettimeofday(&tv1, NULL);
+	for (i = 0; i < count; i++) {
+		rc = json_parse_buffer(p, buf, len, &e);
+		if (rc) {
+			printf("json_parse_buffer error %d\n", rc);
+			json_parser_free(p);
+			return -1;
+		}
+		if (!i && dump)
+			*dump = json_entity_dump(NULL, e);
+		json_entity_free(e);
+	}
+	gettimeofday(&tv2, NULL);
+	json_parser_free(p);
+	return ldmsd_timeval_diff(&tv1, &tv2);
+}
+
+/* report MB/s of the lexer and the arena parser */
+int parse_rates(const char *name, char *buf, size_t len, int count)
+{
+	jbuf_t jl = NULL, ja = NULL;
+	double tl, ta;
+	int rc = 0;
+
+	tl = parse_time(JSON_PARSER_LEX, buf, len, count, &jl);
+	ta = parse_time(JSON_PARSER_ARENA, buf, len, count, &ja);
+	if (tl < 0 || ta < 0 || !jl || !ja) {
+		rc = 1;
+		goto out;
+	}
+	if (strcmp(jl->buf, ja->buf)) {
+		printf("%s: lex and arena parsers differ:\n%s\n%s\n",
+		       name, jl->buf, ja->buf);
+		rc = 1;
+		goto out;
+	}
+	printf("%d %s (%zu bytes) lex parse MB/s %g\n", count, name, len,
+	       (double)len * count / tl);
+	printf("%d %s (%zu bytes) arena parse MB/s %g\n", count, name, len,
+	       (double)len * count / ta);
+out:
+	jbuf_free(jl);
+	jbuf_free(ja);
+	return rc;
+}
+
 int main(int argc, char *argv[])
 {
 	if (argc < 2) {
@@ -259,5 +339,14 @@ int main(int argc, char *argv[])
 	printf("%d sprintf time us %g\n",count, ldmsd_timeval_diff(&tv1, &tv2));
 	printf("%d jbuf elements time us    %g\n",count, ldmsd_timeval_diff(&tv2, &tv3));
 	printf("%d jbuf fmt time us    %g\n",count, ldmsd_timeval_diff(&tv3, &tv4));
-	return 0;
+
+	/* parse rates */
+	char kbuf[16384];
+	int rc = 0;
+	make_string_sprintf(1, buf,
+		record_count, rwo, offset, length, max_byte, rw_switch, flushes, start_time, end_time, tspec_start, tspec_end, total_time, mod_name, data_type);
+	rc |= parse_rates("darshan", buf, strlen(buf) + 1, count);
+	rc |= parse_rates("kokkos", kbuf, make_string_kokkos(kbuf, sizeof(kbuf), 1), count);
+	rc |= parse_rates("kokkos-batch", kbuf, make_string_kokkos(kbuf, sizeof(kbuf), 64), count / 64 + 1);
+	return rc;
 }
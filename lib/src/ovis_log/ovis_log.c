@@ -51,10 +51,16 @@
 #include <assert.h>
 #include <limits.h>
 #include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include <sys/errno.h>
+#include <sys/queue.h>
 #include <sys/time.h>
+#include <sys/uio.h>
 #include <syslog.h>
 #include <sys/types.h>
 #include <regex.h>
@@ -94,17 +100,122 @@ static pthread_mutex_t subsys_tree_lock = PTHREAD_MUTEX_INITIALIZER;
 
 struct log_data {
 	enum op_type {
-		OVIS_LOG_O_LOG = 1,
+		OVIS_LOG_O_DRAIN = 1,
+		OVIS_LOG_O_DEDUP,
 		OVIS_LOG_O_OPEN,
 		OVIS_LOG_O_CLOSE,
 	} type;
-	uint64_t level; /* feature|level */
 	char *msg;
+	uint64_t stamp;	/* when ovis_log_open() or ovis_log_close() was called */
+};
+
+/*
+ * Asynchronous logging
+ *
+ * After ovis_log_init(), ovis_vlog() formats the whole line on the calling
+ * thread into a ring buffer owned by that thread, without allocating memory
+ * or taking a lock. The log worker drains the rings of all threads and
+ * writes up to LOG_IOV_MAX lines with one writev(). A thread posts the
+ * drain event only if the worker has not been woken up already, and the
+ * event is delivered LOG_DRAIN_DELAY later, so a burst of messages costs
+ * one event and one writev(). A thread whose ring is full, or whose line
+ * does not fit in a ring, drains the rings itself.
+ *
+ * The records are stamped with CLOCK_MONOTONIC, and a drain merges the
+ * rings in the stamp order, so the lines are written in the order they were
+ * logged, except that the lines that different threads log at about the
+ * same time may be written in any order.
+ *
+ * Everything that writes to the log file, except the synchronous logging
+ * before ovis_log_init(), holds drain_lock. The threads do not drain while
+ * an ovis_log_open() or ovis_log_close() is pending; the worker writes the
+ * lines logged before the call to the old file.
+ */
+#define LOG_RING_SZ	(64 * 1024)	/* a power of 2 */
+#define LOG_REC_MAX	(LOG_RING_SZ / 4)
+#define LOG_IOV_MAX	1024
+#define LOG_SUM_SZ	(64 * 1024)	/* the dedup summaries of a writev() */
+#define LOG_SUM_MAX	(LOG_REC_MAX + 256)
+#define LOG_DUP_MAX	8		/* the messages remembered per subsystem */
+#define LOG_DRAIN_DELAY	1000000		/* nanoseconds */
+
+struct log_rec {
+	uint64_t stamp;		/* CLOCK_MONOTONIC nanoseconds */
+	uint32_t len;		/* the record size, 8-byte aligned */
+	uint32_t text_len;	/* the line length, excluding the '\0' */
+	uint32_t name_off;	/* "<subsystem>: <message>" in text */
+	uint32_t msg_off;	/* "<message>" in text */
+	int level;
+	ovis_log_t log;		/* NULL for the padding at the end of the ring */
+	char text[];
+};
+
+/* single-producer (the owner thread), single-consumer (drain_lock holder) */
+struct log_ring {
+	uint64_t head;
+	char pad[64 - sizeof(uint64_t)]; /* head and tail on separate cache lines */
+	uint64_t tail;
+	uint64_t drain_head;	/* the next record to write */
+	uint64_t drain_tail;
+	struct log_rec *drain_rec; /* the record at drain_head */
+	int orphan;		/* the owner thread has exited */
+	LIST_ENTRY(log_ring) entry;
+	char buf[LOG_RING_SZ];
+};
+
+struct log_thr {
+	struct log_ring *ring;
+	char *buf;		/* the line being logged */
+	size_t sz;
+	size_t len;
+	size_t name_off;
+	size_t msg_off;
+	time_t dt_sec;
+	char dt[64];		/* the date-time prefix of dt_sec */
+	int is_writer;		/* the log worker thread */
+};
+
+/* A recent message of a subsystem in the dedup mode */
+struct log_dup_ent {
+	struct ovis_log_dup_s *dup;
+	char *msg;
+	size_t len;
+	size_t sz;
+	int level;
+	unsigned int count;	/* the repeats not reported yet */
+	time_t start;		/* when the message or a summary was written */
+	LIST_ENTRY(log_dup_ent) entry; /* in dup_list while count > 0 */
+};
+
+struct ovis_log_dup_s {
 	ovis_log_t log;
-	struct timeval tv;
-	struct tm tm;
+	int n;
+	struct log_dup_ent ent[LOG_DUP_MAX];
 };
 
+static pthread_key_t log_thr_key;
+static pthread_once_t log_thr_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t drain_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t ring_list_lock = PTHREAD_MUTEX_INITIALIZER;
+static LIST_HEAD(, log_ring) ring_list = LIST_HEAD_INITIALIZER(ring_list);
+static struct log_ring **drain_heap;	/* ring_list_lock */
+static int drain_heap_sz;
+static int ring_count;
+static ev_t drain_ev;
+static ev_t dedup_ev;
+static int drain_posted;
+static int log_op_pending;	/* drain_lock */
+static pthread_cond_t log_op_cond = PTHREAD_COND_INITIALIZER;
+static int dedup_interval;	/* seconds, 0 disables the dedup mode */
+
+/* drain_lock */
+static LIST_HEAD(, log_dup_ent) dup_list = LIST_HEAD_INITIALIZER(dup_list);
+static struct log_thr drain_thr;
+static struct iovec drain_iov[LOG_IOV_MAX];
+static int drain_iovcnt;
+static char drain_sum[LOG_SUM_SZ];
+static size_t drain_sum_off;
+
 const char* ovis_loglevel_names[] = {
 	[OVIS_LQUIET] = "QUIET",
 	[OVIS_LDEBUG] = "DEBUG",
@@ -357,6 +468,13 @@ out:
 
 static void __free_log(ovis_log_t log)
 {
+	int i;
+
+	if (log->dup) {
+		for (i = 0; i < log->dup->n; i++)
+			free(log->dup->ent[i].msg);
+		free(log->dup);
+	}
 	free((char *)log->name);
 	free((char *)log->desc);
 	free(log);
@@ -397,7 +515,7 @@ ovis_log_t ovis_log_register(const char *subsys_name, const char *desc)
 		errno = EEXIST;
 		return NULL;
 	}
-	log = malloc(sizeof(*log));
+	log = calloc(1, sizeof(*log));
 	if (!log) {
 		errno = ENOMEM;
 		return NULL;
@@ -641,78 +759,581 @@ static int __log_close()
 	return 0;
 }
 
-static int __log(ovis_log_t log, int level, char *msg,
-			    struct timeval *tv, struct tm *tm)
+static uint64_t __log_stamp(void)
 {
-	if (log_fp == OVIS_LOG_SYSLOG) {
-		syslog(__log_level_to_syslog(level), "%s: %s", log->name, msg);
-		return 0;
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void log_thr_destroy(void *arg)
+{
+	struct log_thr *thr = arg;
+
+	if (thr->ring) {
+		/* The drainer frees the ring once it is empty. */
+		__atomic_store_n(&thr->ring->orphan, 1, __ATOMIC_RELEASE);
 	}
+	free(thr->buf);
+	free(thr);
+}
+
+static void log_thr_key_init(void)
+{
+	(void)pthread_key_create(&log_thr_key, log_thr_destroy);
+}
+
+static struct log_thr *log_thr_get(void)
+{
+	struct log_thr *thr;
+
+	pthread_once(&log_thr_once, log_thr_key_init);
+	thr = pthread_getspecific(log_thr_key);
+	if (thr)
+		return thr;
+	thr = calloc(1, sizeof(*thr));
+	if (!thr)
+		return NULL;
+	thr->sz = 512;
+	thr->buf = malloc(thr->sz);
+	if (!thr->buf || pthread_setspecific(log_thr_key, thr)) {
+		free(thr->buf);
+		free(thr);
+		return NULL;
+	}
+	return thr;
+}
+
+static struct log_ring *log_ring_get(struct log_thr *thr)
+{
+	struct log_ring **heap;
+	struct log_ring *r;
+
+	if (thr->ring)
+		return thr->ring;
+	r = malloc(sizeof(*r));
+	if (!r)
+		return NULL;
+	r->head = r->tail = r->drain_head = 0;
+	r->orphan = 0;
+	pthread_mutex_lock(&ring_list_lock);
+	if (ring_count == drain_heap_sz) {
+		/* The drainer merges the rings with a heap. */
+		heap = realloc(drain_heap, (drain_heap_sz + 16) * sizeof(*heap));
+		if (!heap) {
+			pthread_mutex_unlock(&ring_list_lock);
+			free(r);
+			return NULL;
+		}
+		drain_heap = heap;
+		drain_heap_sz += 16;
+	}
+	LIST_INSERT_HEAD(&ring_list, r, entry);
+	ring_count++;
+	pthread_mutex_unlock(&ring_list_lock);
+	thr->ring = r;
+	return r;
+}
+
+/* Format "<logging time>:<log level>:" */
+static int __log_prefix(struct log_thr *thr, int level, char *buf, size_t sz)
+{
+	const char *ts = "";
+	char tv_s[32];
+	struct timeval tv;
+	struct tm tm;
+	time_t t;
 
-	int rc;
-	FILE *f;
-	if (!log_fp)
-		f = stdout;
-	else
-		f = log_fp;
 	if (default_modes & OVIS_LOG_M_TS) {
-		rc = fprintf(f, "%lu.%06lu:", tv->tv_sec, tv->tv_usec);
+		gettimeofday(&tv, NULL);
+		snprintf(tv_s, sizeof(tv_s), "%lu.%06lu:", tv.tv_sec, tv.tv_usec);
+		ts = tv_s;
 	} else if (default_modes & OVIS_LOG_M_DT) {
-		char dtsz[200];
-		if (strftime(dtsz, sizeof(dtsz), "%a %b %d %H:%M:%S %Y", tm))
-			rc = fprintf(f, "%s:", dtsz);
-		else
-			rc = -EINVAL; /* not expected with gnu libc */
-	} else {
-		rc = 0;
+		/* The date-time string changes once a second. */
+		t = time(NULL);
+		if (t != thr->dt_sec || !thr->dt[0]) {
+			localtime_r(&t, &tm);
+			if (strftime(thr->dt, sizeof(thr->dt) - 1,
+				     "%a %b %d %H:%M:%S %Y", &tm))
+				strcat(thr->dt, ":");
+			else
+				thr->dt[0] = '\0'; /* not expected with gnu libc */
+			thr->dt_sec = t;
+		}
+		ts = thr->dt;
 	}
-	if (rc < 0)
-		return rc;
+	return snprintf(buf, sz, "%s%9s:", ts,
+			((level == OVIS_LALWAYS)?"":ovis_loglevel_names[level]));
+}
 
-	/* Print the level name */
-	rc = fprintf(f, "%9s:", ((level == OVIS_LALWAYS)?"":ovis_loglevel_names[level]));
-	if (rc < 0)
-		return rc;
+static int __log_thr_grow(struct log_thr *thr, size_t sz)
+{
+	char *buf;
 
-	rc = fprintf(f, " %s: %s", log->name, msg);
-	if (rc < 0)
-		return rc;
+	if (sz <= thr->sz)
+		return 0;
+	buf = realloc(thr->buf, sz);
+	if (!buf)
+		return ENOMEM;
+	thr->buf = buf;
+	thr->sz = sz;
+	return 0;
+}
+
+/* Format the line of a message in the buffer of the thread */
+static int __log_format(struct log_thr *thr, ovis_log_t log, int level,
+			const char *fmt, va_list ap)
+{
+	char prefix[128];
+	size_t prefix_len, name_len, hdr_len;
+	va_list ap_dup;
+	int cnt;
+
+	cnt = __log_prefix(thr, level, prefix, sizeof(prefix));
+	if (cnt < 0)
+		return -EINVAL;
+	prefix_len = ((cnt < sizeof(prefix))?cnt:(sizeof(prefix) - 1));
+	name_len = strlen(log->name);
+	hdr_len = prefix_len + 1 + name_len + 2; /* "<prefix> <name>: " */
+	if (__log_thr_grow(thr, hdr_len + 1))
+		return -ENOMEM;
+	while (1) {
+		va_copy(ap_dup, ap);
+		cnt = vsnprintf(&thr->buf[hdr_len], thr->sz - hdr_len, fmt, ap_dup);
+		va_end(ap_dup);
+		if (cnt < 0)
+			return -EINVAL;
+		if (hdr_len + cnt < thr->sz)
+			break;
+		if (__log_thr_grow(thr, hdr_len + cnt + 1))
+			return -ENOMEM;
+	}
+	memcpy(thr->buf, prefix, prefix_len);
+	thr->buf[prefix_len] = ' ';
+	memcpy(&thr->buf[prefix_len + 1], log->name, name_len);
+	memcpy(&thr->buf[hdr_len - 2], ": ", 2);
+	thr->name_off = prefix_len + 1;
+	thr->msg_off = hdr_len;
+	thr->len = hdr_len + cnt;
+	return 0;
+}
+
+/* Write the line formatted by the thread with stdio */
+static void __log_write(struct log_thr *thr, int level, int flush)
+{
+	FILE *f;
+
+	if (log_fp == OVIS_LOG_SYSLOG) {
+		syslog(__log_level_to_syslog(level), "%s", &thr->buf[thr->name_off]);
+		return;
+	}
+	f = (log_fp?log_fp:stdout);
+	fwrite(thr->buf, 1, thr->len, f);
+	if (flush)
+		fflush(f);
+}
+
+static int __log_ring_push(struct log_ring *r, struct log_thr *thr,
+			   ovis_log_t log, int level)
+{
+	struct log_rec *rec;
+	uint64_t head, tail, pos, room, len;
+
+	len = (offsetof(struct log_rec, text) + thr->len + 1 + 7) & ~7UL;
+	head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+	tail = r->tail;
+	pos = tail & (LOG_RING_SZ - 1);
+	room = LOG_RING_SZ - pos;
+	if (room < len) {
+		/*
+		 * Records do not wrap around. Pad the end of the ring. The
+		 * drainer skips an end shorter than a record header.
+		 */
+		if (LOG_RING_SZ - (tail - head) < room + len)
+			return ENOSPC;
+		if (room >= sizeof(*rec)) {
+			rec = (void *)&r->buf[pos];
+			rec->len = room;
+			rec->log = NULL;
+		}
+		tail += room;
+		pos = 0;
+	} else if (LOG_RING_SZ - (tail - head) < len) {
+		return ENOSPC;
+	}
+	rec = (void *)&r->buf[pos];
+	rec->stamp = __log_stamp();
+	rec->len = len;
+	rec->text_len = thr->len;
+	rec->name_off = thr->name_off;
+	rec->msg_off = thr->msg_off;
+	rec->level = level;
+	rec->log = __ovis_log_get(log);
+	memcpy(rec->text, thr->buf, thr->len + 1);
+	__atomic_store_n(&r->tail, tail + len, __ATOMIC_RELEASE);
+	return 0;
+}
+
+/*
+ * Wake up the worker unless it has been woken up already. The worker
+ * clears drain_posted before it reads the rings, so either the worker sees
+ * the record just queued, or the thread sees drain_posted cleared.
+ */
+static void __log_wake(void)
+{
+	struct timespec to;
+
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&drain_posted, __ATOMIC_RELAXED))
+		return;
+	if (__atomic_exchange_n(&drain_posted, 1, __ATOMIC_SEQ_CST))
+		return;
+	ev_sched_to(&to, 0, LOG_DRAIN_DELAY);
+	if (to.tv_nsec >= 1000000000) {
+		to.tv_sec++;
+		to.tv_nsec -= 1000000000;
+	}
+	if (ev_post(NULL, logger_w, drain_ev, &to))
+		__atomic_store_n(&drain_posted, 0, __ATOMIC_SEQ_CST);
+}
+
+/*
+ * Write the gathered lines and release the ring space of the records
+ * drained so far. The caller holds drain_lock and ring_list_lock.
+ */
+static void __drain_flush(void)
+{
+	struct iovec *iov = drain_iov;
+	int cnt = drain_iovcnt;
+	struct log_ring *r;
+	ssize_t n;
+	FILE *f;
+
+	if (log_fp != OVIS_LOG_SYSLOG) {
+		f = (log_fp?log_fp:stdout);
+		/* The lines written with stdio go first. */
+		fflush(f);
+		while (cnt) {
+			n = writev(fileno(f), iov, cnt);
+			if (n < 0) {
+				if (errno == EINTR)
+					continue;
+				break; /* The lines are lost. */
+			}
+			while (cnt && n >= iov->iov_len) {
+				n -= iov->iov_len;
+				iov++;
+				cnt--;
+			}
+			if (cnt) {
+				iov->iov_base = (char *)iov->iov_base + n;
+				iov->iov_len -= n;
+			}
+		}
+	}
+	drain_iovcnt = 0;
+	drain_sum_off = 0;
+	LIST_FOREACH(r, &ring_list, entry)
+		__atomic_store_n(&r->head, r->drain_head, __ATOMIC_RELEASE);
+}
+
+static void __drain_add(char *text, size_t len)
+{
+	drain_iov[drain_iovcnt].iov_base = text;
+	drain_iov[drain_iovcnt].iov_len = len;
+	drain_iovcnt++;
+}
+
+/* Report the repeats of a message not reported yet */
+static void __dup_report(struct log_dup_ent *ent, time_t now)
+{
+	ovis_log_t log = ent->dup->log;
+	char *s = &drain_sum[drain_sum_off];
+	size_t sz = LOG_SUM_SZ - drain_sum_off;
+	int len;
+
+	if (log_fp == OVIS_LOG_SYSLOG) {
+		syslog(__log_level_to_syslog(ent->level),
+		       "%s: message repeated %u times: %.*s", log->name,
+		       ent->count, (int)ent->len, ent->msg);
+	} else {
+		len = __log_prefix(&drain_thr, ent->level, s, sz);
+		if (len >= 0 && len < sz)
+			len += snprintf(&s[len], sz - len,
+					" %s: message repeated %u times: %.*s",
+					log->name, ent->count,
+					(int)ent->len, ent->msg);
+		if (len >= 0) {
+			if (len >= sz)
+				len = sz - 1;
+			__drain_add(s, len);
+			drain_sum_off += len;
+		}
+	}
+	ent->count = 0;
+	ent->start = now;
+	LIST_REMOVE(ent, entry);
+	/* Put back the reference taken when the first repeat was counted. */
+	__ovis_log_put(log);
+}
+
+/*
+ * Return 1 if the record repeats one of the recent messages of its
+ * subsystem. Otherwise, the message replaces the least recent one.
+ */
+static int __dup_check(struct log_rec *rec, time_t now)
+{
+	ovis_log_t log = rec->log;
+	struct ovis_log_dup_s *dup = log->dup;
+	struct log_dup_ent *ent;
+	char *msg = &rec->text[rec->msg_off];
+	size_t len = rec->text_len - rec->msg_off;
+	char *s;
+	int i;
+
+	if (!dup) {
+		dup = calloc(1, sizeof(*dup));
+		if (!dup)
+			return 0;
+		dup->log = log;
+		log->dup = dup;
+	}
+	for (i = 0; i < dup->n; i++) {
+		ent = &dup->ent[i];
+		if (ent->level != rec->level || ent->len != len ||
+		    memcmp(ent->msg, msg, len))
+			continue;
+		if (0 == ent->count++) {
+			LIST_INSERT_HEAD(&dup_list, ent, entry);
+			(void) __ovis_log_get(log);
+		}
+		if (now - ent->start >= dedup_interval)
+			__dup_report(ent, now);
+		return 1;
+	}
+	if (dup->n < LOG_DUP_MAX) {
+		ent = &dup->ent[dup->n++];
+		ent->dup = dup;
+	} else {
+		ent = &dup->ent[0];
+		for (i = 1; i < dup->n; i++) {
+			if (dup->ent[i].start < ent->start)
+				ent = &dup->ent[i];
+		}
+		if (ent->count)
+			__dup_report(ent, now);
+	}
+	if (len > ent->sz) {
+		s = realloc(ent->msg, len);
+		if (!s) {
+			ent->len = 0;
+			ent->level = 0;
+			return 0;
+		}
+		ent->msg = s;
+		ent->sz = len;
+	}
+	memcpy(ent->msg, msg, len);
+	ent->len = len;
+	ent->level = rec->level;
+	ent->start = now;
 	return 0;
 }
 
+/* Return the record at drain_head of a ring, skipping the padding */
+static struct log_rec *__ring_peek(struct log_ring *r)
+{
+	struct log_rec *rec;
+	uint64_t pos, room;
+
+	while (r->drain_head < r->drain_tail) {
+		pos = r->drain_head & (LOG_RING_SZ - 1);
+		room = LOG_RING_SZ - pos;
+		if (room < sizeof(*rec)) {
+			r->drain_head += room;
+			continue;
+		}
+		rec = (void *)&r->buf[pos];
+		if (rec->log)
+			return rec;
+		r->drain_head += rec->len;
+	}
+	return NULL;
+}
+
+/* Restore the min-heap of drain_heap[0 .. n-1] by the stamp of drain_rec */
+static void __heap_down(int i, int n)
+{
+	struct log_ring *r = drain_heap[i];
+	int c;
+
+	while ((c = 2 * i + 1) < n) {
+		if (c + 1 < n && drain_heap[c + 1]->drain_rec->stamp <
+				 drain_heap[c]->drain_rec->stamp)
+			c++;
+		if (r->drain_rec->stamp <= drain_heap[c]->drain_rec->stamp)
+			break;
+		drain_heap[i] = drain_heap[c];
+		i = c;
+	}
+	drain_heap[i] = r;
+}
+
+static void __heap_up(int i)
+{
+	struct log_ring *r = drain_heap[i];
+	int p;
+
+	while (i && r->drain_rec->stamp < drain_heap[p = (i - 1) / 2]->drain_rec->stamp) {
+		drain_heap[i] = drain_heap[p];
+		i = p;
+	}
+	drain_heap[i] = r;
+}
+
+/*
+ * Write the queued lines stamped before \c until. If \c flush is 1,
+ * report all repeats not reported yet. The caller holds drain_lock.
+ */
+static void __log_drain(uint64_t until, int flush)
+{
+	struct log_dup_ent *ent, *ent_next;
+	struct log_ring *r, *r_next;
+	struct log_rec *rec;
+	struct timespec to;
+	time_t now = time(NULL);
+	int n = 0;
+
+	pthread_mutex_lock(&ring_list_lock);
+	LIST_FOREACH(r, &ring_list, entry) {
+		r->drain_tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+		r->drain_rec = __ring_peek(r);
+		if (!r->drain_rec)
+			continue;
+		drain_heap[n] = r;
+		__heap_up(n++);
+	}
+	while (n) {
+		/* Room for a summary and a line */
+		if (drain_iovcnt > LOG_IOV_MAX - 2 ||
+		    drain_sum_off > LOG_SUM_SZ - LOG_SUM_MAX)
+			__drain_flush();
+		r = drain_heap[0];
+		rec = r->drain_rec;
+		if (rec->stamp >= until)
+			break;
+		r->drain_head += rec->len;
+		if (dedup_interval && __dup_check(rec, now))
+			goto next;
+		if (log_fp == OVIS_LOG_SYSLOG)
+			syslog(__log_level_to_syslog(rec->level), "%s",
+			       &rec->text[rec->name_off]);
+		else
+			__drain_add(rec->text, rec->text_len);
+	next:
+		__ovis_log_put(rec->log);
+		r->drain_rec = __ring_peek(r);
+		if (!r->drain_rec)
+			drain_heap[0] = drain_heap[--n];
+		__heap_down(0, n);
+	}
+	for (ent = LIST_FIRST(&dup_list); ent; ent = ent_next) {
+		ent_next = LIST_NEXT(ent, entry);
+		if (drain_iovcnt > LOG_IOV_MAX - 2 ||
+		    drain_sum_off > LOG_SUM_SZ - LOG_SUM_MAX)
+			__drain_flush();
+		if (flush || !dedup_interval || now - ent->start >= dedup_interval)
+			__dup_report(ent, now);
+	}
+	__drain_flush();
+	for (r = LIST_FIRST(&ring_list); r; r = r_next) {
+		r_next = LIST_NEXT(r, entry);
+		if (__atomic_load_n(&r->orphan, __ATOMIC_ACQUIRE) &&
+		    r->head == __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE)) {
+			LIST_REMOVE(r, entry);
+			ring_count--;
+			free(r);
+		}
+	}
+	pthread_mutex_unlock(&ring_list_lock);
+	if (!LIST_EMPTY(&dup_list)) {
+		/* Report the repeats even if the subsystem stops logging. */
+		ev_sched_to(&to, dedup_interval, 0);
+		(void) ev_post(NULL, logger_w, dedup_ev, &to);
+	}
+}
+
+/* The caller holds drain_lock. */
+static void __log_op_done(void)
+{
+	if (0 == --log_op_pending)
+		pthread_cond_broadcast(&log_op_cond);
+}
+
+/* Take drain_lock in the threads other than the worker */
+static void __log_drain_lock(void)
+{
+	pthread_mutex_lock(&drain_lock);
+	while (log_op_pending)
+		pthread_cond_wait(&log_op_cond, &drain_lock);
+}
+
+/* Post an open or close event. */
+static int __log_op_post(ev_t ev)
+{
+	int rc;
+
+	EV_DATA(ev, struct log_data)->stamp = __log_stamp();
+	pthread_mutex_lock(&drain_lock);
+	log_op_pending++;
+	pthread_mutex_unlock(&drain_lock);
+	rc = ev_post(NULL, logger_w, ev, NULL);
+	if (rc) {
+		pthread_mutex_lock(&drain_lock);
+		__log_op_done();
+		pthread_mutex_unlock(&drain_lock);
+	}
+	return rc;
+}
+
 static int log_actor(ev_worker_t src, ev_worker_t dst, ev_status_t status, ev_t ev)
 {
-	int level;
-	char *msg;
-	struct timeval *tv;
-	struct tm *tm;
 	enum op_type type = EV_DATA(ev, struct log_data)->type;
-	ovis_log_t log;
+	struct log_thr *thr;
 	char *path;
 
+	/* The worker holds drain_lock when it logs, so it logs directly. */
+	thr = log_thr_get();
+	if (thr)
+		thr->is_writer = 1;
+
 	switch (type) {
-	case OVIS_LOG_O_LOG:
-		level = EV_DATA(ev, struct log_data)->level;
-		msg = EV_DATA(ev, struct log_data)->msg;
-		tv = &EV_DATA(ev, struct log_data)->tv;
-		tm = &EV_DATA(ev, struct log_data)->tm;
-		log = EV_DATA(ev, struct log_data)->log;
-
-		(void) __log(log, level, msg, tv, tm);
-		if (0 == ev_pending(logger_w)) {
-			if (log_fp != OVIS_LOG_SYSLOG)
-				fflush(log_fp);
-		}
-		free(msg);
-		__ovis_log_put(log);
-		break;
+	case OVIS_LOG_O_DRAIN:
+		/* Clear the flag before reading the rings. See __log_wake(). */
+		__atomic_store_n(&drain_posted, 0, __ATOMIC_SEQ_CST);
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		/* fall through */
+	case OVIS_LOG_O_DEDUP:
+		pthread_mutex_lock(&drain_lock);
+		__log_drain(UINT64_MAX, 0);
+		pthread_mutex_unlock(&drain_lock);
+		return 0; /* drain_ev and dedup_ev are reused. */
 	case OVIS_LOG_O_OPEN:
 		path = EV_DATA(ev, struct log_data)->msg;
+		pthread_mutex_lock(&drain_lock);
+		__log_drain(EV_DATA(ev, struct log_data)->stamp, 0);
 		(void) __log_reopen(path);
+		__log_op_done();
+		pthread_mutex_unlock(&drain_lock);
 		free(path);
 		break;
 	case OVIS_LOG_O_CLOSE:
+		pthread_mutex_lock(&drain_lock);
+		__log_drain(EV_DATA(ev, struct log_data)->stamp, 0);
 		__log_close();
+		__log_op_done();
+		pthread_mutex_unlock(&drain_lock);
 		break;
 	default:
 		ovis_log(NULL, OVIS_LCRITICAL,
@@ -748,6 +1369,11 @@ static int __cache_stdout_stderr()
 	return 0;
 }
 
+static void __log_atexit(void)
+{
+	(void) ovis_log_flush();
+}
+
 int ovis_log_init(const char *name, int default_level, int modes)
 {
 	if (is_init) {
@@ -758,6 +1384,7 @@ int ovis_log_init(const char *name, int default_level, int modes)
 	int rc;
 	int need_free = 0;
 	char s[PATH_MAX];
+	char *env;
 
 	if (!is_level_valid(default_level))
 		return EINVAL;
@@ -793,12 +1420,25 @@ int ovis_log_init(const char *name, int default_level, int modes)
 		rc = ENOMEM;
 		goto err;
 	}
+	drain_ev = ev_new(log_type);
+	dedup_ev = ev_new(log_type);
+	if (!drain_ev || !dedup_ev) {
+		rc = ENOMEM;
+		goto err;
+	}
+	EV_DATA(drain_ev, struct log_data)->type = OVIS_LOG_O_DRAIN;
+	EV_DATA(dedup_ev, struct log_data)->type = OVIS_LOG_O_DEDUP;
+	env = getenv("OVIS_LOG_DEDUP");
+	if (env && atoi(env) > 0)
+		dedup_interval = atoi(env);
 	snprintf(s, PATH_MAX, "%s:logger", progname);
 	logger_w = ev_worker_new(s, log_actor);
 	if (!logger_w) {
 		rc = ENOMEM;
 		goto err;
 	}
+	/* Write the queued messages when the application exits. */
+	atexit(__log_atexit);
 	is_init = 1;
 	return 0;
 err:
@@ -806,10 +1446,23 @@ err:
 		free(progname);
 	if (default_log.name[0] != '\0')
 		free((char *)default_log.name);
+	if (drain_ev)
+		ev_put(drain_ev);
+	if (dedup_ev)
+		ev_put(dedup_ev);
+	drain_ev = dedup_ev = NULL;
 	free(log_type);
 	return rc;
 }
 
+int ovis_log_set_dedup(int interval)
+{
+	if (interval < 0)
+		return EINVAL;
+	dedup_interval = interval;
+	return 0;
+}
+
 void ovis_log_set_mode(int modes)
 {
 	default_modes = modes;
@@ -862,13 +1515,18 @@ int ovis_log_open(const char *path)
 
 		EV_DATA(open_ev, struct log_data)->type = OVIS_LOG_O_OPEN;
 		EV_DATA(open_ev, struct log_data)->msg = s;
-		rc = ev_post(NULL, logger_w, open_ev, NULL);
+		rc = __log_op_post(open_ev);
 	}
 	return rc;
 }
 
 int ovis_log_flush()
 {
+	if (logger_w) {
+		__log_drain_lock();
+		__log_drain(UINT64_MAX, 1);
+		pthread_mutex_unlock(&drain_lock);
+	}
 	if (log_fp && log_fp != OVIS_LOG_SYSLOG)
 		return fflush(log_fp);
 	return 0;
@@ -886,8 +1544,10 @@ int ovis_log_close()
 		rc = __log_close();
 	} else {
 		close_ev = ev_new(log_type);
+		if (!close_ev)
+			return ENOMEM;
 		EV_DATA(close_ev, struct log_data)->type = OVIS_LOG_O_CLOSE;
-		rc = ev_post(NULL, logger_w, close_ev, NULL);
+		rc = __log_op_post(close_ev);
 	}
 	return rc;
 }
@@ -898,21 +1558,13 @@ int ovis_log_rotate(const char *path){
 
 int ovis_vlog(ovis_log_t log, int level, const char *fmt, va_list ap)
 {
-	ev_t log_ev;
-	char *msg;
-	int rc = 0;
-	struct timeval tv;
-	struct tm tm;
-	time_t t;
+	struct log_thr *thr;
+	struct log_ring *r;
+	int rc;
 	int lmask;
 
 	if (!log)
 		log = &default_log;
-	/*
-	 * Take a log handle reference to prevent it
-	 * being destroyed while in this function.
-	 */
-	(void) __ovis_log_get(log);
 
 	lmask = ((log->level == OVIS_LDEFAULT)?default_log.level:log->level);
 
@@ -923,47 +1575,46 @@ int ovis_vlog(ovis_log_t log, int level, const char *fmt, va_list ap)
 	 */
 	if (!(lmask & level)) {
 		/* The given level is disabled. Do nothing. */
-		goto out;
-	}
-
-	if (default_modes & OVIS_LOG_M_TS) {
-		gettimeofday(&tv, NULL);
-
-	} else {
-		t = time(NULL);
-		localtime_r(&t, &tm);
+		return 0;
 	}
 
-	rc = vasprintf(&msg, fmt, ap);
-	if (rc < 0) {
-		rc = -ENOMEM;
-		goto out;
-	}
+	thr = log_thr_get();
+	if (!thr)
+		return -ENOMEM;
+	rc = __log_format(thr, log, level, fmt, ap);
+	if (rc)
+		return rc;
 
 	if (!logger_w) {
 		/* No workers, so directly log to the file. */
-		rc = __log(log, level, msg, &tv, &tm);
-		free(msg);
-		goto out;
+		__log_write(thr, level, 0);
+		return 0;
 	}
-
-	log_ev = ev_new(log_type);
-	if (!log_ev) {
-		rc = -ENOMEM;
-		goto out;
+	/* With the workers, return the length of the formatted message. */
+	rc = thr->len - thr->msg_off;
+	if (thr->is_writer) {
+		/* The worker holds drain_lock. */
+		__log_write(thr, level, 1);
+		return rc;
 	}
-	EV_DATA(log_ev, struct log_data)->msg = msg;
-	EV_DATA(log_ev, struct log_data)->level = level;
-	EV_DATA(log_ev, struct log_data)->type = OVIS_LOG_O_LOG;
-	EV_DATA(log_ev, struct log_data)->log = __ovis_log_get(log);
 
-	if (default_modes & OVIS_LOG_M_TS)
-		EV_DATA(log_ev, struct log_data)->tv = tv;
-	else
-		EV_DATA(log_ev, struct log_data)->tm = tm;
-	ev_post(NULL, logger_w, log_ev, NULL);
-out:
-	__ovis_log_put(log); /* Put back the reference taken at the top of the function. */
+	r = log_ring_get(thr);
+	if (!r || thr->len >= LOG_REC_MAX) {
+		/* Write the line after the queued lines. */
+		__log_drain_lock();
+		__log_drain(UINT64_MAX, 0);
+		__log_write(thr, level, 1);
+		pthread_mutex_unlock(&drain_lock);
+		return rc;
+	}
+	if (__log_ring_push(r, thr, log, level)) {
+		/* The ring is full. Drain the rings to make room. */
+		__log_drain_lock();
+		__log_drain(UINT64_MAX, 0);
+		pthread_mutex_unlock(&drain_lock);
+		(void) __log_ring_push(r, thr, log, level);
+	}
+	__log_wake();
 	return rc;
 }
 
@@ -91,6 +91,7 @@ typedef struct ovis_log_s {
 	int level;
 	struct rbn rbn;
 	int ref_count;
+	struct ovis_log_dup_s *dup; /* The recent messages in the dedup mode */
 } *ovis_log_t;
 
 /**
@@ -116,7 +117,16 @@ typedef struct ovis_log_s {
  *  OVIS_LOG_M_TS_NONE Timestamps are not included in log messages.
  *
  * The \c ovis_log_init() call makes \c ovis_log_open, \c ovis_log_close,
- *  \c ovis_log, and \c ovis_vlog asynchronous.
+ *  \c ovis_log, and \c ovis_vlog asynchronous. \c ovis_log() formats the
+ *  message into a buffer of the calling thread, and the log worker writes
+ *  the buffered messages of all threads in batches. The messages are
+ *  written in the order they are logged, except that the messages that
+ *  different threads log at about the same time may be written in either
+ *  order. The buffered messages are written when the application exits.
+ *
+ * If the OVIS_LOG_DEDUP environment variable is set to a number of
+ *  seconds, \c ovis_log_init() enables the dedup mode. See
+ *  \c ovis_log_set_dedup().
  *
  * \param subsys_name	The default log subsystem name, e.g., the application name.
  * \param level		The default log level.
@@ -150,6 +160,26 @@ int ovis_log_init(const char *default_subsys_name, int default_level, int modes)
  */
 void ovis_log_set_mode(int mode);
 
+/**
+ * \brief Collapse the repeated messages of each subsystem
+ *
+ * In the dedup mode, each subsystem remembers its last 8 distinct messages.
+ *  A message that is the same as one of them at the same log level is not
+ *  written. The repeats are counted and reported with the line
+ *  "<subsystem>: message repeated <N> times: <message>", at least every
+ *  \c interval seconds while the message keeps repeating, and when
+ *  \c ovis_log_flush() is called. A subsystem logging the same few
+ *  messages in a loop therefore writes a few lines per \c interval.
+ *
+ * The dedup mode applies to the messages logged after \c ovis_log_init().
+ *
+ * \param interval   The reporting interval in seconds. 0 disables the
+ *                   dedup mode, which is the default.
+ *
+ * \return 0 on success. EINVAL if \c interval is negative.
+ */
+int ovis_log_set_dedup(int interval);
+
 /**
  * \brief Open a log file
  *
@@ -184,8 +214,8 @@ int ovis_log_open(const char *path);
 /**
  * \brief Flush the outstanding messages to the log file
  *
- * \c ovis_log_flush() is equivalent to calling \c fflush().
- *  If the log messages go to Syslog, the function is a no-op.
+ * \c ovis_log_flush() writes the messages buffered by \c ovis_log() and the
+ *  repeats counted in the dedup mode, and then calls \c fflush().
  *
  * \return 0 on success. Otherwise, an errno is returned.
  */
@@ -0,0 +1,261 @@
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <time.h>
+#include <pthread.h>
+#include "ovis_log.h"
+
+/*
+ * ovis_log_test [-f <log file>] [-n <messages>] [-t <max threads>]
+ *               [-d <dedup interval>] [-b]
+ *
+ * Without -b, threads log numbered messages, and the test checks that the
+ * log file has every message once, the messages of each thread in order,
+ * and the message logged after joining the threads last. Then it checks
+ * that the dedup mode collapses a repeated message.
+ *
+ * With -b, 1 to max threads log -n messages in total as fast as they can.
+ * Reports the messages per second, counting until ovis_log_flush() returns.
+ */
+
+static const char *log_path = "ovis_log_test.log";
+static int num_msgs = 1000000;
+static int max_threads = 64;
+static int dedup = 0;
+static int do_bench = 0;
+static ovis_log_t test_log;
+static FILE *out;
+
+struct thread_s {
+	pthread_t thread;
+	int id;
+	int count;
+};
+
+static void *log_proc(void *arg)
+{
+	struct thread_s *t = arg;
+	int i;
+
+	for (i = 0; i < t->count; i++) {
+		if (dedup)
+			ovis_log(test_log, OVIS_LERROR, "Error %d connecting to "
+				 "the producer\n", 111);
+		else
+			ovis_log(test_log, OVIS_LERROR, "thread %d message %d\n",
+				 t->id, i);
+	}
+	return NULL;
+}
+
+static double log_run(int nthreads, int count)
+{
+	struct thread_s *thr;
+	struct timespec start, end;
+	int i;
+
+	thr = calloc(nthreads, sizeof(*thr));
+	if (!thr) {
+		perror("calloc");
+		exit(1);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < nthreads; i++) {
+		thr[i].id = i;
+		thr[i].count = count;
+		pthread_create(&thr[i].thread, NULL, log_proc, &thr[i]);
+	}
+	for (i = 0; i < nthreads; i++)
+		pthread_join(thr[i].thread, NULL);
+	ovis_log_flush();
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	free(thr);
+	return (end.tv_sec - start.tv_sec) +
+		(end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+static void bench(void)
+{
+	double secs;
+	int n;
+
+	fprintf(out, "%8s %12s %10s %14s\n", "threads", "messages", "seconds", "msgs/sec");
+	for (n = 1; n <= max_threads; n *= 2) {
+		if (truncate(log_path, 0))
+			perror(log_path);
+		secs = log_run(n, num_msgs / n);
+		fprintf(out, "%8d %12d %10.3f %14.0f\n", n, (num_msgs / n) * n, secs,
+		       (num_msgs / n) * n / secs);
+	}
+}
+
+static int check_order(int nthreads, int count)
+{
+	char line[256];
+	int *next, id, seq, errors = 0;
+	int joined = 0;
+	FILE *f;
+
+	next = calloc(nthreads, sizeof(*next));
+	f = fopen(log_path, "r");
+	if (!next || !f) {
+		perror(log_path);
+		exit(1);
+	}
+	while (fgets(line, sizeof(line), f)) {
+		char *s = strstr(line, "test: ");
+		if (!s)
+			continue;
+		if (0 == strcmp(s, "test: joined\n")) {
+			joined++;
+			continue;
+		}
+		if (joined) {
+			fprintf(out, "Logged after joined: %s", line);
+			errors++;
+		}
+		if (2 != sscanf(s, "test: thread %d message %d", &id, &seq) ||
+		    id < 0 || id >= nthreads) {
+			fprintf(out, "Unexpected line: %s", line);
+			errors++;
+			continue;
+		}
+		if (seq != next[id]) {
+			fprintf(out, "thread %d: expected message %d, got %d\n",
+			       id, next[id], seq);
+			errors++;
+		}
+		next[id] = seq + 1;
+	}
+	if (joined != 1) {
+		fprintf(out, "%d joined messages\n", joined);
+		errors++;
+	}
+	for (id = 0; id < nthreads; id++) {
+		if (next[id] != count) {
+			fprintf(out, "thread %d: %d of %d messages\n", id, next[id], count);
+			errors++;
+		}
+	}
+	fclose(f);
+	free(next);
+	return errors;
+}
+
+static int check_dedup(int count)
+{
+	char line[256];
+	int msgs = 0, repeats = 0, others = 0, n;
+	FILE *f;
+
+	f = fopen(log_path, "r");
+	if (!f) {
+		perror(log_path);
+		exit(1);
+	}
+	while (fgets(line, sizeof(line), f)) {
+		char *s = strstr(line, "test: ");
+		if (!s)
+			continue;
+		if (1 == sscanf(s, "test: message repeated %d times", &n))
+			repeats += n;
+		else if (strstr(s, "connecting to the producer"))
+			msgs++;
+		else if (strstr(s, "done"))
+			others++;
+	}
+	fclose(f);
+	if (msgs + repeats != count || others != 1 || msgs > 2) {
+		fprintf(out, "dedup: %d messages, %d repeats, %d others\n",
+		       msgs, repeats, others);
+		return 1;
+	}
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int rc, op;
+	int errors;
+
+	while ((op = getopt(argc, argv, "f:n:t:d:b")) != -1) {
+		switch (op) {
+		case 'f':
+			log_path = optarg;
+			break;
+		case 'n':
+			num_msgs = atoi(optarg);
+			break;
+		case 't':
+			max_threads = atoi(optarg);
+			break;
+		case 'd':
+			dedup = atoi(optarg);
+			break;
+		case 'b':
+			do_bench = 1;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-f log_file] [-n messages] "
+				"[-t max_threads] [-d dedup_interval] [-b]\n",
+				argv[0]);
+			exit(1);
+		}
+	}
+
+	rc = ovis_log_init("ovis_log_test", OVIS_LERROR, OVIS_LOG_M_DT);
+	if (rc) {
+		printf("ovis_log_init error %d\n", rc);
+		exit(1);
+	}
+	test_log = ovis_log_register("test", "ovis_log_test messages");
+	if (!test_log) {
+		perror("ovis_log_register");
+		exit(1);
+	}
+	if (truncate(log_path, 0) && errno != ENOENT)
+		perror(log_path);
+	/* The log file replaces stdout. Keep printing to the terminal. */
+	out = fdopen(dup(1), "w");
+	setvbuf(out, NULL, _IOLBF, 0);
+	rc = ovis_log_open(log_path);
+	if (rc) {
+		fprintf(out, "ovis_log_open error %d\n", rc);
+		exit(1);
+	}
+
+	if (do_bench) {
+		if (dedup)
+			ovis_log_set_dedup(dedup);
+		bench();
+		exit(0);
+	}
+
+	(void) log_run(max_threads, num_msgs / max_threads);
+	rc = ovis_log(test_log, OVIS_LERROR, "joined\n");
+	ovis_log_flush();
+	errors = check_order(max_threads, num_msgs / max_threads);
+	fprintf(out, "order: %s\n", errors ? "FAILED" : "PASSED");
+	/* a queued message returns its formatted length */
+	if (rc != strlen("joined\n")) {
+		fprintf(out, "return: expected %zu, got %d\n",
+			strlen("joined\n"), rc);
+		errors++;
+	}
+
+	if (truncate(log_path, 0))
+		perror(log_path);
+	dedup = 1;
+	ovis_log_set_dedup(1);
+	(void) log_run(1, 1000);
+	ovis_log(test_log, OVIS_LERROR, "done\n");
+	ovis_log_flush();
+	rc = check_dedup(1000);
+	fprintf(out, "dedup: %s\n", rc ? "FAILED" : "PASSED");
+	errors += rc;
+
+	return errors ? 1 : 0;
+}
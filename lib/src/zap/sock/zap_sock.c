@@ -55,6 +55,7 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <arpa/inet.h>
@@ -71,6 +72,7 @@
 #include "zap_sock.h"
 
 #define GETTID() syscall(SYS_gettid)
+#define min_t(t, x, y) (t)((t)x < (t)y?(t)x:(t)y)
 
 static ovis_log_t zslog;
 
@@ -131,8 +133,23 @@ static void z_sock_hdr_init(struct sock_msg_hdr *hdr, uint32_t xid,
 			    uint16_t type, uint32_t len, uint64_t ctxt);
 
 static uint32_t z_last_key = 1;
-static struct rbt z_key_tree;
-static pthread_mutex_t z_key_tree_mutex;
+static pthread_mutex_t z_key_alloc_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Map keys are spread over ZAP_SOCK_KEY_SHARDS trees, each protected by its
+ * own rwlock. Read/write requests served by different io threads look up
+ * keys under the read lock, so they neither serialize on a global mutex nor
+ * (mostly) share a lock cache line. Keys are allocated sequentially, so
+ * `key % ZAP_SOCK_KEY_SHARDS` distributes them evenly.
+ */
+struct z_sock_key_shard {
+	pthread_rwlock_t rwlock;
+	struct rbt tree;
+} __attribute__((aligned(64)));
+
+static struct z_sock_key_shard z_key_shard[ZAP_SOCK_KEY_SHARDS];
+
+#define Z_SOCK_KEY_SHARD(key) (&z_key_shard[(key) % ZAP_SOCK_KEY_SHARDS])
 
 static LIST_HEAD(, z_sock_ep) z_sock_list = LIST_HEAD_INITIALIZER(0);
 static pthread_mutex_t z_sock_list_mutex = PTHREAD_MUTEX_INITIALIZER;
@@ -159,34 +176,41 @@ static int z_rbn_cmp(void *a, const void *b)
 static uint32_t z_key_alloc(struct zap_map *map)
 {
 	struct z_sock_key *key;
-	pthread_mutex_lock(&z_key_tree_mutex);
+	struct z_sock_key_shard *shard;
+	uint32_t k;
+	pthread_mutex_lock(&z_key_alloc_mutex);
 	/*
 	 * multiple threads may compete to allocate key for the map. If the key
 	 * has already been allocated by the other thread, just return it.
 	 */
 	if (SOCK_MAP_KEY_GET(map)) {
-		pthread_mutex_unlock(&z_key_tree_mutex);
+		pthread_mutex_unlock(&z_key_alloc_mutex);
 		return SOCK_MAP_KEY_GET(map);
 	}
 	key = calloc(1, sizeof(*key));
 	if (!key) {
-		pthread_mutex_unlock(&z_key_tree_mutex);
+		pthread_mutex_unlock(&z_key_alloc_mutex);
 		return 0;
 	}
 	key->map = map;
-	key->rb_node.key = (void*)(uint64_t)(++z_last_key);
-	if (!key->rb_node.key) /* overflow, get next key */
-		key->rb_node.key = (void*)(uint64_t)(++z_last_key);
-	rbt_ins(&z_key_tree, &key->rb_node);
-	SOCK_MAP_KEY_SET(map, key->rb_node.key);
-	pthread_mutex_unlock(&z_key_tree_mutex);
+	k = ++z_last_key;
+	if (!k) /* overflow, get next key */
+		k = ++z_last_key;
+	key->rb_node.key = (void*)(uint64_t)k;
+	shard = Z_SOCK_KEY_SHARD(k);
+	pthread_rwlock_wrlock(&shard->rwlock);
+	rbt_ins(&shard->tree, &key->rb_node);
+	pthread_rwlock_unlock(&shard->rwlock);
+	SOCK_MAP_KEY_SET(map, k);
+	pthread_mutex_unlock(&z_key_alloc_mutex);
 	return SOCK_MAP_KEY_GET(map);
 }
 
-/* Caller must hold the z_key_tree_mutex lock. */
-static struct z_sock_key *z_sock_key_find(uint32_t key)
+/* Caller must hold the lock of the shard of `key`. */
+static struct z_sock_key *z_sock_key_find(struct z_sock_key_shard *shard,
+					  uint32_t key)
 {
-	struct rbn *krbn = rbt_find(&z_key_tree, (void*)(uint64_t)key);
+	struct rbn *krbn = rbt_find(&shard->tree, (void*)(uint64_t)key);
 	if (!krbn)
 		return NULL;
 	return container_of(krbn, struct z_sock_key, rb_node);
@@ -195,14 +219,15 @@ static struct z_sock_key *z_sock_key_find(uint32_t key)
 static void z_sock_key_delete(uint32_t key)
 {
 	struct z_sock_key *k;
-	pthread_mutex_lock(&z_key_tree_mutex);
-	k = z_sock_key_find(key);
+	struct z_sock_key_shard *shard = Z_SOCK_KEY_SHARD(key);
+	pthread_rwlock_wrlock(&shard->rwlock);
+	k = z_sock_key_find(shard, key);
 	if (!k)
 		goto out;
-	rbt_del(&z_key_tree, &k->rb_node);
+	rbt_del(&shard->tree, &k->rb_node);
 	free(k);
 out:
-	pthread_mutex_unlock(&z_key_tree_mutex);
+	pthread_rwlock_unlock(&shard->rwlock);
 }
 
 /**
@@ -213,15 +238,24 @@ out:
  * \param sz The size of the accessing memory.
  * \param acc Access flags.
  *
- * The Caller must hold the z_key_tree_mutex lock.
+ * The key shard is read-locked for the duration of the lookup and the
+ * validation, so concurrent callers only exclude z_key_alloc() and
+ * z_sock_key_delete() on the same shard.
  */
 static int z_sock_map_key_access_validate(uint32_t key, char *p, size_t sz,
 				zap_access_t acc)
 {
-	struct z_sock_key *k = z_sock_key_find(key);
+	struct z_sock_key_shard *shard = Z_SOCK_KEY_SHARD(key);
+	struct z_sock_key *k;
+	int rc;
+	pthread_rwlock_rdlock(&shard->rwlock);
+	k = z_sock_key_find(shard, key);
 	if (!k)
-		return ENOENT;
-	return z_map_access_validate((zap_map_t)k->map, p, sz, acc);
+		rc = ENOENT;
+	else
+		rc = z_map_access_validate((zap_map_t)k->map, p, sz, acc);
+	pthread_rwlock_unlock(&shard->rwlock);
+	return rc;
 }
 
 static int __sock_nonblock(int fd)
@@ -632,11 +666,8 @@ static void process_sep_msg_read_req(struct z_sock_ep *sep)
 	data_len = ntohl(msg->data_len);
 	src = (char *)be64toh(msg->src_ptr);
 
-	int rc = 0;
-	pthread_mutex_lock(&z_key_tree_mutex);
-	rc = z_sock_map_key_access_validate(msg->src_map_key, src, data_len,
-				       ZAP_ACCESS_READ);
-	pthread_mutex_unlock(&z_key_tree_mutex);
+	int rc = z_sock_map_key_access_validate(msg->src_map_key, src, data_len,
+					       ZAP_ACCESS_READ);
 	/*
 	 * The data the other side receives could be garbage
 	 * if the map is deleted after this point.
@@ -668,18 +699,50 @@ static void process_sep_msg_read_req(struct z_sock_ep *sep)
 		shutdown(sep->sock, SHUT_RDWR);
 }
 
-struct z_sock_send_wr_s *__sock_wr_alloc(size_t data_len, struct z_sock_io *io)
+/*
+ * Work requests and io entries are recycled through per-endpoint free lists.
+ * All allocations and releases happen under `sep->ep.lock` (or after the
+ * endpoint has lost its last reference), so the lists need no extra locking.
+ * WRs are cached only if they were allocated with the standard inline
+ * capacity; larger ones (big sends) go straight back to the heap.
+ */
+
+/* caller must hold sep->ep.lock */
+struct z_sock_send_wr_s *__sock_wr_alloc(struct z_sock_ep *sep,
+					 size_t data_len, struct z_sock_io *io)
 {
 	struct z_sock_send_wr_s *wr;
-	wr = calloc(1, sizeof(*wr) + data_len);
-	if (!wr)
-		return NULL;
+	if (data_len <= ZAP_SOCK_WR_INLINE_SZ) {
+		wr = TAILQ_FIRST(&sep->wr_free_q);
+		if (wr) {
+			TAILQ_REMOVE(&sep->wr_free_q, wr, link);
+			sep->wr_free_cnt--;
+			memset(wr, 0, sizeof(*wr));
+		} else {
+			wr = calloc(1, sizeof(*wr) + ZAP_SOCK_WR_INLINE_SZ);
+			if (!wr)
+				return NULL;
+		}
+		wr->buf_len = ZAP_SOCK_WR_INLINE_SZ;
+	} else {
+		wr = calloc(1, sizeof(*wr) + data_len);
+		if (!wr)
+			return NULL;
+		wr->buf_len = data_len;
+	}
 	wr->io = io;
 	return wr;
 }
 
-void __sock_wr_free(struct z_sock_send_wr_s *wr)
+/* caller must hold sep->ep.lock */
+void __sock_wr_free(struct z_sock_ep *sep, struct z_sock_send_wr_s *wr)
 {
+	if (wr->buf_len == ZAP_SOCK_WR_INLINE_SZ &&
+	    sep->wr_free_cnt < ZAP_SOCK_POOL_MAX) {
+		TAILQ_INSERT_HEAD(&sep->wr_free_q, wr, link);
+		sep->wr_free_cnt++;
+		return;
+	}
 	free(wr);
 }
 
@@ -687,16 +750,43 @@ void __sock_wr_free(struct z_sock_send_wr_s *wr)
 static inline
 struct z_sock_io *__sock_io_alloc(struct z_sock_ep *sep)
 {
-	return calloc(1, sizeof(struct z_sock_io));
+	struct z_sock_io *io = TAILQ_FIRST(&sep->io_free_q);
+	if (!io)
+		return calloc(1, sizeof(struct z_sock_io));
+	TAILQ_REMOVE(&sep->io_free_q, io, q_link);
+	sep->io_free_cnt--;
+	memset(io, 0, sizeof(*io));
+	return io;
 }
 
 /* caller must hold sep->ep.lock */
 static inline
 void __sock_io_free(struct z_sock_ep *sep, struct z_sock_io *io)
 {
+	if (sep->io_free_cnt < ZAP_SOCK_POOL_MAX) {
+		TAILQ_INSERT_HEAD(&sep->io_free_q, io, q_link);
+		sep->io_free_cnt++;
+		return;
+	}
 	free(io);
 }
 
+/* Release the cached WRs and io entries */
+static void __sock_pool_cleanup(struct z_sock_ep *sep)
+{
+	struct z_sock_send_wr_s *wr;
+	struct z_sock_io *io;
+	while ((wr = TAILQ_FIRST(&sep->wr_free_q))) {
+		TAILQ_REMOVE(&sep->wr_free_q, wr, link);
+		free(wr);
+	}
+	while ((io = TAILQ_FIRST(&sep->io_free_q))) {
+		TAILQ_REMOVE(&sep->io_free_q, io, q_link);
+		free(io);
+	}
+	sep->wr_free_cnt = sep->io_free_cnt = 0;
+}
+
 /**
  * Receiving a read response message.
  */
@@ -790,10 +880,8 @@ static void process_sep_msg_write_req(struct z_sock_ep *sep)
 			sizeof(rmsg), msg->hdr.ctxt);
 
 	/* Validate */
-	pthread_mutex_lock(&z_key_tree_mutex);
 	int rc = z_sock_map_key_access_validate(msg->dst_map_key, dst, data_len,
 					     ZAP_ACCESS_WRITE);
-	pthread_mutex_unlock(&z_key_tree_mutex);
 
 	switch (rc) {
 	case 0:
@@ -1234,11 +1322,43 @@ static void sock_send_complete(struct epoll_event *ev)
 	}
 }
 
-/* sep->ep.lock is held */
+/* A WR has been completely written, sep->ep.lock is held */
+static void __sock_wr_done(struct z_sock_ep *sep, z_sock_send_wr_t wr)
+{
+	TAILQ_REMOVE(&sep->sq, wr, link);
+	if (sep->ep.thread)
+		__atomic_fetch_sub(&sep->ep.thread->stat->sq_sz, 1, __ATOMIC_SEQ_CST);
+	__atomic_fetch_sub(&sep->ep.sq_sz, 1, __ATOMIC_SEQ_CST);
+	if (wr->flags & Z_SOCK_WR_COMPLETION) {
+		/* right now we have only SEND_COMPLETE delivering by WR */
+		assert(ntohs(wr->msg.hdr.msg_type) == SOCK_MSG_SENDRECV);
+		TAILQ_REMOVE(&sep->io_q, wr->io, q_link);
+		TAILQ_INSERT_TAIL(&sep->io_cq, wr->io, q_link);
+	}
+	if (wr->io) {
+		/* record xid */
+		wr->io->xid = wr->msg.hdr.xid;
+		wr->io->wr = NULL;
+	}
+	__sock_wr_free(sep, wr);
+}
+
+/*
+ * sep->ep.lock is held
+ *
+ * The message and data of the queued WRs are gathered into one iovec array
+ * and written with a single sendmsg(). The number of bytes written is then
+ * consumed from the head of the send queue; a partially written WR stays at
+ * the head with its `msg_len`/`data_len`/`off` advanced.
+ */
 static void sock_write(struct epoll_event *ev)
 {
 	struct z_sock_ep *sep = ev->data.ptr;
+	struct iovec iov[ZAP_SOCK_IOV_MAX];
+	struct msghdr mh = { .msg_iov = iov };
 	ssize_t wsz;
+	size_t len, sz, total;
+	int n;
 	z_sock_send_wr_t wr;
 
  next:
@@ -1252,61 +1372,62 @@ static void sock_write(struct epoll_event *ev)
 		goto out;
 	}
 
-	/* msg */
-	while (wr->msg_len) {
-		wsz = send(sep->sock, wr->msg.bytes + wr->off, wr->msg_len, MSG_NOSIGNAL);
-		if (wsz < 0) {
-			if (errno == EAGAIN || errno == EWOULDBLOCK) {
-				__enable_epoll_out(sep);
-				goto out;
-			}
-			/* otherwise, bad error */
-			goto err;
+	/* `off` is the offset into msg while msg_len != 0, then into data */
+	n = 0;
+	total = 0;
+	for (; wr && n <= ZAP_SOCK_IOV_MAX - 2; wr = TAILQ_NEXT(wr, link)) {
+		if (wr->msg_len) {
+			iov[n].iov_base = wr->msg.bytes + wr->off;
+			iov[n].iov_len = wr->msg_len;
+			total += wr->msg_len;
+			n++;
+		}
+		if (wr->data_len) {
+			iov[n].iov_base = (char *)wr->data +
+					  (wr->msg_len ? 0 : wr->off);
+			iov[n].iov_len = wr->data_len;
+			total += wr->data_len;
+			n++;
 		}
-		DEBUG_LOG(sep, "%ld ep: %p, wrote %ld bytes\n", GETTID(), sep, wsz);
-		wr->msg_len -= wsz;
-		if (!wr->msg_len)
-			wr->off = 0; /* reset off for data */
-		else
-			wr->off += wsz;
 	}
-
-	/* data, wr->msg_len is already 0 */
-	assert(wr->msg_len == 0);
-	while (wr->data_len) {
-		wsz = send(sep->sock, wr->data + wr->off, wr->data_len, MSG_NOSIGNAL);
-		if (wsz < 0) {
-			if (errno == EAGAIN || errno == EWOULDBLOCK) {
-				__enable_epoll_out(sep);
-				goto out;
-			}
-			/* otherwise bad error */
-			goto err;
+	mh.msg_iovlen = n;
+	wsz = sendmsg(sep->sock, &mh, MSG_NOSIGNAL);
+	if (wsz < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK) {
+			__enable_epoll_out(sep);
+			goto out;
 		}
-		DEBUG_LOG(sep, "%ld ep: %p, wrote %ld bytes\n", GETTID(), sep, wsz);
-		wr->data_len -= wsz;
-		wr->off += wsz;
+		/* otherwise, bad error */
+		goto err;
 	}
-
-	/* reaching here means wr->data_len and wr->msg_len are 0 */
-	assert(0 == wr->data_len);
-	assert(0 == wr->msg_len);
-	TAILQ_REMOVE(&sep->sq, wr, link);
-	if (sep->ep.thread)
-		__atomic_fetch_sub(&sep->ep.thread->stat->sq_sz, 1, __ATOMIC_SEQ_CST);
-	__atomic_fetch_sub(&sep->ep.sq_sz, 1, __ATOMIC_SEQ_CST);
-	if (wr->flags & Z_SOCK_WR_COMPLETION) {
-		/* right now we have only SEND_COMPLETE delivering by WR */
-		assert(ntohs(wr->msg.hdr.msg_type) == SOCK_MSG_SENDRECV);
-		TAILQ_REMOVE(&sep->io_q, wr->io, q_link);
-		TAILQ_INSERT_TAIL(&sep->io_cq, wr->io, q_link);
+	DEBUG_LOG(sep, "%ld ep: %p, wrote %ld bytes\n", GETTID(), sep, wsz);
+
+	len = wsz;
+	while ((wr = TAILQ_FIRST(&sep->sq)) && len) {
+		if (wr->msg_len) {
+			sz = min_t(size_t, len, wr->msg_len);
+			wr->msg_len -= sz;
+			len -= sz;
+			if (!wr->msg_len)
+				wr->off = 0; /* reset off for data */
+			else
+				wr->off += sz;
+		}
+		if (!wr->msg_len && wr->data_len) {
+			sz = min_t(size_t, len, wr->data_len);
+			wr->data_len -= sz;
+			wr->off += sz;
+			len -= sz;
+		}
+		if (wr->msg_len || wr->data_len)
+			break; /* partially written */
+		__sock_wr_done(sep, wr);
 	}
-	if (wr->io) {
-		/* record xid */
-		wr->io->xid = wr->msg.hdr.xid;
-		wr->io->wr = NULL;
+	if ((size_t)wsz < total) {
+		/* short write, the socket buffer is full */
+		__enable_epoll_out(sep);
+		goto out;
 	}
-	__sock_wr_free(wr);
 	goto next;
 
  out:
@@ -1316,7 +1437,6 @@ static void sock_write(struct epoll_event *ev)
 	shutdown(sep->sock, SHUT_RDWR);
 }
 
-#define min_t(t, x, y) (t)((t)x < (t)y?(t)x:(t)y)
 static void sock_read(z_sock_io_thread_t thr, struct epoll_event *ev)
 {
 	struct z_sock_ep *sep = ev->data.ptr;
@@ -1548,10 +1668,18 @@ static int __disable_epoll_out(struct z_sock_ep *sep)
 static void __wr_post(struct z_sock_ep *sep, z_sock_send_wr_t wr)
 {
 	struct epoll_event ev = { .events = EPOLLOUT, .data.ptr = sep };
+	int busy = !TAILQ_EMPTY(&sep->sq) && (sep->ev.events & EPOLLOUT);
 	TAILQ_INSERT_TAIL(&sep->sq, wr, link);
 	__atomic_fetch_add(&sep->ep.sq_sz, 1, __ATOMIC_SEQ_CST);
 	if (sep->ep.thread)
 		__atomic_fetch_add(&sep->ep.thread->stat->sq_sz, 1, __ATOMIC_SEQ_CST);
+	/*
+	 * If earlier WRs are still waiting for EPOLLOUT, the socket buffer is
+	 * full. Leave the new WR to be gathered with them by the io thread
+	 * rather than issuing a send that would just return EAGAIN.
+	 */
+	if (busy)
+		return;
 	sock_write(&ev);
 }
 
@@ -1570,7 +1698,7 @@ static zap_err_t __sock_send_msg_nolock(struct z_sock_ep *sep,
 	/* allocate send wr */
 	if (mtype == SOCK_MSG_READ_RESP) {
 		/* allow big message, and do not copy `data`  */
-		wr = __sock_wr_alloc(0, NULL);
+		wr = __sock_wr_alloc(sep, 0, NULL);
 		if (!wr)
 			return ZAP_ERR_RESOURCE;
 		wr->msg_len = msg_size;
@@ -1584,7 +1712,7 @@ static zap_err_t __sock_send_msg_nolock(struct z_sock_ep *sep,
 				  GETTID(), sep, data_len);
 			return ZAP_ERR_NO_SPACE;
 		}
-		wr = __sock_wr_alloc(data_len, NULL);
+		wr = __sock_wr_alloc(sep, data_len, NULL);
 		if (!wr)
 			return ZAP_ERR_RESOURCE;
 		wr->msg_len = msg_size + data_len;
@@ -1829,7 +1957,7 @@ static zap_err_t z_sock_send2(zap_ep_t ep, char *buf, size_t len, void *cb_arg)
 	io->comp_type = ZAP_EVENT_SEND_COMPLETE;
 	io->ctxt = cb_arg;
 
-	io->wr = __sock_wr_alloc(len, io);
+	io->wr = __sock_wr_alloc(sep, len, io);
 	if (!io->wr) {
 		zerr = ZAP_ERR_RESOURCE;
 		goto err1;
@@ -1896,7 +2024,7 @@ zap_err_t z_sock_send_mapped(zap_ep_t ep, zap_map_t map, void *buf,
 	io->comp_type = ZAP_EVENT_SEND_MAPPED_COMPLETE;
 	io->ctxt = context;
 
-	io->wr = __sock_wr_alloc(0, io);
+	io->wr = __sock_wr_alloc(sep, 0, io);
 	if (!io->wr) {
 		zerr = ZAP_ERR_RESOURCE;
 		goto err1;
@@ -1928,6 +2056,7 @@ err0:
 static int init_once()
 {
 	static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+	int i;
 
 	pthread_mutex_lock(&mutex);
 	/* check if we lose the race */
@@ -1938,9 +2067,10 @@ static int init_once()
 
 	pthread_atfork(NULL, NULL, (void*)z_sock_atfork);
 
-	z_key_tree.root = NULL;
-	z_key_tree.comparator = z_rbn_cmp;
-	pthread_mutex_init(&z_key_tree_mutex, NULL);
+	for (i = 0; i < ZAP_SOCK_KEY_SHARDS; i++) {
+		rbt_init(&z_key_shard[i].tree, z_rbn_cmp);
+		pthread_rwlock_init(&z_key_shard[i].rwlock, NULL);
+	}
 
 	zslog = ovis_log_register("xprt.zap.sock", "Messages for zap_sock");
 	if (!zslog) {
@@ -1969,6 +2099,8 @@ static zap_ep_t z_sock_new(zap_t z, zap_cb_fn_t cb)
 	TAILQ_INIT(&sep->io_q);
 	TAILQ_INIT(&sep->io_cq);
 	TAILQ_INIT(&sep->sq);
+	TAILQ_INIT(&sep->wr_free_q);
+	TAILQ_INIT(&sep->io_free_q);
 	sep->sock = -1;
 	pthread_cond_init(&sep->sq_cond, NULL);
 
@@ -2003,6 +2135,7 @@ static void z_sock_destroy(zap_ep_t ep)
 		TAILQ_REMOVE(&sep->sq, wr, link);
 		free(wr);
 	}
+	__sock_pool_cleanup(sep);
 
 	if (sep->conn_data)
 		free(sep->conn_data);
@@ -2163,7 +2296,7 @@ static zap_err_t z_sock_read(zap_ep_t ep, zap_map_t src_map, char *src,
 	io->comp_type = ZAP_EVENT_READ_COMPLETE;
 	io->ctxt = context;
 
-	io->wr = __sock_wr_alloc(0, io);
+	io->wr = __sock_wr_alloc(sep, 0, io);
 	if (!io->wr) {
 		zerr = ZAP_ERR_RESOURCE;
 		goto err1;
@@ -2227,7 +2360,7 @@ static zap_err_t z_sock_write(zap_ep_t ep, zap_map_t src_map, char *src,
 	io->comp_type = ZAP_EVENT_WRITE_COMPLETE;
 	io->ctxt = context;
 
-	io->wr = __sock_wr_alloc(0, io);
+	io->wr = __sock_wr_alloc(sep, 0, io);
 	if (!io->wr) {
 		zerr = ZAP_ERR_RESOURCE;
 		goto err1;
@@ -87,6 +87,39 @@
  */
 #define ZAP_SOCK_KEEPINTVL 2
 
+/**
+ * \brief Number of shards of the map key table.
+ *
+ * Each shard has its own rwlock so that io threads validating read and write
+ * requests against different maps do not contend.
+ */
+#define ZAP_SOCK_KEY_SHARDS 64
+
+/**
+ * \brief Maximum number of I/O vectors gathered in one \c sendmsg() call.
+ *
+ * Each send work request contributes up to two vectors (the message header
+ * and the message data), so one call can flush up to half this many queued
+ * work requests.
+ */
+#define ZAP_SOCK_IOV_MAX 64
+
+/**
+ * \brief Inline data capacity of a pooled send work request.
+ *
+ * Work requests carrying no more than this many bytes of copied data (all
+ * control messages, read/write requests and small sends) are recycled
+ * through the endpoint free list instead of being allocated for each
+ * message.
+ */
+#define ZAP_SOCK_WR_INLINE_SZ 256
+
+/**
+ * \brief Maximum number of idle work requests (and I/O entries) kept in the
+ * endpoint free lists.
+ */
+#define ZAP_SOCK_POOL_MAX 64
+
 struct z_sock_key {
 	struct rbn rb_node;
 	struct zap_map *map; /**< reference to zap_map */
@@ -248,6 +281,7 @@ typedef struct z_sock_send_wr_s {
 	size_t off; /* offset of msg or data */
 	const char *data;
 	int flags; /* various wr flags */
+	size_t buf_len; /* inline data capacity allocated after msg */
 	union sock_msg_u msg; /* The message */
 } *z_sock_send_wr_t;
 
@@ -296,6 +330,10 @@ struct z_sock_ep {
 	TAILQ_HEAD(, z_sock_io) io_q; /* manages ops from app (read/write/send) */
 	TAILQ_HEAD(, z_sock_io) io_cq; /* completion queue, currently serves only send completion */
 	TAILQ_HEAD(, z_sock_send_wr_s) sq; /* send queue */
+	TAILQ_HEAD(, z_sock_send_wr_s) wr_free_q; /* idle pooled WRs */
+	TAILQ_HEAD(, z_sock_io) io_free_q; /* idle io entries */
+	int wr_free_cnt;
+	int io_free_cnt;
 	LIST_ENTRY(z_sock_ep) link;
 	pthread_cond_t sq_cond;
 };
@@ -0,0 +1,486 @@
+/* -*- c-basic-offset: 8 -*-
+ * Copyright (c) 2026 National Technology & Engineering Solutions
+ * of Sandia, LLC (NTESS). Under the terms of Contract DE-NA0003525 with
+ * NTESS, the U.S. Government retains certain rights in this software.
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file zap_test_read_contention.c
+ *
+ * Measure the rate of small zap reads served by a zap server when many
+ * connections (hence many server io threads) issue reads concurrently. Every
+ * read request makes the server validate the remote map key, so this exposes
+ * contention on the server's map key lookup.
+ *
+ * To test, run two processes of the test program as follows:
+ * ```
+ * # run server with NUM_SETS sets (memory regions, default 1024). The number
+ * # of server io threads is controlled by ZAP_IO_MAX (default: nprocs).
+ * $ zap_test_read_contention -p PORT -x XPRT [-n NUM_SETS] -s
+ *
+ * # run client with NUM_CONN connections, each keeping DEPTH reads in flight,
+ * # for SEC seconds. The NUM_SETS must be the same as that of the server.
+ * $ zap_test_read_contention -h HOST -p PORT -x XPRT [-n NUM_SETS] \
+ *                            [-c NUM_CONN] [-d DEPTH] [-t SEC]
+ * ```
+ *
+ * The client prints the aggregate number of reads per second.
+ */
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <getopt.h>
+#include <stdlib.h>
+#include <sys/errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <pthread.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <assert.h>
+#include <time.h>
+#include "zap.h"
+
+#ifdef NDEBUG
+#define ASSERT(COND) do { \
+	if (COND) \
+		break; \
+	printf("assert(" #COND ") failed.\n"); \
+	exit(-1); \
+} while (0)
+#else
+#define ASSERT(COND) assert(COND)
+#endif
+
+#define SET_SZ 64
+
+#pragma pack(push, 4)
+enum msg_type {
+	DIR_REQ,
+	DIR_REP,
+};
+
+/* base of all messages */
+struct msg {
+	enum msg_type type;
+};
+
+struct msg_dir_req {
+	struct msg msg;
+	int    num_sets;
+};
+
+struct msg_dir_rep {
+	struct msg  msg;
+	int         idx; /* set index */
+	void        *addr;
+	int         len;
+};
+
+typedef union msg_u {
+	struct msg         msg;
+	struct msg_dir_req dir_req;
+	struct msg_dir_rep dir_rep;
+} *msg_t;
+#pragma pack(pop)
+
+struct remote_set_desc {
+	zap_map_t map;
+	void      *addr;
+	int       len;
+};
+
+/* A client connection */
+struct conn {
+	zap_ep_t ep;
+	int idx;
+	int n_rendezvous;
+	int next; /* next set to read */
+	struct remote_set_desc *rsets;
+	char *buf; /* read destination */
+	zap_map_t lmap;
+};
+
+zap_t zap;
+char *sets;
+zap_map_t *lmaps;
+struct conn *conns;
+
+int num_sets = 1024;
+int num_conn = 4;
+int depth = 16;
+int duration = 10;
+int stop = 0;
+int ready = 0;
+uint64_t reads = 0;
+struct zap_mem_info meminfo;
+pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+
+const char *xprt = NULL;
+const char *host = NULL;
+
+zap_mem_info_t test_meminfo(void)
+{
+	return &meminfo;
+}
+
+void on_server_recv(zap_ep_t ep, zap_event_t ev)
+{
+	zap_err_t err;
+	int i;
+	struct msg_dir_rep rep = { .msg.type = DIR_REP };
+	msg_t msg = (void*)ev->data;
+	/* expecting only DIR_REQ */
+	ASSERT( ev->data_len == sizeof(msg->dir_req) );
+	ASSERT( msg->msg.type == DIR_REQ );
+	ASSERT( msg->dir_req.num_sets == num_sets );
+	for (i = 0; i < num_sets; i++) {
+		rep.idx = i;
+		rep.addr = sets + i * SET_SZ;
+		rep.len  = SET_SZ;
+		err = zap_share(ep, lmaps[i], (void*)&rep, sizeof(rep));
+		ASSERT( err == ZAP_ERR_OK );
+	}
+}
+
+void server_cb(zap_ep_t ep, zap_event_t ev)
+{
+	zap_err_t err;
+
+	switch (ev->type) {
+	case ZAP_EVENT_CONNECT_REQUEST:
+		err = zap_accept(ep, server_cb, NULL, 0);
+		ASSERT( err == ZAP_ERR_OK ); /* zap_accept */
+		break;
+	case ZAP_EVENT_CONNECTED:
+	case ZAP_EVENT_DISCONNECTED:
+	case ZAP_EVENT_SEND_COMPLETE:
+	case ZAP_EVENT_SEND_MAPPED_COMPLETE:
+		/* no-op */
+		break;
+	case ZAP_EVENT_RECV_COMPLETE:
+		on_server_recv(ep, ev);
+		break;
+	default:
+		printf("Unexpected Zap event %s\n", zap_event_str(ev->type));
+		ASSERT(0); /* unexpected event */
+	}
+}
+
+void do_server(zap_t zap, struct sockaddr_in *sin)
+{
+	zap_err_t err;
+	zap_ep_t ep;
+
+	ep = zap_new(zap, server_cb);
+	ASSERT( ep != NULL ); /* zap_new */
+	err = zap_listen(ep, (struct sockaddr *)sin, sizeof(*sin));
+	ASSERT( err == ZAP_ERR_OK ); /* zap_listen */
+	while (1)
+		sleep(60);
+}
+
+/* Issue the next read on the connection; return 0 if the client is done. */
+int conn_read_next(struct conn *c)
+{
+	zap_err_t err;
+	struct remote_set_desc *r;
+	int i;
+
+	if (__atomic_load_n(&stop, __ATOMIC_SEQ_CST))
+		return 0;
+	i = c->next;
+	c->next = (c->next + 1) % num_sets;
+	r = &c->rsets[i];
+	err = zap_read(c->ep, r->map, r->addr, c->lmap,
+		       c->buf + (i % depth) * SET_SZ, SET_SZ, c);
+	ASSERT( err == ZAP_ERR_OK ); /* zap_read */
+	return 1;
+}
+
+void on_client_rendezvous(zap_ep_t ep, zap_event_t ev)
+{
+	struct conn *c = zap_get_ucontext(ep);
+	struct msg_dir_rep *rep = (void*)ev->data;
+	int i;
+	ASSERT( ev->status == ZAP_ERR_OK );
+	ASSERT( ev->data_len == sizeof(*rep) );
+	ASSERT( rep->msg.type == DIR_REP );
+
+	i = rep->idx;
+	c->rsets[i].map  = ev->map;
+	c->rsets[i].addr = rep->addr;
+	c->rsets[i].len  = rep->len;
+	if (++c->n_rendezvous < num_sets)
+		return;
+	pthread_mutex_lock(&mutex);
+	ready++;
+	pthread_cond_signal(&cond);
+	pthread_mutex_unlock(&mutex);
+}
+
+void client_cb(zap_ep_t ep, zap_event_t ev)
+{
+	struct conn *c = zap_get_ucontext(ep);
+	struct msg_dir_req req = { .msg.type = DIR_REQ, .num_sets = num_sets };
+	zap_err_t err;
+
+	switch (ev->type) {
+	case ZAP_EVENT_CONNECTED:
+		err = zap_send(ep, (void*)&req, sizeof(req));
+		ASSERT( err == ZAP_ERR_OK );
+		break;
+	case ZAP_EVENT_RENDEZVOUS:
+		on_client_rendezvous(ep, ev);
+		break;
+	case ZAP_EVENT_READ_COMPLETE:
+		ASSERT( ev->status == ZAP_ERR_OK );
+		__atomic_fetch_add(&reads, 1, __ATOMIC_SEQ_CST);
+		conn_read_next(c);
+		break;
+	case ZAP_EVENT_SEND_MAPPED_COMPLETE:
+	case ZAP_EVENT_SEND_COMPLETE:
+	case ZAP_EVENT_DISCONNECTED:
+		/* no-op */
+		break;
+	default:
+		printf("Unexpected Zap event %s\n", zap_event_str(ev->type));
+		ASSERT(0);
+	}
+}
+
+void do_client(zap_t zap, struct sockaddr_in *sin)
+{
+	zap_err_t err;
+	struct conn *c;
+	struct timespec t0, t1;
+	uint64_t n0, n1;
+	double dt;
+	int i, j;
+
+	conns = calloc(num_conn, sizeof(*conns));
+	ASSERT( conns != NULL );
+	for (i = 0; i < num_conn; i++) {
+		c = &conns[i];
+		c->idx = i;
+		c->next = (i * num_sets) / num_conn;
+		c->rsets = calloc(num_sets, sizeof(c->rsets[0]));
+		ASSERT( c->rsets != NULL );
+		c->buf = malloc(depth * SET_SZ);
+		ASSERT( c->buf != NULL );
+		err = zap_map(&c->lmap, c->buf, depth * SET_SZ,
+			      ZAP_ACCESS_READ|ZAP_ACCESS_WRITE);
+		ASSERT( err == ZAP_ERR_OK ); /* zap_map */
+		c->ep = zap_new(zap, client_cb);
+		ASSERT( c->ep != NULL ); /* zap_new */
+		zap_set_ucontext(c->ep, c);
+		err = zap_connect(c->ep, (struct sockaddr *)sin, sizeof(*sin),
+				  NULL, 0);
+		ASSERT( err == ZAP_ERR_OK ); /* zap_connect */
+	}
+
+	pthread_mutex_lock(&mutex);
+	while (ready < num_conn)
+		pthread_cond_wait(&cond, &mutex);
+	pthread_mutex_unlock(&mutex);
+	printf("%d connections, %d sets, %d reads in flight per connection\n",
+	       num_conn, num_sets, depth);
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	n0 = __atomic_load_n(&reads, __ATOMIC_SEQ_CST);
+	for (i = 0; i < num_conn; i++) {
+		for (j = 0; j < depth; j++)
+			conn_read_next(&conns[i]);
+	}
+	sleep(duration);
+	n1 = __atomic_load_n(&reads, __ATOMIC_SEQ_CST);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	__atomic_store_n(&stop, 1, __ATOMIC_SEQ_CST);
+
+	dt = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+	printf("%" PRIu64 " reads in %.3f sec: %.1f reads/sec\n",
+	       n1 - n0, dt, (n1 - n0) / dt);
+	sleep(1); /* let outstanding reads drain */
+	for (i = 0; i < num_conn; i++)
+		zap_close(conns[i].ep);
+}
+
+int resolve(const char *hostname, struct sockaddr_in *sin)
+{
+	struct hostent *h;
+
+	h = gethostbyname(hostname);
+	if (!h) {
+		printf("Error resolving hostname '%s'\n", hostname);
+		return -1;
+	}
+
+	if (h->h_addrtype != AF_INET) {
+		printf("Hostname '%s' resolved to an unsupported"
+				" address family\n", hostname);
+		return -1;
+	}
+
+	memset(sin, 0, sizeof *sin);
+	sin->sin_addr.s_addr = *(unsigned int *)(h->h_addr_list[0]);
+	sin->sin_family = h->h_addrtype;
+	return 0;
+}
+
+#define FMT_ARGS "x:p:h:sn:c:d:t:"
+void usage(int argc, char *argv[]) {
+	printf("usage: %s -x name -p port_no [-h host] [-s] [-n NUM_SETS]\n"
+	       "          [-c NUM_CONN] [-d DEPTH] [-t SEC]\n"
+	       "    -x name	The transport to use.\n"
+	       "    -p port_no	The port number.\n"
+	       "    -h host	The host name or IP address. Must be specified\n"
+	       "		if this is the client.\n"
+	       "    -s		This is a server.\n"
+	       "    -n NUM_SETS	The number of sets (default: 1024).\n"
+	       "    -c NUM_CONN	The number of client connections (default: 4).\n"
+	       "    -d DEPTH	The number of reads in flight per connection\n"
+	       "		(default: 16).\n"
+	       "    -t SEC	The duration of the test (default: 10).\n"
+	       ,
+	       argv[0]);
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	int rc;
+	int is_server = 0;
+	unsigned short port_no = 0;
+	int i, ptmp = -1;
+	struct sockaddr_in sin = {};
+	zap_err_t err;
+
+	setbuf(stdout, NULL);
+
+	while (-1 != (rc = getopt(argc, argv, FMT_ARGS))) {
+		switch (rc) {
+		case 's':
+			is_server = 1;
+			break;
+		case 'h':
+			host = optarg;
+			break;
+		case 'x':
+			xprt = optarg;
+			break;
+		case 'p':
+			ptmp = atoi(optarg);
+			if (ptmp > 0 && ptmp < USHRT_MAX) {
+				port_no = ptmp;
+			}
+			break;
+		case 'n':
+			num_sets = atoi(optarg);
+			break;
+		case 'c':
+			num_conn = atoi(optarg);
+			break;
+		case 'd':
+			depth = atoi(optarg);
+			break;
+		case 't':
+			duration = atoi(optarg);
+			break;
+		default:
+			usage(argc, argv);
+			break;
+		}
+	}
+	if (!xprt)
+		usage(argc, argv);
+
+	if (port_no == 0)
+		usage(argc, argv);
+
+	if (!is_server && !host)
+		usage(argc, argv);
+
+	if (num_sets <= 0 || num_conn <= 0 || depth <= 0 || duration <= 0)
+		usage(argc, argv);
+
+	memset(&sin, 0, sizeof sin);
+	if (host) {
+		if (resolve(host, &sin))
+			usage(argc, argv);
+	} else
+		sin.sin_family = AF_INET;
+	sin.sin_port = htons(port_no);
+
+	sets = calloc(num_sets, SET_SZ);
+	ASSERT(sets != NULL);
+	meminfo.start = sets;
+	meminfo.len = num_sets * SET_SZ;
+
+	zap = zap_get(xprt, test_meminfo);
+	if (!zap) {
+		printf("%s: could not load the '%s' xprt.\n",
+		       __func__, xprt);
+		exit(1);
+	}
+	if (is_server) {
+		/* one map per set, so that each set has its own map key */
+		lmaps = calloc(num_sets, sizeof(lmaps[0]));
+		ASSERT(lmaps != NULL);
+		for (i = 0; i < num_sets; i++) {
+			err = zap_map(&lmaps[i], sets + i * SET_SZ, SET_SZ,
+				      ZAP_ACCESS_READ|ZAP_ACCESS_WRITE);
+			ASSERT( err == ZAP_ERR_OK ); /* zap_map */
+		}
+		do_server(zap, &sin);
+	} else {
+		do_client(zap, &sin);
+	}
+	return 0;
+}